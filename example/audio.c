@@ -4,23 +4,8 @@
 
 void dect_audio_queue(struct dect_audio_handle *ah, struct dect_msg_buf *mb)
 {
-	SDL_LockAudio();
-	ptrlist_add_tail(mb, &ah->queue);
-	SDL_UnlockAudio();
-}
-
-static void dect_decode_g721(struct g72x_state *codec,
-			     int16_t *dst, const uint8_t *src,
-			     unsigned int len)
-{
-	unsigned int i;
-
-	for (i = 0; i < len * 2; i += 2) {
-		dst[i + 0] = g721_decoder(src[i / 2] >> 4,
-					  AUDIO_ENCODING_LINEAR, codec);
-		dst[i + 1] = g721_decoder(src[i / 2] & 0x0f,
-					  AUDIO_ENCODING_LINEAR, codec);
-	}
+	if (dect_uplane_ring_push(dh, ah->ring, mb) < 0)
+		dect_mbuf_free(dh, mb);
 }
 
 static void dect_audio_dequeue(void *data, uint8_t *stream, int len)
@@ -31,18 +16,21 @@ static void dect_audio_dequeue(void *data, uint8_t *stream, int len)
 
 	len /= 4;
 	while (1) {
-		if (ah->queue == NULL)
+		if (ah->cur == NULL)
+			ah->cur = dect_uplane_ring_pop(ah->ring);
+		if (ah->cur == NULL)
 			goto underrun;
-		mb = ah->queue;
+		mb = ah->cur;
 		copy = mb->len;
 		if (copy > len)
 			copy = len;
 
-		dect_decode_g721(&ah->codec, (int16_t *)stream, mb->data, copy);
+		g721_decode_block(mb->data, (int16_t *)stream, 2 * copy,
+				  &ah->codec);
 		dect_mbuf_pull(mb, copy);
 		if (mb->len == 0) {
-			ah->queue = mb->next;
-			free(mb);
+			dect_uplane_ring_recycle(ah->ring, mb);
+			ah->cur = NULL;
 		}
 
 		len -= copy;
@@ -70,16 +58,22 @@ struct dect_audio_handle *dect_audio_open(void)
 	ah = malloc(sizeof(*ah));
 	if (ah == NULL)
 		goto err1;
-	ptrlist_init(&ah->queue);
+	ah->cur = NULL;
 	g72x_init_state(&ah->codec);
 
+	ah->ring = dect_uplane_ring_alloc(dh, 32);
+	if (ah->ring == NULL)
+		goto err2;
+
 	spec.userdata = ah;
 	if (SDL_OpenAudio(&spec, NULL) < 0)
-		goto err2;
+		goto err3;
 	SDL_PauseAudio(0);
 
 	return ah;
 
+err3:
+	dect_uplane_ring_free(dh, ah->ring);
 err2:
 	free(ah);
 err1:
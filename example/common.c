@@ -43,6 +43,11 @@ void dect_common_init(struct dect_ops *ops, const char *cluster)
 	dh = dect_open_handle(ops, cluster);
 	if (dh == NULL)
 		pexit("dect_init");
+
+	/* Record S-SAP traffic for dect-replay */
+	if (getenv("DECT_RECORD") != NULL &&
+	    dect_record_start(dh, getenv("DECT_RECORD")) < 0)
+		pexit("dect_record_start");
 }
 
 void dect_common_cleanup(struct dect_handle *dh)
@@ -45,7 +45,8 @@ extern void pexit(const char *str);
 
 struct dect_audio_handle {
 	struct g72x_state	codec;
-	struct dect_msg_buf	*queue;
+	struct dect_uplane_ring	*ring;
+	struct dect_msg_buf	*cur;
 };
 
 extern struct dect_audio_handle *dect_audio_open(void);
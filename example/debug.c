@@ -1,3 +1,4 @@
+#include <stdlib.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <stdarg.h>
@@ -49,6 +50,13 @@ static void __fmtstring(2, 0) dect_debug_fn(enum dect_debug_subsys subsys,
 
 void dect_debug_init(void)
 {
+	const char *ring;
+
 	tty = isatty(fileno(stdout));
 	dect_set_debug_hook(dect_debug_fn);
+
+	/* Record binary traces for trace-decode instead of printing them */
+	ring = getenv("DECT_TRACE_RING");
+	if (ring != NULL && dect_trace_ring_open(ring, 0) < 0)
+		fprintf(stderr, "failed to open trace ring %s\n", ring);
 }
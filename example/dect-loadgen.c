@@ -0,0 +1,1140 @@
+/*
+ * DECT PP load generator
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/*
+ * Simulates a population of PPs attached to one FP within a single process,
+ * using the mock transport. PPs perform location updates, authentication,
+ * access rights requests and calls exchanging U-plane frames, the FP sends
+ * CLMS messages, at a configurable rate and mix. Throughput and latency
+ * percentiles are reported per procedure as key=value pairs.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <inttypes.h>
+#include <getopt.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+
+#include <dect/libdect.h>
+#include <dect/auth.h>
+#include <timer.h>
+#include "common.h"
+
+/* Interval of the rate timer in milliseconds */
+#define LG_TICK_MS		10
+/* Procedure timeout in microseconds */
+#define LG_TIMEOUT		(10 * 1000000ULL)
+/* Time to wait for outstanding procedures after the run in microseconds */
+#define LG_DRAIN		(2 * 1000000ULL)
+/* Size of a U-plane frame */
+#define LG_FRAME_SIZE		40
+/* Maximum number of events returned by a single epoll_wait() call */
+#define LG_EVENTS_MAX		64
+
+static const char *pin = "1234";
+
+enum lg_procs {
+	LG_LOCATE,
+	LG_AUTH,
+	LG_ACCESS,
+	LG_CALL,
+	LG_CLMS,
+	__LG_PROC_MAX
+};
+#define LG_PROC_MAX		(__LG_PROC_MAX - 1)
+#define LG_NONE			__LG_PROC_MAX
+
+static const char * const lg_proc_names[__LG_PROC_MAX] = {
+	[LG_LOCATE]	= "locate",
+	[LG_AUTH]	= "auth",
+	[LG_ACCESS]	= "access",
+	[LG_CALL]	= "call",
+	[LG_CLMS]	= "clms",
+};
+
+/**
+ * struct lg_stats - procedure statistics
+ *
+ * @started:	procedures started, for CLMS expected receptions
+ * @completed:	procedures completed successfully
+ * @failed:	procedures failed
+ * @timeouts:	procedures timed out
+ * @skipped:	procedures not started because all PPs were busy
+ * @samples:	latencies of completed procedures in microseconds
+ * @nsamples:	number of latency samples
+ * @size:	size of the sample array
+ */
+struct lg_stats {
+	uint64_t		started;
+	uint64_t		completed;
+	uint64_t		failed;
+	uint64_t		timeouts;
+	uint64_t		skipped;
+	uint64_t		*samples;
+	unsigned int		nsamples;
+	unsigned int		size;
+};
+
+/**
+ * struct lg_handle - simulated FP or PP handle
+ *
+ * @ops:	DECT ops of the handle
+ * @ep:		epoll event backend
+ * @dh:		libdect DECT handle
+ */
+struct lg_handle {
+	struct dect_ops		ops;
+	struct dect_epoll	*ep;
+	struct dect_handle	*dh;
+};
+
+/**
+ * struct lg_pp - simulated PP
+ *
+ * @h:		handle
+ * @ipui:	IPUI
+ * @proc:	active procedure or LG_NONE
+ * @start:	start time of the active procedure
+ * @rand:	RAND value of an authentication
+ * @call:	active call
+ * @rx_bytes:	U-plane bytes received during the active call
+ * @timer:	call release timer
+ */
+struct lg_pp {
+	struct lg_handle	h;
+	struct dect_ipui	ipui;
+	enum lg_procs		proc;
+	uint64_t		start;
+	uint64_t		rand;
+	struct dect_call	*call;
+	unsigned int		rx_bytes;
+	struct dect_timer	*timer;
+};
+
+static struct dect_mock_cluster *mc;
+static struct lg_handle fp;
+static struct lg_handle *shards;
+static unsigned int nshards;
+static bool batch;
+static const char *ldb_path;
+static bool keystore;
+static struct lg_pp *pps;
+static unsigned int npps = 100;
+static unsigned int next_pp;
+
+static struct lg_stats stats[__LG_PROC_MAX];
+static unsigned int weights[__LG_PROC_MAX] = { 1, 1, 1, 1, 1 };
+static unsigned int weight_sum;
+static double rate = 100.0, credit;
+static unsigned int frames = 50;
+static unsigned int ticks;
+
+static uint64_t last_tick, run_end, drain_end;
+static uint8_t k[DECT_AUTH_KEY_LEN];
+static int epfd;
+
+static uint64_t lg_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static struct lg_handle *lg_handle(struct dect_handle *dh)
+{
+	return *(struct lg_handle **)dect_handle_priv(dh);
+}
+
+static struct lg_pp *lg_pp(struct dect_handle *dh)
+{
+	return container_of(lg_handle(dh), struct lg_pp, h);
+}
+
+static void lg_sample(struct lg_stats *s, uint64_t latency)
+{
+	if (s->nsamples == s->size) {
+		s->size = s->size ? 2 * s->size : 1024;
+		s->samples = realloc(s->samples, s->size * sizeof(s->samples[0]));
+		if (s->samples == NULL)
+			pexit("realloc");
+	}
+	s->samples[s->nsamples++] = latency;
+}
+
+static void lg_complete(struct lg_pp *pp, enum lg_procs proc, bool success)
+{
+	struct lg_stats *s = &stats[proc];
+
+	/* Ignore late results of timed out procedures */
+	if (pp->proc != proc)
+		return;
+	pp->proc = LG_NONE;
+
+	if (success) {
+		s->completed++;
+		lg_sample(s, lg_now() - pp->start);
+	} else
+		s->failed++;
+}
+
+/*
+ * Mobility Management
+ */
+
+static int lg_locate_req(struct lg_pp *pp, struct dect_mm_endpoint *mme)
+{
+	struct dect_ie_portable_identity portable_identity;
+	struct dect_ie_location_area location_area;
+	struct dect_ie_terminal_capability terminal_capability;
+	struct dect_mm_locate_param param = {
+		.portable_identity	= &portable_identity,
+		.location_area		= &location_area,
+		.terminal_capability	= &terminal_capability,
+	};
+
+	portable_identity.type	= DECT_PORTABLE_ID_TYPE_IPUI;
+	portable_identity.ipui	= pp->ipui;
+
+	location_area.type	= DECT_LOCATION_AREA_LEVEL;
+	location_area.level	= 36;
+
+	dect_pp_init_terminal_capability(&terminal_capability);
+
+	return dect_mm_locate_req(pp->h.dh, mme, &param);
+}
+
+static int lg_authenticate_req(struct lg_pp *pp, struct dect_mm_endpoint *mme)
+{
+	struct dect_ie_auth_type auth_type;
+	struct dect_ie_auth_value rand;
+	struct dect_mm_authenticate_param param = {
+		.auth_type	= &auth_type,
+		.rand		= &rand,
+	};
+
+	pp->rand = (uint64_t)random() << 32 | random();
+
+	auth_type.auth_id		= DECT_AUTH_DSAA;
+	auth_type.auth_key_type		= DECT_KEY_AUTHENTICATION_CODE;
+	auth_type.auth_key_num		= 0 | DECT_AUTH_KEY_IPUI_PARK;
+	auth_type.cipher_key_num	= 0;
+	auth_type.flags			= 0;
+	rand.value			= pp->rand;
+
+	return dect_mm_authenticate_req(pp->h.dh, mme, &param);
+}
+
+static int lg_access_rights_req(struct lg_pp *pp, struct dect_mm_endpoint *mme)
+{
+	struct dect_ie_portable_identity portable_identity;
+	struct dect_ie_auth_type auth_type;
+	struct dect_ie_terminal_capability terminal_capability;
+	struct dect_mm_access_rights_param param = {
+		.portable_identity	= &portable_identity,
+		.auth_type		= &auth_type,
+		.terminal_capability	= &terminal_capability,
+	};
+
+	portable_identity.type		= DECT_PORTABLE_ID_TYPE_IPUI;
+	portable_identity.ipui		= pp->ipui;
+
+	auth_type.auth_id		= DECT_AUTH_DSAA;
+	auth_type.auth_key_type		= DECT_KEY_AUTHENTICATION_CODE;
+	auth_type.auth_key_num		= 0 | DECT_AUTH_KEY_IPUI_PARK;
+	auth_type.cipher_key_num	= 0;
+	auth_type.flags			= 0;
+
+	dect_pp_init_terminal_capability(&terminal_capability);
+
+	return dect_mm_access_rights_req(pp->h.dh, mme, &param);
+}
+
+static void lg_dl_establish_cfm(struct dect_handle *dh, bool success,
+				struct dect_data_link *ddl,
+				const struct dect_mac_conn_params *mcp)
+{
+	struct lg_pp *pp = lg_pp(dh);
+	struct dect_mm_endpoint *mme;
+	enum lg_procs proc = pp->proc;
+	int err;
+
+	/* Links of calls are established by Call Control */
+	if (proc != LG_LOCATE && proc != LG_AUTH && proc != LG_ACCESS)
+		return;
+	if (!success)
+		goto err;
+
+	mme = dect_mm_endpoint_alloc(dh, ddl);
+	if (mme == NULL)
+		goto err;
+
+	if (proc == LG_LOCATE)
+		err = lg_locate_req(pp, mme);
+	else if (proc == LG_AUTH)
+		err = lg_authenticate_req(pp, mme);
+	else
+		err = lg_access_rights_req(pp, mme);
+	if (err < 0)
+		goto err;
+	return;
+
+err:
+	lg_complete(pp, proc, false);
+}
+
+static void lg_pp_mm_locate_cfm(struct dect_handle *dh,
+				struct dect_mm_endpoint *mme, bool accept,
+				struct dect_mm_locate_param *param)
+{
+	lg_complete(lg_pp(dh), LG_LOCATE, accept);
+}
+
+static void lg_pp_mm_authenticate_cfm(struct dect_handle *dh,
+				      struct dect_mm_endpoint *mme, bool accept,
+				      struct dect_mm_authenticate_param *param)
+{
+	struct lg_pp *pp = lg_pp(dh);
+	uint8_t ks[DECT_AUTH_KEY_LEN];
+	uint32_t res2;
+
+	if (accept && param->res != NULL) {
+		dect_auth_a21(k, param->rs ? param->rs->value : 0, ks);
+		dect_auth_a22(ks, pp->rand, &res2);
+		accept = res2 == param->res->value;
+	} else
+		accept = false;
+
+	lg_complete(pp, LG_AUTH, accept);
+}
+
+static void lg_pp_mm_access_rights_cfm(struct dect_handle *dh,
+				       struct dect_mm_endpoint *mme, bool accept,
+				       struct dect_mm_access_rights_param *param)
+{
+	lg_complete(lg_pp(dh), LG_ACCESS, accept);
+}
+
+static void lg_fp_mm_locate_ind(struct dect_handle *dh,
+				struct dect_mm_endpoint *mme,
+				struct dect_mm_locate_param *param)
+{
+	struct dect_mm_locate_param reply = {
+		.portable_identity	= param->portable_identity,
+		.location_area		= param->location_area,
+	};
+
+	dect_mm_locate_res(dh, mme, true, &reply);
+}
+
+static void lg_fp_mm_authenticate_ind(struct dect_handle *dh,
+				      struct dect_mm_endpoint *mme,
+				      struct dect_mm_authenticate_param *param)
+{
+	struct dect_ie_auth_res res2;
+	struct dect_mm_authenticate_param reply = {
+		.res	= &res2,
+	};
+	uint8_t ks[DECT_AUTH_KEY_LEN];
+
+	if (param->rand == NULL)
+		return dect_mm_authenticate_res(dh, mme, false, &reply);
+
+	dect_auth_a21(k, param->rs ? param->rs->value : 0, ks);
+	dect_auth_a22(ks, param->rand->value, &res2.value);
+	dect_mm_authenticate_res(dh, mme, true, &reply);
+}
+
+static void lg_fp_mm_access_rights_ind(struct dect_handle *dh,
+				       struct dect_mm_endpoint *mme,
+				       struct dect_mm_access_rights_param *param)
+{
+	dect_mm_access_rights_res(dh, mme, true, param);
+}
+
+/*
+ * Call Control
+ */
+
+static int lg_call_setup(struct lg_pp *pp)
+{
+	struct dect_ie_basic_service basic_service;
+	struct dect_mncc_setup_param param = {
+		.basic_service	= &basic_service,
+	};
+
+	pp->call = dect_call_alloc(pp->h.dh);
+	if (pp->call == NULL)
+		return -1;
+	pp->rx_bytes = 0;
+
+	basic_service.class   = DECT_CALL_CLASS_NORMAL;
+	basic_service.service = DECT_SERVICE_BASIC_SPEECH_DEFAULT;
+
+	return dect_mncc_setup_req(pp->h.dh, pp->call, &pp->ipui, &param);
+}
+
+static void lg_call_release(struct dect_handle *dh, struct dect_timer *timer)
+{
+	struct lg_pp *pp = dect_timer_data(timer);
+	struct dect_mncc_release_param param = {};
+
+	if (pp->proc != LG_CALL)
+		return;
+	if (dect_mncc_release_req(dh, pp->call, &param) < 0)
+		lg_complete(pp, LG_CALL, false);
+}
+
+static void lg_pp_mncc_connect_ind(struct dect_handle *dh, struct dect_call *call,
+				   struct dect_mncc_connect_param *param)
+{
+	struct lg_pp *pp = lg_pp(dh);
+	struct dect_mncc_connect_param reply = {};
+	unsigned int i;
+
+	dect_mncc_connect_res(dh, call, &reply);
+	if (call != pp->call || pp->proc != LG_CALL)
+		return;
+
+	for (i = 0; i < frames; i++) {
+		DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
+
+		memset(dect_mbuf_put(mb, LG_FRAME_SIZE), i, LG_FRAME_SIZE);
+		if (dect_dl_u_data_req(dh, call, mb) < 0)
+			return lg_complete(pp, LG_CALL, false);
+	}
+
+	if (frames == 0)
+		dect_timer_start_ms(dh, pp->timer, 1);
+}
+
+static void lg_pp_dl_u_data_view_ind(struct dect_handle *dh, struct dect_call *call,
+				     const struct dect_msg_buf *mb)
+{
+	struct lg_pp *pp = lg_pp(dh);
+
+	if (call != pp->call || pp->proc != LG_CALL)
+		return;
+
+	/* Release once all frames have been echoed by the FP */
+	pp->rx_bytes += mb->len;
+	if (pp->rx_bytes >= frames * LG_FRAME_SIZE &&
+	    !dect_timer_running(pp->timer))
+		dect_timer_start_ms(dh, pp->timer, 1);
+}
+
+static void lg_pp_mncc_release_ind(struct dect_handle *dh, struct dect_call *call,
+				   struct dect_mncc_release_param *param)
+{
+	struct lg_pp *pp = lg_pp(dh);
+
+	dect_mncc_release_res(dh, call, param);
+	if (call != pp->call)
+		return;
+	pp->call = NULL;
+	lg_complete(pp, LG_CALL, false);
+}
+
+static void lg_pp_mncc_release_cfm(struct dect_handle *dh, struct dect_call *call,
+				   enum dect_causes cause,
+				   struct dect_mncc_release_param *param)
+{
+	struct lg_pp *pp = lg_pp(dh);
+
+	if (call != pp->call)
+		return;
+	pp->call = NULL;
+	lg_complete(pp, LG_CALL, cause == DECT_CAUSE_PEER_MESSAGE);
+}
+
+static void lg_pp_mncc_reject_ind(struct dect_handle *dh, struct dect_call *call,
+				  enum dect_causes cause,
+				  struct dect_mncc_release_param *param)
+{
+	struct lg_pp *pp = lg_pp(dh);
+
+	if (call != pp->call)
+		return;
+	pp->call = NULL;
+	lg_complete(pp, LG_CALL, false);
+}
+
+static void lg_fp_mncc_setup_ind(struct dect_handle *dh, struct dect_call *call,
+				 struct dect_mncc_setup_param *setup)
+{
+	struct dect_mncc_connect_param param = {};
+
+	dect_mncc_connect_req(dh, call, &param);
+}
+
+/* Batched delivery of the FP indications */
+static void lg_fp_ind_batch(struct dect_handle *dh, const struct dect_ind *inds,
+			    unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++) {
+		switch (inds[i].type) {
+		case DECT_IND_MNCC_SETUP:
+			lg_fp_mncc_setup_ind(dh, inds[i].call, inds[i].setup);
+			break;
+		case DECT_IND_MM_LOCATE:
+			lg_fp_mm_locate_ind(dh, inds[i].mme, inds[i].locate);
+			break;
+		case DECT_IND_MM_ACCESS_RIGHTS:
+			lg_fp_mm_access_rights_ind(dh, inds[i].mme,
+						   inds[i].access_rights);
+			break;
+		case DECT_IND_MM_DETACH:
+			break;
+		}
+	}
+}
+
+static void lg_fp_mncc_release_ind(struct dect_handle *dh, struct dect_call *call,
+				   struct dect_mncc_release_param *param)
+{
+	dect_mncc_release_res(dh, call, param);
+}
+
+static void lg_fp_dl_u_data_view_ind(struct dect_handle *dh, struct dect_call *call,
+				     const struct dect_msg_buf *mb)
+{
+	DECT_DEFINE_MSG_BUF_ONSTACK(_echo), *echo = &_echo;
+
+	memcpy(dect_mbuf_put(echo, mb->len), mb->data, mb->len);
+	dect_dl_u_data_req(dh, call, echo);
+}
+
+/*
+ * CLMS
+ */
+
+static void lg_clms_send(void)
+{
+	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
+	struct dect_ie_network_parameter network_parameter;
+	struct lg_stats *s = &stats[LG_CLMS];
+	uint64_t now = lg_now();
+
+	network_parameter.discriminator = DECT_NETWORK_PARAMETER_APPLICATION_ASSIGNED;
+	network_parameter.len		= sizeof(now);
+	memcpy(network_parameter.data, &now, sizeof(now));
+
+	s->started += npps;
+	if (dect_build_sfmt_ie(fp.dh, DECT_IE_NETWORK_PARAMETER, mb,
+			       &network_parameter.common) < 0)
+		return;
+
+	dect_mncl_unitdata_req(fp.dh, DECT_CLMS_FIXED, NULL, mb);
+}
+
+static void lg_mncl_unitdata_ind(struct dect_handle *dh,
+				 enum dect_clms_message_types type,
+				 struct dect_mncl_unitdata_param *param,
+				 struct dect_msg_buf *mb)
+{
+	struct dect_ie_network_parameter *network_parameter;
+	struct lg_stats *s = &stats[LG_CLMS];
+	struct dect_ie_common *dst;
+	struct dect_sfmt_ie ie;
+	uint64_t sent;
+
+	if (dect_parse_sfmt_ie_header(&ie, mb) < 0)
+		return;
+	if (ie.id != DECT_IE_NETWORK_PARAMETER)
+		return;
+	if (dect_parse_sfmt_ie(dh, 0, &dst, &ie) < 0)
+		return;
+
+	network_parameter = dect_ie_container(network_parameter, dst);
+	if (network_parameter->len == sizeof(sent)) {
+		memcpy(&sent, network_parameter->data, sizeof(sent));
+		s->completed++;
+		lg_sample(s, lg_now() - sent);
+	}
+	dect_ie_put(dh, network_parameter);
+}
+
+/*
+ * Load generation
+ */
+
+static struct lg_pp *lg_idle_pp(void)
+{
+	struct lg_pp *pp;
+	unsigned int i;
+
+	for (i = 0; i < npps; i++) {
+		pp = &pps[next_pp];
+		next_pp = (next_pp + 1) % npps;
+		if (pp->proc == LG_NONE)
+			return pp;
+	}
+	return NULL;
+}
+
+static enum lg_procs lg_pick(void)
+{
+	unsigned int r = random() % weight_sum;
+	enum lg_procs proc;
+
+	for (proc = 0; proc < LG_PROC_MAX; proc++) {
+		if (r < weights[proc])
+			break;
+		r -= weights[proc];
+	}
+	return proc;
+}
+
+static void lg_start(enum lg_procs proc)
+{
+	struct dect_mac_conn_params mcp = {};
+	struct lg_pp *pp;
+	int err;
+
+	if (proc == LG_CLMS)
+		return lg_clms_send();
+
+	pp = lg_idle_pp();
+	if (pp == NULL) {
+		stats[proc].skipped++;
+		return;
+	}
+
+	stats[proc].started++;
+	pp->proc  = proc;
+	pp->start = lg_now();
+
+	if (proc == LG_CALL)
+		err = lg_call_setup(pp);
+	else
+		err = dect_dl_establish_req(pp->h.dh, &pp->ipui, &mcp);
+	if (err < 0)
+		lg_complete(pp, proc, false);
+}
+
+static void lg_expire(uint64_t now)
+{
+	struct lg_pp *pp;
+	unsigned int i;
+
+	for (i = 0; i < npps; i++) {
+		pp = &pps[i];
+		if (pp->proc == LG_NONE || now < pp->start + LG_TIMEOUT)
+			continue;
+		stats[pp->proc].timeouts++;
+		pp->proc = LG_NONE;
+	}
+}
+
+static void lg_tick(struct dect_handle *dh, struct dect_timer *timer)
+{
+	uint64_t now = lg_now();
+
+	/* Credit is based on the elapsed time to compensate for late ticks */
+	if (now < run_end) {
+		credit += rate * (now - last_tick) / 1000000;
+		for (; credit >= 1; credit -= 1)
+			lg_start(lg_pick());
+	}
+	last_tick = now;
+
+	/* Check for timeouts once per second */
+	if (++ticks % (1000 / LG_TICK_MS) == 0)
+		lg_expire(now);
+
+	dect_timer_start_ms(dh, timer, LG_TICK_MS);
+}
+
+static int lg_sample_cmp(const void *p1, const void *p2)
+{
+	uint64_t v1 = *(const uint64_t *)p1, v2 = *(const uint64_t *)p2;
+
+	return v1 < v2 ? -1 : v1 > v2;
+}
+
+static uint64_t lg_percentile(const struct lg_stats *s, unsigned int p)
+{
+	if (s->nsamples == 0)
+		return 0;
+	return s->samples[(uint64_t)(s->nsamples - 1) * p / 100];
+}
+
+static void lg_report(uint64_t duration)
+{
+	struct dect_mock_stats mstats;
+	struct lg_stats *s;
+	unsigned int i;
+
+	for (i = 0; i < __LG_PROC_MAX; i++) {
+		s = &stats[i];
+		if (s->started == 0 && s->skipped == 0)
+			continue;
+
+		qsort(s->samples, s->nsamples, sizeof(s->samples[0]),
+		      lg_sample_cmp);
+		printf("proc=%s started=%" PRIu64 " completed=%" PRIu64
+		       " failed=%" PRIu64 " timeouts=%" PRIu64
+		       " skipped=%" PRIu64 " per_sec=%" PRIu64
+		       " p50_us=%" PRIu64 " p90_us=%" PRIu64
+		       " p99_us=%" PRIu64 " max_us=%" PRIu64 "\n",
+		       lg_proc_names[i], s->started, s->completed,
+		       i == LG_CLMS ? s->started - s->completed : s->failed,
+		       s->timeouts, s->skipped,
+		       duration ? s->completed * 1000000 / duration : 0,
+		       lg_percentile(s, 50), lg_percentile(s, 90),
+		       lg_percentile(s, 99), lg_percentile(s, 100));
+	}
+
+	dect_mock_cluster_get_stats(mc, &mstats);
+	printf("mock links=%" PRIu64 " link_failures=%" PRIu64
+	       " lu_links=%" PRIu64 " broadcasts=%" PRIu64
+	       " deliveries=%" PRIu64 " drops=%" PRIu64 "\n",
+	       mstats.links, mstats.link_failures, mstats.lu_links,
+	       mstats.broadcasts, mstats.deliveries, mstats.drops);
+
+	if (nshards > 0) {
+		struct dect_shard_stats sstats;
+
+		dect_shard_get_stats(fp.dh, &sstats);
+		printf("shard links=%" PRIu64 " links_by_pmid=%" PRIu64
+		       " link_timeouts=%" PRIu64 " link_drops=%" PRIu64
+		       " pages=%" PRIu64 " broadcasts=%" PRIu64
+		       " drops=%" PRIu64 "\n",
+		       sstats.links, sstats.links_by_pmid, sstats.link_timeouts,
+		       sstats.link_drops, sstats.pages, sstats.broadcasts,
+		       sstats.drops);
+	}
+}
+
+/*
+ * Handles
+ */
+
+static struct dect_llme_ops_ fp_llme_ops;
+
+static struct dect_lce_ops fp_lce_ops;
+
+static struct dect_mm_ops fp_mm_ops = {
+	.mm_locate_ind		= lg_fp_mm_locate_ind,
+	.mm_authenticate_ind	= lg_fp_mm_authenticate_ind,
+	.mm_access_rights_ind	= lg_fp_mm_access_rights_ind,
+};
+
+static struct dect_cc_ops fp_cc_ops = {
+	.mncc_setup_ind		= lg_fp_mncc_setup_ind,
+	.mncc_release_ind	= lg_fp_mncc_release_ind,
+	.dl_u_data_view_ind	= lg_fp_dl_u_data_view_ind,
+};
+
+static struct dect_clms_ops fp_clms_ops;
+
+static struct dect_ops fp_ops = {
+	.llme_ops		= &fp_llme_ops,
+	.lce_ops		= &fp_lce_ops,
+	.mm_ops			= &fp_mm_ops,
+	.cc_ops			= &fp_cc_ops,
+	.clms_ops		= &fp_clms_ops,
+};
+
+static struct dect_llme_ops_ pp_llme_ops;
+
+static struct dect_lce_ops pp_lce_ops = {
+	.dl_establish_cfm	= lg_dl_establish_cfm,
+};
+
+static struct dect_mm_ops pp_mm_ops = {
+	.mm_locate_cfm		= lg_pp_mm_locate_cfm,
+	.mm_authenticate_cfm	= lg_pp_mm_authenticate_cfm,
+	.mm_access_rights_cfm	= lg_pp_mm_access_rights_cfm,
+};
+
+static struct dect_cc_ops pp_cc_ops = {
+	.mncc_connect_ind	= lg_pp_mncc_connect_ind,
+	.mncc_release_ind	= lg_pp_mncc_release_ind,
+	.mncc_release_cfm	= lg_pp_mncc_release_cfm,
+	.mncc_reject_ind	= lg_pp_mncc_reject_ind,
+	.dl_u_data_view_ind	= lg_pp_dl_u_data_view_ind,
+};
+
+static struct dect_clms_ops pp_clms_ops = {
+	.mncl_unitdata_ind	= lg_mncl_unitdata_ind,
+};
+
+static struct dect_ops pp_ops = {
+	.llme_ops		= &pp_llme_ops,
+	.lce_ops		= &pp_lce_ops,
+	.mm_ops			= &pp_mm_ops,
+	.cc_ops			= &pp_cc_ops,
+	.clms_ops		= &pp_clms_ops,
+};
+
+/* Store the authentication codes of all PPs in the key store of a FP handle */
+static int lg_keystore_open(struct dect_handle *dh)
+{
+	struct dect_keystore_entry entry = {
+		.flags	= DECT_KEYSTORE_AC,
+	};
+	struct dect_ipui ipui = {
+		.put	= DECT_IPUI_N,
+	};
+	unsigned int n, size = 2;
+
+	while (size < 2 * npps)
+		size <<= 1;
+	if (dect_keystore_open(dh, NULL, size) < 0)
+		return -1;
+
+	dect_pin_to_ac(pin, entry.ac, sizeof(entry.ac));
+	ipui.pun.n.ipei.emc = 0x0ba8;
+	for (n = 0; n < npps; n++) {
+		ipui.pun.n.ipei.psn = n + 1;
+		if (dect_keystore_update(dh, &ipui, &entry) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+static int lg_open(struct lg_handle *h, const struct dect_ops *ops,
+		   uint32_t mode, struct dect_handle *primary)
+{
+	struct epoll_event ev;
+
+	h->ops = *ops;
+	h->ops.priv_size = sizeof(h);
+
+	h->ep = dect_epoll_alloc(&h->ops);
+	if (h->ep == NULL)
+		goto err1;
+
+	if (primary != NULL)
+		h->dh = dect_shard_open(primary, &h->ops);
+	else
+		h->dh = dect_mock_open_handle(&h->ops, mc, mode);
+	if (h->dh == NULL)
+		goto err2;
+	*(struct lg_handle **)dect_handle_priv(h->dh) = h;
+
+	if (mode == DECT_MODE_FP && batch &&
+	    dect_ind_batch_enable(h->dh, lg_fp_ind_batch) < 0)
+		goto err3;
+	if (mode == DECT_MODE_FP && primary == NULL && ldb_path != NULL &&
+	    dect_ldb_open(h->dh, ldb_path, 1024) < 0)
+		goto err3;
+	if (mode == DECT_MODE_FP && keystore && lg_keystore_open(h->dh) < 0)
+		goto err3;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events   = EPOLLIN;
+	ev.data.ptr = h;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, dect_epoll_fd(h->ep), &ev) < 0)
+		goto err3;
+	return 0;
+
+err3:
+	dect_close_handle(h->dh);
+err2:
+	dect_epoll_free(h->ep);
+err1:
+	return -1;
+}
+
+static void lg_close(struct lg_handle *h)
+{
+	dect_close_handle(h->dh);
+	dect_epoll_free(h->ep);
+}
+
+static int lg_pp_open(struct lg_pp *pp, unsigned int index)
+{
+	struct dect_tpui tpui;
+	unsigned int i, n;
+
+	if (lg_open(&pp->h, &pp_ops, DECT_MODE_PP, NULL) < 0)
+		return -1;
+
+	pp->timer = dect_timer_alloc(pp->h.dh);
+	if (pp->timer == NULL) {
+		lg_close(&pp->h);
+		return -1;
+	}
+	dect_timer_setup(pp->timer, lg_call_release, pp);
+
+	pp->proc		 = LG_NONE;
+	pp->ipui.put		 = DECT_IPUI_N;
+	pp->ipui.pun.n.ipei.emc	 = 0x0ba8;
+	pp->ipui.pun.n.ipei.psn	 = index + 1;
+	dect_pp_set_ipui(pp->h.dh, &pp->ipui);
+
+	/* A distinct assigned PMID keeps U-plane endpoints unique */
+	tpui.type = DECT_TPUI_INDIVIDUAL_ASSIGNED;
+	for (i = array_size(tpui.ia.digits), n = index; i > 0; i--, n /= 10)
+		tpui.ia.digits[i - 1] = n % 10;
+	dect_pp_set_tpui(pp->h.dh, &tpui);
+	return 0;
+}
+
+static void lg_pp_close(struct lg_pp *pp)
+{
+	if (dect_timer_running(pp->timer))
+		dect_timer_stop(pp->h.dh, pp->timer);
+	dect_timer_free(pp->h.dh, pp->timer);
+	lg_close(&pp->h);
+}
+
+static void lg_batch_begin(void)
+{
+	unsigned int i;
+
+	if (!batch)
+		return;
+	dect_ind_batch_begin(fp.dh);
+	for (i = 0; i < nshards; i++)
+		dect_ind_batch_begin(shards[i].dh);
+}
+
+static void lg_batch_end(void)
+{
+	unsigned int i;
+
+	if (!batch)
+		return;
+	dect_ind_batch_end(fp.dh);
+	for (i = 0; i < nshards; i++)
+		dect_ind_batch_end(shards[i].dh);
+}
+
+static void lg_run(void)
+{
+	struct epoll_event ev[LG_EVENTS_MAX];
+	struct lg_handle *h;
+	int i, n;
+
+	while (lg_now() < drain_end) {
+		n = epoll_wait(epfd, ev, array_size(ev), LG_TICK_MS);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			pexit("epoll_wait");
+		}
+
+		/* Deliver the FP indications once per iteration */
+		lg_batch_begin();
+		for (i = 0; i < n; i++) {
+			h = ev[i].data.ptr;
+			dect_epoll_dispatch(h->ep, h->dh, 0);
+		}
+		lg_batch_end();
+	}
+}
+
+static int lg_parse_mix(const char *arg)
+{
+	char *str, *tok, *val, *save;
+	unsigned int i;
+
+	str = strdup(arg);
+	if (str == NULL)
+		return -1;
+	memset(weights, 0, sizeof(weights));
+
+	for (tok = strtok_r(str, ",", &save); tok != NULL;
+	     tok = strtok_r(NULL, ",", &save)) {
+		val = strchr(tok, '=');
+		if (val == NULL)
+			goto err;
+		*val++ = '\0';
+
+		for (i = 0; i < __LG_PROC_MAX; i++) {
+			if (!strcmp(tok, lg_proc_names[i]))
+				break;
+		}
+		if (i == __LG_PROC_MAX)
+			goto err;
+		weights[i] = strtoul(val, NULL, 0);
+	}
+	free(str);
+	return 0;
+
+err:
+	fprintf(stderr, "invalid mix: %s\n", arg);
+	free(str);
+	return -1;
+}
+
+enum {
+	OPT_PPS		= 'n',
+	OPT_RATE	= 'r',
+	OPT_DURATION	= 'd',
+	OPT_MIX		= 'm',
+	OPT_FRAMES	= 'f',
+	OPT_SHARDS	= 's',
+	OPT_BATCH	= 'b',
+	OPT_LDB		= 'l',
+	OPT_KEYSTORE	= 'k',
+	OPT_HELP	= 'h',
+};
+
+static const struct option options[] = {
+	{ .name = "pps",	.has_arg = true,  .flag = NULL, .val = OPT_PPS },
+	{ .name = "rate",	.has_arg = true,  .flag = NULL, .val = OPT_RATE },
+	{ .name = "duration",	.has_arg = true,  .flag = NULL, .val = OPT_DURATION },
+	{ .name = "mix",	.has_arg = true,  .flag = NULL, .val = OPT_MIX },
+	{ .name = "frames",	.has_arg = true,  .flag = NULL, .val = OPT_FRAMES },
+	{ .name = "shards",	.has_arg = true,  .flag = NULL, .val = OPT_SHARDS },
+	{ .name = "batch",	.has_arg = false, .flag = NULL, .val = OPT_BATCH },
+	{ .name = "ldb",	.has_arg = true,  .flag = NULL, .val = OPT_LDB },
+	{ .name = "keystore",	.has_arg = false, .flag = NULL, .val = OPT_KEYSTORE },
+	{ .name = "help",	.has_arg = false, .flag = NULL, .val = OPT_HELP },
+
+	{ },
+};
+
+int main(int argc, char **argv)
+{
+	struct dect_ari pari = {
+		.arc	= DECT_ARC_A,
+		.emc	= 0x0ba8,
+		.fpn	= 1,
+	};
+	uint8_t ac[DECT_AUTH_CODE_LEN];
+	unsigned int duration = 10, i, n;
+	struct dect_timer *timer;
+	struct rlimit rl;
+	uint64_t start;
+	int optidx = 0, c;
+
+	for (;;) {
+		c = getopt_long(argc, argv, "n:r:d:m:f:s:bl:kh", options, &optidx);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case OPT_PPS:
+			npps = strtoul(optarg, NULL, 0);
+			break;
+		case OPT_RATE:
+			rate = strtod(optarg, NULL);
+			break;
+		case OPT_DURATION:
+			duration = strtoul(optarg, NULL, 0);
+			break;
+		case OPT_MIX:
+			if (lg_parse_mix(optarg) < 0)
+				exit(1);
+			break;
+		case OPT_FRAMES:
+			frames = strtoul(optarg, NULL, 0);
+			break;
+		case OPT_SHARDS:
+			nshards = strtoul(optarg, NULL, 0);
+			break;
+		case OPT_BATCH:
+			batch = true;
+			break;
+		case OPT_LDB:
+			ldb_path = optarg;
+			break;
+		case OPT_KEYSTORE:
+			keystore = true;
+			break;
+		case OPT_HELP:
+			printf("%s: [ -n/--pps N ] [ -r/--rate PROCS/S ] "
+			       "[ -d/--duration SECS ] "
+			       "[ -m/--mix locate=W,auth=W,access=W,call=W,clms=W ] "
+			       "[ -f/--frames N ] [ -s/--shards N ] "
+			       "[ -b/--batch ] [ -l/--ldb FILE ] [ -k/--keystore ] "
+			       "[ -h/--help ]\n", argv[0]);
+			exit(0);
+		case '?':
+			exit(1);
+		}
+	}
+
+	for (i = 0; i < __LG_PROC_MAX; i++)
+		weight_sum += weights[i];
+	if (npps == 0 || weight_sum == 0) {
+		fprintf(stderr, "%s: no PPs or procedures\n", argv[0]);
+		exit(1);
+	}
+
+	/* Each handle uses a handful of file descriptors */
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+		rl.rlim_cur = rl.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rl);
+	}
+
+	dect_pin_to_ac(pin, ac, sizeof(ac));
+	dect_auth_b1(ac, sizeof(ac), k);
+
+	dect_dummy_ops_init(&fp_ops);
+	dect_dummy_ops_init(&pp_ops);
+
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd < 0)
+		pexit("epoll_create1");
+
+	mc = dect_mock_cluster_alloc(&pari);
+	if (mc == NULL)
+		pexit("dect_mock_cluster_alloc");
+	if (lg_open(&fp, &fp_ops, DECT_MODE_FP, NULL) < 0)
+		pexit("dect_mock_open_handle");
+
+	/* Shards are driven by the same thread, the mock cluster isn't shared */
+	shards = calloc(nshards, sizeof(shards[0]));
+	if (nshards > 0 && shards == NULL)
+		pexit("calloc");
+	for (n = 0; n < nshards; n++) {
+		if (lg_open(&shards[n], &fp_ops, DECT_MODE_FP, fp.dh) < 0)
+			pexit("dect_shard_open");
+	}
+
+	pps = calloc(npps, sizeof(pps[0]));
+	if (pps == NULL)
+		pexit("calloc");
+	for (n = 0; n < npps; n++) {
+		if (lg_pp_open(&pps[n], n) < 0) {
+			fprintf(stderr, "%s: PP %u: %s\n", argv[0], n,
+				strerror(errno));
+			exit(1);
+		}
+	}
+
+	timer = dect_timer_alloc(fp.dh);
+	if (timer == NULL)
+		pexit("dect_timer_alloc");
+	dect_timer_setup(timer, lg_tick, NULL);
+	dect_timer_start_ms(fp.dh, timer, LG_TICK_MS);
+
+	start	  = lg_now();
+	last_tick = start;
+	run_end	  = start + duration * 1000000ULL;
+	drain_end = run_end + LG_DRAIN;
+	lg_run();
+
+	lg_report(run_end - start);
+
+	dect_timer_stop(fp.dh, timer);
+	dect_timer_free(fp.dh, timer);
+	for (n = 0; n < npps; n++)
+		lg_pp_close(&pps[n]);
+	/* Shards are closed along with the primary handle */
+	lg_close(&fp);
+	for (n = 0; n < nshards; n++)
+		dect_epoll_free(shards[n].ep);
+	dect_mock_cluster_free(mc);
+	free(shards);
+	free(pps);
+	return 0;
+}
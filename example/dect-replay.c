@@ -0,0 +1,85 @@
+/*
+ * DECT S-SAP traffic replay
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <getopt.h>
+
+#include <dect/libdect.h>
+#include "common.h"
+
+enum {
+	OPT_CLUSTER	= 'c',
+	OPT_ITERATIONS	= 'n',
+	OPT_HELP	= 'h',
+};
+
+static const struct option options[] = {
+	{ .name = "cluster",	.has_arg = true,  .flag = NULL, .val = OPT_CLUSTER },
+	{ .name = "iterations",	.has_arg = true,  .flag = NULL, .val = OPT_ITERATIONS },
+	{ .name = "help",	.has_arg = false, .flag = NULL, .val = OPT_HELP },
+
+	{ },
+};
+
+static struct dect_ops ops;
+
+int main(int argc, char **argv)
+{
+	struct dect_replay_stats stats;
+	unsigned int iterations = 1, i;
+	int optidx = 0, c;
+
+	for (;;) {
+		c = getopt_long(argc, argv, "c:n:h", options, &optidx);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case OPT_CLUSTER:
+			cluster = optarg;
+			break;
+		case OPT_ITERATIONS:
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		case OPT_HELP:
+			printf("%s: [ -c/--cluster NAME ] [ -n/--iterations N ] "
+			       "[ -h/--help ] RECORDING\n", argv[0]);
+			exit(0);
+		case '?':
+			exit(1);
+		}
+	}
+	if (optind != argc - 1) {
+		fprintf(stderr, "%s: no recording specified\n", argv[0]);
+		exit(1);
+	}
+
+	dect_common_init(&ops, cluster);
+
+	/* One line of key=value pairs per iteration */
+	for (i = 0; i < iterations; i++) {
+		if (dect_replay(dh, argv[optind], &stats) < 0) {
+			fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+			exit(1);
+		}
+		printf("iteration=%u rx_msgs=%" PRIu64 " tx_msgs=%" PRIu64
+		       " tx_replies=%" PRIu64 " links=%" PRIu64 " errors=%" PRIu64
+		       " duration_us=%" PRIu64 " msgs_per_sec=%" PRIu64 "\n",
+		       i, stats.rx_msgs, stats.tx_msgs, stats.tx_replies,
+		       stats.links, stats.errors, stats.duration,
+		       stats.duration ? stats.rx_msgs * 1000000 / stats.duration : 0);
+	}
+
+	dect_common_cleanup(dh);
+	return 0;
+}
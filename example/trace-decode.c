@@ -0,0 +1,50 @@
+/*
+ * libdect trace ring decoder
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <dect/libdect.h>
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-t] [-s] RING\n"
+		"  -t	print timestamps\n"
+		"  -s	print subsystem numbers\n", name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int flags = 0;
+	int c;
+
+	while ((c = getopt(argc, argv, "ts")) != -1) {
+		switch (c) {
+		case 't':
+			flags |= DECT_TRACE_DECODE_TIMESTAMPS;
+			break;
+		case 's':
+			flags |= DECT_TRACE_DECODE_SUBSYS;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1)
+		usage(argv[0]);
+
+	if (dect_trace_ring_decode(argv[optind], stdout, flags) < 0) {
+		fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+		return 1;
+	}
+	return 0;
+}
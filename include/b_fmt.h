@@ -6,6 +6,8 @@
 #ifndef _LIBDECT_B_FMT_H
 #define _LIBDECT_B_FMT_H
 
+#include <linux/types.h>
+
 struct dect_short_page_msg {
 	uint8_t		hdr;
 	__be16		information;
@@ -318,34 +318,118 @@ enum dect_cc_states {
 };
 #define DECT_CC_STATE_MAX		(__DECT_CC_STATE_MAX - 1)
 
+/* Size of the U-Plane TX buffer, eight 10ms frames of G.726 data */
+#define DECT_CC_LU_TX_BUF_SIZE		320
+
+/* Maximum number of frames of a call passed to a single sendmsg() call */
+#define DECT_CC_LU_TX_IOV_MAX		16
+
+/* Number of preallocated U-Plane RX buffers */
+#define DECT_CC_LU_RX_RING_SIZE		4
+
+/* Cache line size, used to keep the indices of the U-Plane rings apart */
+#define DECT_CC_CACHELINE_SIZE		64
+
+/**
+ * struct dect_uplane_queue - single producer single consumer queue indices
+ *
+ * @head:	consumer index
+ * @tail:	producer index
+ */
+struct dect_uplane_queue {
+	unsigned int		head __aligned(DECT_CC_CACHELINE_SIZE);
+	unsigned int		tail __aligned(DECT_CC_CACHELINE_SIZE);
+};
+
+/**
+ * struct dect_uplane_ring - U-Plane frame ring
+ *
+ * @mask:	ring size minus one
+ * @outstanding: buffers owned by the ring or the consumer, producer only
+ * @frame_buf:	frame queue entries
+ * @free_buf:	recycle queue entries
+ * @frames:	frame queue from the protocol thread to the consumer
+ * @free:	recycle queue from the consumer to the protocol thread
+ */
+struct dect_uplane_ring {
+	unsigned int		mask;
+	unsigned int		outstanding;
+	struct dect_msg_buf	**frame_buf;
+	struct dect_msg_buf	**free_buf;
+	struct dect_uplane_queue frames;
+	struct dect_uplane_queue free;
+};
+
+/* Maximum number of keypad characters coalesced into one {CC-INFO} */
+#define DECT_CC_INFO_DIGITS_MAX		32
+
 /**
  * @transaction:		LCE link transaction
+ * @state:			call state
+ * @lu_sap:			U-Plane file descriptor
+ * @lu_tx_len:			amount of U-Plane data waiting for transmission
+ * @lu_rx_next:			next U-Plane RX ring slot
+ * @lu_rx_ring:			U-Plane RX buffers, referenced while connected
  * @ft_id:			FT ID
  * @pt_id:			PT ID
- * @state:			call state
  * @overlap_sending_timer:	overlap sending timer (<CC.01>)
  * @release_timer:		call release timer (<CC.02>)
  * @setup_timer:		call setup timer (<CC.03>)
  * @completion_timer:		call setup completion timer (<CC.04>)
  * @connect_timer:		call connect timer (<CC.05>)
- * @lu_sap:			U-Plane file descriptor
+ * @info_timer:			keypad information coalescing timer
+ * @info_len:			number of coalesced keypad characters
+ * @info_digits:		keypad characters waiting to be sent in a {CC-INFO}
+ * @iwu_stream:			IWU-TO-IWU data stream
+ * @lu_suspended:		U-Plane was disconnected by a data link suspension
+ * @proc_start:			start of a pending setup or release for latency statistics
+ * @lu_qstats:			LU1 queue statistics of the previous sample
+ * @lu_qstats_time:		time of the previous sample in milliseconds
+ * @lu_stats_timer:		U-Plane statistics sampling timer
+ * @lu_stats_interval:		sampling interval in milliseconds
+ * @lu_stats_cb:		sampling callback
  * @qstats_timer:		LU1 queue statistics debugging timer
+ * @lu_tx_buf:			U-Plane data waiting for the socket to become writable
  * @priv:			libdect user private storage
+ *
+ * The members used for each message and U-Plane frame come first, the
+ * U-Plane TX buffer, which is only used while the socket is congested, is
+ * placed last. The CC timers are embedded in the call allocation following
+ * the user private storage area.
  */
 struct dect_call {
 	struct dect_transaction			transaction;
+	enum dect_cc_states			state;
+	struct dect_fd				*lu_sap;
+	uint16_t				lu_tx_len;
+	unsigned int				lu_rx_next;
+	struct dect_msg_buf			*lu_rx_ring[DECT_CC_LU_RX_RING_SIZE];
+
 	struct dect_ie_fixed_identity		*ft_id;
 	struct dect_ie_portable_identity	*pt_id;
-	enum dect_cc_states			state;
 	struct dect_timer			*overlap_sending_timer;
 	struct dect_timer			*release_timer;
 	struct dect_timer			*setup_timer;
 	struct dect_timer			*completion_timer;
 	struct dect_timer			*connect_timer;
-	struct dect_fd				*lu_sap;
+	struct dect_timer			*info_timer;
+	uint8_t					info_len;
+	uint8_t					info_digits[DECT_CC_INFO_DIGITS_MAX];
+	struct dect_iwu_stream			*iwu_stream;
+	bool					lu_suspended;
+	enum dect_service_change_modes		service_change;
+	uint64_t				proc_start;
+	struct dect_lu1_queue_stats		lu_qstats;
+	uint64_t				lu_qstats_time;
+	struct dect_timer			*lu_stats_timer;
+	unsigned int				lu_stats_interval;
+	void					(*lu_stats_cb)(struct dect_handle *,
+							       struct dect_call *,
+							       const struct dect_uplane_stats *);
 #ifdef DEBUG
 	struct dect_timer			*qstats_timer;
 #endif
+	uint8_t					lu_tx_buf[DECT_CC_LU_TX_BUF_SIZE];
 	uint8_t					priv[] __aligned(__alignof__(uint64_t));
 };
 
@@ -356,6 +440,15 @@ struct dect_call {
 #define DECT_CC_CONNECT_TIMEOUT		10	/* <CC.05>: 10 seconds */
 #define DECT_CC_QUEUE_STATS_TIMER	1 	/* 1 second */
 
+/* Number of timers embedded in struct dect_call */
+#define DECT_CC_TIMER_MAX		6
+
+extern bool dect_iwu_stream_rcv(struct dect_handle *dh, struct dect_call *call,
+				const struct dect_ie_iwu_to_iwu *ie);
+extern void dect_iwu_stream_call_destroy(struct dect_handle *dh,
+					 struct dect_call *call);
+
 extern const struct dect_nwk_protocol dect_cc_protocol;
+extern const struct dect_sfmt_msg_desc * const dect_cc_msg_descs[];
 
 #endif /* _LIBDECT_CC_H */
@@ -8,12 +8,30 @@ extern void __dect_debug(enum dect_debug_subsys subsys, const char *fmt, ...) __
 extern void __dect_hexdump(enum dect_debug_subsys subsys, const char *prefix,
 			   const uint8_t *buf, size_t size);
 
+extern bool dect_trace_ring_vlog(enum dect_debug_subsys subsys, const char *fmt,
+				 va_list ap);
+extern bool dect_trace_ring_hexdump(enum dect_debug_subsys subsys,
+				    const char *prefix, const uint8_t *buf,
+				    size_t size);
+
+extern unsigned int dect_debug_flags;
+
+struct dect_handle;
+extern void dect_debug_bind(const struct dect_handle *dh);
+
 #ifdef DEBUG
+extern unsigned int dect_debug_mask;
+
+#define dect_debug_enabled(subsys) \
+	(dect_debug_mask & DECT_DEBUG_MASK(subsys))
 #define dect_debug(subsys, fmt, ...) \
-	__dect_debug(subsys, fmt, ## __VA_ARGS__)
+	({ if (dect_debug_enabled(subsys)) \
+		__dect_debug(subsys, fmt, ## __VA_ARGS__); })
 #define dect_hexdump(subsys, pfx, buf, size) \
-	__dect_hexdump(subsys, pfx, buf, size)
+	({ if (dect_debug_enabled(subsys)) \
+		__dect_hexdump(subsys, pfx, buf, size); })
 #else
+#define dect_debug_enabled(subsys)	false
 #define dect_debug(subsys, fmt, ...) \
 	({ if (0) __dect_debug(subsys, fmt, ## __VA_ARGS__); })
 #define dect_hexdump(subsys, pfx, buf, size) \
@@ -44,6 +44,106 @@ extern void dect_auth_a12(const uint8_t *ks, uint64_t rand_f, uint8_t *dck,
 extern void dect_auth_a21(const uint8_t *k, uint64_t rs, uint8_t *ks);
 extern void dect_auth_a22(const uint8_t *ks, uint64_t rand_p, uint32_t *res2);
 
+/** Authentication tuple for batch calculations */
+struct dect_auth_tuple {
+	uint8_t		k[DECT_AUTH_KEY_LEN];		/**< authentication key K */
+	uint64_t	rs;				/**< random seed RS */
+	uint64_t	rand;				/**< random value RAND_F or RAND_P */
+	uint8_t		ks[DECT_AUTH_KEY_LEN];		/**< derived session key KS or KS' */
+	uint8_t		dck[DECT_CIPHER_KEY_LEN];	/**< derived cipher key (A12 only) */
+	uint32_t	res;				/**< authentication response RES1 or RES2 */
+};
+
+extern void dect_auth_a1_batch(struct dect_auth_tuple *tuples, unsigned int n);
+extern void dect_auth_a2_batch(struct dect_auth_tuple *tuples, unsigned int n);
+
+extern int dect_auth_selftest(void);
+
+/** Authentication processes of an offloaded request */
+enum dect_auth_procs {
+	DECT_AUTH_PROC_A1,				/**< A11 and A12 */
+	DECT_AUTH_PROC_A2,				/**< A21 and A22 */
+};
+
+struct dect_handle;
+
+/** Offloaded authentication request */
+struct dect_auth_request {
+	enum dect_auth_procs	proc;			/**< processes to perform */
+	struct dect_auth_tuple	tuple;			/**< authentication tuple */
+	void			(*complete)(struct dect_handle *dh,
+					    struct dect_auth_request *req);	/**< completion callback */
+	void			*priv;			/**< completion callback data */
+};
+
+extern int dect_auth_offload_init(struct dect_handle *dh, unsigned int threads);
+extern void dect_auth_offload_exit(struct dect_handle *dh);
+extern int dect_auth_submit(struct dect_handle *dh,
+			    struct dect_auth_request *reqs[], unsigned int n);
+
+/** Authentication challenge pool flags */
+enum dect_auth_pool_flags {
+	DECT_AUTH_POOL_RANDOM_RS	= 0x1,		/**< use a random RS for each challenge */
+};
+
+/** Authentication challenge pool configuration */
+struct dect_auth_pool_cfg {
+	unsigned int	flags;				/**< pool flags (#dect_auth_pool_flags) */
+	uint64_t	rs;				/**< RS used without #DECT_AUTH_POOL_RANDOM_RS */
+	unsigned int	depth;				/**< maximum number of challenges */
+	unsigned int	low;				/**< refill when the pool falls below this number */
+	unsigned int	high;				/**< refill up to this number */
+};
+
+/** Authentication challenge pool statistics */
+struct dect_auth_pool_stats {
+	unsigned int	depth;				/**< current number of challenges */
+	unsigned int	hits;				/**< challenges taken from the pool */
+	unsigned int	misses;				/**< challenges calculated on demand */
+	unsigned int	refills;			/**< refills started */
+	unsigned int	calculated;			/**< challenges calculated in total */
+};
+
+struct dect_auth_pool;
+
+extern struct dect_auth_pool *dect_auth_pool_alloc(const struct dect_handle *dh,
+						   const uint8_t *k,
+						   const struct dect_auth_pool_cfg *cfg);
+extern void dect_auth_pool_free(const struct dect_handle *dh,
+				struct dect_auth_pool *pool);
+extern int dect_auth_pool_get(const struct dect_handle *dh,
+			      struct dect_auth_pool *pool,
+			      struct dect_auth_tuple *tuple);
+extern void dect_auth_pool_set_key(const struct dect_handle *dh,
+				   struct dect_auth_pool *pool, const uint8_t *k);
+extern void dect_auth_pool_get_stats(const struct dect_auth_pool *pool,
+				     struct dect_auth_pool_stats *stats);
+
+/** Session key cache statistics */
+struct dect_auth_ks_cache_stats {
+	unsigned int	size;				/**< maximum number of entries */
+	unsigned int	entries;			/**< number of used entries */
+	unsigned int	hits;				/**< keys returned from the cache */
+	unsigned int	misses;				/**< keys derived using DSAA */
+	unsigned int	evictions;			/**< entries replaced when full */
+	unsigned int	invalidations;			/**< entries invalidated */
+};
+
+struct dect_ipui;
+
+extern int dect_auth_ks_cache_init(struct dect_handle *dh, unsigned int size);
+extern void dect_auth_ks_cache_exit(struct dect_handle *dh);
+extern void dect_auth_a11_cached(struct dect_handle *dh,
+				 const struct dect_ipui *ipui,
+				 const uint8_t *k, uint64_t rs, uint8_t *ks);
+extern void dect_auth_a21_cached(struct dect_handle *dh,
+				 const struct dect_ipui *ipui,
+				 const uint8_t *k, uint64_t rs, uint8_t *ks);
+extern void dect_auth_ks_cache_invalidate(struct dect_handle *dh,
+					  const struct dect_ipui *ipui);
+extern int dect_auth_ks_cache_get_stats(const struct dect_handle *dh,
+					struct dect_auth_ks_cache_stats *stats);
+
 /** @} */
 
 #ifdef __cplusplus
@@ -0,0 +1,61 @@
+/*
+ * libdect raw frame capture
+ */
+
+#ifndef _LIBDECT_DECT_CAPTURE_H
+#define _LIBDECT_DECT_CAPTURE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup capture
+ * @{
+ */
+
+/**
+ * enum dect_capture_flags - capture flags
+ *
+ * @DECT_CAPTURE_DIRECT:	write the capture files using O_DIRECT
+ * @DECT_CAPTURE_TS_MULTIFRAME:	derive timestamps from the multiframe, frame
+ *				and slot numbers instead of the host clock
+ */
+enum dect_capture_flags {
+	DECT_CAPTURE_DIRECT		= 0x1,
+	DECT_CAPTURE_TS_MULTIFRAME	= 0x2,
+};
+
+/**
+ * Capture configuration
+ *
+ * @flags:		capture flags (#dect_capture_flags)
+ * @buf_size:		output buffer size, 0 for the default of 1MB
+ * @rotate_size:	maximum capture file size, 0 to disable rotation
+ */
+struct dect_capture_cfg {
+	unsigned int		flags;
+	unsigned int		buf_size;
+	uint64_t		rotate_size;
+};
+
+struct dect_capture;
+struct dect_msg_buf;
+
+extern struct dect_capture *dect_capture_open(const struct dect_handle *dh,
+					      const char *path,
+					      const struct dect_capture_cfg *cfg);
+extern int dect_capture_close(struct dect_capture *cap);
+
+extern int dect_capture_write(struct dect_capture *cap,
+			      const struct dect_msg_buf *mb);
+extern int dect_capture_write_batch(struct dect_capture *cap,
+				    struct dect_msg_buf *mbs[], unsigned int n);
+extern int dect_capture_flush(struct dect_capture *cap);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _LIBDECT_DECT_CAPTURE_H */
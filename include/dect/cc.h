@@ -16,6 +16,7 @@ extern "C" {
  * @{
  */
 
+#include <sys/uio.h>
 #include <dect/ie.h>
 
 /** MNCC_SETUP primitive parameters */
@@ -283,6 +284,10 @@ struct dect_cc_ops {
 	void	(*dl_u_data_ind)(struct dect_handle *dh, struct dect_call *call,
 				 struct dect_msg_buf *mb);
 	/**< DL_U_DATA-ind primitive */
+	void	(*dl_u_data_view_ind)(struct dect_handle *dh, struct dect_call *call,
+				      const struct dect_msg_buf *mb);
+	/**< DL_U_DATA-ind primitive lending the buffer for the duration of the call,
+	 *   used instead of dl_u_data_ind if set */
 };
 
 extern int dect_mncc_setup_req(struct dect_handle *dh, struct dect_call *call,
@@ -308,6 +313,8 @@ extern int dect_mncc_facility_req(struct dect_handle *dh, struct dect_call *call
 				  const struct dect_mncc_facility_param *param);
 extern int dect_mncc_info_req(struct dect_handle *dh, struct dect_call *call,
 			      const struct dect_mncc_info_param *param);
+extern void dect_cc_set_info_coalescing(struct dect_handle *dh,
+					unsigned int window);
 extern int dect_mncc_modify_req(struct dect_handle *dh, struct dect_call *call,
 				const struct dect_mncc_modify_param *param);
 extern void dect_mncc_modify_res(struct dect_handle *dh, struct dect_call *call,
@@ -326,6 +333,107 @@ extern int dect_mncc_iwu_info_req(struct dect_handle *dh, struct dect_call *call
 extern int dect_dl_u_data_req(const struct dect_handle *dh, struct dect_call *call,
 			      struct dect_msg_buf *mb);
 
+/**
+ * DL_U_DATA-req batch entry
+ *
+ * @call:	Call Control Endpoint
+ * @mb:		Message Buffer
+ * @err:	result, 0 or an errno value
+ */
+struct dect_dl_u_data_req_param {
+	struct dect_call	*call;
+	struct dect_msg_buf	*mb;
+	int			err;
+};
+
+/**
+ * U-Plane statistics
+ *
+ * @rx_bytes:		bytes received by the LU1 entity
+ * @rx_underflow:	RX queue underflows
+ * @tx_bytes:		bytes transmitted by the LU1 entity
+ * @tx_underflow:	TX queue underflows
+ * @interval:		time since the previous sample in milliseconds
+ * @rx_rate:		receive rate during the interval in bytes per second
+ * @tx_rate:		transmit rate during the interval in bytes per second
+ * @rx_underflow_delta:	RX queue underflows during the interval
+ * @tx_underflow_delta:	TX queue underflows during the interval
+ */
+struct dect_uplane_stats {
+	uint32_t		rx_bytes;
+	uint32_t		rx_underflow;
+	uint32_t		tx_bytes;
+	uint32_t		tx_underflow;
+	uint32_t		interval;
+	uint32_t		rx_rate;
+	uint32_t		tx_rate;
+	uint32_t		rx_underflow_delta;
+	uint32_t		tx_underflow_delta;
+};
+
+extern int dect_call_get_uplane_stats(const struct dect_handle *dh,
+				      struct dect_call *call,
+				      struct dect_uplane_stats *stats);
+extern int dect_call_sample_uplane_stats(const struct dect_handle *dh,
+					 struct dect_call *call,
+					 unsigned int interval,
+					 void (*cb)(struct dect_handle *dh,
+						    struct dect_call *call,
+						    const struct dect_uplane_stats *stats));
+
+extern int dect_dl_u_data_req_batch(const struct dect_handle *dh,
+				    struct dect_dl_u_data_req_param *param,
+				    unsigned int n);
+
+struct dect_uplane_ring;
+extern struct dect_uplane_ring *dect_uplane_ring_alloc(const struct dect_handle *dh,
+						       unsigned int size);
+extern void dect_uplane_ring_free(const struct dect_handle *dh,
+				  struct dect_uplane_ring *ring);
+extern int dect_uplane_ring_push(const struct dect_handle *dh,
+				 struct dect_uplane_ring *ring,
+				 struct dect_msg_buf *mb);
+extern struct dect_msg_buf *dect_uplane_ring_pop(struct dect_uplane_ring *ring);
+extern void dect_uplane_ring_recycle(struct dect_uplane_ring *ring,
+				     struct dect_msg_buf *mb);
+
+/** @} */
+
+/**
+ * @addtogroup iwu_stream
+ * @{
+ */
+
+/** Maximum number of segments in flight */
+#define DECT_IWU_STREAM_WINDOW_MAX	64
+
+/** IWU stream parameters */
+struct dect_iwu_stream_param {
+	uint8_t		pd;			/**< IWU-TO-IWU protocol discriminator of the stream */
+	unsigned int	window;			/**< segments in flight, 0 for the default of 8 */
+	unsigned int	tx_limit;		/**< queued payloads, 0 for the default of 16 */
+	unsigned int	rx_max;			/**< maximum size of a received payload, 0 for 64 KiB */
+	void		(*receive)(struct dect_handle *dh,
+				   struct dect_call *call,
+				   const struct iovec *iov,
+				   unsigned int iovcnt, void *priv);	/**< a payload has been received */
+	void		(*sent)(struct dect_handle *dh,
+				struct dect_call *call,
+				const void *data, size_t len,
+				int err, void *priv);		/**< a payload has been acknowledged or failed */
+	void		(*writable)(struct dect_handle *dh,
+				    struct dect_call *call,
+				    void *priv);			/**< optional: payloads can be queued again */
+	void		*priv;			/**< callback data */
+};
+
+extern int dect_iwu_stream_open(struct dect_handle *dh, struct dect_call *call,
+				const struct dect_iwu_stream_param *param);
+extern void dect_iwu_stream_close(struct dect_handle *dh,
+				  struct dect_call *call);
+extern int dect_iwu_stream_send(struct dect_handle *dh, struct dect_call *call,
+				const void *data, size_t len);
+
 /** @} */
 
 #ifdef __cplusplus
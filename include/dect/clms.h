@@ -51,6 +51,13 @@ extern void dect_mncl_unitdata_req(struct dect_handle *dh,
 				   enum dect_clms_message_types type,
 				   const struct dect_mncl_unitdata_param *param,
 				   const struct dect_msg_buf *mb);
+extern int dect_mncl_unitdata_multicast_req(struct dect_handle *dh,
+					    enum dect_clms_message_types type,
+					    const struct dect_tpui *tpui,
+					    const struct dect_ipui *ipuis,
+					    unsigned int n,
+					    const struct dect_mncl_unitdata_param *param,
+					    const struct dect_msg_buf *mb);
 
 /** @} */
 
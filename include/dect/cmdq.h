@@ -0,0 +1,46 @@
+/*
+ * libdect command queue
+ */
+
+#ifndef _LIBDECT_DECT_CMDQ_H
+#define _LIBDECT_DECT_CMDQ_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup cmdq
+ * @{
+ */
+
+#include <stdint.h>
+
+/** Maximum number of queued commands */
+#define DECT_CMDQ_SIZE_MAX	65536
+
+/**
+ * Command queue statistics
+ */
+struct dect_cmdq_stats {
+	uint64_t	executed;	/**< Executed commands */
+	uint64_t	rejected;	/**< Commands refused because the queue was full */
+	uint64_t	batches;	/**< Event loop iterations executing commands */
+	uint64_t	max_batch;	/**< Maximum number of commands executed in one iteration */
+};
+
+struct dect_handle;
+extern int dect_cmdq_init(struct dect_handle *dh, unsigned int size);
+extern void dect_cmdq_exit(struct dect_handle *dh);
+extern int dect_cmdq_submit(struct dect_handle *dh,
+			    void (*fn)(struct dect_handle *dh, void *arg),
+			    void *arg);
+extern void dect_cmdq_get_stats(const struct dect_handle *dh,
+				struct dect_cmdq_stats *stats);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _LIBDECT_DECT_CMDQ_H */
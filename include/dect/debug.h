@@ -6,6 +6,7 @@ extern "C" {
 #endif
 
 #include <stdarg.h>
+#include <stdio.h>
 #include <dect/utils.h>
 
 /**
@@ -27,9 +28,48 @@ enum dect_debug_subsys {
 	DECT_DEBUG_NL,		/**< Netlink communication */
 };
 
+/** Debug mask bit of a debugging subsystem */
+#define DECT_DEBUG_MASK(subsys)	(1U << (subsys))
+/** Debug mask enabling all subsystems */
+#define DECT_DEBUG_ALL		(~0U)
+
 extern void dect_set_debug_hook(void (*fn)(enum dect_debug_subsys subsys,
 					   const char *fmt, va_list ap)
 				__fmtstring(2, 0));
+struct dect_handle;
+extern void dect_handle_set_debug_hook(struct dect_handle *dh,
+				       void (*fn)(enum dect_debug_subsys subsys,
+						  const char *fmt, va_list ap)
+				       __fmtstring(2, 0));
+extern void dect_set_debug_mask(unsigned int mask);
+extern unsigned int dect_get_debug_mask(void);
+
+/**
+ * Debugging flags
+ */
+enum dect_debug_flags {
+	DECT_DEBUG_DEFER_DUMPS	= 0x1,	/**< Keep message dumps of data links in a
+					     per-link history, dumped on errors */
+};
+
+extern void dect_set_debug_flags(unsigned int flags);
+
+/**
+ * @addtogroup trace_ring
+ * @{
+ */
+
+/** Trace ring decoding flags */
+enum dect_trace_decode_flags {
+	DECT_TRACE_DECODE_TIMESTAMPS	= 0x1,	/**< Prefix records with their timestamp */
+	DECT_TRACE_DECODE_SUBSYS	= 0x2,	/**< Prefix records with their subsystem */
+};
+
+extern int dect_trace_ring_open(const char *path, unsigned int nrecs);
+extern void dect_trace_ring_close(void);
+extern int dect_trace_ring_decode(const char *path, FILE *f, unsigned int flags);
+
+/** @} */
 
 /** @} */
 
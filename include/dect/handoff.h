@@ -0,0 +1,28 @@
+/*
+ * libdect socket handoff
+ */
+
+#ifndef _LIBDECT_DECT_HANDOFF_H
+#define _LIBDECT_DECT_HANDOFF_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup handoff
+ * @{
+ */
+
+struct dect_handle;
+struct dect_ops;
+extern int dect_handoff_send(struct dect_handle *dh, int sock);
+extern struct dect_handle *dect_handoff_open(struct dect_ops *ops,
+					     const char *cluster, int sock);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _LIBDECT_DECT_HANDOFF_H */
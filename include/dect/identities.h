@@ -164,6 +164,19 @@ struct dect_ipui {
 extern bool dect_ipui_cmp(const struct dect_ipui *u1,
 			  const struct dect_ipui *u2);
 
+/** Packed IPUI key of an identity that failed to parse */
+#define DECT_IPUI_KEY_INVALID		(~0ULL)
+
+extern unsigned int dect_parse_ipei_strings(struct dect_ipui *ipuis,
+					    uint64_t *keys,
+					    const char * const *strs,
+					    unsigned int n);
+extern unsigned int dect_format_ipei_strings(char *buf,
+					     const struct dect_ipui *ipuis,
+					     unsigned int n);
+extern void dect_ipui_keys(uint64_t *keys, const struct dect_ipui *ipuis,
+			   unsigned int n);
+
 /**
  * @}
  * @defgroup identity_tpui Temporary Portable User ID (TPUI)
@@ -208,6 +221,8 @@ struct dect_tpui {
 
 extern struct dect_tpui *dect_ipui_to_tpui(struct dect_tpui *tpui,
 					   const struct dect_ipui *ipui);
+extern void dect_ipuis_to_tpuis(struct dect_tpui *tpuis,
+				const struct dect_ipui *ipuis, unsigned int n);
 extern void dect_dump_tpui(const struct dect_tpui *tpui);
 
 /** Collective broadcast identifier */
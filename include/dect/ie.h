@@ -39,7 +39,11 @@ struct dect_handle;
 struct dect_ie_collection {
 	unsigned int			refcnt;	/**< Reference count */
 	unsigned int			size;	/**< Size if bytes of entire collection */
+#ifdef __cplusplus
+	struct dect_ie_common		*ie[0];
+#else
 	struct dect_ie_common		*ie[];	/**< Dynamic amount of IEs/IE lists */
+#endif
 };
 
 extern void *dect_ie_collection_alloc(const struct dect_handle *dh, unsigned int size);
@@ -73,19 +77,32 @@ extern void __dect_ie_collection_put(const struct dect_handle *dh, struct dect_i
 struct dect_ie_common {
 	struct dect_ie_common		*next;	/**< IE list list node */
 	unsigned int			refcnt;	/**< Reference count */
+	uint16_t			flags;	/**< IE flags */
+	uint16_t			size;	/**< Allocated size of a received variable size IE, 0 if complete */
+};
+
+/**
+ * IE flags
+ */
+enum dect_ie_flags {
+	DECT_IE_ARENA			= 0x1, /**< IE is allocated from an IE arena */
+	DECT_IE_INTERNED		= 0x2, /**< IE is an immutable shared instance */
 };
 
 /**
  * Get a pointer to the containing IE from a struct dect_ie_common.
  */
-#define dect_ie_container(res, ie)	container_of(ie, typeof(*res), common)
+#define dect_ie_container(res, ie)	container_of(ie, __typeof__(*res), common)
 
 extern struct dect_ie_common *dect_ie_alloc(const struct dect_handle *dh, size_t size);
 extern void dect_ie_destroy(const struct dect_handle *dh, struct dect_ie_common *ie);
+extern void dect_set_ie_arena_size(struct dect_handle *dh, unsigned int size);
 
 static inline struct dect_ie_common *__dect_ie_init(struct dect_ie_common *ie)
 {
 	ie->refcnt = 1;
+	ie->flags  = 0;
+	ie->size   = 0;
 	ie->next   = NULL;
 	return ie;
 }
@@ -114,6 +131,15 @@ extern void __dect_ie_put(const struct dect_handle *dh, struct dect_ie_common *i
  */
 #define dect_ie_put(dh, ie)		__dect_ie_put(dh, &(ie)->common)
 
+extern struct dect_ie_common *__dect_ie_intern(struct dect_handle *dh,
+					       const struct dect_ie_common *ie,
+					       size_t size);
+
+/**
+ * Get a shared immutable instance of an IE.
+ */
+#define dect_ie_intern(dh, ie)		dect_ie_container(ie, __dect_ie_intern(dh, &(ie)->common, sizeof(*(ie))))
+
 
 /* Repeat indicator */
 
@@ -134,6 +160,7 @@ struct dect_ie_list {
 	struct dect_ie_common		common;
 	enum dect_ie_list_types		type;
 	struct dect_ie_common		*list;
+	struct dect_ie_common		*last;
 };
 
 extern void dect_ie_list_init(struct dect_ie_list *iel);
@@ -267,7 +294,11 @@ enum dect_basic_service {
 /** <<BASIC-SERVICE>> IE */
 struct dect_ie_basic_service {
 	struct dect_ie_common		common;
+#ifdef __cplusplus
+	enum dect_call_classes		call_class;
+#else
 	enum dect_call_classes		class;
+#endif
 	enum dect_basic_service		service;
 };
 
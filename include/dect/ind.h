@@ -0,0 +1,62 @@
+/*
+ * libdect batched indications
+ */
+
+#ifndef _LIBDECT_DECT_IND_H
+#define _LIBDECT_DECT_IND_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup ind_batch
+ * @{
+ */
+
+/** Maximum number of indications delivered in one batch */
+#define DECT_IND_BATCH_MAX	64
+
+/** Batched indication types */
+enum dect_ind_types {
+	DECT_IND_MNCC_SETUP,		/**< MNCC_SETUP-ind */
+	DECT_IND_MM_LOCATE,		/**< MM_LOCATE-ind */
+	DECT_IND_MM_ACCESS_RIGHTS,	/**< MM_ACCESS_RIGHTS-ind */
+	DECT_IND_MM_DETACH,		/**< MM_DETACH-ind */
+};
+
+/**
+ * Batched indication
+ *
+ * The members correspond to the arguments of the indication callback.
+ */
+struct dect_ind {
+	enum dect_ind_types			type;		/**< Indication type */
+	union {
+		struct dect_call		*call;		/**< Call of CC indications */
+		struct dect_mm_endpoint		*mme;		/**< MM endpoint of MM indications */
+	};
+	union {
+		struct dect_ie_collection	*param;		/**< Primitive parameters */
+		struct dect_mncc_setup_param	*setup;		/**< #DECT_IND_MNCC_SETUP parameters */
+		struct dect_mm_locate_param	*locate;	/**< #DECT_IND_MM_LOCATE parameters */
+		struct dect_mm_access_rights_param *access_rights; /**< #DECT_IND_MM_ACCESS_RIGHTS parameters */
+		struct dect_mm_detach_param	*detach;	/**< #DECT_IND_MM_DETACH parameters */
+	};
+};
+
+struct dect_handle;
+extern int dect_ind_batch_enable(struct dect_handle *dh,
+				 void (*fn)(struct dect_handle *dh,
+					    const struct dect_ind *inds,
+					    unsigned int n));
+extern void dect_ind_batch_disable(struct dect_handle *dh);
+extern void dect_ind_batch_begin(struct dect_handle *dh);
+extern void dect_ind_batch_end(struct dect_handle *dh);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _LIBDECT_DECT_IND_H */
@@ -11,6 +11,14 @@ dect_keypad_buffer_init(const struct dect_handle *dh, uint8_t timeout,
 					 struct dect_ie_keypad *keypad),
 			void *priv);
 
+struct dect_digit_map;
+extern struct dect_digit_map *dect_digit_map_compile(const struct dect_handle *dh,
+						     const char *str);
+extern void dect_digit_map_free(const struct dect_handle *dh,
+				struct dect_digit_map *map);
+extern void dect_keypad_buffer_set_digit_map(struct dect_keypad_buffer *kb,
+					     const struct dect_digit_map *map);
+
 extern void dect_keypad_append(struct dect_handle *dh,
 			       struct dect_keypad_buffer *buf,
 			       const struct dect_ie_keypad *keypad,
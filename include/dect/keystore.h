@@ -0,0 +1,55 @@
+/*
+ * libdect subscriber key store
+ */
+
+#ifndef _LIBDECT_DECT_KEYSTORE_H
+#define _LIBDECT_DECT_KEYSTORE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <dect/auth.h>
+#include <dect/identities.h>
+
+/**
+ * @addtogroup keystore
+ * @{
+ */
+
+/** Key store entry flags */
+enum dect_keystore_flags {
+	DECT_KEYSTORE_UAK	= 0x1,	/**< the UAK is valid */
+	DECT_KEYSTORE_AC	= 0x2,	/**< the authentication code is valid */
+	DECT_KEYSTORE_DCK	= 0x4,	/**< the derived cipher key is valid */
+};
+
+/** Key store entry */
+struct dect_keystore_entry {
+	uint8_t		uak[DECT_AUTH_KEY_LEN];		/**< user authentication key */
+	uint8_t		ac[DECT_AUTH_CODE_LEN];		/**< authentication code */
+	uint8_t		dck[DECT_CIPHER_KEY_LEN];	/**< derived cipher key */
+	uint8_t		cipher_key_num;			/**< cipher key number of the DCK */
+	uint8_t		flags;				/**< entry flags (#dect_keystore_flags) */
+};
+
+struct dect_handle;
+extern int dect_keystore_open(struct dect_handle *dh, const char *path,
+			      unsigned int size);
+extern int dect_keystore_update(struct dect_handle *dh,
+				const struct dect_ipui *ipui,
+				const struct dect_keystore_entry *entry);
+extern int dect_keystore_lookup(const struct dect_handle *dh,
+				const struct dect_ipui *ipui,
+				struct dect_keystore_entry *entry);
+extern int dect_keystore_delete(struct dect_handle *dh,
+				const struct dect_ipui *ipui);
+extern int dect_keystore_sync(struct dect_handle *dh);
+extern void dect_keystore_close(struct dect_handle *dh);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _LIBDECT_DECT_KEYSTORE_H */
@@ -55,6 +55,79 @@ struct dect_lce_ops {
 extern int dect_lce_group_ring_req(struct dect_handle *dh,
 				   enum dect_alerting_patterns pattern);
 
+/** LCE paging scheduler configuration */
+struct dect_lce_page_cfg {
+	unsigned int		max_depth;	/**< maximum number of pending pages */
+	unsigned int		rate;		/**< paging capacity in pages per second */
+	unsigned int		burst;		/**< maximum number of pages sent at once */
+};
+
+/** LCE paging scheduler statistics */
+struct dect_lce_page_stats {
+	unsigned int		depth;		/**< current number of pending pages */
+	unsigned int		peak;		/**< maximum number of pending pages */
+	unsigned int		queued;		/**< pages queued */
+	unsigned int		coalesced;	/**< pages merged with a pending page */
+	unsigned int		dropped;	/**< pages dropped */
+	unsigned int		sent;		/**< pages transmitted */
+	unsigned int		batches;	/**< transmission batches */
+};
+
+extern int dect_lce_set_page_cfg(struct dect_handle *dh,
+				 const struct dect_lce_page_cfg *cfg);
+extern void dect_lce_get_page_stats(const struct dect_handle *dh,
+				    struct dect_lce_page_stats *stats);
+
+struct dect_lce_group_page;
+
+extern struct dect_lce_group_page *
+dect_lce_group_page_req(struct dect_handle *dh, const struct dect_ipui *ipuis,
+			unsigned int n, const struct dect_tpui *tpui,
+			const struct dect_mac_conn_params *mcp);
+extern void dect_lce_group_page_cancel(struct dect_handle *dh,
+				       struct dect_lce_group_page *gp);
+
+/** LCE idle data link statistics */
+struct dect_lce_linger_stats {
+	unsigned int		idle;		/**< current number of idle links */
+	unsigned int		reused;		/**< idle links reused by a transaction */
+	unsigned int		expired;	/**< idle links released after the linger time */
+	unsigned int		evicted;	/**< idle links released to stay within budget */
+};
+
+extern void dect_lce_set_link_linger(struct dect_handle *dh,
+				     unsigned int timeout, unsigned int max);
+extern void dect_lce_get_linger_stats(const struct dect_handle *dh,
+				      struct dect_lce_linger_stats *stats);
+
+extern void dect_lce_set_rtx_limit(struct dect_handle *dh, unsigned int max);
+
+/** LCE admission control configuration */
+struct dect_lce_admission_cfg {
+	unsigned int		max_links;	/**< maximum number of new links without a message, 0 for no limit */
+	unsigned int		max_active;	/**< maximum number of concurrent locate and access rights requests, 0 for no limit */
+	unsigned int		max_queued;	/**< maximum number of deferred requests */
+	unsigned int		queue_timeout;	/**< maximum time in milliseconds a request is deferred */
+	enum dect_reject_reasons reject_reason;	/**< reject reason of refused requests, 0 for overload */
+};
+
+/** LCE admission control statistics */
+struct dect_lce_admission_stats {
+	unsigned int		pending_links;	/**< current number of new links without a message */
+	unsigned int		paused;		/**< number of times the S-SAP listener was paused */
+	unsigned int		active;		/**< current number of admitted requests */
+	unsigned int		queued;		/**< current number of deferred requests */
+	unsigned int		admitted;	/**< requests admitted */
+	unsigned int		deferred;	/**< requests deferred */
+	unsigned int		rejected;	/**< requests refused */
+	unsigned int		timeouts;	/**< deferred requests refused after the queue timeout */
+};
+
+extern void dect_lce_set_admission(struct dect_handle *dh,
+				   const struct dect_lce_admission_cfg *cfg);
+extern void dect_lce_get_admission_stats(const struct dect_handle *dh,
+					 struct dect_lce_admission_stats *stats);
+
 extern int dect_dl_establish_req(struct dect_handle *dh, const struct dect_ipui *ipui,
 				 const struct dect_mac_conn_params *mcp);
 
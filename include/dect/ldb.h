@@ -0,0 +1,28 @@
+/*
+ * libdect persistent location database
+ */
+
+#ifndef _LIBDECT_DECT_LDB_H
+#define _LIBDECT_DECT_LDB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup ldb
+ * @{
+ */
+
+struct dect_handle;
+extern int dect_ldb_open(struct dect_handle *dh, const char *path,
+			 unsigned int size);
+extern int dect_ldb_sync(struct dect_handle *dh);
+extern void dect_ldb_close(struct dect_handle *dh);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _LIBDECT_DECT_LDB_H */
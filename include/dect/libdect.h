@@ -24,6 +24,17 @@ extern "C" {
 #include <dect/ss.h>
 #include <dect/clms.h>
 #include <dect/debug.h>
+#include <dect/stats.h>
+#include <dect/mem.h>
+#include <dect/shard.h>
+#include <dect/cmdq.h>
+#include <dect/ind.h>
+#include <dect/handoff.h>
+#include <dect/ldb.h>
+#include <dect/keystore.h>
+#include <dect/pp_table.h>
+#include <dect/record.h>
+#include <dect/mock.h>
 
 struct dect_handle;
 
@@ -31,21 +42,29 @@ struct dect_handle;
  * DECT message buffer
  *
  * @arg next	Data link TX queue node
+ * @arg frag	Next fragment of a chained buffer
+ * @arg data	Data pointer
+ * @arg len	Data length
  * @arg refcnt	Reference count
  * @arg type	Message type
- * @arg len	Data length
- * @arg data	Data pointer
+ * @arg mfn	Multiframe number of reception
+ * @arg frame	Frame number of reception
+ * @arg slot	Slot of reception
  * @arg head	Storage area for on-stack buffers
+ *
+ * The header is kept small and the members used on each access come first,
+ * so the header shares a cache line with the start of the data.
  */
 struct dect_msg_buf {
 	struct dect_msg_buf	*next;
+	struct dect_msg_buf	*frag;
+	uint8_t			*data;
+	uint16_t		len;
+	uint8_t			refcnt;
+	uint8_t			type;
 	uint32_t		mfn;
 	uint8_t			frame;
 	uint8_t			slot;
-	uint8_t			refcnt;
-	uint8_t			type;
-	uint8_t			len;
-	uint8_t			*data;
 	uint8_t			head[128];
 };
 
@@ -56,11 +75,39 @@ struct dect_msg_buf {
 	}
 
 extern struct dect_msg_buf *dect_mbuf_alloc(const struct dect_handle *dh);
+extern struct dect_msg_buf *dect_mbuf_alloc_raw(const struct dect_handle *dh);
 extern void dect_mbuf_free(const struct dect_handle *dh, struct dect_msg_buf *mb);
 extern void *dect_mbuf_pull(struct dect_msg_buf *mb, unsigned int len);
 extern void *dect_mbuf_push(struct dect_msg_buf *mb, unsigned int len);
 extern void dect_mbuf_reserve(struct dect_msg_buf *mb, unsigned int len);
 extern void *dect_mbuf_put(struct dect_msg_buf *mb, unsigned int len);
+extern void dect_mbuf_add_frag(struct dect_msg_buf *mb, struct dect_msg_buf *frag);
+extern void dect_mbuf_free_frags(const struct dect_handle *dh,
+				 struct dect_msg_buf *mb);
+extern unsigned int dect_mbuf_chain_len(const struct dect_msg_buf *mb);
+
+/**
+ * DECT message buffer pool statistics
+ *
+ * @arg hits		Allocations served from the pool
+ * @arg misses		Allocations served by the allocator
+ * @arg free		Free buffers held by the pool
+ * @arg prefill		Number of preallocated buffers
+ * @arg high_water	Maximum number of free buffers kept in the pool
+ */
+struct dect_mbuf_pool_stats {
+	uint64_t		hits;
+	uint64_t		misses;
+	unsigned int		free;
+	unsigned int		prefill;
+	unsigned int		high_water;
+};
+
+extern int dect_mbuf_pool_set_limits(struct dect_handle *dh,
+				     unsigned int prefill,
+				     unsigned int high_water);
+extern void dect_mbuf_pool_get_stats(const struct dect_handle *dh,
+				     struct dect_mbuf_pool_stats *stats);
 
 /**
  * @addtogroup io
@@ -73,9 +120,20 @@ enum dect_fd_events {
 	DECT_FD_WRITE	= 0x2	/**< file descriptor is writable */
 };
 
+/** libdect file descriptor priority classes, in decreasing priority */
+enum dect_fd_priorities {
+	DECT_FD_PRIO_UPLANE,		/**< U-plane (LU1) sockets */
+	DECT_FD_PRIO_SIGNALLING,	/**< data links and internal queues */
+	DECT_FD_PRIO_LISTENER,		/**< S-SAP listener and B-SAP */
+	DECT_FD_PRIO_NETLINK,		/**< netlink socket */
+	__DECT_FD_PRIO_MAX
+};
+#define DECT_FD_PRIO_MAX	(__DECT_FD_PRIO_MAX - 1)
+
 struct dect_fd;
 extern void *dect_fd_priv(struct dect_fd *dfd);
 extern int dect_fd_num(const struct dect_fd *dfd);
+extern enum dect_fd_priorities dect_fd_priority(const struct dect_fd *dfd);
 extern void dect_fd_process(struct dect_handle *dh, struct dect_fd *dfd,
 			    uint32_t events);
 /** @} */
@@ -88,6 +146,8 @@ extern void dect_fd_process(struct dect_handle *dh, struct dect_fd *dfd,
 struct dect_timer;
 extern void *dect_timer_priv(struct dect_timer *timer);
 extern void dect_timer_run(struct dect_handle *dh, struct dect_timer *timer);
+extern int dect_timers_next_expiry(const struct dect_handle *dh);
+extern void dect_timers_run(struct dect_handle *dh);
 
 /** @} */
 
@@ -119,6 +179,23 @@ struct dect_event_ops {
 				      struct dect_timer *timer);
 };
 
+struct dect_ops;
+struct dect_epoll;
+extern struct dect_epoll *dect_epoll_alloc(struct dect_ops *ops);
+extern void dect_epoll_free(struct dect_epoll *ep);
+extern int dect_epoll_fd(const struct dect_epoll *ep);
+extern int dect_epoll_dispatch(struct dect_epoll *ep, struct dect_handle *dh,
+			       int timeout);
+
+#ifdef CONFIG_IO_URING
+struct dect_uring;
+extern struct dect_uring *dect_uring_alloc(struct dect_ops *ops);
+extern void dect_uring_free(struct dect_uring *ur);
+extern int dect_uring_fd(const struct dect_uring *ur);
+extern int dect_uring_dispatch(struct dect_uring *ur, struct dect_handle *dh,
+			       int timeout);
+#endif
+
 /** @} */
 
 /**
@@ -144,8 +221,31 @@ struct dect_ops {
 
 extern struct dect_handle *dect_open_handle(struct dect_ops *ops,
 					    const char *cluster);
+
+/**
+ * Cluster information snapshot
+ *
+ * @index:	cluster index
+ * @mode:	cluster mode
+ * @pari:	FP's PARI
+ * @fpc:	FP capabilities
+ */
+struct dect_cluster_info {
+	int				index;
+	uint32_t			mode;
+	struct dect_ari			pari;
+	struct dect_fp_capabilities	fpc;
+};
+
+extern struct dect_handle *
+dect_open_handle_async(struct dect_ops *ops, const char *cluster,
+		       const struct dect_cluster_info *info,
+		       void (*cb)(struct dect_handle *dh, int err));
+extern void dect_handle_get_cluster_info(const struct dect_handle *dh,
+					 struct dect_cluster_info *info);
 extern void dect_close_handle(struct dect_handle *dh);
 extern void *dect_handle_priv(struct dect_handle *dh);
+extern void dect_set_rcv_budget(struct dect_handle *dh, unsigned int budget);
 
 extern void dect_pp_set_ipui(struct dect_handle *dh,
 			     const struct dect_ipui *ipui);
@@ -0,0 +1,441 @@
+#ifndef _LIBDECT_DECT_LIBDECT_HPP
+#define _LIBDECT_DECT_LIBDECT_HPP
+
+/**
+ * @defgroup cxx C++ bindings
+ *
+ * Header-only resource management for IEs, IE collections and message buffers.
+ *
+ * dect::ie_ptr, dect::ie_collection_ptr and dect::mbuf own one reference of
+ * the wrapped object and release it when destroyed. They can only be moved,
+ * which transfers the reference without touching the reference count. An
+ * additional reference is taken explicitly using their share() member, the
+ * reference of an object received from libdect using their hold() function.
+ *
+ * dect::message wraps the parameters of a request primitive. Like on-stack
+ * parameters in C, the IEs set in a message are referenced but not held, they
+ * must stay valid until the request has been sent.
+ *
+ * Allocation failures are reported by returning an empty object, the bindings
+ * don't throw.
+ *
+ * @{
+ */
+
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+#include <dect/libdect.h>
+
+namespace dect {
+
+/** @cond */
+namespace detail {
+
+template <typename T>
+inline struct dect_ie_common *ie_common(T *ie) noexcept
+{
+	return ie ? &ie->common : nullptr;
+}
+
+inline struct dect_ie_common *ie_common(struct dect_ie_common *ie) noexcept
+{
+	return ie;
+}
+
+template <typename T>
+inline T *ie_container(struct dect_ie_common *ie) noexcept
+{
+	static_assert(std::is_standard_layout<T>::value,
+		      "IE types must be standard layout");
+	if (ie == nullptr)
+		return nullptr;
+	return reinterpret_cast<T *>(reinterpret_cast<char *>(ie) -
+				     offsetof(T, common));
+}
+
+template <>
+inline struct dect_ie_common *
+ie_container<struct dect_ie_common>(struct dect_ie_common *ie) noexcept
+{
+	return ie;
+}
+
+} /* namespace detail */
+/** @endcond */
+
+/**
+ * Owning reference of an IE
+ *
+ * @tparam T	IE type, e.g. struct dect_ie_display
+ */
+template <typename T>
+class ie_ptr {
+public:
+	ie_ptr() noexcept : dh_(nullptr), ie_(nullptr) {}
+	ie_ptr(std::nullptr_t) noexcept : ie_ptr() {}
+
+	ie_ptr(ie_ptr &&other) noexcept : dh_(other.dh_), ie_(other.ie_)
+	{
+		other.ie_ = nullptr;
+	}
+
+	ie_ptr &operator=(ie_ptr &&other) noexcept
+	{
+		if (this != &other) {
+			reset();
+			dh_ = other.dh_;
+			ie_ = other.ie_;
+			other.ie_ = nullptr;
+		}
+		return *this;
+	}
+
+	ie_ptr(const ie_ptr &) = delete;
+	ie_ptr &operator=(const ie_ptr &) = delete;
+
+	~ie_ptr() { reset(); }
+
+	/**
+	 * Take ownership of a reference held by the caller
+	 *
+	 * @param dh	libdect DECT handle the IE was allocated from
+	 * @param ie	IE, may be NULL
+	 */
+	static ie_ptr adopt(const struct dect_handle *dh, T *ie) noexcept
+	{
+		return ie_ptr(dh, ie);
+	}
+
+	/**
+	 * Take a new reference of an IE
+	 *
+	 * @param dh	libdect DECT handle the IE was allocated from
+	 * @param ie	IE, may be NULL
+	 *
+	 * IEs received from libdect may be allocated from an arena and are moved
+	 * to the heap when held, the returned object may thus refer to a
+	 * different address than @a ie.
+	 */
+	static ie_ptr hold(const struct dect_handle *dh, T *ie) noexcept
+	{
+		return ie_ptr(dh, detail::ie_container<T>(
+				__dect_ie_hold(detail::ie_common(ie))));
+	}
+
+	/** Take an additional reference of the IE. */
+	ie_ptr share() const noexcept
+	{
+		return hold(dh_, ie_);
+	}
+
+	/** Release the reference of the IE. */
+	void reset() noexcept
+	{
+		if (ie_ != nullptr)
+			__dect_ie_put(dh_, detail::ie_common(ie_));
+		ie_ = nullptr;
+	}
+
+	/** Give up ownership of the reference without releasing it. */
+	T *release() noexcept
+	{
+		T *ie = ie_;
+
+		ie_ = nullptr;
+		return ie;
+	}
+
+	T *get() const noexcept { return ie_; }
+	T &operator*() const noexcept { return *ie_; }
+	T *operator->() const noexcept { return ie_; }
+	explicit operator bool() const noexcept { return ie_ != nullptr; }
+
+	const struct dect_handle *handle() const noexcept { return dh_; }
+
+private:
+	ie_ptr(const struct dect_handle *dh, T *ie) noexcept : dh_(dh), ie_(ie) {}
+
+	const struct dect_handle	*dh_;
+	T				*ie_;
+};
+
+/**
+ * Allocate an IE
+ *
+ * @tparam T	IE type
+ * @param dh	libdect DECT handle
+ *
+ * @return the zeroed IE or an empty object if the allocation failed.
+ */
+template <typename T>
+inline ie_ptr<T> make_ie(const struct dect_handle *dh) noexcept
+{
+	return ie_ptr<T>::adopt(dh, detail::ie_container<T>(
+				dect_ie_alloc(dh, sizeof(T))));
+}
+
+/**
+ * Clone an IE
+ *
+ * @param dh	libdect DECT handle
+ * @param ie	IE to clone
+ *
+ * @return the clone or an empty object if the allocation failed.
+ */
+template <typename T>
+inline ie_ptr<T> clone_ie(const struct dect_handle *dh, const T &ie) noexcept
+{
+	return ie_ptr<T>::adopt(dh, detail::ie_container<T>(
+				__dect_ie_clone(dh, &ie.common, sizeof(T))));
+}
+
+/**
+ * Owning reference of an IE collection
+ *
+ * @tparam T	primitive parameter type, e.g. struct dect_mncc_setup_param
+ *
+ * Used to keep the parameters of an indication or confirmation beyond the
+ * callback, the IEs of the collection remain valid as long as it is held.
+ */
+template <typename T>
+class ie_collection_ptr {
+public:
+	ie_collection_ptr() noexcept : dh_(nullptr), iec_(nullptr) {}
+	ie_collection_ptr(std::nullptr_t) noexcept : ie_collection_ptr() {}
+
+	ie_collection_ptr(ie_collection_ptr &&other) noexcept
+		: dh_(other.dh_), iec_(other.iec_)
+	{
+		other.iec_ = nullptr;
+	}
+
+	ie_collection_ptr &operator=(ie_collection_ptr &&other) noexcept
+	{
+		if (this != &other) {
+			reset();
+			dh_ = other.dh_;
+			iec_ = other.iec_;
+			other.iec_ = nullptr;
+		}
+		return *this;
+	}
+
+	ie_collection_ptr(const ie_collection_ptr &) = delete;
+	ie_collection_ptr &operator=(const ie_collection_ptr &) = delete;
+
+	~ie_collection_ptr() { reset(); }
+
+	/** Take ownership of a reference held by the caller. */
+	static ie_collection_ptr adopt(const struct dect_handle *dh,
+				       T *iec) noexcept
+	{
+		return ie_collection_ptr(dh, iec);
+	}
+
+	/** Take a new reference of an IE collection received from libdect. */
+	static ie_collection_ptr hold(const struct dect_handle *dh,
+				      T *iec) noexcept
+	{
+		if (iec != nullptr)
+			__dect_ie_collection_hold(&iec->common);
+		return ie_collection_ptr(dh, iec);
+	}
+
+	/** Take an additional reference of the IE collection. */
+	ie_collection_ptr share() const noexcept
+	{
+		return hold(dh_, iec_);
+	}
+
+	/** Release the reference of the IE collection. */
+	void reset() noexcept
+	{
+		if (iec_ != nullptr)
+			__dect_ie_collection_put(dh_, &iec_->common);
+		iec_ = nullptr;
+	}
+
+	/** Give up ownership of the reference without releasing it. */
+	T *release() noexcept
+	{
+		T *iec = iec_;
+
+		iec_ = nullptr;
+		return iec;
+	}
+
+	T *get() const noexcept { return iec_; }
+	T &operator*() const noexcept { return *iec_; }
+	T *operator->() const noexcept { return iec_; }
+	explicit operator bool() const noexcept { return iec_ != nullptr; }
+
+	const struct dect_handle *handle() const noexcept { return dh_; }
+
+private:
+	ie_collection_ptr(const struct dect_handle *dh, T *iec) noexcept
+		: dh_(dh), iec_(iec) {}
+
+	const struct dect_handle	*dh_;
+	T				*iec_;
+};
+
+/**
+ * Owning reference of a message buffer
+ *
+ * Buffers passed to functions taking ownership, like dect_uplane_ring_push(),
+ * are handed over using release().
+ */
+class mbuf {
+public:
+	mbuf() noexcept : dh_(nullptr), mb_(nullptr) {}
+	mbuf(std::nullptr_t) noexcept : mbuf() {}
+
+	mbuf(mbuf &&other) noexcept : dh_(other.dh_), mb_(other.mb_)
+	{
+		other.mb_ = nullptr;
+	}
+
+	mbuf &operator=(mbuf &&other) noexcept
+	{
+		if (this != &other) {
+			reset();
+			dh_ = other.dh_;
+			mb_ = other.mb_;
+			other.mb_ = nullptr;
+		}
+		return *this;
+	}
+
+	mbuf(const mbuf &) = delete;
+	mbuf &operator=(const mbuf &) = delete;
+
+	~mbuf() { reset(); }
+
+	/**
+	 * Allocate a message buffer
+	 *
+	 * @param dh	libdect DECT handle
+	 *
+	 * @return the buffer or an empty object if the allocation failed.
+	 */
+	static mbuf alloc(const struct dect_handle *dh) noexcept
+	{
+		return mbuf(dh, dect_mbuf_alloc(dh));
+	}
+
+	/** Take ownership of a buffer held by the caller. */
+	static mbuf adopt(const struct dect_handle *dh,
+			  struct dect_msg_buf *mb) noexcept
+	{
+		return mbuf(dh, mb);
+	}
+
+	/** Free the buffer. */
+	void reset() noexcept
+	{
+		if (mb_ != nullptr)
+			dect_mbuf_free(dh_, mb_);
+		mb_ = nullptr;
+	}
+
+	/** Give up ownership of the buffer without freeing it. */
+	struct dect_msg_buf *release() noexcept
+	{
+		struct dect_msg_buf *mb = mb_;
+
+		mb_ = nullptr;
+		return mb;
+	}
+
+	uint8_t *data() const noexcept { return mb_->data; }
+	unsigned int size() const noexcept { return mb_->len; }
+
+	void *put(unsigned int len) noexcept { return dect_mbuf_put(mb_, len); }
+	void *push(unsigned int len) noexcept { return dect_mbuf_push(mb_, len); }
+	void *pull(unsigned int len) noexcept { return dect_mbuf_pull(mb_, len); }
+	void reserve(unsigned int len) noexcept { dect_mbuf_reserve(mb_, len); }
+
+	struct dect_msg_buf *get() const noexcept { return mb_; }
+	struct dect_msg_buf &operator*() const noexcept { return *mb_; }
+	struct dect_msg_buf *operator->() const noexcept { return mb_; }
+	explicit operator bool() const noexcept { return mb_ != nullptr; }
+
+private:
+	mbuf(const struct dect_handle *dh, struct dect_msg_buf *mb) noexcept
+		: dh_(dh), mb_(mb) {}
+
+	const struct dect_handle	*dh_;
+	struct dect_msg_buf		*mb_;
+};
+
+/**
+ * Parameters of a request primitive
+ *
+ * @tparam P	primitive parameter type, e.g. struct dect_mncc_setup_param
+ *
+ * The parameters are zero initialized, IEs are set using set() and add()
+ * with a pointer to the member of @a P:
+ *
+ * @code
+ * dect::message<struct dect_mncc_setup_param> msg;
+ *
+ * msg.set(&dect_mncc_setup_param::basic_service, &basic_service)
+ *    .add(&dect_mncc_setup_param::iwu_attributes, iwu_attr);
+ * dect_mncc_setup_req(dh, call, msg.get());
+ * @endcode
+ *
+ * No references are taken, the IEs must remain valid and unmodified until the
+ * request has been sent.
+ */
+template <typename P>
+class message {
+public:
+	message() noexcept : param_() {}
+
+	message(const message &) = delete;
+	message &operator=(const message &) = delete;
+
+	/** Set an IE. */
+	template <typename T>
+	message &set(T *P::*member, T *ie) noexcept
+	{
+		param_.*member = ie;
+		return *this;
+	}
+
+	template <typename T>
+	message &set(T *P::*member, const ie_ptr<T> &ie) noexcept
+	{
+		param_.*member = ie.get();
+		return *this;
+	}
+
+	/** Append an IE to a repeated IE list. */
+	template <typename T>
+	message &add(struct dect_ie_list P::*member, T *ie) noexcept
+	{
+		__dect_ie_list_add(detail::ie_common(ie), &(param_.*member));
+		return *this;
+	}
+
+	template <typename T>
+	message &add(struct dect_ie_list P::*member, const ie_ptr<T> &ie) noexcept
+	{
+		return add(member, ie.get());
+	}
+
+	P *get() noexcept { return &param_; }
+	P *operator->() noexcept { return &param_; }
+	operator P *() noexcept { return &param_; }
+
+private:
+	P	param_;
+};
+
+} /* namespace dect */
+
+/** @} */
+
+#endif /* _LIBDECT_DECT_LIBDECT_HPP */
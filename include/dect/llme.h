@@ -45,6 +45,42 @@ extern int dect_llme_rfp_preload_req(struct dect_handle *dh,
 extern int dect_llme_mac_me_info_res(struct dect_handle *dh, const struct dect_ari *pari);
 extern int dect_llme_scan_req(struct dect_handle *dh);
 
+extern int dect_llme_batch_begin(struct dect_handle *dh);
+extern int dect_llme_batch_commit(struct dect_handle *dh);
+
+/**
+ * Scan result
+ *
+ * @pari:	PARI of the FP
+ * @fpc:	FP capabilities of the last indication
+ * @count:	number of indications received from the FP
+ * @first_seen:	time of the first indication in milliseconds
+ * @last_seen:	time of the last indication in milliseconds
+ */
+struct dect_scan_result {
+	struct dect_ari			pari;
+	struct dect_fp_capabilities	fpc;
+	uint32_t			count;
+	uint64_t			first_seen;
+	uint64_t			last_seen;
+};
+
+struct dect_scan_session;
+
+extern struct dect_scan_session *
+dect_scan_session_start(struct dect_handle *dh, unsigned int size,
+			void (*notify)(struct dect_handle *dh,
+				       struct dect_scan_session *ss,
+				       void *priv),
+			void *priv);
+extern void dect_scan_session_stop(struct dect_handle *dh,
+				   struct dect_scan_session *ss);
+extern unsigned int dect_scan_session_read(struct dect_scan_session *ss,
+					   struct dect_scan_result *results,
+					   unsigned int n);
+extern unsigned int dect_scan_session_fp_count(const struct dect_scan_session *ss,
+					       uint32_t *dropped);
+
 /** @} */
 
 #ifdef __cplusplus
@@ -0,0 +1,75 @@
+/*
+ * libdect memory accounting
+ */
+
+#ifndef _LIBDECT_DECT_MEM_H
+#define _LIBDECT_DECT_MEM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup mem
+ * @{
+ */
+
+#include <stdint.h>
+
+/** Object types of accounted memory */
+enum dect_mem_types {
+	DECT_MEM_OTHER,			/**< Objects not covered by other types */
+	DECT_MEM_CALL,			/**< Calls */
+	DECT_MEM_LINK,			/**< Data links */
+	DECT_MEM_LTE,			/**< Location table entries */
+	DECT_MEM_MM_ENDPOINT,		/**< MM endpoints */
+	DECT_MEM_SS_ENDPOINT,		/**< SS endpoints */
+	DECT_MEM_IE,			/**< Information elements and collections */
+	DECT_MEM_MBUF,			/**< Message buffers */
+	DECT_MEM_TIMER,			/**< Timers */
+	DECT_MEM_RTX,			/**< Messages stored for retransmission */
+	__DECT_MEM_MAX
+};
+#define DECT_MEM_MAX			(__DECT_MEM_MAX - 1)
+
+/**
+ * Memory statistics of one object type
+ */
+struct dect_mem_type_stats {
+	uint64_t	allocs;			/**< Successful allocations */
+	uint64_t	failures;		/**< Failed allocations, including limit violations */
+	uint64_t	objects;		/**< Live objects */
+	uint64_t	bytes;			/**< Live bytes */
+	uint64_t	peak_bytes;		/**< Maximum of live bytes */
+	uint64_t	cached;			/**< Objects kept for reuse, included in @objects */
+	uint64_t	cache_hits;		/**< Allocations served from the object cache */
+};
+
+/**
+ * libdect memory statistics
+ *
+ * Byte counts cover the requested object sizes and exclude the allocator
+ * overhead and the handle itself. Objects kept in the object caches count
+ * as live objects.
+ */
+struct dect_mem_stats {
+	struct dect_mem_type_stats	type[DECT_MEM_MAX + 1];	/**< Statistics per object type */
+	struct dect_mem_type_stats	total;			/**< Statistics of all types */
+};
+
+struct dect_handle;
+extern void dect_mem_snapshot(const struct dect_handle *dh,
+			      struct dect_mem_stats *stats);
+extern int dect_mem_set_limit(struct dect_handle *dh,
+			      enum dect_mem_types type, uint64_t bytes);
+extern void dect_mem_set_total_limit(struct dect_handle *dh, uint64_t bytes);
+extern int dect_mem_set_cache_limit(struct dect_handle *dh,
+				    enum dect_mem_types type, unsigned int max);
+extern const char *dect_mem_type_name(enum dect_mem_types type);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _LIBDECT_DECT_MEM_H */
@@ -384,6 +384,80 @@ extern void dect_mm_info_res(struct dect_handle *dh, struct dect_mm_endpoint *mm
 extern int dect_mm_iwu_req(struct dect_handle *dh, struct dect_mm_endpoint *mme,
 			   const struct dect_mm_iwu_param *param);
 
+/**
+ * @addtogroup mm_provision
+ * @{
+ */
+
+/** Bulk provisioning entry states */
+enum dect_mm_provision_states {
+	DECT_MM_PROVISION_PENDING,		/**< waiting for an access rights request */
+	DECT_MM_PROVISION_ACCESS_RIGHTS,	/**< access rights granted, waiting for key allocation */
+	DECT_MM_PROVISION_KEY_ALLOCATION,	/**< key allocation in progress */
+	DECT_MM_PROVISION_AUTHENTICATION,	/**< authentication using the UAK in progress */
+	DECT_MM_PROVISION_DONE,			/**< provisioning completed successfully */
+	DECT_MM_PROVISION_FAILED,		/**< provisioning failed */
+};
+
+/** Bulk provisioning entry flags */
+enum dect_mm_provision_flags {
+	DECT_MM_PROVISION_UAK		= 0x1,	/**< the UAK is valid, key allocation is skipped */
+};
+
+/** Bulk provisioning entry */
+struct dect_mm_provision_entry {
+	struct dect_ipui		ipui;				/**< IPUI of the PP */
+	uint8_t				ac[DECT_AUTH_CODE_LEN];		/**< authentication code used for key allocation */
+	uint8_t				uak[DECT_AUTH_KEY_LEN];		/**< user authentication key */
+	uint8_t				dck[DECT_CIPHER_KEY_LEN];	/**< cipher key derived by the final authentication */
+	unsigned int			flags;				/**< entry flags (#dect_mm_provision_flags) */
+	enum dect_mm_provision_states	state;				/**< provisioning state */
+	void				*priv;				/**< application private data */
+};
+
+struct dect_mm_provision;
+
+/** Bulk provisioning configuration */
+struct dect_mm_provision_cfg {
+	unsigned int	max_active;		/**< maximum number of concurrent key allocations and authentications, 0 for no limit */
+	uint8_t		uak_num;		/**< UAK number of allocated keys */
+	bool		authenticate;		/**< authenticate the PP using the UAK after key allocation */
+	void		(*progress)(struct dect_handle *dh,
+				    struct dect_mm_provision *mp,
+				    struct dect_mm_provision_entry *entry);	/**< invoked on every state change of an entry */
+	void		*priv;			/**< application private data */
+};
+
+extern struct dect_mm_provision *
+dect_mm_provision_start(struct dect_handle *dh,
+			struct dect_mm_provision_entry *entries, unsigned int n,
+			const struct dect_mm_provision_cfg *cfg);
+extern void dect_mm_provision_stop(struct dect_handle *dh,
+				   struct dect_mm_provision *mp);
+extern void *dect_mm_provision_priv(const struct dect_mm_provision *mp);
+
+/**
+ * @}
+ * @addtogroup mm_secure
+ * @{
+ */
+
+/** Secure link procedure parameters */
+struct dect_mm_secure_param {
+	const uint8_t	*uak;			/**< user authentication key of the PP, NULL to use the key store */
+	uint8_t		uak_num;		/**< UAK number */
+	uint64_t	rs;			/**< RS used for authentication */
+	uint8_t		cipher_key_num;		/**< number the PP stores the derived cipher key under */
+	unsigned int	dck_lifetime;		/**< seconds a derived cipher key is reused without authentication, 0 to always authenticate */
+	void		(*complete)(struct dect_handle *dh,
+				    struct dect_mm_endpoint *mme,
+				    bool success, void *priv);	/**< invoked once ciphering is enabled or has failed */
+	void		*priv;			/**< completion callback data */
+};
+
+extern int dect_mm_secure_req(struct dect_handle *dh, struct dect_mm_endpoint *mme,
+			      const struct dect_mm_secure_param *param);
+
 /** @} */
 
 #ifdef __cplusplus
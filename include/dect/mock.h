@@ -0,0 +1,49 @@
+/*
+ * libdect in-process mock transport
+ */
+
+#ifndef _LIBDECT_DECT_MOCK_H
+#define _LIBDECT_DECT_MOCK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup mock
+ * @{
+ */
+
+#include <stdint.h>
+
+struct dect_mock_cluster;
+
+/**
+ * Mock cluster statistics
+ */
+struct dect_mock_stats {
+	uint64_t	links;		/**< S-SAP data links established */
+	uint64_t	link_failures;	/**< S-SAP connection attempts refused */
+	uint64_t	lu_links;	/**< LU1 connections established */
+	uint64_t	broadcasts;	/**< B-SAP messages sent by FPs */
+	uint64_t	deliveries;	/**< B-SAP messages delivered to PPs */
+	uint64_t	drops;		/**< B-SAP messages dropped at full PPs */
+};
+
+struct dect_handle;
+struct dect_ops;
+extern struct dect_mock_cluster *dect_mock_cluster_alloc(const struct dect_ari *pari);
+extern void dect_mock_cluster_free(struct dect_mock_cluster *mc);
+extern void dect_mock_cluster_get_stats(const struct dect_mock_cluster *mc,
+					struct dect_mock_stats *stats);
+
+extern struct dect_handle *dect_mock_open_handle(struct dect_ops *ops,
+						 struct dect_mock_cluster *mc,
+						 uint32_t mode);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _LIBDECT_DECT_MOCK_H */
@@ -0,0 +1,70 @@
+/*
+ * libdect U-plane playout
+ */
+
+#ifndef _LIBDECT_DECT_PLAYOUT_H
+#define _LIBDECT_DECT_PLAYOUT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup playout
+ * @{
+ */
+
+/* Number of linear PCM samples of a playout block (10ms at 8kHz) */
+#define DECT_PLAYOUT_BLOCK_SAMPLES	80
+
+/**
+ * Playout statistics
+ *
+ * @blocks:	number of delivered blocks
+ * @underruns:	number of jitter buffer underruns
+ * @concealed:	number of blocks containing concealed samples
+ * @dropped:	number of blocks dropped to reduce the delay
+ * @jitter:	arrival jitter estimate in milliseconds
+ * @delay:	target delay in milliseconds
+ * @depth:	current jitter buffer depth in milliseconds
+ */
+struct dect_playout_stats {
+	uint32_t	blocks;
+	uint32_t	underruns;
+	uint32_t	concealed;
+	uint32_t	dropped;
+	uint32_t	jitter;
+	uint32_t	delay;
+	uint32_t	depth;
+};
+
+struct dect_playout;
+struct dect_msg_buf;
+
+extern struct dect_playout *dect_playout_alloc(const struct dect_handle *dh,
+					       unsigned int min_delay,
+					       unsigned int max_delay);
+extern void dect_playout_free(const struct dect_handle *dh,
+			      struct dect_playout *po);
+
+extern void dect_playout_put(struct dect_playout *po,
+			     const struct dect_msg_buf *mb);
+extern void dect_playout_get(struct dect_playout *po, int16_t *pcm);
+
+extern int dect_playout_start(const struct dect_handle *dh,
+			      struct dect_playout *po,
+			      void (*cb)(struct dect_handle *dh, void *priv,
+					 const int16_t *pcm),
+			      void *priv);
+extern void dect_playout_stop(const struct dect_handle *dh,
+			      struct dect_playout *po);
+
+extern void dect_playout_get_stats(const struct dect_playout *po,
+				   struct dect_playout_stats *stats);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _LIBDECT_DECT_PLAYOUT_H */
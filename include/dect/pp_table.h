@@ -0,0 +1,38 @@
+/*
+ * libdect PP identity table
+ */
+
+#ifndef _LIBDECT_DECT_PP_TABLE_H
+#define _LIBDECT_DECT_PP_TABLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup pp_table
+ * @{
+ */
+
+struct dect_handle;
+struct dect_ipui;
+struct dect_tpui;
+struct dect_pp_identity;
+
+extern struct dect_pp_identity *dect_pp_identity_add(struct dect_handle *dh,
+						     const struct dect_ipui *ipui);
+extern int dect_pp_identity_set_tpui(struct dect_handle *dh,
+				     struct dect_pp_identity *id,
+				     const struct dect_tpui *tpui);
+extern void dect_pp_identity_remove(struct dect_handle *dh,
+				    struct dect_pp_identity *id);
+extern struct dect_pp_identity *
+dect_pp_identity_lookup(const struct dect_handle *dh,
+			const struct dect_ipui *ipui);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _LIBDECT_DECT_PP_TABLE_H */
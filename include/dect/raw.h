@@ -13,6 +13,8 @@ extern "C" {
 struct dect_raw_ops {
 	void	(*raw_rcv)(struct dect_handle *dh, struct dect_fd *dfd,
 			   struct dect_msg_buf *mb);
+	void	(*raw_rcv_batch)(struct dect_handle *dh, struct dect_fd *dfd,
+				 struct dect_msg_buf *mbs[], unsigned int n);
 };
 
 extern struct dect_fd *dect_raw_open(struct dect_handle *dh);
@@ -21,6 +23,12 @@ extern void dect_raw_close(struct dect_handle *dh, struct dect_fd *dfd);
 extern ssize_t dect_raw_transmit(struct dect_handle *dh, struct dect_fd *dfd,
 				 uint8_t slot, struct dect_msg_buf *mb);
 
+/* Maximum number of frames submitted by a single sendmmsg() call */
+#define DECT_RAW_TX_BATCH	32
+
+extern int dect_raw_transmit_batch(struct dect_handle *dh, struct dect_fd *dfd,
+				   struct dect_msg_buf *mbs[], unsigned int n);
+
 /** @} */
 
 #ifdef __cplusplus
@@ -0,0 +1,80 @@
+/*
+ * libdect S-SAP traffic recorder
+ */
+
+#ifndef _LIBDECT_DECT_RECORD_H
+#define _LIBDECT_DECT_RECORD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup record
+ * @{
+ */
+
+#include <stdint.h>
+
+/** Recording file magic, "DSSR" */
+#define DECT_RECORD_MAGIC	0x52535344
+/** Recording file format version */
+#define DECT_RECORD_VERSION	1
+
+/**
+ * Recording file header
+ */
+struct dect_record_file_hdr {
+	uint32_t	magic;		/**< #DECT_RECORD_MAGIC */
+	uint16_t	version;	/**< #DECT_RECORD_VERSION */
+	uint8_t		mode;		/**< Cluster mode (#dect_cluster_modes) */
+	uint8_t		__pad;
+	uint64_t	start;		/**< Start of the recording, UNIX time in microseconds */
+};
+
+/** Record types */
+enum dect_record_types {
+	DECT_RECORD_RX		= 0,	/**< Received S-Format message */
+	DECT_RECORD_TX		= 1,	/**< Transmitted S-Format message */
+	DECT_RECORD_RELEASE	= 2,	/**< Data link released */
+};
+
+/**
+ * Record header, followed by @len bytes of message data and padding to a
+ * multiple of eight bytes.
+ */
+struct dect_record_hdr {
+	uint64_t	ts;		/**< Monotonic timestamp in microseconds */
+	uint64_t	link;		/**< Data link identifier, unique until released */
+	uint8_t		type;		/**< Record type (#dect_record_types) */
+	uint8_t		pd;		/**< Protocol discriminator */
+	uint8_t		tv;		/**< Transaction value */
+	uint8_t		f;		/**< Transaction identifier flag */
+	uint16_t	len;		/**< Message length including the S-Format header */
+	uint16_t	__pad;
+};
+
+/**
+ * Replay statistics
+ */
+struct dect_replay_stats {
+	uint64_t	rx_msgs;	/**< Replayed received messages */
+	uint64_t	tx_msgs;	/**< Recorded transmitted messages, skipped */
+	uint64_t	tx_replies;	/**< Messages transmitted during the replay */
+	uint64_t	links;		/**< Data links created */
+	uint64_t	errors;		/**< Invalid or oversized records */
+	uint64_t	duration;	/**< Duration of the replay in microseconds */
+};
+
+struct dect_handle;
+extern int dect_record_start(struct dect_handle *dh, const char *path);
+extern int dect_record_stop(struct dect_handle *dh);
+extern int dect_replay(struct dect_handle *dh, const char *path,
+		       struct dect_replay_stats *stats);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _LIBDECT_DECT_RECORD_H */
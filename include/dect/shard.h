@@ -0,0 +1,50 @@
+/*
+ * libdect sharding
+ */
+
+#ifndef _LIBDECT_DECT_SHARD_H
+#define _LIBDECT_DECT_SHARD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup shard
+ * @{
+ */
+
+#include <stdint.h>
+
+/** Maximum number of shards of a handle */
+#define DECT_SHARD_MAX		64
+
+/**
+ * Sharding statistics
+ */
+struct dect_shard_stats {
+	uint64_t	links;		/**< Data links handed to shards */
+	uint64_t	links_by_pmid;	/**< Data links assigned by PMID, without portable identity */
+	uint64_t	link_timeouts;	/**< Data links released without a first message */
+	uint64_t	link_drops;	/**< Data links released because a shard queue was full */
+	uint64_t	pages;		/**< Pages passed from shards */
+	uint64_t	broadcasts;	/**< Broadcasts passed from shards */
+	uint64_t	drops;		/**< Pages and broadcasts refused because the queue was full */
+};
+
+struct dect_handle;
+struct dect_ops;
+struct dect_ipui;
+extern struct dect_handle *dect_shard_open(struct dect_handle *dh,
+					   struct dect_ops *ops);
+extern struct dect_handle *dect_shard_lookup(struct dect_handle *dh,
+					     const struct dect_ipui *ipui);
+extern void dect_shard_get_stats(struct dect_handle *dh,
+				 struct dect_shard_stats *stats);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _LIBDECT_DECT_SHARD_H */
@@ -0,0 +1,174 @@
+/*
+ * libdect runtime statistics
+ */
+
+#ifndef _LIBDECT_DECT_STATS_H
+#define _LIBDECT_DECT_STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup stats
+ * @{
+ */
+
+#include <stdint.h>
+
+/** Alignment of the statistics groups, each group occupies whole cache lines */
+#define DECT_STATS_ALIGN	64
+
+/**
+ * Link Control Entity statistics
+ */
+struct dect_stats_lce {
+	uint64_t	rx_msgs;		/**< Received S-Format messages */
+	uint64_t	tx_msgs;		/**< Transmitted S-Format messages */
+	uint64_t	tx_errors;		/**< Failed transmissions */
+	uint64_t	rx_truncated;		/**< Messages shorter than the S-Format header */
+	uint64_t	rx_unknown_pd;		/**< Messages with unknown protocol discriminator */
+	uint64_t	rx_invalid_tv;		/**< Messages with invalid transaction value */
+	uint64_t	parse_ie_missing;	/**< Parse errors: mandatory IE missing */
+	uint64_t	parse_ie_error;		/**< Parse errors: mandatory IE invalid */
+	uint64_t	page_retransmissions;	/**< Page retransmissions (LCE.03 expiry) */
+	uint64_t	rtx_evictions;		/**< Messages dropped from the retransmission store */
+	uint64_t	links_established;	/**< Established outgoing data links */
+	uint64_t	establish_failures;	/**< Failed outgoing data link establishments */
+} __attribute__((aligned(DECT_STATS_ALIGN)));
+
+/**
+ * NWK layer protocol statistics (CC, MM, SS, CLMS)
+ */
+struct dect_stats_proto {
+	uint64_t	rx_msgs;		/**< Received messages */
+	uint64_t	tx_msgs;		/**< Transmitted messages */
+	uint64_t	transactions;		/**< Transactions opened by the peer */
+} __attribute__((aligned(DECT_STATS_ALIGN)));
+
+/**
+ * Netlink statistics
+ */
+struct dect_stats_nl {
+	uint64_t	rx_msgs;		/**< Received netlink messages */
+	uint64_t	rx_errors;		/**< Receive errors */
+	uint64_t	parse_errors;		/**< Unparsable netlink messages */
+	uint64_t	tx_errors;		/**< Failed batched LLME transmissions */
+} __attribute__((aligned(DECT_STATS_ALIGN)));
+
+/**
+ * Raw socket statistics
+ */
+struct dect_stats_raw {
+	uint64_t	rx_frames;		/**< Received frames */
+	uint64_t	rx_errors;		/**< Receive errors and frames without position */
+	uint64_t	tx_frames;		/**< Transmitted frames */
+	uint64_t	tx_errors;		/**< Failed transmissions */
+} __attribute__((aligned(DECT_STATS_ALIGN)));
+
+/** Number of linear sub-buckets per power of two, as a power of two */
+#define DECT_STATS_HIST_SUB_BITS	2
+/** Number of latency histogram buckets, covering about two hours */
+#define DECT_STATS_HIST_BUCKETS		128
+
+/**
+ * Latency histogram
+ *
+ * Latencies are recorded in microseconds into log-linear buckets: each power
+ * of two is divided into 2^#DECT_STATS_HIST_SUB_BITS linear buckets, values
+ * exceeding the range are counted in the last bucket.
+ */
+struct dect_stats_hist {
+	uint64_t	count;			/**< Number of samples */
+	uint64_t	sum;			/**< Sum of all samples */
+	uint64_t	max;			/**< Maximum sample */
+	uint64_t	buckets[DECT_STATS_HIST_BUCKETS]; /**< Samples per bucket */
+};
+
+/** Procedure latencies */
+enum dect_stats_latencies {
+	DECT_STATS_LATENCY_CC_SETUP,		/**< MNCC_SETUP-req to {CC-CONNECT} */
+	DECT_STATS_LATENCY_CC_RELEASE,		/**< MNCC_RELEASE-req to {CC-RELEASE-COM} */
+	DECT_STATS_LATENCY_LCE_ESTABLISH,	/**< Direct data link establishment */
+	DECT_STATS_LATENCY_LCE_PAGE,		/**< Page to page response */
+	DECT_STATS_LATENCY_MM_ACCESS_RIGHTS,	/**< Access rights procedure */
+	DECT_STATS_LATENCY_MM_ACCESS_RIGHTS_TERMINATE, /**< Access rights termination procedure */
+	DECT_STATS_LATENCY_MM_AUTHENTICATE,	/**< Authentication procedure */
+	DECT_STATS_LATENCY_MM_KEY_ALLOCATION,	/**< Key allocation procedure */
+	DECT_STATS_LATENCY_MM_LOCATION_REGISTRATION, /**< Location registration procedure */
+	DECT_STATS_LATENCY_MM_TEMPORARY_IDENTITY_ASSIGNMENT, /**< Temporary identity assignment procedure */
+	DECT_STATS_LATENCY_MM_IDENTIFICATION,	/**< Identification procedure */
+	DECT_STATS_LATENCY_MM_CIPHER,		/**< Cipher switching procedure */
+	DECT_STATS_LATENCY_MM_PARAMETER_RETRIEVAL, /**< Parameter retrieval procedure */
+	DECT_STATS_LATENCY_MM_DETACH,		/**< Detach procedure */
+	__DECT_STATS_LATENCY_MAX
+};
+#define DECT_STATS_LATENCY_MAX		(__DECT_STATS_LATENCY_MAX - 1)
+
+/**
+ * libdect runtime statistics
+ *
+ * The counters are maintained per handle and are always enabled. MM
+ * procedure latencies are recorded for locally initiated procedures and
+ * include procedures completed by timeout.
+ */
+struct dect_stats {
+	struct dect_stats_lce	lce;		/**< LCE statistics */
+	struct dect_stats_proto	cc;		/**< Call Control statistics */
+	struct dect_stats_proto	mm;		/**< Mobility Management statistics */
+	struct dect_stats_proto	ss;		/**< Supplementary Services statistics */
+	struct dect_stats_proto	clms;		/**< ConnectionLess Message Service statistics */
+	struct dect_stats_nl	nl;		/**< Netlink statistics */
+	struct dect_stats_raw	raw;		/**< Raw socket statistics */
+	struct dect_stats_hist	latency[DECT_STATS_LATENCY_MAX + 1];
+	/**< Procedure latency histograms, indexed by #dect_stats_latencies */
+};
+
+/** Number of protocol discriminators in the message cost table */
+#define DECT_STATS_MSG_COST_PDS		8
+/** Number of message types in the message cost table */
+#define DECT_STATS_MSG_COST_TYPES	128
+
+/**
+ * Processing cost of a message type
+ *
+ * Times are in nanoseconds. The receive handler time excludes parsing and
+ * building messages in response.
+ */
+struct dect_stats_msg_cost {
+	uint64_t	rx_samples;		/**< Sampled received messages */
+	uint64_t	parse_ns;		/**< Time spent parsing */
+	uint64_t	rcv_ns;			/**< Time spent in the protocol receive handler */
+	uint64_t	tx_samples;		/**< Sampled transmitted messages */
+	uint64_t	build_ns;		/**< Time spent building */
+};
+
+/**
+ * Message processing cost table
+ *
+ * Indexed by the protocol discriminator and the message type.
+ */
+struct dect_stats_msg_costs {
+	struct dect_stats_msg_cost	msg[DECT_STATS_MSG_COST_PDS][DECT_STATS_MSG_COST_TYPES];
+};
+
+struct dect_handle;
+extern void dect_stats_snapshot(const struct dect_handle *dh,
+				struct dect_stats *stats);
+extern void dect_stats_reset(struct dect_handle *dh);
+
+extern int dect_stats_msg_cost_enable(struct dect_handle *dh,
+				      unsigned int interval);
+extern void dect_stats_msg_cost_snapshot(const struct dect_handle *dh,
+					 struct dect_stats_msg_costs *costs);
+
+extern uint64_t dect_stats_hist_bucket_max(unsigned int bucket);
+extern uint64_t dect_stats_hist_quantile(const struct dect_stats_hist *hist,
+					 unsigned int permille);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _LIBDECT_DECT_STATS_H */
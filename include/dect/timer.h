@@ -7,6 +7,19 @@
 #ifndef _LIBDECT_DECT_TIMER_H
 #define _LIBDECT_DECT_TIMER_H
 
+/**
+ * enum dect_timer_slack_classes - timer slack classes
+ *
+ * @DECT_TIMER_SLACK_EXACT:	expire at the requested time
+ * @DECT_TIMER_SLACK_COARSE:	may be delayed by the slack window of the handle
+ */
+enum dect_timer_slack_classes {
+	DECT_TIMER_SLACK_EXACT,
+	DECT_TIMER_SLACK_COARSE,
+};
+
+extern void dect_timer_set_slack(struct dect_handle *dh, unsigned int slack);
+
 extern struct dect_timer *dect_timer_alloc(const struct dect_handle *dh);
 extern void dect_timer_free(const struct dect_handle *dh, struct dect_timer *timer);
 extern void dect_timer_setup(struct dect_timer *timer,
@@ -14,8 +27,12 @@ extern void dect_timer_setup(struct dect_timer *timer,
 			     void *data);
 extern void dect_timer_start(const struct dect_handle *dh,
 			     struct dect_timer *timer, unsigned int timeout);
+extern void dect_timer_start_ms(const struct dect_handle *dh,
+				struct dect_timer *timer, unsigned int timeout);
 extern void dect_timer_stop(const struct dect_handle *dh, struct dect_timer *timer);
 extern bool dect_timer_running(const struct dect_timer *timer);
+extern void dect_timer_set_slack_class(struct dect_timer *timer,
+				       enum dect_timer_slack_classes slack);
 
 extern void *dect_timer_data(const struct dect_timer *timer);
 
@@ -8,7 +8,7 @@ extern "C" {
 #include <stddef.h>
 
 #define container_of(ptr, type, member) ({				\
-	const typeof( ((type *)0)->member ) *__mptr = (ptr);		\
+	const __typeof__( ((type *)0)->member ) *__mptr = (ptr);		\
 	(type *)( (char *)__mptr - offsetof(type,member) );})
 
 #define __fmtstring(x, y)	__attribute__((format(printf, x, y)))
@@ -78,6 +78,35 @@ extern bool dect_parse_ipui(struct dect_ipui *ipui,
 			    const uint8_t *ptr, uint8_t len);
 extern uint8_t dect_build_ipui(uint8_t *ptr, const struct dect_ipui *ipui);
 extern void dect_dump_ipui(const struct dect_ipui *ipui);
+extern uint32_t dect_ipui_hash(const struct dect_ipui *ipui, unsigned int bits);
+
+/*
+ * Packed IPUI keys: PUT and identity specific fields, hashed for types P, Q
+ * and U. Identity numbers are limited to 60 bits by EN 300 175-6.
+ */
+#define DECT_IPUI_KEY_PUT_SHIFT		60
+#define DECT_IPUI_KEY_DATA_MASK		((1ULL << DECT_IPUI_KEY_PUT_SHIFT) - 1)
+
+extern uint64_t dect_ipui_key(const struct dect_ipui *ipui);
+
+static inline bool dect_ipui_key_unique(uint64_t key)
+{
+	switch ((key >> DECT_IPUI_KEY_PUT_SHIFT) << DECT_IPUI_PUT_SHIFT) {
+	case DECT_IPUI_P:
+	case DECT_IPUI_Q:
+	case DECT_IPUI_U:
+		return false;
+	default:
+		return true;
+	}
+}
+
+/* Compare the keys of two IPUIs, and the IPUIs if the keys are not unique */
+static inline bool dect_ipui_key_eq(uint64_t k1, const struct dect_ipui *i1,
+				    uint64_t k2, const struct dect_ipui *i2)
+{
+	return k1 == k2 && (dect_ipui_key_unique(k1) || !dect_ipui_cmp(i1, i2));
+}
 
 /*
  * TPUI
@@ -86,6 +115,7 @@ extern void dect_dump_ipui(const struct dect_ipui *ipui);
 #define DECT_TPUI_CONNECTIONLESS_GROUP_ID	0xcc000
 
 #define DECT_TPUI_CALL_GROUP_ID			0xdd000
+#define DECT_TPUI_GROUP_MASK			0x00fff
 
 #define DECT_TPUI_DEFAULT_INDIVIDUAL_ID		0xe0000
 #define DECT_TPUI_DEFAULT_INDIVIDUAL_IPUI_MASK	0x0ffff
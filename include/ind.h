@@ -0,0 +1,54 @@
+/*
+ * libdect batched indications
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LIBDECT_IND_H
+#define _LIBDECT_IND_H
+
+#include <dect/ind.h>
+
+/**
+ * struct dect_ind_batch - indication batching state
+ *
+ * @fn:		batch delivery callback
+ * @depth:	nesting depth of dect_ind_batch_begin()
+ * @n:		number of queued indications
+ * @inds:	queued indications
+ * @links:	data links of the queued indications
+ */
+struct dect_ind_batch {
+	void			(*fn)(struct dect_handle *dh,
+				      const struct dect_ind *inds,
+				      unsigned int n);
+	unsigned int		depth;
+	unsigned int		n;
+	struct dect_ind		inds[DECT_IND_BATCH_MAX];
+	struct dect_data_link	*links[DECT_IND_BATCH_MAX];
+};
+
+extern int dect_ind_queue(struct dect_handle *dh, struct dect_data_link *ddl,
+			  enum dect_ind_types type, void *obj,
+			  struct dect_ie_collection *param);
+extern void dect_ind_flush(struct dect_handle *dh);
+extern void dect_ind_process_end(struct dect_handle *dh);
+
+/* Deliver queued indications before further events of a data link */
+static inline void dect_ind_link_flush(struct dect_handle *dh,
+				       const struct dect_data_link *ddl)
+{
+	if (ddl->ind_queued > 0)
+		dect_ind_flush(dh);
+}
+
+/* Deliver queued indications before objects may be released */
+static inline void dect_ind_flush_pending(struct dect_handle *dh)
+{
+	if (dh->ind_batch != NULL && dh->ind_batch->n > 0)
+		dect_ind_flush(dh);
+}
+
+#endif /* _LIBDECT_IND_H */
@@ -13,8 +13,86 @@
 enum dect_fd_state {
 	DECT_FD_UNREGISTERED,
 	DECT_FD_REGISTERED,
+	DECT_FD_DETACHED,	/* socket handed off to another process */
+};
+
+struct dect_fd;
+struct dect_transport;
+struct dect_ari;
+struct dect_fp_capabilities;
+
+/**
+ * struct dect_transport_ops - socket layer of a transport backend
+ *
+ * @socket:		create a socket of the given type and DECT protocol
+ * @close:		close a socket
+ * @accept:		accept a data link on a listening S-SAP socket, returns a
+ *			non-blocking close-on-exec socket
+ * @bind:		bind a socket to a DECT address
+ * @listen:		listen for incoming data links
+ * @connect:		connect a socket to a DECT address
+ * @getsockopt:		get a socket option
+ * @setsockopt:		set a socket option
+ * @recvmsg:		receive a message
+ * @sendmsg:		send a message
+ * @sendmmsg:		send multiple messages
+ * @detach:		stop I/O on a socket passed to another process (optional)
+ * @exit:		release the transport state of a handle (optional)
+ * @llme_rfp_preload_req: MAC_ME_RFP_PRELOAD-req (optional)
+ * @llme_mac_me_info_res: MAC_ME_INFO-res (optional)
+ * @llme_scan_req:	SCAN-req (optional)
+ *
+ * Transports must supply real file descriptors usable with the application's
+ * event handler. Stream I/O of LU1 sockets and raw sockets is performed on
+ * the file descriptors directly. The LLME primitives are sent through netlink
+ * unless overridden.
+ */
+struct dect_transport_ops {
+	int		(*socket)(struct dect_transport *t, int type, int protocol);
+	void		(*close)(struct dect_fd *dfd);
+	int		(*accept)(const struct dect_fd *dfd,
+				  struct sockaddr *addr, socklen_t *len);
+	int		(*bind)(struct dect_fd *dfd, const struct sockaddr *addr,
+				socklen_t len);
+	int		(*listen)(struct dect_fd *dfd, int backlog);
+	int		(*connect)(struct dect_fd *dfd,
+				   const struct sockaddr *addr, socklen_t len);
+	int		(*getsockopt)(const struct dect_fd *dfd, int level,
+				      int optname, void *optval,
+				      socklen_t *optlen);
+	int		(*setsockopt)(const struct dect_fd *dfd, int level,
+				      int optname, const void *optval,
+				      socklen_t optlen);
+	ssize_t		(*recvmsg)(const struct dect_fd *dfd,
+				   struct msghdr *msg, int flags);
+	ssize_t		(*sendmsg)(const struct dect_fd *dfd,
+				   const struct msghdr *msg, int flags);
+	int		(*sendmmsg)(const struct dect_fd *dfd,
+				    struct mmsghdr *msgs, unsigned int vlen,
+				    int flags);
+	void		(*detach)(struct dect_fd *dfd);
+
+	void		(*exit)(struct dect_handle *dh);
+	int		(*llme_rfp_preload_req)(struct dect_handle *dh,
+						const struct dect_fp_capabilities *fpc);
+	int		(*llme_mac_me_info_res)(struct dect_handle *dh,
+						const struct dect_ari *pari);
+	int		(*llme_scan_req)(struct dect_handle *dh);
 };
 
+/**
+ * struct dect_transport - transport backend instance
+ *
+ * @ops:		transport operations
+ *
+ * Backends embed this structure in their per-handle state.
+ */
+struct dect_transport {
+	const struct dect_transport_ops	*ops;
+};
+
+extern struct dect_transport dect_kernel_transport;
+
 /**
  * struct dect_fd - libdect file descriptor
  *
@@ -22,6 +100,8 @@ enum dect_fd_state {
  * @fd:			file descriptor numer
  * @state:		file descriptor registration state (debugging)
  * @data:		libdect internal data
+ * @transport:		transport backend of the socket
+ * @prio:		priority class, only changed while unregistered
  * @priv:		libdect user private file-descriptor storage
  */
 struct dect_fd {
@@ -30,6 +110,8 @@ struct dect_fd {
 	int			fd;
 	enum dect_fd_state	state;
 	void			*data;
+	struct dect_transport	*transport;
+	enum dect_fd_priorities	prio;
 	uint8_t			priv[] __aligned(__alignof__(uint64_t));
 };
 
@@ -46,8 +128,63 @@ extern struct dect_fd *dect_accept(const struct dect_handle *dh,
 				   const struct dect_fd *dfd,
 				   struct sockaddr *addr, socklen_t len);
 
+static inline int dect_fd_bind(struct dect_fd *dfd,
+			       const struct sockaddr *addr, socklen_t len)
+{
+	return dfd->transport->ops->bind(dfd, addr, len);
+}
+
+static inline int dect_fd_listen(struct dect_fd *dfd, int backlog)
+{
+	return dfd->transport->ops->listen(dfd, backlog);
+}
+
+static inline int dect_fd_connect(struct dect_fd *dfd,
+				  const struct sockaddr *addr, socklen_t len)
+{
+	return dfd->transport->ops->connect(dfd, addr, len);
+}
+
+static inline int dect_fd_getsockopt(const struct dect_fd *dfd, int level,
+				     int optname, void *optval,
+				     socklen_t *optlen)
+{
+	return dfd->transport->ops->getsockopt(dfd, level, optname,
+					       optval, optlen);
+}
+
+static inline int dect_fd_setsockopt(const struct dect_fd *dfd, int level,
+				     int optname, const void *optval,
+				     socklen_t optlen)
+{
+	return dfd->transport->ops->setsockopt(dfd, level, optname,
+					       optval, optlen);
+}
+
+static inline ssize_t dect_fd_recvmsg(const struct dect_fd *dfd,
+				      struct msghdr *msg, int flags)
+{
+	return dfd->transport->ops->recvmsg(dfd, msg, flags);
+}
+
+static inline ssize_t dect_fd_sendmsg(const struct dect_fd *dfd,
+				      const struct msghdr *msg, int flags)
+{
+	return dfd->transport->ops->sendmsg(dfd, msg, flags);
+}
+
+static inline int dect_fd_sendmmsg(const struct dect_fd *dfd,
+				   struct mmsghdr *msgs, unsigned int vlen,
+				   int flags)
+{
+	return dfd->transport->ops->sendmmsg(dfd, msgs, vlen, flags);
+}
+
 extern int dect_fd_register(const struct dect_handle *dh, struct dect_fd *dfd,
 			    uint32_t events);
 extern void dect_fd_unregister(const struct dect_handle *dh, struct dect_fd *dfd);
+extern int dect_fd_detach(const struct dect_handle *dh, struct dect_fd *dfd);
+extern int dect_fd_update(const struct dect_handle *dh, struct dect_fd *dfd,
+			  uint32_t events);
 
 #endif /* _LIBDECT_IO_H */
@@ -0,0 +1,25 @@
+/*
+ * libdect subscriber key store
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LIBDECT_KEYSTORE_H
+#define _LIBDECT_KEYSTORE_H
+
+#include <dect/keystore.h>
+
+struct dect_data_link;
+extern const struct dect_keystore_entry *
+dect_keystore_get(const struct dect_handle *dh,
+		  const struct dect_data_link *ddl);
+extern void dect_keystore_set_uak(struct dect_handle *dh,
+				  const struct dect_ipui *ipui,
+				  const uint8_t *uak);
+extern void dect_keystore_set_dck(struct dect_handle *dh,
+				  const struct dect_data_link *ddl,
+				  const uint8_t *dck, uint8_t cipher_key_num);
+
+#endif /* _LIBDECT_KEYSTORE_H */
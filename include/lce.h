@@ -11,8 +11,47 @@
 #include <linux/dect.h>
 #include <list.h>
 #include <s_fmt.h>
+#include <b_fmt.h>
 #include <utils.h>
 
+/**
+ * struct dect_mbuf_pool - message buffer pool
+ *
+ * @free_list:	list of free message buffers, linked through mb->next
+ * @count:	number of buffers on the free list
+ * @prefill:	number of buffers allocated in advance
+ * @high_water:	maximum number of free buffers kept in the pool
+ * @hits:	number of allocations served from the pool
+ * @misses:	number of allocations served by the allocator
+ */
+struct dect_mbuf_pool {
+	struct dect_msg_buf		*free_list;
+	unsigned int			count;
+	unsigned int			prefill;
+	unsigned int			high_water;
+	uint64_t			hits;
+	uint64_t			misses;
+};
+
+#define DECT_MBUF_POOL_PREFILL		8
+#define DECT_MBUF_POOL_HIGH_WATER	32
+
+/* Default number of messages received per socket event */
+#define DECT_RCV_BUDGET_DEFAULT		16
+
+/* Maximum number of buffers in a message buffer chain */
+#define DECT_MBUF_IOV_MAX		8
+
+struct iovec;
+extern unsigned int dect_mbuf_fill_iov(struct iovec *iov,
+				       const struct dect_msg_buf *mb);
+extern unsigned int dect_mbuf_rcv_prepare(const struct dect_handle *dh,
+					  struct iovec *iov,
+					  struct dect_msg_buf *mb,
+					  unsigned int nfrags);
+extern void dect_mbuf_rcv_complete(const struct dect_handle *dh,
+				   struct dect_msg_buf *mb, size_t len);
+
 static inline void dect_mbuf_dump(enum dect_debug_subsys subsys,
 				  const struct dect_msg_buf *mb,
 				  const char *prefix)
@@ -41,17 +80,33 @@ enum dect_transaction_state {
 /* Connectionless NWK layer transaction value */
 #define DECT_TV_CONNECTIONLESS		6
 
+/* Maximum transaction value without TV extension */
+#define DECT_TV_MAX			7
+
 enum dect_release_modes {
 	DECT_DDL_RELEASE_NORMAL,
 	DECT_DDL_RELEASE_PARTIAL,
 };
 
+/**
+ * enum dect_rtt_types - round-trip time estimators
+ *
+ * @DECT_RTT_PAGE:	page to link establishment, includes the PP paging cycle
+ * @DECT_RTT_MM:	MM request to response on an established link
+ */
+enum dect_rtt_types {
+	DECT_RTT_PAGE,
+	DECT_RTT_MM,
+	__DECT_RTT_MAX
+};
+#define DECT_RTT_MAX			(__DECT_RTT_MAX - 1)
+
 /**
  * struct dect_transaction - DECT protocol transaction
  *
  * @list:	Datalink transaction list node
  * @link:	Associated data link
- * @mb:		Message buffer for retransmissions
+ * @rtx:	Stored message for retransmissions, NULL if none
  * @pd:		Protocol discriminator
  * @role:	Role (initiator/responder)
  * @tv:		Transaction value
@@ -59,7 +114,7 @@ enum dect_release_modes {
 struct dect_transaction {
 	struct list_head		list;
 	struct dect_data_link		*link;
-	struct dect_msg_buf		*mb;
+	struct dect_rtx_msg		*rtx;
 	enum dect_pds			pd;
 	enum dect_transaction_role	role:8;
 	enum dect_transaction_state	state:8;
@@ -70,8 +125,26 @@ extern int dect_ddl_transaction_open(struct dect_handle *dh,
 				     struct dect_transaction *ta,
 				     struct dect_data_link *ddl,
 				     enum dect_pds pd);
+extern int dect_ddl_suspend(struct dect_handle *dh,
+			    struct dect_data_link *ddl);
+extern void dect_ddl_rtt_sample(struct dect_handle *dh,
+				struct dect_data_link *ddl,
+				enum dect_rtt_types type, uint64_t start);
+extern unsigned int dect_ddl_rto(const struct dect_data_link *ddl,
+				 enum dect_rtt_types type, unsigned int limit);
 extern struct dect_data_link *dect_ddl_connect(struct dect_handle *dh,
 					       const struct dect_ipui *ipui);
+extern struct dect_data_link *
+dect_ddl_get_by_dlei(const struct dect_handle *dh,
+		     const struct sockaddr_dect_ssap *dlei);
+extern void dect_ddl_dump_history(const struct dect_data_link *ddl);
+extern struct dect_data_link *dect_ddl_replay_open(struct dect_handle *dh,
+						   int *peer);
+extern bool dect_ddl_replay_rcv(struct dect_handle *dh,
+				struct dect_data_link *ddl,
+				struct dect_msg_buf *mb);
+extern void dect_ddl_replay_close(struct dect_handle *dh,
+				  struct dect_data_link *ddl);
 extern int dect_ddl_set_ipui(struct dect_handle *dh, struct dect_data_link *ddl,
 			     const struct dect_ipui *ipui);
 
@@ -92,6 +165,10 @@ extern int dect_lce_send(const struct dect_handle *dh,
 			 struct dect_transaction *ta,
 			 const struct dect_sfmt_msg_desc *desc,
 			 const struct dect_msg_common *msg, uint8_t type);
+extern int dect_lce_send_tmpl(const struct dect_handle *dh,
+			      struct dect_transaction *ta,
+			      const struct dect_sfmt_msg_tmpl *tmpl,
+			      const struct dect_msg_common *msg, uint8_t type);
 extern int dect_lce_retransmit(const struct dect_handle *dh,
 			       struct dect_transaction *ta);
 
@@ -100,9 +177,24 @@ extern int dect_lce_send_cl(struct dect_handle *dh, const struct dect_ipui *ipui
 			    const struct dect_msg_common *msg,
 			    enum dect_pds pd, uint8_t type);
 
+/* Maximum number of links in establishment for a connectionless multicast */
+#define DECT_LCE_CL_MULTICAST_PENDING_MAX	8
+/* Interval for resuming a connectionless multicast in milliseconds */
+#define DECT_LCE_CL_MULTICAST_INTERVAL		100
+
+extern int dect_lce_send_cl_multicast(struct dect_handle *dh,
+				      const struct dect_ipui *ipuis,
+				      unsigned int n,
+				      const struct dect_sfmt_msg_desc *desc,
+				      const struct dect_msg_common *msg,
+				      enum dect_pds pd, uint8_t type);
+
 extern ssize_t dect_lce_broadcast(const struct dect_handle *dh,
 				  const struct dect_msg_buf *mb,
 				  bool long_page, bool fast_page);
+extern int dect_lce_page_queue(struct dect_handle *dh,
+			       const struct dect_msg_buf *mb,
+			       uint32_t tpui, bool fast_page);
 
 /**
  * struct dect_nwk_protocol - NWK layer protocol
@@ -129,39 +221,192 @@ struct dect_nwk_protocol {
 	void			(*encrypt_ind)(struct dect_handle *dh,
 					       struct dect_transaction *ta,
 					       enum dect_cipher_states state);
+	void			(*suspend_ind)(struct dect_handle *dh,
+					       struct dect_transaction *ta,
+					       bool suspended);
 	void			(*rebind)(struct dect_handle *dh,
 					  struct dect_data_link *from,
 					  struct dect_data_link *to);
+	bool			retransmit;
 };
 
-extern void dect_lce_register_protocol(const struct dect_nwk_protocol *protocol);
+/**
+ * struct dect_lte_page - cached page message of a PT
+ *
+ * @tpui:	TPUI value passed to the paging scheduler
+ * @valid:	cached message is valid
+ * @service:	MAC service type the message was built for
+ * @slot:	slot type the message was built for
+ * @fast_page:	PT supports fast paging
+ * @len:	message length
+ * @msg:	short or full page message
+ */
+struct dect_lte_page {
+	uint32_t				tpui;
+	bool					valid;
+	uint8_t					service;
+	uint8_t					slot;
+	bool					fast_page;
+	uint8_t					len;
+	uint8_t					msg[sizeof(struct dect_full_page_msg)];
+};
 
 /**
  * struct dect_lte - Location Table Entry
  *
  * @list:			Location table list node
+ * @ipui_node:			Location table IPUI hash node
+ * @tpui_node:			Location table TPUI hash node, hashed while TPUI is valid
  * @ipui:			International Portable User ID
+ * @ipui_key:			Packed IPUI key
  * @tpui:			Assigned Temporary Portable User ID
  * @tpui_valid:			TPUI is valid
- * @setup_capability:		PT's setup capabilities
- * @terminal_capability:	PT's terminal capabilities
+ * @dck_num:			Cipher key number the PT stored @dck under
+ * @setup_capability:		PT's setup capabilities, interned
+ * @terminal_capability:	PT's terminal capabilities, interned
+ * @dck:			Last derived cipher key, not exported
+ * @dck_time:			Derivation time of @dck in milliseconds, 0 if invalid
+ * @page:			Page message of the last paged service and slot type
  */
 struct dect_lte {
 	struct list_head			list;
+	struct hlist_node			ipui_node;
+	struct hlist_node			tpui_node;
 	struct dect_ipui			ipui;
+	uint64_t				ipui_key;
 	struct dect_tpui			tpui;
 	bool					tpui_valid;
+	uint8_t					dck_num;
 	struct dect_ie_setup_capability		*setup_capability;
 	struct dect_ie_terminal_capability	*terminal_capability;
+	uint8_t					dck[DECT_CIPHER_KEY_LEN];
+	uint64_t				dck_time;
+	struct dect_lte_page			page;
+};
+
+#define DECT_LDB_HASH_BITS		10
+#define DECT_LDB_HASH_SIZE		(1 << DECT_LDB_HASH_BITS)
+
+enum dect_lte_record_flags {
+	DECT_LTE_RECORD_TPUI		= 0x1,
+	DECT_LTE_RECORD_SETUP_CAP	= 0x2,
+	DECT_LTE_RECORD_TERMINAL_CAP	= 0x4,
 };
 
+/**
+ * struct dect_lte_record - Location Table Entry in a fixed size format
+ *
+ * @ipui:	International Portable User ID
+ * @tpui:	Assigned Temporary Portable User ID, valid with DECT_LTE_RECORD_TPUI
+ * @flags:	valid members (enum dect_lte_record_flags)
+ * @setup:	setup capabilities, valid with DECT_LTE_RECORD_SETUP_CAP
+ * @terminal:	terminal capabilities, valid with DECT_LTE_RECORD_TERMINAL_CAP
+ *
+ * Used to pass the location table to other processes.
+ */
+struct dect_lte_record {
+	struct dect_ipui			ipui;
+	struct dect_tpui			tpui;
+	uint32_t				flags;
+	struct {
+		uint8_t				page_capability;
+		uint8_t				setup_capability;
+	} setup;
+	struct {
+		uint8_t				tone;
+		uint8_t				echo;
+		uint8_t				noise_rejection;
+		uint8_t				volume_ctrl;
+		uint8_t				slot;
+		uint8_t				display;
+		uint8_t				display_lines;
+		uint8_t				display_columns;
+		uint16_t			display_memory;
+		uint8_t				display_control;
+		uint8_t				display_charsets;
+		uint8_t				scrolling;
+		uint64_t			profile_indicator;
+	} terminal;
+};
+
+extern struct dect_lte *dect_lte_get_by_tpui(const struct dect_handle *dh,
+					     const struct dect_tpui *tpui);
 extern void dect_lte_update(struct dect_handle *dh, const struct dect_ipui *ipui,
 			    struct dect_ie_setup_capability *setup_capability,
 			    struct dect_ie_terminal_capability *terminal_capability);
 
-extern void dect_lte_update_tpui(const struct dect_handle *dh,
+extern void dect_lte_update_tpui(struct dect_handle *dh,
 				 const struct dect_ipui *ipui,
 				 const struct dect_tpui *tpui);
+extern void dect_lte_update_dck(struct dect_handle *dh,
+				const struct dect_ipui *ipui,
+				const uint8_t *dck, uint8_t num);
+extern bool dect_lte_get_dck(const struct dect_handle *dh,
+			     const struct dect_ipui *ipui, uint8_t num,
+			     unsigned int lifetime, uint8_t *dck);
+extern void dect_lte_export(const struct dect_lte *lte,
+			    struct dect_lte_record *rec);
+extern int dect_lte_import(struct dect_handle *dh,
+			   const struct dect_lte_record *rec);
+
+/*
+ * Paging scheduler
+ */
+
+enum dect_page_prios {
+	DECT_PAGE_PRIO_FAST,
+	DECT_PAGE_PRIO_NORMAL,
+	__DECT_PAGE_PRIO_MAX
+};
+#define DECT_PAGE_PRIO_MAX		(__DECT_PAGE_PRIO_MAX - 1)
+
+/* Default queue depth and paging capacity: one page per frame */
+#define DECT_PAGE_DEPTH_DEFAULT		64
+#define DECT_PAGE_RATE_DEFAULT		100
+#define DECT_PAGE_BURST_DEFAULT		4
+
+/* Scheduling interval: one frame */
+#define DECT_PAGE_SCHED_INTERVAL	10	/* milliseconds */
+
+/**
+ * struct dect_page_sched - paging scheduler
+ *
+ * @queue:	pending pages per priority
+ * @timer:	scheduling timer
+ * @cfg:	scheduler configuration
+ * @tokens:	token bucket fill level in 1/1000 pages
+ * @last:	time of the last token bucket update in milliseconds
+ * @stats:	scheduler statistics
+ */
+struct dect_page_sched {
+	struct list_head		queue[DECT_PAGE_PRIO_MAX + 1];
+	struct dect_timer		*timer;
+	struct dect_lce_page_cfg	cfg;
+	uint64_t			tokens;
+	uint64_t			last;
+	struct dect_lce_page_stats	stats;
+};
+
+extern void dect_page_sched_init(struct dect_handle *dh);
+
+/**
+ * struct dect_lce_admission - admission control state
+ *
+ * @cfg:	admission control configuration
+ * @queue:	deferred MM requests, oldest first
+ * @timer:	deferred request timer, allocated when the first request is deferred
+ * @paused:	S-SAP listener is unregistered because of too many new links
+ * @stats:	admission control statistics
+ */
+struct dect_lce_admission {
+	struct dect_lce_admission_cfg	cfg;
+	struct list_head		queue;
+	struct dect_timer		*timer;
+	bool				paused;
+	struct dect_lce_admission_stats	stats;
+};
+
+extern void dect_lce_admission_init(struct dect_handle *dh);
 
 enum dect_data_link_states {
 	DECT_DATA_LINK_RELEASED,
@@ -177,38 +422,117 @@ enum dect_data_link_states {
 
 enum dect_data_link_flags {
 	DECT_DATA_LINK_IPUI_VALID	= 0x1,
+	DECT_DATA_LINK_RCV_ACTIVE	= 0x2,
+	DECT_DATA_LINK_DESTROYED	= 0x4,
+	DECT_DATA_LINK_LINGER		= 0x8,
+	DECT_DATA_LINK_ADMIT_PENDING	= 0x10,
+	DECT_DATA_LINK_DETACHED		= 0x20,
+};
+
+/**
+ * struct dect_rtt - round-trip time estimate
+ *
+ * @srtt:	smoothed round-trip time in microseconds, 0 without samples
+ * @rttvar:	round-trip time variation in microseconds
+ */
+struct dect_rtt {
+	uint32_t			srtt;
+	uint32_t			rttvar;
+};
+
+#define DECT_DDL_HISTORY_SIZE		8
+#define DECT_DDL_HISTORY_DATA_SIZE	62
+
+/**
+ * struct dect_ddl_history - last messages of a data link
+ *
+ * Messages are only recorded with #DECT_DEBUG_DEFER_DUMPS.
+ *
+ * @next:	index of the entry to overwrite next
+ * @msgs:	messages: direction, original length and the leading bytes
+ */
+struct dect_ddl_history {
+	unsigned int			next;
+	struct {
+		bool			tx;
+		uint8_t			len;
+		uint8_t			data[DECT_DDL_HISTORY_DATA_SIZE];
+	}				msgs[DECT_DDL_HISTORY_SIZE];
 };
 
 /**
  * struct dect_data_link
  *
  * @list:		DECT handle link list node
- * @dlei:		Data Link Endpoint identifier
- * @ipui:		International Portable User ID
  * @dfd:		Associated socket file descriptor
- * @mcp:		MAC connections parameters
  * @state:		Data link state
+ * @cipher:		Ciphering state
+ * @flags:		Data link flags (enum dect_data_link_flags)
+ * @ind_queued:		Number of indications of the link queued for batched delivery
  * @sdu_timer:		Establish without SDU timer (LCE.05)
+ * @transactions:	list of transactions
+ * @tx_queue:		Messages waiting for the socket to become writable
+ * @tx_queue_len:	Number of messages on the TX queue
+ * @msg_queue:		Message queue used during ESTABLISH_PENDING state
+ * @endpoints:		per-protocol endpoint slots, maintained by the protocol's rebind hook
+ * @ta_map:		bitmap of used TVs per PD and role
+ * @ta_table:		transactions indexed by PD, role and TV
+ * @ipui_node:		DECT handle link IPUI hash node, hashed while IPUI is valid
+ * @dlei_node:		DECT handle link DLEI hash node
+ * @dlei:		Data Link Endpoint identifier
+ * @ipui:		International Portable User ID
+ * @ipui_key:		Packed IPUI key, valid with the IPUI
+ * @mcp:		MAC connections parameters
  * @release_timer:	Normal link release timer (LCE.01)
  * @page_timer:		Indirect establish timer (LCE.03)
  * @page_count:		Number of page messages sent
- * @msg_queue:		Message queue used during ESTABLISH_PENDING state
+ * @establish_time:	Start of outgoing link establishment for latency statistics
+ * @rtt:		Round-trip time estimates for adaptive timeouts
+ * @group:		Group page the link is a member of
+ * @linger_timer:	Idle link linger timer
+ * @linger_node:	DECT handle idle link list node, valid while lingering
+ * @suspend_node:	DECT handle suspended link list node, valid while detached
+ * @history:		Last transmitted and received messages
+ *
+ * The members used when processing messages come first, so they share the
+ * leading cache lines. Link establishment, release and paging state and the
+ * message history follow.
  */
 struct dect_data_link {
 	struct list_head		list;
-	struct sockaddr_dect_ssap	dlei;
-	struct dect_ipui		ipui;
 	struct dect_fd			*dfd;
-	struct dect_mac_conn_params	mcp;
 	enum dect_data_link_states	state;
 	enum dect_cipher_states		cipher;
+	uint8_t				flags;
+	unsigned int			ind_queued;
 	struct dect_timer		*sdu_timer;
+	struct list_head		transactions;
+	PTRQUEUE_HEAD(struct dect_msg_buf) tx_queue;
+	unsigned int			tx_queue_len;
+	PTRQUEUE_HEAD(struct dect_msg_buf) msg_queue;
+	void				*endpoints[DECT_PD_MAX + 1];
+	uint8_t				ta_map[DECT_PD_MAX + 1]
+					      [DECT_TRANSACTION_MAX + 1];
+	struct dect_transaction		*ta_table[DECT_PD_MAX + 1]
+						 [DECT_TRANSACTION_MAX + 1]
+						 [DECT_TV_MAX + 1];
+
+	struct hlist_node		ipui_node;
+	struct hlist_node		dlei_node;
+	struct sockaddr_dect_ssap	dlei;
+	struct dect_ipui		ipui;
+	uint64_t			ipui_key;
+	struct dect_mac_conn_params	mcp;
 	struct dect_timer		*release_timer;
 	struct dect_timer		*page_timer;
 	uint8_t				page_count;
-	uint8_t				flags;
-	struct dect_msg_buf		*msg_queue;
-	struct list_head		transactions;
+	uint64_t			establish_time;
+	struct dect_rtt			rtt[DECT_RTT_MAX + 1];
+	struct dect_lce_group_page	*group;
+	struct dect_timer		*linger_timer;
+	struct list_head		linger_node;
+	struct list_head		suspend_node;
+	struct dect_ddl_history		history;
 };
 
 #define DECT_DDL_RELEASE_TIMEOUT	5	/* LCE.01: 5 seconds */
@@ -216,6 +540,72 @@ struct dect_data_link {
 #define DECT_DDL_PAGE_TIMEOUT		5	/* LCE.03: 5 seconds */
 #define DECT_DDL_ESTABLISH_SDU_TIMEOUT	5	/* LCE.05: 5 seconds */
 #define DECT_DDL_PAGE_RETRANS_MAX	3	/* N.300 */
+#define DECT_DDL_PAGE_TOTAL_TIMEOUT	(DECT_DDL_PAGE_RETRANS_MAX * \
+					 DECT_DDL_PAGE_TIMEOUT * 1000)
+#define DECT_DDL_RTO_MIN		250	/* milliseconds */
+
+/**
+ * struct dect_lce_group_page - group page
+ *
+ * @timer:	shared indirect establish timer (LCE.03)
+ * @mcp:	MAC connection parameters
+ * @tpui:	group TPUI, valid if @group_tpui is set
+ * @group_tpui:	page the group TPUI instead of the individual TPUIs
+ * @busy:	member links are being released by the group page
+ * @page_count:	number of page messages sent
+ * @active:	number of member links
+ * @size:	number of member link slots
+ * @links:	member links, NULL once released
+ */
+struct dect_lce_group_page {
+	struct dect_timer		*timer;
+	struct dect_mac_conn_params	mcp;
+	struct dect_tpui		tpui;
+	bool				group_tpui;
+	bool				busy;
+	uint8_t				page_count;
+	unsigned int			active;
+	unsigned int			size;
+	struct dect_data_link		*links[];
+};
+
+/* Maximum number of messages waiting for the socket to become writable */
+#define DECT_DDL_TX_QUEUE_MAX		32
+
+#define DECT_LINK_HASH_BITS		8
+#define DECT_LINK_HASH_SIZE		(1 << DECT_LINK_HASH_BITS)
+
+/* Number of timers embedded in struct dect_data_link */
+#define DECT_DDL_TIMER_MAX		4
+
+/**
+ * struct dect_rtx_msg - message stored for retransmission
+ *
+ * @list:	retransmission store list node
+ * @ta:		transaction the message was sent on
+ * @len:	message length including the S-Format header
+ * @data:	message data
+ */
+struct dect_rtx_msg {
+	struct list_head		list;
+	struct dect_transaction		*ta;
+	uint16_t			len;
+	uint8_t				data[];
+};
+
+/**
+ * struct dect_rtx_store - retransmission store
+ *
+ * @msgs:	stored messages, least recently sent first
+ * @cnt:	number of stored messages
+ */
+struct dect_rtx_store {
+	struct list_head		msgs;
+	unsigned int			cnt;
+};
+
+/* Default maximum number of messages kept for retransmission */
+#define DECT_RTX_STORE_MAX		1024
 
 extern int dect_ddl_set_cipher_key(const struct dect_data_link *ddl,
 				   const uint8_t ck[]);
@@ -265,7 +655,11 @@ struct dect_lce_page_reject_msg {
 };
 
 extern void dect_pp_change_pmid(struct dect_handle *dh);
+extern uint32_t dect_lce_page_ipui(const struct dect_ipui *ipui);
 
+extern int dect_ddl_adopt(struct dect_handle *dh, struct dect_fd *dfd,
+			  const struct sockaddr_dect_ssap *dlei,
+			  const struct dect_mac_conn_params *mcp, bool admit);
 extern int dect_lce_init(struct dect_handle *dh);
 extern void dect_lce_exit(struct dect_handle *dh);
 
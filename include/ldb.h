@@ -0,0 +1,17 @@
+/*
+ * libdect persistent location database
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LIBDECT_LDB_H
+#define _LIBDECT_LDB_H
+
+#include <dect/ldb.h>
+
+struct dect_lte;
+extern void dect_ldb_update(struct dect_handle *dh, const struct dect_lte *lte);
+
+#endif /* _LIBDECT_LDB_H */
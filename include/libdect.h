@@ -7,6 +7,26 @@
 #include <list.h>
 #include <lce.h>
 
+/**
+ * enum dect_open_states - asynchronous open states
+ *
+ * @DECT_OPEN_READY:	handle is initialized
+ * @DECT_OPEN_QUERY:	waiting for the cluster query response
+ * @DECT_OPEN_DONE:	cluster information received, completion pending
+ * @DECT_OPEN_SEEDED:	initialized from a cached snapshot, completion pending
+ * @DECT_OPEN_INFO:	waiting for the MAC_ME_INFO-req response (PP only)
+ * @DECT_OPEN_FAILED:	initialization failed, or completion pending while
+ *			the open timer is running
+ */
+enum dect_open_states {
+	DECT_OPEN_READY,
+	DECT_OPEN_QUERY,
+	DECT_OPEN_DONE,
+	DECT_OPEN_SEEDED,
+	DECT_OPEN_INFO,
+	DECT_OPEN_FAILED,
+};
+
 enum dect_pp_identities {
 	DECT_PP_IPUI		= 0x1,
 	DECT_PP_TPUI		= 0x2,
@@ -16,24 +36,72 @@ enum dect_pp_identities {
  * struct dect_handle - libdect handle
  *
  * @ops:	user ops
+ * @transport:	transport backend
  * @nlsock:	netlink socket
  * @nlfd:	netlink file descriptor
  * @index:	cluster index
  * @mode:	cluster mode
  * @pari:	FP's PARI
  * @fpc:	FP capabilities
+ * @llme_batch:	batched LLME requests, NULL when not batching
+ * @scan_session: active scan session
+ * @auth_offload: authentication offload state
+ * @cmdq:	command queue for requests from other threads
+ * @ind_batch:	batched indication state, NULL when not batching
+ * @ks_cache:	session authentication key cache
+ * @stats:	runtime statistics
+ * @stats_mem:	runtime statistics allocation
+ * @msg_cost:	message cost sampling state, NULL when not sampling
+ * @mem:	memory accounting state
+ * @shard:	sharding state
+ * @recorder:	S-SAP traffic recorder
+ * @page_sched:	LCE paging scheduler
  * @ipui:	PP's IPUI
  * @tpui:	PP's TPUI
  * @pmid:	PP's PMID
  * @flags:	PP identity validity flags
+ * @page_tpui:	PP's short page TPUI values, indexed by the W bit
+ * @pp_table:	emulated PP identities, NULL if not used
  * @ldb:	LCE location table data base
+ * @ldb_ipui_hash: location table index by IPUI
+ * @ldb_tpui_hash: location table index by assigned TPUI
+ * @ldb_file:	persistent location database, NULL if not used
+ * @keystore:	subscriber key store, NULL if not used
  * @b_sap:	B-SAP socket
  * @s_sap:	S-SAP listener socket
+ * @admission:	admission control state
  * @links:	list of data links
+ * @rcv_budget:	maximum number of messages received per socket event
+ * @linger_links: idle data links kept open, oldest first
+ * @linger_timeout: idle data link linger time in milliseconds, 0 to disable
+ * @linger_max:	maximum number of idle data links
+ * @linger_stats: idle data link statistics
+ * @suspended_links: suspended data links without MAC connection
+ * @rtt:	round-trip time estimates of all data links
+ * @link_ipui_hash: data link index by IPUI
+ * @link_dlei_hash: data link index by DLEI
+ * @cl_multicasts: connectionless messages being sent to multiple PPs
  * @mme_list:	MM endpoint list
+ * @provision:	active bulk provisioning session
+ * @mbuf_pool:	message buffer pool
+ * @rtx_store:	last messages of transactions of retransmitting protocols
+ * @rtx_max:	maximum number of messages kept for retransmission
+ * @ie_arena_size: size of IE arenas for received messages
+ * @ie_intern_hash: interned IEs
+ * @ie_intern_cnt: number of interned IEs
+ * @cc_setup_tmpl: {CC-SETUP} template containing the fixed identity
+ * @cc_info_window: keypad information coalescing window in milliseconds
+ * @timer_wheel: internal timer wheel, NULL if the application manages timers
+ * @timer_slack: slack window of coarse timers in milliseconds, 0 to disable
+ * @open_state:	asynchronous open state
+ * @open_timer:	asynchronous open timeout and completion timer
+ * @open_cb:	asynchronous open completion callback
+ * @open_err:	asynchronous open error code
+ * @debug_hook:	debugging message hook of the handle, NULL to use the global hook
  */
 struct dect_handle {
 	const struct dect_ops		*ops;
+	struct dect_transport		*transport;
 
 	struct nl_sock			*nlsock;
 	struct dect_fd			*nlfd;
@@ -42,22 +110,100 @@ struct dect_handle {
 	enum dect_cluster_modes		mode;
 	struct dect_ari			pari;
 	struct dect_fp_capabilities	fpc;
+	struct dect_llme_batch		*llme_batch;
+	struct dect_scan_session	*scan_session;
+	struct dect_auth_offload	*auth_offload;
+	struct dect_cmdq		*cmdq;
+	struct dect_ind_batch		*ind_batch;
+	struct dect_auth_ks_cache	*ks_cache;
+	struct dect_stats		*stats;
+	void				*stats_mem;
+	struct dect_msg_cost		*msg_cost;
+	struct dect_mem			*mem;
+	struct dect_shard		*shard;
+	struct dect_recorder		*recorder;
 
 	struct dect_transaction		page_transaction;
+	struct dect_page_sched		page_sched;
 	struct dect_ipui		ipui;
 	struct dect_tpui		tpui;
 	uint32_t			pmid;
 	uint32_t			flags;
+	uint16_t			page_tpui[2];
+	struct dect_pp_table		*pp_table;
 
 	struct list_head		ldb;
+	struct hlist_head		ldb_ipui_hash[DECT_LDB_HASH_SIZE];
+	struct hlist_head		ldb_tpui_hash[DECT_LDB_HASH_SIZE];
+	struct dect_ldb			*ldb_file;
+	struct dect_keystore		*keystore;
 
 	struct dect_fd			*b_sap;
 	struct dect_fd			*s_sap;
+	struct dect_lce_admission	admission;
 	struct list_head		links;
+	unsigned int			rcv_budget;
+	struct list_head		linger_links;
+	unsigned int			linger_timeout;
+	unsigned int			linger_max;
+	struct dect_lce_linger_stats	linger_stats;
+	struct list_head		suspended_links;
+	struct dect_rtt			rtt[DECT_RTT_MAX + 1];
+	struct hlist_head		link_ipui_hash[DECT_LINK_HASH_SIZE];
+	struct hlist_head		link_dlei_hash[DECT_LINK_HASH_SIZE];
+	struct list_head		cl_multicasts;
 
 	struct list_head		mme_list;
+	struct dect_mm_provision	*provision;
+
+	struct dect_mbuf_pool		*mbuf_pool;
+	struct dect_rtx_store		*rtx_store;
+	unsigned int			rtx_max;
+	unsigned int			ie_arena_size;
+	struct hlist_head		ie_intern_hash[DECT_IE_INTERN_HASH_SIZE];
+	unsigned int			ie_intern_cnt;
+	struct dect_sfmt_msg_tmpl	cc_setup_tmpl;
+	unsigned int			cc_info_window;
+	struct dect_timer_wheel		*timer_wheel;
+	unsigned int			timer_slack;
+
+	enum dect_open_states		open_state;
+	struct dect_timer		*open_timer;
+	void				(*open_cb)(struct dect_handle *, int);
+	int				open_err;
+	void				(*debug_hook)(enum dect_debug_subsys subsys,
+						      const char *fmt, va_list ap);
 
 	uint8_t				priv[] __aligned(__alignof__(uint64_t));
 };
 
+extern struct dect_handle *dect_alloc_handle(struct dect_ops *ops);
+
+extern int dect_mem_init(struct dect_handle *dh);
+extern void dect_mem_exit(struct dect_handle *dh);
+
+/* Increment a statistics counter */
+#define dect_stats_inc(dh, group, counter)	((dh)->stats->group.counter++)
+
+extern int dect_stats_init(struct dect_handle *dh);
+extern void dect_stats_exit(struct dect_handle *dh);
+extern uint64_t dect_stats_clock(void);
+extern void dect_stats_latency(const struct dect_handle *dh,
+			       enum dect_stats_latencies latency, uint64_t start);
+
+extern uint64_t dect_stats_rcv_begin(const struct dect_handle *dh,
+				     uint8_t pd, uint8_t type);
+extern void dect_stats_rcv_end(const struct dect_handle *dh, uint64_t start);
+extern uint64_t dect_stats_parse_begin(const struct dect_handle *dh);
+extern void dect_stats_parse_end(const struct dect_handle *dh, uint64_t start);
+extern uint64_t dect_stats_build_begin(const struct dect_handle *dh);
+extern void dect_stats_build_end(const struct dect_handle *dh, uint64_t start,
+				 uint8_t pd, uint8_t type);
+
+/* Invalidate templates depending on the handle's mode or identities */
+static inline void dect_handle_tmpl_invalidate(struct dect_handle *dh)
+{
+	dh->cc_setup_tmpl.desc = NULL;
+}
+
 #endif /* _LIBDECT_H */
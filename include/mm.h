@@ -348,6 +348,9 @@ enum dect_mm_procedures {
  * @retransmissions:	Number of retransmissions
  * @transaction:	Procedure transaction
  * @timer:		Procedure timer
+ * @start:		Initiation time for latency statistics, 0 for responders
+ * @rtt_start:		Request transmission time for round-trip time measurement,
+ *			0 once sampled or retransmitted
  */
 struct dect_mm_procedure {
 	enum dect_mm_procedures			type:8;
@@ -358,6 +361,8 @@ struct dect_mm_procedure {
 	struct dect_ie_collection		*iec;
 	struct dect_tpui			tpui;
 	struct dect_timer			*timer;
+	uint64_t				start;
+	uint64_t				rtt_start;
 };
 
 /**
@@ -367,6 +372,8 @@ struct dect_mm_procedure {
  * @link:		data link
  * @procedure:		Originator/Responder procedures
  * @current:		currently active procedure
+ * @admitted:		holds an admission control slot
+ * @secure:		active secure link procedure
  * @priv:		libdect user private storage
  */
 struct dect_mm_endpoint {
@@ -374,9 +381,33 @@ struct dect_mm_endpoint {
 	struct dect_data_link			*link;
 	struct dect_mm_procedure		procedure[DECT_TRANSACTION_MAX + 1];
 	struct dect_mm_procedure		*current;
+	bool					admitted;
+	struct dect_mm_secure			*secure;
 	uint8_t					priv[] __aligned(__alignof__(uint64_t));
 };
 
 extern const struct dect_nwk_protocol dect_mm_protocol;
+extern const struct dect_sfmt_msg_desc * const dect_mm_msg_descs[];
+
+extern bool dect_mm_provision_access_rights_ind(struct dect_handle *dh,
+						struct dect_mm_endpoint *mme,
+						struct dect_mm_access_rights_param *param);
+extern bool dect_mm_provision_authenticate_ind(struct dect_handle *dh,
+					       struct dect_mm_endpoint *mme,
+					       struct dect_mm_authenticate_param *param);
+extern bool dect_mm_provision_authenticate_cfm(struct dect_handle *dh,
+					       struct dect_mm_endpoint *mme, bool accept,
+					       struct dect_mm_authenticate_param *param);
+extern void dect_mm_provision_endpoint_destroy(struct dect_handle *dh,
+					       const struct dect_mm_endpoint *mme);
+extern void dect_mm_provision_exit(struct dect_handle *dh);
+
+extern bool dect_mm_secure_authenticate_cfm(struct dect_handle *dh,
+					    struct dect_mm_endpoint *mme, bool accept,
+					    struct dect_mm_authenticate_param *param);
+extern bool dect_mm_secure_cipher_cfm(struct dect_handle *dh,
+				      struct dect_mm_endpoint *mme, bool accept);
+extern void dect_mm_secure_endpoint_destroy(struct dect_handle *dh,
+					    struct dect_mm_endpoint *mme);
 
 #endif /* _LIBDECT_MM_H */
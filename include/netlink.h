@@ -2,6 +2,14 @@
 #define _LIBDECT_NETLINK_H
 
 extern int dect_netlink_init(struct dect_handle *dh, const char *cluster);
+extern int dect_netlink_init_async(struct dect_handle *dh, const char *cluster,
+				   const struct dect_cluster_info *info);
 extern void dect_netlink_exit(struct dect_handle *dh);
 
+extern bool dect_scan_session_rcv(struct dect_handle *dh,
+				  const struct dect_ari *pari,
+				  const struct dect_fp_capabilities *fpc);
+
+extern void dect_open_complete(struct dect_handle *dh, int err);
+
 #endif /* _LIBDECT_NETLINK_H */
@@ -0,0 +1,102 @@
+/*
+ * libdect PP identity table
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LIBDECT_PP_TABLE_H
+#define _LIBDECT_PP_TABLE_H
+
+#include <dect/pp_table.h>
+#include <list.h>
+#include <utils.h>
+#include <lce.h>
+
+#define DECT_PP_HASH_BITS		10
+#define DECT_PP_HASH_SIZE		(1 << DECT_PP_HASH_BITS)
+
+/**
+ * enum dect_pp_page_keys - page identities of a PP
+ *
+ * @DECT_PP_PAGE_DEFAULT_TPUI:	default individual TPUI of short pages
+ * @DECT_PP_PAGE_ASSIGNED_TPUI:	assigned individual TPUI of short pages
+ * @DECT_PP_PAGE_IPUI:		IPUI of full pages
+ */
+enum dect_pp_page_keys {
+	DECT_PP_PAGE_DEFAULT_TPUI,
+	DECT_PP_PAGE_ASSIGNED_TPUI,
+	DECT_PP_PAGE_IPUI,
+	__DECT_PP_PAGE_MAX
+};
+
+/**
+ * struct dect_pp_page_key - page hash entry of a PP identity
+ *
+ * @node:	page hash node, hashed while the identity is valid
+ * @id:		PP identity
+ * @value:	identity as contained in page messages
+ * @type:	identity type (enum dect_pp_page_keys)
+ */
+struct dect_pp_page_key {
+	struct hlist_node		node;
+	struct dect_pp_identity		*id;
+	uint32_t			value;
+	uint8_t				type;
+};
+
+/**
+ * struct dect_pp_identity - emulated PP identity
+ *
+ * @list:		identity table list node
+ * @ipui_node:		identity table IPUI hash node
+ * @keys:		page hash entries
+ * @ipui:		PP's IPUI
+ * @ipui_key:		packed IPUI key
+ * @tpui:		PP's assigned TPUI, valid with DECT_PP_TPUI
+ * @pmid:		PP's PMID
+ * @flags:		identity validity flags
+ * @page_transaction:	transaction of the page response
+ */
+struct dect_pp_identity {
+	struct list_head		list;
+	struct hlist_node		ipui_node;
+	struct dect_pp_page_key		keys[__DECT_PP_PAGE_MAX];
+	struct dect_ipui		ipui;
+	uint64_t			ipui_key;
+	struct dect_tpui		tpui;
+	uint32_t			pmid;
+	uint32_t			flags;
+	struct dect_transaction		page_transaction;
+};
+
+/**
+ * struct dect_pp_table - PP identity table
+ *
+ * @identities:	list of identities
+ * @ipui_hash:	identity index by IPUI
+ * @page_hash:	identity index by page identity
+ */
+struct dect_pp_table {
+	struct list_head		identities;
+	struct hlist_head		ipui_hash[DECT_PP_HASH_SIZE];
+	struct hlist_head		page_hash[DECT_PP_HASH_SIZE];
+};
+
+static inline struct hlist_head *
+dect_pp_page_bucket(struct dect_pp_table *pt, enum dect_pp_page_keys type,
+		    uint32_t value)
+{
+	return &pt->page_hash[hash_64((uint64_t)type << 32 | value,
+				      DECT_PP_HASH_BITS)];
+}
+
+extern struct dect_pp_identity *dect_pp_identity_find(const struct dect_handle *dh,
+						      uint64_t key,
+						      const struct dect_ipui *ipui);
+extern uint32_t dect_pp_table_pmid(const struct dect_handle *dh,
+				   const struct dect_data_link *ddl);
+extern void dect_pp_table_exit(struct dect_handle *dh);
+
+#endif /* _LIBDECT_PP_TABLE_H */
@@ -0,0 +1,22 @@
+/*
+ * libdect S-SAP traffic recorder
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LIBDECT_RECORD_H
+#define _LIBDECT_RECORD_H
+
+#include <dect/record.h>
+
+extern void __dect_record(const struct dect_handle *dh, const void *link,
+			  enum dect_record_types type,
+			  const struct dect_msg_buf *mb);
+extern void dect_record_exit(struct dect_handle *dh);
+
+#define dect_record(dh, link, type, mb) \
+	({ if ((dh)->recorder != NULL) __dect_record(dh, link, type, mb); })
+
+#endif /* _LIBDECT_RECORD_H */
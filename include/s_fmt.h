@@ -264,19 +264,206 @@ struct dect_sfmt_ie_desc {
 	.flags	= DECT_SFMT_IE_END,			\
 }
 
+/* Maximum number of IE descriptions in a message description */
+#define DECT_SFMT_MSG_IE_MAX		64
+
+/**
+ * struct dect_sfmt_msg_rx_index - receive direction IE index of a message description
+ *
+ * @first:	first IE description matching an IE id, DECT_SFMT_MSG_IE_MAX if none
+ * @next:	next IE description of the same type, DECT_SFMT_MSG_IE_MAX if none
+ * @mandatory:	bitmap of mandatory IE descriptions
+ * @optional:	bitmap of optional IE descriptions
+ */
+struct dect_sfmt_msg_rx_index {
+	uint8_t				first[256];
+	uint8_t				next[DECT_SFMT_MSG_IE_MAX];
+	uint64_t			mandatory;
+	uint64_t			optional;
+};
+
+/**
+ * struct dect_sfmt_msg_index - index of a message description
+ *
+ * @valid:	index has been computed
+ * @count:	number of IE descriptions, excluding the end marker
+ * @offset:	offset of the IE storage of each IE description in the message
+ * @rx:		receive direction indices for FP and PP mode
+ *
+ * The index is computed on first use of the message description.
+ */
+struct dect_sfmt_msg_index {
+	bool				valid;
+	uint8_t				count;
+	uint16_t			offset[DECT_SFMT_MSG_IE_MAX + 1];
+	struct dect_sfmt_msg_rx_index	rx[2];
+};
+
+struct dect_msg_common;
+struct dect_msg_buf;
+
+/**
+ * struct dect_sfmt_msg_desc - S-Format message description
+ *
+ * @name:	Message name
+ * @index:	Index computed on first use
+ * @parse:	Specialized parser for the message (optional)
+ * @build:	Specialized builder for the message (optional)
+ * @ie:		IE descriptions
+ */
 struct dect_sfmt_msg_desc {
 	const char			*name;
+	struct dect_sfmt_msg_index	*index;
+	enum dect_sfmt_error		(*parse)(const struct dect_handle *dh,
+						 const struct dect_sfmt_msg_desc *desc,
+						 struct dect_msg_common *dst,
+						 struct dect_msg_buf *mb);
+	enum dect_sfmt_error		(*build)(const struct dect_handle *dh,
+						 const struct dect_sfmt_msg_desc *desc,
+						 const struct dect_msg_common *src,
+						 struct dect_msg_buf *mb);
 	struct dect_sfmt_ie_desc	ie[];
 };
 
 #define DECT_SFMT_MSG_DESC(_name, _init...)			\
 	const struct dect_sfmt_msg_desc _name ## _msg_desc = {	\
 		.name	= # _name,				\
+		.index	= &(struct dect_sfmt_msg_index){},	\
 		.ie	= {					\
 			_init,					\
 		},						\
 	}
 
+/*
+ * Specialized message codecs
+ *
+ * Messages described by an IE list macro of the form
+ *
+ *	#define DECT_FOO_IES(IE) IE(type, fp_pp, pp_fp, flags) ...
+ *
+ * can be defined using DECT_SFMT_MSG_DESC_CODEC(), which in addition to the
+ * description expands to a parser and builder for each mode, unrolled over
+ * the IE list with all status checks resolved at compile time. They behave
+ * exactly like the generic interpreter in s_msg.c, which is used for all
+ * other messages and for lazy parsing.
+ */
+
+#define __DECT_SFMT_IE_ENTRY(_type, _fp_pp, _pp_fp, _flags)		\
+	DECT_SFMT_IE(_type, _fp_pp, _pp_fp, _flags),
+
+#define __DECT_SFMT_GEN_PARSE_IE(_type, _status, _flags)			\
+	err = dect_sfmt_gen_parse_ie(dh, msg, _type, DECT_SFMT_ ## _status,	\
+				     _flags, &dst, mb, &ie);			\
+	if (err != DECT_SFMT_OK)						\
+		goto err;
+
+#define __DECT_SFMT_GEN_BUILD_IE(_type, _status, _flags)			\
+	err = dect_sfmt_gen_build_ie(dh, _type, DECT_SFMT_ ## _status,		\
+				     _flags, &src, &iel, mb);			\
+	if (err != DECT_SFMT_OK)						\
+		return err;
+
+/* Receive status is pp_fp in FP mode and fp_pp in PP mode, transmit vice versa */
+#define __DECT_SFMT_GEN_PARSE_FP(_type, _fp_pp, _pp_fp, _flags)		\
+	__DECT_SFMT_GEN_PARSE_IE(_type, _pp_fp, _flags)
+#define __DECT_SFMT_GEN_PARSE_PP(_type, _fp_pp, _pp_fp, _flags)		\
+	__DECT_SFMT_GEN_PARSE_IE(_type, _fp_pp, _flags)
+#define __DECT_SFMT_GEN_BUILD_FP(_type, _fp_pp, _pp_fp, _flags)		\
+	__DECT_SFMT_GEN_BUILD_IE(_type, _fp_pp, _flags)
+#define __DECT_SFMT_GEN_BUILD_PP(_type, _fp_pp, _pp_fp, _flags)		\
+	__DECT_SFMT_GEN_BUILD_IE(_type, _pp_fp, _flags)
+
+#define __DECT_SFMT_GEN_PARSER(_name, _ies, _mode)				\
+static enum dect_sfmt_error							\
+dect_parse_ ## _name ## _msg_ ## _mode(const struct dect_handle *dh,		\
+				      const struct dect_sfmt_msg_desc *mdesc,	\
+				      struct dect_msg_common *msg,		\
+				      struct dect_msg_buf *mb)			\
+{										\
+	struct dect_ie_common **dst = &msg->ie[0];				\
+	struct dect_sfmt_ie _ie, *ie = &_ie;					\
+	enum dect_sfmt_error err;						\
+										\
+	err = dect_sfmt_gen_parse_begin(dh, mdesc, msg, mb, &ie);		\
+	if (err != DECT_SFMT_OK)						\
+		goto err;							\
+	_ies(__DECT_SFMT_GEN_PARSE_ ## _mode)					\
+	return DECT_SFMT_OK;							\
+err:										\
+	dect_sfmt_gen_parse_abort(msg);						\
+	return err;								\
+}
+
+#define __DECT_SFMT_GEN_BUILDER(_name, _ies, _mode)				\
+static enum dect_sfmt_error							\
+dect_build_ ## _name ## _msg_ ## _mode(const struct dect_handle *dh,		\
+				      const struct dect_sfmt_msg_desc *mdesc,	\
+				      const struct dect_msg_common *msg,	\
+				      struct dect_msg_buf *mb)			\
+{										\
+	struct dect_ie_common * const *src = &msg->ie[0];			\
+	struct dect_ie_list *iel = NULL;					\
+	enum dect_sfmt_error err;						\
+										\
+	dect_sfmt_gen_build_begin(mdesc);					\
+	_ies(__DECT_SFMT_GEN_BUILD_ ## _mode)					\
+	return DECT_SFMT_OK;							\
+}
+
+/**
+ * Define a S-Format message description with specialized codecs
+ *
+ * @param _name		message name
+ * @param _ies		IE list macro
+ *
+ * Must be preceded by the static keyword, like DECT_SFMT_MSG_DESC().
+ */
+#define DECT_SFMT_MSG_DESC_CODEC(_name, _ies)					\
+enum dect_sfmt_error								\
+dect_parse_ ## _name ## _msg(const struct dect_handle *dh,			\
+			     const struct dect_sfmt_msg_desc *mdesc,		\
+			     struct dect_msg_common *msg,			\
+			     struct dect_msg_buf *mb);				\
+__DECT_SFMT_GEN_PARSER(_name, _ies, FP)						\
+__DECT_SFMT_GEN_PARSER(_name, _ies, PP)						\
+__DECT_SFMT_GEN_BUILDER(_name, _ies, FP)					\
+__DECT_SFMT_GEN_BUILDER(_name, _ies, PP)					\
+										\
+static enum dect_sfmt_error							\
+dect_parse_ ## _name ## _msg(const struct dect_handle *dh,			\
+			     const struct dect_sfmt_msg_desc *mdesc,		\
+			     struct dect_msg_common *msg,			\
+			     struct dect_msg_buf *mb)				\
+{										\
+	if (dh->mode == DECT_MODE_FP)						\
+		return dect_parse_ ## _name ## _msg_FP(dh, mdesc, msg, mb);	\
+	else									\
+		return dect_parse_ ## _name ## _msg_PP(dh, mdesc, msg, mb);	\
+}										\
+										\
+static enum dect_sfmt_error							\
+dect_build_ ## _name ## _msg(const struct dect_handle *dh,			\
+			     const struct dect_sfmt_msg_desc *mdesc,		\
+			     const struct dect_msg_common *msg,			\
+			     struct dect_msg_buf *mb)				\
+{										\
+	if (dh->mode == DECT_MODE_FP)						\
+		return dect_build_ ## _name ## _msg_FP(dh, mdesc, msg, mb);	\
+	else									\
+		return dect_build_ ## _name ## _msg_PP(dh, mdesc, msg, mb);	\
+}										\
+										\
+static const struct dect_sfmt_msg_desc _name ## _msg_desc = {			\
+	.name	= # _name,							\
+	.index	= &(struct dect_sfmt_msg_index){},				\
+	.parse	= dect_parse_ ## _name ## _msg,					\
+	.build	= dect_build_ ## _name ## _msg,					\
+	.ie	= {								\
+		_ies(__DECT_SFMT_IE_ENTRY)					\
+		DECT_SFMT_IE_END_MSG,						\
+	},									\
+}
+
 static inline enum dect_reject_reasons dect_sfmt_reject_reason(enum dect_sfmt_error err)
 {
 	switch (err) {
@@ -289,20 +476,89 @@ static inline enum dect_reject_reasons dect_sfmt_reject_reason(enum dect_sfmt_er
 	}
 }
 
+struct dect_ie_arena;
+
+/**
+ * struct dect_sfmt_ie_view - location of an unparsed IE within a message
+ *
+ * @id:		IE id
+ * @offset:	offset of the IE header relative to the start of the message IEs
+ * @len:	IE length including the header, zero if absent
+ */
+struct dect_sfmt_ie_view {
+	uint8_t				id;
+	uint8_t				offset;
+	uint8_t				len;
+};
+
+/**
+ * struct dect_sfmt_msg_view - IE views of a lazily parsed message
+ *
+ * @data:	start of the message IEs within the message buffer
+ * @ie:		IE views indexed by IE description
+ *
+ * The views refer to the message buffer, which must remain unchanged
+ * until all IEs of interest have been resolved.
+ */
+struct dect_sfmt_msg_view {
+	const uint8_t			*data;
+	struct dect_sfmt_ie_view	ie[DECT_SFMT_MSG_IE_MAX];
+};
+
 /**
  * struct dect_msg_common - Common dummy msg structure to avoid casts
  *
+ * @arena:	IE arena of a received message
+ * @view:	IE views of a lazily parsed message
  * @ie:		First IE
  */
 struct dect_msg_common {
+	struct dect_ie_arena		*arena;
+	struct dect_sfmt_msg_view	*view;
 	struct dect_ie_common		*ie[0];
 };
 
+#define DECT_IE_INTERN_HASH_BITS	5
+#define DECT_IE_INTERN_HASH_SIZE	(1 << DECT_IE_INTERN_HASH_BITS)
+
+/* Maximum number of interned IEs per handle */
+#define DECT_IE_INTERN_MAX		128
+
+extern void dect_ie_intern_flush(struct dect_handle *dh);
+
+extern struct dect_ie_arena *dect_ie_arena_alloc(const struct dect_handle *dh);
+extern void dect_ie_arena_free(struct dect_ie_arena *arena);
+extern struct dect_ie_common *dect_ie_arena_ie_alloc(struct dect_ie_arena *arena,
+						     size_t size);
+
 struct dect_msg_buf;
 extern enum dect_sfmt_error dect_parse_sfmt_msg(const struct dect_handle *dh,
 						const struct dect_sfmt_msg_desc *desc,
 						struct dect_msg_common *dst,
 						struct dect_msg_buf *mb);
+extern enum dect_sfmt_error dect_parse_sfmt_msg_lazy(const struct dect_handle *dh,
+						     const struct dect_sfmt_msg_desc *desc,
+						     struct dect_msg_common *dst,
+						     struct dect_msg_buf *mb,
+						     struct dect_sfmt_msg_view *view);
+extern struct dect_ie_common *dect_msg_ie_resolve(const struct dect_handle *dh,
+						  const struct dect_sfmt_msg_desc *desc,
+						  struct dect_msg_common *msg,
+						  struct dect_ie_common **ie);
+
+/**
+ * Resolve an IE member of a lazily parsed message
+ *
+ * @param dh		libdect DECT handle
+ * @param desc		message description
+ * @param msg		message structure
+ * @param member	IE member of the message structure
+ */
+#define dect_msg_ie(dh, desc, msg, member)					\
+	((typeof((msg)->member))						\
+	 dect_msg_ie_resolve(dh, desc, &(msg)->common,				\
+			     (struct dect_ie_common **)&(msg)->member))
+
 extern enum dect_sfmt_error dect_build_sfmt_msg(const struct dect_handle *dh,
 						const struct dect_sfmt_msg_desc *desc,
 						const struct dect_msg_common *src,
@@ -312,4 +568,134 @@ extern void dect_msg_free(const struct dect_handle *dh,
 			  const struct dect_sfmt_msg_desc *desc,
 			  struct dect_msg_common *msg);
 
+extern bool dect_sfmt_peek_ipui(const uint8_t *data, unsigned int len,
+				struct dect_ipui *ipui);
+
+/* Maximum size of the cached IE encodings of a message template */
+#define DECT_SFMT_MSG_TMPL_SIZE		128
+
+/**
+ * struct dect_sfmt_msg_tmpl - prebuilt S-Format message template
+ *
+ * @desc:	message description, NULL if the template is not initialized
+ * @fixed:	bitmap of IE descriptions with a cached encoding
+ * @offset:	offset of the cached encoding of each IE description in @data
+ * @len:	length of the cached encoding of each IE description
+ * @size:	total size of the cached encodings
+ * @data:	cached IE encodings
+ *
+ * A template caches the encodings of the constant IEs of a message, which
+ * are copied into the message buffer instead of being rebuilt on each send.
+ * The encodings depend on the cluster mode of the handle used to build them.
+ */
+struct dect_sfmt_msg_tmpl {
+	const struct dect_sfmt_msg_desc	*desc;
+	uint64_t			fixed;
+	uint8_t				offset[DECT_SFMT_MSG_IE_MAX];
+	uint8_t				len[DECT_SFMT_MSG_IE_MAX];
+	uint8_t				size;
+	uint8_t				data[DECT_SFMT_MSG_TMPL_SIZE];
+};
+
+static inline bool dect_sfmt_msg_tmpl_valid(const struct dect_sfmt_msg_tmpl *tmpl)
+{
+	return tmpl->desc != NULL;
+}
+
+extern enum dect_sfmt_error dect_sfmt_msg_tmpl_init(const struct dect_handle *dh,
+						    struct dect_sfmt_msg_tmpl *tmpl,
+						    const struct dect_sfmt_msg_desc *desc,
+						    const struct dect_msg_common *msg);
+extern enum dect_sfmt_error dect_build_sfmt_msg_tmpl(const struct dect_handle *dh,
+						     const struct dect_sfmt_msg_tmpl *tmpl,
+						     const struct dect_msg_common *src,
+						     struct dect_msg_buf *mb);
+
+/* Helpers for specialized message codecs */
+extern enum dect_sfmt_error dect_sfmt_gen_parse_begin(const struct dect_handle *dh,
+						      const struct dect_sfmt_msg_desc *desc,
+						      struct dect_msg_common *msg,
+						      struct dect_msg_buf *mb,
+						      struct dect_sfmt_ie **ie);
+extern enum dect_sfmt_error dect_sfmt_gen_parse_msg_ie(const struct dect_handle *dh,
+						       struct dect_msg_common *msg,
+						       uint8_t type,
+						       enum dect_sfmt_ie_status status,
+						       struct dect_ie_common **dst,
+						       struct dect_msg_buf *mb,
+						       struct dect_sfmt_ie **ie);
+extern void dect_sfmt_gen_parse_abort(struct dect_msg_common *msg);
+extern void dect_sfmt_gen_build_begin(const struct dect_sfmt_msg_desc *desc);
+extern enum dect_sfmt_error dect_sfmt_gen_build_msg_ie(const struct dect_handle *dh,
+						       uint8_t type,
+						       enum dect_sfmt_ie_status status,
+						       struct dect_msg_buf *mb,
+						       const struct dect_ie_common *ie);
+
+static inline enum dect_sfmt_error
+dect_sfmt_gen_parse_ie(const struct dect_handle *dh, struct dect_msg_common *msg,
+		       uint8_t type, enum dect_sfmt_ie_status status,
+		       uint8_t flags, struct dect_ie_common ***dst,
+		       struct dect_msg_buf *mb, struct dect_sfmt_ie **ie)
+{
+	const struct dect_sfmt_ie *cur = *ie;
+	enum dect_sfmt_error err = DECT_SFMT_OK;
+
+	if (type == DECT_IE_REPEAT_INDICATOR)
+		dect_ie_list_init((struct dect_ie_list *)*dst);
+	else if (!(flags & DECT_SFMT_IE_REPEAT))
+		**dst = NULL;
+
+	if (cur != NULL &&
+	    (cur->id == type ||
+	     (status == DECT_SFMT_IE_OPTIONAL &&
+	      ((type == DECT_IE_SINGLE_DISPLAY && cur->id == DECT_IE_MULTI_DISPLAY) ||
+	       (type == DECT_IE_SINGLE_KEYPAD && cur->id == DECT_IE_MULTI_KEYPAD))))) {
+		if (status == DECT_SFMT_IE_NONE)
+			return -1;
+		err = dect_sfmt_gen_parse_msg_ie(dh, msg, type, status, *dst, mb, ie);
+	} else if (status == DECT_SFMT_IE_MANDATORY)
+		return DECT_SFMT_MANDATORY_IE_MISSING;
+
+	if (type == DECT_IE_REPEAT_INDICATOR)
+		*dst = (void *)*dst + sizeof(struct dect_ie_list);
+	else if (!(flags & DECT_SFMT_IE_REPEAT))
+		*dst += 1;
+	return err;
+}
+
+static inline enum dect_sfmt_error
+dect_sfmt_gen_build_ie(const struct dect_handle *dh, uint8_t type,
+		       enum dect_sfmt_ie_status status, uint8_t flags,
+		       struct dect_ie_common * const **src,
+		       struct dect_ie_list **iel, struct dect_msg_buf *mb)
+{
+	const struct dect_ie_common *ie;
+	enum dect_sfmt_error err = DECT_SFMT_OK;
+
+	if (type == DECT_IE_REPEAT_INDICATOR) {
+		/* Add repeat indicator if more than one element on the list */
+		*iel = (struct dect_ie_list *)*src;
+		if ((*iel)->list != NULL && (*iel)->list->next != NULL)
+			err = dect_sfmt_gen_build_msg_ie(dh, type, status, mb,
+							 &(*iel)->common);
+		*src = (void *)*src + sizeof(struct dect_ie_list);
+	} else if ((flags & DECT_SFMT_IE_REPEAT) && *iel != NULL) {
+		dect_foreach_ie(ie, *iel) {
+			err = dect_sfmt_gen_build_msg_ie(dh, type, status, mb, ie);
+			if (err != DECT_SFMT_OK)
+				break;
+		}
+		*iel = NULL;
+	} else {
+		if (**src != NULL)
+			err = dect_sfmt_gen_build_msg_ie(dh, type, status, mb, **src);
+		else if (status == DECT_SFMT_IE_MANDATORY)
+			err = dect_sfmt_gen_build_msg_ie(dh, type, status, mb, NULL);
+		if (!(flags & DECT_SFMT_IE_REPEAT))
+			*src += 1;
+	}
+	return err;
+}
+
 #endif /* _LIBDECT_S_FMT_H */
@@ -0,0 +1,116 @@
+/*
+ * libdect sharding
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LIBDECT_SHARD_H
+#define _LIBDECT_SHARD_H
+
+#include <pthread.h>
+#include <linux/dect.h>
+#include <dect/shard.h>
+#include <list.h>
+
+/* Size of the message queue of each handle */
+#define DECT_SHARD_QUEUE_SIZE		256
+
+/* Maximum length of a broadcast passed to the primary handle */
+#define DECT_SHARD_BCAST_MAX		16
+
+enum dect_shard_msg_types {
+	DECT_SHARD_MSG_LINK,
+	DECT_SHARD_MSG_PAGE,
+	DECT_SHARD_MSG_BROADCAST,
+};
+
+/**
+ * struct dect_shard_msg - message passed between a primary handle and a shard
+ *
+ * @type:	message type
+ * @link:	accepted data link handed to a shard
+ * @bcast:	page or broadcast passed to the primary handle
+ */
+struct dect_shard_msg {
+	enum dect_shard_msg_types		type;
+	union {
+		struct {
+			int				fd;
+			struct dect_transport		*transport;
+			struct sockaddr_dect_ssap	dlei;
+			struct dect_mac_conn_params	mcp;
+		} link;
+		struct {
+			uint32_t			tpui;
+			bool				long_page;
+			bool				fast_page;
+			uint8_t				len;
+			uint8_t				data[DECT_SHARD_BCAST_MAX];
+		} bcast;
+	};
+};
+
+/**
+ * struct dect_shard_queue - bounded message queue of a handle
+ *
+ * @dfd:	eventfd signalling queued messages
+ * @lock:	lock protecting the ring and @drops
+ * @head:	index of the oldest message
+ * @count:	number of queued messages
+ * @drops:	messages refused because the queue was full
+ * @msgs:	message ring
+ */
+struct dect_shard_queue {
+	struct dect_fd			*dfd;
+	pthread_mutex_t			lock;
+	unsigned int			head;
+	unsigned int			count;
+	uint64_t			drops;
+	struct dect_shard_msg		msgs[DECT_SHARD_QUEUE_SIZE];
+};
+
+/**
+ * struct dect_shard - sharding state of a handle
+ *
+ * @primary:	primary handle of a shard, NULL for the primary handle itself
+ * @nshards:	number of shards of the primary handle
+ * @shards:	shard handles of the primary handle
+ * @pending:	accepted data links waiting for their first message
+ * @stats:	statistics of the primary handle
+ * @queue:	incoming messages
+ */
+struct dect_shard {
+	struct dect_handle		*primary;
+	unsigned int			nshards;
+	struct dect_handle		*shards[DECT_SHARD_MAX];
+	struct list_head		pending;
+	struct dect_shard_stats		stats;
+	struct dect_shard_queue		queue;
+};
+
+/* Primary handle distributing data links to shards */
+static inline bool dect_shard_primary(const struct dect_handle *dh)
+{
+	return dh->shard != NULL && dh->shard->primary == NULL;
+}
+
+/* Shard handle, B-SAP and S-SAP listener are owned by the primary handle */
+static inline bool dect_shard_member(const struct dect_handle *dh)
+{
+	return dh->shard != NULL && dh->shard->primary != NULL;
+}
+
+extern void dect_shard_accept(struct dect_handle *dh, struct dect_fd *dfd,
+			      const struct sockaddr_dect_ssap *dlei,
+			      const struct dect_mac_conn_params *mcp);
+extern int dect_shard_page(const struct dect_handle *dh,
+			   const struct dect_msg_buf *mb,
+			   uint32_t tpui, bool fast_page);
+extern int dect_shard_broadcast(const struct dect_handle *dh,
+				const struct dect_msg_buf *mb,
+				bool long_page, bool fast_page);
+extern void dect_shard_exit(struct dect_handle *dh);
+
+#endif /* _LIBDECT_SHARD_H */
@@ -8,6 +8,7 @@
 #define _LIBDECT_TIMER_H
 
 #include <utils.h>
+#include <list.h>
 #include <dect/timer.h>
 
 struct dect_handle;
@@ -15,6 +16,7 @@ struct dect_handle;
 enum dect_timer_state {
 	DECT_TIMER_STOPPED,
 	DECT_TIMER_RUNNING,
+	DECT_TIMER_CANCELLED,
 };
 
 /**
@@ -23,14 +25,94 @@ enum dect_timer_state {
  * @callback:		callback to invoke on timer expiry
  * @data:		libdect internal data
  * @state:		libdect internal state
+ * @slack:		slack class
+ * @list:		timer wheel slot list node
+ * @expires:		absolute expiry time in milliseconds (CLOCK_MONOTONIC)
+ * @armed:		expiry time the application's event handler was armed for
  * @priv:		libdect user private timer storage
  */
 struct dect_timer {
 	void			(*callback)(struct dect_handle *,
 					    struct dect_timer *);
 	void			*data;
-	enum dect_timer_state	state;
+	enum dect_timer_state	state:8;
+	enum dect_timer_slack_classes slack:8;
+	struct list_head	list;
+	uint64_t		expires;
+	uint64_t		armed;
 	uint8_t			priv[] __aligned(__alignof__(uint64_t));
 };
 
+extern size_t dect_timer_size(const struct dect_handle *dh);
+extern struct dect_timer *dect_timer_embed(const struct dect_handle *dh,
+					   void *storage, unsigned int index,
+					   void (*cb)(struct dect_handle *,
+						      struct dect_timer *),
+					   void *data);
+extern void dect_timer_cancel(const struct dect_handle *dh,
+			      struct dect_timer *timer);
+extern bool dect_timer_pending(const struct dect_timer *timer);
+extern uint64_t dect_timer_now(void);
+
+/* Timer wheel geometry: four levels of 64 slots with 1ms resolution */
+#define DECT_TIMER_WHEEL_BITS		6
+#define DECT_TIMER_WHEEL_SIZE		(1 << DECT_TIMER_WHEEL_BITS)
+#define DECT_TIMER_WHEEL_MASK		(DECT_TIMER_WHEEL_SIZE - 1)
+#define DECT_TIMER_WHEEL_LEVELS		4
+#define DECT_TIMER_WHEEL_MAX		((1ULL << (DECT_TIMER_WHEEL_LEVELS * \
+						   DECT_TIMER_WHEEL_BITS)) - 1)
+
+/**
+ * struct dect_timer_wheel - libdect internal timer wheel
+ *
+ * @clk:	time in milliseconds up to which timers have been run
+ * @count:	number of running timers
+ * @vec:	slot lists, level n covers intervals of 64^n milliseconds
+ *
+ * Used when the application doesn't register dect_event_ops::start_timer().
+ */
+struct dect_timer_wheel {
+	uint64_t		clk;
+	unsigned int		count;
+	struct list_head	vec[DECT_TIMER_WHEEL_LEVELS][DECT_TIMER_WHEEL_SIZE];
+};
+
+extern int dect_timer_wheel_init(struct dect_handle *dh);
+extern void dect_timer_wheel_exit(struct dect_handle *dh);
+
+/**
+ * struct dect_timer_queue - timer queue of the built-in event backends
+ *
+ * @timers:	list of running timers, sorted by expiry time
+ * @tfd:	timerfd armed for the first timer
+ */
+struct dect_timer_queue {
+	struct list_head	timers;
+	int			tfd;
+};
+
+/**
+ * struct dect_timer_queue_entry - timer private data of the built-in event backends
+ *
+ * @list:	timer queue list node
+ * @timer:	timer containing the private data
+ * @expires:	absolute expiry time in nanoseconds (CLOCK_MONOTONIC)
+ */
+struct dect_timer_queue_entry {
+	struct list_head	list;
+	struct dect_timer	*timer;
+	uint64_t		expires;
+};
+
+struct timeval;
+extern int dect_timer_queue_init(struct dect_timer_queue *tq);
+extern void dect_timer_queue_exit(struct dect_timer_queue *tq);
+extern void dect_timer_queue_add(struct dect_timer_queue *tq,
+				 struct dect_timer *timer,
+				 const struct timeval *tv);
+extern void dect_timer_queue_del(struct dect_timer_queue *tq,
+				 struct dect_timer *timer);
+extern void dect_timer_queue_run(struct dect_timer_queue *tq,
+				 struct dect_handle *dh);
+
 #endif /* _LIBDECT_TIMER_H */
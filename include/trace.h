@@ -0,0 +1,82 @@
+/*
+ * libdect static tracepoints
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LIBDECT_TRACE_H
+#define _LIBDECT_TRACE_H
+
+/*
+ * USDT probes of provider "libdect", usable with perf, bpftrace or SystemTap.
+ * Probes compile to a single nop when built with CONFIG_USDT and to nothing
+ * otherwise. Argument evaluation must be free of side effects.
+ *
+ * Each probe has a semaphore counting the attached tracers, so arguments that
+ * are costly to compute, like the IPUI hash, are only computed while tracing.
+ *
+ * lce_rx		ddl, pd, type, tv, ipui hash, length
+ * lce_tx		ddl, pd, type, tv, length, result
+ * lce_broadcast	length, long page, fast page
+ * transaction_open	ddl, pd, tv, role, ipui hash
+ * transaction_close	ddl, pd, tv, role, ipui hash
+ * sfmt_parse		message name, length, result
+ * sfmt_build		message name, length, result
+ * timer_start		timer, timeout in ms
+ * timer_stop		timer
+ * timer_run		timer, callback
+ * uplane_rx		call, length
+ * uplane_tx		call, length, sent bytes
+ */
+
+#ifdef CONFIG_USDT
+#define _SDT_HAS_SEMAPHORES	1
+#include <sys/sdt.h>
+
+#define DECT_TRACE_SEMAPHORE(name) \
+	unsigned short libdect_##name##_semaphore \
+		__attribute__((section(".probes")))
+
+extern unsigned short libdect_lce_rx_semaphore;
+extern unsigned short libdect_lce_tx_semaphore;
+extern unsigned short libdect_lce_broadcast_semaphore;
+extern unsigned short libdect_transaction_open_semaphore;
+extern unsigned short libdect_transaction_close_semaphore;
+extern unsigned short libdect_sfmt_parse_semaphore;
+extern unsigned short libdect_sfmt_build_semaphore;
+extern unsigned short libdect_timer_start_semaphore;
+extern unsigned short libdect_timer_stop_semaphore;
+extern unsigned short libdect_timer_run_semaphore;
+extern unsigned short libdect_uplane_rx_semaphore;
+extern unsigned short libdect_uplane_tx_semaphore;
+
+#define dect_trace_enabled(name) \
+	__builtin_expect(libdect_##name##_semaphore != 0, 0)
+
+#define dect_trace1(name, a1) \
+	DTRACE_PROBE1(libdect, name, a1)
+#define dect_trace2(name, a1, a2) \
+	DTRACE_PROBE2(libdect, name, a1, a2)
+#define dect_trace3(name, a1, a2, a3) \
+	DTRACE_PROBE3(libdect, name, a1, a2, a3)
+#define dect_trace5(name, a1, a2, a3, a4, a5) \
+	DTRACE_PROBE5(libdect, name, a1, a2, a3, a4, a5)
+#define dect_trace6(name, a1, a2, a3, a4, a5, a6) \
+	DTRACE_PROBE6(libdect, name, a1, a2, a3, a4, a5, a6)
+#else
+#define dect_trace1(name, a1)				do { } while (0)
+#define dect_trace2(name, a1, a2)			do { } while (0)
+#define dect_trace3(name, a1, a2, a3)			do { } while (0)
+#define dect_trace5(name, a1, a2, a3, a4, a5)		do { } while (0)
+#define dect_trace6(name, a1, a2, a3, a4, a5, a6)	do { } while (0)
+
+#define dect_trace_enabled(name)			0
+#endif
+
+/* 32 bit IPUI hash identifying the portable across probes */
+#define dect_trace_ipui(name, ddl) \
+	(dect_trace_enabled(name) ? dect_ipui_hash(&(ddl)->ipui, 32) : 0)
+
+#endif /* _LIBDECT_TRACE_H */
@@ -4,6 +4,7 @@
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <dect/mem.h>
 
 #ifndef AF_DECT
 #define AF_DECT 40
@@ -25,9 +26,19 @@
 #define __visible		__attribute__((visibility("default")))
 
 struct dect_handle;
+extern void *dect_malloc_type(const struct dect_handle *dh,
+			      enum dect_mem_types type, size_t size);
+extern void *dect_zalloc_type(const struct dect_handle *dh,
+			      enum dect_mem_types type, size_t size);
 extern void *dect_malloc(const struct dect_handle *dh, size_t size);
 extern void *dect_zalloc(const struct dect_handle *dh, size_t size);
 extern void dect_free(const struct dect_handle *dh, void *ptr);
+extern void *dect_cache_alloc(const struct dect_handle *dh,
+			      enum dect_mem_types type, size_t size);
+extern void dect_cache_free(const struct dect_handle *dh, void *ptr);
+
+/* Default maximum number of cached objects per memory type */
+#define DECT_MEM_CACHE_MAX	16
 #define EXPORT_SYMBOL(x)	typeof(x) (x) __visible
 #define BUG()			assert(0)
 
@@ -42,6 +53,7 @@ extern void dect_free(const struct dect_handle *dh, void *ptr);
 #define field_sizeof(t, f)	(sizeof(((t *)NULL)->f))
 
 #define div_round_up(n, d)	(((n) + (d) - 1) / (d))
+#define align(x, a)		(((x) + (a) - 1) & ~((typeof(x))(a) - 1))
 
 #define min(x, y) ({				\
 	typeof(x) _min1 = (x);			\
@@ -55,36 +67,51 @@ extern void dect_free(const struct dect_handle *dh, void *ptr);
 	(void) (&_max1 == &_max2);		\
 	_max1 > _max2 ? _max1 : _max2; })
 
+/* Multiplicative hash of a 64 bit value, returning the upper @bits bits */
+static inline uint32_t hash_64(uint64_t val, unsigned int bits)
+{
+	return (val * 0x9e3779b97f4a7c15ULL) >> (64 - bits);
+}
+
 static inline unsigned int fls(uint64_t v)
 {
-	unsigned int len = 0;
+	return v ? 64 - __builtin_clzll(v) : 0;
+}
 
-	while (v) {
-		v >>= 1;
-		len++;
+/*
+ * Singly linked queues with a tail pointer, allowing O(1) appends.
+ * A queue must not be copied while it is empty since the tail then
+ * points to its own head.
+ */
+#define PTRQUEUE_HEAD(type)				\
+	struct {					\
+		type	*head;				\
+		type	**tail;				\
 	}
-	return len;
-}
 
-#define ptrlist_init(head)				\
+#define ptrqueue_init(queue)				\
 	do {						\
-		*(head) = NULL;				\
+		(queue)->head = NULL;			\
+		(queue)->tail = &(queue)->head;		\
 	} while (0)
 
-#define ptrlist_add_tail(new, head)			\
+#define ptrqueue_empty(queue)	((queue)->head == NULL)
+
+#define ptrqueue_add_tail(new, queue)			\
 	do {						\
-		typeof(new) *pprev;			\
-		pprev = (head);				\
-		while (*pprev != NULL)			\
-			pprev = &(*pprev)->next;	\
-		*pprev = new;				\
+		(new)->next = NULL;			\
+		*(queue)->tail = (new);			\
+		(queue)->tail = &(new)->next;		\
 	} while (0)
 
-#define ptrlist_dequeue_head(head)			\
+#define ptrqueue_dequeue_head(queue)			\
 	({						\
-		typeof(*head) elem = *(head);		\
-		if (elem != NULL)			\
-			*(head) = elem->next;		\
+		typeof((queue)->head) elem = (queue)->head; \
+		if (elem != NULL) {			\
+			(queue)->head = elem->next;	\
+			if ((queue)->head == NULL)	\
+				(queue)->tail = &(queue)->head; \
+		}					\
 		elem;					\
 	})
 
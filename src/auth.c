@@ -26,6 +26,9 @@
 #include <libdect.h>
 #include <utils.h>
 
+#define auth_debug(fmt, args...) \
+	dect_debug(DECT_DEBUG_MM, "AUTH: " fmt, ## args)
+
 /**
  * Convert PIN to authentication code
  *
@@ -197,7 +200,61 @@ void dect_auth_a22(const uint8_t *ks, uint64_t rand_p, uint32_t *res2)
 }
 EXPORT_SYMBOL(dect_auth_a22);
 
-/** @} */
+/**
+ * A11 and A12 processes for multiple authentication tuples
+ *
+ * @param tuples	authentication tuples
+ * @param n		number of tuples
+ *
+ * Derive KS from K and RS and DCK and RES1 from KS and RAND for each tuple.
+ * The A11 process is only performed once for consecutive tuples using the
+ * same K and RS.
+ */
+void dect_auth_a1_batch(struct dect_auth_tuple *tuples, unsigned int n)
+{
+	struct dect_auth_tuple *t, *prev = NULL;
+	unsigned int i;
+
+	for (i = 0; i < n; i++) {
+		t = &tuples[i];
+		if (prev != NULL && prev->rs == t->rs &&
+		    !memcmp(prev->k, t->k, sizeof(t->k)))
+			memcpy(t->ks, prev->ks, sizeof(t->ks));
+		else
+			dect_auth_a11(t->k, t->rs, t->ks);
+		dect_auth_a12(t->ks, t->rand, t->dck, &t->res);
+		prev = t;
+	}
+}
+EXPORT_SYMBOL(dect_auth_a1_batch);
+
+/**
+ * A21 and A22 processes for multiple authentication tuples
+ *
+ * @param tuples	authentication tuples
+ * @param n		number of tuples
+ *
+ * Derive KS' from K and RS and RES2 from KS' and RAND for each tuple. The
+ * A21 process is only performed once for consecutive tuples using the same
+ * K and RS.
+ */
+void dect_auth_a2_batch(struct dect_auth_tuple *tuples, unsigned int n)
+{
+	struct dect_auth_tuple *t, *prev = NULL;
+	unsigned int i;
+
+	for (i = 0; i < n; i++) {
+		t = &tuples[i];
+		if (prev != NULL && prev->rs == t->rs &&
+		    !memcmp(prev->k, t->k, sizeof(t->k)))
+			memcpy(t->ks, prev->ks, sizeof(t->ks));
+		else
+			dect_auth_a21(t->k, t->rs, t->ks);
+		dect_auth_a22(t->ks, t->rand, &t->res);
+		prev = t;
+	}
+}
+EXPORT_SYMBOL(dect_auth_a2_batch);
 
 /*
  * DSAA/DSC key allocation test from ETS EN 300 175-7 Annex K
@@ -214,7 +271,16 @@ EXPORT_SYMBOL(dect_auth_a22);
 #define DECT_AUTH_TEST_RES3		0x961b3a9f
 #define DECT_AUTH_TEST_DCK		0x8560dc324ea49f37ULL
 
-static void __init dect_auth_test(void)
+/**
+ * Verify the DSAA implementation using the test vectors of EN 300 175-7
+ *
+ * Calculates the authentication of the FT and the PT and the key allocation
+ * of the test vectors of Annex K. The test is not run automatically, it may
+ * be invoked by an application on startup.
+ *
+ * @return 0 if all results match the test vectors or -1 otherwise.
+ */
+int dect_auth_selftest(void)
 {
 	uint8_t k[DECT_AUTH_KEY_LEN];
 	uint8_t ks[DECT_AUTH_KEY_LEN], ks_[DECT_AUTH_KEY_LEN];
@@ -224,6 +290,7 @@ static void __init dect_auth_test(void)
 	} dck;
 	uint32_t res1, res2;
 	uint8_t ac[4];
+	int err = 0;
 
 	/* Authentication code "9124" */
 	dect_pin_to_ac("9124", ac, sizeof(ac));
@@ -233,23 +300,35 @@ static void __init dect_auth_test(void)
 	dect_auth_a11(k, DECT_AUTH_TEST_RS1, ks);
 	dect_auth_a12(ks, DECT_AUTH_TEST_RAND1, dck.key, &res1);
 
-	if (__be32_to_cpu(res1) != DECT_AUTH_TEST_RES1)
-		printf("dect_auth_test: fail1 res1=%.8x\n", res1);
+	if (__be32_to_cpu(res1) != DECT_AUTH_TEST_RES1) {
+		auth_debug("selftest: fail1 res1=%.8x\n", res1);
+		err = -1;
+	}
 
 	/* PT auth request + UAK allocation (UAK = KS') */
 	dect_auth_a21(k, DECT_AUTH_TEST_RS1, ks_);
 	dect_auth_a22(ks_, DECT_AUTH_TEST_RAND2, &res2);
 
-	if (__cpu_to_be32(res2) != DECT_AUTH_TEST_RES2)
-		printf("dect_auth_test: fail2 res2=%.8x\n", res2);
+	if (__cpu_to_be32(res2) != DECT_AUTH_TEST_RES2) {
+		auth_debug("selftest: fail2 res2=%.8x\n", res2);
+		err = -1;
+	}
 
 	/* DCK allocation using UAK */
 	dect_auth_a11(ks_, DECT_AUTH_TEST_RS2, ks_);
 	dect_auth_a12(ks_, DECT_AUTH_TEST_RAND3, dck.key, &res1);
 
-	if (__cpu_to_be32(res1) != DECT_AUTH_TEST_RES3)
-		printf("dect_auth_test: fail3 res1=%.8x\n", res1);
-	if (__cpu_to_be64(dck.val) != DECT_AUTH_TEST_DCK)
-		printf("dect_auth_test: fail4 dck=%.16" PRIx64 "\n",
-		       (uint64_t)__cpu_to_be64(dck.val));
+	if (__cpu_to_be32(res1) != DECT_AUTH_TEST_RES3) {
+		auth_debug("selftest: fail3 res1=%.8x\n", res1);
+		err = -1;
+	}
+	if (__cpu_to_be64(dck.val) != DECT_AUTH_TEST_DCK) {
+		auth_debug("selftest: fail4 dck=%.16" PRIx64 "\n",
+			   (uint64_t)__cpu_to_be64(dck.val));
+		err = -1;
+	}
+	return err;
 }
+EXPORT_SYMBOL(dect_auth_selftest);
+
+/** @} */
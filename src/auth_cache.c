@@ -0,0 +1,321 @@
+/*
+ * libdect session authentication key cache
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @addtogroup security
+ * @{
+ *
+ * @defgroup auth_cache Session key cache
+ *
+ * Cache of session authentication keys derived by the A11 and A21 processes.
+ *
+ * The session keys KS and KS' only depend on the authentication key K and
+ * the random seed RS, which usually remains unchanged across authentications
+ * of a subscriber. When a cache has been enabled using
+ * dect_auth_ks_cache_init(), dect_auth_a11_cached() and
+ * dect_auth_a21_cached() return previously derived keys for an IPUI if both
+ * K and RS match and only perform the DSAA calculation otherwise.
+ *
+ * The cache is bounded, the least recently used entry is replaced when it is
+ * full. Entries are invalidated automatically on reception of a
+ * {MM-KEY-ALLOCATE} message and can be invalidated by the application using
+ * dect_auth_ks_cache_invalidate(), for instance when the UAK changes.
+ *
+ * @{
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <libdect.h>
+#include <dect/auth.h>
+#include <identities.h>
+#include <utils.h>
+
+#define DECT_AUTH_KS_HASH_BITS	8
+#define DECT_AUTH_KS_HASH_SIZE	(1 << DECT_AUTH_KS_HASH_BITS)
+
+enum dect_auth_ks_flags {
+	DECT_AUTH_KS_VALID	= 0x1,
+	DECT_AUTH_KS2_VALID	= 0x2,
+};
+
+/**
+ * struct dect_auth_ks_entry - session key cache entry
+ *
+ * @list:	LRU list node
+ * @hnode:	IPUI hash node
+ * @ipui:	IPUI of the subscriber
+ * @k:		authentication key K
+ * @rs:		random seed RS
+ * @flags:	valid keys (#dect_auth_ks_flags)
+ * @ks:		session authentication key KS
+ * @ks2:	session authentication key KS'
+ */
+struct dect_auth_ks_entry {
+	struct list_head		list;
+	struct hlist_node		hnode;
+	struct dect_ipui		ipui;
+	uint8_t				k[DECT_AUTH_KEY_LEN];
+	uint64_t			rs;
+	unsigned int			flags;
+	uint8_t				ks[DECT_AUTH_KEY_LEN];
+	uint8_t				ks2[DECT_AUTH_KEY_LEN];
+};
+
+/**
+ * struct dect_auth_ks_cache - session key cache
+ *
+ * @lru:	entries in least recently used order, unused entries first
+ * @hash:	IPUI hash of used entries
+ * @stats:	cache statistics
+ * @entries:	cache entries
+ */
+struct dect_auth_ks_cache {
+	struct list_head		lru;
+	struct hlist_head		hash[DECT_AUTH_KS_HASH_SIZE];
+	struct dect_auth_ks_cache_stats	stats;
+	struct dect_auth_ks_entry	entries[];
+};
+
+static struct dect_auth_ks_entry *
+dect_auth_ks_lookup(const struct dect_auth_ks_cache *cache,
+		    const struct dect_ipui *ipui)
+{
+	struct dect_auth_ks_entry *e;
+	struct hlist_node *pos;
+
+	hlist_for_each_entry(e, pos, &cache->hash[dect_ipui_hash(ipui,
+						DECT_AUTH_KS_HASH_BITS)], hnode) {
+		if (!dect_ipui_cmp(&e->ipui, ipui))
+			return e;
+	}
+	return NULL;
+}
+
+static void dect_auth_ks_entry_release(struct dect_auth_ks_cache *cache,
+				       struct dect_auth_ks_entry *e)
+{
+	hlist_del_init(&e->hnode);
+	memset(e->k, 0, sizeof(e->k));
+	memset(e->ks, 0, sizeof(e->ks));
+	memset(e->ks2, 0, sizeof(e->ks2));
+	e->flags = 0;
+	list_move(&e->list, &cache->lru);
+	cache->stats.entries--;
+}
+
+static struct dect_auth_ks_entry *
+dect_auth_ks_get(struct dect_auth_ks_cache *cache, const struct dect_ipui *ipui,
+		 const uint8_t *k, uint64_t rs)
+{
+	struct dect_auth_ks_entry *e;
+
+	e = dect_auth_ks_lookup(cache, ipui);
+	if (e == NULL) {
+		e = list_first_entry(&cache->lru, struct dect_auth_ks_entry, list);
+		if (!hlist_unhashed(&e->hnode)) {
+			dect_auth_ks_entry_release(cache, e);
+			cache->stats.evictions++;
+		}
+		e->ipui = *ipui;
+		hlist_add_head(&e->hnode, &cache->hash[dect_ipui_hash(ipui,
+						DECT_AUTH_KS_HASH_BITS)]);
+		cache->stats.entries++;
+	} else if (e->rs != rs || memcmp(e->k, k, sizeof(e->k)))
+		e->flags = 0;
+
+	memcpy(e->k, k, sizeof(e->k));
+	e->rs = rs;
+	list_move_tail(&e->list, &cache->lru);
+	return e;
+}
+
+/**
+ * Enable the session key cache
+ *
+ * @param dh		libdect DECT handle
+ * @param size		maximum number of cached subscribers
+ *
+ * @return 0 on success or -1 on error.
+ */
+int dect_auth_ks_cache_init(struct dect_handle *dh, unsigned int size)
+{
+	struct dect_auth_ks_cache *cache;
+	unsigned int i;
+
+	if (dh->ks_cache != NULL || size == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	cache = dect_zalloc(dh, sizeof(*cache) + size * sizeof(cache->entries[0]));
+	if (cache == NULL)
+		return -1;
+
+	init_list_head(&cache->lru);
+	for (i = 0; i < size; i++)
+		list_add_tail(&cache->entries[i].list, &cache->lru);
+	cache->stats.size = size;
+
+	dh->ks_cache = cache;
+	return 0;
+}
+EXPORT_SYMBOL(dect_auth_ks_cache_init);
+
+/**
+ * Disable the session key cache and release all entries
+ *
+ * @param dh		libdect DECT handle
+ */
+void dect_auth_ks_cache_exit(struct dect_handle *dh)
+{
+	struct dect_auth_ks_cache *cache = dh->ks_cache;
+
+	if (cache == NULL)
+		return;
+
+	memset(cache->entries, 0, cache->stats.size * sizeof(cache->entries[0]));
+	dect_free(dh, cache);
+	dh->ks_cache = NULL;
+}
+EXPORT_SYMBOL(dect_auth_ks_cache_exit);
+
+/**
+ * A11 process using the session key cache
+ *
+ * @param dh		libdect DECT handle
+ * @param ipui		IPUI of the subscriber
+ * @param k		authentication key K
+ * @param rs		random seed
+ * @param ks		buffer to store session authentication key of size #DECT_AUTH_KEY_LEN
+ *
+ * Equivalent to dect_auth_a11(), but returns a cached KS for the IPUI if
+ * K and RS are unchanged.
+ */
+void dect_auth_a11_cached(struct dect_handle *dh, const struct dect_ipui *ipui,
+			  const uint8_t *k, uint64_t rs, uint8_t *ks)
+{
+	struct dect_auth_ks_cache *cache = dh->ks_cache;
+	struct dect_auth_ks_entry *e;
+
+	if (cache == NULL) {
+		dect_auth_a11(k, rs, ks);
+		return;
+	}
+
+	e = dect_auth_ks_get(cache, ipui, k, rs);
+	if (e->flags & DECT_AUTH_KS_VALID)
+		cache->stats.hits++;
+	else {
+		cache->stats.misses++;
+		dect_auth_a11(k, rs, e->ks);
+		e->flags |= DECT_AUTH_KS_VALID;
+	}
+	memcpy(ks, e->ks, sizeof(e->ks));
+}
+EXPORT_SYMBOL(dect_auth_a11_cached);
+
+/**
+ * A21 process using the session key cache
+ *
+ * @param dh		libdect DECT handle
+ * @param ipui		IPUI of the subscriber
+ * @param k		authentication key K
+ * @param rs		random seed
+ * @param ks		buffer to store session authentication key of size #DECT_AUTH_KEY_LEN
+ *
+ * Equivalent to dect_auth_a21(), but returns a cached KS' for the IPUI if
+ * K and RS are unchanged.
+ */
+void dect_auth_a21_cached(struct dect_handle *dh, const struct dect_ipui *ipui,
+			  const uint8_t *k, uint64_t rs, uint8_t *ks)
+{
+	struct dect_auth_ks_cache *cache = dh->ks_cache;
+	struct dect_auth_ks_entry *e;
+	unsigned int i;
+
+	if (cache == NULL) {
+		dect_auth_a21(k, rs, ks);
+		return;
+	}
+
+	e = dect_auth_ks_get(cache, ipui, k, rs);
+	if (e->flags & DECT_AUTH_KS2_VALID)
+		cache->stats.hits++;
+	else if (e->flags & DECT_AUTH_KS_VALID) {
+		/* A21 derives KS' by XORing KS with 0xaa */
+		cache->stats.hits++;
+		for (i = 0; i < DECT_AUTH_KEY_LEN; i++)
+			e->ks2[i] = e->ks[i] ^ 0xaa;
+		e->flags |= DECT_AUTH_KS2_VALID;
+	} else {
+		cache->stats.misses++;
+		dect_auth_a21(k, rs, e->ks2);
+		e->flags |= DECT_AUTH_KS2_VALID;
+	}
+	memcpy(ks, e->ks2, sizeof(e->ks2));
+}
+EXPORT_SYMBOL(dect_auth_a21_cached);
+
+/**
+ * Invalidate cached session keys
+ *
+ * @param dh		libdect DECT handle
+ * @param ipui		IPUI of the subscriber or NULL to invalidate all entries
+ */
+void dect_auth_ks_cache_invalidate(struct dect_handle *dh,
+				   const struct dect_ipui *ipui)
+{
+	struct dect_auth_ks_cache *cache = dh->ks_cache;
+	struct dect_auth_ks_entry *e, *next;
+
+	if (cache == NULL)
+		return;
+
+	if (ipui != NULL) {
+		e = dect_auth_ks_lookup(cache, ipui);
+		if (e == NULL)
+			return;
+		dect_auth_ks_entry_release(cache, e);
+		cache->stats.invalidations++;
+		return;
+	}
+
+	list_for_each_entry_safe(e, next, &cache->lru, list) {
+		if (hlist_unhashed(&e->hnode))
+			continue;
+		dect_auth_ks_entry_release(cache, e);
+		cache->stats.invalidations++;
+	}
+}
+EXPORT_SYMBOL(dect_auth_ks_cache_invalidate);
+
+/**
+ * Get session key cache statistics
+ *
+ * @param dh		libdect DECT handle
+ * @param stats		cache statistics
+ *
+ * @return 0 on success or -1 if the cache is not enabled.
+ */
+int dect_auth_ks_cache_get_stats(const struct dect_handle *dh,
+				 struct dect_auth_ks_cache_stats *stats)
+{
+	if (dh->ks_cache == NULL) {
+		errno = ENOENT;
+		return -1;
+	}
+	*stats = dh->ks_cache->stats;
+	return 0;
+}
+EXPORT_SYMBOL(dect_auth_ks_cache_get_stats);
+
+/** @} */
+/** @} */
@@ -0,0 +1,330 @@
+/*
+ * libdect authentication offload
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @addtogroup security
+ * @{
+ *
+ * @defgroup auth_offload Authentication offload
+ *
+ * Calculation of authentication processes by worker threads.
+ *
+ * Authentication requests submitted using dect_auth_submit() are queued to
+ * a pool of worker threads started by dect_auth_offload_init(), which
+ * perform the A11/A12 or A21/A22 processes in batches. Completed requests
+ * are handed back to the thread running the event loop through an eventfd
+ * registered with the handle's event ops, where the completion callbacks are
+ * invoked. Without offload, requests are completed synchronously.
+ *
+ * The worker threads only access the authentication tuples of the requests,
+ * all libdect state is accessed from the event loop.
+ *
+ * @{
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include <libdect.h>
+#include <dect/auth.h>
+#include <utils.h>
+#include <io.h>
+
+/* Maximum number of outstanding requests */
+#define DECT_AUTH_OFFLOAD_QUEUE		4096
+
+/* Maximum number of requests processed by a worker at once */
+#define DECT_AUTH_OFFLOAD_BATCH		32
+
+/* Maximum number of worker threads */
+#define DECT_AUTH_OFFLOAD_THREADS	64
+
+struct dect_auth_ring {
+	unsigned int			head;
+	unsigned int			count;
+	struct dect_auth_request	*reqs[DECT_AUTH_OFFLOAD_QUEUE];
+};
+
+/**
+ * struct dect_auth_offload - authentication offload state
+ *
+ * @dfd:	eventfd signalling completed requests
+ * @lock:	lock protecting the rings and @stop
+ * @cond:	condition signalled when requests are queued or on stop
+ * @stop:	workers should exit once @pending is empty
+ * @outstanding: number of submitted but not completed requests
+ * @nthreads:	number of worker threads
+ * @threads:	worker threads
+ * @pending:	requests waiting for a worker
+ * @done:	completed requests waiting for the event loop
+ */
+struct dect_auth_offload {
+	struct dect_fd			*dfd;
+	pthread_mutex_t			lock;
+	pthread_cond_t			cond;
+	bool				stop;
+	unsigned int			outstanding;
+	unsigned int			nthreads;
+	pthread_t			threads[DECT_AUTH_OFFLOAD_THREADS];
+	struct dect_auth_ring		pending;
+	struct dect_auth_ring		done;
+};
+
+static void dect_auth_ring_add(struct dect_auth_ring *ring,
+			       struct dect_auth_request *req)
+{
+	ring->reqs[(ring->head + ring->count++) % DECT_AUTH_OFFLOAD_QUEUE] = req;
+}
+
+static unsigned int dect_auth_ring_get(struct dect_auth_ring *ring,
+				       struct dect_auth_request **reqs,
+				       unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n && ring->count > 0; i++) {
+		reqs[i] = ring->reqs[ring->head];
+		ring->head = (ring->head + 1) % DECT_AUTH_OFFLOAD_QUEUE;
+		ring->count--;
+	}
+	return i;
+}
+
+static void dect_auth_process(struct dect_auth_request *req)
+{
+	switch (req->proc) {
+	case DECT_AUTH_PROC_A1:
+		dect_auth_a1_batch(&req->tuple, 1);
+		break;
+	case DECT_AUTH_PROC_A2:
+		dect_auth_a2_batch(&req->tuple, 1);
+		break;
+	}
+}
+
+static void dect_auth_offload_notify(struct dect_auth_offload *ao)
+{
+	const uint64_t one = 1;
+	ssize_t ret;
+
+	/* Only fails if the counter would overflow, which can't happen */
+	ret = write(ao->dfd->fd, &one, sizeof(one));
+	(void)ret;
+}
+
+static void *dect_auth_worker(void *arg)
+{
+	struct dect_auth_offload *ao = arg;
+	struct dect_auth_request *reqs[DECT_AUTH_OFFLOAD_BATCH];
+	unsigned int i, n;
+	bool notify;
+
+	pthread_mutex_lock(&ao->lock);
+	while (1) {
+		while (ao->pending.count == 0 && !ao->stop)
+			pthread_cond_wait(&ao->cond, &ao->lock);
+		n = dect_auth_ring_get(&ao->pending, reqs, array_size(reqs));
+		if (n == 0)
+			break;
+		pthread_mutex_unlock(&ao->lock);
+
+		for (i = 0; i < n; i++)
+			dect_auth_process(reqs[i]);
+
+		pthread_mutex_lock(&ao->lock);
+		notify = ao->done.count == 0;
+		for (i = 0; i < n; i++)
+			dect_auth_ring_add(&ao->done, reqs[i]);
+		if (notify)
+			dect_auth_offload_notify(ao);
+	}
+	pthread_mutex_unlock(&ao->lock);
+	return NULL;
+}
+
+/* Invoke the completion callbacks of all completed requests */
+static void dect_auth_offload_complete(struct dect_handle *dh,
+				       struct dect_auth_offload *ao)
+{
+	struct dect_auth_request *reqs[DECT_AUTH_OFFLOAD_BATCH];
+	unsigned int i, n;
+
+	do {
+		pthread_mutex_lock(&ao->lock);
+		n = dect_auth_ring_get(&ao->done, reqs, array_size(reqs));
+		ao->outstanding -= n;
+		pthread_mutex_unlock(&ao->lock);
+
+		for (i = 0; i < n; i++)
+			reqs[i]->complete(dh, reqs[i]);
+	} while (n > 0);
+}
+
+static void dect_auth_offload_event(struct dect_handle *dh,
+				    struct dect_fd *dfd, uint32_t events)
+{
+	uint64_t val;
+
+	if (read(dfd->fd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+		return;
+	dect_auth_offload_complete(dh, dfd->data);
+}
+
+static void dect_auth_offload_stop(struct dect_auth_offload *ao)
+{
+	unsigned int i;
+
+	pthread_mutex_lock(&ao->lock);
+	ao->stop = true;
+	pthread_cond_broadcast(&ao->cond);
+	pthread_mutex_unlock(&ao->lock);
+
+	for (i = 0; i < ao->nthreads; i++)
+		pthread_join(ao->threads[i], NULL);
+}
+
+/**
+ * Start authentication offload
+ *
+ * @param dh		libdect DECT handle
+ * @param threads	number of worker threads
+ *
+ * @return 0 on success or -1 on error.
+ */
+int dect_auth_offload_init(struct dect_handle *dh, unsigned int threads)
+{
+	struct dect_auth_offload *ao;
+
+	if (dh->auth_offload != NULL || threads == 0 ||
+	    threads > DECT_AUTH_OFFLOAD_THREADS) {
+		errno = EINVAL;
+		goto err1;
+	}
+
+	ao = dect_zalloc(dh, sizeof(*ao));
+	if (ao == NULL)
+		goto err1;
+	pthread_mutex_init(&ao->lock, NULL);
+	pthread_cond_init(&ao->cond, NULL);
+
+	ao->dfd = dect_fd_alloc(dh);
+	if (ao->dfd == NULL)
+		goto err2;
+	ao->dfd->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (ao->dfd->fd < 0)
+		goto err3;
+	dect_fd_setup(ao->dfd, dect_auth_offload_event, ao);
+	if (dect_fd_register(dh, ao->dfd, DECT_FD_READ) < 0)
+		goto err3;
+
+	for (ao->nthreads = 0; ao->nthreads < threads; ao->nthreads++) {
+		errno = pthread_create(&ao->threads[ao->nthreads], NULL,
+				       dect_auth_worker, ao);
+		if (errno != 0)
+			goto err4;
+	}
+
+	dh->auth_offload = ao;
+	return 0;
+
+err4:
+	dect_auth_offload_stop(ao);
+	dect_fd_unregister(dh, ao->dfd);
+err3:
+	dect_close(dh, ao->dfd);
+err2:
+	pthread_cond_destroy(&ao->cond);
+	pthread_mutex_destroy(&ao->lock);
+	dect_free(dh, ao);
+err1:
+	return -1;
+}
+EXPORT_SYMBOL(dect_auth_offload_init);
+
+/**
+ * Stop authentication offload
+ *
+ * @param dh		libdect DECT handle
+ *
+ * Wait for the workers to finish all queued requests and stop them. The
+ * completion callbacks of the finished requests are invoked before this
+ * function returns.
+ */
+void dect_auth_offload_exit(struct dect_handle *dh)
+{
+	struct dect_auth_offload *ao = dh->auth_offload;
+
+	if (ao == NULL)
+		return;
+
+	dect_auth_offload_stop(ao);
+	dh->auth_offload = NULL;
+	dect_auth_offload_complete(dh, ao);
+
+	dect_fd_unregister(dh, ao->dfd);
+	dect_close(dh, ao->dfd);
+	pthread_cond_destroy(&ao->cond);
+	pthread_mutex_destroy(&ao->lock);
+	dect_free(dh, ao);
+}
+EXPORT_SYMBOL(dect_auth_offload_exit);
+
+/**
+ * Submit authentication requests
+ *
+ * @param dh		libdect DECT handle
+ * @param reqs		authentication requests
+ * @param n		number of requests
+ *
+ * Perform the authentication processes of the requests and invoke their
+ * completion callbacks. With offload enabled, the processes are performed
+ * by the worker threads and the callbacks are invoked asynchronously from
+ * the event loop, otherwise they are invoked before this function returns.
+ * The requests must remain valid until completion.
+ *
+ * @return 0 on success or -1 if the offload queue is full, in which case
+ * none of the requests was submitted.
+ */
+int dect_auth_submit(struct dect_handle *dh, struct dect_auth_request *reqs[],
+		     unsigned int n)
+{
+	struct dect_auth_offload *ao = dh->auth_offload;
+	unsigned int i;
+
+	if (ao == NULL) {
+		for (i = 0; i < n; i++) {
+			dect_auth_process(reqs[i]);
+			reqs[i]->complete(dh, reqs[i]);
+		}
+		return 0;
+	}
+
+	pthread_mutex_lock(&ao->lock);
+	if (ao->outstanding + n > DECT_AUTH_OFFLOAD_QUEUE) {
+		pthread_mutex_unlock(&ao->lock);
+		errno = EAGAIN;
+		return -1;
+	}
+	for (i = 0; i < n; i++)
+		dect_auth_ring_add(&ao->pending, reqs[i]);
+	ao->outstanding += n;
+	if (n > 1)
+		pthread_cond_broadcast(&ao->cond);
+	else
+		pthread_cond_signal(&ao->cond);
+	pthread_mutex_unlock(&ao->lock);
+	return 0;
+}
+EXPORT_SYMBOL(dect_auth_submit);
+
+/** @} */
+/** @} */
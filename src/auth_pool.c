@@ -0,0 +1,276 @@
+/*
+ * libdect precomputed authentication challenges
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @addtogroup security
+ * @{
+ *
+ * @defgroup auth_pool Authentication challenge pool
+ *
+ * Precomputed challenges for FP initiated authentication.
+ *
+ * A challenge pool holds authentication tuples for a single subscriber,
+ * each consisting of a random RAND_F and RS together with the expected
+ * RES1 and the derived cipher key DCK. When the number of tuples falls
+ * below the low watermark, the pool is refilled up to the high watermark
+ * from a libdect timer in small steps, so the DSAA calculations are spread
+ * over otherwise idle event loop iterations instead of being performed on
+ * the critical path of call setup.
+ *
+ * The application takes a tuple using dect_auth_pool_get() before invoking
+ * dect_mm_authenticate_req() with RAND_F and RS of the tuple, and compares
+ * the RES1 received in the MM_AUTHENTICATE-cfm primitive with the tuple's
+ * RES1. The DCK can then be used to enable ciphering.
+ *
+ * @{
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/random.h>
+
+#include <libdect.h>
+#include <dect/auth.h>
+#include <utils.h>
+#include <timer.h>
+
+/* Maximum pool depth */
+#define DECT_AUTH_POOL_MAX_DEPTH	1024
+
+/* Number of tuples calculated per refill step */
+#define DECT_AUTH_POOL_REFILL_STEP	8
+
+/**
+ * struct dect_auth_pool - authentication challenge pool
+ *
+ * @cfg:	pool configuration
+ * @k:		authentication key K
+ * @timer:	refill timer
+ * @head:	index of the oldest tuple
+ * @count:	number of tuples in the pool
+ * @stats:	pool statistics
+ * @tuples:	ring of precomputed tuples
+ */
+struct dect_auth_pool {
+	struct dect_auth_pool_cfg	cfg;
+	uint8_t				k[DECT_AUTH_KEY_LEN];
+	struct dect_timer		*timer;
+	unsigned int			head;
+	unsigned int			count;
+	struct dect_auth_pool_stats	stats;
+	struct dect_auth_tuple		tuples[];
+};
+
+static int dect_auth_pool_random(struct dect_auth_pool *pool,
+				 struct dect_auth_tuple *tuples, unsigned int n)
+{
+	uint64_t val[2 * DECT_AUTH_POOL_REFILL_STEP];
+	size_t len = n * 2 * sizeof(val[0]);
+	uint8_t *p = (uint8_t *)val;
+	unsigned int i;
+	ssize_t ret;
+
+	while (len > 0) {
+		ret = getrandom(p, len, 0);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		p   += ret;
+		len -= ret;
+	}
+
+	for (i = 0; i < n; i++) {
+		memcpy(tuples[i].k, pool->k, sizeof(tuples[i].k));
+		tuples[i].rand = val[2 * i];
+		if (pool->cfg.flags & DECT_AUTH_POOL_RANDOM_RS)
+			tuples[i].rs = val[2 * i + 1];
+		else
+			tuples[i].rs = pool->cfg.rs;
+	}
+	return 0;
+}
+
+/* Calculate up to @n tuples at the tail of the ring */
+static unsigned int dect_auth_pool_fill(struct dect_auth_pool *pool,
+					unsigned int n)
+{
+	struct dect_auth_tuple tuples[DECT_AUTH_POOL_REFILL_STEP];
+	unsigned int i;
+
+	n = min(n, (unsigned int)DECT_AUTH_POOL_REFILL_STEP);
+	n = min(n, pool->cfg.depth - pool->count);
+	if (n == 0 || dect_auth_pool_random(pool, tuples, n) < 0)
+		return 0;
+
+	dect_auth_a1_batch(tuples, n);
+	for (i = 0; i < n; i++)
+		pool->tuples[(pool->head + pool->count++) % pool->cfg.depth] =
+			tuples[i];
+	pool->stats.calculated += n;
+	return n;
+}
+
+static void dect_auth_pool_timer(struct dect_handle *dh,
+				 struct dect_timer *timer)
+{
+	struct dect_auth_pool *pool = timer->data;
+
+	if (dect_auth_pool_fill(pool, pool->cfg.high - pool->count) == 0)
+		return;
+	if (pool->count < pool->cfg.high)
+		dect_timer_start_ms(dh, pool->timer, 0);
+}
+
+static void dect_auth_pool_refill(const struct dect_handle *dh,
+				  struct dect_auth_pool *pool)
+{
+	if (pool->count < pool->cfg.low && !dect_timer_running(pool->timer)) {
+		pool->stats.refills++;
+		dect_timer_start_ms(dh, pool->timer, 0);
+	}
+}
+
+/**
+ * Allocate an authentication challenge pool
+ *
+ * @param dh		libdect DECT handle
+ * @param k		authentication key K of size #DECT_AUTH_KEY_LEN
+ * @param cfg		pool configuration
+ *
+ * The pool is initially empty and filled up to the high watermark from the
+ * event loop.
+ */
+struct dect_auth_pool *dect_auth_pool_alloc(const struct dect_handle *dh,
+					    const uint8_t *k,
+					    const struct dect_auth_pool_cfg *cfg)
+{
+	struct dect_auth_pool *pool;
+
+	if (cfg->depth == 0 || cfg->depth > DECT_AUTH_POOL_MAX_DEPTH ||
+	    cfg->high > cfg->depth || cfg->low > cfg->high) {
+		errno = EINVAL;
+		goto err1;
+	}
+
+	pool = dect_zalloc(dh, sizeof(*pool) +
+			   cfg->depth * sizeof(pool->tuples[0]));
+	if (pool == NULL)
+		goto err1;
+	pool->cfg = *cfg;
+	memcpy(pool->k, k, sizeof(pool->k));
+
+	pool->timer = dect_timer_alloc(dh);
+	if (pool->timer == NULL)
+		goto err2;
+	dect_timer_setup(pool->timer, dect_auth_pool_timer, pool);
+
+	pool->stats.refills++;
+	dect_timer_start_ms(dh, pool->timer, 0);
+	return pool;
+
+err2:
+	dect_free(dh, pool);
+err1:
+	return NULL;
+}
+EXPORT_SYMBOL(dect_auth_pool_alloc);
+
+/**
+ * Release an authentication challenge pool
+ *
+ * @param dh		libdect DECT handle
+ * @param pool		authentication challenge pool
+ */
+void dect_auth_pool_free(const struct dect_handle *dh,
+			 struct dect_auth_pool *pool)
+{
+	if (dect_timer_running(pool->timer))
+		dect_timer_stop(dh, pool->timer);
+	dect_timer_free(dh, pool->timer);
+	memset(pool->k, 0, sizeof(pool->k));
+	memset(pool->tuples, 0, pool->cfg.depth * sizeof(pool->tuples[0]));
+	dect_free(dh, pool);
+}
+EXPORT_SYMBOL(dect_auth_pool_free);
+
+/**
+ * Take a precomputed challenge from the pool
+ *
+ * @param dh		libdect DECT handle
+ * @param pool		authentication challenge pool
+ * @param tuple		buffer to store the challenge
+ *
+ * When the pool is empty, the challenge is calculated synchronously.
+ *
+ * @return 0 on success or -1 if no random values could be obtained.
+ */
+int dect_auth_pool_get(const struct dect_handle *dh,
+		       struct dect_auth_pool *pool,
+		       struct dect_auth_tuple *tuple)
+{
+	if (pool->count == 0) {
+		pool->stats.misses++;
+		if (dect_auth_pool_fill(pool, 1) == 0)
+			return -1;
+	} else
+		pool->stats.hits++;
+
+	*tuple = pool->tuples[pool->head];
+	memset(&pool->tuples[pool->head], 0, sizeof(pool->tuples[0]));
+	pool->head = (pool->head + 1) % pool->cfg.depth;
+	pool->count--;
+
+	dect_auth_pool_refill(dh, pool);
+	return 0;
+}
+EXPORT_SYMBOL(dect_auth_pool_get);
+
+/**
+ * Change the authentication key of a challenge pool
+ *
+ * @param dh		libdect DECT handle
+ * @param pool		authentication challenge pool
+ * @param k		new authentication key K of size #DECT_AUTH_KEY_LEN
+ *
+ * Discard all precomputed challenges and refill the pool using the new key,
+ * for instance after key allocation.
+ */
+void dect_auth_pool_set_key(const struct dect_handle *dh,
+			    struct dect_auth_pool *pool, const uint8_t *k)
+{
+	memcpy(pool->k, k, sizeof(pool->k));
+	memset(pool->tuples, 0, pool->cfg.depth * sizeof(pool->tuples[0]));
+	pool->head  = 0;
+	pool->count = 0;
+
+	if (!dect_timer_running(pool->timer)) {
+		pool->stats.refills++;
+		dect_timer_start_ms(dh, pool->timer, 0);
+	}
+}
+EXPORT_SYMBOL(dect_auth_pool_set_key);
+
+/**
+ * Get authentication challenge pool statistics
+ *
+ * @param pool		authentication challenge pool
+ * @param stats		pool statistics
+ */
+void dect_auth_pool_get_stats(const struct dect_auth_pool *pool,
+			      struct dect_auth_pool_stats *stats)
+{
+	*stats	     = pool->stats;
+	stats->depth = pool->count;
+}
+EXPORT_SYMBOL(dect_auth_pool_get_stats);
+
+/** @} */
+/** @} */
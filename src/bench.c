@@ -0,0 +1,734 @@
+/*
+ * libdect microbenchmark suite
+ *
+ * Usage : bench [-s seconds] [-l links] [name ...]
+ *
+ * Measures the core library paths in isolation: S-Format parsing and
+ * building of all CC and MM messages in both directions, identity
+ * conversions, IE and message buffer allocation, timers, transaction lookup,
+ * DSAA and the codecs. Benchmarks are selected by name prefix, all are run
+ * by default.
+ *
+ * The handles are bound to a mock cluster using an event backend that does
+ * nothing, so neither the DECT kernel stack nor an event loop is involved.
+ *
+ * Each benchmark prints one line of key=value pairs:
+ *
+ *	bench=<name> ops=<count> ns_per_op=<ns> ops_per_sec=<rate>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <libdect.h>
+#include <dect/auth.h>
+#include <dect/mock.h>
+#include <utils.h>
+#include <timer.h>
+#include <s_fmt.h>
+#include <lce.h>
+#include <cc.h>
+#include <mm.h>
+#include <identities.h>
+#include "ccitt-adpcm/g72x.h"
+
+#define BENCH_MSG_SIZE		4096
+#define BENCH_FRAME_SAMPLES	80
+
+static double bench_seconds = 0.2;
+static unsigned int bench_nfilters;
+static char **bench_filters;
+
+static struct dect_handle *fp;
+static struct dect_handle *pp;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static bool bench_selected(const char *name)
+{
+	unsigned int i;
+
+	if (bench_nfilters == 0)
+		return true;
+	for (i = 0; i < bench_nfilters; i++) {
+		if (!strncmp(name, bench_filters[i], strlen(bench_filters[i])))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Run fn in batches of growing size until the configured time has elapsed.
+ * The batch size is doubled as long as a batch takes less than 1% of the
+ * total time, so the clock is read rarely enough not to distort the results.
+ */
+static void bench_run(const char *name, void (*fn)(void *arg, unsigned int n),
+		      void *arg)
+{
+	unsigned long long ops = 0;
+	unsigned int n = 1;
+	double start, batch, elapsed;
+
+	if (!bench_selected(name))
+		return;
+
+	fn(arg, 1);
+	start = now();
+	do {
+		batch = now();
+		fn(arg, n);
+		ops += n;
+		elapsed = now() - start;
+		if (now() - batch < bench_seconds / 100 && n < 1U << 30)
+			n *= 2;
+	} while (elapsed < bench_seconds);
+
+	printf("bench=%s ops=%llu ns_per_op=%.1f ops_per_sec=%.0f\n",
+	       name, ops, elapsed * 1e9 / ops, ops / elapsed);
+	fflush(stdout);
+}
+
+/*
+ * Null event backend
+ */
+
+static int null_register_fd(const struct dect_handle *dh, struct dect_fd *dfd,
+			    uint32_t events)
+{
+	return 0;
+}
+
+static void null_unregister_fd(const struct dect_handle *dh,
+			       struct dect_fd *dfd)
+{
+}
+
+static void null_start_timer(const struct dect_handle *dh,
+			     struct dect_timer *timer,
+			     const struct timeval *tv)
+{
+}
+
+static void null_stop_timer(const struct dect_handle *dh,
+			    struct dect_timer *timer)
+{
+}
+
+static const struct dect_event_ops null_event_ops = {
+	.register_fd	= null_register_fd,
+	.unregister_fd	= null_unregister_fd,
+	.start_timer	= null_start_timer,
+	.stop_timer	= null_stop_timer,
+};
+
+/*
+ * S-Format messages
+ *
+ * Messages are built with all IEs for which a sample exists, IE lists are
+ * left empty. Messages containing mandatory IEs without a sample are skipped.
+ */
+
+static struct dect_ie_portable_identity sample_portable_identity = {
+	.type		= DECT_PORTABLE_ID_TYPE_IPUI,
+	.ipui		= {
+		.put		= DECT_IPUI_N,
+		.pun.n.ipei	= {
+			.emc	= 0x0ba8,
+			.psn	= 0x12345,
+		},
+	},
+};
+
+static struct dect_ie_fixed_identity sample_fixed_identity = {
+	.type		= DECT_FIXED_ID_TYPE_PARK,
+	.ari		= {
+		.arc	= DECT_ARC_A,
+		.emc	= 0x0ba8,
+		.fpn	= 1,
+	},
+	.rpn		= 36,
+};
+
+static struct dect_ie_basic_service sample_basic_service = {
+	.class		= DECT_CALL_CLASS_NORMAL,
+	.service	= DECT_SERVICE_BASIC_SPEECH_DEFAULT,
+};
+
+static struct dect_ie_allocation_type sample_allocation_type = {
+	.auth_id	= DECT_AUTH_DSAA,
+	.auth_key_num	= 1,
+	.auth_code_num	= 1,
+};
+
+static struct dect_ie_auth_type sample_auth_type = {
+	.auth_id	= DECT_AUTH_DSAA,
+	.auth_key_type	= DECT_KEY_USER_AUTHENTICATION_KEY,
+	.auth_key_num	= 1,
+	.cipher_key_num	= 1,
+};
+
+static struct dect_ie_cipher_info sample_cipher_info = {
+	.enable		= true,
+	.cipher_alg_id	= DECT_CIPHER_STANDARD_1,
+	.cipher_key_type = DECT_CIPHER_DERIVED_KEY,
+	.cipher_key_num	= 1,
+};
+
+static struct dect_ie_identity_type sample_identity_type = {
+	.group		= DECT_IDENTITY_PORTABLE_IDENTITY,
+	.portable	= DECT_PORTABLE_ID_TYPE_IPUI,
+};
+
+static struct dect_ie_info_type sample_info_type = {
+	.num		= 1,
+	.type		= { DECT_INFO_LOCATE_SUGGEST },
+};
+
+static struct dect_ie_location_area sample_location_area = {
+	.type		= DECT_LOCATION_AREA_LEVEL,
+	.level		= 36,
+};
+
+static struct dect_ie_auth_value sample_auth_value = {
+	.value		= 0x0123456789abcdefULL,
+};
+
+static struct dect_ie_auth_res sample_auth_res = {
+	.value		= 0x89abcdef,
+};
+
+static struct dect_ie_release_reason sample_release_reason = {
+	.reason		= DECT_RELEASE_NORMAL,
+};
+
+static struct dect_ie_display sample_display = {
+	.len		= 7,
+	.info		= "libdect",
+};
+
+static struct dect_ie_called_party_number sample_called_party_number = {
+	.type		= DECT_NUMBER_TYPE_UNKNOWN,
+	.npi		= DECT_NPI_UNKNOWN,
+	.len		= 10,
+	.address	= "0123456789",
+};
+
+static struct dect_ie_common * const samples[256] = {
+	[DECT_IE_PORTABLE_IDENTITY]	= &sample_portable_identity.common,
+	[DECT_IE_FIXED_IDENTITY]	= &sample_fixed_identity.common,
+	[DECT_IE_BASIC_SERVICE]		= &sample_basic_service.common,
+	[DECT_IE_ALLOCATION_TYPE]	= &sample_allocation_type.common,
+	[DECT_IE_AUTH_TYPE]		= &sample_auth_type.common,
+	[DECT_IE_CIPHER_INFO]		= &sample_cipher_info.common,
+	[DECT_IE_IDENTITY_TYPE]		= &sample_identity_type.common,
+	[DECT_IE_INFO_TYPE]		= &sample_info_type.common,
+	[DECT_IE_LOCATION_AREA]		= &sample_location_area.common,
+	[DECT_IE_RAND]			= &sample_auth_value.common,
+	[DECT_IE_RS]			= &sample_auth_value.common,
+	[DECT_IE_RES]			= &sample_auth_res.common,
+	[DECT_IE_RELEASE_REASON]	= &sample_release_reason.common,
+	[DECT_IE_SINGLE_DISPLAY]	= &sample_display.common,
+	[DECT_IE_CALLED_PARTY_NUMBER]	= &sample_called_party_number.common,
+};
+
+union bench_msg {
+	struct dect_msg_common	common;
+	uint8_t			data[BENCH_MSG_SIZE];
+};
+
+struct bench_sfmt {
+	const struct dect_sfmt_msg_desc	*desc;
+	const struct dect_handle	*tx;
+	const struct dect_handle	*rx;
+	union bench_msg			src;
+	union bench_msg			dst;
+	struct dect_msg_buf		mb;
+	uint8_t				data[sizeof(((struct dect_msg_buf *)0)->head)];
+	uint8_t				len;
+};
+
+/* Populate a message with samples. Returns 0 if the message is not sent in
+ * the direction of the transmitting handle and -1 if a mandatory IE has no
+ * sample. */
+static int bench_sfmt_fill(struct bench_sfmt *b)
+{
+	const struct dect_sfmt_ie_desc *desc;
+	struct dect_ie_common **ie = b->src.common.ie;
+	enum dect_sfmt_ie_status status;
+	bool used = false;
+
+	memset(&b->src, 0, sizeof(b->src));
+	for (desc = b->desc->ie; !(desc->flags & DECT_SFMT_IE_END); desc++) {
+		status = b->tx->mode == DECT_MODE_FP ? desc->fp_pp : desc->pp_fp;
+		if (status != DECT_SFMT_IE_NONE)
+			used = true;
+
+		if (desc->type == DECT_IE_REPEAT_INDICATOR) {
+			ie = (void *)ie + sizeof(struct dect_ie_list);
+			continue;
+		}
+		if (desc->flags & DECT_SFMT_IE_REPEAT || samples[desc->type] == NULL) {
+			if (status == DECT_SFMT_IE_MANDATORY)
+				return -1;
+		} else if (status != DECT_SFMT_IE_NONE)
+			*ie = samples[desc->type];
+
+		if (!(desc->flags & DECT_SFMT_IE_REPEAT))
+			ie++;
+	}
+	return used;
+}
+
+static void bench_sfmt_build(void *arg, unsigned int n)
+{
+	struct bench_sfmt *b = arg;
+
+	while (n--) {
+		b->mb.data = b->mb.head;
+		b->mb.len  = 0;
+		dect_build_sfmt_msg(b->tx, b->desc, &b->src.common, &b->mb);
+	}
+}
+
+static void bench_sfmt_parse(void *arg, unsigned int n)
+{
+	struct bench_sfmt *b = arg;
+
+	while (n--) {
+		memcpy(b->mb.head, b->data, b->len);
+		b->mb.data = b->mb.head;
+		b->mb.len  = b->len;
+		memset(&b->dst.common, 0, sizeof(b->dst.common));
+		if (dect_parse_sfmt_msg(b->rx, b->desc, &b->dst.common,
+					&b->mb) == DECT_SFMT_OK)
+			dect_msg_free(b->rx, b->desc, &b->dst.common);
+	}
+}
+
+static int bench_sfmt_msg(const struct dect_sfmt_msg_desc *desc,
+			  const struct dect_handle *tx,
+			  const struct dect_handle *rx)
+{
+	const char *dir = tx->mode == DECT_MODE_FP ? "fp" : "pp";
+	struct bench_sfmt *b;
+	enum dect_sfmt_error err;
+	char build[128], parse[128];
+	int ret = 0;
+
+	snprintf(build, sizeof(build), "sfmt.build.%s.%s", desc->name, dir);
+	snprintf(parse, sizeof(parse), "sfmt.parse.%s.%s", desc->name, dir);
+	if (!bench_selected(build) && !bench_selected(parse))
+		return 0;
+
+	b = calloc(1, sizeof(*b));
+	if (b == NULL)
+		return -1;
+	b->desc = desc;
+	b->tx	= tx;
+	b->rx	= rx;
+	switch (bench_sfmt_fill(b)) {
+	case 0:
+		goto out;
+	case -1:
+		fprintf(stderr, "%s.%s: skipped, missing sample\n",
+			desc->name, dir);
+		goto out;
+	}
+
+	/* Build and parse once to validate the samples */
+	b->mb.data = b->mb.head;
+	err = dect_build_sfmt_msg(tx, desc, &b->src.common, &b->mb);
+	if (err != DECT_SFMT_OK)
+		goto err;
+	memcpy(b->data, b->mb.data, b->mb.len);
+	b->len = b->mb.len;
+
+	err = dect_parse_sfmt_msg(rx, desc, &b->dst.common, &b->mb);
+	if (err != DECT_SFMT_OK)
+		goto err;
+	dect_msg_free(rx, desc, &b->dst.common);
+
+	bench_run(build, bench_sfmt_build, b);
+	bench_run(parse, bench_sfmt_parse, b);
+out:
+	free(b);
+	return ret;
+
+err:
+	fprintf(stderr, "%s.%s: sample message invalid: %d\n",
+		desc->name, dir, err);
+	ret = -1;
+	goto out;
+}
+
+static int bench_sfmt(void)
+{
+	const struct dect_sfmt_msg_desc * const *desc;
+	int ret = 0;
+
+	for (desc = dect_cc_msg_descs; *desc != NULL; desc++) {
+		ret |= bench_sfmt_msg(*desc, fp, pp);
+		ret |= bench_sfmt_msg(*desc, pp, fp);
+	}
+	for (desc = dect_mm_msg_descs; *desc != NULL; desc++) {
+		ret |= bench_sfmt_msg(*desc, fp, pp);
+		ret |= bench_sfmt_msg(*desc, pp, fp);
+	}
+	return ret;
+}
+
+/*
+ * Identities
+ */
+
+static void bench_parse_ipui(void *arg, unsigned int n)
+{
+	struct dect_ipui ipui;
+	uint8_t data[8];
+	uint8_t len;
+
+	len = dect_build_ipui(data, &sample_portable_identity.ipui);
+	while (n--)
+		dect_parse_ipui(&ipui, data, len);
+}
+
+static void bench_build_ipui(void *arg, unsigned int n)
+{
+	uint8_t data[8];
+
+	while (n--)
+		dect_build_ipui(data, &sample_portable_identity.ipui);
+}
+
+static void bench_build_tpui(void *arg, unsigned int n)
+{
+	struct dect_tpui tpui = {
+		.type	= DECT_TPUI_INDIVIDUAL_ASSIGNED,
+		.ia	= {
+			.digits	= { 1, 2, 3, 4, 5 },
+		},
+	};
+	volatile uint32_t res;
+
+	while (n--)
+		res = dect_build_tpui(&tpui);
+	(void)res;
+}
+
+/*
+ * Allocation
+ */
+
+static void bench_ie_alloc(void *arg, unsigned int n)
+{
+	struct dect_ie_common *ie;
+
+	while (n--) {
+		ie = dect_ie_alloc(fp, sizeof(struct dect_ie_auth_value));
+		__dect_ie_hold(ie);
+		__dect_ie_put(fp, ie);
+		__dect_ie_put(fp, ie);
+	}
+}
+
+static void bench_mbuf_alloc(void *arg, unsigned int n)
+{
+	while (n--)
+		dect_mbuf_free(fp, dect_mbuf_alloc(fp));
+}
+
+/*
+ * Timers
+ */
+
+static void bench_timer_cb(struct dect_handle *dh, struct dect_timer *timer)
+{
+}
+
+static void bench_timer(void *arg, unsigned int n)
+{
+	struct dect_timer *timer = arg;
+
+	while (n--) {
+		dect_timer_start_ms(fp, timer, 1000);
+		dect_timer_stop(fp, timer);
+	}
+}
+
+/*
+ * Transaction lookup: open and close a CC transaction by IPUI on one of the
+ * established links, each of which holds another transaction open.
+ */
+
+struct bench_links {
+	unsigned int			n;
+	unsigned int			next;
+	struct dect_ipui		*ipui;
+	struct dect_transaction		*ta;
+	int				*peer;
+};
+
+static int bench_links_init(struct bench_links *bl, unsigned int n)
+{
+	struct dect_data_link *ddl;
+	unsigned int i;
+
+	bl->ipui = calloc(n, sizeof(bl->ipui[0]));
+	bl->ta   = calloc(n, sizeof(bl->ta[0]));
+	bl->peer = calloc(n, sizeof(bl->peer[0]));
+	if (bl->ipui == NULL || bl->ta == NULL || bl->peer == NULL)
+		return -1;
+
+	for (bl->n = 0; bl->n < n; bl->n++) {
+		i = bl->n;
+		bl->ipui[i] = sample_portable_identity.ipui;
+		bl->ipui[i].pun.n.ipei.psn = i + 1;
+
+		ddl = dect_ddl_replay_open(fp, &bl->peer[i]);
+		if (ddl == NULL)
+			return -1;
+		if (dect_ddl_set_ipui(fp, ddl, &bl->ipui[i]) < 0 ||
+		    dect_ddl_transaction_open(fp, &bl->ta[i], ddl, DECT_PD_CC) < 0) {
+			close(bl->peer[i]);
+			dect_ddl_replay_close(fp, ddl);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void bench_links_exit(struct bench_links *bl)
+{
+	unsigned int i;
+
+	for (i = 0; i < bl->n; i++) {
+		dect_transaction_close(fp, &bl->ta[i], DECT_DDL_RELEASE_NORMAL);
+		close(bl->peer[i]);
+	}
+	free(bl->peer);
+	free(bl->ta);
+	free(bl->ipui);
+}
+
+static void bench_transaction(void *arg, unsigned int n)
+{
+	struct bench_links *bl = arg;
+	struct dect_transaction ta;
+
+	while (n--) {
+		if (dect_transaction_open(fp, &ta, &bl->ipui[bl->next],
+					  DECT_PD_CC) == 0)
+			dect_transaction_close(fp, &ta, DECT_DDL_RELEASE_PARTIAL);
+		if (++bl->next == bl->n)
+			bl->next = 0;
+	}
+}
+
+/*
+ * DSAA
+ */
+
+static const uint8_t bench_k[DECT_AUTH_KEY_LEN] = {
+	0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+	0xfe, 0xdc, 0xba, 0x98, 0x76, 0x54, 0x32, 0x10,
+};
+
+static void bench_a11(void *arg, unsigned int n)
+{
+	uint8_t ks[DECT_AUTH_KEY_LEN];
+
+	while (n--)
+		dect_auth_a11(bench_k, n, ks);
+}
+
+static void bench_a12(void *arg, unsigned int n)
+{
+	uint8_t dck[DECT_CIPHER_KEY_LEN];
+	uint32_t res1;
+
+	while (n--)
+		dect_auth_a12(bench_k, n, dck, &res1);
+}
+
+static void bench_a21(void *arg, unsigned int n)
+{
+	uint8_t ks[DECT_AUTH_KEY_LEN];
+
+	while (n--)
+		dect_auth_a21(bench_k, n, ks);
+}
+
+static void bench_a22(void *arg, unsigned int n)
+{
+	uint32_t res2;
+
+	while (n--)
+		dect_auth_a22(bench_k, n, &res2);
+}
+
+/*
+ * Codecs, one operation processes one 10ms frame
+ */
+
+static short bench_pcm[BENCH_FRAME_SAMPLES];
+static unsigned char bench_code[BENCH_FRAME_SAMPLES];
+
+static void bench_alaw_encode(void *arg, unsigned int n)
+{
+	while (n--)
+		linear2alaw_block(bench_pcm, bench_code, BENCH_FRAME_SAMPLES);
+}
+
+static void bench_alaw_decode(void *arg, unsigned int n)
+{
+	while (n--)
+		alaw2linear_block(bench_code, bench_pcm, BENCH_FRAME_SAMPLES);
+}
+
+static void bench_g721_encode(void *arg, unsigned int n)
+{
+	while (n--)
+		g721_encode_block(bench_pcm, bench_code, BENCH_FRAME_SAMPLES,
+				  arg);
+}
+
+static void bench_g721_decode(void *arg, unsigned int n)
+{
+	while (n--)
+		g721_decode_block(bench_code, bench_pcm, BENCH_FRAME_SAMPLES,
+				  arg);
+}
+
+static void bench_codecs(void)
+{
+	struct g72x_state state;
+	unsigned int i;
+
+	for (i = 0; i < BENCH_FRAME_SAMPLES; i++)
+		bench_pcm[i] = (i * 997) % 8192 - 4096;
+
+	bench_run("codec.alaw.encode", bench_alaw_encode, NULL);
+	bench_run("codec.alaw.decode", bench_alaw_decode, NULL);
+	g72x_init_state(&state);
+	bench_run("codec.g721.encode", bench_g721_encode, &state);
+	g72x_init_state(&state);
+	bench_run("codec.g721.decode", bench_g721_decode, &state);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-s seconds] [-l links] [name ...]\n", name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct dect_ari pari = {
+		.arc	= DECT_ARC_A,
+		.emc	= 0x0ba8,
+		.fpn	= 1,
+	};
+	struct dect_ops fp_ops = {
+		.event_ops	= &null_event_ops,
+	}, pp_ops = {
+		.event_ops	= &null_event_ops,
+	};
+	struct dect_mock_cluster *mc;
+	struct bench_links bl = {};
+	struct dect_timer *timer;
+	unsigned int links = 256;
+	char name[64];
+	int opt, ret = 0;
+
+	while ((opt = getopt(argc, argv, "s:l:h")) != -1) {
+		switch (opt) {
+		case 's':
+			bench_seconds = atof(optarg);
+			break;
+		case 'l':
+			links = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (bench_seconds <= 0 || links == 0)
+		usage(argv[0]);
+	bench_filters  = argv + optind;
+	bench_nfilters = argc - optind;
+
+	/* Discard debugging messages before formatting */
+	dect_set_debug_mask(0);
+
+	mc = dect_mock_cluster_alloc(&pari);
+	if (mc == NULL)
+		goto err1;
+	fp = dect_mock_open_handle(&fp_ops, mc, DECT_MODE_FP);
+	if (fp == NULL)
+		goto err2;
+	pp = dect_mock_open_handle(&pp_ops, mc, DECT_MODE_PP);
+	if (pp == NULL)
+		goto err3;
+
+	if (bench_sfmt() < 0)
+		ret = 1;
+
+	bench_run("identities.parse_ipui", bench_parse_ipui, NULL);
+	bench_run("identities.build_ipui", bench_build_ipui, NULL);
+	bench_run("identities.build_tpui", bench_build_tpui, NULL);
+
+	bench_run("ie.alloc_hold_put", bench_ie_alloc, NULL);
+	bench_run("mbuf.alloc_free", bench_mbuf_alloc, NULL);
+
+	timer = dect_timer_alloc(fp);
+	if (timer == NULL)
+		goto err4;
+	dect_timer_setup(timer, bench_timer_cb, NULL);
+	bench_run("timer.start_stop", bench_timer, timer);
+	dect_timer_free(fp, timer);
+
+	snprintf(name, sizeof(name), "lce.transaction.%u", links);
+	if (bench_selected(name)) {
+		if (bench_links_init(&bl, links) < 0) {
+			perror("bench_links_init");
+			ret = 1;
+		} else
+			bench_run(name, bench_transaction, &bl);
+		bench_links_exit(&bl);
+	}
+
+	bench_run("dsaa.a11", bench_a11, NULL);
+	bench_run("dsaa.a12", bench_a12, NULL);
+	bench_run("dsaa.a21", bench_a21, NULL);
+	bench_run("dsaa.a22", bench_a22, NULL);
+
+	bench_codecs();
+
+	dect_close_handle(pp);
+	dect_close_handle(fp);
+	dect_mock_cluster_free(mc);
+	return ret;
+
+err4:
+	dect_close_handle(pp);
+err3:
+	dect_close_handle(fp);
+err2:
+	dect_mock_cluster_free(mc);
+err1:
+	perror("bench");
+	return 1;
+}
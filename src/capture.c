@@ -0,0 +1,450 @@
+/*
+ * libdect raw frame capture
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @addtogroup raw
+ * @{
+ *
+ * @defgroup capture Raw frame capture
+ *
+ * Streaming capture of raw DECT frames to pcapng files.
+ *
+ * Frames received through the raw_rcv or raw_rcv_batch callbacks are written
+ * using dect_capture_write() or dect_capture_write_batch() as enhanced packet
+ * blocks with link type LINKTYPE_USER0. The packet data consists of an eight
+ * byte pseudo header followed by the frame:
+ *
+ * - multiframe number (32 bit, big endian)
+ * - frame number (8 bit)
+ * - slot number (8 bit)
+ * - two bytes of padding
+ *
+ * Timestamps have microsecond resolution and are taken from the host clock
+ * or, with #DECT_CAPTURE_TS_MULTIFRAME, derived from the frame position, one
+ * multiframe corresponding to 160ms.
+ *
+ * Output is collected in a large buffer and written in chunks. With
+ * #DECT_CAPTURE_DIRECT the files are opened using O_DIRECT and only written
+ * in multiples of the block size, bypassing the page cache. When a rotation
+ * size is configured, the output is split into files named <path>.0,
+ * <path>.1, ..., each starting with its own section header.
+ *
+ * @{
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <asm/byteorder.h>
+
+#include <libdect.h>
+#include <utils.h>
+#include <dect/capture.h>
+
+/* Default output buffer size */
+#define DECT_CAPTURE_BUF_SIZE		(1024 * 1024)
+
+/* Alignment of buffers and writes for O_DIRECT */
+#define DECT_CAPTURE_ALIGN		4096
+
+/* pcapng block types */
+#define PCAPNG_SHB			0x0a0d0d0a
+#define PCAPNG_IDB			0x00000001
+#define PCAPNG_EPB			0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC		0x1a2b3c4d
+
+#define PCAPNG_OPT_ENDOFOPT		0
+#define PCAPNG_OPT_IF_TSRESOL		9
+
+#define LINKTYPE_USER0			147
+
+#define DECT_CAPTURE_PSEUDO_HDR_SIZE	8
+
+/* Size of the section header and interface description blocks */
+#define DECT_CAPTURE_HDR_SIZE		(28 + 32)
+
+/**
+ * struct dect_capture - raw frame capture
+ *
+ * @dh:		libdect DECT handle
+ * @flags:	capture flags
+ * @fd:		file descriptor of the current capture file
+ * @num:	number of the current capture file
+ * @rotate_size: maximum capture file size
+ * @file_size:	amount of data written to the current file, including
+ *		buffered data
+ * @buf_size:	output buffer size
+ * @len:	amount of buffered data
+ * @buf:	output buffer
+ * @mem:	output buffer allocation
+ * @path:	capture file path
+ */
+struct dect_capture {
+	const struct dect_handle	*dh;
+	unsigned int			flags;
+	int				fd;
+	unsigned int			num;
+	uint64_t			rotate_size;
+	uint64_t			file_size;
+	unsigned int			buf_size;
+	unsigned int			len;
+	uint8_t				*buf;
+	void				*mem;
+	char				path[];
+};
+
+static void dect_capture_put_u16(uint8_t **p, uint16_t val)
+{
+	memcpy(*p, &val, sizeof(val));
+	*p += sizeof(val);
+}
+
+static void dect_capture_put_u32(uint8_t **p, uint32_t val)
+{
+	memcpy(*p, &val, sizeof(val));
+	*p += sizeof(val);
+}
+
+static int dect_capture_write_fd(int fd, const uint8_t *buf, unsigned int len)
+{
+	ssize_t ret;
+
+	while (len > 0) {
+		ret = write(fd, buf, len);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+/*
+ * Write buffered data. With O_DIRECT, a partial trailing block is kept in the
+ * buffer unless @final is set, in which case O_DIRECT is disabled to write it.
+ */
+static int dect_capture_write_buf(struct dect_capture *cap, bool final)
+{
+	unsigned int len = cap->len;
+
+	if (cap->flags & DECT_CAPTURE_DIRECT) {
+		if (final) {
+			if (fcntl(cap->fd, F_SETFL,
+				  fcntl(cap->fd, F_GETFL) & ~O_DIRECT) < 0)
+				return -1;
+		} else
+			len &= ~(DECT_CAPTURE_ALIGN - 1);
+	}
+
+	if (dect_capture_write_fd(cap->fd, cap->buf, len) < 0)
+		return -1;
+
+	cap->len -= len;
+	memmove(cap->buf, cap->buf + len, cap->len);
+	return 0;
+}
+
+static int dect_capture_open_file(struct dect_capture *cap)
+{
+	char name[strlen(cap->path) + 16];
+	int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+	if (cap->rotate_size)
+		snprintf(name, sizeof(name), "%s.%u", cap->path, cap->num);
+	else
+		snprintf(name, sizeof(name), "%s", cap->path);
+
+	if (cap->flags & DECT_CAPTURE_DIRECT)
+		flags |= O_DIRECT;
+
+	cap->fd = open(name, flags, 0644);
+	if (cap->fd < 0)
+		return -1;
+	cap->file_size = 0;
+	return 0;
+}
+
+static uint8_t *dect_capture_reserve(struct dect_capture *cap, unsigned int len)
+{
+	uint8_t *p;
+
+	if (cap->len + len > cap->buf_size &&
+	    dect_capture_write_buf(cap, false) < 0)
+		return NULL;
+	/* A partial block may remain buffered with O_DIRECT */
+	if (cap->len + len > cap->buf_size) {
+		errno = EMSGSIZE;
+		return NULL;
+	}
+
+	p = cap->buf + cap->len;
+	cap->len += len;
+	cap->file_size += len;
+	return p;
+}
+
+static int dect_capture_write_headers(struct dect_capture *cap)
+{
+	uint8_t *p;
+
+	/* Section header block, section length unspecified */
+	p = dect_capture_reserve(cap, 28);
+	if (p == NULL)
+		return -1;
+	dect_capture_put_u32(&p, PCAPNG_SHB);
+	dect_capture_put_u32(&p, 28);
+	dect_capture_put_u32(&p, PCAPNG_BYTE_ORDER_MAGIC);
+	dect_capture_put_u16(&p, 1);
+	dect_capture_put_u16(&p, 0);
+	dect_capture_put_u32(&p, 0xffffffff);
+	dect_capture_put_u32(&p, 0xffffffff);
+	dect_capture_put_u32(&p, 28);
+
+	/* Interface description block, microsecond timestamps */
+	p = dect_capture_reserve(cap, 32);
+	if (p == NULL)
+		return -1;
+	dect_capture_put_u32(&p, PCAPNG_IDB);
+	dect_capture_put_u32(&p, 32);
+	dect_capture_put_u16(&p, LINKTYPE_USER0);
+	dect_capture_put_u16(&p, 0);
+	dect_capture_put_u32(&p, 0);
+	dect_capture_put_u16(&p, PCAPNG_OPT_IF_TSRESOL);
+	dect_capture_put_u16(&p, 1);
+	dect_capture_put_u32(&p, 6);
+	dect_capture_put_u32(&p, PCAPNG_OPT_ENDOFOPT);
+	dect_capture_put_u32(&p, 32);
+	return 0;
+}
+
+/*
+ * A failed rotation leaves the capture without an open file, the next
+ * rotation retries opening the same file.
+ */
+static int dect_capture_rotate(struct dect_capture *cap)
+{
+	if (cap->fd >= 0) {
+		if (dect_capture_write_buf(cap, true) < 0)
+			return -1;
+		close(cap->fd);
+		cap->fd = -1;
+		cap->num++;
+	}
+
+	if (dect_capture_open_file(cap) < 0)
+		return -1;
+	return dect_capture_write_headers(cap);
+}
+
+static uint64_t dect_capture_timestamp(const struct dect_capture *cap,
+				       const struct dect_msg_buf *mb)
+{
+	struct timespec ts;
+
+	/* 10ms per frame, 24 slots per frame, 16 frames per multiframe */
+	if (cap->flags & DECT_CAPTURE_TS_MULTIFRAME)
+		return (uint64_t)mb->mfn * 160000 + mb->frame * 10000 +
+		       mb->slot * 10000 / 24;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * Open a capture
+ *
+ * @param dh		libdect DECT handle
+ * @param path		capture file path
+ * @param cfg		capture configuration, may be NULL for the defaults
+ *
+ * @return the new capture or NULL on error.
+ */
+struct dect_capture *dect_capture_open(const struct dect_handle *dh,
+				       const char *path,
+				       const struct dect_capture_cfg *cfg)
+{
+	struct dect_capture *cap;
+	unsigned int buf_size;
+
+	cap = dect_zalloc(dh, sizeof(*cap) + strlen(path) + 1);
+	if (cap == NULL)
+		goto err1;
+	cap->dh = dh;
+	strcpy(cap->path, path);
+
+	buf_size = DECT_CAPTURE_BUF_SIZE;
+	if (cfg != NULL) {
+		cap->flags	 = cfg->flags;
+		cap->rotate_size = cfg->rotate_size;
+		if (cfg->buf_size)
+			buf_size = cfg->buf_size;
+	}
+
+	/* Leave room for at least one frame in front of a partial block */
+	buf_size = max(buf_size, 4U * DECT_CAPTURE_ALIGN);
+	cap->buf_size = buf_size & ~(DECT_CAPTURE_ALIGN - 1);
+
+	cap->mem = dect_malloc(dh, cap->buf_size + DECT_CAPTURE_ALIGN - 1);
+	if (cap->mem == NULL)
+		goto err2;
+	cap->buf = (uint8_t *)(((unsigned long)cap->mem + DECT_CAPTURE_ALIGN - 1) &
+			       ~(DECT_CAPTURE_ALIGN - 1UL));
+
+	if (dect_capture_open_file(cap) < 0)
+		goto err3;
+	if (dect_capture_write_headers(cap) < 0)
+		goto err4;
+	return cap;
+
+err4:
+	close(cap->fd);
+err3:
+	dect_free(dh, cap->mem);
+err2:
+	dect_free(dh, cap);
+err1:
+	return NULL;
+}
+EXPORT_SYMBOL(dect_capture_open);
+
+/**
+ * Flush and close a capture
+ *
+ * @param cap		capture
+ *
+ * The capture is released even if writing the remaining data fails.
+ */
+int dect_capture_close(struct dect_capture *cap)
+{
+	const struct dect_handle *dh = cap->dh;
+	int err;
+
+	if (cap->fd >= 0) {
+		err = dect_capture_write_buf(cap, true);
+		close(cap->fd);
+	} else {
+		errno = EBADF;
+		err = -1;
+	}
+	dect_free(dh, cap->mem);
+	dect_free(dh, cap);
+	return err;
+}
+EXPORT_SYMBOL(dect_capture_close);
+
+/**
+ * Write a frame to a capture
+ *
+ * @param cap		capture
+ * @param mb		libdect message buffer containing the frame
+ *
+ * The frame data may be spread over a chain of message buffer fragments.
+ * The data is buffered and written once the output buffer is full. Frames
+ * that don't fit into the output buffer next to a partial block are
+ * rejected with EMSGSIZE.
+ */
+int dect_capture_write(struct dect_capture *cap, const struct dect_msg_buf *mb)
+{
+	const struct dect_msg_buf *frag;
+	unsigned int len, plen, blen;
+	uint64_t ts;
+	uint32_t mfn;
+	uint8_t *p;
+
+	len  = DECT_CAPTURE_PSEUDO_HDR_SIZE + dect_mbuf_chain_len(mb);
+	plen = (len + 3) & ~3U;
+	blen = 32 + plen;
+
+	if (blen > cap->buf_size - DECT_CAPTURE_ALIGN) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	if (cap->rotate_size &&
+	    (cap->fd < 0 || (cap->file_size + blen > cap->rotate_size &&
+			     cap->file_size > DECT_CAPTURE_HDR_SIZE)) &&
+	    dect_capture_rotate(cap) < 0)
+		return -1;
+
+	p = dect_capture_reserve(cap, blen);
+	if (p == NULL)
+		return -1;
+
+	ts = dect_capture_timestamp(cap, mb);
+	dect_capture_put_u32(&p, PCAPNG_EPB);
+	dect_capture_put_u32(&p, blen);
+	dect_capture_put_u32(&p, 0);
+	dect_capture_put_u32(&p, ts >> 32);
+	dect_capture_put_u32(&p, ts);
+	dect_capture_put_u32(&p, len);
+	dect_capture_put_u32(&p, len);
+
+	mfn = __cpu_to_be32(mb->mfn);
+	memcpy(p, &mfn, sizeof(mfn));
+	p[4] = mb->frame;
+	p[5] = mb->slot;
+	p[6] = 0;
+	p[7] = 0;
+	p += DECT_CAPTURE_PSEUDO_HDR_SIZE;
+
+	for (frag = mb; frag != NULL; frag = frag->frag) {
+		memcpy(p, frag->data, frag->len);
+		p += frag->len;
+	}
+	memset(p, 0, plen - len);
+	p += plen - len;
+
+	dect_capture_put_u32(&p, blen);
+	return 0;
+}
+EXPORT_SYMBOL(dect_capture_write);
+
+/**
+ * Write an array of frames to a capture
+ *
+ * @param cap		capture
+ * @param mbs		libdect message buffers containing the frames
+ * @param n		number of frames
+ *
+ * Write the frames passed to a raw_rcv_batch callback.
+ */
+int dect_capture_write_batch(struct dect_capture *cap,
+			     struct dect_msg_buf *mbs[], unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++) {
+		if (dect_capture_write(cap, mbs[i]) < 0)
+			return -1;
+	}
+	return 0;
+}
+EXPORT_SYMBOL(dect_capture_write_batch);
+
+/**
+ * Write buffered data to the capture file
+ *
+ * @param cap		capture
+ *
+ * With #DECT_CAPTURE_DIRECT, a partial trailing block remains buffered.
+ */
+int dect_capture_flush(struct dect_capture *cap)
+{
+	return dect_capture_write_buf(cap, false);
+}
+EXPORT_SYMBOL(dect_capture_flush);
+
+/** @} */
+/** @} */
@@ -32,79 +32,81 @@
 #include <lce.h>
 #include <cc.h>
 #include <ss.h>
-
-static DECT_SFMT_MSG_DESC(cc_setup,
-	DECT_SFMT_IE(DECT_IE_PORTABLE_IDENTITY,		IE_MANDATORY, IE_MANDATORY, 0),
-	DECT_SFMT_IE(DECT_IE_FIXED_IDENTITY,		IE_MANDATORY, IE_MANDATORY, 0),
-	DECT_SFMT_IE(DECT_IE_NWK_ASSIGNED_IDENTITY,	IE_NONE,      IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_BASIC_SERVICE,		IE_MANDATORY, IE_MANDATORY, 0),
-	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_IWU_ATTRIBUTES,		IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT),
-	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_CALL_ATTRIBUTES,		IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT),
-	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_CONNECTION_ATTRIBUTES,	IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT),
-	DECT_SFMT_IE(DECT_IE_CIPHER_INFO,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_CONNECTION_IDENTITY,	IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_FACILITY,			IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT),
-	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_NONE,      0),
-	DECT_SFMT_IE(DECT_IE_PROGRESS_INDICATOR,	IE_OPTIONAL,  IE_NONE,      DECT_SFMT_IE_REPEAT),
-	DECT_SFMT_IE(DECT_IE_SINGLE_DISPLAY,		IE_OPTIONAL,  IE_NONE,      0),
-	DECT_SFMT_IE(DECT_IE_SINGLE_KEYPAD,		IE_NONE,      IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_SIGNAL,			IE_OPTIONAL,  IE_NONE,      0),
-	DECT_SFMT_IE(DECT_IE_FEATURE_ACTIVATE,		IE_NONE,      IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_FEATURE_INDICATE,		IE_OPTIONAL,  IE_NONE,      0),
-	DECT_SFMT_IE(DECT_IE_NETWORK_PARAMETER,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_EXT_HO_INDICATOR,		IE_OPTIONAL,  IE_NONE,      0),
-	DECT_SFMT_IE(DECT_IE_TERMINAL_CAPABILITY,	IE_NONE,      IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_END_TO_END_COMPATIBILITY,	IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_RATE_PARAMETERS,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_TRANSIT_DELAY,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_WINDOW_SIZE,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_CALLING_PARTY_NUMBER,	IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_CALLED_PARTY_NUMBER,	IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_CALLED_PARTY_SUBADDR,	IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_SENDING_COMPLETE,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_SEGMENTED_INFO,		IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT),
-	DECT_SFMT_IE(DECT_IE_IWU_TO_IWU,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_IWU_PACKET,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_CALLING_PARTY_NAME,	IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_ESCAPE_TO_PROPRIETARY,	IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_CODEC_LIST,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_CALL_INFORMATION,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE_END_MSG
-);
-
-static DECT_SFMT_MSG_DESC(cc_info,
-	DECT_SFMT_IE(DECT_IE_LOCATION_AREA,		IE_NONE,      IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_NWK_ASSIGNED_IDENTITY,	IE_NONE,      IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_FACILITY,			IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT),
-	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_PROGRESS_INDICATOR,	IE_OPTIONAL,  IE_NONE,      DECT_SFMT_IE_REPEAT),
-	DECT_SFMT_IE(DECT_IE_SINGLE_DISPLAY,		IE_OPTIONAL,  IE_NONE,      0),
-	DECT_SFMT_IE(DECT_IE_SINGLE_KEYPAD,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_SIGNAL,			IE_OPTIONAL,  IE_NONE,      0),
-	DECT_SFMT_IE(DECT_IE_FEATURE_ACTIVATE,		IE_NONE,      IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_FEATURE_INDICATE,      	IE_OPTIONAL,  IE_NONE,      0),
-	DECT_SFMT_IE(DECT_IE_NETWORK_PARAMETER,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_EXT_HO_INDICATOR,		IE_OPTIONAL,  IE_NONE,      0),
-	DECT_SFMT_IE(DECT_IE_CALLING_PARTY_NUMBER,	IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_CALLED_PARTY_NUMBER,	IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_CALLED_PARTY_SUBADDR,	IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_SENDING_COMPLETE,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_TEST_HOOK_CONTROL,		IE_OPTIONAL,  IE_NONE,      0),
-	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_IWU_TO_IWU,		IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT),
-	DECT_SFMT_IE(DECT_IE_IWU_PACKET,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_CALLING_PARTY_NAME,	IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_ESCAPE_TO_PROPRIETARY,	IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_CODEC_LIST,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_CALL_INFORMATION,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE_END_MSG
-);
+#include <ind.h>
+#include <trace.h>
+
+#define DECT_CC_SETUP_IES(IE)										\
+	IE(DECT_IE_PORTABLE_IDENTITY,		IE_MANDATORY, IE_MANDATORY, 0)				\
+	IE(DECT_IE_FIXED_IDENTITY,		IE_MANDATORY, IE_MANDATORY, 0)				\
+	IE(DECT_IE_NWK_ASSIGNED_IDENTITY,	IE_NONE,      IE_OPTIONAL,  0)				\
+	IE(DECT_IE_BASIC_SERVICE,		IE_MANDATORY, IE_MANDATORY, 0)				\
+	IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_IWU_ATTRIBUTES,		IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT)	\
+	IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_CALL_ATTRIBUTES,		IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT)	\
+	IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_CONNECTION_ATTRIBUTES,	IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT)	\
+	IE(DECT_IE_CIPHER_INFO,			IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_CONNECTION_IDENTITY,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_FACILITY,			IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT)	\
+	IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_NONE,      0)				\
+	IE(DECT_IE_PROGRESS_INDICATOR,		IE_OPTIONAL,  IE_NONE,      DECT_SFMT_IE_REPEAT)	\
+	IE(DECT_IE_SINGLE_DISPLAY,		IE_OPTIONAL,  IE_NONE,      0)				\
+	IE(DECT_IE_SINGLE_KEYPAD,		IE_NONE,      IE_OPTIONAL,  0)				\
+	IE(DECT_IE_SIGNAL,			IE_OPTIONAL,  IE_NONE,      0)				\
+	IE(DECT_IE_FEATURE_ACTIVATE,		IE_NONE,      IE_OPTIONAL,  0)				\
+	IE(DECT_IE_FEATURE_INDICATE,		IE_OPTIONAL,  IE_NONE,      0)				\
+	IE(DECT_IE_NETWORK_PARAMETER,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_EXT_HO_INDICATOR,		IE_OPTIONAL,  IE_NONE,      0)				\
+	IE(DECT_IE_TERMINAL_CAPABILITY,		IE_NONE,      IE_OPTIONAL,  0)				\
+	IE(DECT_IE_END_TO_END_COMPATIBILITY,	IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_RATE_PARAMETERS,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_TRANSIT_DELAY,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_WINDOW_SIZE,			IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_CALLING_PARTY_NUMBER,	IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_CALLED_PARTY_NUMBER,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_CALLED_PARTY_SUBADDR,	IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_SENDING_COMPLETE,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_SEGMENTED_INFO,		IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT)	\
+	IE(DECT_IE_IWU_TO_IWU,			IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_IWU_PACKET,			IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_CALLING_PARTY_NAME,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_ESCAPE_TO_PROPRIETARY,	IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_CODEC_LIST,			IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_CALL_INFORMATION,		IE_OPTIONAL,  IE_OPTIONAL,  0)
+
+static DECT_SFMT_MSG_DESC_CODEC(cc_setup, DECT_CC_SETUP_IES);
+
+#define DECT_CC_INFO_IES(IE)										\
+	IE(DECT_IE_LOCATION_AREA,		IE_NONE,      IE_OPTIONAL,  0)				\
+	IE(DECT_IE_NWK_ASSIGNED_IDENTITY,	IE_NONE,      IE_OPTIONAL,  0)				\
+	IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_FACILITY,			IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT)	\
+	IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_PROGRESS_INDICATOR,		IE_OPTIONAL,  IE_NONE,      DECT_SFMT_IE_REPEAT)	\
+	IE(DECT_IE_SINGLE_DISPLAY,		IE_OPTIONAL,  IE_NONE,      0)				\
+	IE(DECT_IE_SINGLE_KEYPAD,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_SIGNAL,			IE_OPTIONAL,  IE_NONE,      0)				\
+	IE(DECT_IE_FEATURE_ACTIVATE,		IE_NONE,      IE_OPTIONAL,  0)				\
+	IE(DECT_IE_FEATURE_INDICATE,		IE_OPTIONAL,  IE_NONE,      0)				\
+	IE(DECT_IE_NETWORK_PARAMETER,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_EXT_HO_INDICATOR,		IE_OPTIONAL,  IE_NONE,      0)				\
+	IE(DECT_IE_CALLING_PARTY_NUMBER,	IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_CALLED_PARTY_NUMBER,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_CALLED_PARTY_SUBADDR,	IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_SENDING_COMPLETE,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_TEST_HOOK_CONTROL,		IE_OPTIONAL,  IE_NONE,      0)				\
+	IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_IWU_TO_IWU,			IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT)	\
+	IE(DECT_IE_IWU_PACKET,			IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_CALLING_PARTY_NAME,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_ESCAPE_TO_PROPRIETARY,	IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_CODEC_LIST,			IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_CALL_INFORMATION,		IE_OPTIONAL,  IE_OPTIONAL,  0)
+
+static DECT_SFMT_MSG_DESC_CODEC(cc_info, DECT_CC_INFO_IES);
 
 static DECT_SFMT_MSG_DESC(cc_setup_ack,
 	DECT_SFMT_IE(DECT_IE_INFO_TYPE,			IE_OPTIONAL,  IE_NONE,      0),
@@ -326,6 +328,26 @@ static DECT_SFMT_MSG_DESC(crss_hold,
 	DECT_SFMT_IE_END_MSG
 );
 
+/* All message descriptions, used by the benchmark suite */
+const struct dect_sfmt_msg_desc * const dect_cc_msg_descs[] = {
+	&cc_setup_msg_desc,
+	&cc_info_msg_desc,
+	&cc_setup_ack_msg_desc,
+	&cc_call_proc_msg_desc,
+	&cc_alerting_msg_desc,
+	&cc_connect_msg_desc,
+	&cc_connect_ack_msg_desc,
+	&cc_release_msg_desc,
+	&cc_release_com_msg_desc,
+	&cc_service_change_msg_desc,
+	&cc_service_accept_msg_desc,
+	&cc_service_reject_msg_desc,
+	&cc_notify_msg_desc,
+	&cc_iwu_info_msg_desc,
+	&crss_hold_msg_desc,
+	NULL
+};
+
 #define __cc_debug(call, pfx, fmt, args...) \
 	dect_debug(DECT_DEBUG_CC, "%sCC: call %p (%s): " fmt "\n", pfx, \
 		   (call), call_states[(call)->state], ## args)
@@ -367,6 +389,24 @@ const struct dect_ipui *dect_call_portable_identity(const struct dect_call *call
 }
 EXPORT_SYMBOL(dect_call_portable_identity);
 
+static int dect_cc_lu_tx_buffer(const struct dect_handle *dh,
+				struct dect_call *call,
+				const uint8_t *data, unsigned int len)
+{
+	if (call->lu_tx_len + len > sizeof(call->lu_tx_buf)) {
+		cc_debug(call, "U-Plane TX buffer full, dropping %u bytes", len);
+		errno = ENOBUFS;
+		return -1;
+	}
+	if (call->lu_tx_len == 0 &&
+	    dect_fd_update(dh, call->lu_sap, DECT_FD_READ | DECT_FD_WRITE) < 0)
+		return -1;
+
+	memcpy(call->lu_tx_buf + call->lu_tx_len, data, len);
+	call->lu_tx_len += len;
+	return 0;
+}
+
 /**
  * DL_U_DATA-req primitive
  *
@@ -379,7 +419,7 @@ EXPORT_SYMBOL(dect_call_portable_identity);
 int dect_dl_u_data_req(const struct dect_handle *dh, struct dect_call *call,
 		       struct dect_msg_buf *mb)
 {
-	ssize_t size;
+	ssize_t size = 0;
 
 	if (call->lu_sap == NULL) {
 		cc_debug(call, "U-Plane U_DATA-req, but still unconnected");
@@ -387,14 +427,319 @@ int dect_dl_u_data_req(const struct dect_handle *dh, struct dect_call *call,
 	}
 	//cc_debug(call, "U-Plane U_DATA-req");
 	//dect_mbuf_dump(mb, "LU1");
-	size = send(call->lu_sap->fd, mb->data, mb->len, 0);
-	if (size != ((ssize_t)mb->len))
-		cc_debug(call, "sending %u bytes failed: %s",
-			 mb->len, strerror(errno));
+
+	/* Preserve ordering while data is waiting for transmission */
+	if (call->lu_tx_len == 0) {
+		size = send(call->lu_sap->fd, mb->data, mb->len, 0);
+		dect_trace3(uplane_tx, call, mb->len, size);
+		if (size == ((ssize_t)mb->len))
+			return 0;
+		if (size < 0 && errno != EAGAIN) {
+			cc_debug(call, "sending %u bytes failed: %s",
+				 mb->len, strerror(errno));
+			return 0;
+		}
+		if (size < 0)
+			size = 0;
+	}
+
+	/* Buffer the remaining data until the socket becomes writable */
+	dect_cc_lu_tx_buffer(dh, call, mb->data + size, mb->len - size);
 	return 0;
 }
 EXPORT_SYMBOL(dect_dl_u_data_req);
 
+/* Send consecutive frames of a single call using one sendmsg() call */
+static void dect_cc_lu_tx_batch(const struct dect_handle *dh,
+				struct dect_dl_u_data_req_param *param,
+				unsigned int n)
+{
+	struct dect_call *call = param[0].call;
+	struct iovec iov[DECT_CC_LU_TX_IOV_MAX];
+	struct msghdr msg;
+	ssize_t size = 0;
+	unsigned int i, len;
+
+	if (call->lu_sap == NULL) {
+		for (i = 0; i < n; i++)
+			param[i].err = ENOTCONN;
+		return;
+	}
+
+	/* Preserve ordering while data is waiting for transmission */
+	if (call->lu_tx_len == 0) {
+		for (i = 0, len = 0; i < n; i++) {
+			iov[i].iov_base = param[i].mb->data;
+			iov[i].iov_len  = param[i].mb->len;
+			len += param[i].mb->len;
+		}
+
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov    = iov;
+		msg.msg_iovlen = n;
+
+		size = sendmsg(call->lu_sap->fd, &msg, 0);
+		dect_trace3(uplane_tx, call, len, size);
+		if (size < 0 && errno != EAGAIN) {
+			cc_debug(call, "sending %u frames failed: %s",
+				 n, strerror(errno));
+			for (i = 0; i < n; i++)
+				param[i].err = errno;
+			return;
+		}
+		if (size < 0)
+			size = 0;
+	}
+
+	/* Buffer everything behind the sent data */
+	for (i = 0; i < n; i++) {
+		len = param[i].mb->len;
+		param[i].err = 0;
+		if ((size_t)size >= len) {
+			size -= len;
+			continue;
+		}
+		if (dect_cc_lu_tx_buffer(dh, call, param[i].mb->data + size,
+					 len - size) < 0)
+			param[i].err = errno;
+		size = 0;
+	}
+}
+
+/**
+ * DL_U_DATA-req primitive for multiple frames and calls
+ *
+ * @param dh		libdect DECT handle
+ * @param param		array of calls and message buffers
+ * @param n		number of array entries
+ *
+ * Pass U-plane data of multiple calls to the DLC. Consecutive entries for the
+ * same call are transmitted using a single system call. The result of each
+ * entry is stored in its err member.
+ *
+ * @return the number of successfully transmitted or buffered entries.
+ */
+int dect_dl_u_data_req_batch(const struct dect_handle *dh,
+			     struct dect_dl_u_data_req_param *param,
+			     unsigned int n)
+{
+	unsigned int i, j, cnt = 0;
+
+	for (i = 0; i < n; i = j) {
+		for (j = i + 1; j < n && j - i < DECT_CC_LU_TX_IOV_MAX; j++) {
+			if (param[j].call != param[i].call)
+				break;
+		}
+
+		dect_cc_lu_tx_batch(dh, param + i, j - i);
+		for (; i < j; i++) {
+			if (param[i].err == 0)
+				cnt++;
+		}
+	}
+	return cnt;
+}
+EXPORT_SYMBOL(dect_dl_u_data_req_batch);
+
+/*
+ * U-Plane frame ring: frames are passed from the protocol thread to a
+ * consumer, usually a real-time audio thread, through a lock-free single
+ * producer single consumer queue. Consumed buffers are returned through a
+ * second queue and released by the protocol thread, so the consumer never
+ * blocks or calls into the allocator.
+ */
+
+static bool dect_uplane_queue_put(struct dect_uplane_queue *q,
+				  struct dect_msg_buf **buf, unsigned int mask,
+				  struct dect_msg_buf *mb)
+{
+	unsigned int tail = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+
+	if (tail - __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) > mask)
+		return false;
+	buf[tail & mask] = mb;
+	__atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+static struct dect_msg_buf *dect_uplane_queue_get(struct dect_uplane_queue *q,
+						  struct dect_msg_buf **buf,
+						  unsigned int mask)
+{
+	unsigned int head = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+	struct dect_msg_buf *mb;
+
+	if (head == __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE))
+		return NULL;
+	mb = buf[head & mask];
+	__atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+	return mb;
+}
+
+/**
+ * Allocate a U-Plane frame ring
+ *
+ * @param dh		libdect DECT handle
+ * @param size		maximum number of frames, rounded up to a power of two
+ */
+struct dect_uplane_ring *dect_uplane_ring_alloc(const struct dect_handle *dh,
+						unsigned int size)
+{
+	struct dect_uplane_ring *ring;
+
+	size = 1 << fls(max(size, 2U) - 1);
+	ring = dect_zalloc(dh, sizeof(*ring) + 2 * size * sizeof(ring->frame_buf[0]));
+	if (ring == NULL)
+		return NULL;
+
+	ring->mask	= size - 1;
+	ring->frame_buf	= (void *)(ring + 1);
+	ring->free_buf	= ring->frame_buf + size;
+	return ring;
+}
+EXPORT_SYMBOL(dect_uplane_ring_alloc);
+
+/**
+ * Release a U-Plane frame ring
+ *
+ * @param dh		libdect DECT handle
+ * @param ring		U-Plane frame ring
+ *
+ * The consumer must have stopped using the ring. Queued and recycled frames
+ * are released, frames still held by the consumer are not.
+ */
+void dect_uplane_ring_free(const struct dect_handle *dh,
+			   struct dect_uplane_ring *ring)
+{
+	struct dect_msg_buf *mb;
+
+	while ((mb = dect_uplane_queue_get(&ring->frames, ring->frame_buf,
+					   ring->mask)))
+		dect_mbuf_free(dh, mb);
+	while ((mb = dect_uplane_queue_get(&ring->free, ring->free_buf,
+					   ring->mask)))
+		dect_mbuf_free(dh, mb);
+	dect_free(dh, ring);
+}
+EXPORT_SYMBOL(dect_uplane_ring_free);
+
+/**
+ * Queue a frame for the consumer
+ *
+ * @param dh		libdect DECT handle
+ * @param ring		U-Plane frame ring
+ * @param mb		libdect message buffer
+ *
+ * Called by the protocol thread, usually from the dl_u_data_ind callback.
+ * The reference to the buffer is transferred to the ring on success.
+ * Buffers recycled by the consumer are released first.
+ *
+ * @return 0 on success or -1 if the consumer holds the maximum number of frames.
+ */
+int dect_uplane_ring_push(const struct dect_handle *dh,
+			  struct dect_uplane_ring *ring,
+			  struct dect_msg_buf *mb)
+{
+	struct dect_msg_buf *old;
+
+	while ((old = dect_uplane_queue_get(&ring->free, ring->free_buf,
+					    ring->mask))) {
+		dect_mbuf_free(dh, old);
+		ring->outstanding--;
+	}
+
+	if (ring->outstanding > ring->mask) {
+		errno = ENOBUFS;
+		return -1;
+	}
+
+	dect_uplane_queue_put(&ring->frames, ring->frame_buf, ring->mask, mb);
+	ring->outstanding++;
+	return 0;
+}
+EXPORT_SYMBOL(dect_uplane_ring_push);
+
+/**
+ * Dequeue the next frame
+ *
+ * @param ring		U-Plane frame ring
+ *
+ * Called by the consumer. Frames must be returned using
+ * dect_uplane_ring_recycle() once consumed.
+ *
+ * @return the next frame or NULL if the ring is empty.
+ */
+struct dect_msg_buf *dect_uplane_ring_pop(struct dect_uplane_ring *ring)
+{
+	return dect_uplane_queue_get(&ring->frames, ring->frame_buf, ring->mask);
+}
+EXPORT_SYMBOL(dect_uplane_ring_pop);
+
+/**
+ * Return a consumed frame to the protocol thread
+ *
+ * @param ring		U-Plane frame ring
+ * @param mb		frame returned by dect_uplane_ring_pop()
+ *
+ * Called by the consumer, never blocks.
+ */
+void dect_uplane_ring_recycle(struct dect_uplane_ring *ring,
+			      struct dect_msg_buf *mb)
+{
+	/* Can't overflow, no more than the ring size of frames is outstanding */
+	dect_uplane_queue_put(&ring->free, ring->free_buf, ring->mask, mb);
+}
+EXPORT_SYMBOL(dect_uplane_ring_recycle);
+
+static void dect_cc_lu_tx_flush(const struct dect_handle *dh,
+				struct dect_call *call)
+{
+	ssize_t size;
+
+	size = send(call->lu_sap->fd, call->lu_tx_buf, call->lu_tx_len, 0);
+	if (size < 0) {
+		if (errno == EAGAIN)
+			return;
+		cc_debug(call, "sending %u bytes failed: %s",
+			 call->lu_tx_len, strerror(errno));
+		size = call->lu_tx_len;
+	}
+
+	call->lu_tx_len -= size;
+	memmove(call->lu_tx_buf, call->lu_tx_buf + size, call->lu_tx_len);
+	if (call->lu_tx_len == 0)
+		dect_fd_update(dh, call->lu_sap, DECT_FD_READ);
+}
+
+/*
+ * Get a buffer for a received U-Plane frame: ring buffers still referenced
+ * by the application are skipped, a pool buffer is used if all are busy.
+ */
+static struct dect_msg_buf *dect_cc_lu_rx_buf(const struct dect_handle *dh,
+					      struct dect_call *call)
+{
+	struct dect_msg_buf *mb;
+	unsigned int i;
+
+	for (i = 0; i < DECT_CC_LU_RX_RING_SIZE; i++) {
+		mb = call->lu_rx_ring[call->lu_rx_next];
+		call->lu_rx_next = (call->lu_rx_next + 1) % DECT_CC_LU_RX_RING_SIZE;
+		if (mb == NULL || mb->refcnt > 1)
+			continue;
+
+		mb->data = mb->head;
+		mb->len  = 0;
+		mb->type = 0;
+		mb->next = NULL;
+		mb->refcnt++;
+		return mb;
+	}
+	return dect_mbuf_alloc_raw(dh);
+}
+
+static void dect_call_disconnect_uplane(const struct dect_handle *dh,
+					struct dect_call *call);
+
 static void dect_cc_lu_event(struct dect_handle *dh, struct dect_fd *fd,
 			     uint32_t event)
 {
@@ -402,31 +747,60 @@ static void dect_cc_lu_event(struct dect_handle *dh, struct dect_fd *fd,
 	struct dect_msg_buf *mb;
 	ssize_t len;
 
+	if (event & DECT_FD_WRITE) {
+		dect_cc_lu_tx_flush(dh, call);
+		if (!(event & DECT_FD_READ))
+			return;
+	}
+
 	//cc_debug(call, "U-Plane U_DATA-ind");
-	mb = dect_mbuf_alloc(dh);
+	mb = dect_cc_lu_rx_buf(dh, call);
 	if (mb == NULL)
 		return;
 
 	len = recv(call->lu_sap->fd, mb->data, 40, 0);
 	if (len < 0)
-		return;
+		goto out;
+	if (len == 0) {
+		/* The LU1 connection was released with the MAC connection */
+		dect_mbuf_free(dh, mb);
+		return dect_call_disconnect_uplane(dh, call);
+	}
 	mb->len = len;
+	dect_trace2(uplane_rx, call, mb->len);
 
 	//dect_mbuf_dump(mb, "LU1");
+	if (dh->ops->cc_ops->dl_u_data_view_ind != NULL) {
+		dh->ops->cc_ops->dl_u_data_view_ind(dh, call, mb);
+		goto out;
+	}
 	dh->ops->cc_ops->dl_u_data_ind(dh, call, mb);
+	return;
+
+out:
+	dect_mbuf_free(dh, mb);
 }
 
-static void dect_cc_get_queue_stats(const struct dect_call *call)
+static int dect_cc_read_queue_stats(const struct dect_call *call,
+				    struct dect_lu1_queue_stats *qstats)
 {
-	struct dect_lu1_queue_stats qstats;
 	socklen_t optlen;
 
-	optlen = sizeof(qstats);
-	if (getsockopt(call->lu_sap->fd, SOL_DECT, DECT_LU1_QUEUE_STATS,
-		       &qstats, &optlen) < 0) {
+	optlen = sizeof(*qstats);
+	if (dect_fd_getsockopt(call->lu_sap, SOL_DECT, DECT_LU1_QUEUE_STATS,
+			       qstats, &optlen) < 0) {
 		cc_debug(call, "Failed to get queue statistics: %s", strerror(errno));
-		return;
+		return -1;
 	}
+	return 0;
+}
+
+static void dect_cc_get_queue_stats(const struct dect_call *call)
+{
+	struct dect_lu1_queue_stats qstats;
+
+	if (dect_cc_read_queue_stats(call, &qstats) < 0)
+		return;
 
 	cc_debug(call, "LU1 Queue-Statistic:");
 	cc_debug(call, "  RX-Bytes:     %u", qstats.rx_bytes);
@@ -435,6 +809,111 @@ static void dect_cc_get_queue_stats(const struct dect_call *call)
 	cc_debug(call, "  TX-Underflow: %u", qstats.tx_underflow);
 }
 
+/**
+ * Get U-Plane statistics of a call
+ *
+ * @param dh		libdect DECT handle
+ * @param call		Call Control Endpoint
+ * @param stats		U-Plane statistics
+ *
+ * Read the LU1 queue statistics and calculate rates and underflows since the
+ * previous sample, or since the U-Plane was connected for the first sample.
+ *
+ * @return 0 on success or -1 on error.
+ */
+int dect_call_get_uplane_stats(const struct dect_handle *dh,
+			       struct dect_call *call,
+			       struct dect_uplane_stats *stats)
+{
+	const struct dect_lu1_queue_stats *prev = &call->lu_qstats;
+	struct dect_lu1_queue_stats qstats;
+	uint64_t now;
+
+	if (call->lu_sap == NULL) {
+		errno = ENOTCONN;
+		return -1;
+	}
+	if (dect_cc_read_queue_stats(call, &qstats) < 0)
+		return -1;
+	now = dect_timer_now();
+
+	memset(stats, 0, sizeof(*stats));
+	stats->rx_bytes		  = qstats.rx_bytes;
+	stats->rx_underflow	  = qstats.rx_underflow;
+	stats->tx_bytes		  = qstats.tx_bytes;
+	stats->tx_underflow	  = qstats.tx_underflow;
+	stats->interval		  = now - call->lu_qstats_time;
+	stats->rx_underflow_delta = qstats.rx_underflow - prev->rx_underflow;
+	stats->tx_underflow_delta = qstats.tx_underflow - prev->tx_underflow;
+	if (stats->interval > 0) {
+		stats->rx_rate = (uint64_t)(qstats.rx_bytes - prev->rx_bytes) *
+				 1000 / stats->interval;
+		stats->tx_rate = (uint64_t)(qstats.tx_bytes - prev->tx_bytes) *
+				 1000 / stats->interval;
+	}
+
+	call->lu_qstats	     = qstats;
+	call->lu_qstats_time = now;
+	return 0;
+}
+EXPORT_SYMBOL(dect_call_get_uplane_stats);
+
+static void dect_cc_stats_timer(struct dect_handle *dh, struct dect_timer *timer)
+{
+	struct dect_call *call = timer->data;
+	struct dect_uplane_stats stats;
+
+	dect_timer_start_ms(dh, call->lu_stats_timer, call->lu_stats_interval);
+	if (dect_call_get_uplane_stats(dh, call, &stats) < 0)
+		return;
+	call->lu_stats_cb(dh, call, &stats);
+}
+
+/**
+ * Periodically sample U-Plane statistics of a call
+ *
+ * @param dh		libdect DECT handle
+ * @param call		Call Control Endpoint
+ * @param interval	sampling interval in milliseconds, 0 to stop sampling
+ * @param cb		callback invoked with each sample
+ *
+ * Samples are only taken while the U-Plane is connected, sampling resumes
+ * when the U-Plane is connected again. Sampling updates the reference point
+ * of the derived values returned by dect_call_get_uplane_stats().
+ *
+ * @return 0 on success or -1 on error.
+ */
+int dect_call_sample_uplane_stats(const struct dect_handle *dh,
+				  struct dect_call *call,
+				  unsigned int interval,
+				  void (*cb)(struct dect_handle *dh,
+					     struct dect_call *call,
+					     const struct dect_uplane_stats *stats))
+{
+	call->lu_stats_interval = interval;
+	if (interval == 0) {
+		if (call->lu_stats_timer != NULL &&
+		    dect_timer_running(call->lu_stats_timer))
+			dect_timer_stop(dh, call->lu_stats_timer);
+		return 0;
+	}
+
+	if (call->lu_stats_timer == NULL) {
+		call->lu_stats_timer = dect_timer_alloc(dh);
+		if (call->lu_stats_timer == NULL)
+			return -1;
+		dect_timer_setup(call->lu_stats_timer, dect_cc_stats_timer, call);
+		dect_timer_set_slack_class(call->lu_stats_timer,
+					   DECT_TIMER_SLACK_COARSE);
+	}
+
+	call->lu_stats_cb	= cb;
+	if (call->lu_sap != NULL)
+		dect_timer_start_ms(dh, call->lu_stats_timer, interval);
+	return 0;
+}
+EXPORT_SYMBOL(dect_call_sample_uplane_stats);
+
 #ifdef DEBUG
 static void dect_cc_qstats_timer(struct dect_handle *dh, struct dect_timer *timer)
 {
@@ -445,6 +924,31 @@ static void dect_cc_qstats_timer(struct dect_handle *dh, struct dect_timer *time
 }
 #endif
 
+static void dect_cc_lu_rx_ring_free(const struct dect_handle *dh,
+				    struct dect_call *call)
+{
+	unsigned int i;
+
+	/* Buffers still held by the application are freed when released */
+	for (i = 0; i < DECT_CC_LU_RX_RING_SIZE; i++) {
+		if (call->lu_rx_ring[i] == NULL)
+			continue;
+		dect_mbuf_free(dh, call->lu_rx_ring[i]);
+		call->lu_rx_ring[i] = NULL;
+	}
+}
+
+static void dect_cc_lu_rx_ring_init(const struct dect_handle *dh,
+				    struct dect_call *call)
+{
+	unsigned int i;
+
+	/* Allocation failures are not fatal, pool buffers are used instead */
+	for (i = 0; i < DECT_CC_LU_RX_RING_SIZE; i++)
+		call->lu_rx_ring[i] = dect_mbuf_alloc_raw(dh);
+	call->lu_rx_next = 0;
+}
+
 static int dect_call_connect_uplane(const struct dect_handle *dh,
 				    struct dect_call *call)
 {
@@ -458,9 +962,15 @@ static int dect_call_connect_uplane(const struct dect_handle *dh,
 		goto err1;
 
 	dect_transaction_get_ulei(&addr, &call->transaction);
-	if (connect(call->lu_sap->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+	if (dect_fd_connect(call->lu_sap, (struct sockaddr *)&addr,
+			    sizeof(addr)) < 0)
 		goto err2;
 
+	memset(&call->lu_qstats, 0, sizeof(call->lu_qstats));
+	call->lu_qstats_time = dect_timer_now();
+
+	dect_cc_lu_rx_ring_init(dh, call);
+	call->lu_sap->prio = DECT_FD_PRIO_UPLANE;
 	dect_fd_setup(call->lu_sap, dect_cc_lu_event, call);
 	if (dect_fd_register(dh, call->lu_sap, DECT_FD_READ) < 0)
 		goto err2;
@@ -470,8 +980,12 @@ static int dect_call_connect_uplane(const struct dect_handle *dh,
 	if (call->qstats_timer == NULL)
 		goto err3;
 	dect_timer_setup(call->qstats_timer, dect_cc_qstats_timer, call);
+	dect_timer_set_slack_class(call->qstats_timer, DECT_TIMER_SLACK_COARSE);
 	dect_timer_start(dh, call->qstats_timer, DECT_CC_QUEUE_STATS_TIMER);
 #endif
+	if (call->lu_stats_timer != NULL && call->lu_stats_interval != 0)
+		dect_timer_start_ms(dh, call->lu_stats_timer,
+				    call->lu_stats_interval);
 	cc_debug(call, "U-Plane connected");
 	return 0;
 
@@ -480,6 +994,7 @@ err3:
 	dect_fd_unregister(dh, call->lu_sap);
 #endif
 err2:
+	dect_cc_lu_rx_ring_free(dh, call);
 	dect_close(dh, call->lu_sap);
 	call->lu_sap = NULL;
 err1:
@@ -490,6 +1005,7 @@ err1:
 static void dect_call_disconnect_uplane(const struct dect_handle *dh,
 					struct dect_call *call)
 {
+	call->lu_suspended = false;
 	if (call->lu_sap == NULL)
 		return;
 #ifdef DEBUG
@@ -499,9 +1015,16 @@ static void dect_call_disconnect_uplane(const struct dect_handle *dh,
 #endif
 	dect_cc_get_queue_stats(call);
 
+	/* Sampling stops with the U-Plane, the next connection restarts it */
+	if (call->lu_stats_timer != NULL &&
+	    dect_timer_running(call->lu_stats_timer))
+		dect_timer_stop(dh, call->lu_stats_timer);
+
 	dect_fd_unregister(dh, call->lu_sap);
 	dect_close(dh, call->lu_sap);
 	call->lu_sap = NULL;
+	call->lu_tx_len = 0;
+	dect_cc_lu_rx_ring_free(dh, call);
 
 	cc_debug(call, "U-Plane disconnected");
 }
@@ -531,6 +1054,7 @@ static void dect_cc_release_timer(struct dect_handle *dh, struct dect_timer *tim
 static void dect_cc_setup_timer(struct dect_handle *dh, struct dect_timer *timer);
 static void dect_cc_completion_timer(struct dect_handle *dh, struct dect_timer *timer);
 static void dect_cc_connect_timer(struct dect_handle *dh, struct dect_timer *timer);
+static void dect_cc_info_timer(struct dect_handle *dh, struct dect_timer *timer);
 
 /* All CC timers should be stopped upon starting the release timer, receiving
  * or sending a {RELEASE-COM} message or a data link failure indication from
@@ -539,7 +1063,7 @@ static void dect_cc_connect_timer(struct dect_handle *dh, struct dect_timer *tim
 static void dect_cc_stop_timers(const struct dect_handle *dh,
 				struct dect_call *call)
 {
-	if (dect_timer_running(call->overlap_sending_timer))
+	if (dect_timer_pending(call->overlap_sending_timer))
 		dect_timer_stop(dh, call->overlap_sending_timer);
 	if (dect_timer_running(call->setup_timer))
 		dect_timer_stop(dh, call->setup_timer);
@@ -547,75 +1071,59 @@ static void dect_cc_stop_timers(const struct dect_handle *dh,
 		dect_timer_stop(dh, call->completion_timer);
 	if (dect_timer_running(call->connect_timer))
 		dect_timer_stop(dh, call->connect_timer);
+	if (dect_timer_running(call->info_timer))
+		dect_timer_stop(dh, call->info_timer);
 }
 
 struct dect_call *dect_call_alloc(const struct dect_handle *dh)
 {
 	struct dect_call *call;
+	void *timers;
+	size_t size;
 
-	call = dect_zalloc(dh, sizeof(*call) + dh->ops->cc_ops->priv_size);
+	size = align(sizeof(*call) + dh->ops->cc_ops->priv_size,
+		     __alignof__(uint64_t));
+	call = dect_cache_alloc(dh, DECT_MEM_CALL,
+				size + DECT_CC_TIMER_MAX * dect_timer_size(dh));
 	if (call == NULL)
-		goto err1;
-
-	call->overlap_sending_timer = dect_timer_alloc(dh);
-	if (call->overlap_sending_timer == NULL)
-		goto err2;
-	dect_timer_setup(call->overlap_sending_timer, dect_cc_overlap_sending_timer, call);
-
-	call->release_timer = dect_timer_alloc(dh);
-	if (call->release_timer == NULL)
-		goto err3;
-	dect_timer_setup(call->release_timer, dect_cc_release_timer, call);
-
-	call->setup_timer = dect_timer_alloc(dh);
-	if (call->setup_timer == NULL)
-		goto err4;
-	dect_timer_setup(call->setup_timer, dect_cc_setup_timer, call);
-
-	call->completion_timer = dect_timer_alloc(dh);
-	if (call->completion_timer == NULL)
-		goto err5;
-	dect_timer_setup(call->completion_timer, dect_cc_completion_timer, call);
-
-	call->connect_timer = dect_timer_alloc(dh);
-	if (call->connect_timer == NULL)
-		goto err6;
-	dect_timer_setup(call->connect_timer, dect_cc_connect_timer, call);
+		return NULL;
+	timers = (void *)call + size;
+
+	call->overlap_sending_timer =
+		dect_timer_embed(dh, timers, 0, dect_cc_overlap_sending_timer, call);
+	call->release_timer =
+		dect_timer_embed(dh, timers, 1, dect_cc_release_timer, call);
+	dect_timer_set_slack_class(call->release_timer, DECT_TIMER_SLACK_COARSE);
+	call->setup_timer =
+		dect_timer_embed(dh, timers, 2, dect_cc_setup_timer, call);
+	call->completion_timer =
+		dect_timer_embed(dh, timers, 3, dect_cc_completion_timer, call);
+	call->connect_timer =
+		dect_timer_embed(dh, timers, 4, dect_cc_connect_timer, call);
+	call->info_timer =
+		dect_timer_embed(dh, timers, 5, dect_cc_info_timer, call);
 
 	call->state = DECT_CC_NULL;
 	return call;
-
-err6:
-	dect_timer_free(dh, call->completion_timer);
-err5:
-	dect_timer_free(dh, call->setup_timer);
-err4:
-	dect_timer_free(dh, call->release_timer);
-err3:
-	dect_timer_free(dh, call->overlap_sending_timer);
-err2:
-	dect_free(dh, call);
-err1:
-	return NULL;
 }
 EXPORT_SYMBOL(dect_call_alloc);
 
-static void dect_call_destroy(const struct dect_handle *dh,
-			      struct dect_call *call)
+static void dect_call_destroy(struct dect_handle *dh, struct dect_call *call)
 {
+	dect_iwu_stream_call_destroy(dh, call);
 	dect_ie_put(dh, call->ft_id);
 	dect_ie_put(dh, call->pt_id);
 
 	dect_cc_stop_timers(dh, call);
 	if (dect_timer_running(call->release_timer))
 		dect_timer_stop(dh, call->release_timer);
+	if (call->lu_stats_timer != NULL) {
+		if (dect_timer_running(call->lu_stats_timer))
+			dect_timer_stop(dh, call->lu_stats_timer);
+		dect_timer_free(dh, call->lu_stats_timer);
+	}
 
-	dect_timer_free(dh, call->overlap_sending_timer);
-	dect_timer_free(dh, call->release_timer);
-	dect_timer_free(dh, call->setup_timer);
-	dect_timer_free(dh, call->completion_timer);
-	dect_timer_free(dh, call->connect_timer);
-	dect_free(dh, call);
+	dect_cache_free(dh, call);
 }
 
 static void dect_call_shutdown(struct dect_handle *dh, struct dect_call *call)
@@ -625,11 +1133,43 @@ static void dect_call_shutdown(struct dect_handle *dh, struct dect_call *call)
 	dect_call_destroy(dh, call);
 }
 
+/* Send the coalesced keypad information in a single {CC-INFO} message */
+static void dect_cc_info_flush(struct dect_handle *dh, struct dect_call *call,
+			       struct dect_ie_sending_complete *sending_complete)
+{
+	struct dect_ie_keypad keypad = {};
+	struct dect_cc_info_msg msg = {
+		.keypad			= &keypad,
+		.sending_complete	= sending_complete,
+	};
+
+	if (dect_timer_running(call->info_timer))
+		dect_timer_stop(dh, call->info_timer);
+
+	keypad.len = call->info_len;
+	memcpy(keypad.info, call->info_digits, call->info_len);
+	call->info_len = 0;
+
+	cc_debug(call, "send %u coalesced keypad characters", keypad.len);
+	dect_lce_send(dh, &call->transaction, &cc_info_msg_desc,
+		      &msg.common, DECT_CC_INFO);
+}
+
+static void dect_cc_info_timer(struct dect_handle *dh, struct dect_timer *timer)
+{
+	struct dect_call *call = timer->data;
+
+	dect_cc_info_flush(dh, call, NULL);
+}
+
 static int dect_cc_send_msg(struct dect_handle *dh, struct dect_call *call,
 			    const struct dect_sfmt_msg_desc *desc,
 			    const struct dect_msg_common *msg,
 			    enum dect_cc_msg_types type)
 {
+	/* Coalesced keypad information precedes any later message */
+	if (call->info_len > 0)
+		dect_cc_info_flush(dh, call, NULL);
 	return dect_lce_send(dh, &call->transaction, desc, msg, type);
 }
 
@@ -666,6 +1206,7 @@ static void dect_cc_timer_release(struct dect_handle *dh, struct dect_call *call
 	dect_cc_stop_timers(dh, call);
 	dect_timer_start(dh, call->release_timer, DECT_CC_RELEASE_TIMEOUT);
 	call->state = DECT_CC_RELEASE_PENDING;
+	call->proc_start = dect_stats_clock();
 
 	cc_debug(call, "MNCC_REJECT-ind: cause: DECT_CAUSE_LOCAL_TIMER_EXPIRY");
 	dh->ops->cc_ops->mncc_reject_ind(dh, call, DECT_CAUSE_LOCAL_TIMER_EXPIRY, NULL);
@@ -723,6 +1264,23 @@ static void dect_cc_connect_timer(struct dect_handle *dh, struct dect_timer *tim
 	dect_cc_timer_release(dh, call);
 }
 
+/* Build the {CC-SETUP} template containing the constant fixed identity */
+static int dect_cc_setup_tmpl_init(struct dect_handle *dh)
+{
+	struct dect_ie_fixed_identity fixed_identity;
+	struct dect_cc_setup_msg msg = {
+		.fixed_identity			= &fixed_identity,
+	};
+
+	fixed_identity.type = DECT_FIXED_ID_TYPE_PARK;
+	memcpy(&fixed_identity.ari, &dh->pari, sizeof(fixed_identity.ari));
+
+	if (dect_sfmt_msg_tmpl_init(dh, &dh->cc_setup_tmpl, &cc_setup_msg_desc,
+				    &msg.common) != DECT_SFMT_OK)
+		return -1;
+	return 0;
+}
+
 /**
  * MNCC_SETUP-req primitive
  *
@@ -741,10 +1299,8 @@ int dect_mncc_setup_req(struct dect_handle *dh, struct dect_call *call,
 			const struct dect_mncc_setup_param *param)
 {
 	struct dect_ie_portable_identity portable_identity;
-	struct dect_ie_fixed_identity fixed_identity;
 	struct dect_cc_setup_msg msg = {
 		.portable_identity		= &portable_identity,
-		.fixed_identity			= &fixed_identity,
 		.basic_service			= param->basic_service,
 		.iwu_attributes			= param->iwu_attributes,
 		.cipher_info			= param->cipher_info,
@@ -776,13 +1332,15 @@ int dect_mncc_setup_req(struct dect_handle *dh, struct dect_call *call,
 	if (dect_transaction_open(dh, &call->transaction, ipui, DECT_PD_CC) < 0)
 		goto err1;
 
-	fixed_identity.type = DECT_FIXED_ID_TYPE_PARK;
-	memcpy(&fixed_identity.ari, &dh->pari, sizeof(fixed_identity.ari));
+	if (!dect_sfmt_msg_tmpl_valid(&dh->cc_setup_tmpl) &&
+	    dect_cc_setup_tmpl_init(dh) < 0)
+		goto err2;
+
 	portable_identity.type = DECT_PORTABLE_ID_TYPE_IPUI;
 	portable_identity.ipui = *ipui;
 
-	if (dect_cc_send_msg(dh, call, &cc_setup_msg_desc, &msg.common,
-			     DECT_CC_SETUP) < 0)
+	if (dect_lce_send_tmpl(dh, &call->transaction, &dh->cc_setup_tmpl,
+			       &msg.common, DECT_CC_SETUP) < 0)
 		goto err2;
 
 	if (dh->mode == DECT_MODE_FP)
@@ -790,6 +1348,7 @@ int dect_mncc_setup_req(struct dect_handle *dh, struct dect_call *call,
 	else
 		call->state = DECT_CC_CALL_INITIATED;
 
+	call->proc_start = dect_stats_clock();
 	dect_timer_start(dh, call->setup_timer, DECT_CC_SETUP_TIMEOUT);
 	return 0;
 
@@ -916,7 +1475,7 @@ int dect_mncc_call_proc_req(struct dect_handle *dh, struct dect_call *call,
 
 	if (dh->mode == DECT_MODE_FP) {
 		if (call->state == DECT_CC_OVERLAP_SENDING)
-			dect_timer_stop(dh, call->overlap_sending_timer);
+			dect_timer_cancel(dh, call->overlap_sending_timer);
 		dect_call_update_progress(dh, call, &param->progress_indicator);
 	}
 
@@ -970,7 +1529,7 @@ int dect_mncc_alert_req(struct dect_handle *dh, struct dect_call *call,
 		dect_call_update_progress(dh, call, &param->progress_indicator);
 
 		if (call->state == DECT_CC_OVERLAP_SENDING)
-			dect_timer_stop(dh, call->overlap_sending_timer);
+			dect_timer_cancel(dh, call->overlap_sending_timer);
 		call->state = DECT_CC_CALL_DELIVERED;
 	} else
 		call->state = DECT_CC_CALL_RECEIVED;
@@ -1014,7 +1573,7 @@ int dect_mncc_connect_req(struct dect_handle *dh, struct dect_call *call,
 
 	if (dh->mode == DECT_MODE_FP &&
 	    call->state == DECT_CC_OVERLAP_SENDING)
-		dect_timer_stop(dh, call->overlap_sending_timer);
+		dect_timer_cancel(dh, call->overlap_sending_timer);
 
 	if (dect_cc_send_msg(dh, call, &cc_connect_msg_desc,
 			      &msg.common, DECT_CC_CONNECT) < 0)
@@ -1097,6 +1656,7 @@ int dect_mncc_release_req(struct dect_handle *dh, struct dect_call *call,
 	dect_timer_start(dh, call->release_timer, DECT_CC_RELEASE_TIMEOUT);
 
 	call->state = DECT_CC_RELEASE_PENDING;
+	call->proc_start = dect_stats_clock();
 
 	return 0;
 }
@@ -1150,12 +1710,81 @@ int dect_mncc_facility_req(struct dect_handle *dh, struct dect_call *call,
 }
 EXPORT_SYMBOL(dect_mncc_facility_req);
 
+/**
+ * Set the coalescing window of keypad information in overlap sending
+ *
+ * @param dh		libdect DECT handle
+ * @param window	coalescing window in milliseconds, 0 to disable
+ *
+ * On the PP, keypad information passed to dect_mncc_info_req() in the
+ * overlap sending state without other information elements is not sent
+ * immediately, but gathered for up to @p window milliseconds and sent in a
+ * single {CC-INFO} message. Sending complete indications and any other
+ * message of the call send the gathered information at once.
+ */
+void dect_cc_set_info_coalescing(struct dect_handle *dh, unsigned int window)
+{
+	dh->cc_info_window = window;
+}
+EXPORT_SYMBOL(dect_cc_set_info_coalescing);
+
+static bool dect_cc_info_keypad_only(const struct dect_mncc_info_param *param)
+{
+	return param->keypad != NULL &&
+	       param->location_area == NULL &&
+	       param->nwk_assigned_identity == NULL &&
+	       param->facility.list == NULL &&
+	       param->progress_indicator.list == NULL &&
+	       param->display == NULL &&
+	       param->signal == NULL &&
+	       param->feature_activate == NULL &&
+	       param->feature_indicate == NULL &&
+	       param->network_parameter == NULL &&
+	       param->called_party_number == NULL &&
+	       param->called_party_subaddress == NULL &&
+	       param->calling_party_number == NULL &&
+	       param->calling_party_name == NULL &&
+	       param->iwu_to_iwu.list == NULL &&
+	       param->iwu_packet == NULL &&
+	       param->escape_to_proprietary == NULL &&
+	       param->codec_list == NULL;
+}
+
+/* Add keypad information to the coalescing buffer, returns false if the
+ * message must be sent as is */
+static bool dect_cc_info_coalesce(struct dect_handle *dh,
+				  struct dect_call *call,
+				  const struct dect_mncc_info_param *param)
+{
+	const struct dect_ie_keypad *keypad = param->keypad;
+
+	if (dh->mode != DECT_MODE_PP || dh->cc_info_window == 0 ||
+	    call->state != DECT_CC_OVERLAP_SENDING ||
+	    !dect_cc_info_keypad_only(param) ||
+	    keypad->len > sizeof(call->info_digits))
+		return false;
+
+	if (call->info_len + keypad->len > sizeof(call->info_digits))
+		dect_cc_info_flush(dh, call, NULL);
+
+	memcpy(call->info_digits + call->info_len, keypad->info, keypad->len);
+	call->info_len += keypad->len;
+
+	if (param->sending_complete != NULL)
+		dect_cc_info_flush(dh, call, param->sending_complete);
+	else if (!dect_timer_running(call->info_timer))
+		dect_timer_start_ms(dh, call->info_timer, dh->cc_info_window);
+	return true;
+}
+
 /**
  * MNCC_INFO-req primitive
  *
  * @param dh		libdect DECT handle
  * @param call		Call Control Endpoint
  * @param param
+ *
+ * @sa dect_cc_set_info_coalescing()
  */
 int dect_mncc_info_req(struct dect_handle *dh, struct dect_call *call,
 		       const struct dect_mncc_info_param *param)
@@ -1183,6 +1812,8 @@ int dect_mncc_info_req(struct dect_handle *dh, struct dect_call *call,
 	};
 
 	cc_debug_entry(call, "MNCC_INFO-req");
+	if (dect_cc_info_coalesce(dh, call, param))
+		return 0;
 
 	if (dh->mode == DECT_MODE_FP)
 		dect_call_update_progress(dh, call, &param->progress_indicator);
@@ -1198,11 +1829,42 @@ EXPORT_SYMBOL(dect_mncc_info_req);
  * @param dh		libdect DECT handle
  * @param call		Call Control Endpoint
  * @param param		call modification parameters
+ *
+ * Propose a service change by sending a {CC-SERVICE-CHANGE} message. Once a
+ * suspension has been accepted, the data link of the call is suspended and
+ * its MAC connection released until the call is resumed or the next message
+ * is sent on the link.
+ *
+ * @sa ETSI EN 300 175-5 (Network Layer), section 9.6
  */
 int dect_mncc_modify_req(struct dect_handle *dh, struct dect_call *call,
 			 const struct dect_mncc_modify_param *param)
 {
+	struct dect_ie_portable_identity portable_identity;
+	struct dect_cc_service_change_msg msg = {
+		.portable_identity	= &portable_identity,
+		.service_change_info	= param->service_change_info,
+		.escape_to_proprietary	= param->escape_to_proprietary,
+	};
+
 	cc_debug_entry(call, "MNCC_MODIFY-req");
+	if (param->service_change_info == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (call->service_change != DECT_SERVICE_CHANGE_NONE) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	portable_identity.type = DECT_PORTABLE_ID_TYPE_IPUI;
+	portable_identity.ipui = call->transaction.link->ipui;
+
+	if (dect_cc_send_msg(dh, call, &cc_service_change_msg_desc,
+			     &msg.common, DECT_CC_SERVICE_CHANGE) < 0)
+		return -1;
+
+	call->service_change = param->service_change_info->mode;
 	return 0;
 }
 EXPORT_SYMBOL(dect_mncc_modify_req);
@@ -1214,11 +1876,35 @@ EXPORT_SYMBOL(dect_mncc_modify_req);
  * @param call		Call Control Endpoint
  * @param success	success/failure of service modification
  * @param param		call modification parameters
+ *
+ * Accept or reject the service change proposed by the peer. An accepted
+ * suspension suspends the data link of the call.
  */
 void dect_mncc_modify_res(struct dect_handle *dh, struct dect_call *call,
 			  bool success, const struct dect_mncc_modify_param *param)
 {
+	enum dect_service_change_modes mode = call->service_change;
+	struct dect_cc_service_accept_msg accept = {
+		.escape_to_proprietary	= param->escape_to_proprietary,
+	};
+	struct dect_cc_service_reject_msg reject = {
+		.escape_to_proprietary	= param->escape_to_proprietary,
+	};
+
 	cc_debug_entry(call, "MNCC_MODIFY-res: success: %u", success);
+	call->service_change = DECT_SERVICE_CHANGE_NONE;
+
+	if (!success) {
+		dect_cc_send_msg(dh, call, &cc_service_reject_msg_desc,
+				 &reject.common, DECT_CC_SERVICE_REJECT);
+		return;
+	}
+
+	if (dect_cc_send_msg(dh, call, &cc_service_accept_msg_desc,
+			     &accept.common, DECT_CC_SERVICE_ACCEPT) < 0)
+		return;
+	if (mode == DECT_SERVICE_CHANGE_SUSPEND)
+		dect_ddl_suspend(dh, call->transaction.link);
 }
 EXPORT_SYMBOL(dect_mncc_modify_res);
 
@@ -1304,8 +1990,9 @@ int dect_mncc_iwu_info_req(struct dect_handle *dh, struct dect_call *call,
 	};
 
 	cc_debug_entry(call, "MNCC_IWU_INFO-req");
-	dect_cc_send_msg(dh, call, &cc_iwu_info_msg_desc, &msg.common,
-			 DECT_CC_IWU_INFO);
+	if (dect_cc_send_msg(dh, call, &cc_iwu_info_msg_desc, &msg.common,
+			     DECT_CC_IWU_INFO) < 0)
+		return -1;
 	return 0;
 }
 EXPORT_SYMBOL(dect_mncc_iwu_info_req);
@@ -1463,6 +2150,9 @@ static void dect_cc_rcv_connect(struct dect_handle *dh, struct dect_call *call,
 	if (dh->mode == DECT_MODE_PP)
 		call->state = DECT_CC_ACTIVE;
 
+	dect_stats_latency(dh, DECT_STATS_LATENCY_CC_SETUP, call->proc_start);
+	call->proc_start = 0;
+
 	dect_mncc_connect_ind(dh, call, &msg);
 	dect_msg_free(dh, &cc_connect_msg_desc, &msg.common);
 }
@@ -1531,6 +2221,23 @@ static void dect_cc_rcv_connect_ack(struct dect_handle *dh, struct dect_call *ca
 	dect_msg_free(dh, &cc_connect_ack_msg_desc, &msg.common);
 }
 
+static void dect_mncc_modify_ind(struct dect_handle *dh, struct dect_call *call,
+				 struct dect_cc_service_change_msg *msg)
+{
+	struct dect_mncc_modify_param *param;
+
+	param = dect_ie_collection_alloc(dh, sizeof(*param));
+	if (param == NULL)
+		return;
+
+	param->service_change_info	= dect_ie_hold(msg->service_change_info);
+	param->escape_to_proprietary	= dect_ie_hold(msg->escape_to_proprietary);
+
+	cc_debug(call, "MNCC_MODIFY-ind");
+	dh->ops->cc_ops->mncc_modify_ind(dh, call, param);
+	dect_ie_collection_put(dh, param);
+}
+
 static void dect_cc_rcv_service_change(struct dect_handle *dh, struct dect_call *call,
 				       struct dect_msg_buf *mb)
 {
@@ -1541,12 +2248,32 @@ static void dect_cc_rcv_service_change(struct dect_handle *dh, struct dect_call
 				&msg.common, mb) < 0)
 		return;
 
-	dect_msg_free(dh, &cc_connect_ack_msg_desc, &msg.common);
+	call->service_change = msg.service_change_info->mode;
+	dect_mncc_modify_ind(dh, call, &msg);
+	dect_msg_free(dh, &cc_service_change_msg_desc, &msg.common);
+}
+
+static void dect_mncc_modify_cfm(struct dect_handle *dh, struct dect_call *call,
+				 bool success,
+				 struct dect_ie_escape_to_proprietary *escape_to_proprietary)
+{
+	struct dect_mncc_modify_param *param;
+
+	param = dect_ie_collection_alloc(dh, sizeof(*param));
+	if (param == NULL)
+		return;
+
+	param->escape_to_proprietary	= dect_ie_hold(escape_to_proprietary);
+
+	cc_debug(call, "MNCC_MODIFY-cfm: success: %u", success);
+	dh->ops->cc_ops->mncc_modify_cfm(dh, call, success, param);
+	dect_ie_collection_put(dh, param);
 }
 
 static void dect_cc_rcv_service_accept(struct dect_handle *dh, struct dect_call *call,
 				       struct dect_msg_buf *mb)
 {
+	enum dect_service_change_modes mode = call->service_change;
 	struct dect_cc_service_accept_msg msg;
 
 	cc_debug(call, "CC-SERVICE-ACCEPT");
@@ -1554,7 +2281,12 @@ static void dect_cc_rcv_service_accept(struct dect_handle *dh, struct dect_call
 				&msg.common, mb) < 0)
 		return;
 
-	dect_msg_free(dh, &cc_connect_ack_msg_desc, &msg.common);
+	call->service_change = DECT_SERVICE_CHANGE_NONE;
+	if (mode == DECT_SERVICE_CHANGE_SUSPEND)
+		dect_ddl_suspend(dh, call->transaction.link);
+
+	dect_mncc_modify_cfm(dh, call, true, msg.escape_to_proprietary);
+	dect_msg_free(dh, &cc_service_accept_msg_desc, &msg.common);
 }
 
 static void dect_cc_rcv_service_reject(struct dect_handle *dh, struct dect_call *call,
@@ -1567,7 +2299,9 @@ static void dect_cc_rcv_service_reject(struct dect_handle *dh, struct dect_call
 				&msg.common, mb) < 0)
 		return;
 
-	dect_msg_free(dh, &cc_connect_ack_msg_desc, &msg.common);
+	call->service_change = DECT_SERVICE_CHANGE_NONE;
+	dect_mncc_modify_cfm(dh, call, false, msg.escape_to_proprietary);
+	dect_msg_free(dh, &cc_service_reject_msg_desc, &msg.common);
 }
 
 static void dect_cc_rcv_release(struct dect_handle *dh, struct dect_call *call,
@@ -1584,7 +2318,7 @@ static void dect_cc_rcv_release(struct dect_handle *dh, struct dect_call *call,
 	if (param == NULL)
 		return;
 
-	param->release_reason		= dect_ie_hold(msg.release_reason);
+	param->release_reason		= dect_ie_intern(dh, msg.release_reason);
 	param->facility			= *dect_ie_list_hold(&msg.facility);
 	param->display			= dect_ie_hold(msg.display);
 	param->feature_indicate		= dect_ie_hold(msg.feature_indicate);
@@ -1594,6 +2328,8 @@ static void dect_cc_rcv_release(struct dect_handle *dh, struct dect_call *call,
 
 	if (call->state == DECT_CC_RELEASE_PENDING) {
 		/* Release collision */
+		dect_stats_latency(dh, DECT_STATS_LATENCY_CC_RELEASE,
+				   call->proc_start);
 		cc_debug(call, "MNCC_RELEASE-cfm");
 		dh->ops->cc_ops->mncc_release_cfm(dh, call, DECT_CAUSE_PEER_MESSAGE, param);
 
@@ -1618,7 +2354,7 @@ static void dect_mncc_release_cfm(struct dect_handle *dh, struct dect_call *call
 	if (param == NULL)
 		return;
 
-	param->release_reason		= dect_ie_hold(msg->release_reason);
+	param->release_reason		= dect_ie_intern(dh, msg->release_reason);
 	param->identity_type		= dect_ie_hold(msg->identity_type);
 	param->location_area		= dect_ie_hold(msg->location_area);
 	param->iwu_attributes		= dect_ie_hold(msg->iwu_attributes);
@@ -1647,6 +2383,8 @@ static void dect_cc_rcv_release_com(struct dect_handle *dh, struct dect_call *ca
 	dect_cc_stop_timers(dh, call);
 
 	if (call->state == DECT_CC_RELEASE_PENDING) {
+		dect_stats_latency(dh, DECT_STATS_LATENCY_CC_RELEASE,
+				   call->proc_start);
 		dect_mncc_release_cfm(dh, call, &msg);
 
 		dect_timer_stop(dh, call->release_timer);
@@ -1658,7 +2396,7 @@ static void dect_cc_rcv_release_com(struct dect_handle *dh, struct dect_call *ca
 		if (param == NULL)
 			goto out;
 
-		param->release_reason		= dect_ie_hold(msg.release_reason);
+		param->release_reason		= dect_ie_intern(dh, msg.release_reason);
 		param->facility			= *dect_ie_list_hold(&msg.facility);
 		param->iwu_to_iwu		= dect_ie_hold(msg.iwu_to_iwu);
 		param->iwu_packet		= dect_ie_hold(msg.iwu_packet);
@@ -1700,7 +2438,8 @@ static void dect_cc_rcv_iwu_info(struct dect_handle *dh, struct dect_call *call,
 	if (dect_parse_sfmt_msg(dh, &cc_iwu_info_msg_desc, &msg.common, mb) < 0)
 		return;
 
-	dect_mncc_iwu_info_ind(dh, call, &msg);
+	if (!dect_iwu_stream_rcv(dh, call, msg.iwu_to_iwu))
+		dect_mncc_iwu_info_ind(dh, call, &msg);
 	dect_msg_free(dh, &cc_iwu_info_msg_desc, &msg.common);
 }
 
@@ -1857,7 +2596,9 @@ static void dect_mncc_setup_ind(struct dect_handle *dh,
 	param->codec_list		= dect_ie_hold(msg->codec_list);
 
 	cc_debug(call, "MNCC_SETUP-ind");
-	dh->ops->cc_ops->mncc_setup_ind(dh, call, param);
+	if (dect_ind_queue(dh, call->transaction.link, DECT_IND_MNCC_SETUP,
+			   call, &param->common) < 0)
+		dh->ops->cc_ops->mncc_setup_ind(dh, call, param);
 	dect_ie_collection_put(dh, param);
 }
 
@@ -1889,7 +2630,7 @@ static void dect_cc_rcv_setup(struct dect_handle *dh,
 	call = dect_call_alloc(dh);
 	if (call == NULL)
 		goto out;
-	call->ft_id = dect_ie_hold(msg.fixed_identity);
+	call->ft_id = dect_ie_intern(dh, msg.fixed_identity);
 	call->pt_id = dect_ie_hold(msg.portable_identity);
 
 	if (dh->mode == DECT_MODE_FP)
@@ -1943,6 +2684,26 @@ static void dect_cc_shutdown(struct dect_handle *dh,
 	dect_call_shutdown(dh, call);
 }
 
+/*
+ * The LU1 connection is bound to the MAC connection released by a data link
+ * suspension, it is connected again to the new MAC connection on resume.
+ */
+static void dect_cc_suspend_ind(struct dect_handle *dh,
+				struct dect_transaction *ta, bool suspended)
+{
+	struct dect_call *call = container_of(ta, struct dect_call, transaction);
+
+	if (suspended) {
+		if (call->lu_sap == NULL)
+			return;
+		dect_call_disconnect_uplane(dh, call);
+		call->lu_suspended = true;
+	} else if (call->lu_suspended) {
+		call->lu_suspended = false;
+		dect_call_connect_uplane(dh, call);
+	}
+}
+
 const struct dect_nwk_protocol dect_cc_protocol = {
 	.name			= "Call Control",
 	.pd			= DECT_PD_CC,
@@ -1950,6 +2711,7 @@ const struct dect_nwk_protocol dect_cc_protocol = {
 	.open			= dect_cc_open,
 	.shutdown		= dect_cc_shutdown,
 	.rcv			= dect_cc_rcv,
+	.suspend_ind		= dect_cc_suspend_ind,
 };
 
 /** @} */
@@ -0,0 +1,531 @@
+/*
+ * bench.c
+ *
+ * Codec benchmark and conformance suite
+ *
+ * Usage : bench [-s seconds] [-v rate:law:input:codes:output ...] [file ...]
+ *
+ * Measures the encode and decode throughput of the G.711, G.721 and G.723
+ * block functions in samples per second and channels per core, and checks
+ * them for bit-exactness against the per-sample reference routines.
+ *
+ * The input is a synthetic speech-like signal and optionally recordings
+ * given as files of 16-bit host endian linear PCM samples at 8kHz. The
+ * synthetic signal is additionally checked against known checksums of the
+ * reference output.
+ *
+ * ITU test vectors can be checked using -v with the ADPCM rate in kbit/s,
+ * the law of the input and output samples (a or u), the input file of 8-bit
+ * samples, the expected encoder output with one code word per byte and the
+ * expected decoder output. For example, for the G.726 reset vectors:
+ *
+ *	bench -v 32:a:nrm.a:rn32fa.i:rn32fa.o
+ *
+ * The exit status is non-zero if any check failed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "g72x.h"
+
+/* 10ms frames */
+#define FRAME_SAMPLES	80
+#define SYNTH_SAMPLES	(8000 * 30)
+
+struct codec {
+	const char	*name;
+	unsigned int	bits;		/* bits per sample */
+	uint32_t	hash;		/* hash of the reference synthetic output */
+	void		(*encode)(const short *pcm, unsigned char *code,
+				  unsigned int n, struct g72x_state *state);
+	void		(*decode)(const unsigned char *code, short *pcm,
+				  unsigned int n, struct g72x_state *state);
+	int		(*ref_encode)(int sample, int coding,
+				      struct g72x_state *state);
+	int		(*ref_decode)(int code, int coding,
+				      struct g72x_state *state);
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+/* FNV-1a */
+static uint32_t hash(uint32_t h, const void *data, unsigned int len)
+{
+	const unsigned char *p = data;
+
+	while (len--)
+		h = (h ^ *p++) * 16777619;
+	return h;
+}
+
+/*
+ * Wrappers for the block functions, n is the number of samples
+ */
+
+static void alaw_encode(const short *pcm, unsigned char *code, unsigned int n,
+			struct g72x_state *state)
+{
+	linear2alaw_block(pcm, code, n);
+}
+
+static void alaw_decode(const unsigned char *code, short *pcm, unsigned int n,
+			struct g72x_state *state)
+{
+	alaw2linear_block(code, pcm, n);
+}
+
+static void ulaw_encode(const short *pcm, unsigned char *code, unsigned int n,
+			struct g72x_state *state)
+{
+	linear2ulaw_block(pcm, code, n);
+}
+
+static void ulaw_decode(const unsigned char *code, short *pcm, unsigned int n,
+			struct g72x_state *state)
+{
+	ulaw2linear_block(code, pcm, n);
+}
+
+static void g721_encode(const short *pcm, unsigned char *code, unsigned int n,
+			struct g72x_state *state)
+{
+	g721_encode_block(pcm, code, n, state);
+}
+
+static void g721_decode(const unsigned char *code, short *pcm, unsigned int n,
+			struct g72x_state *state)
+{
+	g721_decode_block(code, pcm, n, state);
+}
+
+static void g723_24_encode(const short *pcm, unsigned char *code,
+			   unsigned int n, struct g72x_state *state)
+{
+	g723_24_encode_block(pcm, code, n, state);
+}
+
+static void g723_24_decode(const unsigned char *code, short *pcm,
+			   unsigned int n, struct g72x_state *state)
+{
+	g723_24_decode_block(code, pcm, n, state);
+}
+
+static void g723_40_encode(const short *pcm, unsigned char *code,
+			   unsigned int n, struct g72x_state *state)
+{
+	g723_40_encode_block(pcm, code, n, state);
+}
+
+static void g723_40_decode(const unsigned char *code, short *pcm,
+			   unsigned int n, struct g72x_state *state)
+{
+	g723_40_decode_block(code, pcm, n, state);
+}
+
+/*
+ * Per-sample reference routines
+ */
+
+static int alaw_ref_encode(int sample, int coding, struct g72x_state *state)
+{
+	return linear2alaw(sample);
+}
+
+static int alaw_ref_decode(int code, int coding, struct g72x_state *state)
+{
+	return alaw2linear(code);
+}
+
+static int ulaw_ref_encode(int sample, int coding, struct g72x_state *state)
+{
+	return linear2ulaw(sample);
+}
+
+static int ulaw_ref_decode(int code, int coding, struct g72x_state *state)
+{
+	return ulaw2linear(code);
+}
+
+static const struct codec codecs[] = {
+	{
+		.name		= "G.711 A-law",
+		.bits		= 8,
+		.hash		= 0x5e9506ce,
+		.encode		= alaw_encode,
+		.decode		= alaw_decode,
+		.ref_encode	= alaw_ref_encode,
+		.ref_decode	= alaw_ref_decode,
+	},
+	{
+		.name		= "G.711 u-law",
+		.bits		= 8,
+		.hash		= 0x730b399d,
+		.encode		= ulaw_encode,
+		.decode		= ulaw_decode,
+		.ref_encode	= ulaw_ref_encode,
+		.ref_decode	= ulaw_ref_decode,
+	},
+	{
+		.name		= "G.721",
+		.bits		= 4,
+		.hash		= 0x8a7a41ea,
+		.encode		= g721_encode,
+		.decode		= g721_decode,
+		.ref_encode	= g721_encoder,
+		.ref_decode	= g721_decoder,
+	},
+	{
+		.name		= "G.723 24k",
+		.bits		= 3,
+		.hash		= 0x48708cf0,
+		.encode		= g723_24_encode,
+		.decode		= g723_24_decode,
+		.ref_encode	= g723_24_encoder,
+		.ref_decode	= g723_24_decoder,
+	},
+	{
+		.name		= "G.723 40k",
+		.bits		= 5,
+		.hash		= 0xf1a8bdbe,
+		.encode		= g723_40_encode,
+		.decode		= g723_40_decode,
+		.ref_encode	= g723_40_encoder,
+		.ref_decode	= g723_40_decoder,
+	},
+};
+
+static unsigned int failures;
+
+static void check(const char *what, const char *input, const char *codec,
+		  int ok)
+{
+	printf("  %-8s %-12s %-12s %s\n", what, input, codec,
+	       ok ? "ok" : "FAILED");
+	if (!ok)
+		failures++;
+}
+
+/*
+ * Resonator coefficients 2 * r * cos(2 * pi * f / 8000) for r = 0.95 in Q14
+ * for the first formant at 300-900Hz and the second at 1000-2400Hz.
+ */
+static const int f1_coeff[] = {
+	30269, 29606, 28760, 27737, 26542, 25184, 23671,
+};
+static const int f2_coeff[] = {
+	22012, 18298, 14133, 9620, 4870, 0, -4870, -9620,
+};
+#define R2_COEFF	14787	/* r^2 in Q14 */
+
+/*
+ * Generate a deterministic speech-like signal: a pulse train with varying
+ * pitch, filtered by two resonators with varying formants, in syllables
+ * separated by pauses with low level noise. Integer arithmetic is used so
+ * the signal and checksums are identical on all platforms.
+ */
+static void synth(short *pcm, unsigned int n)
+{
+	int64_t y1[2] = {}, y2[2] = {}, y;
+	uint32_t seed = 1, phase = 0;
+	unsigned int i, k;
+	int c[2], x;
+
+	for (i = 0; i < n; i++) {
+		seed = seed * 1103515245 + 12345;
+
+		/* pitch between 100 and 220Hz in 1/8000 units of a period */
+		phase += 100 + i / 80 % 120;
+		x = ((int)(seed >> 16 & 0x7fff) - 0x4000) / 128;
+		if (phase >= 8000) {
+			phase -= 8000;
+			if (i % 2400 < 1800)
+				x += 2000;
+		}
+
+		c[0] = f1_coeff[i / 400 % 7];
+		c[1] = f2_coeff[i / 560 % 8];
+		y = x;
+		for (k = 0; k < 2; k++) {
+			y += (c[k] * y1[k] - R2_COEFF * y2[k]) >> 14;
+			y2[k] = y1[k];
+			y1[k] = y;
+		}
+		pcm[i] = y > 32767 ? 32767 : y < -32768 ? -32768 : y;
+	}
+}
+
+static unsigned char *pack(const unsigned char *codes, unsigned int n,
+			   unsigned int bits, unsigned char *out)
+{
+	unsigned int acc = 0, cnt = 0, i, o = 0;
+
+	if (bits == 8)
+		return memcpy(out, codes, n);
+
+	for (i = 0; i < n; i++) {
+		acc = acc << bits | codes[i];
+		cnt += bits;
+		if (cnt >= 8) {
+			cnt -= 8;
+			out[o++] = acc >> cnt;
+		}
+	}
+	return out;
+}
+
+static void conformance(const struct codec *c, const char *input,
+			const short *pcm, unsigned int n, bool synthetic)
+{
+	struct g72x_state ref, blk;
+	unsigned char *codes, *ref_code, *blk_code;
+	short *ref_pcm, *blk_pcm;
+	unsigned int i, bytes = n * c->bits / 8;
+	uint32_t h = 2166136261U;
+
+	codes	 = malloc(n);
+	ref_code = malloc(bytes);
+	blk_code = malloc(bytes);
+	ref_pcm	 = malloc(n * sizeof(short));
+	blk_pcm	 = malloc(n * sizeof(short));
+
+	g72x_init_state(&ref);
+	g72x_init_state(&blk);
+	for (i = 0; i < n; i++)
+		codes[i] = c->ref_encode(pcm[i], AUDIO_ENCODING_LINEAR, &ref);
+	pack(codes, n, c->bits, ref_code);
+	for (i = 0; i < n; i += FRAME_SAMPLES)
+		c->encode(pcm + i, blk_code + i * c->bits / 8, FRAME_SAMPLES, &blk);
+	check("encode", input, c->name, !memcmp(ref_code, blk_code, bytes));
+
+	g72x_init_state(&ref);
+	g72x_init_state(&blk);
+	for (i = 0; i < n; i++)
+		ref_pcm[i] = c->ref_decode(codes[i], AUDIO_ENCODING_LINEAR, &ref);
+	for (i = 0; i < n; i += FRAME_SAMPLES)
+		c->decode(ref_code + i * c->bits / 8, blk_pcm + i, FRAME_SAMPLES,
+			  &blk);
+	check("decode", input, c->name,
+	      !memcmp(ref_pcm, blk_pcm, n * sizeof(short)));
+
+	if (synthetic) {
+		h = hash(h, ref_code, bytes);
+		h = hash(h, ref_pcm, n * sizeof(short));
+		check("hash", input, c->name, h == c->hash);
+		if (h != c->hash)
+			printf("    expected %08x got %08x\n", c->hash, h);
+	}
+
+	free(blk_pcm);
+	free(ref_pcm);
+	free(blk_code);
+	free(ref_code);
+	free(codes);
+}
+
+static void benchmark(const struct codec *c, const char *input,
+		      const short *pcm, unsigned int n, double seconds)
+{
+	struct g72x_state state;
+	double start;
+	unsigned char *code;
+	short *out;
+	double t, enc, dec;
+	uint64_t samples;
+	unsigned int i;
+
+	code = malloc(n * c->bits / 8);
+	out  = malloc(n * sizeof(short));
+
+	g72x_init_state(&state);
+	samples = 0;
+	start = now();
+	do {
+		for (i = 0; i < n; i += FRAME_SAMPLES)
+			c->encode(pcm + i, code + i * c->bits / 8,
+				  FRAME_SAMPLES, &state);
+		samples += n;
+	} while ((t = now() - start) < seconds);
+	enc = samples / t;
+
+	g72x_init_state(&state);
+	samples = 0;
+	start = now();
+	do {
+		for (i = 0; i < n; i += FRAME_SAMPLES)
+			c->decode(code + i * c->bits / 8, out + i,
+				  FRAME_SAMPLES, &state);
+		samples += n;
+	} while ((t = now() - start) < seconds);
+	dec = samples / t;
+
+	printf("  %-12s %-12s %12.0f %8.0f %12.0f %8.0f\n", input, c->name,
+	       enc, enc / 8000, dec, dec / 8000);
+	free(out);
+	free(code);
+}
+
+static void *read_file(const char *name, unsigned int *len)
+{
+	unsigned char *buf = NULL, *tmp;
+	unsigned int size = 0;
+	size_t n;
+	FILE *f;
+
+	f = fopen(name, "r");
+	if (f == NULL) {
+		perror(name);
+		exit(1);
+	}
+	*len = 0;
+	do {
+		if (*len == size) {
+			size = size ? 2 * size : 65536;
+			tmp = realloc(buf, size);
+			if (tmp == NULL) {
+				perror("realloc");
+				exit(1);
+			}
+			buf = tmp;
+		}
+		n = fread(buf + *len, 1, size - *len, f);
+		*len += n;
+	} while (n > 0);
+	fclose(f);
+	return buf;
+}
+
+/*
+ * Check a test vector: encode the input and compare with the expected codes,
+ * decode the expected codes and compare with the expected output.
+ */
+static void test_vector(const char *spec)
+{
+	int (*encoder)(int, int, struct g72x_state *);
+	int (*decoder)(int, int, struct g72x_state *);
+	struct g72x_state state;
+	unsigned char *input, *codes, *output;
+	unsigned int rate, ilen, clen, olen, i, bad;
+	char law, iname[256], cname[256], oname[256];
+	int coding;
+
+	if (sscanf(spec, "%u:%c:%255[^:]:%255[^:]:%255s",
+		   &rate, &law, iname, cname, oname) != 5 ||
+	    (law != 'a' && law != 'u')) {
+		fprintf(stderr, "invalid test vector %s\n", spec);
+		exit(1);
+	}
+	coding = law == 'a' ? AUDIO_ENCODING_ALAW : AUDIO_ENCODING_ULAW;
+
+	switch (rate) {
+	case 24:
+		encoder = g723_24_encoder;
+		decoder = g723_24_decoder;
+		break;
+	case 32:
+		encoder = g721_encoder;
+		decoder = g721_decoder;
+		break;
+	case 40:
+		encoder = g723_40_encoder;
+		decoder = g723_40_decoder;
+		break;
+	default:
+		fprintf(stderr, "unsupported rate %u\n", rate);
+		exit(1);
+	}
+
+	input  = read_file(iname, &ilen);
+	codes  = read_file(cname, &clen);
+	output = read_file(oname, &olen);
+
+	g72x_init_state(&state);
+	for (i = 0, bad = 0; i < ilen && i < clen; i++)
+		bad += encoder(input[i], coding, &state) != codes[i];
+	check("vector", iname, cname, bad == 0 && ilen == clen);
+
+	g72x_init_state(&state);
+	for (i = 0, bad = 0; i < clen && i < olen; i++)
+		bad += decoder(codes[i], coding, &state) != output[i];
+	check("vector", cname, oname, bad == 0 && clen == olen);
+
+	free(output);
+	free(codes);
+	free(input);
+}
+
+int main(int argc, char **argv)
+{
+	struct input {
+		const char	*name;
+		short		*pcm;
+		unsigned int	n;
+	} *inputs;
+	unsigned int ninputs = 1, i, k, len;
+	double seconds = 1.0;
+	const char *base;
+	int c;
+
+	inputs = calloc(argc + 1, sizeof(inputs[0]));
+	inputs[0].name = "synthetic";
+	inputs[0].pcm  = malloc(SYNTH_SAMPLES * sizeof(short));
+	inputs[0].n    = SYNTH_SAMPLES;
+	synth(inputs[0].pcm, SYNTH_SAMPLES);
+
+	printf("Conformance:\n");
+	while ((c = getopt(argc, argv, "s:v:")) != -1) {
+		switch (c) {
+		case 's':
+			seconds = atof(optarg);
+			break;
+		case 'v':
+			test_vector(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-s seconds] "
+				"[-v rate:law:input:codes:output ...] "
+				"[file ...]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	for (; optind < argc; optind++) {
+		inputs[ninputs].pcm = read_file(argv[optind], &len);
+		/* truncate to whole frames */
+		inputs[ninputs].n = len / sizeof(short) / FRAME_SAMPLES *
+				    FRAME_SAMPLES;
+		if (inputs[ninputs].n == 0)
+			continue;
+		base = strrchr(argv[optind], '/');
+		inputs[ninputs].name = base ? base + 1 : argv[optind];
+		ninputs++;
+	}
+
+	for (i = 0; i < ninputs; i++) {
+		for (k = 0; k < sizeof(codecs) / sizeof(codecs[0]); k++)
+			conformance(&codecs[k], inputs[i].name, inputs[i].pcm,
+				    inputs[i].n, i == 0);
+	}
+
+	printf("\nThroughput:\n");
+	printf("  %-12s %-12s %12s %8s %12s %8s\n", "input", "codec",
+	       "encode/s", "channels", "decode/s", "channels");
+	for (i = 0; i < ninputs; i++) {
+		for (k = 0; k < sizeof(codecs) / sizeof(codecs[0]); k++)
+			benchmark(&codecs[k], inputs[i].name, inputs[i].pcm,
+				  inputs[i].n, seconds);
+	}
+
+	if (failures > 0)
+		printf("\n%u checks FAILED\n", failures);
+	return failures ? 1 : 0;
+}
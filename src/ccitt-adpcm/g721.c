@@ -48,6 +48,7 @@
  * the name of the module which it is implementing.
  *
  */
+#include <stdlib.h>
 #include <utils.h>
 #include "g72x.h"
 
@@ -71,41 +72,24 @@ static short	_fitab[16] = {0, 0, 0, 0x200, 0x200, 0x200, 0x600, 0xE00,
 				0xE00, 0x600, 0x200, 0x200, 0x200, 0, 0, 0};
 
 /*
- * g721_encoder()
- *
- * Encodes the input vale of linear PCM, A-law or u-law data sl and returns
- * the resulting code. -1 is returned for unknown input coding value.
+ * Encode a 14-bit linear sample, shared by g721_encoder() and
+ * g721_encode_block().
  */
-int
-g721_encoder(
+static inline int
+g721_encode_sample(
 	int		sl,
-	int		in_coding,
 	struct g72x_state *state_ptr)
 {
-	short		sezi, se, sez;		/* ACCUM */
+	int		sezi;			/* ACCUM */
+	short		se, sez;
 	short		d;			/* SUBTA */
 	short		sr;			/* ADDB */
 	short		y;			/* MIX */
 	short		dqsez;			/* ADDC */
 	short		dq, i;
 
-	switch (in_coding) {	/* linearize input sample to 14-bit PCM */
-	case AUDIO_ENCODING_ALAW:
-		sl = alaw2linear(sl) >> 2;
-		break;
-	case AUDIO_ENCODING_ULAW:
-		sl = ulaw2linear(sl) >> 2;
-		break;
-	case AUDIO_ENCODING_LINEAR:
-		sl >>= 2;			/* 14-bit dynamic range */
-		break;
-	default:
-		return (-1);
-	}
-
-	sezi = predictor_zero(state_ptr);
+	se = predictor(state_ptr, &sezi) >> 1;	/* estimated signal */
 	sez = sezi >> 1;
-	se = (sezi + predictor_pole(state_ptr)) >> 1;	/* estimated signal */
 
 	d = sl - se;				/* estimation difference */
 
@@ -123,33 +107,28 @@ g721_encoder(
 
 	return (i);
 }
-EXPORT_SYMBOL(g721_encoder);
 
 /*
- * g721_decoder()
- *
- * Description:
- *
- * Decodes a 4-bit code of G.721 encoded data of i and
- * returns the resulting linear PCM, A-law or u-law value.
- * return -1 for unknown out_coding value.
+ * Decode a code word to a 14-bit linear sample, shared by g721_decoder()
+ * and g721_decode_block(). The signal estimate and step size are returned
+ * for tandem adjustment.
  */
-int
-g721_decoder(
+static inline int
+g721_decode_sample(
 	int		i,
-	int		out_coding,
-	struct g72x_state *state_ptr)
+	struct g72x_state *state_ptr,
+	short		*sep,
+	short		*yp)
 {
-	short		sezi, sei, sez, se;	/* ACCUM */
+	int		sezi;			/* ACCUM */
+	short		sei, sez, se;
 	short		y;			/* MIX */
 	short		sr;			/* ADDB */
 	short		dq;
 	short		dqsez;
 
-	i &= 0x0f;			/* mask to get proper bits */
-	sezi = predictor_zero(state_ptr);
+	sei = predictor(state_ptr, &sezi);
 	sez = sezi >> 1;
-	sei = sezi + predictor_pole(state_ptr);
 	se = sei >> 1;			/* se = estimated signal */
 
 	y = step_size(state_ptr);	/* dynamic quantizer step size */
@@ -162,6 +141,61 @@ g721_decoder(
 
 	update(4, y, _witab[i] << 5, _fitab[i], dq, sr, dqsez, state_ptr);
 
+	*sep = se;
+	*yp = y;
+	return (sr);
+}
+
+/*
+ * g721_encoder()
+ *
+ * Encodes the input vale of linear PCM, A-law or u-law data sl and returns
+ * the resulting code. -1 is returned for unknown input coding value.
+ */
+int
+g721_encoder(
+	int		sl,
+	int		in_coding,
+	struct g72x_state *state_ptr)
+{
+	switch (in_coding) {	/* linearize input sample to 14-bit PCM */
+	case AUDIO_ENCODING_ALAW:
+		sl = alaw2linear(sl) >> 2;
+		break;
+	case AUDIO_ENCODING_ULAW:
+		sl = ulaw2linear(sl) >> 2;
+		break;
+	case AUDIO_ENCODING_LINEAR:
+		sl >>= 2;			/* 14-bit dynamic range */
+		break;
+	default:
+		return (-1);
+	}
+
+	return (g721_encode_sample(sl, state_ptr));
+}
+EXPORT_SYMBOL(g721_encoder);
+
+/*
+ * g721_decoder()
+ *
+ * Description:
+ *
+ * Decodes a 4-bit code of G.721 encoded data of i and
+ * returns the resulting linear PCM, A-law or u-law value.
+ * return -1 for unknown out_coding value.
+ */
+int
+g721_decoder(
+	int		i,
+	int		out_coding,
+	struct g72x_state *state_ptr)
+{
+	short		se, y, sr;
+
+	i &= 0x0f;			/* mask to get proper bits */
+	sr = g721_decode_sample(i, state_ptr, &se, &y);
+
 	switch (out_coding) {
 	case AUDIO_ENCODING_ALAW:
 		return (tandem_adjust_alaw(sr, se, y, i, 8, qtab_721));
@@ -174,3 +208,548 @@ g721_decoder(
 	}
 }
 EXPORT_SYMBOL(g721_decoder);
+
+/*
+ * g721_encode_block()
+ *
+ * Encodes len samples of linear PCM data into len / 2 bytes of packed
+ * G.721 code words, the first sample in the upper nibble. len must be
+ * even, a DECT frame of 40 bytes corresponds to 80 samples.
+ */
+void
+g721_encode_block(
+	const short	*pcm,
+	unsigned char	*code,
+	unsigned int	len,
+	struct g72x_state *state_ptr)
+{
+	unsigned int	n;
+	int		hi, lo;
+
+	for (n = 0; n < len / 2; n++) {
+		hi = g721_encode_sample(pcm[2 * n + 0] >> 2, state_ptr);
+		lo = g721_encode_sample(pcm[2 * n + 1] >> 2, state_ptr);
+		code[n] = hi << 4 | lo;
+	}
+}
+EXPORT_SYMBOL(g721_encode_block);
+
+/*
+ * g721_decode_block()
+ *
+ * Decodes len / 2 bytes of packed G.721 code words, upper nibble first,
+ * into len samples of linear PCM data. len must be even.
+ */
+void
+g721_decode_block(
+	const unsigned char *code,
+	short		*pcm,
+	unsigned int	len,
+	struct g72x_state *state_ptr)
+{
+	unsigned int	n;
+	short		se, y;
+
+	for (n = 0; n < len / 2; n++) {
+		pcm[2 * n + 0] = g721_decode_sample(code[n] >> 4, state_ptr,
+						    &se, &y) << 2;
+		pcm[2 * n + 1] = g721_decode_sample(code[n] & 0x0f, state_ptr,
+						    &se, &y) << 2;
+	}
+}
+EXPORT_SYMBOL(g721_decode_block);
+
+/*
+ * quantize() using qtab_721, without a loop over the table so it can be
+ * inlined and vectorized.
+ */
+static inline int
+g721_quantize(
+	int		d,
+	int		y)
+{
+	short		dqm, exp, mant, dl, dln;
+	int		i;
+
+	dqm = (d < 0) ? -d : d;
+	exp = quan_power2(dqm >> 1);
+	mant = ((dqm << 7) >> exp) & 0x7F;
+	dl = (exp << 7) + mant;
+	dln = dl - (y >> 2);
+
+	/* qtab_721 is sorted, count the entries less or equal to dln */
+	i = (dln >= -124) + (dln >= 80) + (dln >= 178) + (dln >= 246) +
+	    (dln >= 300) + (dln >= 349) + (dln >= 400);
+	return ((d < 0) ? 15 - i : (i == 0) ? 15 : i);
+}
+
+/*
+ * tandem_adjust_alaw() and tandem_adjust_ulaw() for G.721, using the
+ * inlined quantizer.
+ */
+static inline int
+g721_tandem_alaw(
+	int		sr,
+	int		se,
+	int		y,
+	int		i)
+{
+	unsigned char	sp;
+	int		im, imx;
+
+	if (sr <= -32768)
+		sr = -1;
+	sp = linear2alaw((sr >> 1) << 3);
+	im = i ^ 8;
+	imx = g721_quantize((short)((alaw2linear(sp) >> 2) - se), y) ^ 8;
+	if (imx == im)
+		return (sp);
+	else if (imx > im)
+		if (sp & 0x80)
+			return ((sp == 0xD5) ? 0x55 : ((sp ^ 0x55) - 1) ^ 0x55);
+		else
+			return ((sp == 0x2A) ? 0x2A : ((sp ^ 0x55) + 1) ^ 0x55);
+	else if (sp & 0x80)
+		return ((sp == 0xAA) ? 0xAA : ((sp ^ 0x55) + 1) ^ 0x55);
+	else
+		return ((sp == 0x55) ? 0xD5 : ((sp ^ 0x55) - 1) ^ 0x55);
+}
+
+static inline int
+g721_tandem_ulaw(
+	int		sr,
+	int		se,
+	int		y,
+	int		i)
+{
+	unsigned char	sp;
+	int		im, imx;
+
+	if (sr <= -32768)
+		sr = 0;
+	sp = linear2ulaw(sr << 2);
+	im = i ^ 8;
+	imx = g721_quantize((short)((ulaw2linear(sp) >> 2) - se), y) ^ 8;
+	if (imx == im)
+		return (sp);
+	else if (imx > im)
+		if (sp & 0x80)
+			return ((sp == 0xFF) ? 0x7E : sp + 1);
+		else
+			return ((sp == 0) ? 0 : sp - 1);
+	else if (sp & 0x80)
+		return ((sp == 0x80) ? 0x80 : sp - 1);
+	else
+		return ((sp == 0x7F) ? 0xFE : sp + 1);
+}
+
+/*
+ * g721_alaw_to_block()
+ *
+ * Transcodes len A-law samples into len / 2 bytes of packed G.721 code
+ * words, upper nibble first, without an intermediate linear PCM buffer.
+ * len must be even.
+ */
+void
+g721_alaw_to_block(
+	const unsigned char *aval,
+	unsigned char	*code,
+	unsigned int	len,
+	struct g72x_state *state_ptr)
+{
+	unsigned int	n;
+	int		hi, lo;
+
+	for (n = 0; n < len / 2; n++) {
+		hi = g721_encode_sample(alaw2linear(aval[2 * n + 0]) >> 2,
+					state_ptr);
+		lo = g721_encode_sample(alaw2linear(aval[2 * n + 1]) >> 2,
+					state_ptr);
+		code[n] = hi << 4 | lo;
+	}
+}
+EXPORT_SYMBOL(g721_alaw_to_block);
+
+/*
+ * g721_ulaw_to_block()
+ *
+ * Transcodes len u-law samples into len / 2 bytes of packed G.721 code
+ * words, upper nibble first, without an intermediate linear PCM buffer.
+ * len must be even.
+ */
+void
+g721_ulaw_to_block(
+	const unsigned char *uval,
+	unsigned char	*code,
+	unsigned int	len,
+	struct g72x_state *state_ptr)
+{
+	unsigned int	n;
+	int		hi, lo;
+
+	for (n = 0; n < len / 2; n++) {
+		hi = g721_encode_sample(ulaw2linear(uval[2 * n + 0]) >> 2,
+					state_ptr);
+		lo = g721_encode_sample(ulaw2linear(uval[2 * n + 1]) >> 2,
+					state_ptr);
+		code[n] = hi << 4 | lo;
+	}
+}
+EXPORT_SYMBOL(g721_ulaw_to_block);
+
+/*
+ * g721_block_to_alaw()
+ *
+ * Transcodes len / 2 bytes of packed G.721 code words, upper nibble first,
+ * into len A-law samples, len must be even. Includes the synchronous tandem adjustment
+ * performed by g721_decoder() for AUDIO_ENCODING_ALAW.
+ */
+void
+g721_block_to_alaw(
+	const unsigned char *code,
+	unsigned char	*aval,
+	unsigned int	len,
+	struct g72x_state *state_ptr)
+{
+	unsigned int	n;
+	short		se, y, sr;
+	int		i;
+
+	for (n = 0; n < len; n++) {
+		i = (n & 1) ? code[n / 2] & 0x0f : code[n / 2] >> 4;
+		sr = g721_decode_sample(i, state_ptr, &se, &y);
+		aval[n] = g721_tandem_alaw(sr, se, y, i);
+	}
+}
+EXPORT_SYMBOL(g721_block_to_alaw);
+
+/*
+ * g721_block_to_ulaw()
+ *
+ * Transcodes len / 2 bytes of packed G.721 code words, upper nibble first,
+ * into len u-law samples, len must be even. Includes the synchronous tandem adjustment
+ * performed by g721_decoder() for AUDIO_ENCODING_ULAW.
+ */
+void
+g721_block_to_ulaw(
+	const unsigned char *code,
+	unsigned char	*uval,
+	unsigned int	len,
+	struct g72x_state *state_ptr)
+{
+	unsigned int	n;
+	short		se, y, sr;
+	int		i;
+
+	for (n = 0; n < len; n++) {
+		i = (n & 1) ? code[n / 2] & 0x0f : code[n / 2] >> 4;
+		sr = g721_decode_sample(i, state_ptr, &se, &y);
+		uval[n] = g721_tandem_ulaw(sr, se, y, i);
+	}
+}
+EXPORT_SYMBOL(g721_block_to_ulaw);
+
+/*
+ * Multi-channel coder
+ *
+ * The multi-channel coder processes the frames of up to G721_MC_CHANNELS
+ * channels collected during one tick, for instance the 40 byte frames of
+ * all active calls every 10ms. Each sample step is applied to all channels
+ * before continuing with the next sample. The state is kept in structure of
+ * arrays layout and the per-channel code below contains no calls and only
+ * conditional expressions, so the compiler can evaluate it for multiple
+ * channels per vector instruction. The results are identical to those of
+ * the single channel coder.
+ */
+
+/*
+ * g721_mc_init_state()
+ *
+ * initializes the state of a multi-channel coder for channels channels.
+ */
+void
+g721_mc_init_state(
+	struct g721_mc_state *state_ptr,
+	unsigned int	channels)
+{
+	unsigned int	c;
+
+	state_ptr->channels = (channels < G721_MC_CHANNELS) ?
+	    channels : G721_MC_CHANNELS;
+	for (c = 0; c < G721_MC_CHANNELS; c++)
+		g721_mc_reset_channel(state_ptr, c);
+}
+EXPORT_SYMBOL(g721_mc_init_state);
+
+/*
+ * g721_mc_reset_channel()
+ *
+ * resets the state of a single channel, for instance when a new call is
+ * assigned to it.
+ */
+void
+g721_mc_reset_channel(
+	struct g721_mc_state *state_ptr,
+	unsigned int	c)
+{
+	unsigned int	k;
+
+	state_ptr->yl[c] = 34816;
+	state_ptr->yu[c] = 544;
+	state_ptr->dms[c] = 0;
+	state_ptr->dml[c] = 0;
+	state_ptr->ap[c] = 0;
+	for (k = 0; k < 2; k++) {
+		state_ptr->a[k][c] = 0;
+		state_ptr->pk[k][c] = 0;
+		state_ptr->sr[k][c] = 32;
+	}
+	for (k = 0; k < 6; k++) {
+		state_ptr->b[k][c] = 0;
+		state_ptr->dq[k][c] = 32;
+	}
+	state_ptr->td[c] = 0;
+}
+EXPORT_SYMBOL(g721_mc_reset_channel);
+
+/* predictor() for channel c */
+static inline int
+g721_mc_predictor(
+	struct g721_mc_state *st,
+	unsigned int	c,
+	int		*sezi)
+{
+	*sezi = (short)(fmult(st->b[0][c] >> 2, st->dq[0][c]) +
+	    fmult(st->b[1][c] >> 2, st->dq[1][c]) +
+	    fmult(st->b[2][c] >> 2, st->dq[2][c]) +
+	    fmult(st->b[3][c] >> 2, st->dq[3][c]) +
+	    fmult(st->b[4][c] >> 2, st->dq[4][c]) +
+	    fmult(st->b[5][c] >> 2, st->dq[5][c]));
+	return (*sezi + fmult(st->a[1][c] >> 2, st->sr[1][c]) +
+	    fmult(st->a[0][c] >> 2, st->sr[0][c]));
+}
+
+/* step_size() for channel c */
+static inline int
+g721_mc_step_size(
+	struct g721_mc_state *st,
+	unsigned int	c)
+{
+	int		y, dif, al;
+
+	y = st->yl[c] >> 6;
+	dif = st->yu[c] - y;
+	al = st->ap[c] >> 2;
+	y += (dif > 0) ? (dif * al) >> 6 :
+	    (dif < 0) ? (dif * al + 0x3F) >> 6 : 0;
+	return ((st->ap[c] >= 256) ? st->yu[c] : y);
+}
+
+/* reconstruct() */
+static inline int
+g721_mc_reconstruct(
+	int		sign,
+	int		dqln,
+	int		y)
+{
+	short		dql, dex, dqt, dq;
+
+	dql = dqln + (y >> 2);
+	dex = (dql >> 7) & 15;
+	dqt = 128 + (dql & 127);
+	dq = (dqt << 7) >> (14 - dex);
+	return ((dql < 0) ? (sign ? -0x8000 : 0) :
+	    (sign ? dq - 0x8000 : dq));
+}
+
+/* update() with code_size 4 for channel c */
+static inline void
+g721_mc_update(
+	struct g721_mc_state *st,
+	unsigned int	c,
+	int		y,
+	int		wi,
+	int		fi,
+	int		dq,
+	int		sr,
+	int		dqsez)
+{
+	short		mag, exp, a2p, a1ul, fa1, pks1, pk0, yu, a0, a1;
+	short		ylint, ylfrac, thr1, thr2, dqthr;
+	short		dq0, sr0;
+	int		tr, td;
+	unsigned int	k;
+
+	pk0 = (dqsez < 0) ? 1 : 0;
+	mag = dq & 0x7FFF;
+
+	/* TRANS */
+	ylint = st->yl[c] >> 15;
+	ylfrac = (st->yl[c] >> 10) & 0x1F;
+	thr1 = (32 + ylfrac) << ylint;
+	thr2 = (ylint > 9) ? 31 << 10 : thr1;
+	dqthr = (thr2 + (thr2 >> 1)) >> 1;
+	tr = (st->td[c] != 0 && mag > dqthr);
+
+	/* FUNCTW & FILTD & DELAY, LIMB */
+	yu = y + ((wi - y) >> 5);
+	yu = (yu < 544) ? 544 : (yu > 5120) ? 5120 : yu;
+	st->yu[c] = yu;
+
+	/* FILTE & DELAY */
+	st->yl[c] += yu + ((-st->yl[c]) >> 6);
+
+	/* UPA2 */
+	pks1 = pk0 ^ st->pk[0][c];
+	a1 = st->a[1][c];
+	a2p = a1 - (a1 >> 7);
+	fa1 = pks1 ? st->a[0][c] : -st->a[0][c];
+	a2p += (dqsez == 0) ? 0 : (fa1 < -8191) ? -0x100 :
+	    (fa1 > 8191) ? 0xFF : fa1 >> 5;
+
+	/* LIMC */
+	if (dqsez != 0)
+		a2p = (pk0 ^ st->pk[1][c]) ?
+		    ((a2p <= -12160) ? -12288 : (a2p >= 12416) ? 12288 :
+		     a2p - 0x80) :
+		    ((a2p <= -12416) ? -12288 : (a2p >= 12160) ? 12288 :
+		     a2p + 0x80);
+
+	/* UPA1, LIMD */
+	a0 = st->a[0][c];
+	a0 -= a0 >> 8;
+	a0 += (dqsez == 0) ? 0 : (pks1 == 0) ? 192 : -192;
+	a1ul = 15360 - a2p;
+	a0 = (a0 < -a1ul) ? -a1ul : (a0 > a1ul) ? a1ul : a0;
+
+	/* reset a's and b's for modem signals */
+	a2p = tr ? 0 : a2p;
+	st->a[1][c] = a2p;
+	st->a[0][c] = tr ? 0 : a0;
+
+	/* UPB */
+	for (k = 0; k < 6; k++) {
+		short b = st->b[k][c];
+
+		b -= b >> 8;
+		b += (mag == 0) ? 0 : ((dq ^ st->dq[k][c]) >= 0) ? 128 : -128;
+		st->b[k][c] = tr ? 0 : b;
+	}
+
+	for (k = 5; k > 0; k--)
+		st->dq[k][c] = st->dq[k - 1][c];
+
+	/* FLOAT A */
+	exp = quan_power2(mag);
+	dq0 = (exp << 6) + ((mag << 6) >> exp) - ((dq >= 0) ? 0 : 0x400);
+	st->dq[0][c] = (mag == 0) ? ((dq >= 0) ? 0x20 : 0xFC20) : dq0;
+
+	/* FLOAT B */
+	st->sr[1][c] = st->sr[0][c];
+	mag = (sr > 0) ? sr : -sr;
+	exp = quan_power2(mag);
+	sr0 = (exp << 6) + ((mag << 6) >> exp) - ((sr > 0) ? 0 : 0x400);
+	st->sr[0][c] = (sr == 0) ? 0x20 : (sr > -32768) ? sr0 : 0xFC20;
+
+	/* DELAY A */
+	st->pk[1][c] = st->pk[0][c];
+	st->pk[0][c] = pk0;
+
+	/* TONE */
+	td = !tr && a2p < -11776;
+	st->td[c] = td;
+
+	/* Adaptation speed control */
+	st->dms[c] += (fi - st->dms[c]) >> 5;
+	st->dml[c] += ((fi << 2) - st->dml[c]) >> 7;
+
+	st->ap[c] = tr ? 256 :
+	    (y < 1536 || td ||
+	     abs((st->dms[c] << 2) - st->dml[c]) >= (st->dml[c] >> 3)) ?
+	    st->ap[c] + ((0x200 - st->ap[c]) >> 4) :
+	    st->ap[c] + ((-st->ap[c]) >> 4);
+}
+
+/*
+ * g721_mc_encode()
+ *
+ * Encodes len samples of linear PCM data of each channel into len / 2 bytes
+ * of packed G.721 code words, upper nibble first, len must be even. pcm[c]
+ * and code[c] point to the input and output frames of channel c.
+ */
+void
+g721_mc_encode(
+	struct g721_mc_state *state_ptr,
+	const short *const pcm[],
+	unsigned char *const code[],
+	unsigned int	len)
+{
+	unsigned int	n, c;
+	int		sezi;
+	short		sl, se, sez, d, y, dq, sr, dqsez, i;
+
+	for (n = 0; n < len; n++) {
+		for (c = 0; c < state_ptr->channels; c++) {
+			sl = pcm[c][n] >> 2;
+
+			se = g721_mc_predictor(state_ptr, c, &sezi) >> 1;
+			sez = sezi >> 1;
+			d = sl - se;
+
+			y = g721_mc_step_size(state_ptr, c);
+			i = g721_quantize(d, y);
+			dq = g721_mc_reconstruct(i & 8, _dqlntab[i], y);
+			sr = (dq < 0) ? se - (dq & 0x3FFF) : se + dq;
+			dqsez = sr + sez - se;
+
+			g721_mc_update(state_ptr, c, y, _witab[i] << 5,
+				       _fitab[i], dq, sr, dqsez);
+
+			if (n & 1)
+				code[c][n / 2] |= i;
+			else
+				code[c][n / 2] = i << 4;
+		}
+	}
+}
+EXPORT_SYMBOL(g721_mc_encode);
+
+/*
+ * g721_mc_decode()
+ *
+ * Decodes len / 2 bytes of packed G.721 code words of each channel, upper
+ * nibble first, into len samples of linear PCM data, len must be even.
+ * code[c] and pcm[c] point to the input and output frames of channel c.
+ */
+void
+g721_mc_decode(
+	struct g721_mc_state *state_ptr,
+	const unsigned char *const code[],
+	short *const pcm[],
+	unsigned int	len)
+{
+	unsigned int	n, c;
+	int		sezi;
+	short		sei, se, sez, y, dq, sr, dqsez, i;
+
+	for (n = 0; n < len; n++) {
+		for (c = 0; c < state_ptr->channels; c++) {
+			i = (n & 1) ? code[c][n / 2] & 0x0f : code[c][n / 2] >> 4;
+
+			sei = g721_mc_predictor(state_ptr, c, &sezi);
+			sez = sezi >> 1;
+			se = sei >> 1;
+
+			y = g721_mc_step_size(state_ptr, c);
+			dq = g721_mc_reconstruct(i & 0x08, _dqlntab[i], y);
+			sr = (dq < 0) ? (se - (dq & 0x3FFF)) : se + dq;
+			dqsez = sr - se + sez;
+
+			g721_mc_update(state_ptr, c, y, _witab[i] << 5,
+				       _fitab[i], dq, sr, dqsez);
+
+			pcm[c][n] = sr << 2;
+		}
+	}
+}
+EXPORT_SYMBOL(g721_mc_decode);
@@ -37,6 +37,7 @@
  * of workstation attributes, such as hardware 2's complement arithmetic.
  *
  */
+#include <utils.h>
 #include "g72x.h"
 
 /*
@@ -58,41 +59,24 @@ static short	_fitab[8] = {0, 0x200, 0x400, 0xE00, 0xE00, 0x400, 0x200, 0};
 static short qtab_723_24[3] = {8, 218, 331};
 
 /*
- * g723_24_encoder()
- *
- * Encodes a linear PCM, A-law or u-law input sample and returns its 3-bit code.
- * Returns -1 if invalid input coding value.
+ * Encode a 14-bit linear sample, shared by g723_24_encoder() and
+ * g723_24_encode_block().
  */
-int
-g723_24_encoder(
+static inline int
+g723_24_encode_sample(
 	int		sl,
-	int		in_coding,
 	struct g72x_state *state_ptr)
 {
-	short		sei, sezi, se, sez;	/* ACCUM */
+	int		sezi;			/* ACCUM */
+	short		sei, sez, se;
 	short		d;			/* SUBTA */
 	short		y;			/* MIX */
 	short		sr;			/* ADDB */
 	short		dqsez;			/* ADDC */
 	short		dq, i;
 
-	switch (in_coding) {	/* linearize input sample to 14-bit PCM */
-	case AUDIO_ENCODING_ALAW:
-		sl = alaw2linear(sl) >> 2;
-		break;
-	case AUDIO_ENCODING_ULAW:
-		sl = ulaw2linear(sl) >> 2;
-		break;
-	case AUDIO_ENCODING_LINEAR:
-		sl >>= 2;		/* sl of 14-bit dynamic range */
-		break;
-	default:
-		return (-1);
-	}
-
-	sezi = predictor_zero(state_ptr);
+	sei = predictor(state_ptr, &sezi);
 	sez = sezi >> 1;
-	sei = sezi + predictor_pole(state_ptr);
 	se = sei >> 1;			/* se = estimated signal */
 
 	d = sl - se;			/* d = estimation diff. */
@@ -112,28 +96,26 @@ g723_24_encoder(
 }
 
 /*
- * g723_24_decoder()
- *
- * Decodes a 3-bit CCITT G.723_24 ADPCM code and returns
- * the resulting 16-bit linear PCM, A-law or u-law sample value.
- * -1 is returned if the output coding is unknown.
+ * Decode a code word to a 14-bit linear sample, shared by
+ * g723_24_decoder() and g723_24_decode_block(). The signal estimate and
+ * step size are returned for tandem adjustment.
  */
-int
-g723_24_decoder(
+static inline int
+g723_24_decode_sample(
 	int		i,
-	int		out_coding,
-	struct g72x_state *state_ptr)
+	struct g72x_state *state_ptr,
+	short		*sep,
+	short		*yp)
 {
-	short		sezi, sei, sez, se;	/* ACCUM */
+	int		sezi;			/* ACCUM */
+	short		sei, sez, se;
 	short		y;			/* MIX */
 	short		sr;			/* ADDB */
 	short		dq;
 	short		dqsez;
 
-	i &= 0x07;			/* mask to get proper bits */
-	sezi = predictor_zero(state_ptr);
+	sei = predictor(state_ptr, &sezi);
 	sez = sezi >> 1;
-	sei = sezi + predictor_pole(state_ptr);
 	se = sei >> 1;			/* se = estimated signal */
 
 	y = step_size(state_ptr);	/* adaptive quantizer step size */
@@ -145,6 +127,59 @@ g723_24_decoder(
 
 	update(3, y, _witab[i], _fitab[i], dq, sr, dqsez, state_ptr);
 
+	*sep = se;
+	*yp = y;
+	return (sr);
+}
+
+/*
+ * g723_24_encoder()
+ *
+ * Encodes a linear PCM, A-law or u-law input sample and returns its 3-bit code.
+ * Returns -1 if invalid input coding value.
+ */
+int
+g723_24_encoder(
+	int		sl,
+	int		in_coding,
+	struct g72x_state *state_ptr)
+{
+	switch (in_coding) {	/* linearize input sample to 14-bit PCM */
+	case AUDIO_ENCODING_ALAW:
+		sl = alaw2linear(sl) >> 2;
+		break;
+	case AUDIO_ENCODING_ULAW:
+		sl = ulaw2linear(sl) >> 2;
+		break;
+	case AUDIO_ENCODING_LINEAR:
+		sl >>= 2;		/* sl of 14-bit dynamic range */
+		break;
+	default:
+		return (-1);
+	}
+
+	return (g723_24_encode_sample(sl, state_ptr));
+}
+EXPORT_SYMBOL(g723_24_encoder);
+
+/*
+ * g723_24_decoder()
+ *
+ * Decodes a 3-bit CCITT G.723_24 ADPCM code and returns
+ * the resulting 16-bit linear PCM, A-law or u-law sample value.
+ * -1 is returned if the output coding is unknown.
+ */
+int
+g723_24_decoder(
+	int		i,
+	int		out_coding,
+	struct g72x_state *state_ptr)
+{
+	short		se, y, sr;
+
+	i &= 0x07;			/* mask to get proper bits */
+	sr = g723_24_decode_sample(i, state_ptr, &se, &y);
+
 	switch (out_coding) {
 	case AUDIO_ENCODING_ALAW:
 		return (tandem_adjust_alaw(sr, se, y, i, 4, qtab_723_24));
@@ -156,3 +191,60 @@ g723_24_decoder(
 		return (-1);
 	}
 }
+EXPORT_SYMBOL(g723_24_decoder);
+
+/*
+ * g723_24_encode_block()
+ *
+ * Encodes len samples of linear PCM data into 3 * len / 8 bytes of
+ * packed 3-bit G.723 code words, the first sample in the most
+ * significant bits. len must be a multiple of 8.
+ */
+void
+g723_24_encode_block(
+	const short	*pcm,
+	unsigned char	*code,
+	unsigned int	len,
+	struct g72x_state *state_ptr)
+{
+	unsigned int	n, acc = 0, bits = 0;
+
+	for (n = 0; n < len; n++) {
+		acc = acc << 3 | g723_24_encode_sample(pcm[n] >> 2, state_ptr);
+		bits += 3;
+		if (bits >= 8) {
+			bits -= 8;
+			*code++ = acc >> bits;
+		}
+	}
+}
+EXPORT_SYMBOL(g723_24_encode_block);
+
+/*
+ * g723_24_decode_block()
+ *
+ * Decodes 3 * len / 8 bytes of packed 3-bit G.723 code words, most
+ * significant bits first, into len samples of linear PCM data. len must
+ * be a multiple of 8.
+ */
+void
+g723_24_decode_block(
+	const unsigned char *code,
+	short		*pcm,
+	unsigned int	len,
+	struct g72x_state *state_ptr)
+{
+	unsigned int	n, acc = 0, bits = 0;
+	short		se, y;
+
+	for (n = 0; n < len; n++) {
+		if (bits < 3) {
+			acc = acc << 8 | *code++;
+			bits += 8;
+		}
+		bits -= 3;
+		pcm[n] = g723_24_decode_sample((acc >> bits) & 0x07, state_ptr,
+					       &se, &y) << 2;
+	}
+}
+EXPORT_SYMBOL(g723_24_decode_block);
@@ -45,6 +45,7 @@
  * the name of the module which it is implementing.
  *
  */
+#include <utils.h>
 #include "g72x.h"
 
 /*
@@ -75,6 +76,80 @@ static short	_fitab[32] = {0, 0, 0, 0, 0, 0x200, 0x200, 0x200,
 static short qtab_723_40[15] = {-122, -16, 68, 139, 198, 250, 298, 339,
 				378, 413, 445, 475, 502, 528, 553};
 
+/*
+ * Encode a 14-bit linear sample, shared by g723_40_encoder() and
+ * g723_40_encode_block().
+ */
+static inline int
+g723_40_encode_sample(
+	int		sl,
+	struct g72x_state *state_ptr)
+{
+	int		sezi;			/* ACCUM */
+	short		sei, sez, se;
+	short		d;			/* SUBTA */
+	short		y;			/* MIX */
+	short		sr;			/* ADDB */
+	short		dqsez;			/* ADDC */
+	short		dq, i;
+
+	sei = predictor(state_ptr, &sezi);
+	sez = sezi >> 1;
+	se = sei >> 1;			/* se = estimated signal */
+
+	d = sl - se;			/* d = estimation diff. */
+
+	/* quantize prediction difference d */
+	y = step_size(state_ptr);	/* quantizer step size */
+	i = quantize(d, y, qtab_723_40, 15);	/* i = ADPCM code */
+	dq = reconstruct(i & 0x10, _dqlntab[i], y); /* quantized diff. */
+
+	sr = (dq < 0) ? se - (dq & 0x7FFF) : se + dq; /* reconstructed signal */
+
+	dqsez = sr + sez - se;		/* pole prediction diff. */
+
+	update(5, y, _witab[i], _fitab[i], dq, sr, dqsez, state_ptr);
+
+	return (i);
+}
+
+/*
+ * Decode a code word to a 14-bit linear sample, shared by
+ * g723_40_decoder() and g723_40_decode_block(). The signal estimate and
+ * step size are returned for tandem adjustment.
+ */
+static inline int
+g723_40_decode_sample(
+	int		i,
+	struct g72x_state *state_ptr,
+	short		*sep,
+	short		*yp)
+{
+	int		sezi;			/* ACCUM */
+	short		sei, sez, se;
+	short		y;			/* MIX */
+	short		sr;			/* ADDB */
+	short		dq;
+	short		dqsez;
+
+	sei = predictor(state_ptr, &sezi);
+	sez = sezi >> 1;
+	se = sei >> 1;			/* se = estimated signal */
+
+	y = step_size(state_ptr);	/* adaptive quantizer step size */
+	dq = reconstruct(i & 0x10, _dqlntab[i], y); /* unquantize pred diff */
+
+	sr = (dq < 0) ? (se - (dq & 0x7FFF)) : (se + dq); /* reconst. signal */
+
+	dqsez = sr - se + sez;			/* pole prediction diff. */
+
+	update(5, y, _witab[i], _fitab[i], dq, sr, dqsez, state_ptr);
+
+	*sep = se;
+	*yp = y;
+	return (sr);
+}
+
 /*
  * g723_40_encoder()
  *
@@ -88,13 +163,6 @@ g723_40_encoder(
 	int		in_coding,
 	struct g72x_state *state_ptr)
 {
-	short		sei, sezi, se, sez;	/* ACCUM */
-	short		d;			/* SUBTA */
-	short		y;			/* MIX */
-	short		sr;			/* ADDB */
-	short		dqsez;			/* ADDC */
-	short		dq, i;
-
 	switch (in_coding) {	/* linearize input sample to 14-bit PCM */
 	case AUDIO_ENCODING_ALAW:
 		sl = alaw2linear(sl) >> 2;
@@ -109,27 +177,9 @@ g723_40_encoder(
 		return (-1);
 	}
 
-	sezi = predictor_zero(state_ptr);
-	sez = sezi >> 1;
-	sei = sezi + predictor_pole(state_ptr);
-	se = sei >> 1;			/* se = estimated signal */
-
-	d = sl - se;			/* d = estimation difference */
-
-	/* quantize prediction difference */
-	y = step_size(state_ptr);	/* adaptive quantizer step size */
-	i = quantize(d, y, qtab_723_40, 15);	/* i = ADPCM code */
-
-	dq = reconstruct(i & 0x10, _dqlntab[i], y);	/* quantized diff */
-
-	sr = (dq < 0) ? se - (dq & 0x7FFF) : se + dq; /* reconstructed signal */
-
-	dqsez = sr + sez - se;		/* dqsez = pole prediction diff. */
-
-	update(5, y, _witab[i], _fitab[i], dq, sr, dqsez, state_ptr);
-
-	return (i);
+	return (g723_40_encode_sample(sl, state_ptr));
 }
+EXPORT_SYMBOL(g723_40_encoder);
 
 /*
  * g723_40_decoder()
@@ -144,26 +194,10 @@ g723_40_decoder(
 	int		out_coding,
 	struct g72x_state *state_ptr)
 {
-	short		sezi, sei, sez, se;	/* ACCUM */
-	short		y;			/* MIX */
-	short		sr;			/* ADDB */
-	short		dq;
-	short		dqsez;
+	short		se, y, sr;
 
 	i &= 0x1f;			/* mask to get proper bits */
-	sezi = predictor_zero(state_ptr);
-	sez = sezi >> 1;
-	sei = sezi + predictor_pole(state_ptr);
-	se = sei >> 1;			/* se = estimated signal */
-
-	y = step_size(state_ptr);	/* adaptive quantizer step size */
-	dq = reconstruct(i & 0x10, _dqlntab[i], y);	/* estimation diff. */
-
-	sr = (dq < 0) ? (se - (dq & 0x7FFF)) : (se + dq); /* reconst. signal */
-
-	dqsez = sr - se + sez;		/* pole prediction diff. */
-
-	update(5, y, _witab[i], _fitab[i], dq, sr, dqsez, state_ptr);
+	sr = g723_40_decode_sample(i, state_ptr, &se, &y);
 
 	switch (out_coding) {
 	case AUDIO_ENCODING_ALAW:
@@ -176,3 +210,60 @@ g723_40_decoder(
 		return (-1);
 	}
 }
+EXPORT_SYMBOL(g723_40_decoder);
+
+/*
+ * g723_40_encode_block()
+ *
+ * Encodes len samples of linear PCM data into 5 * len / 8 bytes of
+ * packed 5-bit G.723 code words, the first sample in the most
+ * significant bits. len must be a multiple of 8.
+ */
+void
+g723_40_encode_block(
+	const short	*pcm,
+	unsigned char	*code,
+	unsigned int	len,
+	struct g72x_state *state_ptr)
+{
+	unsigned int	n, acc = 0, bits = 0;
+
+	for (n = 0; n < len; n++) {
+		acc = acc << 5 | g723_40_encode_sample(pcm[n] >> 2, state_ptr);
+		bits += 5;
+		if (bits >= 8) {
+			bits -= 8;
+			*code++ = acc >> bits;
+		}
+	}
+}
+EXPORT_SYMBOL(g723_40_encode_block);
+
+/*
+ * g723_40_decode_block()
+ *
+ * Decodes 5 * len / 8 bytes of packed 5-bit G.723 code words, most
+ * significant bits first, into len samples of linear PCM data. len must
+ * be a multiple of 8.
+ */
+void
+g723_40_decode_block(
+	const unsigned char *code,
+	short		*pcm,
+	unsigned int	len,
+	struct g72x_state *state_ptr)
+{
+	unsigned int	n, acc = 0, bits = 0;
+	short		se, y;
+
+	for (n = 0; n < len; n++) {
+		if (bits < 5) {
+			acc = acc << 8 | *code++;
+			bits += 8;
+		}
+		bits -= 5;
+		pcm[n] = g723_40_decode_sample((acc >> bits) & 0x1f, state_ptr,
+					       &se, &y) << 2;
+	}
+}
+EXPORT_SYMBOL(g723_40_decode_block);
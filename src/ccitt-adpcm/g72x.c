@@ -34,9 +34,6 @@
 #include <utils.h>
 #include "g72x.h"
 
-static short power2[15] = {1, 2, 4, 8, 0x10, 0x20, 0x40, 0x80,
-			0x100, 0x200, 0x400, 0x800, 0x1000, 0x2000, 0x4000};
-
 /*
  * quan()
  *
@@ -59,34 +56,6 @@ quan(
 	return (i);
 }
 
-/*
- * fmult()
- *
- * returns the integer product of the 14-bit integer "an" and
- * "floating point" representation (4-bit exponent, 6-bit mantessa) "srn".
- */
-static int
-fmult(
-	int		an,
-	int		srn)
-{
-	short		anmag, anexp, anmant;
-	short		wanexp, wanmant;
-	short		retval;
-
-	anmag = (an > 0) ? an : ((-an) & 0x1FFF);
-	anexp = quan(anmag, power2, 15) - 6;
-	anmant = (anmag == 0) ? 32 :
-	    (anexp >= 0) ? anmag >> anexp : anmag << -anexp;
-	wanexp = anexp + ((srn >> 6) & 0xF) - 13;
-
-	wanmant = (anmant * (srn & 077) + 0x30) >> 4;
-	retval = (wanexp >= 0) ? ((wanmant << wanexp) & 0x7FFF) :
-	    (wanmant >> -wanexp);
-
-	return (((an ^ srn) < 0) ? -retval : retval);
-}
-
 /*
  * g72x_init_state()
  *
@@ -128,13 +97,13 @@ int
 predictor_zero(
 	struct g72x_state *state_ptr)
 {
-	int		i;
-	int		sezi;
-
-	sezi = fmult(state_ptr->b[0] >> 2, state_ptr->dq[0]);
-	for (i = 1; i < 6; i++)			/* ACCUM */
-		sezi += fmult(state_ptr->b[i] >> 2, state_ptr->dq[i]);
-	return (sezi);
+	/* ACCUM, unrolled */
+	return (fmult(state_ptr->b[0] >> 2, state_ptr->dq[0]) +
+	    fmult(state_ptr->b[1] >> 2, state_ptr->dq[1]) +
+	    fmult(state_ptr->b[2] >> 2, state_ptr->dq[2]) +
+	    fmult(state_ptr->b[3] >> 2, state_ptr->dq[3]) +
+	    fmult(state_ptr->b[4] >> 2, state_ptr->dq[4]) +
+	    fmult(state_ptr->b[5] >> 2, state_ptr->dq[5]));
 }
 /*
  * predictor_pole()
@@ -149,6 +118,24 @@ predictor_pole(
 	return (fmult(state_ptr->a[1] >> 2, state_ptr->sr[1]) +
 	    fmult(state_ptr->a[0] >> 2, state_ptr->sr[0]));
 }
+
+/*
+ * predictor()
+ *
+ * computes the zero and pole predictor estimates in one pass over the
+ * eight taps. Returns the signal estimate of both predictors and stores
+ * the zero predictor estimate in sezi.
+ */
+int
+predictor(
+	struct g72x_state *state_ptr,
+	int		*sezi)
+{
+	/* truncated to 16 bits like the ACCUM result of predictor_zero() */
+	*sezi = (short)predictor_zero(state_ptr);
+	return (*sezi + fmult(state_ptr->a[1] >> 2, state_ptr->sr[1]) +
+	    fmult(state_ptr->a[0] >> 2, state_ptr->sr[0]));
+}
 /*
  * step_size()
  *
@@ -206,7 +193,7 @@ quantize(
 	 * Compute base 2 log of 'd', and store in 'dl'.
 	 */
 	dqm = abs(d);
-	exp = quan(dqm >> 1, power2, 15);
+	exp = quan_power2(dqm >> 1);
 	mant = ((dqm << 7) >> exp) & 0x7F;	/* Fractional portion. */
 	dl = (exp << 7) + mant;
 
@@ -405,7 +392,7 @@ update(
 	if (mag == 0) {
 		state_ptr->dq[0] = (dq >= 0) ? 0x20 : 0xFC20;
 	} else {
-		exp = quan(mag, power2, 15);
+		exp = quan_power2(mag);
 		state_ptr->dq[0] = (dq >= 0) ?
 		    (exp << 6) + ((mag << 6) >> exp) :
 		    (exp << 6) + ((mag << 6) >> exp) - 0x400;
@@ -416,11 +403,11 @@ update(
 	if (sr == 0) {
 		state_ptr->sr[0] = 0x20;
 	} else if (sr > 0) {
-		exp = quan(sr, power2, 15);
+		exp = quan_power2(sr);
 		state_ptr->sr[0] = (exp << 6) + ((sr << 6) >> exp);
 	} else if (sr > -32768) {
 		mag = -sr;
-		exp = quan(mag, power2, 15);
+		exp = quan_power2(mag);
 		state_ptr->sr[0] =  (exp << 6) + ((mag << 6) >> exp) - 0x400;
 	} else
 		state_ptr->sr[0] = 0xFC20;
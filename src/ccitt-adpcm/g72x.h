@@ -72,11 +72,84 @@ struct g72x_state {
 	char td;	/* delayed tone detect, new in 1988 version */
 };
 
+/*
+ * Maximum number of channels of a multi-channel G.721 coder.
+ */
+#define	G721_MC_CHANNELS	16
+
+/*
+ * State of a multi-channel G.721 coder. The fields correspond to those of
+ * struct g72x_state, but are stored as arrays indexed by the channel number,
+ * so the same processing step can be applied to all channels at once.
+ */
+struct g721_mc_state {
+	unsigned int channels;
+	int yl[G721_MC_CHANNELS];
+	short yu[G721_MC_CHANNELS];
+	short dms[G721_MC_CHANNELS];
+	short dml[G721_MC_CHANNELS];
+	short ap[G721_MC_CHANNELS];
+	short a[2][G721_MC_CHANNELS];
+	short b[6][G721_MC_CHANNELS];
+	short pk[2][G721_MC_CHANNELS];
+	short dq[6][G721_MC_CHANNELS];
+	short sr[2][G721_MC_CHANNELS];
+	short td[G721_MC_CHANNELS];
+};
+
+/*
+ * quan_power2()
+ *
+ * returns the number of significant bits of val, limited to 15, or 0
+ * for values less than 1. The base 2 exponent is obtained by counting the
+ * leading zeros.
+ */
+static inline int
+quan_power2(
+	int		val)
+{
+	int		i;
+
+	if (val <= 0)
+		return (0);
+	i = sizeof(unsigned int) * 8 - __builtin_clz(val);
+	return ((i < 15) ? i : 15);
+}
+
+/*
+ * fmult()
+ *
+ * returns the integer product of the 14-bit integer "an" and
+ * "floating point" representation (4-bit exponent, 6-bit mantessa) "srn".
+ */
+static inline int
+fmult(
+	int		an,
+	int		srn)
+{
+	short		anmag, anexp, anmant;
+	short		wanexp, wanmant;
+	short		retval;
+
+	anmag = (an > 0) ? an : ((-an) & 0x1FFF);
+	anexp = quan_power2(anmag) - 6;
+	anmant = (anmag == 0) ? 32 :
+	    (anexp >= 0) ? anmag >> anexp : anmag << -anexp;
+	wanexp = anexp + ((srn >> 6) & 0xF) - 13;
+
+	wanmant = (anmant * (srn & 077) + 0x30) >> 4;
+	retval = (wanexp >= 0) ? ((wanmant << wanexp) & 0x7FFF) :
+	    (wanmant >> -wanexp);
+
+	return (((an ^ srn) < 0) ? -retval : retval);
+}
+
 /* External function definitions. */
 
 extern void g72x_init_state(struct g72x_state *);
 extern int predictor_zero(struct g72x_state *state_ptr);
 extern int predictor_pole(struct g72x_state *state_ptr);
+extern int predictor(struct g72x_state *state_ptr, int *sezi);
 extern int step_size(struct g72x_state *state_ptr);
 
 extern int quantize(
@@ -121,6 +194,53 @@ extern int g721_decoder(
 		int code,
 		int out_coding,
 		struct g72x_state *state_ptr);
+/* The len argument of all block and multi-channel functions is in samples */
+extern void g721_encode_block(
+		const short *pcm,
+		unsigned char *code,
+		unsigned int len,
+		struct g72x_state *state_ptr);
+extern void g721_decode_block(
+		const unsigned char *code,
+		short *pcm,
+		unsigned int len,
+		struct g72x_state *state_ptr);
+extern void g721_alaw_to_block(
+		const unsigned char *aval,
+		unsigned char *code,
+		unsigned int len,
+		struct g72x_state *state_ptr);
+extern void g721_ulaw_to_block(
+		const unsigned char *uval,
+		unsigned char *code,
+		unsigned int len,
+		struct g72x_state *state_ptr);
+extern void g721_block_to_alaw(
+		const unsigned char *code,
+		unsigned char *aval,
+		unsigned int len,
+		struct g72x_state *state_ptr);
+extern void g721_block_to_ulaw(
+		const unsigned char *code,
+		unsigned char *uval,
+		unsigned int len,
+		struct g72x_state *state_ptr);
+extern void g721_mc_init_state(
+		struct g721_mc_state *state_ptr,
+		unsigned int channels);
+extern void g721_mc_reset_channel(
+		struct g721_mc_state *state_ptr,
+		unsigned int channel);
+extern void g721_mc_encode(
+		struct g721_mc_state *state_ptr,
+		const short *const pcm[],
+		unsigned char *const code[],
+		unsigned int len);
+extern void g721_mc_decode(
+		struct g721_mc_state *state_ptr,
+		const unsigned char *const code[],
+		short *const pcm[],
+		unsigned int len);
 extern int g723_24_encoder(
 		int sample,
 		int in_coding,
@@ -137,6 +257,26 @@ extern int g723_40_decoder(
 		int code,
 		int out_coding,
 		struct g72x_state *state_ptr);
+extern void g723_24_encode_block(
+		const short *pcm,
+		unsigned char *code,
+		unsigned int len,
+		struct g72x_state *state_ptr);
+extern void g723_24_decode_block(
+		const unsigned char *code,
+		short *pcm,
+		unsigned int len,
+		struct g72x_state *state_ptr);
+extern void g723_40_encode_block(
+		const short *pcm,
+		unsigned char *code,
+		unsigned int len,
+		struct g72x_state *state_ptr);
+extern void g723_40_decode_block(
+		const unsigned char *code,
+		short *pcm,
+		unsigned int len,
+		struct g72x_state *state_ptr);
 
 extern unsigned char linear2alaw(int pcm_val);
 extern int alaw2linear(unsigned char a_val);
@@ -145,4 +285,13 @@ extern int ulaw2linear(unsigned char u_val);
 extern unsigned char alaw2ulaw(unsigned char aval);
 extern unsigned char ulaw2alaw(unsigned char uval);
 
+extern void linear2alaw_block(const short *pcm, unsigned char *aval,
+			      unsigned int n);
+extern void alaw2linear_block(const unsigned char *aval, short *pcm,
+			      unsigned int n);
+extern void linear2ulaw_block(const short *pcm, unsigned char *uval,
+			      unsigned int n);
+extern void ulaw2linear_block(const unsigned char *uval, short *pcm,
+			      unsigned int n);
+
 #endif /* !_G72X_H */
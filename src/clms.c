@@ -14,6 +14,8 @@
  */
 
 #include <stdint.h>
+#include <string.h>
+#include <errno.h>
 #include <linux/byteorder/little_endian.h>
 
 #include <libdect.h>
@@ -59,27 +61,42 @@ static const struct dect_trans_tbl clms_header_codings[] = {
 	TRANS_TBL(DECT_CLMS_HDR_ALPHANUMERIC_MULTI_SECTION,	"Multi-section/Alphanumeric"),
 };
 
+static void dect_clms_dump_addr_section(const struct dect_clms_fixed_addr_section *as)
+{
+	char buf[128];
+
+	dect_debug(DECT_DEBUG_CLMS, "  address section:\n");
+	dect_debug(DECT_DEBUG_CLMS, "\tHeader: %s\n",
+		   dect_val2str(clms_header_codings, buf, as->hdr & DECT_CLMS_HDR_MASK));
+	dect_debug(DECT_DEBUG_CLMS, "\tAddress: %04x\n", __be16_to_cpu(as->addr));
+	dect_debug(DECT_DEBUG_CLMS, "\tProtocol Discriminator: %02x\n", as->pd);
+	dect_debug(DECT_DEBUG_CLMS, "\tLength Indicator: %02x\n", as->li);
+}
+
+/*
+ * Reassemble a {CLMS-FIXED} message in place: the data sections are
+ * compacted to the beginning of the buffer, overwriting the address section
+ * and the section headers, so the message is delivered without copying it
+ * to a second buffer.
+ */
 void dect_clms_rcv_fixed(struct dect_handle *dh, struct dect_msg_buf *mb)
 {
-	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mbr = &_mb;
 	struct dect_clms_fixed_addr_section *as;
 	struct dect_clms_fixed_data_section *ds;
-	unsigned int n, len, section, sections;
-	char buf[128];
+	unsigned int n, len, section;
+	uint8_t *data;
 
 	clms_debug("parse {CLMS-FIXED} message");
-	dect_assert(mb->len % 5 == 0);
+	if (mb->len < sizeof(*as) || mb->len % sizeof(*ds)) {
+		clms_debug("invalid message length %u", mb->len);
+		return;
+	}
 
 	as = (void *)mb->data;
 	if ((as->hdr & DECT_CLMS_SECTION_TYPE_MASK) != DECT_CLMS_SECTION_ADDR)
 		return;
-
-	dect_debug(DECT_DEBUG_CLMS, "  address section:\n");
-	dect_debug(DECT_DEBUG_CLMS, "\tHeader: %s\n",
-		   dect_val2str(clms_header_codings, buf, as->hdr & DECT_CLMS_HDR_MASK));
-	dect_debug(DECT_DEBUG_CLMS, "\tAddress: %04x\n", __be16_to_cpu(as->addr));
-	dect_debug(DECT_DEBUG_CLMS, "\tProtocol Discriminator: %02x\n", as->pd);
-	dect_debug(DECT_DEBUG_CLMS, "\tLength Indicator: %02x\n", as->li);
+	if (dect_debug_enabled(DECT_DEBUG_CLMS))
+		dect_clms_dump_addr_section(as);
 
 	if (as->pd != DECT_CLMS_PD_DECT_IE_CODING && as->pd != 0x6)
 		return;
@@ -88,7 +105,9 @@ void dect_clms_rcv_fixed(struct dect_handle *dh, struct dect_msg_buf *mb)
 	case DECT_CLMS_HDR_STANDARD_ONE_SECTION:
 	case DECT_CLMS_HDR_BITSTREAM_ONE_SECTION:
 	case DECT_CLMS_HDR_ALPHANUMERIC_ONE_SECTION:
-		memcpy(dect_mbuf_put(mbr, 1), &as->li, 1);
+		/* The length indicator carries the data */
+		mb->data = &as->li;
+		mb->len  = 1;
 		goto deliver;
 	case DECT_CLMS_HDR_STANDARD_MULTI_SECTION:
 	case DECT_CLMS_HDR_BITSTREAM_MULTI_SECTION:
@@ -101,39 +120,39 @@ void dect_clms_rcv_fixed(struct dect_handle *dh, struct dect_msg_buf *mb)
 		return;
 	}
 
-	dect_mbuf_pull(mb, sizeof(*as));
+	/* Trailing sections beyond the length indicator are ignored */
+	if (mb->len - sizeof(*as) <
+	    sizeof(*ds) * ((len + DECT_CLMS_DATA_SIZE - 1) / DECT_CLMS_DATA_SIZE)) {
+		clms_debug("length indicator %u exceeds message length", as->li);
+		return;
+	}
 
-	sections = 0;
-	while (mb->len > 0) {
-		ds = (void *)mb->data;
+	data = mb->data;
+	ds   = (void *)mb->data + sizeof(*as);
+	for (section = 0; section * DECT_CLMS_DATA_SIZE < len; section++, ds++) {
 		if ((ds->hdr & DECT_CLMS_SECTION_TYPE_MASK) !=
 		    DECT_CLMS_SECTION_DATA)
 			return;
-
-		section = ds->hdr & DECT_CLMS_SECTION_NUM_MASK;
-		dect_debug(DECT_DEBUG_CLMS, "  data section %u:\n", section);
-		dect_hexdump(DECT_DEBUG_CLMS, "\tData", ds->data, 4);
-
-		if (section >= 5)
+		if ((ds->hdr & DECT_CLMS_SECTION_NUM_MASK) != section ||
+		    section >= 5)
 			return;
-		if (section != sections)
-			return;
-		sections++;
 
-		n = min(len, DECT_CLMS_DATA_SIZE);
-		memcpy(dect_mbuf_put(mbr, n), ds->data, n);
-		len -= n;
+		if (dect_debug_enabled(DECT_DEBUG_CLMS)) {
+			dect_debug(DECT_DEBUG_CLMS, "  data section %u:\n", section);
+			dect_hexdump(DECT_DEBUG_CLMS, "\tData", ds->data,
+				     DECT_CLMS_DATA_SIZE);
+		}
 
-		dect_mbuf_pull(mb, sizeof(*ds));
+		n = min(len - section * DECT_CLMS_DATA_SIZE, DECT_CLMS_DATA_SIZE);
+		memmove(data + section * DECT_CLMS_DATA_SIZE, ds->data, n);
 	}
+	mb->len = len;
 
-	if (len > 0)
-		return;
 deliver:
-	dect_mbuf_dump(DECT_DEBUG_CLMS, mbr, "CLMS");
+	dect_mbuf_dump(DECT_DEBUG_CLMS, mb, "CLMS");
 
 	clms_debug("MNCL_UNITDATA-ind: type: %u", DECT_CLMS_FIXED);
-	dh->ops->clms_ops->mncl_unitdata_ind(dh, DECT_CLMS_FIXED, NULL, mbr);
+	dh->ops->clms_ops->mncl_unitdata_ind(dh, DECT_CLMS_FIXED, NULL, mb);
 }
 
 static void dect_clms_send_fixed(struct dect_handle *dh,
@@ -194,6 +213,65 @@ void dect_mncl_unitdata_req(struct dect_handle *dh,
 }
 EXPORT_SYMBOL(dect_mncl_unitdata_req);
 
+/**
+ * DECT_MNCL_UNITDATA-req primitive for multiple portable parts
+ *
+ * @param dh		libdect DECT handle
+ * @param type		message type (fixed/variable) to use
+ * @param tpui		connectionless group TPUI for {CLMS-VARIABLE} messages
+ * @param ipuis		IPUIs of the destination portable parts
+ * @param n		number of destinations
+ * @param param		unitdata parameters for {CLMS-VARIABLE} messages
+ * @param mb		message buffer for {CLMS-FIXED} messages
+ *
+ * {CLMS-FIXED} messages are sent once on the broadcast channel, which reaches
+ * all portable parts. {CLMS-VARIABLE} messages are built once, addressed to
+ * the connectionless group TPUI, and sent over the data links to the portable
+ * parts, which are established on demand with bounded concurrency.
+ *
+ * @return 0 on success or -1 on error.
+ */
+int dect_mncl_unitdata_multicast_req(struct dect_handle *dh,
+				     enum dect_clms_message_types type,
+				     const struct dect_tpui *tpui,
+				     const struct dect_ipui *ipuis,
+				     unsigned int n,
+				     const struct dect_mncl_unitdata_param *param,
+				     const struct dect_msg_buf *mb)
+{
+	struct dect_ie_portable_identity portable_identity;
+	struct dect_clms_variable_msg msg;
+
+	clms_debug_entry("MNCL_UNITDATA-req: type: %u destinations: %u",
+			 type, n);
+
+	if (type == DECT_CLMS_FIXED) {
+		dect_clms_send_fixed(dh, mb->data, mb->len);
+		return 0;
+	}
+
+	if (tpui == NULL || tpui->type != DECT_TPUI_CONNECTIONLESS_GROUP) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	memset(&portable_identity, 0, sizeof(portable_identity));
+	portable_identity.type	= DECT_PORTABLE_ID_TYPE_TPUI;
+	portable_identity.tpui	= *tpui;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.portable_identity	  = &portable_identity;
+	msg.alphanumeric	  = param->alphanumeric;
+	msg.iwu_to_iwu		  = param->iwu_to_iwu;
+	msg.iwu_packet		  = param->iwu_packet;
+	msg.escape_to_proprietary = param->escape_to_proprietary;
+
+	return dect_lce_send_cl_multicast(dh, ipuis, n, &clms_variable_msg_desc,
+					  &msg.common, DECT_PD_CLMS,
+					  CLMS_VARIABLE);
+}
+EXPORT_SYMBOL(dect_mncl_unitdata_multicast_req);
+
 static void dect_clms_rcv_variable(struct dect_handle *dh,
 				   struct dect_transaction *ta,
 				   struct dect_msg_buf *mb)
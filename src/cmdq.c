@@ -0,0 +1,274 @@
+/*
+ * libdect command queue
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @defgroup cmdq Command queue
+ *
+ * Submission of requests from threads other than the event loop thread.
+ *
+ * libdect requests must be invoked from the thread driving the handle.
+ * Other threads can submit commands to the handle's command queue using
+ * dect_cmdq_submit(), the command functions are invoked from the event loop
+ * and may use all functions of the handle. The queue is a bounded lock-free
+ * multi-producer single-consumer ring, the event loop is woken up through
+ * an eventfd registered with the handle's event ops. Commands are executed
+ * in submission order per thread, in batches of all commands queued at the
+ * time the event loop runs.
+ *
+ * @{
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/eventfd.h>
+
+#include <libdect.h>
+#include <utils.h>
+#include <io.h>
+
+/**
+ * struct dect_cmdq_cell - command queue slot
+ *
+ * @seq:	sequence number, equal to the position when the slot is free and
+ *		to the position + 1 once a command was stored
+ * @fn:		command function
+ * @arg:	command argument
+ */
+struct dect_cmdq_cell {
+	unsigned long		seq;
+	void			(*fn)(struct dect_handle *dh, void *arg);
+	void			*arg;
+};
+
+/**
+ * struct dect_cmdq - command queue
+ *
+ * @dfd:	eventfd signalling queued commands
+ * @mask:	number of slots - 1
+ * @stats:	statistics, except @rejected only updated by the event loop
+ * @tail:	position of the next command to enqueue
+ * @signalled:	event loop wakeup pending
+ * @head:	position of the next command to execute
+ * @cells:	queue slots
+ *
+ * The padding keeps the producer and consumer positions on separate cache
+ * lines.
+ */
+struct dect_cmdq {
+	struct dect_fd			*dfd;
+	unsigned long			mask;
+	struct dect_cmdq_stats		stats;
+
+	unsigned long			tail;
+	bool				signalled;
+	uint8_t				__pad1[64];
+
+	unsigned long			head;
+	uint8_t				__pad2[64];
+	struct dect_cmdq_cell		cells[];
+};
+
+static void dect_cmdq_notify(struct dect_cmdq *cq)
+{
+	const uint64_t one = 1;
+	ssize_t ret;
+
+	/* Only fails if the counter would overflow, which can't happen */
+	ret = write(cq->dfd->fd, &one, sizeof(one));
+	(void)ret;
+}
+
+/* Execute the commands queued when invoked, returns false if some remain */
+static bool dect_cmdq_run(struct dect_handle *dh, struct dect_cmdq *cq)
+{
+	struct dect_cmdq_cell *cell;
+	unsigned long n;
+
+	for (n = 0; n <= cq->mask; n++) {
+		cell = &cq->cells[cq->head & cq->mask];
+		if (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != cq->head + 1)
+			break;
+
+		cell->fn(dh, cell->arg);
+
+		__atomic_store_n(&cell->seq, cq->head + cq->mask + 1,
+				 __ATOMIC_RELEASE);
+		cq->head++;
+	}
+
+	if (n > 0) {
+		cq->stats.executed += n;
+		cq->stats.batches++;
+		cq->stats.max_batch = max(cq->stats.max_batch, (uint64_t)n);
+	}
+	return n <= cq->mask;
+}
+
+static void dect_cmdq_event(struct dect_handle *dh, struct dect_fd *dfd,
+			    uint32_t events)
+{
+	struct dect_cmdq *cq = dfd->data;
+	uint64_t val;
+
+	if (read(dfd->fd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+		return;
+
+	/* Commands submitted after this point signal the event loop again */
+	__atomic_store_n(&cq->signalled, false, __ATOMIC_SEQ_CST);
+	if (!dect_cmdq_run(dh, cq) &&
+	    !__atomic_exchange_n(&cq->signalled, true, __ATOMIC_SEQ_CST))
+		dect_cmdq_notify(cq);
+}
+
+/**
+ * Create the command queue of a handle
+ *
+ * @param dh		libdect DECT handle
+ * @param size		maximum number of queued commands, a power of two
+ *
+ * @return 0 on success or -1 on error.
+ */
+int dect_cmdq_init(struct dect_handle *dh, unsigned int size)
+{
+	struct dect_cmdq *cq;
+	unsigned long i;
+
+	if (dh->cmdq != NULL || size < 2 || size > DECT_CMDQ_SIZE_MAX ||
+	    (size & (size - 1))) {
+		errno = EINVAL;
+		goto err1;
+	}
+
+	cq = dect_zalloc(dh, sizeof(*cq) + size * sizeof(cq->cells[0]));
+	if (cq == NULL)
+		goto err1;
+	cq->mask = size - 1;
+	for (i = 0; i < size; i++)
+		cq->cells[i].seq = i;
+
+	cq->dfd = dect_fd_alloc(dh);
+	if (cq->dfd == NULL)
+		goto err2;
+	cq->dfd->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (cq->dfd->fd < 0)
+		goto err3;
+	dect_fd_setup(cq->dfd, dect_cmdq_event, cq);
+	if (dect_fd_register(dh, cq->dfd, DECT_FD_READ) < 0)
+		goto err3;
+
+	dh->cmdq = cq;
+	return 0;
+
+err3:
+	dect_close(dh, cq->dfd);
+err2:
+	dect_free(dh, cq);
+err1:
+	return -1;
+}
+EXPORT_SYMBOL(dect_cmdq_init);
+
+/**
+ * Destroy the command queue of a handle
+ *
+ * @param dh		libdect DECT handle
+ *
+ * Commands still queued are executed before this function returns. No
+ * commands may be submitted concurrently.
+ */
+void dect_cmdq_exit(struct dect_handle *dh)
+{
+	struct dect_cmdq *cq = dh->cmdq;
+
+	if (cq == NULL)
+		return;
+
+	while (!dect_cmdq_run(dh, cq))
+		;
+	dh->cmdq = NULL;
+
+	dect_fd_unregister(dh, cq->dfd);
+	dect_close(dh, cq->dfd);
+	dect_free(dh, cq);
+}
+EXPORT_SYMBOL(dect_cmdq_exit);
+
+/**
+ * Submit a command to the event loop of a handle
+ *
+ * @param dh		libdect DECT handle
+ * @param fn		command function
+ * @param arg		command argument
+ *
+ * May be called from any thread. The command function is invoked with the
+ * handle and argument from the event loop thread.
+ *
+ * @return 0 on success or -1 with errno set to EAGAIN if the queue is full.
+ */
+int dect_cmdq_submit(struct dect_handle *dh,
+		     void (*fn)(struct dect_handle *dh, void *arg), void *arg)
+{
+	struct dect_cmdq *cq = dh->cmdq;
+	struct dect_cmdq_cell *cell;
+	unsigned long pos, seq;
+
+	pos = __atomic_load_n(&cq->tail, __ATOMIC_RELAXED);
+	for (;;) {
+		cell = &cq->cells[pos & cq->mask];
+		seq  = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+
+		if (seq == pos) {
+			if (__atomic_compare_exchange_n(&cq->tail, &pos, pos + 1,
+							true, __ATOMIC_RELAXED,
+							__ATOMIC_RELAXED))
+				break;
+		} else if ((long)(seq - pos) < 0) {
+			__atomic_add_fetch(&cq->stats.rejected, 1,
+					   __ATOMIC_RELAXED);
+			errno = EAGAIN;
+			return -1;
+		} else
+			pos = __atomic_load_n(&cq->tail, __ATOMIC_RELAXED);
+	}
+
+	cell->fn  = fn;
+	cell->arg = arg;
+	__atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+
+	if (!__atomic_exchange_n(&cq->signalled, true, __ATOMIC_SEQ_CST))
+		dect_cmdq_notify(cq);
+	return 0;
+}
+EXPORT_SYMBOL(dect_cmdq_submit);
+
+/**
+ * Get the command queue statistics of a handle
+ *
+ * @param dh		libdect DECT handle
+ * @param stats		result pointer to the statistics
+ *
+ * Must be called from the event loop thread.
+ */
+void dect_cmdq_get_stats(const struct dect_handle *dh,
+			 struct dect_cmdq_stats *stats)
+{
+	const struct dect_cmdq *cq = dh->cmdq;
+
+	memset(stats, 0, sizeof(*stats));
+	if (cq == NULL)
+		return;
+
+	*stats = cq->stats;
+	stats->rejected = __atomic_load_n(&cq->stats.rejected,
+					  __ATOMIC_RELAXED);
+}
+EXPORT_SYMBOL(dect_cmdq_get_stats);
+
+/** @} */
@@ -21,12 +21,25 @@
 
 /**
  * @defgroup debug Debugging
+ *
+ * Debugging messages are passed to a hook or printed to stdout.
+ *
+ * Handles of different clusters may be driven by different threads of one
+ * process. A handle may specify its own hook using
+ * dect_handle_set_debug_hook(), which receives the messages emitted while
+ * the thread processes events of the handle. The remaining settings are
+ * process-wide and should be configured before starting threads.
+ *
  * @{
  */
 
 static void __fmtstring(2, 0) (*debug_hook)(enum dect_debug_subsys subsys,
 					    const char *fmt, va_list ap);
 
+/* Hook of the handle last bound to the calling thread */
+static __thread void __fmtstring(2, 0) (*thread_debug_hook)(enum dect_debug_subsys subsys,
+							    const char *fmt, va_list ap);
+
 /**
  * Set callback hook for debugging messages
  *
@@ -39,6 +52,80 @@ void dect_set_debug_hook(void (*fn)(enum dect_debug_subsys subsys,
 }
 EXPORT_SYMBOL(dect_set_debug_hook);
 
+/**
+ * Set callback hook for debugging messages of a handle
+ *
+ * @param dh	libdect DECT handle
+ * @param fn	callback function, NULL to use the global hook
+ *
+ * The hook receives the messages emitted by the calling thread from now on
+ * and by any thread while processing events of the handle.
+ */
+void dect_handle_set_debug_hook(struct dect_handle *dh,
+				void (*fn)(enum dect_debug_subsys subsys,
+					   const char *fmt, va_list ap))
+{
+	dh->debug_hook = fn;
+	dect_debug_bind(dh);
+}
+EXPORT_SYMBOL(dect_handle_set_debug_hook);
+
+/* Route debugging messages of the calling thread to the hook of a handle */
+void dect_debug_bind(const struct dect_handle *dh)
+{
+	thread_debug_hook = dh->debug_hook;
+}
+
+#ifdef DEBUG
+unsigned int dect_debug_mask = DECT_DEBUG_ALL;
+#endif
+
+/**
+ * Set the mask of subsystems emitting debugging messages
+ *
+ * @param mask	bitmask of #DECT_DEBUG_MASK() values, #DECT_DEBUG_ALL by default
+ *
+ * Debugging messages of masked subsystems are discarded before any
+ * formatting takes place.
+ */
+void dect_set_debug_mask(unsigned int mask)
+{
+#ifdef DEBUG
+	dect_debug_mask = mask;
+#endif
+}
+EXPORT_SYMBOL(dect_set_debug_mask);
+
+unsigned int dect_debug_flags;
+
+/**
+ * Set debugging flags
+ *
+ * @param flags	bitmask of #dect_debug_flags values
+ *
+ * With #DECT_DEBUG_DEFER_DUMPS, messages transmitted and received on data
+ * links are not dumped inline, but copied to a history of the last
+ * messages of each link, which is dumped when the link fails.
+ */
+void dect_set_debug_flags(unsigned int flags)
+{
+	dect_debug_flags = flags;
+}
+EXPORT_SYMBOL(dect_set_debug_flags);
+
+/**
+ * Get the mask of subsystems emitting debugging messages
+ */
+unsigned int dect_get_debug_mask(void)
+{
+#ifdef DEBUG
+	return dect_debug_mask;
+#else
+	return 0;
+#endif
+}
+EXPORT_SYMBOL(dect_get_debug_mask);
+
 #ifdef DEBUG
 void __fmtstring(2, 3) __dect_debug(enum dect_debug_subsys subsys,
 				    const char *fmt, ...)
@@ -46,10 +133,14 @@ void __fmtstring(2, 3) __dect_debug(enum dect_debug_subsys subsys,
 	va_list ap;
 
 	va_start(ap, fmt);
-	if (debug_hook != NULL)
-		debug_hook(subsys, fmt, ap);
-	else
-		vprintf(fmt, ap);
+	if (!dect_trace_ring_vlog(subsys, fmt, ap)) {
+		if (thread_debug_hook != NULL)
+			thread_debug_hook(subsys, fmt, ap);
+		else if (debug_hook != NULL)
+			debug_hook(subsys, fmt, ap);
+		else
+			vprintf(fmt, ap);
+	}
 	va_end(ap);
 }
 
@@ -58,19 +149,27 @@ void __fmtstring(2, 3) __dect_debug(enum dect_debug_subsys subsys,
 void __dect_hexdump(enum dect_debug_subsys subsys, const char *prefix,
 		    const uint8_t *buf, size_t size)
 {
+	static const char hex[] = "0123456789abcdef";
 	unsigned int i, off, plen = 0;
 	char hbuf[3 * BLOCKSIZE + 1], abuf[BLOCKSIZE + 1];
+	const char *p;
+
+	if (dect_trace_ring_hexdump(subsys, prefix, buf, size))
+		return;
 
-	for (i = 0; i < strlen(prefix); i++)
-		plen += prefix[i] == '\t' ? 8 : 1;
+	for (p = prefix; *p != '\0'; p++)
+		plen += *p == '\t' ? 8 : 1;
 
 	for (i = 0; i < size; i++) {
 		off = i % BLOCKSIZE;
 
-		sprintf(hbuf + 3 * off, "%.2x ", buf[i]);
+		hbuf[3 * off + 0] = hex[buf[i] >> 4];
+		hbuf[3 * off + 1] = hex[buf[i] & 0xf];
+		hbuf[3 * off + 2] = ' ';
 		abuf[off] = isascii(buf[i]) && isprint(buf[i]) ? buf[i] : '.';
 
 		if (off == BLOCKSIZE - 1 || i == size - 1) {
+			hbuf[3 * off + 3] = '\0';
 			abuf[off + 1] = '\0';
 			dect_debug(subsys, "%s: %-*s    |%s|\n",
 				   prefix, 64 - plen, hbuf, abuf);
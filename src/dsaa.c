@@ -13,6 +13,8 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <stdint.h>
+#include <string.h>
+#include <asm/byteorder.h>
 
 #include <dect/auth.h>
 #include <libdect.h>
@@ -53,110 +55,154 @@ static const uint8_t sbox[256] = {
 	0x23, 0xeb, 0x0b, 0xd2, 0xa1, 0x90, 0x26, 0x12,
 };
 
-static void bitperm(uint8_t start, uint8_t step, uint8_t *key)
+/*
+ * The bit permutations move bit i of the 64 bit key, with bit 0 being the
+ * least significant bit of the first byte, to bit (start + i * step) % 64.
+ * They are performed by nibbles, the permN tables contain the result of
+ * moving bit j of a nibble to bit j * N. Since the permutation is affine,
+ * the result for nibble n is the table entry rotated by start + 4 * n * step.
+ */
+static const uint64_t perm27[16] = {
+	0x0000000000000000ULL, 0x0000000000000001ULL, 0x0000000008000000ULL,
+	0x0000000008000001ULL, 0x0040000000000000ULL, 0x0040000000000001ULL,
+	0x0040000008000000ULL, 0x0040000008000001ULL, 0x0000000000020000ULL,
+	0x0000000000020001ULL, 0x0000000008020000ULL, 0x0000000008020001ULL,
+	0x0040000000020000ULL, 0x0040000000020001ULL, 0x0040000008020000ULL,
+	0x0040000008020001ULL,
+};
+
+static const uint64_t perm35[16] = {
+	0x0000000000000000ULL, 0x0000000000000001ULL, 0x0000000800000000ULL,
+	0x0000000800000001ULL, 0x0000000000000040ULL, 0x0000000000000041ULL,
+	0x0000000800000040ULL, 0x0000000800000041ULL, 0x0000020000000000ULL,
+	0x0000020000000001ULL, 0x0000020800000000ULL, 0x0000020800000001ULL,
+	0x0000020000000040ULL, 0x0000020000000041ULL, 0x0000020800000040ULL,
+	0x0000020800000041ULL,
+};
+
+static const uint64_t perm39[16] = {
+	0x0000000000000000ULL, 0x0000000000000001ULL, 0x0000008000000000ULL,
+	0x0000008000000001ULL, 0x0000000000004000ULL, 0x0000000000004001ULL,
+	0x0000008000004000ULL, 0x0000008000004001ULL, 0x0020000000000000ULL,
+	0x0020000000000001ULL, 0x0020008000000000ULL, 0x0020008000000001ULL,
+	0x0020000000004000ULL, 0x0020000000004001ULL, 0x0020008000004000ULL,
+	0x0020008000004001ULL,
+};
+
+static const uint64_t perm47[16] = {
+	0x0000000000000000ULL, 0x0000000000000001ULL, 0x0000800000000000ULL,
+	0x0000800000000001ULL, 0x0000000040000000ULL, 0x0000000040000001ULL,
+	0x0000800040000000ULL, 0x0000800040000001ULL, 0x0000000000002000ULL,
+	0x0000000000002001ULL, 0x0000800000002000ULL, 0x0000800000002001ULL,
+	0x0000000040002000ULL, 0x0000000040002001ULL, 0x0000800040002000ULL,
+	0x0000800040002001ULL,
+};
+
+static inline uint64_t rol64(uint64_t val, unsigned int shift)
 {
-	uint8_t copy[8];
-	unsigned int i;
+	return val << shift | val >> ((64 - shift) & 63);
+}
 
-	memcpy(copy, key, 8);
-	memset(key, 0, 8);
+static inline uint64_t bitperm(unsigned int start, unsigned int step,
+			       const uint64_t *perm, uint64_t key)
+{
+	uint64_t res = 0;
+	unsigned int i;
 
-	for (i = 0; i < 64; i++) {
-		key[start/8] |= ((copy[i / 8] & (1 << (i % 8))) >>
-				(i % 8)) << (start % 8);
-		start += step;
-		start %= 64;
+	for (i = 0; i < 16; i++) {
+		res |= rol64(perm[key & 0xf], start % 64);
+		start += 4 * step;
+		key >>= 4;
 	}
+	return res;
 }
 
-static const uint8_t mix_factor[3][8] = {
-	{ 2, 2, 2, 2, 3, 3, 3, 3},
-	{ 2, 2, 3, 3, 2, 2, 3, 3},
-	{ 2, 3, 2, 3, 2, 3, 2, 3},
-};
+/*
+ * Bytewise operations on 64 bit words, without carries between the bytes
+ */
+#define BYTE_MSB	0x8080808080808080ULL
 
-static const uint8_t mix_index[3][8] = {
-	{ 4, 5, 6, 7, 0, 1, 2, 3},
-	{ 2, 3, 0, 1, 6, 7, 4, 5},
-	{ 1, 0, 3, 2, 5, 4, 7, 6},
-};
+static inline uint64_t bytewise_add(uint64_t a, uint64_t b)
+{
+	return ((a & ~BYTE_MSB) + (b & ~BYTE_MSB)) ^ ((a ^ b) & BYTE_MSB);
+}
 
-static void mix(uint8_t start, uint8_t alg, uint8_t *key)
+static inline uint64_t bytewise_shl1(uint64_t a)
 {
-	uint8_t copy[8];
-	unsigned int i;
+	return (a & ~BYTE_MSB) << 1;
+}
 
-	memcpy(copy, key, 8);
-	for (i = 0; i < 8; i++)
-		key[i] = copy[mix_index[alg][i]] + mix_factor[alg][i] * copy[i];
+/*
+ * The mix functions add each byte multiplied by two or three to its partner
+ * byte: mix1 pairs byte i with byte i ^ 4, mix2 with byte i ^ 2 and mix3 with
+ * byte i ^ 1. The multiplier is three for the bytes for which the respective
+ * bit of the index is set.
+ */
+static inline uint64_t mix(uint64_t key, uint64_t partner, uint64_t mul3_mask)
+{
+	return bytewise_add(partner, bytewise_add(bytewise_shl1(key),
+						  key & mul3_mask));
 }
 
-static void mix1(uint8_t *key)
+static inline uint64_t mix1(uint64_t key)
 {
-	mix(4, 0, key);
+	return mix(key, rol64(key, 32), 0xffffffff00000000ULL);
 }
 
-static void mix2(uint8_t *key)
+static inline uint64_t mix2(uint64_t key)
 {
-	mix(2, 1, key);
+	return mix(key, (key >> 16 & 0x0000ffff0000ffffULL) |
+			(key << 16 & 0xffff0000ffff0000ULL),
+		   0xffff0000ffff0000ULL);
 }
 
-static void mix3(uint8_t *key)
+static inline uint64_t mix3(uint64_t key)
 {
-	mix(1, 2, key);
+	return mix(key, (key >> 8 & 0x00ff00ff00ff00ffULL) |
+			(key << 8 & 0xff00ff00ff00ff00ULL),
+		   0xff00ff00ff00ff00ULL);
 }
 
-static void sub(uint8_t *s, uint8_t *t)
+static inline uint64_t sub(uint64_t s, uint64_t t)
 {
+	uint64_t res = 0;
 	unsigned int i;
 
-	for (i = 0; i < 8; i++)
-		s[i] = sbox[s[i] ^ t[i]];
+	s ^= t;
+	for (i = 0; i < 64; i += 8)
+		res |= (uint64_t)sbox[s >> i & 0xff] << i;
+	return res;
 }
 
-/* return in s */
-static void cassable(uint8_t start, uint8_t step, uint8_t *t, uint8_t *s)
+/* return s */
+static uint64_t cassable(unsigned int start, unsigned int step,
+			 const uint64_t *perm, uint64_t t, uint64_t s)
 {
 	unsigned int i;
 
 	for (i = 0; i < 2; i++) {
-		bitperm(start, step, t);
-		sub(s, t);
-		mix1(s);
+		t = bitperm(start, step, perm, t);
+		s = mix1(sub(s, t));
 
-		bitperm(start, step, t);
-		sub(s, t);
-		mix2(s);
+		t = bitperm(start, step, perm, t);
+		s = mix2(sub(s, t));
 
-		bitperm(start, step, t);
-		sub(s, t);
-		mix3(s);
+		t = bitperm(start, step, perm, t);
+		s = mix3(sub(s, t));
 	}
+	return s;
 }
 
-/* return in rand, modifies key */
-static void step1(uint8_t *rand, uint8_t *key)
+static uint64_t step1(uint64_t rand, uint64_t key)
 {
-	uint8_t tmp[8];
-
-	memcpy(tmp, rand, 8);
-
-	cassable(46, 35, tmp, key);
-	cassable(25, 47, key, rand);
-
-	memcpy(key, rand, 8);
+	key = cassable(46, 35, perm35, rand, key);
+	return cassable(25, 47, perm47, key, rand);
 }
 
-static void step2(uint8_t *rand, uint8_t *key)
+static uint64_t step2(uint64_t rand, uint64_t key)
 {
-	uint8_t tmp[8];
-
-	memcpy(tmp, rand, 8);
-
-	cassable(60, 27, tmp, key);
-	cassable(55, 39, key, rand);
-
-	memcpy(key, rand, 8);
+	key = cassable(60, 27, perm27, rand, key);
+	return cassable(55, 39, perm39, key, rand);
 }
 
 static void rev(uint8_t *v, uint8_t n)
@@ -171,12 +217,25 @@ static void rev(uint8_t *v, uint8_t n)
 	}
 }
 
+static uint64_t load64(const uint8_t *p)
+{
+	uint64_t val;
+
+	memcpy(&val, p, sizeof(val));
+	return __le64_to_cpu(val);
+}
+
+static void store64(uint8_t *p, uint64_t val)
+{
+	val = __cpu_to_le64(val);
+	memcpy(p, &val, sizeof(val));
+}
+
 static void dsaa_main(const uint8_t *k, const uint8_t *r, uint8_t *e)
 {
 	uint8_t key[16];
 	uint8_t rand[8];
 	uint8_t a[8];
-	uint8_t b[8];
 
 	memcpy(key, k, sizeof(key));
 	rev(key, 16);
@@ -184,12 +243,10 @@ static void dsaa_main(const uint8_t *k, const uint8_t *r, uint8_t *e)
 	memcpy(&rand, r, sizeof(rand));
 	rev(rand, 8);
 
-	step1(rand, key + 4);
-	memcpy(a, key + 4, 8);
+	store64(a, step1(load64(rand), load64(key + 4)));
 
 	memcpy(key + 4, key + 12, 4);
-	memcpy(b, a, 8);
-	step2(b, key);
+	store64(key, step2(load64(a), load64(key)));
 
 	rev(a, 8);
 	rev(key, 4);
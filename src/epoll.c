@@ -0,0 +1,345 @@
+/*
+ * libdect epoll event backend
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @addtogroup events
+ * @{
+ *
+ * @defgroup epoll epoll event backend
+ *
+ * Built-in event handler based on epoll and timerfd.
+ *
+ * Applications that don't need to integrate libdect with an existing event
+ * library can use the built-in event handler instead of implementing
+ * struct dect_event_ops. dect_epoll_alloc() installs the event ops in the
+ * DECT ops, which are then passed to dect_open_handle() as usual. All file
+ * descriptors and timers of the handle are multiplexed onto a single epoll
+ * file descriptor returned by dect_epoll_fd(), which can be added to an
+ * application's own poll loop. Whenever it becomes readable,
+ * dect_epoll_dispatch() processes the pending events.
+ *
+ * File descriptors are registered level-triggered, libdect's receive
+ * budget limits the amount of work done per file descriptor and dispatch
+ * call. Timers are kept on a list sorted by expiry time, the timerfd is
+ * armed for the first one.
+ *
+ * Each priority class of file descriptors has its own epoll file descriptor
+ * nested in the main one. A dispatch call processes up to
+ * #DECT_EPOLL_EVENTS_MAX events, taken from the classes in order of their
+ * priority. A class that was ready but got no share for
+ * #DECT_EPOLL_STARVE_MAX consecutive calls is served a small quota ahead of
+ * the others, bounding the delay of listener and netlink events while the
+ * higher classes are saturated.
+ *
+ * @{
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/epoll.h>
+
+#include <libdect.h>
+#include <utils.h>
+#include <list.h>
+#include <io.h>
+#include <timer.h>
+
+/* Maximum number of events processed by a single dispatch call */
+#define DECT_EPOLL_EVENTS_MAX		32
+
+/* Number of dispatch calls a ready class may be skipped */
+#define DECT_EPOLL_STARVE_MAX		8
+/* Number of events processed for a starved class */
+#define DECT_EPOLL_STARVE_QUOTA		4
+
+/* Event data of the timerfd in the main epoll file descriptor */
+#define DECT_EPOLL_TIMER		__DECT_FD_PRIO_MAX
+
+/**
+ * struct dect_epoll - epoll event backend
+ *
+ * @ops:	event ops installed in the DECT ops
+ * @dops:	DECT ops, used for memory allocation
+ * @epfd:	epoll file descriptor
+ * @cfd:	epoll file descriptors of the priority classes
+ * @starved:	number of dispatch calls a ready class was skipped
+ * @tq:		timer queue
+ * @pending:	events being processed
+ * @npending:	number of events being processed
+ */
+struct dect_epoll {
+	struct dect_event_ops	ops;
+	const struct dect_ops	*dops;
+	int			epfd;
+	int			cfd[__DECT_FD_PRIO_MAX];
+	unsigned int		starved[__DECT_FD_PRIO_MAX];
+	struct dect_timer_queue	tq;
+	struct epoll_event	*pending;
+	int			npending;
+};
+
+static struct dect_epoll *dect_epoll(const struct dect_handle *dh)
+{
+	return container_of(dh->ops->event_ops, struct dect_epoll, ops);
+}
+
+static int dect_epoll_register_fd(const struct dect_handle *dh,
+				  struct dect_fd *dfd, uint32_t events)
+{
+	struct dect_epoll *ep = dect_epoll(dh);
+	struct epoll_event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	if (events & DECT_FD_READ)
+		ev.events |= EPOLLIN;
+	if (events & DECT_FD_WRITE)
+		ev.events |= EPOLLOUT;
+	ev.data.ptr = dfd;
+
+	return epoll_ctl(ep->cfd[dect_fd_priority(dfd)], EPOLL_CTL_ADD,
+			 dect_fd_num(dfd), &ev);
+}
+
+static void dect_epoll_unregister_fd(const struct dect_handle *dh,
+				     struct dect_fd *dfd)
+{
+	struct dect_epoll *ep = dect_epoll(dh);
+	int i;
+
+	epoll_ctl(ep->cfd[dect_fd_priority(dfd)], EPOLL_CTL_DEL,
+		  dect_fd_num(dfd), NULL);
+
+	/* The file descriptor may be freed before its pending events are
+	 * processed. */
+	for (i = 0; i < ep->npending; i++) {
+		if (ep->pending[i].data.ptr == dfd)
+			ep->pending[i].data.ptr = NULL;
+	}
+}
+
+static void dect_epoll_start_timer(const struct dect_handle *dh,
+				   struct dect_timer *timer,
+				   const struct timeval *tv)
+{
+	dect_timer_queue_add(&dect_epoll(dh)->tq, timer, tv);
+}
+
+static void dect_epoll_stop_timer(const struct dect_handle *dh,
+				  struct dect_timer *timer)
+{
+	dect_timer_queue_del(&dect_epoll(dh)->tq, timer);
+}
+
+static void dect_epoll_close(struct dect_epoll *ep)
+{
+	unsigned int prio;
+
+	for (prio = 0; prio <= DECT_FD_PRIO_MAX; prio++) {
+		if (ep->cfd[prio] >= 0)
+			close(ep->cfd[prio]);
+	}
+	close(ep->epfd);
+}
+
+/**
+ * Allocate an epoll event backend and install its event ops
+ *
+ * @param ops		DECT ops
+ *
+ * Initialize ops->event_ops to use the built-in event handler. The backend
+ * must not be released before the handle using it has been closed.
+ *
+ * @return the new event backend or NULL on error.
+ */
+struct dect_epoll *dect_epoll_alloc(struct dect_ops *ops)
+{
+	struct epoll_event ev;
+	struct dect_epoll *ep;
+	unsigned int prio;
+
+	if (ops->malloc == NULL)
+		ops->malloc = malloc;
+	if (ops->free == NULL)
+		ops->free = free;
+
+	ep = ops->malloc(sizeof(*ep));
+	if (ep == NULL)
+		goto err1;
+	memset(ep, 0, sizeof(*ep));
+	ep->dops = ops;
+
+	ep->ops.fd_priv_size	= 0;
+	ep->ops.register_fd	= dect_epoll_register_fd;
+	ep->ops.unregister_fd	= dect_epoll_unregister_fd;
+	ep->ops.timer_priv_size	= sizeof(struct dect_timer_queue_entry);
+	ep->ops.start_timer	= dect_epoll_start_timer;
+	ep->ops.stop_timer	= dect_epoll_stop_timer;
+
+	for (prio = 0; prio <= DECT_FD_PRIO_MAX; prio++)
+		ep->cfd[prio] = -1;
+
+	ep->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (ep->epfd < 0)
+		goto err2;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	for (prio = 0; prio <= DECT_FD_PRIO_MAX; prio++) {
+		ep->cfd[prio] = epoll_create1(EPOLL_CLOEXEC);
+		if (ep->cfd[prio] < 0)
+			goto err3;
+		ev.data.u32 = prio;
+		if (epoll_ctl(ep->epfd, EPOLL_CTL_ADD, ep->cfd[prio], &ev) < 0)
+			goto err3;
+	}
+
+	if (dect_timer_queue_init(&ep->tq) < 0)
+		goto err3;
+
+	ev.data.u32 = DECT_EPOLL_TIMER;
+	if (epoll_ctl(ep->epfd, EPOLL_CTL_ADD, ep->tq.tfd, &ev) < 0)
+		goto err4;
+
+	ops->event_ops = &ep->ops;
+	return ep;
+
+err4:
+	dect_timer_queue_exit(&ep->tq);
+err3:
+	dect_epoll_close(ep);
+err2:
+	ops->free(ep);
+err1:
+	return NULL;
+}
+EXPORT_SYMBOL(dect_epoll_alloc);
+
+/**
+ * Release an epoll event backend
+ *
+ * @param ep		epoll event backend
+ */
+void dect_epoll_free(struct dect_epoll *ep)
+{
+	dect_timer_queue_exit(&ep->tq);
+	dect_epoll_close(ep);
+	ep->dops->free(ep);
+}
+EXPORT_SYMBOL(dect_epoll_free);
+
+/**
+ * Get the pollable file descriptor of an epoll event backend
+ *
+ * @param ep		epoll event backend
+ *
+ * The file descriptor becomes readable when events are pending.
+ */
+int dect_epoll_fd(const struct dect_epoll *ep)
+{
+	return ep->epfd;
+}
+EXPORT_SYMBOL(dect_epoll_fd);
+
+/* Process up to max events of a priority class */
+static int dect_epoll_run(struct dect_epoll *ep, struct dect_handle *dh,
+			  unsigned int prio, int max)
+{
+	struct epoll_event events[DECT_EPOLL_EVENTS_MAX];
+	struct dect_fd *dfd;
+	uint32_t mask;
+	int i, n;
+
+	n = epoll_wait(ep->cfd[prio], events, max, 0);
+	if (n <= 0)
+		return 0;
+
+	ep->pending  = events;
+	ep->npending = n;
+	for (i = 0; i < n; i++) {
+		dfd = events[i].data.ptr;
+		if (dfd == NULL)
+			continue;
+
+		mask = 0;
+		if (events[i].events & EPOLLOUT)
+			mask |= DECT_FD_WRITE;
+		if (events[i].events & ~EPOLLOUT)
+			mask |= DECT_FD_READ;
+		dect_fd_process(dh, dfd, mask);
+	}
+	ep->pending  = NULL;
+	ep->npending = 0;
+	return n;
+}
+
+/**
+ * Wait for and process pending events
+ *
+ * @param ep		epoll event backend
+ * @param dh		libdect DECT handle
+ * @param timeout	maximum time to wait in milliseconds, -1 for infinite
+ *
+ * Expired timers are run first, followed by the events of the file
+ * descriptors in order of their priority class.
+ *
+ * @return the number of processed events or -1 on error.
+ */
+int dect_epoll_dispatch(struct dect_epoll *ep, struct dect_handle *dh,
+			int timeout)
+{
+	struct epoll_event events[__DECT_FD_PRIO_MAX + 1];
+	unsigned int prio, ready = 0;
+	bool timer = false;
+	int budget, i, n;
+
+	n = epoll_wait(ep->epfd, events, array_size(events), timeout);
+	if (n < 0)
+		return errno == EINTR ? 0 : -1;
+
+	for (i = 0; i < n; i++) {
+		if (events[i].data.u32 == DECT_EPOLL_TIMER)
+			timer = true;
+		else
+			ready |= 1 << events[i].data.u32;
+	}
+
+	n = 0;
+	if (timer) {
+		dect_timer_queue_run(&ep->tq, dh);
+		n++;
+	}
+
+	budget = DECT_EPOLL_EVENTS_MAX;
+	for (prio = 0; prio <= DECT_FD_PRIO_MAX; prio++) {
+		if (!(ready & (1 << prio)) ||
+		    ep->starved[prio] < DECT_EPOLL_STARVE_MAX)
+			continue;
+		budget -= dect_epoll_run(ep, dh, prio, DECT_EPOLL_STARVE_QUOTA);
+		ep->starved[prio] = 0;
+		ready &= ~(1 << prio);
+	}
+
+	for (prio = 0; prio <= DECT_FD_PRIO_MAX; prio++) {
+		if (!(ready & (1 << prio)))
+			continue;
+		if (budget <= 0) {
+			ep->starved[prio]++;
+			continue;
+		}
+		budget -= dect_epoll_run(ep, dh, prio, budget);
+		ep->starved[prio] = 0;
+	}
+
+	return n + DECT_EPOLL_EVENTS_MAX - budget;
+}
+EXPORT_SYMBOL(dect_epoll_dispatch);
+
+/** @} */
+/** @} */
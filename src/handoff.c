@@ -0,0 +1,561 @@
+/*
+ * libdect socket handoff
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @defgroup handoff Socket handoff
+ *
+ * Hitless restarts by passing the sockets of a handle to a new process.
+ *
+ * dect_handoff_send() passes the B-SAP socket, the S-SAP listener socket,
+ * the sockets of all idle data links and the location table over a
+ * connected unix domain socket of type SOCK_SEQPACKET to another process,
+ * which opens a handle using dect_handoff_open(). Idle data links remain
+ * established, connections waiting in the S-SAP backlog are accepted by
+ * the new process.
+ *
+ * The netlink socket is opened again by the new process. Only the sockets
+ * are passed on, not the state of calls, MM procedures or other
+ * transactions. Data links with open transactions or queued messages are
+ * therefore not handed off. They stay with the sending handle and are
+ * released when it is closed, so applications should hand off once their
+ * calls have ended. The new process takes over the idle links subject to
+ * the regular release timers. Handoff is only supported for handles using
+ * the kernel transport and without shards.
+ *
+ * The new process acknowledges the handoff once it has taken over all
+ * sockets. Only then are the sockets of the sending handle detached: they
+ * don't receive any further messages and the socket operations of the
+ * remaining transactions fail. The handle must be closed using
+ * dect_close_handle(), which shuts down its transactions locally. If the
+ * new process fails, it detaches the passed sockets as well before closing
+ * its handle, so the links remain established for the sending handle.
+ *
+ * @{
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+#include <libdect.h>
+#include <netlink.h>
+#include <utils.h>
+#include <io.h>
+#include <timer.h>
+#include <lce.h>
+
+#define handoff_debug(fmt, args...) \
+	dect_debug(DECT_DEBUG_LCE, "handoff: " fmt, ## args)
+
+#define DECT_HANDOFF_MAGIC		0x44454354
+#define DECT_HANDOFF_VERSION		2
+
+/* Maximum number of records per message */
+#define DECT_HANDOFF_BATCH		64
+
+enum dect_handoff_msg_types {
+	DECT_HANDOFF_HELLO,
+	DECT_HANDOFF_LINKS,
+	DECT_HANDOFF_LTES,
+	DECT_HANDOFF_END,
+	DECT_HANDOFF_ACK,
+};
+
+/**
+ * struct dect_handoff_hdr - handoff message header
+ *
+ * @magic:	DECT_HANDOFF_MAGIC
+ * @version:	protocol version, includes the layout of the records
+ * @type:	message type (enum dect_handoff_msg_types)
+ * @count:	number of records following the header
+ */
+struct dect_handoff_hdr {
+	uint32_t				magic;
+	uint16_t				version;
+	uint16_t				type;
+	uint32_t				count;
+};
+
+/**
+ * struct dect_handoff_hello - handle description, passed along with the B-SAP
+ *			       and S-SAP listener sockets
+ *
+ * @index:	cluster index
+ * @mode:	cluster mode
+ * @nfds:	number of sockets
+ */
+struct dect_handoff_hello {
+	int32_t					index;
+	uint32_t				mode;
+	uint32_t				nfds;
+};
+
+/**
+ * struct dect_handoff_link - established data link, passed along with the
+ *			      data link socket
+ *
+ * @dlei:	data link endpoint identifier
+ * @mcp:	MAC connection parameters
+ * @ipui:	International Portable User ID, valid with DECT_DATA_LINK_IPUI_VALID
+ * @flags:	DECT_DATA_LINK_IPUI_VALID
+ */
+struct dect_handoff_link {
+	struct sockaddr_dect_ssap		dlei;
+	struct dect_mac_conn_params		mcp;
+	struct dect_ipui			ipui;
+	uint32_t				flags;
+};
+
+/* Records are passed in the size of the largest record type */
+union dect_handoff_record {
+	struct dect_handoff_hello		hello;
+	struct dect_handoff_link		link;
+	struct dect_lte_record			lte;
+};
+
+struct dect_handoff_msg {
+	struct dect_handoff_hdr			hdr;
+	union dect_handoff_record		rec[DECT_HANDOFF_BATCH];
+};
+
+static int dect_handoff_xmit(int sock, struct dect_handoff_msg *msg,
+			     enum dect_handoff_msg_types type, unsigned int count,
+			     const int *fds, unsigned int nfds)
+{
+	char cbuf[CMSG_SPACE(DECT_HANDOFF_BATCH * sizeof(int))];
+	struct cmsghdr *cmsg;
+	struct msghdr mh;
+	struct iovec iov;
+
+	msg->hdr.magic	 = DECT_HANDOFF_MAGIC;
+	msg->hdr.version = DECT_HANDOFF_VERSION;
+	msg->hdr.type	 = type;
+	msg->hdr.count	 = count;
+
+	iov.iov_base = msg;
+	iov.iov_len  = sizeof(msg->hdr) + count * sizeof(msg->rec[0]);
+
+	memset(&mh, 0, sizeof(mh));
+	mh.msg_iov    = &iov;
+	mh.msg_iovlen = 1;
+	if (nfds > 0) {
+		memset(cbuf, 0, sizeof(cbuf));
+		mh.msg_control	  = cbuf;
+		mh.msg_controllen = CMSG_SPACE(nfds * sizeof(int));
+
+		cmsg = CMSG_FIRSTHDR(&mh);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type	 = SCM_RIGHTS;
+		cmsg->cmsg_len	 = CMSG_LEN(nfds * sizeof(int));
+		memcpy(CMSG_DATA(cmsg), fds, nfds * sizeof(int));
+	}
+
+	return sendmsg(sock, &mh, MSG_NOSIGNAL) < 0 ? -1 : 0;
+}
+
+static void dect_handoff_close_fds(const int *fds, unsigned int nfds)
+{
+	unsigned int i;
+
+	for (i = 0; i < nfds; i++)
+		close(fds[i]);
+}
+
+/*
+ * Receive a message and the passed sockets, which are owned by the caller
+ * on success. Returns the message type or -1 on error.
+ */
+static int dect_handoff_recv(int sock, struct dect_handoff_msg *msg,
+			     int *fds, unsigned int *nfds)
+{
+	char cbuf[CMSG_SPACE(DECT_HANDOFF_BATCH * sizeof(int))];
+	struct cmsghdr *cmsg;
+	struct msghdr mh;
+	struct iovec iov;
+	ssize_t len;
+
+	iov.iov_base = msg;
+	iov.iov_len  = sizeof(*msg);
+
+	memset(&mh, 0, sizeof(mh));
+	mh.msg_iov	  = &iov;
+	mh.msg_iovlen	  = 1;
+	mh.msg_control	  = cbuf;
+	mh.msg_controllen = sizeof(cbuf);
+
+	len = recvmsg(sock, &mh, MSG_CMSG_CLOEXEC);
+	if (len < 0)
+		return -1;
+
+	*nfds = 0;
+	for (cmsg = CMSG_FIRSTHDR(&mh); cmsg != NULL;
+	     cmsg = CMSG_NXTHDR(&mh, cmsg)) {
+		if (cmsg->cmsg_level != SOL_SOCKET ||
+		    cmsg->cmsg_type != SCM_RIGHTS)
+			continue;
+		*nfds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		memcpy(fds, CMSG_DATA(cmsg), *nfds * sizeof(int));
+	}
+
+	if (mh.msg_flags & (MSG_TRUNC | MSG_CTRUNC) ||
+	    (size_t)len < sizeof(msg->hdr) ||
+	    msg->hdr.magic != DECT_HANDOFF_MAGIC ||
+	    msg->hdr.version != DECT_HANDOFF_VERSION ||
+	    msg->hdr.count > DECT_HANDOFF_BATCH ||
+	    (size_t)len != sizeof(msg->hdr) + msg->hdr.count * sizeof(msg->rec[0])) {
+		dect_handoff_close_fds(fds, *nfds);
+		errno = EPROTO;
+		return -1;
+	}
+	return msg->hdr.type;
+}
+
+/* Link a passed socket to a libdect file descriptor */
+static struct dect_fd *dect_handoff_fd(struct dect_handle *dh, int fd)
+{
+	struct dect_fd *dfd;
+
+	dfd = dect_fd_alloc(dh);
+	if (dfd == NULL)
+		return NULL;
+	dfd->fd = fd;
+	return dfd;
+}
+
+/* Only links without transaction state can be taken over */
+static bool dect_handoff_link_valid(const struct dect_data_link *ddl)
+{
+	return ddl->state == DECT_DATA_LINK_ESTABLISHED &&
+	       !(ddl->flags & DECT_DATA_LINK_DESTROYED) &&
+	       ddl->dfd != NULL && ddl->dfd->fd >= 0 &&
+	       list_empty(&ddl->transactions) &&
+	       ptrqueue_empty(&ddl->tx_queue);
+}
+
+/* Detach the sockets owned by the other process */
+static void dect_handoff_detach(struct dect_handle *dh)
+{
+	struct dect_data_link *ddl;
+
+	list_for_each_entry(ddl, &dh->links, list) {
+		if (dect_handoff_link_valid(ddl))
+			dect_fd_detach(dh, ddl->dfd);
+	}
+	if (dh->s_sap != NULL)
+		dect_fd_detach(dh, dh->s_sap);
+	dect_fd_detach(dh, dh->b_sap);
+}
+
+static int dect_handoff_send_links(const struct dect_handle *dh, int sock,
+				   struct dect_handoff_msg *msg)
+{
+	int fds[DECT_HANDOFF_BATCH];
+	struct dect_handoff_link *link;
+	struct dect_data_link *ddl;
+	unsigned int n = 0;
+
+	list_for_each_entry(ddl, &dh->links, list) {
+		if (!dect_handoff_link_valid(ddl))
+			continue;
+
+		link = &msg->rec[n].link;
+		memset(link, 0, sizeof(*link));
+		link->dlei  = ddl->dlei;
+		link->mcp   = ddl->mcp;
+		link->flags = ddl->flags & DECT_DATA_LINK_IPUI_VALID;
+		if (link->flags & DECT_DATA_LINK_IPUI_VALID)
+			link->ipui = ddl->ipui;
+		fds[n++] = ddl->dfd->fd;
+
+		if (n < DECT_HANDOFF_BATCH)
+			continue;
+		if (dect_handoff_xmit(sock, msg, DECT_HANDOFF_LINKS, n, fds, n) < 0)
+			return -1;
+		n = 0;
+	}
+
+	if (n > 0 &&
+	    dect_handoff_xmit(sock, msg, DECT_HANDOFF_LINKS, n, fds, n) < 0)
+		return -1;
+	return 0;
+}
+
+static int dect_handoff_send_ltes(const struct dect_handle *dh, int sock,
+				  struct dect_handoff_msg *msg)
+{
+	const struct dect_lte *lte;
+	unsigned int n = 0;
+
+	list_for_each_entry(lte, &dh->ldb, list) {
+		dect_lte_export(lte, &msg->rec[n++].lte);
+
+		if (n < DECT_HANDOFF_BATCH)
+			continue;
+		if (dect_handoff_xmit(sock, msg, DECT_HANDOFF_LTES, n,
+				      NULL, 0) < 0)
+			return -1;
+		n = 0;
+	}
+
+	if (n > 0 &&
+	    dect_handoff_xmit(sock, msg, DECT_HANDOFF_LTES, n, NULL, 0) < 0)
+		return -1;
+	return 0;
+}
+
+/**
+ * Pass the sockets and location table of a handle to another process
+ *
+ * @param dh		libdect DECT handle
+ * @param sock		connected unix domain socket of type SOCK_SEQPACKET
+ *
+ * Blocks until the other process has acknowledged the handoff. On success,
+ * the sockets of the handle are detached and the handle must be closed.
+ * On error, the handle remains usable.
+ *
+ * @return 0 on success or -1 on error.
+ */
+int dect_handoff_send(struct dect_handle *dh, int sock)
+{
+	struct dect_handoff_msg *msg;
+	int fds[DECT_HANDOFF_BATCH];
+	unsigned int nfds;
+	int type;
+
+	if (dh->transport != &dect_kernel_transport || dh->shard != NULL ||
+	    dh->open_state != DECT_OPEN_READY) {
+		errno = EOPNOTSUPP;
+		goto err1;
+	}
+
+	msg = dect_malloc(dh, sizeof(*msg));
+	if (msg == NULL)
+		goto err1;
+
+	memset(&msg->rec[0].hello, 0, sizeof(msg->rec[0].hello));
+	msg->rec[0].hello.index = dh->index;
+	msg->rec[0].hello.mode	= dh->mode;
+	fds[msg->rec[0].hello.nfds++] = dh->b_sap->fd;
+	if (dh->s_sap != NULL)
+		fds[msg->rec[0].hello.nfds++] = dh->s_sap->fd;
+
+	if (dect_handoff_xmit(sock, msg, DECT_HANDOFF_HELLO, 1,
+			      fds, msg->rec[0].hello.nfds) < 0)
+		goto err2;
+	if (dect_handoff_send_links(dh, sock, msg) < 0)
+		goto err2;
+	if (dect_handoff_send_ltes(dh, sock, msg) < 0)
+		goto err2;
+	if (dect_handoff_xmit(sock, msg, DECT_HANDOFF_END, 0, NULL, 0) < 0)
+		goto err2;
+
+	type = dect_handoff_recv(sock, msg, fds, &nfds);
+	if (type < 0)
+		goto err2;
+	dect_handoff_close_fds(fds, nfds);
+	if (type != DECT_HANDOFF_ACK) {
+		errno = ECONNABORTED;
+		goto err2;
+	}
+	dect_free(dh, msg);
+
+	/* The sockets are owned by the new process from now on */
+	dect_handoff_detach(dh);
+	return 0;
+
+err2:
+	dect_free(dh, msg);
+err1:
+	handoff_debug("send: %s\n", strerror(errno));
+	return -1;
+}
+EXPORT_SYMBOL(dect_handoff_send);
+
+static int dect_handoff_adopt_links(struct dect_handle *dh,
+				    const struct dect_handoff_msg *msg,
+				    const int *fds, unsigned int nfds)
+{
+	const struct dect_handoff_link *link;
+	struct dect_data_link *ddl;
+	struct dect_fd *dfd;
+	unsigned int i;
+
+	if (nfds != msg->hdr.count) {
+		dect_handoff_close_fds(fds, nfds);
+		errno = EPROTO;
+		return -1;
+	}
+
+	for (i = 0; i < nfds; i++) {
+		link = &msg->rec[i].link;
+
+		dfd = dect_handoff_fd(dh, fds[i]);
+		if (dfd == NULL)
+			goto err1;
+		if (dect_ddl_adopt(dh, dfd, &link->dlei, &link->mcp, false) < 0)
+			goto err2;
+
+		if (link->flags & DECT_DATA_LINK_IPUI_VALID) {
+			ddl = dfd->data;
+			dect_ddl_set_ipui(dh, ddl, &link->ipui);
+		}
+	}
+	return 0;
+
+err2:
+	dect_close(dh, dfd);
+	i++;
+err1:
+	dect_handoff_close_fds(fds + i, nfds - i);
+	return -1;
+}
+
+static int dect_handoff_import_ltes(struct dect_handle *dh,
+				    const struct dect_handoff_msg *msg)
+{
+	unsigned int i;
+
+	for (i = 0; i < msg->hdr.count; i++) {
+		if (dect_lte_import(dh, &msg->rec[i].lte) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+/* Receive the data links and location table following the HELLO message */
+static int dect_handoff_recv_state(struct dect_handle *dh, int sock,
+				   struct dect_handoff_msg *msg)
+{
+	int fds[DECT_HANDOFF_BATCH];
+	unsigned int nfds;
+	int type;
+
+	for (;;) {
+		type = dect_handoff_recv(sock, msg, fds, &nfds);
+		if (type < 0)
+			return -1;
+
+		switch (type) {
+		case DECT_HANDOFF_LINKS:
+			if (dect_handoff_adopt_links(dh, msg, fds, nfds) < 0)
+				return -1;
+			break;
+		case DECT_HANDOFF_LTES:
+			dect_handoff_close_fds(fds, nfds);
+			if (dect_handoff_import_ltes(dh, msg) < 0)
+				return -1;
+			break;
+		case DECT_HANDOFF_END:
+			dect_handoff_close_fds(fds, nfds);
+			return 0;
+		default:
+			dect_handoff_close_fds(fds, nfds);
+			errno = EPROTO;
+			return -1;
+		}
+	}
+}
+
+/**
+ * Open a handle using the sockets passed by another process
+ *
+ * @param ops		DECT ops
+ * @param cluster	Cluster name
+ * @param sock		connected unix domain socket of type SOCK_SEQPACKET
+ *
+ * Receives the state passed by dect_handoff_send(), binds to the cluster
+ * the sockets belong to and acknowledges the handoff.
+ *
+ * @return		a new libdect DECT handle or NULL on error.
+ */
+struct dect_handle *dect_handoff_open(struct dect_ops *ops, const char *cluster,
+				      int sock)
+{
+	const struct dect_handoff_hello *hello;
+	struct dect_handoff_msg *msg;
+	struct dect_handle *dh;
+	int fds[DECT_HANDOFF_BATCH];
+	unsigned int nfds;
+
+	if (cluster == NULL)
+		cluster = "cluster0";
+
+	dh = dect_alloc_handle(ops);
+	if (dh == NULL)
+		goto err1;
+	msg = dect_malloc(dh, sizeof(*msg));
+	if (msg == NULL)
+		goto err2;
+
+	if (dect_handoff_recv(sock, msg, fds, &nfds) != DECT_HANDOFF_HELLO)
+		goto err3;
+	hello = &msg->rec[0].hello;
+	if (msg->hdr.count != 1 || hello->nfds != nfds || nfds < 1 || nfds > 2) {
+		errno = EPROTO;
+		goto err4;
+	}
+
+	if (dect_netlink_init(dh, cluster) < 0)
+		goto err4;
+	if (dh->index != hello->index || dh->mode != hello->mode ||
+	    (dh->mode == DECT_MODE_FP) != (nfds == 2)) {
+		errno = EINVAL;
+		goto err5;
+	}
+
+	dh->b_sap = dect_handoff_fd(dh, fds[0]);
+	if (dh->b_sap == NULL)
+		goto err5;
+	if (nfds == 2) {
+		dh->s_sap = dect_handoff_fd(dh, fds[1]);
+		if (dh->s_sap == NULL)
+			goto err6;
+	}
+	/* The LCE owns the sockets from now on, even on error */
+	if (dect_lce_init(dh) < 0) {
+		dect_netlink_exit(dh);
+		goto err3;
+	}
+
+	if (dect_handoff_recv_state(dh, sock, msg) < 0 ||
+	    dect_handoff_xmit(sock, msg, DECT_HANDOFF_ACK, 0, NULL, 0) < 0) {
+		/* The sockets remain in use by the sending process */
+		dect_handoff_detach(dh);
+		dect_free(dh, msg);
+		dect_close_handle(dh);
+		goto err1;
+	}
+
+	dect_free(dh, msg);
+	return dh;
+
+err6:
+	dect_close(dh, dh->b_sap);
+	dect_handoff_close_fds(fds + 1, nfds - 1);
+	dect_netlink_exit(dh);
+	goto err3;
+err5:
+	dect_netlink_exit(dh);
+err4:
+	dect_handoff_close_fds(fds, nfds);
+err3:
+	dect_free(dh, msg);
+err2:
+	dect_timer_wheel_exit(dh);
+	dect_stats_exit(dh);
+	dect_mem_exit(dh);
+	dh->ops->free(dh);
+err1:
+	handoff_debug("open: %s\n", strerror(errno));
+	return NULL;
+}
+EXPORT_SYMBOL(dect_handoff_open);
+
+/** @} */
@@ -134,6 +134,42 @@ static void dect_dump_ipei(const struct dect_ipei *ipei)
 	sfmt_debug("\tPSN: %.5x\n", ipei->psn);
 }
 
+#define DECT_IPEI_EMC_DIGITS	5
+#define DECT_IPEI_PSN_DIGITS	7
+
+/* Check character of the digits of an IPEI, ETSI EN 300 175-6 Annex C */
+static char dect_ipei_check_char(const char *digits)
+{
+	unsigned int i, c = 0;
+
+	for (i = 0; i < DECT_IPEI_STRING_LEN - 1; i++)
+		c += (i + 1) * (digits[i] - '0');
+	c %= 11;
+	return c < 10 ? c + '0' : '*';
+}
+
+static void dect_format_digits(char *buf, uint32_t val, unsigned int n)
+{
+	while (n-- > 0) {
+		buf[n] = val % 10 + '0';
+		val /= 10;
+	}
+}
+
+static bool dect_parse_digits(const char *str, unsigned int n, uint32_t *val)
+{
+	unsigned int i, d;
+
+	*val = 0;
+	for (i = 0; i < n; i++) {
+		d = (unsigned char)str[i] - '0';
+		if (d > 9)
+			return false;
+		*val = *val * 10 + d;
+	}
+	return true;
+}
+
 /**
  * Format an IPEI as printed text
  *
@@ -144,21 +180,11 @@ static void dect_dump_ipei(const struct dect_ipei *ipei)
  */
 char *dect_format_ipei_string(const struct dect_ipei *ipei, char *buf)
 {
-	unsigned int i, c, len;
-
-	len = sprintf(buf, "%05u%07u", ipei->emc, ipei->psn);
-
-	c = 0;
-	for (i = 0; i < len; i++)
-		c += (i + 1) * (buf[i] - '0');
-	c %= 11;
-
-	if (c < 10)
-		buf[len] = c + '0';
-	else
-		buf[len] = '*';
-	buf[len + 1] = '\0';
-
+	dect_format_digits(buf, ipei->emc, DECT_IPEI_EMC_DIGITS);
+	dect_format_digits(buf + DECT_IPEI_EMC_DIGITS, ipei->psn,
+			   DECT_IPEI_PSN_DIGITS);
+	buf[DECT_IPEI_STRING_LEN - 1] = dect_ipei_check_char(buf);
+	buf[DECT_IPEI_STRING_LEN] = '\0';
 	return buf;
 }
 EXPORT_SYMBOL(dect_format_ipei_string);
@@ -176,26 +202,22 @@ EXPORT_SYMBOL(dect_format_ipei_string);
  */
 bool dect_parse_ipei_string(struct dect_ipei *ipei, const char *str)
 {
-	unsigned int i, c, len;
+	uint32_t emc, psn;
 
-	len = strlen(str);
-	if (len != DECT_IPEI_STRING_LEN)
+	if (strnlen(str, DECT_IPEI_STRING_LEN + 1) != DECT_IPEI_STRING_LEN)
+		return false;
+	if (!dect_parse_digits(str, DECT_IPEI_EMC_DIGITS, &emc) ||
+	    !dect_parse_digits(str + DECT_IPEI_EMC_DIGITS,
+			       DECT_IPEI_PSN_DIGITS, &psn))
+		return false;
+	if (str[DECT_IPEI_STRING_LEN - 1] != dect_ipei_check_char(str))
+		return false;
+	if (emc > UINT16_MAX || psn > DECT_IPEI_PSN_MASK)
 		return false;
 
-	c = 0;
-	for (i = 0; i < len - 1; i++)
-		c += (i + 1) * (str[i] - '0');
-	c %= 11;
-
-	if (c < 10) {
-		if (str[len - 1] != (int)c + '0')
-			return false;
-	} else {
-		if (str[len - 1] != '*')
-			return false;
-	}
-
-	return sscanf(str, "%05hu%07u", &ipei->emc, &ipei->psn) == 2;
+	ipei->emc = emc;
+	ipei->psn = psn;
+	return true;
 }
 EXPORT_SYMBOL(dect_parse_ipei_string);
 
@@ -273,7 +295,8 @@ bool dect_parse_ipui(struct dect_ipui *ipui, const uint8_t *ptr, uint8_t len)
 
 uint8_t dect_build_ipui(uint8_t *ptr, const struct dect_ipui *ipui)
 {
-	unsigned int i, len;
+	unsigned int len;
+	__be64 word;
 	uint64_t tmp;
 
 	switch (ipui->put) {
@@ -296,21 +319,126 @@ uint8_t dect_build_ipui(uint8_t *ptr, const struct dect_ipui *ipui)
 		return 0;
 	}
 
-	if (len < 4)
-		tmp <<= 4 - len;
+	if (len > DECT_IPUI_KEY_PUT_SHIFT)
+		return 0;
 
-	memset(ptr, 0, div_round_up(4 + len, 8));
-	ptr[0] = ipui->put;
+	/* The PUT followed by the left aligned number, padded with zero bits */
+	word = __cpu_to_be64((uint64_t)ipui->put << 56 |
+			     tmp << (DECT_IPUI_KEY_PUT_SHIFT - len));
+	memcpy(ptr, &word, div_round_up(4 + len, 8));
+	return 4 + len;
+}
 
-	for (i = 0; i < div_round_up(len, 8U); i++)
-		ptr[i] |= tmp >> (max(len, 4U) - 4 - 8 * i);
+#define DECT_HASH_SEED		0xcbf29ce484222325ULL
 
-	return 4 + len;
+static uint64_t dect_hash_bytes(uint64_t h, const uint8_t *data, unsigned int len)
+{
+	unsigned int i;
+
+	for (i = 0; i < len; i++)
+		h = (h ^ data[i]) * 0x100000001b3ULL;
+	return h;
 }
 
+/**
+ * Calculate the packed key of an IPUI
+ *
+ * @param ipui		IPUI
+ *
+ * The key contains the PUT in the upper four bits and the identity specific
+ * fields in the lower 60 bits. The fields of types P, Q and U don't fit and
+ * are hashed, so keys of these types are not unique.
+ */
+uint64_t dect_ipui_key(const struct dect_ipui *ipui)
+{
+	uint64_t key = 0;
+
+	switch (ipui->put) {
+	case DECT_IPUI_N:
+		key = dect_build_ipei(&ipui->pun.n.ipei);
+		break;
+	case DECT_IPUI_O:
+		key = ipui->pun.o.number;
+		break;
+	case DECT_IPUI_P:
+		key = dect_hash_bytes(DECT_HASH_SEED ^ ipui->pun.p.poc,
+				      ipui->pun.p.acc,
+				      sizeof(ipui->pun.p.acc));
+		break;
+	case DECT_IPUI_Q:
+		key = dect_hash_bytes(DECT_HASH_SEED, ipui->pun.q.bacn,
+				      sizeof(ipui->pun.q.bacn));
+		break;
+	case DECT_IPUI_R:
+		key = ipui->pun.r.imsi;
+		break;
+	case DECT_IPUI_S:
+		key = ipui->pun.s.number;
+		break;
+	case DECT_IPUI_T:
+		key = (uint64_t)ipui->pun.t.eic << 44 | ipui->pun.t.number;
+		break;
+	case DECT_IPUI_U:
+		key = dect_hash_bytes(DECT_HASH_SEED, ipui->pun.u.cacn,
+				      sizeof(ipui->pun.u.cacn));
+		break;
+	}
+
+	return (uint64_t)(ipui->put >> DECT_IPUI_PUT_SHIFT) << DECT_IPUI_KEY_PUT_SHIFT |
+	       (key & DECT_IPUI_KEY_DATA_MASK);
+}
+
+/**
+ * Calculate a hash over the identity specific fields of an IPUI
+ *
+ * @param ipui		IPUI
+ * @param bits		number of hash bits
+ */
+uint32_t dect_ipui_hash(const struct dect_ipui *ipui, unsigned int bits)
+{
+	return hash_64(dect_ipui_key(ipui), bits);
+}
+
+/**
+ * Compare two IPUIs
+ *
+ * @param i1		first IPUI
+ * @param i2		second IPUI
+ *
+ * Only the identity specific fields of the PUT are compared.
+ *
+ * @return false if the IPUIs are equal, true otherwise.
+ */
 bool dect_ipui_cmp(const struct dect_ipui *i1, const struct dect_ipui *i2)
 {
-	return memcmp(i1, i2, sizeof(*i1));
+	if (i1->put != i2->put)
+		return true;
+
+	switch (i1->put) {
+	case DECT_IPUI_N:
+		return i1->pun.n.ipei.emc != i2->pun.n.ipei.emc ||
+		       i1->pun.n.ipei.psn != i2->pun.n.ipei.psn;
+	case DECT_IPUI_O:
+		return i1->pun.o.number != i2->pun.o.number;
+	case DECT_IPUI_P:
+		return i1->pun.p.poc != i2->pun.p.poc ||
+		       memcmp(i1->pun.p.acc, i2->pun.p.acc,
+			      sizeof(i1->pun.p.acc));
+	case DECT_IPUI_Q:
+		return memcmp(i1->pun.q.bacn, i2->pun.q.bacn,
+			      sizeof(i1->pun.q.bacn));
+	case DECT_IPUI_R:
+		return i1->pun.r.imsi != i2->pun.r.imsi;
+	case DECT_IPUI_S:
+		return i1->pun.s.number != i2->pun.s.number;
+	case DECT_IPUI_T:
+		return i1->pun.t.eic != i2->pun.t.eic ||
+		       i1->pun.t.number != i2->pun.t.number;
+	case DECT_IPUI_U:
+		return memcmp(i1->pun.u.cacn, i2->pun.u.cacn,
+			      sizeof(i1->pun.u.cacn));
+	}
+	return true;
 }
 EXPORT_SYMBOL(dect_ipui_cmp);
 
@@ -336,6 +464,115 @@ struct dect_tpui *dect_ipui_to_tpui(struct dect_tpui *tpui,
 	return tpui;
 }
 
+/*
+ * Bulk conversion
+ */
+
+/**
+ * Parse an array of IPEI strings
+ *
+ * @param ipuis		result array of IPUIs of type N, may be NULL
+ * @param keys		result array of packed IPUI keys, may be NULL
+ * @param strs		IPEI strings
+ * @param n		number of strings
+ *
+ * The packed keys are the keys indexing the location table, see
+ * dect_ipui_keys(). The key of a string that fails to parse is set to
+ * #DECT_IPUI_KEY_INVALID and its IPUI is left unchanged.
+ *
+ * @return the number of valid strings.
+ */
+unsigned int dect_parse_ipei_strings(struct dect_ipui *ipuis, uint64_t *keys,
+				     const char * const *strs, unsigned int n)
+{
+	struct dect_ipei ipei;
+	unsigned int i, valid = 0;
+
+	for (i = 0; i < n; i++) {
+		if (!dect_parse_ipei_string(&ipei, strs[i])) {
+			if (keys != NULL)
+				keys[i] = DECT_IPUI_KEY_INVALID;
+			continue;
+		}
+		if (ipuis != NULL) {
+			ipuis[i].put        = DECT_IPUI_N;
+			ipuis[i].pun.n.ipei = ipei;
+		}
+		if (keys != NULL)
+			keys[i] = dect_build_ipei(&ipei);
+		valid++;
+	}
+	return valid;
+}
+EXPORT_SYMBOL(dect_parse_ipei_strings);
+
+/**
+ * Format the IPEIs of an array of IPUIs as printed text
+ *
+ * @param buf		destination buffer of n * (#DECT_IPEI_STRING_LEN + 1) bytes
+ * @param ipuis		IPUIs
+ * @param n		number of IPUIs
+ *
+ * The strings are stored consecutively, each including its terminating
+ * zero byte. IPUIs other than type N result in an empty string.
+ *
+ * @return the number of formatted IPEIs.
+ */
+unsigned int dect_format_ipei_strings(char *buf, const struct dect_ipui *ipuis,
+				      unsigned int n)
+{
+	unsigned int i, valid = 0;
+
+	for (i = 0; i < n; i++, buf += DECT_IPEI_STRING_LEN + 1) {
+		if (ipuis[i].put != DECT_IPUI_N) {
+			buf[0] = '\0';
+			continue;
+		}
+		dect_format_ipei_string(&ipuis[i].pun.n.ipei, buf);
+		valid++;
+	}
+	return valid;
+}
+EXPORT_SYMBOL(dect_format_ipei_strings);
+
+/**
+ * Calculate the packed keys of an array of IPUIs
+ *
+ * @param keys		result array of packed keys
+ * @param ipuis		IPUIs
+ * @param n		number of IPUIs
+ *
+ * A key contains the PUT in the upper four bits and the identity specific
+ * fields in the lower 60 bits. Keys are unique except for the types P, Q
+ * and U, whose fields are hashed.
+ */
+void dect_ipui_keys(uint64_t *keys, const struct dect_ipui *ipuis,
+		    unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		keys[i] = dect_ipui_key(&ipuis[i]);
+}
+EXPORT_SYMBOL(dect_ipui_keys);
+
+/**
+ * Derive the default individual TPUIs of an array of IPUIs
+ *
+ * @param tpuis		result array of TPUIs
+ * @param ipuis		IPUIs
+ * @param n		number of IPUIs
+ */
+void dect_ipuis_to_tpuis(struct dect_tpui *tpuis, const struct dect_ipui *ipuis,
+			 unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		dect_ipui_to_tpui(&tpuis[i], &ipuis[i]);
+}
+EXPORT_SYMBOL(dect_ipuis_to_tpuis);
+
 void dect_dump_tpui(const struct dect_tpui *tpui)
 {
 	unsigned int i;
@@ -380,9 +617,11 @@ uint32_t dect_build_tpui(const struct dect_tpui *tpui)
 		break;
 	case DECT_TPUI_CONNECTIONLESS_GROUP:
 		t  = DECT_TPUI_CONNECTIONLESS_GROUP_ID;
+		t |= tpui->cg.group & DECT_TPUI_GROUP_MASK;
 		break;
 	case DECT_TPUI_CALL_GROUP:
 		t  = DECT_TPUI_CALL_GROUP_ID;
+		t |= tpui->cg.group & DECT_TPUI_GROUP_MASK;
 		break;
 	case DECT_TPUI_INDIVIDUAL_DEFAULT:
 		t  = DECT_TPUI_DEFAULT_INDIVIDUAL_ID;
@@ -21,6 +21,7 @@
 
 #include <dect/ie.h>
 #include <libdect.h>
+#include <utils.h>
 
 #if 0
 #define refcnt_debug(fmt, ...)	dect_debug(DECT_DEBUG_UNKNOWN, fmt, ## __VA_ARGS__)
@@ -28,6 +29,111 @@
 #define refcnt_debug(fmt, ...)
 #endif
 
+/*
+ * Information Element arenas
+ */
+
+/**
+ * struct dect_ie_arena - IE arena of a received message
+ *
+ * @dh:		libdect DECT handle
+ * @size:	size of the data area
+ * @used:	number of used bytes of the data area
+ * @data:	data area
+ */
+struct dect_ie_arena {
+	const struct dect_handle	*dh;
+	unsigned int			size;
+	unsigned int			used;
+	uint8_t				data[] __aligned(__alignof__(uint64_t));
+};
+
+/**
+ * struct dect_ie_arena_chunk - IE allocated from an IE arena
+ *
+ * @arena:	IE arena
+ * @size:	IE size
+ * @ie:		IE storage
+ */
+struct dect_ie_arena_chunk {
+	struct dect_ie_arena		*arena;
+	unsigned int			size;
+	uint8_t				ie[] __aligned(__alignof__(uint64_t));
+};
+
+#define DECT_IE_ARENA_ALIGN		__alignof__(uint64_t)
+
+/**
+ * Set the size of the IE arena used for parsing received messages
+ *
+ * @param dh		libdect DECT handle
+ * @param size		arena size in bytes, zero disables the use of arenas
+ *
+ * When enabled, the IEs of received messages are allocated from a single
+ * arena which is released after the message has been processed. IEs held
+ * by the application are copied to separately allocated memory.
+ */
+void dect_set_ie_arena_size(struct dect_handle *dh, unsigned int size)
+{
+	dh->ie_arena_size = size;
+}
+EXPORT_SYMBOL(dect_set_ie_arena_size);
+
+struct dect_ie_arena *dect_ie_arena_alloc(const struct dect_handle *dh)
+{
+	struct dect_ie_arena *arena;
+
+	if (dh->ie_arena_size == 0)
+		return NULL;
+
+	arena = dect_malloc_type(dh, DECT_MEM_IE,
+				 sizeof(*arena) + dh->ie_arena_size);
+	if (arena == NULL)
+		return NULL;
+	arena->dh   = dh;
+	arena->size = dh->ie_arena_size;
+	arena->used = 0;
+	return arena;
+}
+
+void dect_ie_arena_free(struct dect_ie_arena *arena)
+{
+	dect_free(arena->dh, arena);
+}
+
+struct dect_ie_common *dect_ie_arena_ie_alloc(struct dect_ie_arena *arena,
+					      size_t size)
+{
+	struct dect_ie_arena_chunk *chunk;
+	struct dect_ie_common *ie;
+	unsigned int len;
+
+	len = sizeof(*chunk) + size;
+	len = (len + DECT_IE_ARENA_ALIGN - 1) & ~(DECT_IE_ARENA_ALIGN - 1);
+	if (arena->used + len > arena->size)
+		return dect_ie_alloc(arena->dh, size);
+
+	chunk = (void *)arena->data + arena->used;
+	arena->used += len;
+
+	chunk->arena = arena;
+	chunk->size  = size;
+	ie = (struct dect_ie_common *)chunk->ie;
+	memset(ie, 0, size);
+	ie->refcnt = 1;
+	ie->flags  = DECT_IE_ARENA;
+	return ie;
+}
+
+/* Copy an arena allocated IE to the heap */
+static struct dect_ie_common *dect_ie_arena_promote(struct dect_ie_common *ie)
+{
+	struct dect_ie_arena_chunk *chunk;
+
+	chunk = (void *)ie - offsetof(struct dect_ie_arena_chunk, ie);
+	return __dect_ie_clone(chunk->arena->dh, ie, chunk->size);
+}
+
 /*
  * Information Elements
  */
@@ -36,7 +142,7 @@ struct dect_ie_common *dect_ie_alloc(const struct dect_handle *dh, size_t size)
 {
 	struct dect_ie_common *ie;
 
-	ie = dect_zalloc(dh, size);
+	ie = dect_zalloc_type(dh, DECT_MEM_IE, size);
 	if (ie == NULL)
 		return NULL;
 	ie->refcnt = 1;
@@ -55,11 +161,18 @@ struct dect_ie_common *__dect_ie_clone(const struct dect_handle *dh,
 				       size_t size)
 {
 	struct dect_ie_common *clone;
+	size_t len = size;
+
+	/* Received variable size IEs only contain the received payload */
+	if (ie->size != 0)
+		len = min(size, (size_t)ie->size);
 
 	clone = dect_ie_alloc(dh, size);
 	if (clone == NULL)
 		return NULL;
-	memcpy(clone + 1, ie + 1, size - sizeof(*ie));
+	memcpy(clone + 1, ie + 1, len - sizeof(*ie));
+	if (size == ie->size)
+		clone->size = ie->size;
 	return clone;
 }
 EXPORT_SYMBOL(__dect_ie_clone);
@@ -68,6 +181,10 @@ struct dect_ie_common *__dect_ie_hold(struct dect_ie_common *ie)
 {
 	if (ie == NULL)
 		return NULL;
+	if (ie->flags & DECT_IE_ARENA)
+		return dect_ie_arena_promote(ie);
+	if (ie->flags & DECT_IE_INTERNED)
+		return ie;
 	refcnt_debug("IE %p: hold refcnt=%u\n", ie, ie->refcnt);
 	dect_assert(ie->refcnt != 0);
 	ie->refcnt++;
@@ -77,7 +194,7 @@ EXPORT_SYMBOL(__dect_ie_hold);
 
 void __dect_ie_put(const struct dect_handle *dh, struct dect_ie_common *ie)
 {
-	if (ie == NULL)
+	if (ie == NULL || ie->flags & (DECT_IE_ARENA | DECT_IE_INTERNED))
 		return;
 	refcnt_debug("IE %p: release refcnt=%u\n", ie, ie->refcnt);
 	dect_assert(ie->refcnt != 0);
@@ -86,6 +203,118 @@ void __dect_ie_put(const struct dect_handle *dh, struct dect_ie_common *ie)
 }
 EXPORT_SYMBOL(__dect_ie_put);
 
+/*
+ * Interned Information Elements
+ */
+
+/**
+ * struct dect_ie_intern_entry - interned IE
+ *
+ * @node:	intern table node
+ * @hash:	hash of the IE contents
+ * @size:	IE size
+ * @ie:		IE storage
+ */
+struct dect_ie_intern_entry {
+	struct hlist_node		node;
+	uint32_t			hash;
+	unsigned int			size;
+	uint8_t				ie[] __aligned(__alignof__(uint64_t));
+};
+
+static uint32_t dect_ie_intern_hash(const struct dect_ie_common *ie, size_t size)
+{
+	const uint8_t *data = (const uint8_t *)(ie + 1);
+	uint64_t hash = size;
+	unsigned int i;
+
+	for (i = 0; i < size - sizeof(*ie); i++)
+		hash = (hash << 5) + hash + data[i];
+	return hash_64(hash, 32);
+}
+
+/**
+ * Get a shared immutable instance of an IE
+ *
+ * @param dh		libdect DECT handle
+ * @param ie		Information Element
+ * @param size		IE size
+ *
+ * Look up an interned IE with the same contents as @ie, interning a copy of
+ * @ie if none exists. Interned IEs are pinned for the lifetime of the handle,
+ * dect_ie_hold() and dect_ie_put() don't modify them. The contents are
+ * compared bytewise, so IEs must be completely initialized, including any
+ * padding, to be shared. Interned IEs must not be modified or added to IE
+ * lists.
+ *
+ * When the intern table is full, a regular copy of @ie is returned. In both
+ * cases the caller should release the returned IE using dect_ie_put().
+ *
+ * @return the shared IE or NULL if no memory could be allocated.
+ */
+struct dect_ie_common *__dect_ie_intern(struct dect_handle *dh,
+					const struct dect_ie_common *ie,
+					size_t size)
+{
+	struct dect_ie_intern_entry *entry;
+	struct dect_ie_common *iie;
+	struct hlist_node *pos;
+	struct hlist_head *head;
+	uint32_t hash;
+
+	if (ie == NULL)
+		return NULL;
+	if (ie->flags & DECT_IE_INTERNED)
+		return (struct dect_ie_common *)ie;
+	if (ie->size != 0)
+		size = ie->size;
+
+	hash = dect_ie_intern_hash(ie, size);
+	head = &dh->ie_intern_hash[hash & (DECT_IE_INTERN_HASH_SIZE - 1)];
+	hlist_for_each_entry(entry, pos, head, node) {
+		iie = (struct dect_ie_common *)entry->ie;
+		if (entry->hash == hash && entry->size == size &&
+		    !memcmp(iie + 1, ie + 1, size - sizeof(*ie)))
+			return iie;
+	}
+
+	if (dh->ie_intern_cnt >= DECT_IE_INTERN_MAX)
+		return __dect_ie_clone(dh, ie, size);
+
+	entry = dect_malloc_type(dh, DECT_MEM_IE, sizeof(*entry) + size);
+	if (entry == NULL)
+		return NULL;
+	entry->hash = hash;
+	entry->size = size;
+
+	iie = (struct dect_ie_common *)entry->ie;
+	memcpy(iie + 1, ie + 1, size - sizeof(*ie));
+	iie->next   = NULL;
+	iie->refcnt = 1;
+	iie->flags  = DECT_IE_INTERNED;
+	iie->size   = ie->size;
+
+	hlist_add_head(&entry->node, head);
+	dh->ie_intern_cnt++;
+	return iie;
+}
+EXPORT_SYMBOL(__dect_ie_intern);
+
+void dect_ie_intern_flush(struct dect_handle *dh)
+{
+	struct dect_ie_intern_entry *entry;
+	struct hlist_node *pos, *n;
+	unsigned int i;
+
+	for (i = 0; i < DECT_IE_INTERN_HASH_SIZE; i++) {
+		hlist_for_each_entry_safe(entry, pos, n, &dh->ie_intern_hash[i], node) {
+			hlist_del(&entry->node);
+			dect_free(dh, entry);
+		}
+	}
+	dh->ie_intern_cnt = 0;
+}
+
 /*
  * Information Element lists
  */
@@ -96,29 +325,59 @@ void dect_ie_list_init(struct dect_ie_list *ie)
 {
 	ie->common.next = &ie_list_marker;
 	ie->list = NULL;
+	ie->last = NULL;
 }
 EXPORT_SYMBOL(dect_ie_list_init);
 
 void __dect_ie_list_add(struct dect_ie_common *ie, struct dect_ie_list *iel)
 {
-	struct dect_ie_common **pprev;
-
-	pprev = &iel->list;
-	while (*pprev != NULL)
-		pprev = &(*pprev)->next;
-
+	dect_assert(!(ie->flags & DECT_IE_INTERNED));
 	ie->next = NULL;
-	*pprev = ie;
+	if (iel->list == NULL)
+		iel->list = ie;
+	else {
+		/*
+		 * The tail is only maintained for lists set up through
+		 * dect_ie_list_init(), walk the list of others.
+		 */
+		if (iel->common.next != &ie_list_marker || iel->last == NULL)
+			for (iel->last = iel->list; iel->last->next != NULL;
+			     iel->last = iel->last->next)
+				;
+		iel->last->next = ie;
+	}
+	iel->last = ie;
 }
 EXPORT_SYMBOL(__dect_ie_list_add);
 
 struct dect_ie_list *dect_ie_list_hold(struct dect_ie_list *iel)
 {
-	struct dect_ie_common *ie;
+	struct dect_ie_common **pprev, *ie, *clone;
 
 	refcnt_debug("IEL %p: hold\n", iel);
-	dect_foreach_ie(ie, iel)
-		__dect_ie_hold(ie);
+	iel->last = NULL;
+	pprev = &iel->list;
+	while ((ie = *pprev) != NULL) {
+		if (!(ie->flags & DECT_IE_ARENA)) {
+			__dect_ie_hold(ie);
+			iel->last = ie;
+			pprev = &ie->next;
+			continue;
+		}
+
+		/* Replace arena allocated IEs by a copy on the heap, holding
+		 * one reference for the list and one for the caller. */
+		clone = dect_ie_arena_promote(ie);
+		if (clone == NULL) {
+			*pprev = ie->next;
+			continue;
+		}
+		clone->next   = ie->next;
+		clone->refcnt = 2;
+		*pprev = clone;
+		iel->last = clone;
+		pprev = &clone->next;
+	}
 	return iel;
 }
 EXPORT_SYMBOL(dect_ie_list_hold);
@@ -141,7 +400,7 @@ void *dect_ie_collection_alloc(const struct dect_handle *dh, unsigned int size)
 {
 	struct dect_ie_collection *iec;
 
-	iec = dect_zalloc(dh, size);
+	iec = dect_zalloc_type(dh, DECT_MEM_IE, size);
 	if (iec == NULL)
 		return NULL;
 	iec->refcnt = 1;
@@ -162,7 +421,7 @@ static void dect_ie_collection_free(const struct dect_handle *dh,
 
 	while (size > 0) {
 		if (*ptr == &ie_list_marker) {
-			dect_ie_list_put(dh, *ptr);
+			dect_ie_list_put(dh, (struct dect_ie_list *)ptr);
 			size -= sizeof(struct dect_ie_list);
 			ptr = ((void *)ptr) + sizeof(struct dect_ie_list);
 		} else {
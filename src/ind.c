@@ -0,0 +1,179 @@
+/*
+ * libdect batched indications
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @defgroup ind_batch Batched indications
+ *
+ * Delivery of indications to the application in batches.
+ *
+ * With batching enabled using dect_ind_batch_enable(), the indications of
+ * type #dect_ind_types are not passed to their callbacks, but queued and
+ * delivered to the batch callback as an array once the event being
+ * processed by dect_fd_process() has been handled. Applications can extend
+ * a batch over multiple events, for instance one iteration of their event
+ * loop, by enclosing them in dect_ind_batch_begin() and dect_ind_batch_end().
+ *
+ * Indications of a data link are delivered in order: the batch is delivered
+ * before further messages of a data link with queued indications are
+ * processed, before the data link is released and before timers run. Other
+ * indications are still delivered immediately.
+ *
+ * The objects and parameters of a batch are valid for the duration of the
+ * batch callback, the parameters must be held to be used afterwards.
+ *
+ * @{
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <libdect.h>
+#include <utils.h>
+#include <lce.h>
+#include <ind.h>
+
+/**
+ * Enable batched delivery of indications
+ *
+ * @param dh		libdect DECT handle
+ * @param fn		batch delivery callback
+ *
+ * @return 0 on success or -1 on error.
+ */
+int dect_ind_batch_enable(struct dect_handle *dh,
+			  void (*fn)(struct dect_handle *dh,
+				     const struct dect_ind *inds,
+				     unsigned int n))
+{
+	if (fn == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (dh->ind_batch == NULL) {
+		dh->ind_batch = dect_zalloc(dh, sizeof(*dh->ind_batch));
+		if (dh->ind_batch == NULL)
+			return -1;
+	}
+	dh->ind_batch->fn = fn;
+	return 0;
+}
+EXPORT_SYMBOL(dect_ind_batch_enable);
+
+/**
+ * Disable batched delivery of indications
+ *
+ * @param dh		libdect DECT handle
+ *
+ * Queued indications are delivered before this function returns.
+ */
+void dect_ind_batch_disable(struct dect_handle *dh)
+{
+	if (dh->ind_batch == NULL)
+		return;
+
+	dect_ind_flush(dh);
+	dect_free(dh, dh->ind_batch);
+	dh->ind_batch = NULL;
+}
+EXPORT_SYMBOL(dect_ind_batch_disable);
+
+/**
+ * Begin a batch of indications spanning multiple events
+ *
+ * @param dh		libdect DECT handle
+ *
+ * Calls may be nested, the batch is delivered by the outermost
+ * dect_ind_batch_end() call.
+ */
+void dect_ind_batch_begin(struct dect_handle *dh)
+{
+	if (dh->ind_batch != NULL)
+		dh->ind_batch->depth++;
+}
+EXPORT_SYMBOL(dect_ind_batch_begin);
+
+/**
+ * End a batch of indications spanning multiple events
+ *
+ * @param dh		libdect DECT handle
+ */
+void dect_ind_batch_end(struct dect_handle *dh)
+{
+	struct dect_ind_batch *ib = dh->ind_batch;
+
+	if (ib == NULL || ib->depth == 0)
+		return;
+	if (--ib->depth == 0)
+		dect_ind_flush(dh);
+}
+EXPORT_SYMBOL(dect_ind_batch_end);
+
+/**
+ * dect_ind_queue - queue an indication for batched delivery
+ *
+ * @dh:		libdect DECT handle
+ * @ddl:	data link of the indication
+ * @type:	indication type
+ * @obj:	call or MM endpoint
+ * @param:	primitive parameters
+ *
+ * Returns -1 if the indication must be delivered immediately.
+ */
+int dect_ind_queue(struct dect_handle *dh, struct dect_data_link *ddl,
+		   enum dect_ind_types type, void *obj,
+		   struct dect_ie_collection *param)
+{
+	struct dect_ind_batch *ib = dh->ind_batch;
+	struct dect_ind *ind;
+
+	if (ib == NULL)
+		return -1;
+	if (ib->n == array_size(ib->inds))
+		dect_ind_flush(dh);
+
+	ind = &ib->inds[ib->n];
+	ind->type  = type;
+	ind->call  = obj;
+	ind->param = __dect_ie_collection_hold(param);
+	ib->links[ib->n++] = ddl;
+	ddl->ind_queued++;
+	return 0;
+}
+
+void dect_ind_flush(struct dect_handle *dh)
+{
+	struct dect_ind_batch *ib = dh->ind_batch;
+	struct dect_ind inds[DECT_IND_BATCH_MAX];
+	unsigned int i, n;
+
+	if (ib == NULL || ib->n == 0)
+		return;
+
+	/* Indications queued by the callback go into the next batch */
+	n = ib->n;
+	memcpy(inds, ib->inds, n * sizeof(inds[0]));
+	for (i = 0; i < n; i++)
+		ib->links[i]->ind_queued--;
+	ib->n = 0;
+
+	ib->fn(dh, inds, n);
+
+	for (i = 0; i < n; i++)
+		__dect_ie_collection_put(dh, inds[i].param);
+}
+
+/* Deliver the batch at the end of an event unless extended by the user */
+void dect_ind_process_end(struct dect_handle *dh)
+{
+	if (dh->ind_batch != NULL && dh->ind_batch->depth == 0)
+		dect_ind_flush(dh);
+}
+
+/** @} */
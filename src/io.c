@@ -31,6 +31,12 @@
  * associate data with the file descriptor. The function dect_fd_priv() returns
  * a pointer to this data area.
  *
+ * Each file descriptor belongs to one of the priority classes of enum
+ * #dect_fd_priorities, returned by dect_fd_priority(). Event handlers
+ * should process the events of higher classes first when multiple file
+ * descriptors are ready, so U-plane data isn't delayed by bursts of
+ * signalling, registrations or paging.
+ *
  * @{
  */
 
@@ -44,6 +50,7 @@
 #include <libdect.h>
 #include <utils.h>
 #include <io.h>
+#include <ind.h>
 
 #ifndef SOCK_NONBLOCK
 #define SOCK_NONBLOCK O_NONBLOCK
@@ -57,8 +64,10 @@ struct dect_fd *dect_fd_alloc(const struct dect_handle *dh)
 			  dh->ops->event_ops->fd_priv_size);
 	if (dfd == NULL)
 		return NULL;
-	dfd->fd    = -1;
-	dfd->state = DECT_FD_UNREGISTERED;
+	dfd->fd        = -1;
+	dfd->state     = DECT_FD_UNREGISTERED;
+	dfd->transport = dh->transport;
+	dfd->prio      = DECT_FD_PRIO_SIGNALLING;
 	return dfd;
 }
 EXPORT_SYMBOL(dect_fd_alloc);
@@ -85,6 +94,19 @@ int dect_fd_num(const struct dect_fd *dfd)
 }
 EXPORT_SYMBOL(dect_fd_num);
 
+/**
+ * Get the priority class of a libdect file descriptor
+ *
+ * @param dfd		libdect file descriptor
+ *
+ * The priority class doesn't change while the file descriptor is registered.
+ */
+enum dect_fd_priorities dect_fd_priority(const struct dect_fd *dfd)
+{
+	return dfd->prio;
+}
+EXPORT_SYMBOL(dect_fd_priority);
+
 void dect_fd_setup(struct dect_fd *dfd,
 		   void (*cb)(struct dect_handle *, struct dect_fd *, uint32_t),
 		   void *data)
@@ -99,6 +121,8 @@ int dect_fd_register(const struct dect_handle *dh, struct dect_fd *dfd,
 {
 	int err;
 
+	if (dfd->state == DECT_FD_DETACHED)
+		return 0;
 	dect_assert(dfd->state == DECT_FD_UNREGISTERED);
 	err = dh->ops->event_ops->register_fd(dh, dfd, events);
 	if (err == 0)
@@ -109,12 +133,48 @@ EXPORT_SYMBOL(dect_fd_register);
 
 void dect_fd_unregister(const struct dect_handle *dh, struct dect_fd *dfd)
 {
+	if (dfd->state == DECT_FD_DETACHED)
+		return;
 	dect_assert(dfd->state == DECT_FD_REGISTERED);
 	dh->ops->event_ops->unregister_fd(dh, dfd);
 	dfd->state = DECT_FD_UNREGISTERED;
 }
 EXPORT_SYMBOL(dect_fd_unregister);
 
+/*
+ * Detach a socket that has been passed to another process. The descriptor is
+ * replaced by /dev/null, so the socket isn't affected by the remaining users
+ * of the file descriptor, whose operations fail, until it is closed.
+ */
+int dect_fd_detach(const struct dect_handle *dh, struct dect_fd *dfd)
+{
+	int fd;
+
+	fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+
+	if (dfd->state == DECT_FD_REGISTERED)
+		dect_fd_unregister(dh, dfd);
+	if (dfd->transport->ops->detach != NULL)
+		dfd->transport->ops->detach(dfd);
+	if (dup3(fd, dfd->fd, O_CLOEXEC) < 0) {
+		close(fd);
+		return -1;
+	}
+	close(fd);
+	dfd->state = DECT_FD_DETACHED;
+	return 0;
+}
+
+/* Change the events a registered file descriptor is registered for */
+int dect_fd_update(const struct dect_handle *dh, struct dect_fd *dfd,
+		   uint32_t events)
+{
+	dect_fd_unregister(dh, dfd);
+	return dect_fd_register(dh, dfd, events);
+}
+
 /**
  * Process libdect file descriptor events
  *
@@ -128,15 +188,19 @@ EXPORT_SYMBOL(dect_fd_unregister);
 void dect_fd_process(struct dect_handle *dh, struct dect_fd *dfd, uint32_t events)
 {
 	dect_assert(dfd->state == DECT_FD_REGISTERED);
+	dect_debug_bind(dh);
 	dfd->callback(dh, dfd, events);
+	dect_ind_process_end(dh);
 }
 EXPORT_SYMBOL(dect_fd_process);
 
 void dect_close(const struct dect_handle *dh, struct dect_fd *dfd)
 {
-	dect_assert(dfd->state == DECT_FD_UNREGISTERED);
-	if (dfd->fd >= 0)
+	dect_assert(dfd->state != DECT_FD_REGISTERED);
+	if (dfd->state == DECT_FD_DETACHED)
 		close(dfd->fd);
+	else if (dfd->fd >= 0)
+		dfd->transport->ops->close(dfd);
 	dect_free(dh, dfd);
 }
 EXPORT_SYMBOL(dect_close);
@@ -149,7 +213,8 @@ struct dect_fd *dect_socket(const struct dect_handle *dh, int type, int protocol
 	if (dfd == NULL)
 		goto err1;
 
-	dfd->fd = socket(AF_DECT, type | SOCK_NONBLOCK, protocol);
+	dfd->fd = dh->transport->ops->socket(dh->transport,
+					     type | SOCK_NONBLOCK, protocol);
 	if (dfd->fd < 0)
 		goto err2;
 
@@ -171,11 +236,9 @@ struct dect_fd *dect_accept(const struct dect_handle *dh,
 	if (nfd == NULL)
 		goto err1;
 
-	nfd->fd = accept(dfd->fd, addr, &len);
+	nfd->fd = dfd->transport->ops->accept(dfd, addr, &len);
 	if (nfd->fd < 0)
 		goto err2;
-	if (fcntl(nfd->fd, F_SETFL, O_NONBLOCK) < 0)
-		goto err2;
 
 	return nfd;
 
@@ -185,5 +248,92 @@ err1:
 	return NULL;
 }
 
+/*
+ * Kernel transport: AF_DECT sockets
+ */
+
+static int dect_kernel_socket(struct dect_transport *t, int type, int protocol)
+{
+	return socket(AF_DECT, type, protocol);
+}
+
+static void dect_kernel_close(struct dect_fd *dfd)
+{
+	close(dfd->fd);
+}
+
+static int dect_kernel_accept(const struct dect_fd *dfd,
+			      struct sockaddr *addr, socklen_t *len)
+{
+	return accept4(dfd->fd, addr, len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+}
+
+static int dect_kernel_bind(struct dect_fd *dfd, const struct sockaddr *addr,
+			    socklen_t len)
+{
+	return bind(dfd->fd, addr, len);
+}
+
+static int dect_kernel_listen(struct dect_fd *dfd, int backlog)
+{
+	return listen(dfd->fd, backlog);
+}
+
+static int dect_kernel_connect(struct dect_fd *dfd,
+			       const struct sockaddr *addr, socklen_t len)
+{
+	return connect(dfd->fd, addr, len);
+}
+
+static int dect_kernel_getsockopt(const struct dect_fd *dfd, int level,
+				  int optname, void *optval, socklen_t *optlen)
+{
+	return getsockopt(dfd->fd, level, optname, optval, optlen);
+}
+
+static int dect_kernel_setsockopt(const struct dect_fd *dfd, int level,
+				  int optname, const void *optval,
+				  socklen_t optlen)
+{
+	return setsockopt(dfd->fd, level, optname, optval, optlen);
+}
+
+static ssize_t dect_kernel_recvmsg(const struct dect_fd *dfd,
+				   struct msghdr *msg, int flags)
+{
+	return recvmsg(dfd->fd, msg, flags);
+}
+
+static ssize_t dect_kernel_sendmsg(const struct dect_fd *dfd,
+				   const struct msghdr *msg, int flags)
+{
+	return sendmsg(dfd->fd, msg, flags);
+}
+
+static int dect_kernel_sendmmsg(const struct dect_fd *dfd,
+				struct mmsghdr *msgs, unsigned int vlen,
+				int flags)
+{
+	return sendmmsg(dfd->fd, msgs, vlen, flags);
+}
+
+static const struct dect_transport_ops dect_kernel_transport_ops = {
+	.socket		= dect_kernel_socket,
+	.close		= dect_kernel_close,
+	.accept		= dect_kernel_accept,
+	.bind		= dect_kernel_bind,
+	.listen		= dect_kernel_listen,
+	.connect	= dect_kernel_connect,
+	.getsockopt	= dect_kernel_getsockopt,
+	.setsockopt	= dect_kernel_setsockopt,
+	.recvmsg	= dect_kernel_recvmsg,
+	.sendmsg	= dect_kernel_sendmsg,
+	.sendmmsg	= dect_kernel_sendmmsg,
+};
+
+struct dect_transport dect_kernel_transport = {
+	.ops		= &dect_kernel_transport_ops,
+};
+
 /** @} */
 /** @} */
@@ -0,0 +1,633 @@
+/*
+ * libdect IWU-TO-IWU data streams
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @addtogroup cc
+ * @{
+ *
+ * @defgroup iwu_stream IWU data streams
+ *
+ * Transfer of large payloads in {CC-IWU-INFO} messages.
+ *
+ * dect_mncc_iwu_info_req() sends one <<IWU-TO-IWU>> IE per message, limited
+ * to the size of a message buffer. A stream opened on a call using
+ * dect_iwu_stream_open() segments the payloads queued using
+ * dect_iwu_stream_send() into {CC-IWU-INFO} messages carrying an
+ * <<IWU-TO-IWU>> IE with the protocol discriminator of the stream. Up to
+ * @ref dect_iwu_stream_param::window "window" segments are sent without
+ * waiting for an acknowledgement, the receiver acknowledges the segments
+ * requested by the sender and the last segment of each payload. Segments
+ * are only accepted in sequence: the receiver reports a gap by a negative
+ * acknowledgement and the sender retransmits starting with the missing
+ * segment, unacknowledged segments are also retransmitted after
+ * #DECT_IWU_STREAM_RTX_TIMEOUT seconds. The received segments of a payload
+ * are reassembled in message buffers and passed to the receive callback
+ * as an iovec array.
+ *
+ * The sent callback is invoked once the last segment of a payload has been
+ * acknowledged, the payload data must remain valid until then. When the
+ * limit of queued payloads is reached, dect_iwu_stream_send() fails with
+ * EAGAIN and the writable callback is invoked once a payload has completed.
+ * Payloads are failed with ETIMEDOUT when the peer doesn't acknowledge
+ * #DECT_IWU_STREAM_RTX_MAX retransmissions and with ECONNRESET when the
+ * call is released.
+ *
+ * <<IWU-TO-IWU>> IEs with a different protocol discriminator are passed to
+ * the application as usual. Both peers must use the same stream format:
+ *
+ * - octet 1: flags (#DECT_IWU_SEG_FIRST, #DECT_IWU_SEG_LAST,
+ *   #DECT_IWU_SEG_ACK_REQ, #DECT_IWU_SEG_NAK, #DECT_IWU_SEG_ACK)
+ * - octet 2: sequence number of a segment, the next expected sequence
+ *   number for a positive or negative acknowledgement
+ * - octet 3+: segment data
+ *
+ * @{
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <libdect.h>
+#include <utils.h>
+#include <timer.h>
+#include <lce.h>
+#include <cc.h>
+
+#define DECT_IWU_SEG_FIRST		0x01
+#define DECT_IWU_SEG_LAST		0x02
+#define DECT_IWU_SEG_ACK_REQ		0x04
+#define DECT_IWU_SEG_NAK		0x40
+#define DECT_IWU_SEG_ACK		0x80
+
+#define DECT_IWU_SEG_HDR_SIZE		2
+/* Segment data fitting in a message buffer with the S-Format and IE headers */
+#define DECT_IWU_SEG_DATA_MAX		112
+
+#define DECT_IWU_STREAM_WINDOW		8
+#define DECT_IWU_STREAM_TX_LIMIT	16
+#define DECT_IWU_STREAM_RX_MAX		65536
+/* Retransmission timeout in seconds and retransmissions without progress */
+#define DECT_IWU_STREAM_RTX_TIMEOUT	5
+#define DECT_IWU_STREAM_RTX_MAX		4
+
+#define is_debug(call, fmt, args...) \
+	dect_debug(DECT_DEBUG_CC, "CC: call %p: IWU stream: " fmt "\n", \
+		   (call), ## args)
+
+/**
+ * struct dect_iwu_tx - queued payload
+ *
+ * @list:	transmit queue node
+ * @data:	payload data
+ * @len:	payload length
+ * @off:	amount of data segmented
+ * @last_seq:	sequence number of the last segment, once segmented
+ */
+struct dect_iwu_tx {
+	struct list_head		list;
+	const uint8_t			*data;
+	size_t				len;
+	size_t				off;
+	uint8_t				last_seq;
+};
+
+/**
+ * struct dect_iwu_stream - IWU data stream
+ *
+ * @param:	stream parameters
+ * @timer:	retransmission timer
+ * @tx_rtx:	number of retransmissions without progress
+ * @tx_queue:	queued payloads, oldest first
+ * @tx_cur:	payload being segmented
+ * @tx_queued:	number of queued payloads
+ * @tx_blocked:	a payload was rejected, invoke the writable callback
+ * @tx_seq:	sequence number of the next segment
+ * @tx_acked:	sequence number of the oldest unacknowledged segment
+ * @rx_next:	next expected sequence number
+ * @rx_nak:	a gap before @rx_next has been reported
+ * @rx_active:	a payload is being reassembled
+ * @rx_discard:	the payload exceeds the maximum size and is discarded
+ * @rx_len:	amount of data reassembled
+ * @rx_cnt:	number of message buffers of the payload
+ * @rx_queue:	message buffers of the payload
+ */
+struct dect_iwu_stream {
+	struct dect_iwu_stream_param	param;
+	struct dect_timer		*timer;
+	unsigned int			tx_rtx;
+
+	struct list_head		tx_queue;
+	struct dect_iwu_tx		*tx_cur;
+	unsigned int			tx_queued;
+	bool				tx_blocked;
+	uint8_t				tx_seq;
+	uint8_t				tx_acked;
+
+	uint8_t				rx_next;
+	bool				rx_nak;
+	bool				rx_active;
+	bool				rx_discard;
+	size_t				rx_len;
+	unsigned int			rx_cnt;
+	PTRQUEUE_HEAD(struct dect_msg_buf) rx_queue;
+};
+
+static uint8_t dect_iwu_tx_inflight(const struct dect_iwu_stream *is)
+{
+	return is->tx_seq - is->tx_acked;
+}
+
+static int dect_iwu_stream_send_seg(struct dect_handle *dh,
+				    struct dect_call *call,
+				    const struct dect_iwu_stream *is,
+				    uint8_t flags, uint8_t seq,
+				    const void *data, unsigned int len)
+{
+	struct dect_ie_iwu_to_iwu iwu_to_iwu = {};
+	struct dect_mncc_iwu_info_param param = {
+		.iwu_to_iwu	= &iwu_to_iwu,
+	};
+
+	iwu_to_iwu.sr	   = true;
+	iwu_to_iwu.pd	   = is->param.pd;
+	iwu_to_iwu.len	   = DECT_IWU_SEG_HDR_SIZE + len;
+	iwu_to_iwu.data[0] = flags;
+	iwu_to_iwu.data[1] = seq;
+	memcpy(iwu_to_iwu.data + DECT_IWU_SEG_HDR_SIZE, data, len);
+
+	return dect_mncc_iwu_info_req(dh, call, &param);
+}
+
+/* Send segments of the queued payloads while the window is open */
+static int dect_iwu_stream_xmit(struct dect_handle *dh, struct dect_call *call,
+				struct dect_iwu_stream *is)
+{
+	unsigned int inflight, len, ack_every;
+	struct dect_iwu_tx *tx;
+	uint8_t flags;
+
+	ack_every = max(is->param.window / 2, 1U);
+	while ((tx = is->tx_cur) != NULL &&
+	       (inflight = dect_iwu_tx_inflight(is)) < is->param.window) {
+		len   = min(tx->len - tx->off, (size_t)DECT_IWU_SEG_DATA_MAX);
+		flags = 0;
+		if (tx->off == 0)
+			flags |= DECT_IWU_SEG_FIRST;
+		if (tx->off + len == tx->len)
+			flags |= DECT_IWU_SEG_LAST;
+		if ((inflight + 1) % ack_every == 0 ||
+		    inflight + 1 == is->param.window)
+			flags |= DECT_IWU_SEG_ACK_REQ;
+
+		if (dect_iwu_stream_send_seg(dh, call, is, flags, is->tx_seq,
+					     tx->data + tx->off, len) < 0)
+			return -1;
+
+		tx->off += len;
+		if (flags & DECT_IWU_SEG_LAST) {
+			tx->last_seq = is->tx_seq;
+			if (list_is_last(&tx->list, &is->tx_queue))
+				is->tx_cur = NULL;
+			else
+				is->tx_cur = list_entry(tx->list.next,
+							struct dect_iwu_tx, list);
+		}
+		is->tx_seq++;
+	}
+	return 0;
+}
+
+/*
+ * Rewind the transmission by the last n segments sent, they are sent again
+ * with the same sequence numbers by the next dect_iwu_stream_xmit().
+ */
+static void dect_iwu_stream_rewind(struct dect_iwu_stream *is, uint8_t n)
+{
+	struct dect_iwu_tx *tx = is->tx_cur;
+
+	is->tx_seq -= n;
+	while (n-- > 0) {
+		if (tx == NULL)
+			tx = list_last_entry(&is->tx_queue, struct dect_iwu_tx, list);
+		else if (tx->off == 0)
+			tx = list_entry(tx->list.prev, struct dect_iwu_tx, list);
+		tx->off = (tx->off - 1) / DECT_IWU_SEG_DATA_MAX *
+			  DECT_IWU_SEG_DATA_MAX;
+	}
+	is->tx_cur = tx;
+}
+
+/* Invoke the sent callback for completed payloads and release them */
+static void dect_iwu_stream_complete(struct dect_handle *dh,
+				     struct dect_call *call,
+				     const struct dect_iwu_stream_param *param,
+				     struct list_head *done, int err)
+{
+	struct dect_iwu_tx *tx, *next;
+
+	list_for_each_entry_safe(tx, next, done, list) {
+		list_del(&tx->list);
+		param->sent(dh, call, tx->data, tx->len, err, param->priv);
+		dect_free(dh, tx);
+	}
+}
+
+static void dect_iwu_stream_notify(struct dect_handle *dh,
+				   struct dect_call *call)
+{
+	struct dect_iwu_stream *is = call->iwu_stream;
+
+	if (is == NULL || !is->tx_blocked ||
+	    is->tx_queued >= is->param.tx_limit)
+		return;
+
+	is->tx_blocked = false;
+	if (is->param.writable != NULL)
+		is->param.writable(dh, call, is->param.priv);
+}
+
+/* The timeout is restarted when the peer makes progress */
+static void dect_iwu_stream_update_timer(const struct dect_handle *dh,
+					 struct dect_iwu_stream *is,
+					 bool progress)
+{
+	if (progress)
+		is->tx_rtx = 0;
+	if (is->tx_queued == 0) {
+		if (dect_timer_running(is->timer))
+			dect_timer_stop(dh, is->timer);
+	} else if (progress || !dect_timer_running(is->timer))
+		dect_timer_start(dh, is->timer, DECT_IWU_STREAM_RTX_TIMEOUT);
+}
+
+/* Detach all queued payloads for failing them */
+static void dect_iwu_stream_flush_tx(struct dect_iwu_stream *is,
+				     struct list_head *done)
+{
+	list_splice_init(&is->tx_queue, done);
+	is->tx_cur    = NULL;
+	is->tx_queued = 0;
+	is->tx_acked  = is->tx_seq;
+}
+
+static void dect_iwu_stream_timer(struct dect_handle *dh,
+				  struct dect_timer *timer)
+{
+	struct dect_call *call = timer->data;
+	struct dect_iwu_stream *is = call->iwu_stream;
+	struct dect_iwu_stream_param param = is->param;
+	LIST_HEAD(done);
+
+	/* Send all unacknowledged segments again */
+	if (is->tx_rtx++ < DECT_IWU_STREAM_RTX_MAX) {
+		is_debug(call, "retransmission timeout");
+		dect_iwu_stream_rewind(is, dect_iwu_tx_inflight(is));
+		if (dect_iwu_stream_xmit(dh, call, is) < 0)
+			is_debug(call, "transmit: %s", strerror(errno));
+		dect_timer_start(dh, is->timer, DECT_IWU_STREAM_RTX_TIMEOUT);
+		return;
+	}
+
+	is_debug(call, "acknowledgement timeout");
+	dect_iwu_stream_flush_tx(is, &done);
+	dect_iwu_stream_complete(dh, call, &param, &done, ETIMEDOUT);
+	dect_iwu_stream_notify(dh, call);
+}
+
+/*
+ * A negative acknowledgement acknowledges the segments preceding the
+ * missing one and requests retransmission of all following segments.
+ */
+static void dect_iwu_stream_rcv_ack(struct dect_handle *dh,
+				    struct dect_call *call,
+				    struct dect_iwu_stream *is, uint8_t seq,
+				    bool nak)
+{
+	struct dect_iwu_stream_param param = is->param;
+	struct dect_iwu_tx *tx, *next;
+	uint8_t acked, old = is->tx_acked;
+	LIST_HEAD(done);
+
+	acked = seq - old;
+	if ((acked == 0 && !nak) || acked > dect_iwu_tx_inflight(is)) {
+		is_debug(call, "stale acknowledgement %u", seq);
+		return;
+	}
+	is->tx_acked = seq;
+	if (nak) {
+		is_debug(call, "retransmit from segment %u", seq);
+		dect_iwu_stream_rewind(is, dect_iwu_tx_inflight(is));
+	}
+
+	list_for_each_entry_safe(tx, next, &is->tx_queue, list) {
+		if (tx == is->tx_cur || (uint8_t)(tx->last_seq - old) >= acked)
+			break;
+		list_move_tail(&tx->list, &done);
+		is->tx_queued--;
+	}
+
+	if (dect_iwu_stream_xmit(dh, call, is) < 0)
+		is_debug(call, "transmit: %s", strerror(errno));
+	dect_iwu_stream_update_timer(dh, is, acked != 0);
+
+	dect_iwu_stream_complete(dh, call, &param, &done, 0);
+	dect_iwu_stream_notify(dh, call);
+}
+
+static void dect_iwu_stream_rx_reset(const struct dect_handle *dh,
+				     struct dect_iwu_stream *is)
+{
+	struct dect_msg_buf *mb;
+
+	while ((mb = ptrqueue_dequeue_head(&is->rx_queue)) != NULL)
+		dect_mbuf_free(dh, mb);
+	is->rx_active  = false;
+	is->rx_discard = false;
+	is->rx_len     = 0;
+	is->rx_cnt     = 0;
+}
+
+/* Append segment data to the payload, filling each message buffer */
+static int dect_iwu_stream_rx_append(const struct dect_handle *dh,
+				     struct dect_iwu_stream *is,
+				     const uint8_t *data, unsigned int len)
+{
+	struct dect_msg_buf *mb;
+	unsigned int n;
+
+	while (len > 0) {
+		mb = is->rx_queue.head != NULL ?
+		     container_of(is->rx_queue.tail, struct dect_msg_buf, next) :
+		     NULL;
+		if (mb == NULL || mb->len == sizeof(mb->head)) {
+			mb = dect_mbuf_alloc_raw(dh);
+			if (mb == NULL)
+				return -1;
+			ptrqueue_add_tail(mb, &is->rx_queue);
+			is->rx_cnt++;
+		}
+
+		n = min(len, (unsigned int)sizeof(mb->head) - mb->len);
+		memcpy(dect_mbuf_put(mb, n), data, n);
+		is->rx_len += n;
+		data += n;
+		len  -= n;
+	}
+	return 0;
+}
+
+/* Pass a reassembled payload to the application */
+static void dect_iwu_stream_deliver(struct dect_handle *dh,
+				    struct dect_call *call,
+				    struct dect_iwu_stream *is)
+{
+	struct dect_iwu_stream_param param = is->param;
+	struct dect_msg_buf *mb, *head = is->rx_queue.head;
+	unsigned int i, n = is->rx_cnt;
+	struct iovec *iov;
+
+	/* The queue is handed over, the callback may close the stream */
+	ptrqueue_init(&is->rx_queue);
+	dect_iwu_stream_rx_reset(dh, is);
+
+	iov = dect_malloc(dh, max(n, 1U) * sizeof(*iov));
+	if (iov != NULL) {
+		for (mb = head, i = 0; mb != NULL; mb = mb->next, i++) {
+			iov[i].iov_base = mb->data;
+			iov[i].iov_len  = mb->len;
+		}
+		param.receive(dh, call, iov, n, param.priv);
+		dect_free(dh, iov);
+	}
+
+	while ((mb = head) != NULL) {
+		head = mb->next;
+		dect_mbuf_free(dh, mb);
+	}
+}
+
+/* Called from the CC layer for each received {CC-IWU-INFO} message */
+bool dect_iwu_stream_rcv(struct dect_handle *dh, struct dect_call *call,
+			 const struct dect_ie_iwu_to_iwu *ie)
+{
+	struct dect_iwu_stream *is = call->iwu_stream;
+	uint8_t flags, seq;
+
+	if (is == NULL || ie == NULL || ie->pd != is->param.pd ||
+	    ie->len < DECT_IWU_SEG_HDR_SIZE)
+		return false;
+
+	flags = ie->data[0];
+	seq   = ie->data[1];
+	if (flags & DECT_IWU_SEG_ACK) {
+		dect_iwu_stream_rcv_ack(dh, call, is, seq,
+					flags & DECT_IWU_SEG_NAK);
+		return true;
+	}
+
+	/*
+	 * Segments following a gap are dropped, the gap is reported once
+	 * until the missing segment arrives. Duplicates are acknowledged
+	 * again in case the acknowledgement was lost.
+	 */
+	if (seq != is->rx_next) {
+		is_debug(call, "segment %u, expected %u", seq, is->rx_next);
+		if ((uint8_t)(seq - is->rx_next) < DECT_IWU_STREAM_WINDOW_MAX) {
+			if (!is->rx_nak)
+				dect_iwu_stream_send_seg(dh, call, is,
+							 DECT_IWU_SEG_ACK |
+							 DECT_IWU_SEG_NAK,
+							 is->rx_next, NULL, 0);
+			is->rx_nak = true;
+		} else if (flags & (DECT_IWU_SEG_ACK_REQ | DECT_IWU_SEG_LAST))
+			dect_iwu_stream_send_seg(dh, call, is, DECT_IWU_SEG_ACK,
+						 is->rx_next, NULL, 0);
+		return true;
+	}
+	is->rx_nak  = false;
+	is->rx_next = seq + 1;
+
+	if (flags & DECT_IWU_SEG_FIRST) {
+		dect_iwu_stream_rx_reset(dh, is);
+		is->rx_active = true;
+	}
+
+	if (is->rx_active && !is->rx_discard) {
+		if (is->rx_len + ie->len - DECT_IWU_SEG_HDR_SIZE >
+		    is->param.rx_max ||
+		    dect_iwu_stream_rx_append(dh, is,
+					      ie->data + DECT_IWU_SEG_HDR_SIZE,
+					      ie->len - DECT_IWU_SEG_HDR_SIZE) < 0) {
+			is_debug(call, "discarding payload");
+			dect_iwu_stream_rx_reset(dh, is);
+			is->rx_active  = true;
+			is->rx_discard = true;
+		}
+	}
+
+	if (flags & (DECT_IWU_SEG_ACK_REQ | DECT_IWU_SEG_LAST))
+		dect_iwu_stream_send_seg(dh, call, is, DECT_IWU_SEG_ACK,
+					 is->rx_next, NULL, 0);
+
+	if (flags & DECT_IWU_SEG_LAST) {
+		if (is->rx_active && !is->rx_discard)
+			dect_iwu_stream_deliver(dh, call, is);
+		else
+			dect_iwu_stream_rx_reset(dh, is);
+	}
+	return true;
+}
+
+static void __dect_iwu_stream_close(struct dect_handle *dh,
+				    struct dect_call *call, int err)
+{
+	struct dect_iwu_stream *is = call->iwu_stream;
+	struct dect_iwu_stream_param param = is->param;
+	LIST_HEAD(done);
+
+	call->iwu_stream = NULL;
+	if (dect_timer_running(is->timer))
+		dect_timer_stop(dh, is->timer);
+	dect_timer_free(dh, is->timer);
+	dect_iwu_stream_flush_tx(is, &done);
+	dect_iwu_stream_rx_reset(dh, is);
+	dect_free(dh, is);
+
+	dect_iwu_stream_complete(dh, call, &param, &done, err);
+}
+
+/* Called from the CC layer when a call is destroyed */
+void dect_iwu_stream_call_destroy(struct dect_handle *dh,
+				  struct dect_call *call)
+{
+	if (call->iwu_stream != NULL)
+		__dect_iwu_stream_close(dh, call, ECONNRESET);
+}
+
+/**
+ * Open an IWU data stream on a call
+ *
+ * @param dh		libdect DECT handle
+ * @param call		Call Control Endpoint
+ * @param param		stream parameters
+ *
+ * @return 0 on success or -1 on error.
+ */
+int dect_iwu_stream_open(struct dect_handle *dh, struct dect_call *call,
+			 const struct dect_iwu_stream_param *param)
+{
+	struct dect_iwu_stream *is;
+
+	if (call->iwu_stream != NULL || param->receive == NULL ||
+	    param->sent == NULL || param->window > DECT_IWU_STREAM_WINDOW_MAX) {
+		errno = EINVAL;
+		goto err1;
+	}
+
+	is = dect_zalloc(dh, sizeof(*is));
+	if (is == NULL)
+		goto err1;
+	is->param = *param;
+	if (is->param.window == 0)
+		is->param.window = DECT_IWU_STREAM_WINDOW;
+	if (is->param.tx_limit == 0)
+		is->param.tx_limit = DECT_IWU_STREAM_TX_LIMIT;
+	if (is->param.rx_max == 0)
+		is->param.rx_max = DECT_IWU_STREAM_RX_MAX;
+	init_list_head(&is->tx_queue);
+	ptrqueue_init(&is->rx_queue);
+
+	is->timer = dect_timer_alloc(dh);
+	if (is->timer == NULL)
+		goto err2;
+	dect_timer_setup(is->timer, dect_iwu_stream_timer, call);
+
+	call->iwu_stream = is;
+	return 0;
+
+err2:
+	dect_free(dh, is);
+err1:
+	return -1;
+}
+EXPORT_SYMBOL(dect_iwu_stream_open);
+
+/**
+ * Close the IWU data stream of a call
+ *
+ * @param dh		libdect DECT handle
+ * @param call		Call Control Endpoint
+ *
+ * Payloads which have not been acknowledged are failed with ECANCELED, a
+ * partially received payload is discarded.
+ */
+void dect_iwu_stream_close(struct dect_handle *dh, struct dect_call *call)
+{
+	if (call->iwu_stream != NULL)
+		__dect_iwu_stream_close(dh, call, ECANCELED);
+}
+EXPORT_SYMBOL(dect_iwu_stream_close);
+
+/**
+ * Queue a payload for transmission on the IWU data stream of a call
+ *
+ * @param dh		libdect DECT handle
+ * @param call		Call Control Endpoint
+ * @param data		payload data, must remain valid until the sent callback
+ * @param len		payload length
+ *
+ * @return 0 on success or -1 on error, with errno set to EAGAIN if the limit
+ * of queued payloads has been reached.
+ */
+int dect_iwu_stream_send(struct dect_handle *dh, struct dect_call *call,
+			 const void *data, size_t len)
+{
+	struct dect_iwu_stream *is = call->iwu_stream;
+	struct dect_iwu_tx *tx;
+
+	if (is == NULL || data == NULL || len == 0) {
+		errno = EINVAL;
+		goto err1;
+	}
+	if (is->tx_queued >= is->param.tx_limit) {
+		is->tx_blocked = true;
+		errno = EAGAIN;
+		goto err1;
+	}
+
+	tx = dect_zalloc(dh, sizeof(*tx));
+	if (tx == NULL)
+		goto err1;
+	tx->data = data;
+	tx->len  = len;
+
+	list_add_tail(&tx->list, &is->tx_queue);
+	is->tx_queued++;
+	if (is->tx_cur == NULL)
+		is->tx_cur = tx;
+
+	if (dect_iwu_stream_xmit(dh, call, is) < 0 && tx->off == 0)
+		goto err2;
+	dect_iwu_stream_update_timer(dh, is, false);
+	return 0;
+
+err2:
+	if (is->tx_cur == tx)
+		is->tx_cur = NULL;
+	list_del(&tx->list);
+	is->tx_queued--;
+	dect_free(dh, tx);
+	dect_iwu_stream_update_timer(dh, is, false);
+err1:
+	return -1;
+}
+EXPORT_SYMBOL(dect_iwu_stream_send);
+
+/** @} */
+/** @} */
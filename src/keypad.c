@@ -10,12 +10,37 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <errno.h>
 
 #include <libdect.h>
 #include <dect/keypad.h>
 #include <utils.h>
 #include <timer.h>
 
+#define DECT_DIGIT_MAP_MAX		256
+#define DECT_DIGIT_MAP_WORDS		(DECT_DIGIT_MAP_MAX / 64)
+#define DECT_DIGIT_MAP_KEYS		12
+
+/**
+ * struct dect_digit_map - compiled digit map
+ *
+ * @match:	positions accepting a key, indexed by key
+ * @repeat:	positions of elements which may be repeated
+ * @end:	pattern end positions
+ * @start:	initial state
+ *
+ * Each pattern is compiled to one position per element, followed by an end
+ * position. The state of a keypad buffer is the set of positions reachable
+ * by the digits received so far, which is updated for each digit using the
+ * per key position masks.
+ */
+struct dect_digit_map {
+	uint64_t		match[DECT_DIGIT_MAP_KEYS][DECT_DIGIT_MAP_WORDS];
+	uint64_t		repeat[DECT_DIGIT_MAP_WORDS];
+	uint64_t		end[DECT_DIGIT_MAP_WORDS];
+	uint64_t		start[DECT_DIGIT_MAP_WORDS];
+};
+
 struct dect_keypad_buffer {
 	struct dect_timer	*timer;
 	struct dect_ie_keypad	keypad;
@@ -23,8 +48,210 @@ struct dect_keypad_buffer {
 	void			*priv;
 	void			(*complete)(struct dect_handle *, void *,
 					    struct dect_ie_keypad *);
+	const struct dect_digit_map *map;
+	uint64_t		state[DECT_DIGIT_MAP_WORDS];
 };
 
+static int dect_digit_map_key(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c == '*')
+		return 10;
+	if (c == '#')
+		return 11;
+	return -1;
+}
+
+static void dect_digit_map_set(uint64_t *set, unsigned int pos)
+{
+	set[pos / 64] |= 1ULL << (pos % 64);
+}
+
+/* Add the positions following repeatable elements, which may be skipped */
+static void dect_digit_map_closure(const struct dect_digit_map *map,
+				   uint64_t *state)
+{
+	unsigned int pos;
+
+	for (pos = 0; pos < DECT_DIGIT_MAP_MAX - 1; pos++) {
+		if (state[pos / 64] & map->repeat[pos / 64] &
+		    (1ULL << (pos % 64)))
+			dect_digit_map_set(state, pos + 1);
+	}
+}
+
+static void dect_digit_map_step(const struct dect_digit_map *map,
+				uint64_t *state, char c)
+{
+	uint64_t m[DECT_DIGIT_MAP_WORDS], carry = 0;
+	unsigned int i;
+	int key;
+
+	key = dect_digit_map_key(c);
+	for (i = 0; i < DECT_DIGIT_MAP_WORDS; i++) {
+		m[i] = key < 0 ? 0 : state[i] & map->match[key][i];
+		/* Repeated elements stay active, others advance by one */
+		state[i]  = m[i] & map->repeat[i];
+		m[i]     &= ~map->repeat[i];
+		state[i] |= m[i] << 1 | carry;
+		carry     = m[i] >> 63;
+	}
+	dect_digit_map_closure(map, state);
+}
+
+/* A match is unambiguous once a pattern has ended and no other can continue */
+static bool dect_digit_map_matched(const struct dect_digit_map *map,
+				   const uint64_t *state)
+{
+	uint64_t end = 0, other = 0;
+	unsigned int i;
+
+	for (i = 0; i < DECT_DIGIT_MAP_WORDS; i++) {
+		end   |= state[i] & map->end[i];
+		other |= state[i] & ~map->end[i];
+	}
+	return end && !other;
+}
+
+/**
+ * Compile a digit map
+ *
+ * @param dh		libdect DECT handle
+ * @param str		digit map
+ *
+ * A digit map consists of patterns separated by '|'. Patterns consist of the
+ * keys '0'-'9', '*' and '#', 'x' matching any digit, sets of keys in square
+ * brackets, which may contain ranges like "[2-5]", and '.' matching zero or
+ * more repetitions of the preceding element. A keypad buffer using the map
+ * completes as soon as the received digits match a pattern and can't match
+ * a longer one, for instance the map "1[1-9]x|0xxxxxxxxx.|*x#" completes
+ * after three digits for numbers starting with 1 and after '#' for service
+ * codes, while numbers starting with 0 complete on timeout.
+ *
+ * @return the digit map or NULL on error.
+ */
+struct dect_digit_map *dect_digit_map_compile(const struct dect_handle *dh,
+					      const char *str)
+{
+	struct dect_digit_map *map;
+	unsigned int pos = 0, first = 0, keys;
+	int key, last;
+
+	map = dect_zalloc(dh, sizeof(*map));
+	if (map == NULL)
+		return NULL;
+	dect_digit_map_set(map->start, 0);
+
+	for (; *str != '\0'; str++) {
+		switch (*str) {
+		case '|':
+			if (pos == first)
+				goto err;
+			dect_digit_map_set(map->end, pos++);
+			if (pos >= DECT_DIGIT_MAP_MAX)
+				goto err;
+			dect_digit_map_set(map->start, pos);
+			first = pos;
+			continue;
+		case '.':
+			if (pos == first)
+				goto err;
+			dect_digit_map_set(map->repeat, pos - 1);
+			continue;
+		case 'x':
+			keys = 0x3ff;
+			break;
+		case '[':
+			keys = 0;
+			last = -1;
+			for (str++; *str != ']'; str++) {
+				if (*str == '-' && last >= 0 &&
+				    (key = dect_digit_map_key(str[1])) > last) {
+					keys |= ((1U << (key + 1)) - 1) &
+						~((1U << last) - 1);
+					str++;
+					last = -1;
+					continue;
+				}
+				key = dect_digit_map_key(*str);
+				if (key < 0)
+					goto err;
+				keys |= 1U << key;
+				last  = key;
+			}
+			if (keys == 0)
+				goto err;
+			break;
+		default:
+			key = dect_digit_map_key(*str);
+			if (key < 0)
+				goto err;
+			keys = 1U << key;
+			break;
+		}
+
+		if (pos >= DECT_DIGIT_MAP_MAX - 1)
+			goto err;
+		for (key = 0; key < DECT_DIGIT_MAP_KEYS; key++) {
+			if (keys & (1U << key))
+				dect_digit_map_set(map->match[key], pos);
+		}
+		pos++;
+	}
+
+	if (pos == first)
+		goto err;
+	dect_digit_map_set(map->end, pos);
+	dect_digit_map_closure(map, map->start);
+	return map;
+
+err:
+	dect_free(dh, map);
+	errno = EINVAL;
+	return NULL;
+}
+EXPORT_SYMBOL(dect_digit_map_compile);
+
+/**
+ * Release a compiled digit map
+ *
+ * @param dh		libdect DECT handle
+ * @param map		digit map
+ *
+ * The map must not be in use by a keypad buffer.
+ */
+void dect_digit_map_free(const struct dect_handle *dh,
+			 struct dect_digit_map *map)
+{
+	dect_free(dh, map);
+}
+EXPORT_SYMBOL(dect_digit_map_free);
+
+/**
+ * Set the digit map of a keypad buffer
+ *
+ * @param kb		keypad buffer
+ * @param map		digit map, NULL to complete on timeout only
+ *
+ * Digits already contained in the buffer are evaluated immediately. The map
+ * may be shared by multiple buffers.
+ */
+void dect_keypad_buffer_set_digit_map(struct dect_keypad_buffer *kb,
+				      const struct dect_digit_map *map)
+{
+	unsigned int i;
+
+	kb->map = map;
+	if (map == NULL)
+		return;
+
+	memcpy(kb->state, map->start, sizeof(kb->state));
+	for (i = 0; i < kb->keypad.len; i++)
+		dect_digit_map_step(map, kb->state, kb->keypad.info[i]);
+}
+EXPORT_SYMBOL(dect_keypad_buffer_set_digit_map);
+
 static void dect_keypad_timer(struct dect_handle *dh, struct dect_timer *timer)
 {
 	struct dect_keypad_buffer *kb = timer->data;
@@ -36,17 +263,25 @@ void dect_keypad_append(struct dect_handle *dh, struct dect_keypad_buffer *kb,
 			const struct dect_ie_keypad *keypad,
 			bool sending_complete)
 {
-	unsigned int len;
+	unsigned int len, i;
+	bool matched = false;
 
-	if (keypad->len > 0)
-		dect_timer_stop(dh, kb->timer);
+	if (keypad->len > 0 && dect_timer_running(kb->timer))
+		dect_timer_cancel(dh, kb->timer);
 
 	len = sizeof(kb->keypad.info) - kb->keypad.len;
 	len = min((unsigned int)keypad->len, len);
 	memcpy(kb->keypad.info + kb->keypad.len, keypad->info, len);
 	kb->keypad.len += len;
 
-	if (sending_complete || kb->keypad.len == sizeof(kb->keypad.info))
+	if (kb->map != NULL) {
+		for (i = 0; i < len; i++)
+			dect_digit_map_step(kb->map, kb->state, keypad->info[i]);
+		matched = dect_digit_map_matched(kb->map, kb->state);
+	}
+
+	if (sending_complete || matched ||
+	    kb->keypad.len == sizeof(kb->keypad.info))
 		kb->complete(dh, kb->priv, &kb->keypad);
 	else if (keypad->len > 0)
 		dect_timer_start(dh, kb->timer, kb->timeout);
@@ -69,6 +304,7 @@ dect_keypad_buffer_init(const struct dect_handle *dh, uint8_t timeout,
 	if (kb->timer == NULL)
 		goto err2;
 	dect_timer_setup(kb->timer, dect_keypad_timer, kb);
+	dect_timer_set_slack_class(kb->timer, DECT_TIMER_SLACK_COARSE);
 
 	kb->complete = complete;
 	kb->priv     = priv;
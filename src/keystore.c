@@ -0,0 +1,641 @@
+/*
+ * libdect subscriber key store
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @defgroup keystore Key store
+ *
+ * Storage of the authentication keys of subscribers within libdect.
+ *
+ * Without a key store, the application looks up the UAK or authentication
+ * code for the IPUI of a PP on each MM_AUTHENTICATE-ind and responds using
+ * dect_mm_authenticate_res(), and keeps the derived cipher key for the
+ * following MM_CIPHER-ind. With a key store opened using dect_keystore_open(),
+ * libdect completes these procedures itself when an entry for the IPUI is
+ * present:
+ *
+ * - authentication requests using the UAK or the authentication code are
+ *   answered without invoking the mm_authenticate_ind() callback. On the PP,
+ *   the cipher key derived by the authentication is stored in the entry.
+ * - cipher requests of the FT using the stored derived cipher key are
+ *   accepted without invoking the mm_cipher_ind() callback.
+ * - dect_mm_secure_req() uses the stored UAK if no UAK is given.
+ * - bulk provisioning stores the UAK of successfully provisioned PPs.
+ *
+ * On the FP, the entry is looked up by the IPUI of the data link, which is
+ * known once the PP has identified itself, i.e. by a locate or access rights
+ * request or a call setup. Requests for which no IPUI is known or no suitable
+ * key is stored are passed to the application as usual.
+ *
+ * The table consists of a fixed number of fixed size records indexed by the
+ * hash of the packed IPUI using linear probing. It is kept in anonymous
+ * memory or in a shared mapping of a file, in which case changes reach the
+ * file through the page cache and dect_keystore_sync() writes them to disk.
+ * Records are checksummed, records torn by a system crash are discarded when
+ * the file is opened. Records are not modified in place, an update writes a
+ * new record and deletes the old one afterwards, so a torn update loses at
+ * most the new keys. The file contains the keys in plain text and is
+ * created accessible by its owner only.
+ *
+ * @{
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <libdect.h>
+#include <identities.h>
+#include <utils.h>
+#include <lce.h>
+#include <keystore.h>
+
+#define ks_debug(fmt, args...) \
+	dect_debug(DECT_DEBUG_MM, "keystore: " fmt, ## args)
+
+#define DECT_KEYSTORE_MAGIC		0x444b5354
+#define DECT_KEYSTORE_VERSION		2
+#define DECT_KEYSTORE_HDR_SIZE		64
+
+/**
+ * struct dect_keystore_hdr - key store file header
+ *
+ * @magic:	DECT_KEYSTORE_MAGIC
+ * @version:	file format version
+ * @bits:	number of bits of the record index
+ * @rec_size:	size of a record
+ */
+struct dect_keystore_hdr {
+	uint32_t				magic;
+	uint16_t				version;
+	uint16_t				bits;
+	uint32_t				rec_size;
+};
+
+enum dect_keystore_rec_states {
+	DECT_KEYSTORE_REC_FREE,
+	DECT_KEYSTORE_REC_USED,
+	DECT_KEYSTORE_REC_DELETED,
+};
+
+/**
+ * struct dect_keystore_rec - key store record
+ *
+ * @csum:	checksum of @key, @gen, @ipui and @entry
+ * @state:	record state, deleted records continue probe sequences
+ * @key:	packed IPUI
+ * @gen:	update generation, the newest record of an IPUI is valid
+ * @ipui:	IPUI
+ * @entry:	keys stored for the IPUI
+ */
+struct dect_keystore_rec {
+	uint32_t				csum;
+	uint32_t				state;
+	uint64_t				key;
+	uint32_t				gen;
+	struct dect_ipui			ipui;
+	struct dect_keystore_entry		entry;
+};
+
+/**
+ * struct dect_keystore - subscriber key store
+ *
+ * @map:	mapping of the table
+ * @size:	size of the mapping
+ * @file:	mapping is backed by a file
+ * @bits:	number of bits of the record index
+ * @mask:	number of records - 1
+ * @recs:	records
+ * @gen:	generation of the next update
+ * @dirty_lo:	first record changed since the last sync
+ * @dirty_hi:	last record changed since the last sync + 1
+ */
+struct dect_keystore {
+	void					*map;
+	size_t					size;
+	bool					file;
+	unsigned int				bits;
+	unsigned int				mask;
+	struct dect_keystore_rec		*recs;
+	uint32_t				gen;
+	unsigned int				dirty_lo;
+	unsigned int				dirty_hi;
+};
+
+static uint32_t dect_keystore_csum(const struct dect_keystore_rec *rec)
+{
+	const uint8_t *data = (const uint8_t *)&rec->key;
+	uint32_t h = 0x811c9dc5;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(*rec) - offsetof(struct dect_keystore_rec, key); i++)
+		h = (h ^ data[i]) * 0x01000193;
+	return h;
+}
+
+/* Find the record of an IPUI */
+static struct dect_keystore_rec *
+dect_keystore_find(const struct dect_keystore *ks, uint64_t key,
+		   const struct dect_ipui *ipui)
+{
+	struct dect_keystore_rec *rec;
+	unsigned int i, n;
+
+	i = hash_64(key, ks->bits);
+	for (n = 0; n <= ks->mask; n++, i = (i + 1) & ks->mask) {
+		rec = &ks->recs[i];
+		switch (rec->state) {
+		case DECT_KEYSTORE_REC_FREE:
+			return NULL;
+		case DECT_KEYSTORE_REC_DELETED:
+			break;
+		default:
+			if (dect_ipui_key_eq(rec->key, &rec->ipui, key, ipui))
+				return rec;
+			break;
+		}
+	}
+	return NULL;
+}
+
+/* Find the first free or deleted record in the probe sequence of an IPUI */
+static struct dect_keystore_rec *
+dect_keystore_find_slot(const struct dect_keystore *ks, uint64_t key)
+{
+	struct dect_keystore_rec *rec;
+	unsigned int i, n;
+
+	i = hash_64(key, ks->bits);
+	for (n = 0; n <= ks->mask; n++, i = (i + 1) & ks->mask) {
+		rec = &ks->recs[i];
+		if (rec->state != DECT_KEYSTORE_REC_USED)
+			return rec;
+	}
+	return NULL;
+}
+
+static void dect_keystore_commit(struct dect_keystore *ks,
+				 struct dect_keystore_rec *rec,
+				 enum dect_keystore_rec_states state)
+{
+	unsigned int i;
+
+	rec->csum = dect_keystore_csum(rec);
+	__atomic_store_n(&rec->state, state, __ATOMIC_RELEASE);
+
+	i = rec - ks->recs;
+	if (ks->dirty_lo >= ks->dirty_hi) {
+		ks->dirty_lo = i;
+		ks->dirty_hi = i + 1;
+	} else {
+		ks->dirty_lo = min(ks->dirty_lo, i);
+		ks->dirty_hi = max(ks->dirty_hi, i + 1);
+	}
+}
+
+static void dect_keystore_remove(struct dect_keystore *ks,
+				 struct dect_keystore_rec *rec)
+{
+	memset(&rec->entry, 0, sizeof(rec->entry));
+	dect_keystore_commit(ks, rec, DECT_KEYSTORE_REC_DELETED);
+}
+
+/*
+ * Store the keys of an IPUI replacing the record @old. The keys are written
+ * to the first free or deleted record of the probe sequence, which remains
+ * unused until committed, before deleting @old. If both survive a crash, the
+ * newer generation is kept when the file is opened. When the table is full,
+ * @old is rewritten in place and marked deleted meanwhile; its probe
+ * sequence continues if the record is torn.
+ */
+static int dect_keystore_store(struct dect_keystore *ks,
+			       struct dect_keystore_rec *old, uint64_t key,
+			       const struct dect_ipui *ipui,
+			       const struct dect_keystore_entry *entry)
+{
+	struct dect_keystore_rec *rec;
+
+	rec = dect_keystore_find_slot(ks, key);
+	if (rec == NULL) {
+		if (old == NULL) {
+			errno = ENOSPC;
+			return -1;
+		}
+		rec = old;
+		old = NULL;
+		__atomic_store_n(&rec->state, DECT_KEYSTORE_REC_DELETED,
+				 __ATOMIC_RELEASE);
+	}
+
+	rec->key   = key;
+	rec->gen   = ks->gen++;
+	rec->ipui  = *ipui;
+	rec->entry = *entry;
+	dect_keystore_commit(ks, rec, DECT_KEYSTORE_REC_USED);
+
+	if (old != NULL)
+		dect_keystore_remove(ks, old);
+	return 0;
+}
+
+/* Get the IPUI of the PP at the other end of a data link */
+static const struct dect_ipui *dect_keystore_link_ipui(const struct dect_handle *dh,
+						       const struct dect_data_link *ddl,
+						       uint64_t *key)
+{
+	if (ddl->flags & DECT_DATA_LINK_IPUI_VALID) {
+		*key = ddl->ipui_key;
+		return &ddl->ipui;
+	}
+	if (dh->mode == DECT_MODE_PP && dh->flags & DECT_PP_IPUI) {
+		*key = dect_ipui_key(&dh->ipui);
+		return &dh->ipui;
+	}
+	return NULL;
+}
+
+/**
+ * dect_keystore_get - get the keys of the PP of a data link
+ *
+ * @dh:		libdect DECT handle
+ * @ddl:	data link
+ *
+ * On the PP, the keys of the PP's own IPUI are returned. The entry is
+ * valid until the key store is changed.
+ */
+const struct dect_keystore_entry *
+dect_keystore_get(const struct dect_handle *dh, const struct dect_data_link *ddl)
+{
+	const struct dect_keystore_rec *rec;
+	const struct dect_ipui *ipui;
+	uint64_t key;
+
+	if (dh->keystore == NULL)
+		return NULL;
+	ipui = dect_keystore_link_ipui(dh, ddl, &key);
+	if (ipui == NULL)
+		return NULL;
+
+	rec = dect_keystore_find(dh->keystore, key, ipui);
+	return rec != NULL ? &rec->entry : NULL;
+}
+
+/**
+ * dect_keystore_set_uak - store a UAK allocated by libdect
+ *
+ * @dh:		libdect DECT handle
+ * @ipui:	IPUI of the PP
+ * @uak:	user authentication key
+ *
+ * The authentication code of an existing entry is kept, a stored cipher key
+ * is invalidated.
+ */
+void dect_keystore_set_uak(struct dect_handle *dh, const struct dect_ipui *ipui,
+			   const uint8_t *uak)
+{
+	struct dect_keystore *ks = dh->keystore;
+	struct dect_keystore_entry entry = {};
+	struct dect_keystore_rec *rec;
+	uint64_t key;
+
+	if (ks == NULL)
+		return;
+
+	key = dect_ipui_key(ipui);
+	rec = dect_keystore_find(ks, key, ipui);
+	if (rec != NULL)
+		entry = rec->entry;
+
+	memcpy(entry.uak, uak, sizeof(entry.uak));
+	memset(entry.dck, 0, sizeof(entry.dck));
+	entry.flags |= DECT_KEYSTORE_UAK;
+	entry.flags &= ~DECT_KEYSTORE_DCK;
+	if (dect_keystore_store(ks, rec, key, ipui, &entry) < 0)
+		ks_debug("key store full, UAK not stored\n");
+}
+
+/**
+ * dect_keystore_set_dck - store a cipher key derived by libdect
+ *
+ * @dh:			libdect DECT handle
+ * @ddl:		data link
+ * @dck:		derived cipher key
+ * @cipher_key_num:	cipher key number
+ *
+ * Only updates existing entries.
+ */
+void dect_keystore_set_dck(struct dect_handle *dh,
+			   const struct dect_data_link *ddl,
+			   const uint8_t *dck, uint8_t cipher_key_num)
+{
+	struct dect_keystore *ks = dh->keystore;
+	struct dect_keystore_entry entry;
+	struct dect_keystore_rec *rec;
+	const struct dect_ipui *ipui;
+	uint64_t key;
+
+	if (ks == NULL)
+		return;
+	ipui = dect_keystore_link_ipui(dh, ddl, &key);
+	if (ipui == NULL)
+		return;
+	rec = dect_keystore_find(ks, key, ipui);
+	if (rec == NULL)
+		return;
+
+	entry = rec->entry;
+	memcpy(entry.dck, dck, sizeof(entry.dck));
+	entry.cipher_key_num = cipher_key_num;
+	entry.flags |= DECT_KEYSTORE_DCK;
+	dect_keystore_store(ks, rec, key, ipui, &entry);
+}
+
+/**
+ * Add or replace the keys of a PP
+ *
+ * @param dh		libdect DECT handle
+ * @param ipui		IPUI of the PP
+ * @param entry		keys, the flags specify the valid keys
+ *
+ * @return 0 on success or -1 on error.
+ */
+int dect_keystore_update(struct dect_handle *dh, const struct dect_ipui *ipui,
+			 const struct dect_keystore_entry *entry)
+{
+	struct dect_keystore *ks = dh->keystore;
+	struct dect_keystore_rec *rec;
+	uint64_t key;
+
+	if (ks == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	key = dect_ipui_key(ipui);
+	rec = dect_keystore_find(ks, key, ipui);
+	return dect_keystore_store(ks, rec, key, ipui, entry);
+}
+EXPORT_SYMBOL(dect_keystore_update);
+
+/**
+ * Look up the keys of a PP
+ *
+ * @param dh		libdect DECT handle
+ * @param ipui		IPUI of the PP
+ * @param entry		storage for the keys
+ *
+ * @return 0 on success or -1 if no entry exists.
+ */
+int dect_keystore_lookup(const struct dect_handle *dh,
+			 const struct dect_ipui *ipui,
+			 struct dect_keystore_entry *entry)
+{
+	const struct dect_keystore_rec *rec = NULL;
+
+	if (dh->keystore != NULL)
+		rec = dect_keystore_find(dh->keystore, dect_ipui_key(ipui),
+					 ipui);
+	if (rec == NULL) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	*entry = rec->entry;
+	return 0;
+}
+EXPORT_SYMBOL(dect_keystore_lookup);
+
+/**
+ * Delete the keys of a PP
+ *
+ * @param dh		libdect DECT handle
+ * @param ipui		IPUI of the PP
+ *
+ * @return 0 on success or -1 if no entry exists.
+ */
+int dect_keystore_delete(struct dect_handle *dh, const struct dect_ipui *ipui)
+{
+	struct dect_keystore_rec *rec = NULL;
+
+	if (dh->keystore != NULL)
+		rec = dect_keystore_find(dh->keystore, dect_ipui_key(ipui),
+					 ipui);
+	if (rec == NULL) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	dect_keystore_remove(dh->keystore, rec);
+	return 0;
+}
+EXPORT_SYMBOL(dect_keystore_delete);
+
+/*
+ * Discard records torn by a system crash, keeping their probe sequences, and
+ * the older record of an IPUI whose update was interrupted.
+ */
+static void dect_keystore_check(struct dect_keystore *ks)
+{
+	struct dect_keystore_rec *rec, *dup;
+	unsigned int i, n = 0, torn = 0;
+
+	for (i = 0; i <= ks->mask; i++) {
+		rec = &ks->recs[i];
+		if (rec->state != DECT_KEYSTORE_REC_USED)
+			continue;
+		if (rec->csum != dect_keystore_csum(rec)) {
+			dect_keystore_remove(ks, rec);
+			torn++;
+			continue;
+		}
+		if ((int32_t)(rec->gen - ks->gen) >= 0)
+			ks->gen = rec->gen + 1;
+	}
+
+	for (i = 0; i <= ks->mask; i++) {
+		rec = &ks->recs[i];
+		if (rec->state != DECT_KEYSTORE_REC_USED)
+			continue;
+		while ((dup = dect_keystore_find(ks, rec->key, &rec->ipui)) != NULL &&
+		       dup != rec) {
+			if ((int32_t)(rec->gen - dup->gen) < 0) {
+				dect_keystore_remove(ks, rec);
+				break;
+			}
+			dect_keystore_remove(ks, dup);
+		}
+		if (rec->state == DECT_KEYSTORE_REC_USED)
+			n++;
+	}
+
+	ks_debug("loaded %u entries, %u damaged\n", n, torn);
+}
+
+/**
+ * Open a key store
+ *
+ * @param dh		libdect DECT handle
+ * @param path		key store file or NULL to keep the keys in memory only
+ * @param size		number of records of a new key store, a power of two
+ *
+ * A new file is created if it doesn't exist, otherwise the size of the
+ * existing file is used. Each handle, including the shards of a handle, must
+ * use a separate file.
+ *
+ * @return 0 on success or -1 on error.
+ */
+int dect_keystore_open(struct dect_handle *dh, const char *path,
+		       unsigned int size)
+{
+	struct dect_keystore_hdr *hdr;
+	struct dect_keystore *ks;
+	struct stat st = {};
+	int fd = -1;
+
+	if (dh->keystore != NULL || size < 2 || (size & (size - 1))) {
+		errno = EINVAL;
+		goto err1;
+	}
+
+	ks = dect_zalloc(dh, sizeof(*ks));
+	if (ks == NULL)
+		goto err1;
+
+	if (path != NULL) {
+		fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+		if (fd < 0)
+			goto err2;
+		if (fstat(fd, &st) < 0)
+			goto err3;
+		ks->file = true;
+	}
+
+	if (st.st_size == 0) {
+		ks->size = DECT_KEYSTORE_HDR_SIZE +
+			   (size_t)size * sizeof(struct dect_keystore_rec);
+		if (ks->file && ftruncate(fd, ks->size) < 0)
+			goto err3;
+	} else
+		ks->size = st.st_size;
+
+	if (ks->size < DECT_KEYSTORE_HDR_SIZE) {
+		errno = EINVAL;
+		goto err3;
+	}
+
+	if (ks->file)
+		ks->map = mmap(NULL, ks->size, PROT_READ | PROT_WRITE,
+			       MAP_SHARED, fd, 0);
+	else
+		ks->map = mmap(NULL, ks->size, PROT_READ | PROT_WRITE,
+			       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ks->map == MAP_FAILED)
+		goto err3;
+
+	hdr = ks->map;
+	if (st.st_size == 0) {
+		hdr->version  = DECT_KEYSTORE_VERSION;
+		hdr->bits     = __builtin_ctz(size);
+		hdr->rec_size = sizeof(struct dect_keystore_rec);
+		__atomic_store_n(&hdr->magic, DECT_KEYSTORE_MAGIC, __ATOMIC_RELEASE);
+		if (ks->file && msync(ks->map, DECT_KEYSTORE_HDR_SIZE, MS_SYNC) < 0)
+			goto err4;
+	}
+
+	if (hdr->magic != DECT_KEYSTORE_MAGIC ||
+	    hdr->version != DECT_KEYSTORE_VERSION ||
+	    hdr->rec_size != sizeof(struct dect_keystore_rec) ||
+	    hdr->bits == 0 || hdr->bits >= 32 ||
+	    ks->size != DECT_KEYSTORE_HDR_SIZE +
+			((size_t)1 << hdr->bits) * sizeof(struct dect_keystore_rec)) {
+		errno = EINVAL;
+		goto err4;
+	}
+	ks->bits = hdr->bits;
+	ks->mask = (1U << hdr->bits) - 1;
+	ks->recs = ks->map + DECT_KEYSTORE_HDR_SIZE;
+
+	if (fd >= 0)
+		close(fd);
+
+	dect_keystore_check(ks);
+	dh->keystore = ks;
+	return 0;
+
+err4:
+	munmap(ks->map, ks->size);
+err3:
+	if (fd >= 0)
+		close(fd);
+err2:
+	dect_free(dh, ks);
+err1:
+	ks_debug("dect_keystore_open: %s\n", strerror(errno));
+	return -1;
+}
+EXPORT_SYMBOL(dect_keystore_open);
+
+/**
+ * Write the changes of a key store to disk
+ *
+ * @param dh		libdect DECT handle
+ *
+ * Changes are written back to the file by the kernel in the background, this
+ * function only needs to be used to survive system crashes.
+ *
+ * @return 0 on success or -1 on error.
+ */
+int dect_keystore_sync(struct dect_handle *dh)
+{
+	struct dect_keystore *ks = dh->keystore;
+	long pagesize = sysconf(_SC_PAGESIZE);
+	uintptr_t start, end;
+
+	if (ks == NULL || ks->dirty_lo >= ks->dirty_hi)
+		return 0;
+
+	if (ks->file) {
+		start = (uintptr_t)&ks->recs[ks->dirty_lo] & ~(pagesize - 1);
+		end   = (uintptr_t)&ks->recs[ks->dirty_hi];
+		if (msync((void *)start, end - start, MS_SYNC) < 0)
+			return -1;
+	}
+
+	ks->dirty_lo = ks->dirty_hi = 0;
+	return 0;
+}
+EXPORT_SYMBOL(dect_keystore_sync);
+
+/**
+ * Close the key store of a handle
+ *
+ * @param dh		libdect DECT handle
+ *
+ * Called by dect_close_handle(). Keys kept in memory only are cleared.
+ */
+void dect_keystore_close(struct dect_handle *dh)
+{
+	struct dect_keystore *ks = dh->keystore;
+
+	if (ks == NULL)
+		return;
+
+	if (ks->file)
+		dect_keystore_sync(dh);
+	else
+		memset(ks->map, 0, ks->size);
+	munmap(ks->map, ks->size);
+	dect_free(dh, ks);
+	dh->keystore = NULL;
+}
+EXPORT_SYMBOL(dect_keystore_close);
+
+/** @} */
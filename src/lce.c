@@ -24,6 +24,7 @@
 #include <sys/socket.h>
 #include <linux/byteorder/little_endian.h>
 #include <linux/dect.h>
+#include <linux/filter.h>
 #include <asm/byteorder.h>
 
 #include <libdect.h>
@@ -35,9 +36,15 @@
 #include <b_fmt.h>
 #include <clms.h>
 #include <lce.h>
+#include <pp_table.h>
 #include <cc.h>
 #include <mm.h>
 #include <ss.h>
+#include <trace.h>
+#include <record.h>
+#include <shard.h>
+#include <ind.h>
+#include <ldb.h>
 #include <dect/auth.h>
 
 static DECT_SFMT_MSG_DESC(lce_page_response,
@@ -57,39 +64,201 @@ static DECT_SFMT_MSG_DESC(lce_page_reject,
 	DECT_SFMT_IE_END_MSG
 );
 
-static const struct dect_nwk_protocol *protocols[DECT_PD_MAX + 1];
+static const struct dect_nwk_protocol lce_protocol;
+
+/*
+ * NWK layer protocols by protocol discriminator. The table is immutable, so
+ * handles can be driven by different threads without synchronization.
+ * Protocols disabled at build time are unset, their messages are discarded.
+ */
+static const struct dect_nwk_protocol * const protocols[DECT_PD_MAX + 1] = {
+	[DECT_PD_LCE]		= &lce_protocol,
+#ifdef CONFIG_CC
+	[DECT_PD_CC]		= &dect_cc_protocol,
+#endif
+#ifdef CONFIG_SS
+	[DECT_PD_CISS]		= &dect_ciss_protocol,
+#endif
+#ifdef CONFIG_CLMS
+	[DECT_PD_CLMS]		= &dect_clms_protocol,
+#endif
+#ifdef CONFIG_MM
+	[DECT_PD_MM]		= &dect_mm_protocol,
+#endif
+};
 
 #define lce_debug(fmt, args...) \
 	dect_debug(DECT_DEBUG_LCE, "LCE: " fmt, ## args)
 
-void dect_lce_register_protocol(const struct dect_nwk_protocol *protocol)
+static struct dect_msg_buf *dect_mbuf_pool_get(const struct dect_handle *dh)
+{
+	struct dect_mbuf_pool *pool = dh->mbuf_pool;
+	struct dect_msg_buf *mb;
+
+	mb = pool->free_list;
+	if (mb != NULL) {
+		pool->free_list = mb->next;
+		pool->count--;
+		pool->hits++;
+		return mb;
+	}
+
+	pool->misses++;
+	return dect_malloc_type(dh, DECT_MEM_MBUF, sizeof(*mb));
+}
+
+static void dect_mbuf_pool_put(const struct dect_handle *dh,
+			       struct dect_msg_buf *mb)
+{
+	struct dect_mbuf_pool *pool = dh->mbuf_pool;
+
+	if (pool->count >= pool->high_water) {
+		dect_free(dh, mb);
+		return;
+	}
+
+	mb->next = pool->free_list;
+	pool->free_list = mb;
+	pool->count++;
+}
+
+static void dect_mbuf_pool_trim(const struct dect_handle *dh, unsigned int count)
+{
+	struct dect_mbuf_pool *pool = dh->mbuf_pool;
+	struct dect_msg_buf *mb;
+
+	while (pool->count > count) {
+		mb = pool->free_list;
+		pool->free_list = mb->next;
+		pool->count--;
+		dect_free(dh, mb);
+	}
+}
+
+static void dect_mbuf_pool_fill(const struct dect_handle *dh, unsigned int count)
 {
-	protocols[protocol->pd] = protocol;
-	lce_debug("registered protocol %u (%s)\n",
-		  protocol->pd, protocol->name);
+	struct dect_mbuf_pool *pool = dh->mbuf_pool;
+	struct dect_msg_buf *mb;
+
+	while (pool->count < count) {
+		mb = dect_malloc_type(dh, DECT_MEM_MBUF, sizeof(*mb));
+		if (mb == NULL)
+			break;
+		mb->next = pool->free_list;
+		pool->free_list = mb;
+		pool->count++;
+	}
 }
 
 /**
- * Allocate a libdect message buffer
+ * Configure the message buffer pool limits
+ *
+ * @param dh		libdect DECT handle
+ * @param prefill	number of buffers to keep preallocated
+ * @param high_water	maximum number of free buffers kept in the pool
+ *
+ * Buffers released while the pool holds @high_water free buffers are
+ * returned to the allocator.
+ */
+int dect_mbuf_pool_set_limits(struct dect_handle *dh, unsigned int prefill,
+			      unsigned int high_water)
+{
+	struct dect_mbuf_pool *pool = dh->mbuf_pool;
+
+	if (prefill > high_water)
+		return -1;
+
+	pool->prefill	 = prefill;
+	pool->high_water = high_water;
+	dect_mbuf_pool_trim(dh, high_water);
+	dect_mbuf_pool_fill(dh, prefill);
+	return 0;
+}
+EXPORT_SYMBOL(dect_mbuf_pool_set_limits);
+
+/**
+ * Get message buffer pool statistics
+ *
+ * @param dh		libdect DECT handle
+ * @param stats		statistics buffer
+ */
+void dect_mbuf_pool_get_stats(const struct dect_handle *dh,
+			      struct dect_mbuf_pool_stats *stats)
+{
+	const struct dect_mbuf_pool *pool = dh->mbuf_pool;
+
+	stats->hits	  = pool->hits;
+	stats->misses	  = pool->misses;
+	stats->free	  = pool->count;
+	stats->prefill	  = pool->prefill;
+	stats->high_water = pool->high_water;
+}
+EXPORT_SYMBOL(dect_mbuf_pool_get_stats);
+
+static int dect_mbuf_pool_init(struct dect_handle *dh)
+{
+	struct dect_mbuf_pool *pool;
+
+	pool = dect_zalloc(dh, sizeof(*pool));
+	if (pool == NULL)
+		return -1;
+	pool->prefill	 = DECT_MBUF_POOL_PREFILL;
+	pool->high_water = DECT_MBUF_POOL_HIGH_WATER;
+	dh->mbuf_pool	 = pool;
+
+	dect_mbuf_pool_fill(dh, pool->prefill);
+	return 0;
+}
+
+static void dect_mbuf_pool_exit(struct dect_handle *dh)
+{
+	dect_mbuf_pool_trim(dh, 0);
+	dect_free(dh, dh->mbuf_pool);
+	dh->mbuf_pool = NULL;
+}
+
+/**
+ * Allocate a libdect message buffer without clearing the data area
  *
  * @param dh	libdect DECT handle
  *
- * Allocate a libdect message buffer. The buffer needs to be released again
- * using dect_mbuf_free().
+ * Allocate a libdect message buffer for callers which overwrite the data
+ * area, like receive paths. The contents of the head area are undefined.
+ * The buffer needs to be released again using dect_mbuf_free().
  */
-struct dect_msg_buf *dect_mbuf_alloc(const struct dect_handle *dh)
+struct dect_msg_buf *dect_mbuf_alloc_raw(const struct dect_handle *dh)
 {
 	struct dect_msg_buf *mb;
 
-	mb = dect_malloc(dh, sizeof(*mb));
+	mb = dect_mbuf_pool_get(dh);
 	if (mb == NULL)
 		return NULL;
-	memset(mb->head, 0, sizeof(mb->head));
 	mb->data   = mb->head;
 	mb->len    = 0;
 	mb->type   = 0;
 	mb->refcnt = 1;
 	mb->next   = NULL;
+	mb->frag   = NULL;
+	return mb;
+}
+EXPORT_SYMBOL(dect_mbuf_alloc_raw);
+
+/**
+ * Allocate a libdect message buffer
+ *
+ * @param dh	libdect DECT handle
+ *
+ * Allocate a libdect message buffer. The buffer needs to be released again
+ * using dect_mbuf_free().
+ */
+struct dect_msg_buf *dect_mbuf_alloc(const struct dect_handle *dh)
+{
+	struct dect_msg_buf *mb;
+
+	mb = dect_mbuf_alloc_raw(dh);
+	if (mb == NULL)
+		return NULL;
+	memset(mb->head, 0, sizeof(mb->head));
 	return mb;
 }
 EXPORT_SYMBOL(dect_mbuf_alloc);
@@ -101,16 +270,141 @@ EXPORT_SYMBOL(dect_mbuf_alloc);
  * @param mb	libdect message buffer
  *
  * Release reference to a libdect message buffer. When the reference count
- * drops to zero, the buffer will be freed.
+ * drops to zero, the buffer and the references to its fragments are returned
+ * to the message buffer pool.
  */
 void dect_mbuf_free(const struct dect_handle *dh, struct dect_msg_buf *mb)
 {
 	if (--mb->refcnt > 0)
 		return;
-	dect_free(dh, mb);
+	dect_mbuf_free_frags(dh, mb);
+	dect_mbuf_pool_put(dh, mb);
 }
 EXPORT_SYMBOL(dect_mbuf_free);
 
+/**
+ * Append a fragment to a libdect message buffer
+ *
+ * @param mb	libdect message buffer
+ * @param frag	libdect message buffer containing the fragment
+ *
+ * Append a fragment to the end of the buffer chain of a libdect message
+ * buffer. The reference to the fragment is transferred to the chain.
+ */
+void dect_mbuf_add_frag(struct dect_msg_buf *mb, struct dect_msg_buf *frag)
+{
+	unsigned int n = 1;
+
+	while (mb->frag != NULL) {
+		mb = mb->frag;
+		n++;
+	}
+	dect_assert(n < DECT_MBUF_IOV_MAX);
+	mb->frag = frag;
+}
+EXPORT_SYMBOL(dect_mbuf_add_frag);
+
+/**
+ * Release the fragments of a libdect message buffer
+ *
+ * @param dh	libdect DECT handle
+ * @param mb	libdect message buffer
+ *
+ * Release the references to all fragments chained to a libdect message
+ * buffer, for example when the head is allocated on the stack.
+ */
+void dect_mbuf_free_frags(const struct dect_handle *dh, struct dect_msg_buf *mb)
+{
+	struct dect_msg_buf *frag;
+
+	while ((frag = mb->frag) != NULL) {
+		mb->frag   = frag->frag;
+		frag->frag = NULL;
+		dect_mbuf_free(dh, frag);
+	}
+}
+EXPORT_SYMBOL(dect_mbuf_free_frags);
+
+/**
+ * Return the total data length of a libdect message buffer chain
+ *
+ * @param mb	libdect message buffer
+ */
+unsigned int dect_mbuf_chain_len(const struct dect_msg_buf *mb)
+{
+	unsigned int len = 0;
+
+	for (; mb != NULL; mb = mb->frag)
+		len += mb->len;
+	return len;
+}
+EXPORT_SYMBOL(dect_mbuf_chain_len);
+
+/* Fill an iovec array describing the data of a buffer chain */
+unsigned int dect_mbuf_fill_iov(struct iovec *iov, const struct dect_msg_buf *mb)
+{
+	unsigned int n;
+
+	for (n = 0; mb != NULL; mb = mb->frag, n++) {
+		dect_assert(n < DECT_MBUF_IOV_MAX);
+		iov[n].iov_base = mb->data;
+		iov[n].iov_len  = mb->len;
+	}
+	return n;
+}
+
+/*
+ * Chain up to @nfrags empty fragments for receiving data exceeding the head
+ * area of @mb and fill @iov. Returns the number of iovec entries.
+ */
+unsigned int dect_mbuf_rcv_prepare(const struct dect_handle *dh,
+				   struct iovec *iov, struct dect_msg_buf *mb,
+				   unsigned int nfrags)
+{
+	struct dect_msg_buf *frag, *prev = mb;
+	unsigned int n = 1;
+
+	dect_assert(mb->frag == NULL && nfrags < DECT_MBUF_IOV_MAX);
+	iov[0].iov_base = mb->data;
+	iov[0].iov_len  = mb->head + sizeof(mb->head) - mb->data;
+
+	while (n <= nfrags) {
+		frag = dect_mbuf_alloc_raw(dh);
+		if (frag == NULL)
+			break;
+		prev->frag = frag;
+		prev = frag;
+
+		iov[n].iov_base = frag->data;
+		iov[n].iov_len  = sizeof(frag->head);
+		n++;
+	}
+	return n;
+}
+
+/*
+ * Distribute the received length over the buffer chain and release the
+ * fragments which did not receive any data.
+ */
+void dect_mbuf_rcv_complete(const struct dect_handle *dh,
+			    struct dect_msg_buf *mb, size_t len)
+{
+	struct dect_msg_buf *last = NULL;
+	size_t size;
+
+	for (; mb != NULL; mb = mb->frag) {
+		size = mb->head + sizeof(mb->head) - mb->data;
+		mb->len = min(len, size);
+		len -= mb->len;
+		if (len == 0) {
+			last = mb;
+			break;
+		}
+	}
+	if (last != NULL)
+		dect_mbuf_free_frags(dh, last);
+}
+
 /**
  * Pull data from the head of a libdect message buffer
  *
@@ -169,7 +463,7 @@ void *dect_mbuf_put(struct dect_msg_buf *mb, unsigned int len)
 EXPORT_SYMBOL(dect_mbuf_put);
 
 static ssize_t dect_mbuf_rcv(const struct dect_fd *dfd, struct msghdr *msg,
-			     struct dect_msg_buf *mb)
+			     struct dect_msg_buf *mb, int flags)
 {
 	struct iovec iov;
 	ssize_t len;
@@ -183,12 +477,21 @@ static ssize_t dect_mbuf_rcv(const struct dect_fd *dfd, struct msghdr *msg,
 	iov.iov_base		= mb->data;
 	iov.iov_len		= sizeof(mb->head);
 
-	len = recvmsg(dfd->fd, msg, 0);
+	len = dect_fd_recvmsg(dfd, msg, flags);
 	if (len < 0) {
-		lce_debug("recvmsg: %s\n", strerror(errno));
+		if (errno != EAGAIN)
+			lce_debug("recvmsg: %s\n", strerror(errno));
 		return len;
 	}
 
+	/* S-Format messages are parsed from the linear head area only */
+	if (msg->msg_flags & MSG_TRUNC) {
+		lce_debug("recvmsg: message exceeds %zu bytes\n",
+			  sizeof(mb->head));
+		errno = EMSGSIZE;
+		return -1;
+	}
+
 	mb->len = len;
 	return len;
 }
@@ -197,44 +500,79 @@ static ssize_t dect_mbuf_send(const struct dect_handle *dh,
 			      const struct dect_fd *dfd,
 			      struct msghdr *msg, const struct dect_msg_buf *mb)
 {
-	struct iovec iov;
+	struct iovec iov[DECT_MBUF_IOV_MAX];
 	ssize_t len;
 
 	msg->msg_name		= NULL;
 	msg->msg_namelen	= 0;
-	msg->msg_iov		= &iov;
-	msg->msg_iovlen		= 1;
+	msg->msg_iov		= iov;
+	msg->msg_iovlen		= dect_mbuf_fill_iov(iov, mb);
 	msg->msg_flags		|= MSG_NOSIGNAL;
 
-	iov.iov_base		= mb->data;
-	iov.iov_len		= mb->len;
-
-	len = sendmsg(dfd->fd, msg, 0);
+	len = dect_fd_sendmsg(dfd, msg, 0);
 	if (len < 0)
-		lce_debug("sendmsg: %u bytes: %s\n", mb->len, strerror(errno));
+		lce_debug("sendmsg: %u bytes: %s\n", dect_mbuf_chain_len(mb),
+			  strerror(errno));
 
 	return len;
 }
 
 /*
  * Location Table
+ *
+ * The capability IEs of the entries are interned, entries of PPs with the
+ * same capabilities share one instance. When interning fails, the previous
+ * IE is kept.
  */
 
-#define dect_ie_update(pos, ie)			\
-	do {					\
-		if (ie == NULL)			\
-			break;			\
-		dect_ie_put(dh, pos);		\
-		pos = dect_ie_hold(ie);		\
+#define dect_ie_update(pos, ie)				\
+	do {						\
+		typeof(pos) __ie;			\
+							\
+		if (ie == NULL)				\
+			break;				\
+		__ie = dect_ie_intern(dh, ie);		\
+		if (__ie == NULL)			\
+			break;				\
+		dect_ie_put(dh, pos);			\
+		pos = __ie;				\
 	} while (0)
 
+static unsigned int dect_ldb_ipui_hash(uint64_t key)
+{
+	return hash_64(key, DECT_LDB_HASH_BITS);
+}
+
+static unsigned int dect_ldb_tpui_hash(const struct dect_tpui *tpui)
+{
+	return hash_64(dect_build_tpui(tpui), DECT_LDB_HASH_BITS);
+}
+
 static struct dect_lte *dect_lte_get_by_ipui(const struct dect_handle *dh,
 					     const struct dect_ipui *ipui)
 {
+	uint64_t key = dect_ipui_key(ipui);
+	struct hlist_node *pos;
+	struct dect_lte *lte;
+
+	hlist_for_each_entry(lte, pos, &dh->ldb_ipui_hash[dect_ldb_ipui_hash(key)],
+			     ipui_node) {
+		if (dect_ipui_key_eq(lte->ipui_key, &lte->ipui, key, ipui))
+			return lte;
+	}
+	return NULL;
+}
+
+struct dect_lte *dect_lte_get_by_tpui(const struct dect_handle *dh,
+				      const struct dect_tpui *tpui)
+{
+	uint32_t t = dect_build_tpui(tpui);
+	struct hlist_node *pos;
 	struct dect_lte *lte;
 
-	list_for_each_entry(lte, &dh->ldb, list) {
-		if (!dect_ipui_cmp(&lte->ipui, ipui))
+	hlist_for_each_entry(lte, pos, &dh->ldb_tpui_hash[dect_ldb_tpui_hash(tpui)],
+			     tpui_node) {
+		if (dect_build_tpui(&lte->tpui) == t)
 			return lte;
 	}
 	return NULL;
@@ -245,21 +583,36 @@ static struct dect_lte *dect_lte_alloc(struct dect_handle *dh,
 {
 	struct dect_lte *lte;
 
-	lte = dect_malloc(dh, sizeof(*lte));
+	lte = dect_malloc_type(dh, DECT_MEM_LTE, sizeof(*lte));
 	if (lte == NULL)
 		return NULL;
 	memset(lte, 0, sizeof(*lte));
-	lte->ipui = *ipui;
+	lte->ipui     = *ipui;
+	lte->ipui_key = dect_ipui_key(ipui);
 
 	list_add_tail(&lte->list, &dh->ldb);
+	hlist_add_head(&lte->ipui_node,
+		       &dh->ldb_ipui_hash[dect_ldb_ipui_hash(lte->ipui_key)]);
 	return lte;
 }
 
+static void dect_lte_invalidate_tpui(struct dect_lte *lte)
+{
+	lte->page.valid = false;
+	if (!lte->tpui_valid)
+		return;
+	hlist_del(&lte->tpui_node);
+	lte->tpui_valid = false;
+}
+
 static void dect_lte_release(struct dect_handle *dh, struct dect_lte *lte)
 {
 	dect_ie_put(dh, lte->setup_capability);
 	dect_ie_put(dh, lte->terminal_capability);
+	dect_lte_invalidate_tpui(lte);
+	hlist_del(&lte->ipui_node);
 	list_del(&lte->list);
+	memset(lte->dck, 0, sizeof(lte->dck));
 	dect_free(dh, lte);
 }
 
@@ -278,30 +631,176 @@ void dect_lte_update(struct dect_handle *dh, const struct dect_ipui *ipui,
 
 	dect_ie_update(lte->setup_capability, setup_capability);
 	dect_ie_update(lte->terminal_capability, terminal_capability);
+	lte->page.valid = false;
+	dect_ldb_update(dh, lte);
+}
+
+/**
+ * dect_lte_update_dck - store or invalidate the derived cipher key of a PT
+ *
+ * @dh:		libdect DECT handle
+ * @ipui:	International Portable User ID
+ * @dck:	derived cipher key or NULL to invalidate
+ * @num:	cipher key number the PT stored the key under
+ */
+void dect_lte_update_dck(struct dect_handle *dh, const struct dect_ipui *ipui,
+			 const uint8_t *dck, uint8_t num)
+{
+	struct dect_lte *lte;
+
+	lte = dect_lte_get_by_ipui(dh, ipui);
+	if (lte == NULL)
+		return;
+
+	if (dck != NULL) {
+		memcpy(lte->dck, dck, sizeof(lte->dck));
+		lte->dck_num  = num;
+		lte->dck_time = dect_timer_now();
+	} else {
+		memset(lte->dck, 0, sizeof(lte->dck));
+		lte->dck_time = 0;
+	}
 }
 
-void dect_lte_update_tpui(const struct dect_handle *dh,
+/**
+ * dect_lte_get_dck - get a derived cipher key of a PT
+ *
+ * @dh:		libdect DECT handle
+ * @ipui:	International Portable User ID
+ * @num:	cipher key number
+ * @lifetime:	maximum age of the key in seconds
+ * @dck:	result buffer
+ */
+bool dect_lte_get_dck(const struct dect_handle *dh,
+		      const struct dect_ipui *ipui, uint8_t num,
+		      unsigned int lifetime, uint8_t *dck)
+{
+	const struct dect_lte *lte;
+
+	lte = dect_lte_get_by_ipui(dh, ipui);
+	if (lte == NULL || lte->dck_time == 0 || lte->dck_num != num ||
+	    dect_timer_now() - lte->dck_time >= lifetime * 1000ULL)
+		return false;
+
+	memcpy(dck, lte->dck, sizeof(lte->dck));
+	return true;
+}
+
+void dect_lte_update_tpui(struct dect_handle *dh,
 			  const struct dect_ipui *ipui,
 			  const struct dect_tpui *tpui)
 {
-	struct dect_lte *lte;
+	struct dect_lte *lte, *old;
 
 	lte = dect_lte_get_by_ipui(dh, ipui);
 	if (lte == NULL)
 		return;
+
+	/* An assigned TPUI identifies a single PP, remove it from a previous
+	 * owner. */
+	old = dect_lte_get_by_tpui(dh, tpui);
+	if (old != NULL && old != lte) {
+		dect_lte_invalidate_tpui(old);
+		dect_ldb_update(dh, old);
+	}
+	dect_lte_invalidate_tpui(lte);
+
 	lte->tpui	= *tpui;
 	lte->tpui_valid = true;
+	hlist_add_head(&lte->tpui_node, &dh->ldb_tpui_hash[dect_ldb_tpui_hash(tpui)]);
+	dect_ldb_update(dh, lte);
 }
 
-static const struct dect_tpui *dect_tpui(const struct dect_handle *dh,
-					 const struct dect_ipui *ipui)
+void dect_lte_export(const struct dect_lte *lte, struct dect_lte_record *rec)
 {
-	const struct dect_lte *lte;
+	const struct dect_ie_setup_capability *sc = lte->setup_capability;
+	const struct dect_ie_terminal_capability *tc = lte->terminal_capability;
+
+	memset(rec, 0, sizeof(*rec));
+	rec->ipui = lte->ipui;
+	if (lte->tpui_valid) {
+		rec->tpui   = lte->tpui;
+		rec->flags |= DECT_LTE_RECORD_TPUI;
+	}
+	if (sc != NULL) {
+		rec->setup.page_capability  = sc->page_capability;
+		rec->setup.setup_capability = sc->setup_capability;
+		rec->flags |= DECT_LTE_RECORD_SETUP_CAP;
+	}
+	if (tc != NULL) {
+		rec->terminal.tone		= tc->tone;
+		rec->terminal.echo		= tc->echo;
+		rec->terminal.noise_rejection	= tc->noise_rejection;
+		rec->terminal.volume_ctrl	= tc->volume_ctrl;
+		rec->terminal.slot		= tc->slot;
+		rec->terminal.display		= tc->display;
+		rec->terminal.display_lines	= tc->display_lines;
+		rec->terminal.display_columns	= tc->display_columns;
+		rec->terminal.display_memory	= tc->display_memory;
+		rec->terminal.display_control	= tc->display_control;
+		rec->terminal.display_charsets	= tc->display_charsets;
+		rec->terminal.scrolling		= tc->scrolling;
+		rec->terminal.profile_indicator	= tc->profile_indicator;
+		rec->flags |= DECT_LTE_RECORD_TERMINAL_CAP;
+	}
+}
 
-	lte = dect_lte_get_by_ipui(dh, ipui);
-	if (lte == NULL || !lte->tpui_valid)
-		return NULL;
-	return &lte->tpui;
+int dect_lte_import(struct dect_handle *dh, const struct dect_lte_record *rec)
+{
+	struct dect_ie_setup_capability *sc = NULL;
+	struct dect_ie_terminal_capability *tc = NULL;
+	struct dect_lte *lte;
+
+	if (rec->flags & DECT_LTE_RECORD_SETUP_CAP) {
+		sc = (void *)dect_ie_alloc(dh, sizeof(*sc));
+		if (sc == NULL)
+			goto err1;
+		sc->page_capability  = rec->setup.page_capability;
+		sc->setup_capability = rec->setup.setup_capability;
+	}
+	if (rec->flags & DECT_LTE_RECORD_TERMINAL_CAP) {
+		tc = (void *)dect_ie_alloc(dh, sizeof(*tc));
+		if (tc == NULL)
+			goto err2;
+		tc->tone		= rec->terminal.tone;
+		tc->echo		= rec->terminal.echo;
+		tc->noise_rejection	= rec->terminal.noise_rejection;
+		tc->volume_ctrl		= rec->terminal.volume_ctrl;
+		tc->slot		= rec->terminal.slot;
+		tc->display		= rec->terminal.display;
+		tc->display_lines	= rec->terminal.display_lines;
+		tc->display_columns	= rec->terminal.display_columns;
+		tc->display_memory	= rec->terminal.display_memory;
+		tc->display_control	= rec->terminal.display_control;
+		tc->display_charsets	= rec->terminal.display_charsets;
+		tc->scrolling		= rec->terminal.scrolling;
+		tc->profile_indicator	= rec->terminal.profile_indicator;
+	}
+
+	lte = dect_lte_get_by_ipui(dh, &rec->ipui);
+	if (lte == NULL) {
+		lte = dect_lte_alloc(dh, &rec->ipui);
+		if (lte == NULL)
+			goto err3;
+	}
+	dect_ie_update(lte->setup_capability, sc);
+	dect_ie_update(lte->terminal_capability, tc);
+	lte->page.valid = false;
+	if (rec->flags & DECT_LTE_RECORD_TPUI)
+		dect_lte_update_tpui(dh, &rec->ipui, &rec->tpui);
+	else
+		dect_ldb_update(dh, lte);
+
+	dect_ie_put(dh, tc);
+	dect_ie_put(dh, sc);
+	return 0;
+
+err3:
+	dect_ie_put(dh, tc);
+err2:
+	dect_ie_put(dh, sc);
+err1:
+	return -1;
 }
 
 static enum dect_setup_capabilities
@@ -371,6 +870,34 @@ static const struct dect_trans_tbl dect_service_types[] = {
 	TRANS_TBL(DECT_SERVICE_IPQ_ERROR_DETECTION,	"Ipq_error_detection"),
 };
 
+static unsigned int dect_link_ipui_hash(uint64_t key)
+{
+	return hash_64(key, DECT_LINK_HASH_BITS);
+}
+
+static unsigned int dect_link_dlei_hash(const struct sockaddr_dect_ssap *dlei)
+{
+	uint64_t key;
+
+	key  = (uint64_t)dlei->dect_pmid;
+	key |= (uint64_t)dlei->dect_lcn  << 20;
+	key |= (uint64_t)dlei->dect_lln  << 24;
+	key |= (uint64_t)dlei->dect_sapi << 28;
+	key |= (uint64_t)dlei->dect_ari  << 32;
+	return hash_64(key, DECT_LINK_HASH_BITS);
+}
+
+static bool dect_dlei_cmp(const struct sockaddr_dect_ssap *d1,
+			  const struct sockaddr_dect_ssap *d2)
+{
+	return d1->dect_index != d2->dect_index ||
+	       d1->dect_ari   != d2->dect_ari   ||
+	       d1->dect_pmid  != d2->dect_pmid  ||
+	       d1->dect_lcn   != d2->dect_lcn   ||
+	       d1->dect_lln   != d2->dect_lln   ||
+	       d1->dect_sapi  != d2->dect_sapi;
+}
+
 int dect_ddl_set_ipui(struct dect_handle *dh, struct dect_data_link *ddl,
 		      const struct dect_ipui *ipui)
 {
@@ -381,8 +908,11 @@ int dect_ddl_set_ipui(struct dect_handle *dh, struct dect_data_link *ddl,
 		ddl_debug(ddl, "set IPUI: N EMC: %04x PSN: %05x",
 			  ipui->pun.n.ipei.emc, ipui->pun.n.ipei.psn);
 
-		ddl->ipui   = *ipui;
-		ddl->flags |= DECT_DATA_LINK_IPUI_VALID;
+		ddl->ipui     = *ipui;
+		ddl->ipui_key = dect_ipui_key(ipui);
+		ddl->flags   |= DECT_DATA_LINK_IPUI_VALID;
+		hlist_add_head(&ddl->ipui_node,
+			       &dh->link_ipui_hash[dect_link_ipui_hash(ddl->ipui_key)]);
 	}
 	return 0;
 }
@@ -390,83 +920,246 @@ int dect_ddl_set_ipui(struct dect_handle *dh, struct dect_data_link *ddl,
 static struct dect_data_link *dect_ddl_get_by_ipui(const struct dect_handle *dh,
 						   const struct dect_ipui *ipui)
 {
+	uint64_t key = dect_ipui_key(ipui);
 	struct dect_data_link *ddl;
+	struct hlist_node *pos;
 
-	list_for_each_entry(ddl, &dh->links, list) {
-		if (ddl->flags & DECT_DATA_LINK_IPUI_VALID &&
-		    !dect_ipui_cmp(&ddl->ipui, ipui))
+	hlist_for_each_entry(ddl, pos, &dh->link_ipui_hash[dect_link_ipui_hash(key)],
+			     ipui_node) {
+		if (dect_ipui_key_eq(ddl->ipui_key, &ddl->ipui, key, ipui))
 			return ddl;
 	}
 	return NULL;
 }
 
-static struct dect_transaction *
-dect_ddl_transaction_lookup(const struct dect_data_link *ddl, uint8_t pd,
-			    uint8_t tv, enum dect_transaction_role role)
+struct dect_data_link *dect_ddl_get_by_dlei(const struct dect_handle *dh,
+					    const struct sockaddr_dect_ssap *dlei)
 {
-	struct dect_transaction *ta;
+	struct dect_data_link *ddl;
+	struct hlist_node *pos;
 
-	list_for_each_entry(ta, &ddl->transactions, list) {
-		if (ta->pd == pd && ta->tv == tv && ta->role == role)
-			return ta;
+	hlist_for_each_entry(ddl, pos, &dh->link_dlei_hash[dect_link_dlei_hash(dlei)],
+			     dlei_node) {
+		if (!dect_dlei_cmp(&ddl->dlei, dlei))
+			return ddl;
 	}
 	return NULL;
 }
 
-static struct dect_data_link *dect_ddl_alloc(const struct dect_handle *dh)
+static void dect_ddl_link(struct dect_handle *dh, struct dect_data_link *ddl)
 {
-	struct dect_data_link *ddl;
-
-	ddl = dect_zalloc(dh, sizeof(*ddl));
-	if (ddl == NULL)
-		goto err1;
-	ddl->sdu_timer = dect_timer_alloc(dh);
-	if (ddl->sdu_timer == NULL)
-		goto err2;
-	ddl->state = DECT_DATA_LINK_RELEASED;
-	init_list_head(&ddl->list);
-	init_list_head(&ddl->transactions);
-	ptrlist_init(&ddl->msg_queue);
-	ddl_debug(ddl, "alloc");
-	return ddl;
+	list_add_tail(&ddl->list, &dh->links);
+	hlist_add_head(&ddl->dlei_node,
+		       &dh->link_dlei_hash[dect_link_dlei_hash(&ddl->dlei)]);
+}
 
-err2:
-	dect_free(dh, ddl);
-err1:
-	return NULL;
+static void dect_ddl_unlink(struct dect_data_link *ddl)
+{
+	if (ddl->flags & DECT_DATA_LINK_IPUI_VALID)
+		hlist_del(&ddl->ipui_node);
+	if (!hlist_unhashed(&ddl->dlei_node))
+		hlist_del(&ddl->dlei_node);
+	list_del(&ddl->list);
 }
 
-static void dect_ddl_destroy(struct dect_handle *dh, struct dect_data_link *ddl)
+static struct dect_transaction *
+dect_ddl_transaction_lookup(const struct dect_data_link *ddl, uint8_t pd,
+			    uint8_t tv, enum dect_transaction_role role)
 {
-	struct dect_msg_buf *mb;
-	unsigned int i;
+	return ddl->ta_table[pd][role][tv];
+}
+
+static void dect_ddl_transaction_insert(struct dect_data_link *ddl,
+					struct dect_transaction *ta)
+{
+	dect_assert(ddl->ta_table[ta->pd][ta->role][ta->tv] == NULL);
+	ddl->ta_table[ta->pd][ta->role][ta->tv] = ta;
+	ddl->ta_map[ta->pd][ta->role] |= 1 << ta->tv;
+}
+
+static void dect_ddl_transaction_remove(struct dect_data_link *ddl,
+					struct dect_transaction *ta)
+{
+	ddl->ta_table[ta->pd][ta->role][ta->tv] = NULL;
+	ddl->ta_map[ta->pd][ta->role] &= ~(1 << ta->tv);
+}
+
+static void dect_ddl_release_timer(struct dect_handle *dh, struct dect_timer *timer);
+static void dect_ddl_page_timer(struct dect_handle *dh, struct dect_timer *timer);
+static void dect_ddl_linger_timer(struct dect_handle *dh, struct dect_timer *timer);
+static void dect_ddl_linger_stop(struct dect_handle *dh,
+				 struct dect_data_link *ddl);
+static void dect_lce_group_page_unlink(struct dect_handle *dh,
+				       struct dect_data_link *ddl);
+static void dect_lce_group_page_complete(struct dect_handle *dh,
+					 struct dect_data_link *req);
+static void dect_ddl_admit(struct dect_handle *dh, struct dect_data_link *ddl);
+static void dect_lce_send_identity(struct dect_handle *dh,
+				   struct dect_data_link *ddl);
+
+static size_t dect_ddl_size(const struct dect_handle *dh)
+{
+	return align(sizeof(struct dect_data_link), __alignof__(uint64_t)) +
+	       DECT_DDL_TIMER_MAX * dect_timer_size(dh);
+}
+
+/*
+ * Data links are recycled through the object cache, so bursts of incoming
+ * links don't hit the allocator for each link.
+ */
+static struct dect_data_link *dect_ddl_alloc(struct dect_handle *dh)
+{
+	struct dect_data_link *ddl;
+	void *timers;
+
+	ddl = dect_cache_alloc(dh, DECT_MEM_LINK, dect_ddl_size(dh));
+	if (ddl == NULL)
+		return NULL;
+	timers = (void *)ddl + align(sizeof(*ddl), __alignof__(uint64_t));
+
+	/* The SDU timer callback depends on the link state and is set up
+	 * when starting the timer. */
+	ddl->sdu_timer	   = dect_timer_embed(dh, timers, 0, NULL, ddl);
+	ddl->release_timer = dect_timer_embed(dh, timers, 1,
+					      dect_ddl_release_timer, ddl);
+	ddl->page_timer	   = dect_timer_embed(dh, timers, 2,
+					      dect_ddl_page_timer, ddl);
+	ddl->linger_timer  = dect_timer_embed(dh, timers, 3,
+					      dect_ddl_linger_timer, ddl);
+	dect_timer_set_slack_class(ddl->release_timer, DECT_TIMER_SLACK_COARSE);
+	dect_timer_set_slack_class(ddl->linger_timer, DECT_TIMER_SLACK_COARSE);
+
+	ddl->state = DECT_DATA_LINK_RELEASED;
+	memcpy(ddl->rtt, dh->rtt, sizeof(ddl->rtt));
+	init_list_head(&ddl->list);
+	init_list_head(&ddl->transactions);
+	ptrqueue_init(&ddl->msg_queue);
+	ptrqueue_init(&ddl->tx_queue);
+	ddl_debug(ddl, "alloc");
+	return ddl;
+}
+
+static void dect_ddl_free(struct dect_handle *dh, struct dect_data_link *ddl)
+{
+	dect_cache_free(dh, ddl);
+}
+
+/*
+ * Adaptive timeouts
+ *
+ * The response times of pages and MM procedures are measured following
+ * RFC 6298, so lost requests are retransmitted once the response is overdue
+ * instead of after the fixed protocol timeouts, which remain the upper bound.
+ * Pages and MM procedures are estimated separately: a page response depends
+ * on the paging cycle of an idle PP, an MM response only on an established
+ * MAC connection. New links start with the estimates of the handle, which
+ * combine the samples of all links. Responses to retransmitted requests are
+ * ambiguous and not sampled.
+ */
+static void dect_rtt_update(struct dect_rtt *rtt, uint32_t sample)
+{
+	uint32_t delta;
+
+	if (rtt->srtt == 0) {
+		rtt->srtt   = max(sample, 1U);
+		rtt->rttvar = sample / 2;
+		return;
+	}
+
+	delta = rtt->srtt > sample ? rtt->srtt - sample : sample - rtt->srtt;
+	rtt->rttvar = rtt->rttvar - rtt->rttvar / 4 + delta / 4;
+	rtt->srtt   = max(rtt->srtt - rtt->srtt / 8 + sample / 8, 1U);
+}
+
+/**
+ * dect_ddl_rtt_sample - sample the round-trip time of a data link
+ *
+ * @dh:		libdect DECT handle
+ * @ddl:	data link
+ * @type:	estimator to update
+ * @start:	transmission time of the request, 0 if unknown
+ */
+void dect_ddl_rtt_sample(struct dect_handle *dh, struct dect_data_link *ddl,
+			 enum dect_rtt_types type, uint64_t start)
+{
+	uint32_t sample;
+
+	if (start == 0)
+		return;
+
+	sample = min(dect_stats_clock() - start, (uint64_t)UINT32_MAX);
+	dect_rtt_update(&ddl->rtt[type], sample);
+	dect_rtt_update(&dh->rtt[type], sample);
+}
+
+/**
+ * dect_ddl_rto - retransmission timeout of a data link in milliseconds
+ *
+ * @ddl:	data link
+ * @type:	estimator to use
+ * @limit:	protocol timeout in milliseconds, used without samples
+ */
+unsigned int dect_ddl_rto(const struct dect_data_link *ddl,
+			  enum dect_rtt_types type, unsigned int limit)
+{
+	const struct dect_rtt *rtt = &ddl->rtt[type];
+	uint64_t rto;
+
+	if (rtt->srtt == 0)
+		return limit;
+
+	rto = (rtt->srtt + 4 * (uint64_t)rtt->rttvar) / 1000;
+	return min(max((uint64_t)DECT_DDL_RTO_MIN, rto), (uint64_t)limit);
+}
+
+static void dect_ddl_destroy(struct dect_handle *dh, struct dect_data_link *ddl)
+{
+	struct dect_msg_buf *mb;
+	unsigned int i;
 
 	ddl_debug(ddl, "destroy");
 	dect_assert(list_empty(&ddl->transactions));
+	dect_ind_link_flush(dh, ddl);
+	dect_record(dh, ddl, DECT_RECORD_RELEASE, NULL);
+
+	if (ddl->group != NULL)
+		dect_lce_group_page_unlink(dh, ddl);
+	dect_ddl_linger_stop(dh, ddl);
+	dect_ddl_admit(dh, ddl);
+	if (ddl->flags & DECT_DATA_LINK_DETACHED)
+		list_del(&ddl->suspend_node);
 
 	for (i = 0; i < array_size(protocols); i++) {
 		if (protocols[i] && protocols[i]->rebind != NULL)
 			protocols[i]->rebind(dh, ddl, NULL);
 	}
 
-	list_del(&ddl->list);
+	dect_ddl_unlink(ddl);
 
-	while ((mb = ptrlist_dequeue_head(&ddl->msg_queue)))
+	while ((mb = ptrqueue_dequeue_head(&ddl->msg_queue)))
+		dect_mbuf_free(dh, mb);
+	while ((mb = ptrqueue_dequeue_head(&ddl->tx_queue)))
 		dect_mbuf_free(dh, mb);
 
 	if (ddl->dfd != NULL) {
 		dect_fd_unregister(dh, ddl->dfd);
 		dect_close(dh, ddl->dfd);
+		ddl->dfd = NULL;
 	}
 
-	if (dect_timer_running(ddl->sdu_timer))
+	if (dect_timer_pending(ddl->sdu_timer))
 		dect_timer_stop(dh, ddl->sdu_timer);
-	dect_timer_free(dh, ddl->sdu_timer);
-
-	if (ddl->release_timer != NULL && dect_timer_running(ddl->release_timer))
+	if (dect_timer_running(ddl->release_timer))
 		dect_timer_stop(dh, ddl->release_timer);
-	dect_timer_free(dh, ddl->release_timer);
-	dect_free(dh, ddl);
+	if (dect_timer_running(ddl->page_timer))
+		dect_timer_stop(dh, ddl->page_timer);
+
+	/* The receive loop frees the link once it has finished using it */
+	if (ddl->flags & DECT_DATA_LINK_RCV_ACTIVE) {
+		ddl->flags |= DECT_DATA_LINK_DESTROYED;
+		return;
+	}
+	dect_ddl_free(dh, ddl);
 }
 
 static void dect_ddl_release_timer(struct dect_handle *dh, struct dect_timer *timer)
@@ -486,27 +1179,31 @@ static void dect_ddl_release_complete(struct dect_handle *dh,
 	dect_ddl_destroy(dh, ddl);
 }
 
+static int dect_ddl_shutdown_tx(struct dect_handle *dh,
+				struct dect_data_link *ddl)
+{
+	if (shutdown(ddl->dfd->fd, SHUT_WR) < 0) {
+		dect_ddl_destroy(dh, ddl);
+		return -1;
+	}
+	return 0;
+}
+
 static void dect_ddl_release(struct dect_handle *dh,
 			     struct dect_data_link *ddl)
 {
 	ddl_debug(ddl, "normal release");
+	ddl->state = DECT_DATA_LINK_RELEASE_PENDING;
+	dect_timer_start(dh, ddl->release_timer, DECT_DDL_RELEASE_TIMEOUT);
 
 	/* Shut down transmission and wait until all outstanding frames
 	 * are successfully transmitted or the release timeout occurs.
+	 * Messages still waiting on the TX queue, including the release
+	 * message, are sent first, the write handler shuts down transmission
+	 * once the queue has been drained.
 	 */
-	if (shutdown(ddl->dfd->fd, SHUT_WR) < 0)
-		goto err1;
-	ddl->state = DECT_DATA_LINK_RELEASE_PENDING;
-
-	ddl->release_timer = dect_timer_alloc(dh);
-	if (ddl->release_timer == NULL)
-		goto err1;
-	dect_timer_setup(ddl->release_timer, dect_ddl_release_timer, ddl);
-	dect_timer_start(dh, ddl->release_timer, DECT_DDL_RELEASE_TIMEOUT);
-	return;
-
-err1:
-	dect_ddl_destroy(dh, ddl);
+	if (ptrqueue_empty(&ddl->tx_queue))
+		dect_ddl_shutdown_tx(dh, ddl);
 }
 
 static void dect_ddl_partial_release_timer(struct dect_handle *dh, struct dect_timer *timer)
@@ -526,12 +1223,147 @@ static void dect_ddl_partial_release(struct dect_handle *dh,
 	 * first message has been sent.
 	 */
 	if (dect_timer_running(ddl->sdu_timer))
-		dect_timer_stop(dh, ddl->sdu_timer);
+		dect_timer_cancel(dh, ddl->sdu_timer);
 
 	dect_timer_setup(ddl->sdu_timer, dect_ddl_partial_release_timer, ddl);
 	dect_timer_start(dh, ddl->sdu_timer, DECT_DDL_LINK_MAINTAIN_TIMEOUT);
 }
 
+/*
+ * Idle link linger: instead of releasing a data link once its last
+ * transaction is closed, keep it established for the configured linger time
+ * so a following procedure for the same PP can reuse it without paging and
+ * establishing a new link. The number of idle links is bounded, when the
+ * budget is exhausted the link idle the longest is released.
+ */
+static void dect_ddl_linger_stop(struct dect_handle *dh,
+				 struct dect_data_link *ddl)
+{
+	if (!(ddl->flags & DECT_DATA_LINK_LINGER))
+		return;
+
+	list_del(&ddl->linger_node);
+	ddl->flags &= ~DECT_DATA_LINK_LINGER;
+	dh->linger_stats.idle--;
+	if (dect_timer_running(ddl->linger_timer))
+		dect_timer_stop(dh, ddl->linger_timer);
+}
+
+static void dect_ddl_linger_timer(struct dect_handle *dh, struct dect_timer *timer)
+{
+	struct dect_data_link *ddl = timer->data;
+
+	ddl_debug(ddl, "linger timeout");
+	dect_ddl_linger_stop(dh, ddl);
+	dh->linger_stats.expired++;
+	if (list_empty(&ddl->transactions))
+		dect_ddl_release(dh, ddl);
+}
+
+static bool dect_ddl_linger(struct dect_handle *dh, struct dect_data_link *ddl)
+{
+	struct dect_data_link *old;
+
+	if (dh->linger_timeout == 0 || dh->linger_max == 0 ||
+	    ddl->state != DECT_DATA_LINK_ESTABLISHED)
+		return false;
+
+	if (dh->linger_stats.idle >= dh->linger_max) {
+		old = list_first_entry(&dh->linger_links, struct dect_data_link,
+				       linger_node);
+		ddl_debug(old, "linger budget exhausted");
+		dect_ddl_linger_stop(dh, old);
+		dh->linger_stats.evicted++;
+		dect_ddl_release(dh, old);
+	}
+
+	ddl_debug(ddl, "linger");
+	list_add_tail(&ddl->linger_node, &dh->linger_links);
+	ddl->flags |= DECT_DATA_LINK_LINGER;
+	dh->linger_stats.idle++;
+	dect_timer_start_ms(dh, ddl->linger_timer, dh->linger_timeout);
+	return true;
+}
+
+/**
+ * Configure idle data link linger
+ *
+ * @param dh		libdect DECT handle
+ * @param timeout	time in milliseconds to keep idle links open, 0 to disable
+ * @param max		maximum number of idle links
+ *
+ * Links released normally after the last transaction has been closed are
+ * kept open for @timeout milliseconds, so following transactions for the
+ * same PP can reuse them. Links already lingering keep their timeout.
+ */
+void dect_lce_set_link_linger(struct dect_handle *dh,
+			      unsigned int timeout, unsigned int max)
+{
+	dh->linger_timeout = timeout;
+	dh->linger_max	   = max;
+}
+EXPORT_SYMBOL(dect_lce_set_link_linger);
+
+/**
+ * Get idle data link statistics
+ *
+ * @param dh		libdect DECT handle
+ * @param stats		idle data link statistics
+ */
+void dect_lce_get_linger_stats(const struct dect_handle *dh,
+			       struct dect_lce_linger_stats *stats)
+{
+	*stats = dh->linger_stats;
+}
+EXPORT_SYMBOL(dect_lce_get_linger_stats);
+
+/* Dump a message or defer the dump to the link's history */
+static void dect_ddl_dump(struct dect_data_link *ddl,
+			  const struct dect_msg_buf *mb, bool tx)
+{
+	struct dect_ddl_history *h = &ddl->history;
+
+	if (!(dect_debug_flags & DECT_DEBUG_DEFER_DUMPS))
+		return dect_mbuf_dump(DECT_DEBUG_LCE, mb, tx ? "LCE: TX" : "LCE: RX");
+
+	h->msgs[h->next].tx  = tx;
+	h->msgs[h->next].len = mb->len;
+	memcpy(h->msgs[h->next].data, mb->data,
+	       min((unsigned int)mb->len, (unsigned int)DECT_DDL_HISTORY_DATA_SIZE));
+	h->next = (h->next + 1) % DECT_DDL_HISTORY_SIZE;
+}
+
+/**
+ * dect_ddl_dump_history - dump the last messages of a data link
+ *
+ * @param ddl		Datalink
+ *
+ * Dump the deferred message dumps of a link when an error occured, oldest
+ * first.
+ */
+void dect_ddl_dump_history(const struct dect_data_link *ddl)
+{
+	const struct dect_ddl_history *h = &ddl->history;
+	unsigned int i, n, len;
+
+	if (!dect_debug_enabled(DECT_DEBUG_LCE) ||
+	    !(dect_debug_flags & DECT_DEBUG_DEFER_DUMPS))
+		return;
+
+	ddl_debug(ddl, "message history:");
+	for (i = 0; i < DECT_DDL_HISTORY_SIZE; i++) {
+		n = (h->next + i) % DECT_DDL_HISTORY_SIZE;
+		if (h->msgs[n].len == 0)
+			continue;
+
+		len = min(h->msgs[n].len, (uint8_t)DECT_DDL_HISTORY_DATA_SIZE);
+		dect_hexdump(DECT_DEBUG_LCE, h->msgs[n].tx ? "LCE: TX" : "LCE: RX",
+			     h->msgs[n].data, len);
+		if (h->msgs[n].len > len)
+			lce_debug("... %u bytes truncated\n", h->msgs[n].len - len);
+	}
+}
+
 static void dect_ddl_shutdown(struct dect_handle *dh,
 			      struct dect_data_link *ddl)
 {
@@ -539,6 +1371,7 @@ static void dect_ddl_shutdown(struct dect_handle *dh,
 	bool last = false;
 
 	ddl_debug(ddl, "shutdown");
+	dect_ind_link_flush(dh, ddl);
 	ddl->state = DECT_DATA_LINK_RELEASED;
 
 	/* If no transactions are present, the link is waiting for a partial
@@ -568,9 +1401,15 @@ int dect_ddl_set_cipher_key(const struct dect_data_link *ddl,
 {
 	int err;
 
+	/* Ciphering is bound to the MAC connection of a suspended link */
+	if (ddl->dfd == NULL) {
+		errno = EAGAIN;
+		return -1;
+	}
+
 	ddl_debug(ddl, "DL_ENC_KEY-req: %.16" PRIx64, *(uint64_t *)ck);
-	err = setsockopt(ddl->dfd->fd, SOL_DECT, DECT_DL_ENC_KEY,
-			 ck, DECT_CIPHER_KEY_LEN);
+	err = dect_fd_setsockopt(ddl->dfd, SOL_DECT, DECT_DL_ENC_KEY,
+				 ck, DECT_CIPHER_KEY_LEN);
 	if (err != 0)
 		ddl_debug(ddl, "setsockopt: %s", strerror(errno));
 	return err;
@@ -588,9 +1427,14 @@ int dect_ddl_encrypt_req(const struct dect_data_link *ddl,
 	struct dect_dl_encrypt dle = { .status = status };
 	int err;
 
+	if (ddl->dfd == NULL) {
+		errno = EAGAIN;
+		return -1;
+	}
+
 	ddl_debug(ddl, "DL_ENCRYPT-req: status: %u\n", status);
-	err = setsockopt(ddl->dfd->fd, SOL_DECT, DECT_DL_ENCRYPT,
-			 &dle, sizeof(dle));
+	err = dect_fd_setsockopt(ddl->dfd, SOL_DECT, DECT_DL_ENCRYPT,
+				 &dle, sizeof(dle));
 	if (err != 0)
 		ddl_debug(ddl, "setsockopt: %s", strerror(errno));
 	return err;
@@ -610,6 +1454,17 @@ static void dect_ddl_encrypt_ind(struct dect_handle *dh,
 	}
 }
 
+static void dect_ddl_suspend_ind(struct dect_handle *dh,
+				 struct dect_data_link *ddl, bool suspended)
+{
+	struct dect_transaction *ta, *next;
+
+	list_for_each_entry_safe(ta, next, &ddl->transactions, list) {
+		if (protocols[ta->pd]->suspend_ind)
+			protocols[ta->pd]->suspend_ind(dh, ta, suspended);
+	}
+}
+
 static void dect_ddl_sdu_timer(struct dect_handle *dh, struct dect_timer *timer)
 {
 	struct dect_data_link *ddl = timer->data;
@@ -631,90 +1486,509 @@ static void dect_ddl_stop_sdu_timer(const struct dect_handle *dh,
 				    struct dect_data_link *ddl)
 {
 	ddl_debug(ddl, "stop <LCE.05>: SDU timer");
-	dect_timer_stop(dh, ddl->sdu_timer);
+	dect_timer_cancel(dh, ddl->sdu_timer);
+}
+
+static struct dect_stats_proto *dect_stats_proto(const struct dect_handle *dh,
+						 uint8_t pd)
+{
+	switch (pd) {
+	case DECT_PD_CC:
+		return &dh->stats->cc;
+	case DECT_PD_CISS:
+		return &dh->stats->ss;
+	case DECT_PD_MM:
+		return &dh->stats->mm;
+	case DECT_PD_CLMS:
+		return &dh->stats->clms;
+	default:
+		return NULL;
+	}
+}
+
+static void dect_lce_stats_tx(const struct dect_handle *dh,
+			      const struct dect_data_link *ddl,
+			      const struct dect_msg_buf *mb, ssize_t size)
+{
+	struct dect_stats_proto *ps;
+
+	dect_trace6(lce_tx, ddl, mb->data[0] & DECT_S_PD_MASK,
+		    mb->data[1] & DECT_S_PD_MSG_TYPE_MASK,
+		    (mb->data[0] & DECT_S_TI_TV_MASK) >> DECT_S_TI_TV_SHIFT,
+		    mb->len, size);
+
+	if (size < 0) {
+		dect_stats_inc(dh, lce, tx_errors);
+		return;
+	}
+
+	dect_record(dh, ddl, DECT_RECORD_TX, mb);
+	dect_stats_inc(dh, lce, tx_msgs);
+	ps = dect_stats_proto(dh, mb->data[0] & DECT_S_PD_MASK);
+	if (ps != NULL)
+		ps->tx_msgs++;
+}
+
+/*
+ * Park a message which could not be sent because the socket's send buffer
+ * is full and wait for the socket to become writable.
+ */
+static ssize_t dect_ddl_tx_park(const struct dect_handle *dh,
+				struct dect_data_link *ddl,
+				struct dect_msg_buf *mb)
+{
+	if (ddl->tx_queue_len >= DECT_DDL_TX_QUEUE_MAX) {
+		ddl_debug(ddl, "TX queue full, dropping message");
+		dect_mbuf_free(dh, mb);
+		errno = ENOBUFS;
+		return -1;
+	}
+
+	if (ptrqueue_empty(&ddl->tx_queue) &&
+	    dect_fd_update(dh, ddl->dfd, DECT_FD_READ | DECT_FD_WRITE) < 0) {
+		dect_mbuf_free(dh, mb);
+		return -1;
+	}
+
+	ptrqueue_add_tail(mb, &ddl->tx_queue);
+	ddl->tx_queue_len++;
+	return 0;
 }
 
 static ssize_t dect_ddl_send(const struct dect_handle *dh,
-			     const struct dect_data_link *ddl,
+			     struct dect_data_link *ddl,
 			     struct dect_msg_buf *mb)
 {
 	struct msghdr msg;
 	ssize_t size;
 
+	/* Preserve ordering while messages are waiting for transmission */
+	if (!ptrqueue_empty(&ddl->tx_queue))
+		return dect_ddl_tx_park(dh, ddl, mb);
+
 	memset(&msg, 0, sizeof(msg));
-	dect_mbuf_dump(DECT_DEBUG_LCE, mb, "LCE: TX");
+	dect_ddl_dump(ddl, mb, true);
 	size = dect_mbuf_send(dh, ddl->dfd, &msg, mb);
+	if (size < 0 && errno == EAGAIN)
+		return dect_ddl_tx_park(dh, ddl, mb);
+
+	dect_lce_stats_tx(dh, ddl, mb, size);
 	dect_mbuf_free(dh, mb);
 	return size;
 }
 
-static struct dect_msg_buf *
-dect_lce_build_msg(const struct dect_handle *dh,
-		   const struct dect_transaction *ta,
-		   const struct dect_sfmt_msg_desc *desc,
-		   const struct dect_msg_common *msg, uint8_t type)
+static void dect_ddl_tx_flush(const struct dect_handle *dh,
+			      struct dect_data_link *ddl)
 {
 	struct dect_msg_buf *mb;
-	int err;
+	struct msghdr msg;
+	ssize_t size;
 
-	mb = dect_mbuf_alloc(dh);
-	if (mb == NULL)
+	while ((mb = ddl->tx_queue.head) != NULL) {
+		memset(&msg, 0, sizeof(msg));
+		dect_ddl_dump(ddl, mb, true);
+		size = dect_mbuf_send(dh, ddl->dfd, &msg, mb);
+		if (size < 0 && errno == EAGAIN)
+			return;
+
+		dect_lce_stats_tx(dh, ddl, mb, size);
+		ptrqueue_dequeue_head(&ddl->tx_queue);
+		ddl->tx_queue_len--;
+		dect_mbuf_free(dh, mb);
+	}
+
+	dect_fd_update(dh, ddl->dfd, DECT_FD_READ);
+}
+
+static void dect_lce_data_link_event(struct dect_handle *dh,
+				     struct dect_fd *dfd, uint32_t events);
+
+/* Connect a new S-SAP socket for a data link initiated by this side */
+static int dect_ddl_connect_socket(const struct dect_handle *dh,
+				   struct dect_data_link *ddl,
+				   const struct dect_mac_conn_params *mcp)
+{
+	ddl->dfd = dect_socket(dh, SOCK_SEQPACKET, DECT_S_SAP);
+	if (ddl->dfd == NULL)
 		goto err1;
 
-	dect_mbuf_reserve(mb, DECT_S_HDR_SIZE);
-	err = dect_build_sfmt_msg(dh, desc, msg, mb);
-	if (err < 0)
+	if (mcp != NULL &&
+	    dect_fd_setsockopt(ddl->dfd, SOL_DECT, DECT_DL_MAC_CONN_PARAMS,
+			       mcp, sizeof(*mcp)) < 0)
 		goto err2;
 
-	dect_mbuf_push(mb, DECT_S_HDR_SIZE);
-	mb->data[1]  = type;
-	mb->data[0]  = ta->pd;
-	mb->data[0] |= ta->tv << DECT_S_TI_TV_SHIFT;
-	if (ta->role == DECT_TRANSACTION_RESPONDER)
-		mb->data[0] |= DECT_S_TI_F_FLAG;
-	return mb;
+	dect_fd_setup(ddl->dfd, dect_lce_data_link_event, ddl);
+	if (dect_fd_register(dh, ddl->dfd, DECT_FD_WRITE) < 0)
+		goto err2;
 
+	if (dect_fd_connect(ddl->dfd, (struct sockaddr *)&ddl->dlei,
+			    sizeof(ddl->dlei)) < 0 && errno != EAGAIN)
+		goto err3;
+	return 0;
+
+err3:
+	dect_fd_unregister(dh, ddl->dfd);
 err2:
-	dect_mbuf_free(dh, mb);
+	dect_close(dh, ddl->dfd);
+	ddl->dfd = NULL;
 err1:
-	return NULL;
+	return -1;
 }
 
-/**
- * dect_lce_send - Queue a S-Format message for transmission to the LCE
+/*
+ * Data link suspension
+ *
+ * A data link whose transactions don't need the MAC connection for some
+ * time, for instance a call on hold, is suspended by the higher layers. The
+ * S-SAP socket is closed, which releases the MAC connection, while the link
+ * keeps its transactions and identities. Suspended links are resumed when a
+ * message is sent on them, by paging the PP on the FP and by connecting a
+ * new S-SAP socket on the PP. The FP resumes a suspended link with the socket
+ * of the next link accepted for the assigned individual TPUI of its PP and
+ * the same LLN, or on a page response carrying its IPUI, so neither side
+ * needs to set up its higher layer procedures again. A PP without an
+ * assigned PMID identifies itself by a page response after resuming.
  */
-int dect_lce_send(const struct dect_handle *dh,
-		  struct dect_transaction *ta,
-		  const struct dect_sfmt_msg_desc *desc,
-		  const struct dect_msg_common *msg, uint8_t type)
+static void dect_ddl_suspend_complete(struct dect_handle *dh,
+				      struct dect_data_link *ddl)
 {
-	struct dect_data_link *ddl = ta->link;
-	struct dect_msg_buf *mb;
+	ddl_debug(ddl, "suspended");
+	dect_fd_unregister(dh, ddl->dfd);
+	dect_close(dh, ddl->dfd);
+	ddl->dfd   = NULL;
+	ddl->state = DECT_DATA_LINK_SUSPENDED;
+	ddl->page_count = 0;
+	list_add_tail(&ddl->suspend_node, &dh->suspended_links);
+	ddl->flags |= DECT_DATA_LINK_DETACHED;
+
+	/* Ciphering is bound to the MAC connection */
+	if (ddl->cipher != DECT_CIPHER_DISABLED)
+		dect_ddl_encrypt_ind(dh, ddl, DECT_CIPHER_DISABLED);
+	dect_ddl_suspend_ind(dh, ddl, true);
+}
 
-	mb = dect_lce_build_msg(dh, ta, desc, msg, type);
-	if (mb == NULL)
+/**
+ * dect_ddl_suspend - suspend an established data link
+ *
+ * @dh:		libdect DECT handle
+ * @ddl:	data link
+ *
+ * The MAC connection is released once the queued messages have been
+ * transmitted. All transactions of the link are affected.
+ */
+int dect_ddl_suspend(struct dect_handle *dh, struct dect_data_link *ddl)
+{
+	if (ddl->state != DECT_DATA_LINK_ESTABLISHED ||
+	    list_empty(&ddl->transactions)) {
+		errno = EINVAL;
 		return -1;
+	}
 
-	if (ddl->sdu_timer && dect_timer_running(ddl->sdu_timer))
-		dect_ddl_stop_sdu_timer(dh, ddl);
+	ddl_debug(ddl, "suspend");
+	ddl->state = DECT_DATA_LINK_SUSPEND_PENDING;
+	if (ptrqueue_empty(&ddl->tx_queue) &&
+	    !(ddl->flags & DECT_DATA_LINK_RCV_ACTIVE))
+		dect_ddl_suspend_complete(dh, ddl);
+	return 0;
+}
 
-	if (ta->mb != NULL)
-		dect_mbuf_free(dh, ta->mb);
-	ta->mb = mb;
-	mb->refcnt++;
+static int dect_ddl_resume(const struct dect_handle *dh,
+			   struct dect_data_link *ddl)
+{
+	ddl_debug(ddl, "resume");
+	ddl->state = DECT_DATA_LINK_RESUME_PENDING;
+	ddl->establish_time = dect_stats_clock();
 
-	switch (ddl->state) {
-	case DECT_DATA_LINK_ESTABLISHED:
-		return dect_ddl_send(dh, ddl, mb);
-	case DECT_DATA_LINK_ESTABLISH_PENDING:
-		ptrlist_add_tail(mb, &ddl->msg_queue);
+	/* The FP pages the PP from the page timer */
+	if (dh->mode == DECT_MODE_FP) {
+		ddl->page_count = 0;
+		dect_timer_start(dh, ddl->page_timer, 0);
 		return 0;
-	default:
-		ddl_debug(ddl, "Invalid state: %u\n", ddl->state);
+	}
+
+	if (dect_ddl_connect_socket(dh, ddl, &ddl->mcp) < 0) {
+		ddl->state = DECT_DATA_LINK_SUSPENDED;
+		return -1;
+	}
+	return 0;
+}
+
+static void dect_ddl_resume_complete(struct dect_handle *dh,
+				     struct dect_data_link *ddl)
+{
+	struct dect_msg_buf *mb;
+
+	list_del(&ddl->suspend_node);
+	ddl->flags &= ~DECT_DATA_LINK_DETACHED;
+	ddl->state  = DECT_DATA_LINK_ESTABLISHED;
+	ddl_debug(ddl, "resumed");
+	dect_stats_latency(dh, DECT_STATS_LATENCY_LCE_ESTABLISH,
+			   ddl->establish_time);
+
+	if (dh->mode == DECT_MODE_PP)
+		dect_lce_send_identity(dh, ddl);
+	while ((mb = ptrqueue_dequeue_head(&ddl->msg_queue)))
+		dect_ddl_send(dh, ddl, mb);
+	dect_ddl_suspend_ind(dh, ddl, false);
+}
+
+/*
+ * Only an assigned individual TPUI identifies the PP of a new link, default
+ * PMIDs are chosen at random and may be reused by a different PP.
+ */
+static bool dect_ddl_pmid_assigned(const struct dect_handle *dh,
+				   const struct dect_data_link *ddl,
+				   uint32_t p)
+{
+	const struct dect_lte *lte;
+	struct dect_pmid pmid;
+
+	if (!(ddl->flags & DECT_DATA_LINK_IPUI_VALID))
+		return false;
+	lte = dect_lte_get_by_ipui(dh, &ddl->ipui);
+	if (lte == NULL || !lte->tpui_valid ||
+	    lte->tpui.type != DECT_TPUI_INDIVIDUAL_ASSIGNED)
+		return false;
+	return dect_build_pmid(dect_tpui_to_pmid(&pmid, &lte->tpui)) == p;
+}
+
+/* Find a suspended link the peer reconnects, the LCN may differ */
+static struct dect_data_link *
+dect_ddl_get_suspended(const struct dect_handle *dh,
+		       const struct sockaddr_dect_ssap *dlei)
+{
+	struct dect_data_link *ddl;
+
+	list_for_each_entry(ddl, &dh->suspended_links, suspend_node) {
+		if (ddl->dlei.dect_index == dlei->dect_index &&
+		    ddl->dlei.dect_ari   == dlei->dect_ari   &&
+		    ddl->dlei.dect_pmid  == dlei->dect_pmid  &&
+		    ddl->dlei.dect_lln   == dlei->dect_lln   &&
+		    ddl->dlei.dect_sapi  == dlei->dect_sapi  &&
+		    dect_ddl_pmid_assigned(dh, ddl, dlei->dect_pmid))
+			return ddl;
+	}
+	return NULL;
+}
+
+/* Resume a suspended link using an accepted socket */
+static int dect_ddl_resume_adopt(struct dect_handle *dh,
+				 struct dect_data_link *ddl,
+				 struct dect_fd *dfd,
+				 const struct sockaddr_dect_ssap *dlei,
+				 const struct dect_mac_conn_params *mcp)
+{
+	dect_fd_setup(dfd, dect_lce_data_link_event, ddl);
+	if (dect_fd_register(dh, dfd, DECT_FD_READ) < 0)
+		return -1;
+
+	if (dect_timer_running(ddl->page_timer))
+		dect_timer_stop(dh, ddl->page_timer);
+
+	hlist_del(&ddl->dlei_node);
+	ddl->dfd  = dfd;
+	ddl->dlei = *dlei;
+	ddl->mcp  = *mcp;
+	hlist_add_head(&ddl->dlei_node,
+		       &dh->link_dlei_hash[dect_link_dlei_hash(&ddl->dlei)]);
+
+	if (ddl->page_count == 1)
+		dect_ddl_rtt_sample(dh, ddl, DECT_RTT_PAGE, ddl->establish_time);
+	dect_ddl_resume_complete(dh, ddl);
+	return 0;
+}
+
+static struct dect_msg_buf *
+dect_lce_build_msg(const struct dect_handle *dh,
+		   const struct dect_transaction *ta,
+		   const struct dect_sfmt_msg_desc *desc,
+		   const struct dect_sfmt_msg_tmpl *tmpl,
+		   const struct dect_msg_common *msg, uint8_t type)
+{
+	struct dect_msg_buf *mb;
+	uint64_t start;
+	int err;
+
+	mb = dect_mbuf_alloc(dh);
+	if (mb == NULL)
+		goto err1;
+
+	dect_mbuf_reserve(mb, DECT_S_HDR_SIZE);
+	start = dect_stats_build_begin(dh);
+	if (tmpl != NULL)
+		err = dect_build_sfmt_msg_tmpl(dh, tmpl, msg, mb);
+	else
+		err = dect_build_sfmt_msg(dh, desc, msg, mb);
+	dect_stats_build_end(dh, start, ta->pd, type & DECT_S_PD_MSG_TYPE_MASK);
+	if (err < 0)
+		goto err2;
+
+	dect_mbuf_push(mb, DECT_S_HDR_SIZE);
+	mb->data[1]  = type;
+	mb->data[0]  = ta->pd;
+	mb->data[0] |= ta->tv << DECT_S_TI_TV_SHIFT;
+	if (ta->role == DECT_TRANSACTION_RESPONDER)
+		mb->data[0] |= DECT_S_TI_F_FLAG;
+	return mb;
+
+err2:
+	dect_mbuf_free(dh, mb);
+err1:
+	return NULL;
+}
+
+/*
+ * Retransmission store
+ *
+ * Protocols retransmitting messages on timeout keep a copy of the last
+ * message of each transaction, sized to the message instead of a complete
+ * message buffer. The number of copies is bounded, the least recently sent
+ * message is dropped when the limit is reached and its transaction is not
+ * retransmitted.
+ */
+
+static int dect_rtx_store_init(struct dect_handle *dh)
+{
+	dh->rtx_store = dect_malloc(dh, sizeof(*dh->rtx_store));
+	if (dh->rtx_store == NULL)
+		return -1;
+	init_list_head(&dh->rtx_store->msgs);
+	dh->rtx_store->cnt = 0;
+	return 0;
+}
+
+static void dect_rtx_store_exit(struct dect_handle *dh)
+{
+	dect_free(dh, dh->rtx_store);
+	dh->rtx_store = NULL;
+}
+
+static void dect_rtx_msg_free(const struct dect_handle *dh,
+			      struct dect_rtx_msg *rm)
+{
+	list_del(&rm->list);
+	rm->ta->rtx = NULL;
+	dh->rtx_store->cnt--;
+	dect_free(dh, rm);
+}
+
+static void dect_rtx_store(const struct dect_handle *dh,
+			   struct dect_transaction *ta,
+			   const struct dect_msg_buf *mb)
+{
+	struct dect_rtx_store *rs = dh->rtx_store;
+	struct dect_rtx_msg *rm;
+
+	if (ta->rtx != NULL)
+		dect_rtx_msg_free(dh, ta->rtx);
+	if (!protocols[ta->pd]->retransmit || dh->rtx_max == 0)
+		return;
+
+	if (rs->cnt >= dh->rtx_max) {
+		rm = list_first_entry(&rs->msgs, struct dect_rtx_msg, list);
+		dect_rtx_msg_free(dh, rm);
+		dect_stats_inc(dh, lce, rtx_evictions);
+	}
+
+	/* Without a copy the message is not retransmitted */
+	rm = dect_malloc_type(dh, DECT_MEM_RTX, sizeof(*rm) + mb->len);
+	if (rm == NULL)
+		return;
+	rm->ta	= ta;
+	rm->len	= mb->len;
+	memcpy(rm->data, mb->data, mb->len);
+	list_add_tail(&rm->list, &rs->msgs);
+	rs->cnt++;
+	ta->rtx = rm;
+}
+
+/**
+ * Limit the number of messages kept for retransmission
+ *
+ * @param dh		libdect DECT handle
+ * @param max		maximum number of messages, 0 to disable retransmissions
+ *
+ * The last message of each MM transaction is kept for retransmission after
+ * a timeout. Once the limit is reached, the least recently sent message is
+ * dropped, its procedure is not retransmitted.
+ */
+void dect_lce_set_rtx_limit(struct dect_handle *dh, unsigned int max)
+{
+	struct dect_rtx_msg *rm;
+
+	dh->rtx_max = max;
+	while (dh->rtx_store != NULL && dh->rtx_store->cnt > max) {
+		rm = list_first_entry(&dh->rtx_store->msgs,
+				      struct dect_rtx_msg, list);
+		dect_rtx_msg_free(dh, rm);
+	}
+}
+EXPORT_SYMBOL(dect_lce_set_rtx_limit);
+
+static int dect_lce_queue(const struct dect_handle *dh,
+			  struct dect_transaction *ta,
+			  struct dect_msg_buf *mb)
+{
+	struct dect_data_link *ddl = ta->link;
+
+	if (dect_timer_running(ddl->sdu_timer))
+		dect_ddl_stop_sdu_timer(dh, ddl);
+
+	dect_rtx_store(dh, ta, mb);
+
+	switch (ddl->state) {
+	case DECT_DATA_LINK_ESTABLISHED:
+	case DECT_DATA_LINK_SUSPEND_PENDING:
+		return dect_ddl_send(dh, ddl, mb);
+	case DECT_DATA_LINK_SUSPENDED:
+		if (dect_ddl_resume(dh, ddl) < 0)
+			return -1;
+		/* fall through */
+	case DECT_DATA_LINK_ESTABLISH_PENDING:
+	case DECT_DATA_LINK_RESUME_PENDING:
+		ptrqueue_add_tail(mb, &ddl->msg_queue);
+		return 0;
+	default:
+		ddl_debug(ddl, "Invalid state: %u\n", ddl->state);
 		BUG();
 	}
 }
 
+/**
+ * dect_lce_send - Queue a S-Format message for transmission to the LCE
+ */
+int dect_lce_send(const struct dect_handle *dh,
+		  struct dect_transaction *ta,
+		  const struct dect_sfmt_msg_desc *desc,
+		  const struct dect_msg_common *msg, uint8_t type)
+{
+	struct dect_msg_buf *mb;
+
+	mb = dect_lce_build_msg(dh, ta, desc, NULL, msg, type);
+	if (mb == NULL)
+		return -1;
+	return dect_lce_queue(dh, ta, mb);
+}
+
+/**
+ * dect_lce_send_tmpl - Queue a S-Format message built from a template
+ *
+ * The constant IEs are copied from the template, only the variable IEs
+ * in @msg and the transaction header are built.
+ */
+int dect_lce_send_tmpl(const struct dect_handle *dh,
+		       struct dect_transaction *ta,
+		       const struct dect_sfmt_msg_tmpl *tmpl,
+		       const struct dect_msg_common *msg, uint8_t type)
+{
+	struct dect_msg_buf *mb;
+
+	mb = dect_lce_build_msg(dh, ta, tmpl->desc, tmpl, msg, type);
+	if (mb == NULL)
+		return -1;
+	return dect_lce_queue(dh, ta, mb);
+}
+
 int dect_lce_send_cl(struct dect_handle *dh, const struct dect_ipui *ipui,
 		     const struct dect_sfmt_msg_desc *desc,
 		     const struct dect_msg_common *msg,
@@ -731,15 +2005,17 @@ int dect_lce_send_cl(struct dect_handle *dh, const struct dect_ipui *ipui,
 	if (ddl == NULL)
 		return -1;
 
-	mb = dect_lce_build_msg(dh, &ta, desc, msg, type);
+	mb = dect_lce_build_msg(dh, &ta, desc, NULL, msg, type);
 	if (mb == NULL)
 		return -1;
 
 	switch (ddl->state) {
 	case DECT_DATA_LINK_ESTABLISHED:
+	case DECT_DATA_LINK_SUSPEND_PENDING:
 		return dect_ddl_send(dh, ddl, mb);
 	case DECT_DATA_LINK_ESTABLISH_PENDING:
-		ptrlist_add_tail(mb, &ddl->msg_queue);
+	case DECT_DATA_LINK_RESUME_PENDING:
+		ptrqueue_add_tail(mb, &ddl->msg_queue);
 		return 0;
 	default:
 		ddl_debug(ddl, "Invalid state: %u\n", ddl->state);
@@ -747,43 +2023,262 @@ int dect_lce_send_cl(struct dect_handle *dh, const struct dect_ipui *ipui,
 	}
 }
 
+/**
+ * struct dect_lce_cl_multicast - connectionless message to multiple PPs
+ *
+ * @list:	handle multicast list node
+ * @timer:	timer for resuming when the establishment limit is reached
+ * @mb:		encoded message shared by all destinations
+ * @remaining:	number of destinations the message has not been sent to
+ * @n:		number of destinations
+ * @dests:	destinations
+ */
+struct dect_lce_cl_multicast {
+	struct list_head		list;
+	struct dect_timer		*timer;
+	struct dect_msg_buf		*mb;
+	unsigned int			remaining;
+	unsigned int			n;
+	struct {
+		struct dect_ipui	ipui;
+		bool			done;
+	}				dests[];
+};
+
+/*
+ * Send a message shared by multiple links. The message is only handed to the
+ * socket directly, it can't be linked into the queues of more than one link,
+ * so a private copy is queued if the link is not ready for transmission.
+ */
+static ssize_t dect_ddl_send_shared(const struct dect_handle *dh,
+				    struct dect_data_link *ddl,
+				    const struct dect_msg_buf *mb)
+{
+	struct dect_msg_buf *copy;
+	struct msghdr msg;
+	ssize_t size;
+
+	if (ddl->state == DECT_DATA_LINK_ESTABLISHED &&
+	    ptrqueue_empty(&ddl->tx_queue)) {
+		memset(&msg, 0, sizeof(msg));
+		dect_ddl_dump(ddl, mb, true);
+		size = dect_mbuf_send(dh, ddl->dfd, &msg, mb);
+		if (size >= 0 || errno != EAGAIN) {
+			dect_lce_stats_tx(dh, ddl, mb, size);
+			return size;
+		}
+	}
+
+	copy = dect_mbuf_alloc_raw(dh);
+	if (copy == NULL)
+		return -1;
+	memcpy(copy->data, mb->data, mb->len);
+	copy->len = mb->len;
+
+	if (ddl->state == DECT_DATA_LINK_ESTABLISHED)
+		return dect_ddl_send(dh, ddl, copy);
+	ptrqueue_add_tail(copy, &ddl->msg_queue);
+	return 0;
+}
+
+static unsigned int dect_ddl_count_pending(const struct dect_handle *dh)
+{
+	const struct dect_data_link *ddl;
+	unsigned int n = 0;
+
+	list_for_each_entry(ddl, &dh->links, list) {
+		if (ddl->state == DECT_DATA_LINK_ESTABLISH_PENDING)
+			n++;
+	}
+	return n;
+}
+
+static void dect_lce_cl_multicast_free(struct dect_handle *dh,
+				       struct dect_lce_cl_multicast *mc)
+{
+	list_del(&mc->list);
+	if (dect_timer_running(mc->timer))
+		dect_timer_stop(dh, mc->timer);
+	dect_timer_free(dh, mc->timer);
+	dect_mbuf_free(dh, mc->mb);
+	dect_free(dh, mc);
+}
+
+static void dect_lce_cl_multicast_run(struct dect_handle *dh,
+				      struct dect_lce_cl_multicast *mc)
+{
+	struct dect_data_link *ddl;
+	unsigned int i, pending;
+
+	pending = dect_ddl_count_pending(dh);
+	for (i = 0; i < mc->n && mc->remaining > 0; i++) {
+		if (mc->dests[i].done)
+			continue;
+
+		ddl = dect_ddl_get_by_ipui(dh, &mc->dests[i].ipui);
+		if (ddl == NULL) {
+			if (pending >= DECT_LCE_CL_MULTICAST_PENDING_MAX)
+				continue;
+			ddl = dect_ddl_connect(dh, &mc->dests[i].ipui);
+			if (ddl != NULL &&
+			    ddl->state == DECT_DATA_LINK_ESTABLISH_PENDING)
+				pending++;
+		}
+
+		/* Links being released are retried once they are gone */
+		if (ddl != NULL &&
+		    ddl->state != DECT_DATA_LINK_ESTABLISHED &&
+		    ddl->state != DECT_DATA_LINK_ESTABLISH_PENDING)
+			continue;
+
+		if (ddl == NULL || dect_ddl_send_shared(dh, ddl, mc->mb) < 0)
+			lce_debug("CL multicast: N EMC: %04x PSN: %05x: %s\n",
+				  mc->dests[i].ipui.pun.n.ipei.emc,
+				  mc->dests[i].ipui.pun.n.ipei.psn,
+				  strerror(errno));
+
+		mc->dests[i].done = true;
+		mc->remaining--;
+	}
+
+	if (mc->remaining == 0)
+		dect_lce_cl_multicast_free(dh, mc);
+	else
+		dect_timer_start_ms(dh, mc->timer,
+				    DECT_LCE_CL_MULTICAST_INTERVAL);
+}
+
+static void dect_lce_cl_multicast_timer(struct dect_handle *dh,
+					struct dect_timer *timer)
+{
+	dect_lce_cl_multicast_run(dh, timer->data);
+}
+
+/**
+ * dect_lce_send_cl_multicast - Send a connectionless message to multiple PPs
+ *
+ * The message is built once and shared by all destinations. Links to the PPs
+ * are reused if present, otherwise at most DECT_LCE_CL_MULTICAST_PENDING_MAX
+ * links are in establishment at a time and the remaining destinations are
+ * served once establishment of earlier links has completed.
+ */
+int dect_lce_send_cl_multicast(struct dect_handle *dh,
+			       const struct dect_ipui *ipuis, unsigned int n,
+			       const struct dect_sfmt_msg_desc *desc,
+			       const struct dect_msg_common *msg,
+			       enum dect_pds pd, uint8_t type)
+{
+	struct dect_lce_cl_multicast *mc;
+	struct dect_transaction ta = {
+		.pd	= pd,
+		.tv	= DECT_TV_CONNECTIONLESS,
+	};
+	unsigned int i;
+
+	if (n == 0) {
+		errno = EINVAL;
+		goto err1;
+	}
+
+	mc = dect_zalloc(dh, sizeof(*mc) + n * sizeof(mc->dests[0]));
+	if (mc == NULL)
+		goto err1;
+	for (i = 0; i < n; i++)
+		mc->dests[i].ipui = ipuis[i];
+	mc->remaining = mc->n = n;
+
+	mc->timer = dect_timer_alloc(dh);
+	if (mc->timer == NULL)
+		goto err2;
+	dect_timer_setup(mc->timer, dect_lce_cl_multicast_timer, mc);
+
+	mc->mb = dect_lce_build_msg(dh, &ta, desc, NULL, msg, type);
+	if (mc->mb == NULL)
+		goto err3;
+
+	list_add_tail(&mc->list, &dh->cl_multicasts);
+	dect_lce_cl_multicast_run(dh, mc);
+	return 0;
+
+err3:
+	dect_timer_free(dh, mc->timer);
+err2:
+	dect_free(dh, mc);
+err1:
+	return -1;
+}
+
+/*
+ * Check whether a copy of a stored message is still waiting for transmission.
+ * Retransmissions are sent from fresh buffers, so the queued messages are
+ * compared by content.
+ */
+static bool dect_ddl_tx_queued(const struct dect_data_link *ddl,
+			       const struct dect_rtx_msg *rm)
+{
+	const struct dect_msg_buf *pos;
+
+	for (pos = ddl->tx_queue.head; pos != NULL; pos = pos->next) {
+		if (pos->len == rm->len && !memcmp(pos->data, rm->data, rm->len))
+			return true;
+	}
+	return false;
+}
+
 int dect_lce_retransmit(const struct dect_handle *dh,
 			struct dect_transaction *ta)
 {
 	struct dect_data_link *ddl = ta->link;
+	struct dect_msg_buf *mb;
 
-	if (ta->mb != NULL &&
-	    ddl->state == DECT_DATA_LINK_ESTABLISHED) {
-		ta->mb->refcnt++;
-		return dect_ddl_send(dh, ddl, ta->mb);
-	} else
+	if (ta->rtx == NULL || ddl->state != DECT_DATA_LINK_ESTABLISHED)
+		return 0;
+	/* The message has not been sent yet */
+	if (dect_ddl_tx_queued(ddl, ta->rtx))
 		return 0;
+
+	mb = dect_mbuf_alloc_raw(dh);
+	if (mb == NULL)
+		return -1;
+	memcpy(mb->data, ta->rtx->data, ta->rtx->len);
+	mb->len = ta->rtx->len;
+
+	/* Keep the retransmitted message from being dropped first */
+	list_move_tail(&ta->rtx->list, &dh->rtx_store->msgs);
+	return dect_ddl_send(dh, ddl, mb);
 }
 
-static void dect_ddl_rcv_msg(struct dect_handle *dh, struct dect_data_link *ddl)
+static int dect_ddl_rcv_mb(struct dect_handle *dh, struct dect_data_link *ddl,
+			   struct dect_msg_buf *mb);
+
+static int dect_ddl_rcv_msg(struct dect_handle *dh, struct dect_data_link *ddl)
 {
 	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
-	struct dect_transaction *ta;
 	struct msghdr msg;
 	struct cmsghdr *cmsg;
 	char cmsg_buf[4 * CMSG_SPACE(16)];
-	uint8_t pd, tv;
-	bool f;
 
 	msg.msg_control		= cmsg_buf;
 	msg.msg_controllen	= sizeof(cmsg_buf);
 
-	if (dect_mbuf_rcv(ddl->dfd, &msg, mb) < 0) {
+	if (dect_mbuf_rcv(ddl->dfd, &msg, mb, MSG_DONTWAIT) < 0) {
 		switch (errno) {
+		case EAGAIN:
+			return -1;
+		case EMSGSIZE:
+			return 0;
 		case ENOTCONN:
-			if (ddl->state == DECT_DATA_LINK_RELEASE_PENDING)
-				return dect_ddl_release_complete(dh, ddl);
-			else
-				return dect_ddl_shutdown(dh, ddl);
+			if (ddl->state == DECT_DATA_LINK_RELEASE_PENDING) {
+				dect_ddl_release_complete(dh, ddl);
+				return -1;
+			}
+			/* fall through */
 		case ETIMEDOUT:
 		case ECONNRESET:
 		case EHOSTUNREACH:
-			return dect_ddl_shutdown(dh, ddl);
+			dect_ddl_dump_history(ddl);
+			dect_ddl_shutdown(dh, ddl);
+			return -1;
 		default:
 			ddl_debug(ddl, "unhandled receive error: %s",
 				  strerror(errno));
@@ -810,32 +2305,68 @@ static void dect_ddl_rcv_msg(struct dect_handle *dh, struct dect_data_link *ddl)
 		}
 	}
 
-	dect_mbuf_dump(DECT_DEBUG_LCE, mb, "LCE: RX");
+	return dect_ddl_rcv_mb(dh, ddl, mb);
+}
 
-	if (mb->len < DECT_S_HDR_SIZE)
-		return;
+/* Process a received S-Format message */
+static int dect_ddl_rcv_mb(struct dect_handle *dh, struct dect_data_link *ddl,
+			   struct dect_msg_buf *mb)
+{
+	struct dect_stats_proto *ps;
+	struct dect_transaction *ta;
+	uint64_t start;
+	uint8_t pd, tv;
+	bool f;
+
+	dect_ind_link_flush(dh, ddl);
+	dect_ddl_dump(ddl, mb, false);
+	dect_record(dh, ddl, DECT_RECORD_RX, mb);
+	dect_stats_inc(dh, lce, rx_msgs);
+
+	if (mb->len < DECT_S_HDR_SIZE) {
+		dect_stats_inc(dh, lce, rx_truncated);
+		return 0;
+	}
 	f  = (mb->data[0] & DECT_S_TI_F_FLAG);
 	tv = (mb->data[0] & DECT_S_TI_TV_MASK) >> DECT_S_TI_TV_SHIFT;
 	pd = (mb->data[0] & DECT_S_PD_MASK);
 	mb->type = (mb->data[1] & DECT_S_PD_MSG_TYPE_MASK);
+	dect_trace6(lce_rx, ddl, pd, mb->type, tv,
+		    dect_trace_ipui(lce_rx, ddl),
+		    mb->len);
 	dect_mbuf_pull(mb, DECT_S_HDR_SIZE);
 
 	if (pd >= array_size(protocols) || protocols[pd] == NULL) {
 		ddl_debug(ddl, "unknown protocol %u", pd);
-		return;
+		dect_stats_inc(dh, lce, rx_unknown_pd);
+		dect_ddl_dump_history(ddl);
+		return 0;
 	}
 
 	if (tv >= protocols[pd]->max_transactions) {
 		ddl_debug(ddl, "invalid %s transaction value %u\n",
 			  protocols[pd]->name, tv);
-		return;
+		dect_stats_inc(dh, lce, rx_invalid_tv);
+		dect_ddl_dump_history(ddl);
+		return 0;
 	}
 
+	ps = dect_stats_proto(dh, pd);
+	if (ps != NULL)
+		ps->rx_msgs++;
+
 	if (dect_timer_running(ddl->sdu_timer))
 		dect_ddl_stop_sdu_timer(dh, ddl);
-
-	if (pd == DECT_PD_CLMS && tv == DECT_TV_CONNECTIONLESS)
-		return dect_clss_rcv(dh, mb);
+	dect_ddl_admit(dh, ddl);
+
+	start = dect_stats_rcv_begin(dh, pd, mb->type);
+	if (pd == DECT_PD_CLMS && tv == DECT_TV_CONNECTIONLESS) {
+#ifdef CONFIG_SS
+		dect_clss_rcv(dh, mb);
+#endif
+		dect_stats_rcv_end(dh, start);
+		return 0;
+	}
 
 	ta = dect_ddl_transaction_lookup(ddl, pd, tv, !f);
 	if (ta == NULL) {
@@ -847,9 +2378,13 @@ static void dect_ddl_rcv_msg(struct dect_handle *dh, struct dect_data_link *ddl)
 		};
 		ddl_debug(ddl, "new transaction: protocol: %s F: %u TV: %u",
 			  protocols[pd]->name, f, tv);
+		if (ps != NULL)
+			ps->transactions++;
 		protocols[pd]->open(dh, &req, mb);
 	} else
 		protocols[pd]->rcv(dh, ta, mb);
+	dect_stats_rcv_end(dh, start);
+	return 0;
 }
 
 static void dect_ddl_complete_direct_establish(struct dect_handle *dh,
@@ -864,12 +2399,17 @@ static void dect_ddl_complete_direct_establish(struct dect_handle *dh,
 		goto err1;
 
 	optlen = sizeof(ddl->mcp);
-	if (getsockopt(ddl->dfd->fd, SOL_DECT, DECT_DL_MAC_CONN_PARAMS,
-		       &ddl->mcp, &optlen))
+	if (dect_fd_getsockopt(ddl->dfd, SOL_DECT, DECT_DL_MAC_CONN_PARAMS,
+			       &ddl->mcp, &optlen))
 		goto err1;
 
+	if (ddl->state == DECT_DATA_LINK_RESUME_PENDING)
+		return dect_ddl_resume_complete(dh, ddl);
+
 	ddl->state = DECT_DATA_LINK_ESTABLISHED;
 	ddl_debug(ddl, "complete direct link establishment");
+	dect_stats_latency(dh, DECT_STATS_LATENCY_LCE_ESTABLISH,
+			   ddl->establish_time);
 
 	ddl_debug(ddl, "MAC connection: type: %s service: %s slot: %s",
 		  dect_val2str(dect_conn_types, buf1, ddl->mcp.type),
@@ -877,14 +2417,17 @@ static void dect_ddl_complete_direct_establish(struct dect_handle *dh,
 		  dect_val2str(dect_slot_types, buf3, ddl->mcp.slot));
 
 	ddl_debug(ddl, "DL_ESTABLISH-cfm: success: 1");
+	dect_stats_inc(dh, lce, links_established);
 	dh->ops->lce_ops->dl_establish_cfm(dh, true, ddl, &ddl->mcp);
 
 	/* Send queued messages */
-	while ((mb = ptrlist_dequeue_head(&ddl->msg_queue)))
+	while ((mb = ptrqueue_dequeue_head(&ddl->msg_queue)))
 		dect_ddl_send(dh, ddl, mb);
 	return;
 
 err1:
+	dect_stats_inc(dh, lce, establish_failures);
+	dect_ddl_dump_history(ddl);
 	dect_ddl_shutdown(dh, ddl);
 }
 
@@ -895,10 +2438,17 @@ static void dect_ddl_complete_indirect_establish(struct dect_handle *dh,
 	struct dect_transaction *ta, *ta_next;
 	struct dect_msg_buf *mb;
 	unsigned int i;
+	bool resumed, paged;
+
+	/* A PP resuming a suspended link identifies itself unpaged */
+	resumed = req->flags & DECT_DATA_LINK_DETACHED;
+	paged   = req->state != DECT_DATA_LINK_SUSPENDED;
 
-	/* Stop page timer */
-	dect_timer_stop(dh, req->page_timer);
-	dect_timer_free(dh, req->page_timer);
+	/* Stop page timer, or release the other members of a group page */
+	if (req->group != NULL)
+		dect_lce_group_page_complete(dh, req);
+	else if (dect_timer_running(req->page_timer))
+		dect_timer_stop(dh, req->page_timer);
 
 	ddl_debug(ddl, "complete indirect link establishment req %p", req);
 	dect_ddl_set_ipui(dh, ddl, &req->ipui);
@@ -911,18 +2461,29 @@ static void dect_ddl_complete_indirect_establish(struct dect_handle *dh,
 	/* Transfer transactions to the new link */
 	list_for_each_entry_safe(ta, ta_next, &req->transactions, list) {
 		ddl_debug(ta->link, "transfer transaction to link %p", ddl);
+		dect_ddl_transaction_remove(req, ta);
 		list_move_tail(&ta->list, &ddl->transactions);
 		ta->link = ddl;
+		dect_ddl_transaction_insert(ddl, ta);
 	}
 
 	/* Send queued messages */
-	while ((mb = ptrlist_dequeue_head(&req->msg_queue)))
+	while ((mb = ptrqueue_dequeue_head(&req->msg_queue)))
 		dect_ddl_send(dh, ddl, mb);
 
 	/* Release pending link */
+	if (req->page_count == 1 && req->group == NULL)
+		dect_ddl_rtt_sample(dh, ddl, DECT_RTT_PAGE,
+				    req->establish_time);
+	if (paged)
+		dect_stats_latency(dh, DECT_STATS_LATENCY_LCE_PAGE,
+				   req->establish_time);
 	dect_ddl_destroy(dh, req);
+	if (resumed)
+		dect_ddl_suspend_ind(dh, ddl, false);
 
 	ddl_debug(ddl, "DL_ESTABLISH-cfm: success: 1");
+	dect_stats_inc(dh, lce, links_established);
 	dh->ops->lce_ops->dl_establish_cfm(dh, true, ddl, &ddl->mcp);
 
 	/* If the link was established for a connectionless transmission,
@@ -931,10 +2492,6 @@ static void dect_ddl_complete_indirect_establish(struct dect_handle *dh,
 		return dect_ddl_partial_release(dh, ddl);
 }
 
-static void dect_ddl_page_timer(struct dect_handle *dh, struct dect_timer *timer);
-static void dect_lce_data_link_event(struct dect_handle *dh,
-				     struct dect_fd *dfd, uint32_t events);
-
 static const struct dect_mac_conn_params default_mcp = {
 	.service	= DECT_SERVICE_IN_MIN_DELAY,
 	.slot		= DECT_FULL_SLOT,
@@ -954,50 +2511,34 @@ static struct dect_data_link *dect_ddl_establish(struct dect_handle *dh,
 		goto err1;
 	ddl->mcp   = mcp ? *mcp : default_mcp;
 	ddl->state = DECT_DATA_LINK_ESTABLISH_PENDING;
+	ddl->establish_time = dect_stats_clock();
 	dect_ddl_set_ipui(dh, ddl, ipui);
 
 	if (dh->mode == DECT_MODE_FP &&
 	    dect_setup_capability(dh, ipui) == DECT_SETUP_NO_FAST_SETUP) {
-		ddl->page_timer = dect_timer_alloc(dh);
-		if (ddl->page_timer == NULL)
-			goto err2;
-		dect_timer_setup(ddl->page_timer, dect_ddl_page_timer, ddl);
 		dect_ddl_page_timer(dh, ddl->page_timer);
 	} else {
-		ddl->dfd = dect_socket(dh, SOCK_SEQPACKET, DECT_S_SAP);
-		if (ddl->dfd == NULL)
-			goto err2;
-
 		ddl->dlei.dect_family = AF_DECT;
 		ddl->dlei.dect_index  = dh->index;
 		ddl->dlei.dect_ari = dect_build_ari(&dh->pari) >> 24;
-		ddl->dlei.dect_pmid = dh->pmid;
+		ddl->dlei.dect_pmid = dh->pp_table == NULL ? dh->pmid :
+				      dect_pp_table_pmid(dh, ddl);
 		ddl->dlei.dect_lln = 1;
 		ddl->dlei.dect_sapi = 0;
 
-		if (mcp != NULL &&
-		    setsockopt(ddl->dfd->fd, SOL_DECT, DECT_DL_MAC_CONN_PARAMS,
-			       mcp, sizeof(*mcp)) < 0)
-			goto err2;
-
-		dect_fd_setup(ddl->dfd, dect_lce_data_link_event, ddl);
-		if (dect_fd_register(dh, ddl->dfd, DECT_FD_WRITE) < 0)
+		if (dect_ddl_connect_socket(dh, ddl, mcp) < 0)
 			goto err2;
-
-		if (connect(ddl->dfd->fd, (struct sockaddr *)&ddl->dlei,
-			    sizeof(ddl->dlei)) < 0 && errno != EAGAIN)
-			goto err3;
 	}
 
-	list_add_tail(&ddl->list, &dh->links);
+	dect_ddl_link(dh, ddl);
 	return ddl;
 
-err3:
-	dect_fd_unregister(dh, ddl->dfd);
 err2:
-	dect_free(dh, ddl);
+	dect_ddl_unlink(ddl);
+	dect_ddl_free(dh, ddl);
 err1:
 	lce_debug("dect_ddl_establish: %s\n", strerror(errno));
+	dect_stats_inc(dh, lce, establish_failures);
 	return NULL;
 }
 
@@ -1019,73 +2560,293 @@ struct dect_data_link *dect_ddl_connect(struct dect_handle *dh,
 	ddl = dect_ddl_get_by_ipui(dh, ipui);
 	if (ddl == NULL)
 		ddl = dect_ddl_establish(dh, ipui, NULL);
+	else if (ddl->state == DECT_DATA_LINK_SUSPENDED &&
+		 dect_ddl_resume(dh, ddl) < 0)
+		return NULL;
 	return ddl;
 }
 
+/* Close the page transaction of the PP identity of a data link */
+static void dect_lce_page_transaction_close(struct dect_handle *dh,
+					    const struct dect_data_link *ddl)
+{
+	struct dect_transaction *ta = &dh->page_transaction;
+	struct dect_pp_identity *id;
+
+	if (dh->pp_table != NULL) {
+		id = dect_pp_identity_find(dh, ddl->ipui_key, &ddl->ipui);
+		if (id == NULL)
+			return;
+		ta = &id->page_transaction;
+	}
+
+	if (ta->state == DECT_TRANSACTION_OPEN) {
+		dect_debug(DECT_DEBUG_LCE, "\n");
+		dect_transaction_close(dh, ta, DECT_DDL_RELEASE_NORMAL);
+	}
+}
+
 static void dect_lce_data_link_event(struct dect_handle *dh,
 				     struct dect_fd *dfd, uint32_t events)
 {
 	struct dect_data_link *ddl = dfd->data;
+	unsigned int n;
 
 	dect_debug(DECT_DEBUG_LCE, "\n");
 	if (events & DECT_FD_WRITE) {
 		switch (ddl->state) {
 		case DECT_DATA_LINK_ESTABLISH_PENDING:
+		case DECT_DATA_LINK_RESUME_PENDING:
 			dect_ddl_complete_direct_establish(dh, ddl);
 			break;
+		case DECT_DATA_LINK_ESTABLISHED:
+		case DECT_DATA_LINK_SUSPEND_PENDING:
+			dect_ddl_tx_flush(dh, ddl);
+			break;
+		case DECT_DATA_LINK_RELEASE_PENDING:
+			dect_ddl_tx_flush(dh, ddl);
+			if (ptrqueue_empty(&ddl->tx_queue) &&
+			    dect_ddl_shutdown_tx(dh, ddl) < 0)
+				return;
+			break;
 		default:
 			break;
 		}
 	}
 
-	if (events & DECT_FD_READ) {
-		dect_ddl_rcv_msg(dh, ddl);
+	if (events & DECT_FD_READ) {
+		/* Drain up to rcv_budget queued messages. The link may be
+		 * destroyed while processing a message, in which case it is
+		 * freed after leaving the loop.
+		 */
+		ddl->flags |= DECT_DATA_LINK_RCV_ACTIVE;
+		for (n = 0; n < dh->rcv_budget; n++) {
+			if (dect_ddl_rcv_msg(dh, ddl) < 0)
+				break;
+			if (ddl->flags & DECT_DATA_LINK_DESTROYED)
+				break;
+			if (ddl->state == DECT_DATA_LINK_SUSPEND_PENDING)
+				break;
+		}
+
+		/* Close the page transaction after receiving the first
+		 * message, which is expected to initiate a higher layer
+		 * protocol transaction or reject the page response.
+		 */
+		dect_lce_page_transaction_close(dh, ddl);
+		ddl->flags &= ~DECT_DATA_LINK_RCV_ACTIVE;
+
+		if (ddl->flags & DECT_DATA_LINK_DESTROYED)
+			return dect_ddl_free(dh, ddl);
+	}
+
+	if (ddl->state == DECT_DATA_LINK_SUSPEND_PENDING &&
+	    ptrqueue_empty(&ddl->tx_queue))
+		dect_ddl_suspend_complete(dh, ddl);
+}
+
+/*
+ * Replay of recorded S-SAP traffic
+ *
+ * Replayed links use one end of a socketpair instead of a S-SAP socket, the
+ * other end is returned to the replay, which discards the transmitted
+ * messages. The replay notices destruction of a link by the end of file
+ * condition on its end of the socketpair.
+ */
+
+struct dect_data_link *dect_ddl_replay_open(struct dect_handle *dh, int *peer)
+{
+	struct dect_data_link *ddl;
+	int fds[2];
+
+	ddl = dect_ddl_alloc(dh);
+	if (ddl == NULL)
+		goto err1;
+	ddl->dfd = dect_fd_alloc(dh);
+	if (ddl->dfd == NULL)
+		goto err2;
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC,
+		       0, fds) < 0)
+		goto err3;
+	ddl->dfd->fd = fds[0];
+	*peer = fds[1];
+
+	dect_fd_setup(ddl->dfd, dect_lce_data_link_event, ddl);
+	if (dect_fd_register(dh, ddl->dfd, DECT_FD_READ) < 0)
+		goto err4;
+
+	ddl->state = DECT_DATA_LINK_ESTABLISHED;
+	dect_ddl_link(dh, ddl);
+	return ddl;
+
+err4:
+	close(*peer);
+err3:
+	dect_close(dh, ddl->dfd);
+err2:
+	dect_ddl_free(dh, ddl);
+err1:
+	return NULL;
+}
+
+/* Process a replayed message, returns false if the link was destroyed */
+bool dect_ddl_replay_rcv(struct dect_handle *dh, struct dect_data_link *ddl,
+			 struct dect_msg_buf *mb)
+{
+	ddl->flags |= DECT_DATA_LINK_RCV_ACTIVE;
+	dect_ddl_rcv_mb(dh, ddl, mb);
+	dect_lce_page_transaction_close(dh, ddl);
+	ddl->flags &= ~DECT_DATA_LINK_RCV_ACTIVE;
+
+	if (ddl->flags & DECT_DATA_LINK_DESTROYED) {
+		dect_ddl_free(dh, ddl);
+		return false;
+	}
+	return true;
+}
+
+void dect_ddl_replay_close(struct dect_handle *dh, struct dect_data_link *ddl)
+{
+	dect_ddl_shutdown(dh, ddl);
+}
+
+/*
+ * Admission control
+ *
+ * New links which have not sent their first message yet are counted and the
+ * S-SAP listener is unregistered when the limit is reached, so further
+ * incoming links are held back by the kernel's listen backlog instead of
+ * competing for resources. Location registration and access rights requests
+ * are admitted by the MM layer.
+ */
+
+void dect_lce_admission_init(struct dect_handle *dh)
+{
+	init_list_head(&dh->admission.queue);
+}
+
+static void dect_lce_admission_resume(struct dect_handle *dh)
+{
+	struct dect_lce_admission *adm = &dh->admission;
+
+	if (!adm->paused)
+		return;
+	if (adm->cfg.max_links &&
+	    adm->stats.pending_links >= adm->cfg.max_links)
+		return;
+	if (dect_fd_register(dh, dh->s_sap, DECT_FD_READ) < 0)
+		return;
+	lce_debug("admission: resume S-SAP listener\n");
+	adm->paused = false;
+}
+
+static void dect_ddl_admit_pending(struct dect_handle *dh,
+				   struct dect_data_link *ddl)
+{
+	struct dect_lce_admission *adm = &dh->admission;
+
+	ddl->flags |= DECT_DATA_LINK_ADMIT_PENDING;
+	adm->stats.pending_links++;
+
+	if (adm->paused || adm->cfg.max_links == 0 ||
+	    adm->stats.pending_links < adm->cfg.max_links)
+		return;
+
+	lce_debug("admission: pause S-SAP listener\n");
+	dect_fd_unregister(dh, dh->s_sap);
+	adm->paused = true;
+	adm->stats.paused++;
+}
+
+static void dect_ddl_admit(struct dect_handle *dh, struct dect_data_link *ddl)
+{
+	if (!(ddl->flags & DECT_DATA_LINK_ADMIT_PENDING))
+		return;
+	ddl->flags &= ~DECT_DATA_LINK_ADMIT_PENDING;
+	dh->admission.stats.pending_links--;
+	dect_lce_admission_resume(dh);
+}
+
+/**
+ * Configure admission control
+ *
+ * @param dh		libdect DECT handle
+ * @param cfg		admission control configuration
+ *
+ * Limit the number of new links accepted without having sent a message and
+ * the number of concurrently processed {MM-LOCATE-REQUEST} and
+ * {MM-ACCESS-RIGHTS-REQUEST} messages. Requests exceeding the limit are
+ * deferred for up to @cfg->queue_timeout milliseconds and refused using the
+ * configured reject reason when the queue is full or the timeout expires.
+ */
+void dect_lce_set_admission(struct dect_handle *dh,
+			    const struct dect_lce_admission_cfg *cfg)
+{
+	struct dect_lce_admission *adm = &dh->admission;
+
+	adm->cfg = *cfg;
+	dect_lce_admission_resume(dh);
 
-		/* Close the page transaction after receiving the first
-		 * message, which is expected to initiate a higher layer
-		 * protocol transaction or reject the page response.
-		 */
-		if (dh->page_transaction.state == DECT_TRANSACTION_OPEN) {
-			dect_debug(DECT_DEBUG_LCE, "\n");
-			dect_transaction_close(dh, &dh->page_transaction,
-					       DECT_DDL_RELEASE_NORMAL);
-		}
-	}
+	/* Let the MM layer reevaluate deferred requests */
+	if (!list_empty(&adm->queue))
+		dect_timer_start_ms(dh, adm->timer, 0);
 }
+EXPORT_SYMBOL(dect_lce_set_admission);
 
-static void dect_lce_ssap_listener_event(struct dect_handle *dh,
-					 struct dect_fd *dfd, uint32_t events)
+/**
+ * Get admission control statistics
+ *
+ * @param dh		libdect DECT handle
+ * @param stats		admission control statistics
+ */
+void dect_lce_get_admission_stats(const struct dect_handle *dh,
+				  struct dect_lce_admission_stats *stats)
+{
+	*stats = dh->admission.stats;
+}
+EXPORT_SYMBOL(dect_lce_get_admission_stats);
+
+/**
+ * dect_ddl_adopt - Set up a data link for an accepted socket
+ *
+ * @dh:		libdect DECT handle
+ * @dfd:	accepted S-SAP socket
+ * @dlei:	data link endpoint identifier
+ * @mcp:	MAC connection parameters
+ * @admit:	subject the link to admission control
+ *
+ * The socket is owned by the data link on success, otherwise it remains
+ * owned by the caller.
+ */
+int dect_ddl_adopt(struct dect_handle *dh, struct dect_fd *dfd,
+		   const struct sockaddr_dect_ssap *dlei,
+		   const struct dect_mac_conn_params *mcp, bool admit)
 {
 	struct dect_data_link *ddl;
-	struct dect_fd *nfd;
-	socklen_t optlen;
 	char buf1[128], buf2[128], buf3[128];
 
-	dect_debug(DECT_DEBUG_LCE, "\n");
+	ddl = dect_ddl_get_suspended(dh, dlei);
+	if (ddl != NULL)
+		return dect_ddl_resume_adopt(dh, ddl, dfd, dlei, mcp);
+
 	ddl = dect_ddl_alloc(dh);
 	if (ddl == NULL)
 		goto err1;
+	ddl->dfd  = dfd;
+	ddl->dlei = *dlei;
+	ddl->mcp  = *mcp;
 
-	nfd = dect_accept(dh, dfd, (struct sockaddr *)&ddl->dlei,
-			  sizeof(ddl->dlei));
-	if (nfd == NULL)
+	dect_fd_setup(dfd, dect_lce_data_link_event, ddl);
+	if (dect_fd_register(dh, dfd, DECT_FD_READ) < 0)
 		goto err2;
-	ddl->dfd = nfd;
-
-	optlen = sizeof(ddl->mcp);
-	if (getsockopt(nfd->fd, SOL_DECT, DECT_DL_MAC_CONN_PARAMS,
-		       &ddl->mcp, &optlen))
-		goto err3;
-
-	dect_fd_setup(nfd, dect_lce_data_link_event, ddl);
-	if (dect_fd_register(dh, nfd, DECT_FD_READ) < 0)
-		goto err3;
 
 	ddl->state = DECT_DATA_LINK_ESTABLISHED;
 	if (dect_ddl_schedule_sdu_timer(dh, ddl) < 0)
-		goto err4;
+		goto err3;
 
-	list_add_tail(&ddl->list, &dh->links);
+	dect_ddl_link(dh, ddl);
+	if (admit)
+		dect_ddl_admit_pending(dh, ddl);
 	ddl_debug(ddl, "new link: PMID: %x LCN: %u LLN: %u SAPI: %u",
 		  ddl->dlei.dect_pmid, ddl->dlei.dect_lcn,
 		  ddl->dlei.dect_lln, ddl->dlei.dect_sapi);
@@ -1093,17 +2854,66 @@ static void dect_lce_ssap_listener_event(struct dect_handle *dh,
 		  dect_val2str(dect_conn_types, buf1, ddl->mcp.type),
 		  dect_val2str(dect_service_types, buf2, ddl->mcp.service),
 		  dect_val2str(dect_slot_types, buf3, ddl->mcp.slot));
-	return;
+	return 0;
 
-err4:
-	dect_fd_unregister(dh, nfd);
 err3:
-	dect_close(dh, nfd);
+	dect_fd_unregister(dh, dfd);
 err2:
-	dect_free(dh, ddl);
+	dect_ddl_free(dh, ddl);
 err1:
-	lce_debug("dect_lce_ssap_listener_event: %s\n", strerror(errno));
-	return;
+	return -1;
+}
+
+static int dect_lce_ssap_accept(struct dect_handle *dh, struct dect_fd *dfd)
+{
+	struct sockaddr_dect_ssap dlei;
+	struct dect_mac_conn_params mcp;
+	struct dect_fd *nfd;
+	socklen_t optlen;
+
+	nfd = dect_accept(dh, dfd, (struct sockaddr *)&dlei, sizeof(dlei));
+	if (nfd == NULL)
+		goto err1;
+
+	optlen = sizeof(mcp);
+	if (dect_fd_getsockopt(nfd, SOL_DECT, DECT_DL_MAC_CONN_PARAMS,
+			       &mcp, &optlen))
+		goto err2;
+
+	/* Links are processed by the shard owning the PP */
+	if (dect_shard_primary(dh)) {
+		dect_shard_accept(dh, nfd, &dlei, &mcp);
+		return 0;
+	}
+
+	if (dect_ddl_adopt(dh, nfd, &dlei, &mcp, true) < 0)
+		goto err2;
+	return 0;
+
+err2:
+	dect_close(dh, nfd);
+err1:
+	return -1;
+}
+
+/* Accept up to rcv_budget pending data links, until the queue is drained */
+static void dect_lce_ssap_listener_event(struct dect_handle *dh,
+					 struct dect_fd *dfd, uint32_t events)
+{
+	unsigned int n;
+
+	dect_debug(DECT_DEBUG_LCE, "\n");
+	for (n = 0; n < dh->rcv_budget; n++) {
+		if (dect_lce_ssap_accept(dh, dfd) < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			lce_debug("dect_lce_ssap_listener_event: %s\n",
+				  strerror(errno));
+			if (errno == ENOMEM || errno == EMFILE ||
+			    errno == ENFILE)
+				break;
+		}
+	}
 }
 
 /*
@@ -1123,6 +2933,10 @@ ssize_t dect_lce_broadcast(const struct dect_handle *dh,
 	} cmsg_buf;
 	ssize_t size;
 
+	/* The B-SAP is owned by the primary handle */
+	if (dect_shard_member(dh))
+		return dect_shard_broadcast(dh, mb, long_page, fast_page);
+
 	if (long_page) {
 		memset(cmsg_buf.buf, 0, sizeof(cmsg_buf.buf));
 		msg.msg_control		= &cmsg_buf;
@@ -1144,11 +2958,274 @@ ssize_t dect_lce_broadcast(const struct dect_handle *dh,
 	}
 
 	dect_mbuf_dump(DECT_DEBUG_LCE, mb, "LCE: BCAST TX");
+	dect_trace3(lce_broadcast, mb->len, long_page, fast_page);
 	size = dect_mbuf_send(dh, dh->b_sap, &msg, mb);
 	dect_assert(size == (ssize_t)mb->len);
 	return 0;
 }
 
+/*
+ * Paging scheduler
+ *
+ * Pages are not transmitted directly, but queued per priority for the
+ * scheduler, which transmits them from a timer at most at the configured
+ * paging capacity. Pages for a TPUI already pending are merged with the
+ * pending page, so retransmissions and repeated requests during busy periods
+ * don't flood the B-SAP. Pages queued during one event loop iteration are
+ * submitted using a single sendmmsg() call per priority.
+ */
+
+/* Maximum length of a short or full page message */
+#define DECT_PAGE_MSG_MAX	5
+
+/* Maximum number of pages per sendmmsg() call */
+#define DECT_PAGE_SCHED_BATCH	16
+
+/**
+ * struct dect_page_entry - pending page
+ *
+ * @list:	scheduler queue node
+ * @tpui:	TPUI, used to merge pages
+ * @prio:	page priority
+ * @len:	message length
+ * @data:	page message
+ */
+struct dect_page_entry {
+	struct list_head		list;
+	uint32_t			tpui;
+	enum dect_page_prios		prio;
+	uint8_t				len;
+	uint8_t				data[DECT_PAGE_MSG_MAX];
+};
+
+static void dect_page_sched_timer(struct dect_handle *dh,
+				  struct dect_timer *timer);
+
+void dect_page_sched_init(struct dect_handle *dh)
+{
+	struct dect_page_sched *ps = &dh->page_sched;
+	unsigned int prio;
+
+	for (prio = 0; prio <= DECT_PAGE_PRIO_MAX; prio++)
+		init_list_head(&ps->queue[prio]);
+	ps->cfg.max_depth = DECT_PAGE_DEPTH_DEFAULT;
+	ps->cfg.rate	  = DECT_PAGE_RATE_DEFAULT;
+	ps->cfg.burst	  = DECT_PAGE_BURST_DEFAULT;
+}
+
+static int dect_page_sched_open(struct dect_handle *dh)
+{
+	struct dect_page_sched *ps = &dh->page_sched;
+
+	ps->timer = dect_timer_alloc(dh);
+	if (ps->timer == NULL)
+		return -1;
+	dect_timer_setup(ps->timer, dect_page_sched_timer, NULL);
+	return 0;
+}
+
+static void dect_page_sched_flush(struct dect_handle *dh)
+{
+	struct dect_page_sched *ps = &dh->page_sched;
+	struct dect_page_entry *pe, *next;
+	unsigned int prio;
+
+	for (prio = 0; prio <= DECT_PAGE_PRIO_MAX; prio++) {
+		list_for_each_entry_safe(pe, next, &ps->queue[prio], list) {
+			list_del(&pe->list);
+			dect_free(dh, pe);
+		}
+	}
+	ps->stats.depth = 0;
+
+	if (dect_timer_running(ps->timer))
+		dect_timer_stop(dh, ps->timer);
+	dect_timer_free(dh, ps->timer);
+	ps->timer = NULL;
+}
+
+static struct dect_page_entry *dect_page_lookup(const struct dect_page_sched *ps,
+						uint32_t tpui)
+{
+	struct dect_page_entry *pe;
+	unsigned int prio;
+
+	for (prio = 0; prio <= DECT_PAGE_PRIO_MAX; prio++) {
+		list_for_each_entry(pe, &ps->queue[prio], list) {
+			if (pe->tpui == tpui)
+				return pe;
+		}
+	}
+	return NULL;
+}
+
+int dect_lce_page_queue(struct dect_handle *dh, const struct dect_msg_buf *mb,
+			uint32_t tpui, bool fast_page)
+{
+	struct dect_page_sched *ps = &dh->page_sched;
+	enum dect_page_prios prio;
+	struct dect_page_entry *pe;
+
+	/* Pages are scheduled by the primary handle for the entire cluster */
+	if (dect_shard_member(dh))
+		return dect_shard_page(dh, mb, tpui, fast_page);
+
+	prio = fast_page ? DECT_PAGE_PRIO_FAST : DECT_PAGE_PRIO_NORMAL;
+
+	/* Merge with a pending page, the newer contents take precedence */
+	pe = dect_page_lookup(ps, tpui);
+	if (pe != NULL) {
+		if (prio < pe->prio) {
+			pe->prio = prio;
+			list_move_tail(&pe->list, &ps->queue[prio]);
+		}
+		ps->stats.coalesced++;
+		goto update;
+	}
+
+	if (ps->stats.depth >= ps->cfg.max_depth) {
+		/* Fast pages displace the oldest normal page */
+		if (prio != DECT_PAGE_PRIO_FAST ||
+		    list_empty(&ps->queue[DECT_PAGE_PRIO_NORMAL])) {
+			ps->stats.dropped++;
+			errno = ENOBUFS;
+			return -1;
+		}
+		pe = list_first_entry(&ps->queue[DECT_PAGE_PRIO_NORMAL],
+				      struct dect_page_entry, list);
+		list_del(&pe->list);
+		ps->stats.dropped++;
+	} else {
+		pe = dect_malloc(dh, sizeof(*pe));
+		if (pe == NULL)
+			return -1;
+		ps->stats.depth++;
+		ps->stats.peak = max(ps->stats.peak, ps->stats.depth);
+	}
+
+	pe->tpui = tpui;
+	pe->prio = prio;
+	list_add_tail(&pe->list, &ps->queue[prio]);
+	ps->stats.queued++;
+update:
+	memcpy(pe->data, mb->data, mb->len);
+	pe->len = mb->len;
+
+	/* Defer transmission to collect the pages of this event loop iteration */
+	if (!dect_timer_running(ps->timer))
+		dect_timer_start_ms(dh, ps->timer, 0);
+	return 0;
+}
+
+/* Transmit up to @n pages of priority @prio, returns the number of pages sent */
+static unsigned int dect_page_sched_send(struct dect_handle *dh,
+					 enum dect_page_prios prio,
+					 unsigned int n)
+{
+	struct dect_page_sched *ps = &dh->page_sched;
+	struct dect_page_entry *pes[DECT_PAGE_SCHED_BATCH], *pe;
+	struct mmsghdr msgs[DECT_PAGE_SCHED_BATCH];
+	struct iovec iov[DECT_PAGE_SCHED_BATCH];
+	unsigned int i, cnt, sent = 0;
+	int flags, err;
+
+	flags = MSG_NOSIGNAL;
+	if (prio == DECT_PAGE_PRIO_FAST)
+		flags |= MSG_OOB;
+
+	while (sent < n && !list_empty(&ps->queue[prio])) {
+		memset(msgs, 0, sizeof(msgs));
+		cnt = 0;
+		list_for_each_entry(pe, &ps->queue[prio], list) {
+			if (cnt == min(n - sent, (unsigned int)DECT_PAGE_SCHED_BATCH))
+				break;
+			iov[cnt].iov_base		= pe->data;
+			iov[cnt].iov_len		= pe->len;
+			msgs[cnt].msg_hdr.msg_iov	= &iov[cnt];
+			msgs[cnt].msg_hdr.msg_iovlen	= 1;
+			pes[cnt++] = pe;
+		}
+
+		err = dect_fd_sendmmsg(dh->b_sap, msgs, cnt, flags);
+		if (err < 0) {
+			if (errno == EAGAIN)
+				break;
+			lce_debug("sendmmsg: %s\n", strerror(errno));
+			/* Drop the pages instead of retrying indefinitely */
+			err = cnt;
+			ps->stats.dropped += cnt;
+		} else
+			ps->stats.sent += err;
+		ps->stats.batches++;
+
+		for (i = 0; i < (unsigned int)err; i++) {
+			dect_hexdump(DECT_DEBUG_LCE, "LCE: BCAST TX",
+				     pes[i]->data, pes[i]->len);
+			list_del(&pes[i]->list);
+			dect_free(dh, pes[i]);
+		}
+		ps->stats.depth -= err;
+		sent += err;
+		if ((unsigned int)err < cnt)
+			break;
+	}
+	return sent;
+}
+
+static void dect_page_sched_timer(struct dect_handle *dh,
+				  struct dect_timer *timer)
+{
+	struct dect_page_sched *ps = &dh->page_sched;
+	uint64_t now = dect_timer_now();
+	unsigned int budget, n, prio;
+
+	/* Refill the token bucket at the paging capacity */
+	ps->tokens += (now - ps->last) * ps->cfg.rate;
+	ps->tokens  = min(ps->tokens, (uint64_t)ps->cfg.burst * 1000);
+	ps->last    = now;
+
+	budget = n = ps->tokens / 1000;
+	for (prio = 0; prio <= DECT_PAGE_PRIO_MAX && n > 0; prio++)
+		n -= dect_page_sched_send(dh, prio, n);
+	ps->tokens -= (uint64_t)(budget - n) * 1000;
+
+	if (ps->stats.depth > 0)
+		dect_timer_start_ms(dh, ps->timer, DECT_PAGE_SCHED_INTERVAL);
+}
+
+/**
+ * Configure the LCE paging scheduler
+ *
+ * @param dh		libdect DECT handle
+ * @param cfg		paging scheduler configuration
+ *
+ * Pending pages exceeding a reduced queue depth remain queued.
+ */
+int dect_lce_set_page_cfg(struct dect_handle *dh,
+			  const struct dect_lce_page_cfg *cfg)
+{
+	if (cfg->max_depth == 0 || cfg->rate == 0 || cfg->burst == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+	dh->page_sched.cfg = *cfg;
+	return 0;
+}
+EXPORT_SYMBOL(dect_lce_set_page_cfg);
+
+/**
+ * Get LCE paging scheduler statistics
+ *
+ * @param dh		libdect DECT handle
+ * @param stats		paging scheduler statistics
+ */
+void dect_lce_get_page_stats(const struct dect_handle *dh,
+			     struct dect_lce_page_stats *stats)
+{
+	*stats = dh->page_sched.stats;
+}
+EXPORT_SYMBOL(dect_lce_get_page_stats);
+
 static enum lce_request_page_hdr_codes
 dect_page_service_to_hdr(enum dect_mac_service_types service)
 {
@@ -1237,137 +3314,389 @@ dect_page_service_to_setup_info(const struct dect_mac_conn_params *mcp)
 		return DECT_LCE_PAGE_NO_SETUP_INFO;
 }
 
-/**
- * Request collective or group ringing
+/**
+ * Request collective or group ringing
+ *
+ * @param dh		libdect DECT handle
+ * @param pattern	ring pattern
+ */
+int dect_lce_group_ring_req(struct dect_handle *dh,
+			    enum dect_alerting_patterns pattern)
+{
+	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
+	struct dect_short_page_msg *msg;
+	uint16_t page;
+
+	dect_debug(DECT_DEBUG_LCE, "\nLCE: LCE_GROUP_RING-req\n");
+	msg = dect_mbuf_put(mb, sizeof(*msg));
+
+	msg->hdr  = DECT_LCE_PAGE_W_FLAG;
+	msg->hdr |= DECT_LCE_PAGE_GENERAL_VOICE;
+
+	page = pattern << DECT_LCE_SHORT_PAGE_RING_PATTERN_SHIFT;
+	page = 0;
+	page |= DECT_TPUI_CBI & DECT_LCE_SHORT_PAGE_TPUI_MASK;
+	msg->information = __cpu_to_be16(page);
+
+	return dect_lce_page_queue(dh, mb, DECT_TPUI_CBI, false);
+}
+EXPORT_SYMBOL(dect_lce_group_ring_req);
+
+static void dect_lce_build_short_page(struct dect_msg_buf *mb,
+				      const struct dect_tpui *tpui, bool assigned,
+				      const struct dect_mac_conn_params *mcp)
+{
+	struct dect_short_page_msg *msg;
+	uint16_t page;
+
+	msg = dect_mbuf_put(mb, sizeof(*msg));
+	msg->hdr = dect_page_service_to_hdr(mcp->service);
+	if (assigned)
+		msg->hdr |= DECT_LCE_PAGE_W_FLAG;
+
+	page = dect_build_tpui(tpui) & DECT_LCE_SHORT_PAGE_TPUI_MASK;
+	msg->information = __cpu_to_be16(page);
+}
+
+static void dect_lce_build_full_page(struct dect_msg_buf *mb,
+				     const struct dect_tpui *tpui,
+				     const struct dect_mac_conn_params *mcp)
+{
+	struct dect_full_page_msg *msg;
+	uint32_t page;
+
+	msg = dect_mbuf_put(mb, sizeof(*msg));
+	msg->hdr  = dect_page_service_to_hdr(mcp->service);
+	msg->hdr |= DECT_LCE_PAGE_W_FLAG;
+
+	page  = dect_build_tpui(tpui) << DECT_LCE_FULL_PAGE_TPUI_SHIFT;
+	page |= dect_page_slot_to_info(mcp->slot) <<
+		DECT_LCE_FULL_PAGE_SLOT_TYPE_SHIFT;
+	page |= dect_page_service_to_setup_info(mcp) <<
+		DECT_LCE_FULL_PAGE_SETUP_INFO_SHIFT;
+	msg->information = __cpu_to_be32(page);
+}
+
+static void dect_lce_build_page(struct dect_msg_buf *mb,
+				const struct dect_tpui *tpui, bool assigned,
+				const struct dect_mac_conn_params *mcp)
+{
+	if (mcp->service == DECT_SERVICE_IN_MIN_DELAY &&
+	    mcp->slot == DECT_FULL_SLOT)
+		dect_lce_build_short_page(mb, tpui, assigned, mcp);
+	else
+		dect_lce_build_full_page(mb, tpui, mcp);
+}
+
+static int dect_lce_page_tpui(struct dect_handle *dh,
+			      const struct dect_tpui *tpui, bool assigned,
+			      const struct dect_mac_conn_params *mcp,
+			      bool fast_page)
+{
+	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
+
+	dect_lce_build_page(mb, tpui, assigned, mcp);
+	return dect_lce_page_queue(dh, mb, dect_build_tpui(tpui), fast_page);
+}
+
+static bool dect_lce_fast_page(const struct dect_handle *dh,
+			       const struct dect_ipui *ipui)
+{
+	return dect_page_capability(dh, ipui) ==
+	       DECT_PAGE_CAPABILITY_FAST_AND_NORMAL_PAGING;
+}
+
+/* Build the page message of a PT for the service and slot type of @mcp */
+static void dect_lte_build_page(struct dect_lte *lte,
+				const struct dect_mac_conn_params *mcp)
+{
+	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
+	struct dect_lte_page *page = &lte->page;
+	const struct dect_tpui *tpui;
+	struct dect_tpui _tpui;
+
+	if (lte->tpui_valid)
+		tpui = &lte->tpui;
+	else
+		tpui = dect_ipui_to_tpui(&_tpui, &lte->ipui);
+
+	dect_lce_build_page(mb, tpui, lte->tpui_valid, mcp);
+	memcpy(page->msg, mb->data, mb->len);
+	page->len	= mb->len;
+	page->tpui	= dect_build_tpui(tpui);
+	page->service	= mcp->service;
+	page->slot	= mcp->slot;
+	page->fast_page	= lte->setup_capability != NULL &&
+			  lte->setup_capability->page_capability ==
+			  DECT_PAGE_CAPABILITY_FAST_AND_NORMAL_PAGING;
+	page->valid	= true;
+}
+
+static int dect_lce_page(struct dect_handle *dh,
+			 const struct dect_ipui *ipui,
+			 const struct dect_mac_conn_params *mcp)
+{
+	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
+	const struct dect_lte_page *page;
+	struct dect_lte *lte;
+	struct dect_tpui tpui;
+
+	lte = dect_lte_get_by_ipui(dh, ipui);
+	if (lte == NULL)
+		return dect_lce_page_tpui(dh, dect_ipui_to_tpui(&tpui, ipui),
+					  false, mcp, false);
+
+	page = &lte->page;
+	if (!page->valid || page->service != mcp->service ||
+	    page->slot != mcp->slot)
+		dect_lte_build_page(lte, mcp);
+
+	memcpy(dect_mbuf_put(mb, page->len), page->msg, page->len);
+	return dect_lce_page_queue(dh, mb, page->tpui, page->fast_page);
+}
+
+/*
+ * Pages are retransmitted once the response is overdue, but the last page
+ * waits for the remainder of N.300 times LCE.03 since the first one, so a
+ * PP with a long paging cycle still has the full page-out to respond.
+ */
+static unsigned int dect_ddl_page_timeout(const struct dect_data_link *ddl)
+{
+	uint64_t elapsed;
+
+	if (ddl->page_count < DECT_DDL_PAGE_RETRANS_MAX)
+		return dect_ddl_rto(ddl, DECT_RTT_PAGE,
+				    DECT_DDL_PAGE_TIMEOUT * 1000);
+
+	elapsed = (dect_stats_clock() - ddl->establish_time) / 1000;
+	if (elapsed + DECT_DDL_RTO_MIN >= DECT_DDL_PAGE_TOTAL_TIMEOUT)
+		return DECT_DDL_RTO_MIN;
+	return DECT_DDL_PAGE_TOTAL_TIMEOUT - elapsed;
+}
+
+static void dect_ddl_page_timer(struct dect_handle *dh, struct dect_timer *timer)
+{
+	struct dect_data_link *ddl = timer->data;
+
+	if (ddl->page_count) {
+		dect_debug(DECT_DEBUG_LCE, "\n");
+		ddl_debug(ddl, "<LCE.03>: Page timer");
+	}
+
+	if (ddl->page_count++ == DECT_DDL_PAGE_RETRANS_MAX) {
+		ddl_debug(ddl, "DL_ESTABLISH-cfm: success: 0");
+		dect_stats_inc(dh, lce, establish_failures);
+		dh->ops->lce_ops->dl_establish_cfm(dh, false, NULL, NULL);
+		dect_ddl_dump_history(ddl);
+		dect_ddl_shutdown(dh, ddl);
+	} else {
+		if (ddl->page_count > 1)
+			dect_stats_inc(dh, lce, page_retransmissions);
+		dect_lce_page(dh, &ddl->ipui, &ddl->mcp);
+		dect_timer_start_ms(dh, ddl->page_timer,
+				    dect_ddl_page_timeout(ddl));
+	}
+}
+
+/*
+ * Group paging
  *
- * @param dh		libdect DECT handle
- * @param pattern	ring pattern
+ * A group page establishes links to a set of PPs, for instance the members
+ * of a hunt group. All member links share a single page timer, the members
+ * are paged either using a common group TPUI or individually, in which case
+ * the pages are merged into batches by the paging scheduler. Once the first
+ * member answers, the remaining member links are released.
  */
-int dect_lce_group_ring_req(struct dect_handle *dh,
-			    enum dect_alerting_patterns pattern)
-{
-	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
-	struct dect_short_page_msg *msg;
-	uint16_t page;
 
-	dect_debug(DECT_DEBUG_LCE, "\nLCE: LCE_GROUP_RING-req\n");
-	msg = dect_mbuf_put(mb, sizeof(*msg));
+static void dect_lce_group_page_free(struct dect_handle *dh,
+				     struct dect_lce_group_page *gp)
+{
+	if (dect_timer_running(gp->timer))
+		dect_timer_stop(dh, gp->timer);
+	dect_timer_free(dh, gp->timer);
+	dect_free(dh, gp);
+}
 
-	msg->hdr  = DECT_LCE_PAGE_W_FLAG;
-	msg->hdr |= DECT_LCE_PAGE_GENERAL_VOICE;
+/* Called when a member link is destroyed */
+static void dect_lce_group_page_unlink(struct dect_handle *dh,
+				       struct dect_data_link *ddl)
+{
+	struct dect_lce_group_page *gp = ddl->group;
+	unsigned int i;
 
-	page = pattern << DECT_LCE_SHORT_PAGE_RING_PATTERN_SHIFT;
-	page = 0;
-	page |= DECT_TPUI_CBI & DECT_LCE_SHORT_PAGE_TPUI_MASK;
-	msg->information = __cpu_to_be16(page);
+	for (i = 0; i < gp->size; i++) {
+		if (gp->links[i] == ddl)
+			gp->links[i] = NULL;
+	}
+	ddl->group = NULL;
 
-	return dect_lce_broadcast(dh, mb, false, false);
+	if (--gp->active == 0 && !gp->busy)
+		dect_lce_group_page_free(dh, gp);
 }
-EXPORT_SYMBOL(dect_lce_group_ring_req);
 
-static int dect_lce_send_short_page(const struct dect_handle *dh,
-				    const struct dect_ipui *ipui,
-				    const struct dect_mac_conn_params *mcp)
+/* Release all member links except @keep */
+static void dect_lce_group_page_release(struct dect_handle *dh,
+					struct dect_lce_group_page *gp,
+					const struct dect_data_link *keep)
 {
-	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
-	struct dect_short_page_msg *msg;
-	const struct dect_tpui *tpui;
-	struct dect_tpui _tpui;
-	bool fast_page = false;
-	uint16_t page;
-
-	msg = dect_mbuf_put(mb, sizeof(*msg));
-	msg->hdr = dect_page_service_to_hdr(mcp->service);
-
-	tpui = dect_tpui(dh, ipui);
-	if (tpui == NULL)
-		tpui = dect_ipui_to_tpui(&_tpui, ipui);
-	else
-		msg->hdr |= DECT_LCE_PAGE_W_FLAG;
+	unsigned int i;
 
-	page = dect_build_tpui(tpui) & DECT_LCE_SHORT_PAGE_TPUI_MASK;
-	msg->information = __cpu_to_be16(page);
+	if (dect_timer_running(gp->timer))
+		dect_timer_stop(dh, gp->timer);
 
-	if (dect_page_capability(dh, ipui) ==
-	    DECT_PAGE_CAPABILITY_FAST_AND_NORMAL_PAGING)
-		fast_page = true;
+	gp->busy = true;
+	for (i = 0; i < gp->size; i++) {
+		if (gp->links[i] != NULL && gp->links[i] != keep)
+			dect_ddl_shutdown(dh, gp->links[i]);
+	}
+	gp->busy = false;
 
-	return dect_lce_broadcast(dh, mb, false, fast_page);
+	if (gp->active == 0)
+		dect_lce_group_page_free(dh, gp);
 }
 
-static int dect_lce_send_full_page(const struct dect_handle *dh,
-				   const struct dect_ipui *ipui,
-				   const struct dect_mac_conn_params *mcp)
+static void dect_lce_group_page_send(struct dect_handle *dh,
+				     const struct dect_lce_group_page *gp)
 {
-	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
-	struct dect_full_page_msg *msg;
-	const struct dect_tpui *tpui;
-	struct dect_tpui _tpui;
-	uint8_t ipui_buf[8];
-	bool fast_page = false;
-	uint32_t page;
+	bool fast_page = true;
+	unsigned int i;
 
-	msg = dect_mbuf_put(mb, sizeof(*msg));
-	msg->hdr = dect_page_service_to_hdr(mcp->service);
+	for (i = 0; i < gp->size; i++) {
+		if (gp->links[i] == NULL)
+			continue;
+		if (!gp->group_tpui)
+			dect_lce_page(dh, &gp->links[i]->ipui, &gp->mcp);
+		else if (!dect_lce_fast_page(dh, &gp->links[i]->ipui))
+			fast_page = false;
+	}
 
-	if (1) {
-		msg->hdr |= DECT_LCE_PAGE_W_FLAG;
+	if (gp->group_tpui)
+		dect_lce_page_tpui(dh, &gp->tpui, true, &gp->mcp, fast_page);
+}
 
-		tpui = dect_tpui(dh, ipui);
-		if (tpui == NULL)
-			tpui = dect_ipui_to_tpui(&_tpui, ipui);
+static void dect_lce_group_page_timer(struct dect_handle *dh,
+				      struct dect_timer *timer)
+{
+	struct dect_lce_group_page *gp = timer->data;
 
-		page  = dect_build_tpui(tpui) << DECT_LCE_FULL_PAGE_TPUI_SHIFT;
-		page |= dect_page_slot_to_info(mcp->slot) <<
-			DECT_LCE_FULL_PAGE_SLOT_TYPE_SHIFT;
-		page |= dect_page_service_to_setup_info(mcp) <<
-			DECT_LCE_FULL_PAGE_SETUP_INFO_SHIFT;
-	} else {
-		dect_build_ipui(ipui_buf, ipui);
-		page  = ipui->put << 24;
-		page |= (ipui_buf[1] & 0x0f) << 24;
-		page |= ipui_buf[2] << 16;
-		page |= ipui_buf[3] << 8;
-		page |= ipui_buf[4];
+	if (gp->page_count) {
+		dect_debug(DECT_DEBUG_LCE, "\n");
+		lce_debug("<LCE.03>: Group page timer\n");
 	}
-	msg->information = __cpu_to_be32(page);
 
-	if (dect_page_capability(dh, ipui) ==
-	    DECT_PAGE_CAPABILITY_FAST_AND_NORMAL_PAGING)
-		fast_page = true;
-
-	return dect_lce_broadcast(dh, mb, false, fast_page);
+	if (gp->page_count++ == DECT_DDL_PAGE_RETRANS_MAX) {
+		lce_debug("DL_ESTABLISH-cfm: success: 0\n");
+		dect_stats_inc(dh, lce, establish_failures);
+		dh->ops->lce_ops->dl_establish_cfm(dh, false, NULL, NULL);
+		dect_lce_group_page_release(dh, gp, NULL);
+	} else {
+		if (gp->page_count > 1)
+			dect_stats_inc(dh, lce, page_retransmissions);
+		dect_lce_group_page_send(dh, gp);
+		dect_timer_start(dh, gp->timer, DECT_DDL_PAGE_TIMEOUT);
+	}
 }
 
-static int dect_lce_page(const struct dect_handle *dh,
-			 const struct dect_ipui *ipui,
-			 const struct dect_mac_conn_params *mcp)
+/* Called when @req is completed by a page response */
+static void dect_lce_group_page_complete(struct dect_handle *dh,
+					 struct dect_data_link *req)
 {
-	if (mcp->service == DECT_SERVICE_IN_MIN_DELAY &&
-	    mcp->slot == DECT_FULL_SLOT)
-		return dect_lce_send_short_page(dh, ipui, mcp);
-	else
-		return dect_lce_send_full_page(dh, ipui, mcp);
+	ddl_debug(req, "group page answered");
+	dect_lce_group_page_release(dh, req->group, req);
 }
 
-static void dect_ddl_page_timer(struct dect_handle *dh, struct dect_timer *timer)
+/**
+ * Page a group of PPs
+ *
+ * @param dh		libdect DECT handle
+ * @param ipuis		IPUIs of the group members
+ * @param n		number of group members
+ * @param tpui		group TPUI assigned to all members or NULL
+ * @param mcp		MAC connection parameters or NULL for the defaults
+ *
+ * Establish a data link to the first member of the group answering the page.
+ * When @tpui is given, a single page addressed to the group TPUI is
+ * transmitted, otherwise the members are paged using their individual TPUIs.
+ * The outcome is reported with a single invocation of the DL_ESTABLISH-cfm
+ * primitive, after which the returned group page is released.
+ *
+ * @return a group page handle or NULL on error.
+ */
+struct dect_lce_group_page *
+dect_lce_group_page_req(struct dect_handle *dh, const struct dect_ipui *ipuis,
+			unsigned int n, const struct dect_tpui *tpui,
+			const struct dect_mac_conn_params *mcp)
 {
-	struct dect_data_link *ddl = timer->data;
+	struct dect_lce_group_page *gp;
+	struct dect_data_link *ddl;
+	unsigned int i;
 
-	if (ddl->page_count) {
-		dect_debug(DECT_DEBUG_LCE, "\n");
-		ddl_debug(ddl, "<LCE.03>: Page timer");
+	lce_debug("LCE_GROUP_PAGE-req: %u members\n", n);
+	if (n == 0) {
+		errno = EINVAL;
+		goto err1;
 	}
 
-	if (ddl->page_count++ == DECT_DDL_PAGE_RETRANS_MAX) {
-		ddl_debug(ddl, "DL_ESTABLISH-cfm: success: 0");
-		dh->ops->lce_ops->dl_establish_cfm(dh, false, NULL, NULL);
-		dect_ddl_shutdown(dh, ddl);
-	} else {
-		dect_lce_page(dh, &ddl->ipui, &ddl->mcp);
-		dect_timer_start(dh, ddl->page_timer, DECT_DDL_PAGE_TIMEOUT);
+	gp = dect_zalloc(dh, sizeof(*gp) + n * sizeof(gp->links[0]));
+	if (gp == NULL)
+		goto err1;
+	gp->size = n;
+	gp->mcp  = mcp ? *mcp : default_mcp;
+	if (tpui != NULL) {
+		gp->tpui       = *tpui;
+		gp->group_tpui = true;
+	}
+
+	gp->timer = dect_timer_alloc(dh);
+	if (gp->timer == NULL)
+		goto err2;
+	dect_timer_setup(gp->timer, dect_lce_group_page_timer, gp);
+
+	for (i = 0; i < n; i++) {
+		ddl = dect_ddl_alloc(dh);
+		if (ddl == NULL)
+			goto err3;
+		ddl->mcp   = gp->mcp;
+		ddl->state = DECT_DATA_LINK_ESTABLISH_PENDING;
+		ddl->group = gp;
+		ddl->establish_time = dect_stats_clock();
+		dect_ddl_set_ipui(dh, ddl, &ipuis[i]);
+		dect_ddl_link(dh, ddl);
+
+		gp->links[i] = ddl;
+		gp->active++;
 	}
+
+	dect_lce_group_page_timer(dh, gp->timer);
+	return gp;
+
+err3:
+	/* Frees the group page once all members are released */
+	dect_lce_group_page_release(dh, gp, NULL);
+	goto err1;
+err2:
+	dect_free(dh, gp);
+err1:
+	lce_debug("dect_lce_group_page_req: %s\n", strerror(errno));
+	return NULL;
+}
+EXPORT_SYMBOL(dect_lce_group_page_req);
+
+/**
+ * Cancel a group page
+ *
+ * @param dh		libdect DECT handle
+ * @param gp		group page
+ *
+ * Release all member links. The DL_ESTABLISH-cfm primitive is not invoked.
+ */
+void dect_lce_group_page_cancel(struct dect_handle *dh,
+				struct dect_lce_group_page *gp)
+{
+	lce_debug("LCE_GROUP_PAGE-cancel\n");
+	dect_lce_group_page_release(dh, gp, NULL);
 }
+EXPORT_SYMBOL(dect_lce_group_page_cancel);
 
 static int dect_lce_send_page_reject(const struct dect_handle *dh,
 				     struct dect_transaction *ta,
@@ -1390,23 +3719,38 @@ static void dect_lce_rcv_page_response(struct dect_handle *dh,
 				       struct dect_transaction *ta,
 				       struct dect_msg_buf *mb)
 {
+	const struct dect_sfmt_msg_desc *desc = &lce_page_response_msg_desc;
 	struct dect_lce_page_response_msg msg;
+	struct dect_sfmt_msg_view view;
 	struct dect_data_link *i, *req = NULL;
+	const struct dect_ipui *ipui;
+	struct hlist_node *pos;
 	enum dect_sfmt_error err;
 	bool reject = true;
+	uint64_t key;
 
 	ddl_debug(ta->link, "LCE-PAGE-RESPONSE");
-	err = dect_parse_sfmt_msg(dh, &lce_page_response_msg_desc,
-				  &msg.common, mb);
-	if (err < 0) {
-		dect_lce_send_page_reject(dh, ta, NULL, dect_sfmt_reject_reason(err));
-		return dect_ddl_release(dh, ta->link);
+	/*
+	 * Responses to pages of the LCE itself only need the portable
+	 * identity, the remaining IEs are only parsed for the application.
+	 */
+	err = dect_parse_sfmt_msg_lazy(dh, desc, &msg.common, mb, &view);
+	if (err < 0)
+		goto err1;
+	if (dect_msg_ie(dh, desc, &msg, portable_identity) == NULL) {
+		err = DECT_SFMT_MANDATORY_IE_ERROR;
+		goto err2;
 	}
 
-	list_for_each_entry(i, &dh->links, list) {
-		if (dect_ipui_cmp(&i->ipui, &msg.portable_identity->ipui))
+	ipui = &msg.portable_identity->ipui;
+	key  = dect_ipui_key(ipui);
+	hlist_for_each_entry(i, pos, &dh->link_ipui_hash[dect_link_ipui_hash(key)],
+			     ipui_node) {
+		if (!dect_ipui_key_eq(i->ipui_key, &i->ipui, key, ipui))
 			continue;
-		if (i->state != DECT_DATA_LINK_ESTABLISH_PENDING)
+		if (i->state != DECT_DATA_LINK_ESTABLISH_PENDING &&
+		    i->state != DECT_DATA_LINK_SUSPENDED &&
+		    i->state != DECT_DATA_LINK_RESUME_PENDING)
 			continue;
 		req = i;
 		break;
@@ -1422,6 +3766,11 @@ static void dect_lce_rcv_page_response(struct dect_handle *dh,
 		if (param == NULL)
 			goto err;
 
+		dect_msg_ie(dh, desc, &msg, fixed_identity);
+		dect_msg_ie(dh, desc, &msg, nwk_assigned_identity);
+		dect_msg_ie(dh, desc, &msg, cipher_info);
+		dect_msg_ie(dh, desc, &msg, escape_to_proprietary);
+
 		param->portable_identity	= dect_ie_hold(msg.portable_identity);
 		param->fixed_identity		= dect_ie_hold(msg.fixed_identity);
 		param->nwk_assigned_identity	= dect_ie_hold(msg.nwk_assigned_identity);
@@ -1440,7 +3789,14 @@ err:
 		dect_ddl_release(dh, ta->link);
 	}
 
-	dect_msg_free(dh, &lce_page_response_msg_desc, &msg.common);
+	dect_msg_free(dh, desc, &msg.common);
+	return;
+
+err2:
+	dect_msg_free(dh, desc, &msg.common);
+err1:
+	dect_lce_send_page_reject(dh, ta, NULL, dect_sfmt_reject_reason(err));
+	dect_ddl_release(dh, ta->link);
 }
 
 static void dect_lce_rcv_page_reject(struct dect_handle *dh,
@@ -1448,18 +3804,20 @@ static void dect_lce_rcv_page_reject(struct dect_handle *dh,
 				     struct dect_msg_buf *mb)
 {
 	struct dect_lce_page_reject_msg msg;
+	struct dect_sfmt_msg_view view;
 
+	/* Only the structure is checked, none of the IEs is used */
 	ddl_debug(ta->link, "LCE-PAGE-REJECT");
-	if (dect_parse_sfmt_msg(dh, &lce_page_reject_msg_desc,
-				&msg.common, mb) < 0)
+	if (dect_parse_sfmt_msg_lazy(dh, &lce_page_reject_msg_desc,
+				     &msg.common, mb, &view) < 0)
 		return;
 	dect_msg_free(dh, &lce_page_reject_msg_desc, &msg.common);
 }
 
-static void dect_lce_send_page_response(struct dect_handle *dh,
-					const struct dect_mac_conn_params *mcp)
+static int dect_lce_send_page_response_msg(const struct dect_handle *dh,
+					   struct dect_transaction *ta,
+					   const struct dect_ipui *ipui)
 {
-	struct dect_data_link *ddl;
 	struct dect_ie_portable_identity portable_identity;
 	struct dect_ie_fixed_identity fixed_identity;
 	struct dect_lce_page_response_msg msg = {
@@ -1468,33 +3826,112 @@ static void dect_lce_send_page_response(struct dect_handle *dh,
 	};
 
 	portable_identity.type = DECT_PORTABLE_ID_TYPE_IPUI;
-	portable_identity.ipui = dh->ipui;
+	portable_identity.ipui = *ipui;
 
 	fixed_identity.type    = DECT_FIXED_ID_TYPE_PARK;
 	fixed_identity.ari     = dh->pari;
 
-	ddl = dect_ddl_establish(dh, &dh->ipui, mcp);
+	return dect_lce_send(dh, ta, &lce_page_response_msg_desc,
+			     &msg.common, DECT_LCE_PAGE_RESPONSE);
+}
+
+/*
+ * Identify the PP on a resumed link unless its PMID is an assigned
+ * individual TPUI, the FP otherwise can't tell the MAC connection apart
+ * from a new link of a different PP.
+ */
+static void dect_lce_send_identity(struct dect_handle *dh,
+				   struct dect_data_link *ddl)
+{
+	struct dect_transaction *ta = &dh->page_transaction;
+	struct dect_pp_identity *id;
+	struct dect_pmid pmid;
+
+	dect_parse_pmid(&pmid, ddl->dlei.dect_pmid);
+	if (pmid.type == DECT_PMID_ASSIGNED ||
+	    !(ddl->flags & DECT_DATA_LINK_IPUI_VALID))
+		return;
+
+	if (dh->pp_table != NULL) {
+		id = dect_pp_identity_find(dh, ddl->ipui_key, &ddl->ipui);
+		if (id == NULL)
+			return;
+		ta = &id->page_transaction;
+	}
+
+	if (ta->state == DECT_TRANSACTION_OPEN ||
+	    dect_ddl_transaction_open(dh, ta, ddl, DECT_PD_LCE) < 0)
+		return;
+	dect_lce_send_page_response_msg(dh, ta, &ddl->ipui);
+}
+
+static void dect_lce_send_page_response(struct dect_handle *dh,
+					const struct dect_ipui *ipui,
+					struct dect_transaction *ta,
+					const struct dect_mac_conn_params *mcp)
+{
+	struct dect_data_link *ddl;
+
+	/* A suspended link is resumed, identifying itself if necessary */
+	ddl = dect_ddl_get_by_ipui(dh, ipui);
+	if (ddl != NULL && (ddl->state == DECT_DATA_LINK_SUSPENDED ||
+			    ddl->state == DECT_DATA_LINK_RESUME_PENDING)) {
+		if (ddl->state == DECT_DATA_LINK_SUSPENDED)
+			dect_ddl_resume(dh, ddl);
+		return;
+	}
+
+	ddl = dect_ddl_establish(dh, ipui, mcp);
 	if (ddl == NULL)
 		return;
 
-	if (dect_ddl_transaction_open(dh, &dh->page_transaction, ddl,
-				      DECT_PD_LCE) < 0)
+	if (dect_ddl_transaction_open(dh, ta, ddl, DECT_PD_LCE) < 0)
 		goto err1;
 
-	dect_lce_send(dh, &dh->page_transaction, &lce_page_response_msg_desc,
-		      &msg.common, DECT_LCE_PAGE_RESPONSE);
+	dect_lce_send_page_response_msg(dh, ta, ipui);
 	return;
 
 err1:
 	dect_ddl_destroy(dh, ddl);
 }
 
+/* Answer a page by all addressed identities of the PP identity table */
+static void dect_lce_rcv_table_page(struct dect_handle *dh,
+				    enum dect_pp_page_keys type, uint32_t value,
+				    const struct dect_mac_conn_params *mcp)
+{
+	struct dect_pp_table *pt = dh->pp_table;
+	struct dect_pp_identity *id;
+	struct dect_pp_page_key *pk;
+	struct hlist_node *pos;
+
+	if (type == DECT_PP_PAGE_ASSIGNED_TPUI && value == DECT_TPUI_CBI) {
+		list_for_each_entry(id, &pt->identities, list) {
+			if (id->page_transaction.state == DECT_TRANSACTION_OPEN)
+				continue;
+			dect_lce_send_page_response(dh, &id->ipui,
+						    &id->page_transaction, mcp);
+		}
+		return;
+	}
+
+	hlist_for_each_entry(pk, pos, dect_pp_page_bucket(pt, type, value),
+			     node) {
+		if (pk->type != type || pk->value != value)
+			continue;
+		id = pk->id;
+		if (id->page_transaction.state == DECT_TRANSACTION_OPEN)
+			continue;
+		dect_lce_send_page_response(dh, &id->ipui,
+					    &id->page_transaction, mcp);
+	}
+}
+
 static void dect_lce_rcv_short_page(struct dect_handle *dh,
 				    struct dect_msg_buf *mb)
 {
 	struct dect_short_page_msg *msg = (void *)mb->data;
-	struct dect_tpui tpui;
-	uint16_t info, t;
+	uint16_t info;
 	uint8_t hdr, pattern;
 	bool w;
 
@@ -1519,30 +3956,42 @@ static void dect_lce_rcv_short_page(struct dect_handle *dh,
 
 		lce_debug("LCE_GROUP_RING-ind: pattern: %x\n", pattern);
 		dh->ops->lce_ops->lce_group_ring_ind(dh, pattern);
+	} else if (dh->pp_table != NULL) {
+		dect_lce_rcv_table_page(dh, w ? DECT_PP_PAGE_ASSIGNED_TPUI :
+						DECT_PP_PAGE_DEFAULT_TPUI,
+					info, NULL);
 	} else {
-		if (w == 0) {
-			/* default individual TPUI */
-			t = dect_build_tpui(dect_ipui_to_tpui(&tpui, &dh->ipui));
-			if (info != t)
-				return;
-		} else {
-			/* assigned TPUI or CBI */
-			t = dect_build_tpui(&dh->tpui);
-			if (info != t && info != DECT_TPUI_CBI)
-				return;
-		}
+		/* default individual TPUI or assigned TPUI or CBI */
+		if (info != dh->page_tpui[w] &&
+		    !(w && info == DECT_TPUI_CBI))
+			return;
 
-		dect_lce_send_page_response(dh, NULL);
+		dect_lce_send_page_response(dh, &dh->ipui,
+					    &dh->page_transaction, NULL);
 	}
 }
 
+/* IPUI as contained in full pages */
+uint32_t dect_lce_page_ipui(const struct dect_ipui *ipui)
+{
+	uint8_t ipui_buf[8];
+	uint32_t val;
+
+	dect_build_ipui(ipui_buf, ipui);
+	val  = ipui->put << 24;
+	val |= (ipui_buf[1] & 0x0f) << 24;
+	val |= ipui_buf[2] << 16;
+	val |= ipui_buf[3] << 8;
+	val |= ipui_buf[4];
+	return val;
+}
+
 static void dect_lce_rcv_full_page(struct dect_handle *dh,
 				   struct dect_msg_buf *mb)
 {
 	struct dect_full_page_msg *msg = (void *)mb->data;
 	struct dect_mac_conn_params mcp;
-	uint32_t info, ipui, tpui, t;
-	uint8_t ipui_buf[8];
+	uint32_t info, tpui, t;
 	uint8_t hdr, pattern, slot, setup;
 	bool w;
 
@@ -1573,14 +4022,12 @@ static void dect_lce_rcv_full_page(struct dect_handle *dh,
 
 		if (w == 0) {
 			/* IPUI */
-			dect_build_ipui(ipui_buf, &dh->ipui);
-			ipui  = dh->ipui.put << 24;
-			ipui |= (ipui_buf[1] & 0x0f) << 24;
-			ipui |= ipui_buf[2] << 16;
-			ipui |= ipui_buf[3] << 8;
-			ipui |= ipui_buf[4];
-
-			if (info != ipui)
+			if (dh->pp_table != NULL) {
+				dect_lce_rcv_table_page(dh, DECT_PP_PAGE_IPUI,
+							info, &mcp);
+				return;
+			}
+			if (info != dect_lce_page_ipui(&dh->ipui))
 				return;
 		} else {
 			/* assigned TPUI or CBI */
@@ -1598,9 +4045,17 @@ static void dect_lce_rcv_full_page(struct dect_handle *dh,
 
 			mcp.service = dect_page_hdr_to_service(hdr);
 			mcp.slot    = dect_page_info_to_slot(slot);
+
+			if (dh->pp_table != NULL) {
+				dect_lce_rcv_table_page(dh,
+							DECT_PP_PAGE_ASSIGNED_TPUI,
+							(uint16_t)tpui, &mcp);
+				return;
+			}
 		}
 
-		dect_lce_send_page_response(dh, &mcp);
+		dect_lce_send_page_response(dh, &dh->ipui,
+					    &dh->page_transaction, &mcp);
 	}
 }
 
@@ -1608,11 +4063,12 @@ static void dect_lce_rcv_long_page(struct dect_handle *dh,
 				   struct dect_msg_buf *mb)
 {
 	lce_debug("long page: length: %u\n", mb->len);
+#ifdef CONFIG_CLMS
 	dect_clms_rcv_fixed(dh, mb);
+#endif
 }
 
-static void dect_lce_bsap_event(struct dect_handle *dh, struct dect_fd *dfd,
-				uint32_t events)
+static int dect_lce_bsap_rcv(struct dect_handle *dh, struct dect_fd *dfd)
 {
 	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
 	struct msghdr msg;
@@ -1620,13 +4076,11 @@ static void dect_lce_bsap_event(struct dect_handle *dh, struct dect_fd *dfd,
 	char cmsg_buf[4 * CMSG_SPACE(16)];
 	bool long_page = false;
 
-	dect_debug(DECT_DEBUG_LCE, "\n");
-
 	msg.msg_control		= cmsg_buf;
 	msg.msg_controllen	= sizeof(cmsg_buf);
 
-	if (dect_mbuf_rcv(dfd, &msg, mb) < 0)
-		return;
+	if (dect_mbuf_rcv(dfd, &msg, mb, MSG_DONTWAIT) < 0)
+		return errno == EMSGSIZE ? 0 : -1;
 
 	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
 		const struct dect_bsap_auxdata *aux;
@@ -1651,12 +4105,29 @@ static void dect_lce_bsap_event(struct dect_handle *dh, struct dect_fd *dfd,
 
 	switch (mb->len) {
 	case 3:
-		return dect_lce_rcv_short_page(dh, mb);
+		dect_lce_rcv_short_page(dh, mb);
+		break;
 	case 5:
-		if (!long_page)
-			return dect_lce_rcv_full_page(dh, mb);
+		if (!long_page) {
+			dect_lce_rcv_full_page(dh, mb);
+			break;
+		}
 	default:
-		return dect_lce_rcv_long_page(dh, mb);
+		dect_lce_rcv_long_page(dh, mb);
+		break;
+	}
+	return 0;
+}
+
+static void dect_lce_bsap_event(struct dect_handle *dh, struct dect_fd *dfd,
+				uint32_t events)
+{
+	unsigned int n;
+
+	dect_debug(DECT_DEBUG_LCE, "\n");
+	for (n = 0; n < dh->rcv_budget; n++) {
+		if (dect_lce_bsap_rcv(dh, dfd) < 0)
+			break;
 	}
 }
 
@@ -1708,22 +4179,28 @@ static const struct dect_nwk_protocol lce_protocol = {
 static int dect_transaction_alloc_tv(const struct dect_data_link *ddl,
 				     const struct dect_nwk_protocol *protocol)
 {
-	uint16_t tv;
+	unsigned int map;
+	int tv;
 
-	for (tv = 0; tv < protocol->max_transactions; tv++) {
-		if (dect_ddl_transaction_lookup(ddl, protocol->pd, tv,
-						DECT_TRANSACTION_INITIATOR))
-			continue;
-		return tv;
-	}
-	return -1;
+	map = ddl->ta_map[protocol->pd][DECT_TRANSACTION_INITIATOR];
+	tv  = ffs(~map) - 1;
+	if (tv < 0 || tv >= protocol->max_transactions)
+		return -1;
+	return tv;
 }
 
-static void dect_transaction_link(struct dect_data_link *ddl,
+static void dect_transaction_link(struct dect_handle *dh,
+				  struct dect_data_link *ddl,
 				  struct dect_transaction *ta)
 {
 	struct dect_transaction *last;
 
+	if (ddl->flags & DECT_DATA_LINK_LINGER) {
+		ddl_debug(ddl, "reuse idle link");
+		dect_ddl_linger_stop(dh, ddl);
+		dh->linger_stats.reused++;
+	}
+
 	/* Insert MM transactions at the end of the list to make sure they get
 	 * destroyed last on shutdown. This makes sure that other protocols
 	 * which might invoke and wait for the completion of MM transactions
@@ -1742,6 +4219,8 @@ static void dect_transaction_link(struct dect_data_link *ddl,
 			list_add_tail(&ta->list, &ddl->transactions);
 	} else
 		list_add(&ta->list, &ddl->transactions);
+
+	dect_ddl_transaction_insert(ddl, ta);
 }
 
 int dect_ddl_transaction_open(struct dect_handle *dh, struct dect_transaction *ta,
@@ -1756,13 +4235,15 @@ int dect_ddl_transaction_open(struct dect_handle *dh, struct dect_transaction *t
 
 	ddl_debug(ddl, "open transaction: %s TV: %u", protocol->name, tv);
 	ta->link  = ddl;
-	ta->mb    = NULL;
+	ta->rtx   = NULL;
 	ta->pd	  = pd;
 	ta->role  = DECT_TRANSACTION_INITIATOR;
 	ta->state = DECT_TRANSACTION_OPEN;
 	ta->tv    = tv;
 
-	dect_transaction_link(ddl, ta);
+	dect_trace5(transaction_open, ddl, pd, tv, ta->role,
+		    dect_trace_ipui(transaction_open, ddl));
+	dect_transaction_link(dh, ddl, ta);
 	return 0;
 }
 
@@ -1782,7 +4263,7 @@ void dect_transaction_confirm(struct dect_handle *dh, struct dect_transaction *t
 			      const struct dect_transaction *req)
 {
 	ta->link  = req->link;
-	ta->mb    = NULL;
+	ta->rtx   = NULL;
 	ta->tv    = req->tv;
 	ta->role  = req->role;
 	ta->pd    = req->pd;
@@ -1790,7 +4271,9 @@ void dect_transaction_confirm(struct dect_handle *dh, struct dect_transaction *t
 
 	ddl_debug(req->link, "confirm transaction: %s TV: %u Role: %u",
 		  protocols[ta->pd]->name, ta->tv, ta->role);
-	dect_transaction_link(req->link, ta);
+	dect_trace5(transaction_open, req->link, ta->pd, ta->tv, ta->role,
+		    dect_trace_ipui(transaction_open, req->link));
+	dect_transaction_link(dh, req->link, ta);
 }
 
 void dect_transaction_close(struct dect_handle *dh, struct dect_transaction *ta,
@@ -1800,11 +4283,14 @@ void dect_transaction_close(struct dect_handle *dh, struct dect_transaction *ta,
 
 	ddl_debug(ddl, "close transaction: %s TV: %u Role: %u",
 		  protocols[ta->pd]->name, ta->tv, ta->role);
+	dect_trace5(transaction_close, ddl, ta->pd, ta->tv, ta->role,
+		    dect_trace_ipui(transaction_close, ddl));
 
 	list_del(&ta->list);
+	dect_ddl_transaction_remove(ddl, ta);
 	ta->state = DECT_TRANSACTION_CLOSED;
-	if (ta->mb != NULL)
-		dect_mbuf_free(dh, ta->mb);
+	if (ta->rtx != NULL)
+		dect_rtx_msg_free(dh, ta->rtx);
 
 	switch (ddl->state) {
 	case DECT_DATA_LINK_RELEASED:
@@ -1829,6 +4315,12 @@ void dect_transaction_close(struct dect_handle *dh, struct dect_transaction *ta,
 			return dect_ddl_destroy(dh, ddl);
 		else
 			return;
+	case DECT_DATA_LINK_SUSPENDED:
+	case DECT_DATA_LINK_RESUME_PENDING:
+		/* No MAC connection to release */
+		if (list_empty(&ddl->transactions))
+			return dect_ddl_destroy(dh, ddl);
+		return;
 	default:
 		break;
 	}
@@ -1837,6 +4329,8 @@ void dect_transaction_close(struct dect_handle *dh, struct dect_transaction *ta,
 	case DECT_DDL_RELEASE_NORMAL:
 		if (!list_empty(&ddl->transactions))
 			return;
+		if (dect_ddl_linger(dh, ddl))
+			return;
 		return dect_ddl_release(dh, ddl);
 	case DECT_DDL_RELEASE_PARTIAL:
 		return dect_ddl_partial_release(dh, ddl);
@@ -1885,6 +4379,72 @@ static void dect_pp_set_assigned_pmid(struct dect_handle *dh)
 	lce_debug("set assigned PMID: %05x\n", dh->pmid);
 }
 
+/*
+ * Attach a B-SAP socket filter dropping short pages not addressed to the PP
+ * in the kernel. Full and long pages
+ * can't be told apart without the auxiliary data and are always received.
+ * The filter only avoids wakeups, failure to attach it is not an error.
+ */
+static void dect_pp_attach_page_filter(struct dect_handle *dh)
+{
+	struct sock_filter filter[] = {
+		/* 0: accept everything but short pages */
+		BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+			 sizeof(struct dect_short_page_msg), 0, 17),
+		BPF_STMT(BPF_LD | BPF_B | BPF_ABS,
+			 offsetof(struct dect_short_page_msg, hdr)),
+		BPF_STMT(BPF_MISC | BPF_TAX, 0),
+		BPF_STMT(BPF_ALU | BPF_AND | BPF_K, DECT_LCE_PAGE_HDR_MASK),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+			 DECT_LCE_PAGE_UNKNOWN_RINGING, 0, 5),
+		/* 6: group ring, connectionless group TPUI or CBI */
+		BPF_STMT(BPF_MISC | BPF_TXA, 0),
+		BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K,
+			 DECT_LCE_PAGE_W_FLAG, 10, 0),
+		BPF_STMT(BPF_LD | BPF_H | BPF_ABS,
+			 offsetof(struct dect_short_page_msg, information)),
+		BPF_STMT(BPF_ALU | BPF_AND | BPF_K,
+			 DECT_LCE_SHORT_PAGE_GROUP_MASK),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+			 DECT_TPUI_CBI & DECT_LCE_SHORT_PAGE_GROUP_MASK, 8, 7),
+		/* 11: individual page, default TPUI */
+		BPF_STMT(BPF_MISC | BPF_TXA, 0),
+		BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K,
+			 DECT_LCE_PAGE_W_FLAG, 2, 0),
+		BPF_STMT(BPF_LD | BPF_H | BPF_ABS,
+			 offsetof(struct dect_short_page_msg, information)),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, dh->page_tpui[0], 4, 3),
+		/* 15: individual page, assigned TPUI or CBI */
+		BPF_STMT(BPF_LD | BPF_H | BPF_ABS,
+			 offsetof(struct dect_short_page_msg, information)),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, dh->page_tpui[1], 2, 0),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, DECT_TPUI_CBI, 1, 0),
+		/* 18: drop */
+		BPF_STMT(BPF_RET | BPF_K, 0),
+		/* 19: accept */
+		BPF_STMT(BPF_RET | BPF_K, ~0U),
+	};
+	struct sock_fprog prog = {
+		.len	= array_size(filter),
+		.filter	= filter,
+	};
+
+	if (dect_fd_setsockopt(dh->b_sap, SOL_SOCKET, SO_ATTACH_FILTER,
+			       &prog, sizeof(prog)) < 0)
+		lce_debug("page filter: %s\n", strerror(errno));
+}
+
+static void dect_pp_update_page_filter(struct dect_handle *dh)
+{
+	struct dect_tpui tpui;
+
+	dh->page_tpui[0] = dect_build_tpui(dect_ipui_to_tpui(&tpui, &dh->ipui));
+	dh->page_tpui[1] = dect_build_tpui(&dh->tpui);
+	if (dh->b_sap != NULL && dh->pp_table == NULL)
+		dect_pp_attach_page_filter(dh);
+}
+
 /**
  * Set the PP's IPUI
  *
@@ -1895,6 +4455,7 @@ void dect_pp_set_ipui(struct dect_handle *dh, const struct dect_ipui *ipui)
 {
 	dh->ipui = *ipui;
 	dh->flags |= DECT_PP_IPUI;
+	dect_pp_update_page_filter(dh);
 }
 EXPORT_SYMBOL(dect_pp_set_ipui);
 
@@ -1909,6 +4470,7 @@ void dect_pp_set_tpui(struct dect_handle *dh, const struct dect_tpui *tpui)
 	dh->tpui = *tpui;
 	dh->flags |= DECT_PP_TPUI;
 	dect_pp_set_assigned_pmid(dh);
+	dect_pp_update_page_filter(dh);
 }
 EXPORT_SYMBOL(dect_pp_set_tpui);
 
@@ -1917,63 +4479,91 @@ int dect_lce_init(struct dect_handle *dh)
 	struct sockaddr_dect_ssap s_addr;
 	struct sockaddr_dect b_addr;
 
+	if (dect_mbuf_pool_init(dh) < 0)
+		goto err1;
+	if (dect_rtx_store_init(dh) < 0)
+		goto err2;
+
 	if (dh->mode == DECT_MODE_PP)
 		dect_pp_set_default_pmid(dh);
 
-	/* Open B-SAP socket */
-	dh->b_sap = dect_socket(dh, SOCK_DGRAM, DECT_B_SAP);
-	if (dh->b_sap == NULL)
-		goto err1;
+	dh->page_transaction.state = DECT_TRANSACTION_CLOSED;
+	if (dect_page_sched_open(dh) < 0)
+		goto err3;
 
-	memset(&b_addr, 0, sizeof(b_addr));
-	b_addr.dect_family = AF_DECT;
-	b_addr.dect_index = dh->index;
-	if (bind(dh->b_sap->fd, (struct sockaddr *)&b_addr, sizeof(b_addr)) < 0)
-		goto err2;
+	/* Shards use the B-SAP and S-SAP listener of the primary handle */
+	if (dect_shard_member(dh))
+		return 0;
+
+	/* Open B-SAP socket, unless it was handed over by dect_handoff_open() */
+	if (dh->b_sap == NULL) {
+		dh->b_sap = dect_socket(dh, SOCK_DGRAM, DECT_B_SAP);
+		if (dh->b_sap == NULL)
+			goto err4;
+
+		memset(&b_addr, 0, sizeof(b_addr));
+		b_addr.dect_family = AF_DECT;
+		b_addr.dect_index = dh->index;
+		if (dect_fd_bind(dh->b_sap, (struct sockaddr *)&b_addr,
+				 sizeof(b_addr)) < 0)
+			goto err5;
+	}
 
+	dh->b_sap->prio = DECT_FD_PRIO_LISTENER;
 	dect_fd_setup(dh->b_sap, dect_lce_bsap_event, NULL);
 	if (dect_fd_register(dh, dh->b_sap, DECT_FD_READ) < 0)
-		goto err2;
-
-	dh->page_transaction.state = DECT_TRANSACTION_CLOSED;
+		goto err5;
+	if (dh->mode == DECT_MODE_PP)
+		dect_pp_update_page_filter(dh);
 
 	/* Open S-SAP listener socket */
 	if (dh->mode == DECT_MODE_FP) {
-		dh->s_sap = dect_socket(dh, SOCK_SEQPACKET, DECT_S_SAP);
-		if (dh->s_sap == NULL)
-			goto err3;
-
-		memset(&s_addr, 0, sizeof(s_addr));
-		s_addr.dect_family = AF_DECT;
-		s_addr.dect_index  = dh->index;
-		s_addr.dect_lln    = DECT_LLN_ANY;
-		s_addr.dect_sapi   = DECT_SAPI_ANY;
-
-		if (bind(dh->s_sap->fd, (struct sockaddr *)&s_addr,
-			 sizeof(s_addr)) < 0)
-			goto err4;
-		if (listen(dh->s_sap->fd, 10) < 0)
-			goto err4;
+		if (dh->s_sap == NULL) {
+			dh->s_sap = dect_socket(dh, SOCK_SEQPACKET, DECT_S_SAP);
+			if (dh->s_sap == NULL)
+				goto err6;
+
+			memset(&s_addr, 0, sizeof(s_addr));
+			s_addr.dect_family = AF_DECT;
+			s_addr.dect_index  = dh->index;
+			s_addr.dect_lln    = DECT_LLN_ANY;
+			s_addr.dect_sapi   = DECT_SAPI_ANY;
+
+			if (dect_fd_bind(dh->s_sap, (struct sockaddr *)&s_addr,
+					 sizeof(s_addr)) < 0)
+				goto err7;
+			if (dect_fd_listen(dh->s_sap, 10) < 0)
+				goto err7;
+		}
 
+		dh->s_sap->prio = DECT_FD_PRIO_LISTENER;
 		dect_fd_setup(dh->s_sap, dect_lce_ssap_listener_event, NULL);
 		if (dect_fd_register(dh, dh->s_sap, DECT_FD_READ) < 0)
-			goto err4;
+			goto err7;
 	}
 
-	dect_lce_register_protocol(&lce_protocol);
-	dect_lce_register_protocol(&dect_cc_protocol);
-	dect_lce_register_protocol(&dect_ciss_protocol);
-	dect_lce_register_protocol(&dect_clms_protocol);
-	dect_lce_register_protocol(&dect_mm_protocol);
 	return 0;
 
-err4:
+err7:
 	dect_close(dh, dh->s_sap);
-err3:
+	dh->s_sap = NULL;
+err6:
 	dect_fd_unregister(dh, dh->b_sap);
-err2:
+err5:
 	dect_close(dh, dh->b_sap);
+	dh->b_sap = NULL;
+err4:
+	dect_page_sched_flush(dh);
+err3:
+	dect_rtx_store_exit(dh);
+err2:
+	dect_mbuf_pool_exit(dh);
 err1:
+	/* Release the sockets handed over by dect_handoff_open() */
+	if (dh->s_sap != NULL)
+		dect_close(dh, dh->s_sap);
+	if (dh->b_sap != NULL)
+		dect_close(dh, dh->b_sap);
 	lce_debug("dect_lce_init: %s\n", strerror(errno));
 	return -1;
 }
@@ -1982,6 +4572,10 @@ void dect_lce_exit(struct dect_handle *dh)
 {
 	struct dect_data_link *ddl, *ddl_next;
 	struct dect_lte *lte, *lte_next;
+	struct dect_lce_cl_multicast *mc, *mc_next;
+
+	list_for_each_entry_safe(mc, mc_next, &dh->cl_multicasts, list)
+		dect_lce_cl_multicast_free(dh, mc);
 
 	list_for_each_entry_safe(ddl, ddl_next, &dh->links, list)
 		dect_ddl_shutdown(dh, ddl);
@@ -1989,13 +4583,30 @@ void dect_lce_exit(struct dect_handle *dh)
 	list_for_each_entry_safe(lte, lte_next, &dh->ldb, list)
 		dect_lte_release(dh, lte);
 
-	if (dh->mode == DECT_MODE_FP) {
-		dect_fd_unregister(dh, dh->s_sap);
+	dect_pp_table_exit(dh);
+
+	if (dh->mode == DECT_MODE_FP && !dect_shard_member(dh)) {
+		if (!dh->admission.paused)
+			dect_fd_unregister(dh, dh->s_sap);
 		dect_close(dh, dh->s_sap);
 	}
 
-	dect_fd_unregister(dh, dh->b_sap);
-	dect_close(dh, dh->b_sap);
+	/* Deferred requests have been released together with their links */
+	if (dh->admission.timer != NULL) {
+		if (dect_timer_running(dh->admission.timer))
+			dect_timer_stop(dh, dh->admission.timer);
+		dect_timer_free(dh, dh->admission.timer);
+		dh->admission.timer = NULL;
+	}
+
+	dect_page_sched_flush(dh);
+	if (!dect_shard_member(dh)) {
+		dect_fd_unregister(dh, dh->b_sap);
+		dect_close(dh, dh->b_sap);
+	}
+
+	dect_rtx_store_exit(dh);
+	dect_mbuf_pool_exit(dh);
 }
 
 /** @} */
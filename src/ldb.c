@@ -0,0 +1,341 @@
+/*
+ * libdect persistent location database
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @defgroup ldb Location database
+ *
+ * Persistence of the location table in a memory mapped file.
+ *
+ * The location table of a FP, containing the IPUI, the assigned TPUI and the
+ * capabilities of each registered PP, is kept in memory and rebuilt from
+ * location updates after a restart. A file opened using dect_ldb_open()
+ * keeps a copy of the table, which is loaded into the location table when
+ * opened, so the PPs don't need to be located again.
+ *
+ * The file consists of a header and a fixed number of fixed size records,
+ * indexed by the hash of the IPUI using linear probing. Each change to an
+ * entry updates its record in the shared mapping, so it reaches the file
+ * through the page cache even if the process terminates abnormally. Records
+ * are checksummed, records torn by a system crash are skipped when loading.
+ * dect_ldb_sync() writes the records changed since the last call to disk.
+ *
+ * @{
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <libdect.h>
+#include <identities.h>
+#include <utils.h>
+#include <lce.h>
+#include <ldb.h>
+
+#define ldb_debug(fmt, args...) \
+	dect_debug(DECT_DEBUG_LCE, "LDB: " fmt, ## args)
+
+#define DECT_LDB_MAGIC			0x444c4442
+#define DECT_LDB_VERSION		1
+#define DECT_LDB_HDR_SIZE		64
+
+/**
+ * struct dect_ldb_hdr - location database file header
+ *
+ * @magic:	DECT_LDB_MAGIC
+ * @version:	file format version
+ * @bits:	number of bits of the record index
+ * @rec_size:	size of a record, includes the layout of struct dect_lte_record
+ */
+struct dect_ldb_hdr {
+	uint32_t				magic;
+	uint16_t				version;
+	uint16_t				bits;
+	uint32_t				rec_size;
+};
+
+enum dect_ldb_rec_states {
+	DECT_LDB_REC_FREE,
+	DECT_LDB_REC_USED,
+};
+
+/**
+ * struct dect_ldb_rec - location database record
+ *
+ * @csum:	checksum of @lte
+ * @state:	record state, set once the record has been written
+ * @lte:	location table entry
+ */
+struct dect_ldb_rec {
+	uint32_t				csum;
+	uint32_t				state;
+	struct dect_lte_record			lte;
+};
+
+/**
+ * struct dect_ldb - location database
+ *
+ * @map:	file mapping
+ * @size:	size of the mapping
+ * @bits:	number of bits of the record index
+ * @mask:	number of records - 1
+ * @recs:	records
+ * @dirty_lo:	first record changed since the last sync
+ * @dirty_hi:	last record changed since the last sync + 1
+ */
+struct dect_ldb {
+	void					*map;
+	size_t					size;
+	unsigned int				bits;
+	unsigned int				mask;
+	struct dect_ldb_rec			*recs;
+	unsigned int				dirty_lo;
+	unsigned int				dirty_hi;
+};
+
+static uint32_t dect_ldb_csum(const struct dect_lte_record *lte)
+{
+	const uint8_t *data = (const uint8_t *)lte;
+	uint32_t h = 0x811c9dc5;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(*lte); i++)
+		h = (h ^ data[i]) * 0x01000193;
+	return h;
+}
+
+/* Find the record of an IPUI or the free record it is to be stored in */
+static struct dect_ldb_rec *dect_ldb_lookup(const struct dect_ldb *ldb,
+					    const struct dect_ipui *ipui)
+{
+	struct dect_ldb_rec *rec;
+	unsigned int i, n;
+
+	i = dect_ipui_hash(ipui, ldb->bits);
+	for (n = 0; n <= ldb->mask; n++, i = (i + 1) & ldb->mask) {
+		rec = &ldb->recs[i];
+		if (rec->state == DECT_LDB_REC_FREE ||
+		    !dect_ipui_cmp(&rec->lte.ipui, ipui))
+			return rec;
+	}
+	return NULL;
+}
+
+/**
+ * dect_ldb_update - write a location table entry to the location database
+ *
+ * @dh:		libdect DECT handle
+ * @lte:	location table entry
+ */
+void dect_ldb_update(struct dect_handle *dh, const struct dect_lte *lte)
+{
+	struct dect_ldb *ldb = dh->ldb_file;
+	struct dect_ldb_rec *rec;
+	unsigned int i;
+
+	if (ldb == NULL)
+		return;
+
+	rec = dect_ldb_lookup(ldb, &lte->ipui);
+	if (rec == NULL) {
+		ldb_debug("database full, entry not stored\n");
+		return;
+	}
+
+	dect_lte_export(lte, &rec->lte);
+	rec->csum = dect_ldb_csum(&rec->lte);
+	__atomic_store_n(&rec->state, DECT_LDB_REC_USED, __ATOMIC_RELEASE);
+
+	i = rec - ldb->recs;
+	if (ldb->dirty_lo >= ldb->dirty_hi) {
+		ldb->dirty_lo = i;
+		ldb->dirty_hi = i + 1;
+	} else {
+		ldb->dirty_lo = min(ldb->dirty_lo, i);
+		ldb->dirty_hi = max(ldb->dirty_hi, i + 1);
+	}
+}
+
+static int dect_ldb_load(struct dect_handle *dh, const struct dect_ldb *ldb)
+{
+	const struct dect_ldb_rec *rec;
+	unsigned int i, n = 0, torn = 0;
+
+	for (i = 0; i <= ldb->mask; i++) {
+		rec = &ldb->recs[i];
+		if (rec->state != DECT_LDB_REC_USED)
+			continue;
+		if (rec->csum != dect_ldb_csum(&rec->lte)) {
+			torn++;
+			continue;
+		}
+		if (dect_lte_import(dh, &rec->lte) < 0)
+			return -1;
+		n++;
+	}
+
+	ldb_debug("loaded %u entries, %u damaged\n", n, torn);
+	return 0;
+}
+
+/**
+ * Open a persistent location database
+ *
+ * @param dh		libdect DECT handle
+ * @param path		database file
+ * @param size		number of records of a new file, a power of two
+ *
+ * The entries stored in the file are loaded into the location table, the
+ * entries of the location table are stored in the file. A new file is
+ * created if it doesn't exist, otherwise the size of the existing file is
+ * used. Each handle, including the shards of a handle, must use a separate
+ * file.
+ *
+ * @return 0 on success or -1 on error.
+ */
+int dect_ldb_open(struct dect_handle *dh, const char *path, unsigned int size)
+{
+	struct dect_ldb_hdr *hdr;
+	struct dect_ldb *ldb;
+	struct dect_lte *lte;
+	struct stat st;
+	int fd;
+
+	if (dh->ldb_file != NULL || size < 2 || (size & (size - 1))) {
+		errno = EINVAL;
+		goto err1;
+	}
+
+	ldb = dect_zalloc(dh, sizeof(*ldb));
+	if (ldb == NULL)
+		goto err1;
+
+	fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (fd < 0)
+		goto err2;
+	if (fstat(fd, &st) < 0)
+		goto err3;
+
+	if (st.st_size == 0) {
+		ldb->size = DECT_LDB_HDR_SIZE +
+			    (size_t)size * sizeof(struct dect_ldb_rec);
+		if (ftruncate(fd, ldb->size) < 0)
+			goto err3;
+	} else
+		ldb->size = st.st_size;
+
+	if (ldb->size < DECT_LDB_HDR_SIZE) {
+		errno = EINVAL;
+		goto err3;
+	}
+
+	ldb->map = mmap(NULL, ldb->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			fd, 0);
+	if (ldb->map == MAP_FAILED)
+		goto err3;
+
+	hdr = ldb->map;
+	if (st.st_size == 0) {
+		hdr->version  = DECT_LDB_VERSION;
+		hdr->bits     = __builtin_ctz(size);
+		hdr->rec_size = sizeof(struct dect_ldb_rec);
+		__atomic_store_n(&hdr->magic, DECT_LDB_MAGIC, __ATOMIC_RELEASE);
+		if (msync(ldb->map, DECT_LDB_HDR_SIZE, MS_SYNC) < 0)
+			goto err4;
+	}
+
+	if (hdr->magic != DECT_LDB_MAGIC ||
+	    hdr->version != DECT_LDB_VERSION ||
+	    hdr->rec_size != sizeof(struct dect_ldb_rec) ||
+	    hdr->bits == 0 || hdr->bits >= 32 ||
+	    ldb->size != DECT_LDB_HDR_SIZE +
+			 ((size_t)1 << hdr->bits) * sizeof(struct dect_ldb_rec)) {
+		errno = EINVAL;
+		goto err4;
+	}
+	ldb->bits = hdr->bits;
+	ldb->mask = (1U << hdr->bits) - 1;
+	ldb->recs = ldb->map + DECT_LDB_HDR_SIZE;
+
+	if (dect_ldb_load(dh, ldb) < 0)
+		goto err4;
+
+	close(fd);
+
+	dh->ldb_file = ldb;
+	list_for_each_entry(lte, &dh->ldb, list)
+		dect_ldb_update(dh, lte);
+	return 0;
+
+err4:
+	munmap(ldb->map, ldb->size);
+err3:
+	close(fd);
+err2:
+	dect_free(dh, ldb);
+err1:
+	ldb_debug("dect_ldb_open: %s\n", strerror(errno));
+	return -1;
+}
+EXPORT_SYMBOL(dect_ldb_open);
+
+/**
+ * Write the changes of a location database to disk
+ *
+ * @param dh		libdect DECT handle
+ *
+ * Changes are written back to the file by the kernel in the background, this
+ * function only needs to be used to survive system crashes.
+ *
+ * @return 0 on success or -1 on error.
+ */
+int dect_ldb_sync(struct dect_handle *dh)
+{
+	struct dect_ldb *ldb = dh->ldb_file;
+	long pagesize = sysconf(_SC_PAGESIZE);
+	uintptr_t start, end;
+
+	if (ldb == NULL || ldb->dirty_lo >= ldb->dirty_hi)
+		return 0;
+
+	start = (uintptr_t)&ldb->recs[ldb->dirty_lo] & ~(pagesize - 1);
+	end   = (uintptr_t)&ldb->recs[ldb->dirty_hi];
+	if (msync((void *)start, end - start, MS_SYNC) < 0)
+		return -1;
+
+	ldb->dirty_lo = ldb->dirty_hi = 0;
+	return 0;
+}
+EXPORT_SYMBOL(dect_ldb_sync);
+
+/**
+ * Close the location database of a handle
+ *
+ * @param dh		libdect DECT handle
+ *
+ * The location table remains unchanged. Called by dect_close_handle().
+ */
+void dect_ldb_close(struct dect_handle *dh)
+{
+	struct dect_ldb *ldb = dh->ldb_file;
+
+	if (ldb == NULL)
+		return;
+
+	dect_ldb_sync(dh);
+	munmap(ldb->map, ldb->size);
+	dect_free(dh, ldb);
+	dh->ldb_file = NULL;
+}
+EXPORT_SYMBOL(dect_ldb_close);
+
+/** @} */
@@ -20,9 +20,42 @@
 #include <libdect.h>
 #include <netlink.h>
 #include <utils.h>
+#include <io.h>
+#include <timer.h>
 #include <lce.h>
+#include <mm.h>
+#include <record.h>
+#include <shard.h>
+#include <ldb.h>
+#include <keystore.h>
+#include <trace.h>
 
-static struct dect_handle *dect_alloc_handle(struct dect_ops *ops)
+#ifdef CONFIG_USDT
+/* Tracepoint semaphores, incremented by tracers attaching to the probes */
+DECT_TRACE_SEMAPHORE(lce_rx);
+DECT_TRACE_SEMAPHORE(lce_tx);
+DECT_TRACE_SEMAPHORE(lce_broadcast);
+DECT_TRACE_SEMAPHORE(transaction_open);
+DECT_TRACE_SEMAPHORE(transaction_close);
+DECT_TRACE_SEMAPHORE(sfmt_parse);
+DECT_TRACE_SEMAPHORE(sfmt_build);
+DECT_TRACE_SEMAPHORE(timer_start);
+DECT_TRACE_SEMAPHORE(timer_stop);
+DECT_TRACE_SEMAPHORE(timer_run);
+DECT_TRACE_SEMAPHORE(uplane_rx);
+DECT_TRACE_SEMAPHORE(uplane_tx);
+#endif
+
+/* Seed the generator of the default PMIDs once the first handle is opened */
+static void dect_random_init(void)
+{
+	static bool seeded;
+
+	if (!__atomic_exchange_n(&seeded, true, __ATOMIC_RELAXED))
+		srandom(time(NULL));
+}
+
+struct dect_handle *dect_alloc_handle(struct dect_ops *ops)
 {
 	struct dect_handle *dh;
 
@@ -35,12 +68,37 @@ static struct dect_handle *dect_alloc_handle(struct dect_ops *ops)
 	if (dh == NULL)
 		return NULL;
 	memset(dh, 0, sizeof(*dh) + ops->priv_size);
+	dect_random_init();
 
 	dh->ops = ops;
+	dh->transport = &dect_kernel_transport;
 	init_list_head(&dh->ldb);
 	init_list_head(&dh->links);
 	init_list_head(&dh->mme_list);
+	init_list_head(&dh->linger_links);
+	init_list_head(&dh->suspended_links);
+	init_list_head(&dh->cl_multicasts);
+	dh->rcv_budget = DECT_RCV_BUDGET_DEFAULT;
+	dh->rtx_max = DECT_RTX_STORE_MAX;
+	dect_debug_bind(dh);
+	dect_page_sched_init(dh);
+	dect_lce_admission_init(dh);
+
+	if (dect_mem_init(dh) < 0)
+		goto err1;
+	if (dect_stats_init(dh) < 0)
+		goto err2;
+	if (dect_timer_wheel_init(dh) < 0)
+		goto err3;
 	return dh;
+
+err3:
+	dect_stats_exit(dh);
+err2:
+	dect_mem_exit(dh);
+err1:
+	ops->free(dh);
+	return NULL;
 }
 
 /**
@@ -49,6 +107,10 @@ static struct dect_handle *dect_alloc_handle(struct dect_ops *ops)
  * @param ops		DECT ops
  * @param cluster	Cluster name
  *
+ * Handles don't share mutable state, so handles bound to different clusters
+ * may be driven by different threads of one process. Each handle must only
+ * be used by one thread at a time.
+ *
  * @return		a new libdect DECT handle or NULL on error.
  */
 struct dect_handle *dect_open_handle(struct dect_ops *ops, const char *cluster)
@@ -72,12 +134,93 @@ struct dect_handle *dect_open_handle(struct dect_ops *ops, const char *cluster)
 err3:
 	dect_netlink_exit(dh);
 err2:
-	dect_free(dh, dh);
+	dect_timer_wheel_exit(dh);
+	dect_stats_exit(dh);
+	dect_mem_exit(dh);
+	dh->ops->free(dh);
 err1:
 	return NULL;
 }
 EXPORT_SYMBOL(dect_open_handle);
 
+/**
+ * Initialize the libdect subsystems and bind to a cluster asynchronously
+ *
+ * @param ops		DECT ops
+ * @param cluster	Cluster name
+ * @param info		cached cluster information or NULL
+ * @param cb		completion callback
+ *
+ * Return without waiting for the cluster information from the kernel. The
+ * completion callback is invoked from the event handler once the handle is
+ * ready, or with a negative error argument and errno set if initialization
+ * failed, in which case the handle must be closed. No other functions may be
+ * used with the handle before completion.
+ *
+ * When seeded using cluster information obtained through
+ * dect_handle_get_cluster_info() from a previous instance, initialization
+ * completes without waiting for the kernel and the information is refreshed
+ * in the background.
+ *
+ * @return		a new libdect DECT handle or NULL on error.
+ */
+struct dect_handle *
+dect_open_handle_async(struct dect_ops *ops, const char *cluster,
+		       const struct dect_cluster_info *info,
+		       void (*cb)(struct dect_handle *dh, int err))
+{
+	struct dect_handle *dh;
+
+	if (cluster == NULL)
+		cluster = "cluster0";
+
+	dh = dect_alloc_handle(ops);
+	if (dh == NULL)
+		goto err1;
+	dh->open_cb = cb;
+
+	if (dect_netlink_init_async(dh, cluster, info) < 0)
+		goto err2;
+	return dh;
+
+err2:
+	dect_timer_wheel_exit(dh);
+	dect_stats_exit(dh);
+	dect_mem_exit(dh);
+	dh->ops->free(dh);
+err1:
+	return NULL;
+}
+EXPORT_SYMBOL(dect_open_handle_async);
+
+void dect_open_complete(struct dect_handle *dh, int err)
+{
+	if (err == 0 && dect_lce_init(dh) < 0)
+		err = -1;
+
+	dh->open_state = err < 0 ? DECT_OPEN_FAILED : DECT_OPEN_READY;
+	dh->open_cb(dh, err);
+}
+
+/**
+ * Get a snapshot of the cluster information of a handle
+ *
+ * @param dh		libdect DECT handle
+ * @param info		cluster information
+ *
+ * The snapshot can be used to seed dect_open_handle_async() on restart.
+ */
+void dect_handle_get_cluster_info(const struct dect_handle *dh,
+				  struct dect_cluster_info *info)
+{
+	memset(info, 0, sizeof(*info));
+	info->index = dh->index;
+	info->mode  = dh->mode;
+	info->pari  = dh->pari;
+	info->fpc   = dh->fpc;
+}
+EXPORT_SYMBOL(dect_handle_get_cluster_info);
+
 /**
  * Unbind from a cluster and release the libdect DECT handle
  *
@@ -85,21 +228,55 @@ EXPORT_SYMBOL(dect_open_handle);
  */
 void dect_close_handle(struct dect_handle *dh)
 {
-	dect_lce_exit(dh);
+	bool shard = dect_shard_member(dh);
+
+	dect_cmdq_exit(dh);
+	dect_ind_batch_disable(dh);
+	dect_record_exit(dh);
+	dect_auth_offload_exit(dh);
+	dect_auth_ks_cache_exit(dh);
+	if (dh->open_state == DECT_OPEN_READY)
+		dect_lce_exit(dh);
+	dect_shard_exit(dh);
+	dect_ldb_close(dh);
+	dect_keystore_close(dh);
+#ifdef CONFIG_MM
+	dect_mm_provision_exit(dh);
+#endif
 	dect_netlink_exit(dh);
-	dect_free(dh, dh);
+	dect_ie_intern_flush(dh);
+	dect_timer_wheel_exit(dh);
+	dect_stats_exit(dh);
+	/* The transport is owned by the primary handle */
+	if (!shard && dh->transport->ops->exit != NULL)
+		dh->transport->ops->exit(dh);
+	dect_mem_exit(dh);
+	dh->ops->free(dh);
 }
 EXPORT_SYMBOL(dect_close_handle);
 
-void *dect_handle_priv(struct dect_handle *dh)
+/**
+ * Set the maximum number of messages received per socket event
+ *
+ * @param dh		libdect DECT handle
+ * @param budget	number of messages, at least one
+ *
+ * Queued messages of a data link or the broadcast socket and pending data
+ * links of the S-SAP listener are processed in a loop until the socket is
+ * drained or the budget is exhausted. A smaller
+ * budget improves fairness between data links, a larger one reduces the
+ * number of event loop iterations under load.
+ */
+void dect_set_rcv_budget(struct dect_handle *dh, unsigned int budget)
 {
-	return dh->priv;
+	dh->rcv_budget = max(budget, 1U);
 }
-EXPORT_SYMBOL(dect_handle_priv);
+EXPORT_SYMBOL(dect_set_rcv_budget);
 
-static void __init libdect_init(void)
+void *dect_handle_priv(struct dect_handle *dh)
 {
-	srandom(time(NULL));
+	return dh->priv;
 }
+EXPORT_SYMBOL(dect_handle_priv);
 
 /** @} */
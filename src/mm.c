@@ -19,6 +19,7 @@
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/random.h>
 #include <linux/dect.h>
 
 #include <libdect.h>
@@ -28,7 +29,9 @@
 #include <s_fmt.h>
 #include <lce.h>
 #include <mm.h>
+#include <ind.h>
 #include <dect/auth.h>
+#include <keystore.h>
 
 static DECT_SFMT_MSG_DESC(mm_access_rights_accept,
 	DECT_SFMT_IE(DECT_IE_PORTABLE_IDENTITY,		IE_MANDATORY, IE_NONE,      0),
@@ -100,17 +103,17 @@ static DECT_SFMT_MSG_DESC(mm_authentication_reject,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_authentication_reply,
-	DECT_SFMT_IE(DECT_IE_RES,			IE_MANDATORY, IE_MANDATORY, 0),
-	DECT_SFMT_IE(DECT_IE_RS,			IE_OPTIONAL,  IE_NONE,      0),
-	DECT_SFMT_IE(DECT_IE_ZAP_FIELD,			IE_NONE,      IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_SERVICE_CLASS,		IE_NONE,      IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_KEY,			IE_NONE,      IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_IWU_TO_IWU,		IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT),
-	DECT_SFMT_IE(DECT_IE_ESCAPE_TO_PROPRIETARY,	IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE_END_MSG
-);
+#define DECT_MM_AUTHENTICATION_REPLY_IES(IE)								\
+	IE(DECT_IE_RES,				IE_MANDATORY, IE_MANDATORY, 0)				\
+	IE(DECT_IE_RS,				IE_OPTIONAL,  IE_NONE,      0)				\
+	IE(DECT_IE_ZAP_FIELD,			IE_NONE,      IE_OPTIONAL,  0)				\
+	IE(DECT_IE_SERVICE_CLASS,		IE_NONE,      IE_OPTIONAL,  0)				\
+	IE(DECT_IE_KEY,				IE_NONE,      IE_OPTIONAL,  0)				\
+	IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_IWU_TO_IWU,			IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT)	\
+	IE(DECT_IE_ESCAPE_TO_PROPRIETARY,	IE_OPTIONAL,  IE_OPTIONAL,  0)
+
+static DECT_SFMT_MSG_DESC_CODEC(mm_authentication_reply, DECT_MM_AUTHENTICATION_REPLY_IES);
 
 static DECT_SFMT_MSG_DESC(mm_authentication_request,
 	DECT_SFMT_IE(DECT_IE_AUTH_TYPE,			IE_MANDATORY, IE_MANDATORY, 0),
@@ -219,23 +222,23 @@ static DECT_SFMT_MSG_DESC(mm_locate_reject,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_locate_request,
-	DECT_SFMT_IE(DECT_IE_PORTABLE_IDENTITY,		IE_NONE,      IE_MANDATORY, 0),
-	DECT_SFMT_IE(DECT_IE_FIXED_IDENTITY,		IE_NONE,      IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_LOCATION_AREA,		IE_NONE,      IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_NWK_ASSIGNED_IDENTITY,	IE_NONE,      IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_CIPHER_INFO,		IE_NONE,      IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_SETUP_CAPABILITY,		IE_NONE,      IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_TERMINAL_CAPABILITY,	IE_NONE,      IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_NETWORK_PARAMETER,		IE_NONE,      IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_SEGMENTED_INFO,		IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT),
-	DECT_SFMT_IE(DECT_IE_IWU_TO_IWU,		IE_NONE,      IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_MODEL_IDENTIFIER,		IE_NONE,      IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_ESCAPE_TO_PROPRIETARY,	IE_NONE,      IE_OPTIONAL,  0),
-	DECT_SFMT_IE(DECT_IE_CODEC_LIST,		IE_NONE,      IE_OPTIONAL,  0),
-	DECT_SFMT_IE_END_MSG
-);
+#define DECT_MM_LOCATE_REQUEST_IES(IE)									\
+	IE(DECT_IE_PORTABLE_IDENTITY,		IE_NONE,      IE_MANDATORY, 0)				\
+	IE(DECT_IE_FIXED_IDENTITY,		IE_NONE,      IE_OPTIONAL,  0)				\
+	IE(DECT_IE_LOCATION_AREA,		IE_NONE,      IE_OPTIONAL,  0)				\
+	IE(DECT_IE_NWK_ASSIGNED_IDENTITY,	IE_NONE,      IE_OPTIONAL,  0)				\
+	IE(DECT_IE_CIPHER_INFO,			IE_NONE,      IE_OPTIONAL,  0)				\
+	IE(DECT_IE_SETUP_CAPABILITY,		IE_NONE,      IE_OPTIONAL,  0)				\
+	IE(DECT_IE_TERMINAL_CAPABILITY,		IE_NONE,      IE_OPTIONAL,  0)				\
+	IE(DECT_IE_NETWORK_PARAMETER,		IE_NONE,      IE_OPTIONAL,  0)				\
+	IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0)				\
+	IE(DECT_IE_SEGMENTED_INFO,		IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT)	\
+	IE(DECT_IE_IWU_TO_IWU,			IE_NONE,      IE_OPTIONAL,  0)				\
+	IE(DECT_IE_MODEL_IDENTIFIER,		IE_NONE,      IE_OPTIONAL,  0)				\
+	IE(DECT_IE_ESCAPE_TO_PROPRIETARY,	IE_NONE,      IE_OPTIONAL,  0)				\
+	IE(DECT_IE_CODEC_LIST,			IE_NONE,      IE_OPTIONAL,  0)
+
+static DECT_SFMT_MSG_DESC_CODEC(mm_locate_request, DECT_MM_LOCATE_REQUEST_IES);
 
 static DECT_SFMT_MSG_DESC(mm_info_accept,
 	DECT_SFMT_IE(DECT_IE_INFO_TYPE,			IE_MANDATORY, IE_NONE,      0),
@@ -332,6 +335,39 @@ static DECT_SFMT_MSG_DESC(mm_notify_msg,
 	DECT_SFMT_IE_END_MSG
 );
 
+/* All message descriptions, used by the benchmark suite */
+const struct dect_sfmt_msg_desc * const dect_mm_msg_descs[] = {
+	&mm_access_rights_accept_msg_desc,
+	&mm_access_rights_request_msg_desc,
+	&mm_access_rights_reject_msg_desc,
+	&mm_access_rights_terminate_accept_msg_desc,
+	&mm_access_rights_terminate_reject_msg_desc,
+	&mm_access_rights_terminate_request_msg_desc,
+	&mm_authentication_reject_msg_desc,
+	&mm_authentication_reply_msg_desc,
+	&mm_authentication_request_msg_desc,
+	&mm_cipher_suggest_msg_desc,
+	&mm_cipher_request_msg_desc,
+	&mm_cipher_reject_msg_desc,
+	&mm_detach_msg_desc,
+	&mm_identity_reply_msg_desc,
+	&mm_identity_request_msg_desc,
+	&mm_key_allocate_msg_desc,
+	&mm_locate_accept_msg_desc,
+	&mm_locate_reject_msg_desc,
+	&mm_locate_request_msg_desc,
+	&mm_info_accept_msg_desc,
+	&mm_info_reject_msg_desc,
+	&mm_info_request_msg_desc,
+	&mm_info_suggest_msg_desc,
+	&mm_temporary_identity_assign_msg_desc,
+	&mm_temporary_identity_assign_ack_msg_desc,
+	&mm_temporary_identity_assign_rej_msg_desc,
+	&mm_iwu_msg_desc,
+	&mm_notify_msg_msg_desc,
+	NULL
+};
+
 #define __mm_debug(mme, pfx, fmt, args...) \
 	dect_debug(DECT_DEBUG_MM, "%sMM: link %d (%s): " fmt "\n", (pfx), \
 		   (mme)->link && (mme)->link->dfd ? (mme)->link->dfd->fd : -1, \
@@ -352,6 +388,7 @@ struct dect_mm_proc {
 	void		(*abort)(struct dect_handle *dh,
 				 struct dect_mm_endpoint *mme,
 				 struct dect_mm_procedure *mp);
+	enum dect_stats_latencies latency;
 	struct {
 		uint8_t	priority;
 		uint8_t	timeout;
@@ -366,6 +403,7 @@ static int dect_mm_procedure_initiate(struct dect_handle *dh,
 {
 	struct dect_mm_procedure *mp = &mme->procedure[DECT_TRANSACTION_INITIATOR];
 	const struct dect_mm_proc *proc = &dect_mm_proc[type];
+	unsigned int timeout;
 	uint8_t priority;
 	int err;
 
@@ -396,14 +434,28 @@ static int dect_mm_procedure_initiate(struct dect_handle *dh,
 	mp->type     = type;
 	mp->priority = priority;
 	mp->iec      = NULL;
+	mp->start    = dect_stats_clock();
+	mp->retransmissions = 0;
+
+	/* The response time on an established link is known, retransmit
+	 * once the response is overdue */
+	timeout = proc->param[dh->mode].timeout * 1000;
+	if (mme->link->state == DECT_DATA_LINK_ESTABLISHED) {
+		mp->rtt_start = mp->start;
+		timeout = dect_ddl_rto(mme->link, DECT_RTT_MM, timeout);
+	} else
+		mp->rtt_start = 0;
 
-	if (proc->param[dh->mode].timeout)
-		dect_timer_start(dh, mp->timer, proc->param[dh->mode].timeout);
+	if (timeout)
+		dect_timer_start_ms(dh, mp->timer, timeout);
 
 	mme->current = mp;
 	return 0;
 }
 
+static void dect_mm_admission_put(struct dect_handle *dh,
+				  struct dect_mm_endpoint *mme);
+
 static int dect_mm_procedure_respond(struct dect_handle *dh,
 				     struct dect_mm_endpoint *mme,
 				     enum dect_mm_procedures type)
@@ -431,6 +483,7 @@ static int dect_mm_procedure_respond(struct dect_handle *dh,
 	mp->type     = type;
 	mp->priority = priority;
 	mp->iec      = NULL;
+	mp->start    = 0;
 
 	mme->current = mp;
 	return 0;
@@ -448,13 +501,16 @@ static void dect_mm_procedure_complete(struct dect_handle *dh,
 	if (mp->iec != NULL)
 		__dect_ie_collection_put(dh, mp->iec);
 
+	dect_stats_latency(dh, dect_mm_proc[mp->type].latency, mp->start);
 	dect_transaction_close(dh, &mp->transaction, DECT_DDL_RELEASE_PARTIAL);
 	mp->type = DECT_MMP_NONE;
 
 	if (mme->procedure[!mp->role].type != DECT_MMP_NONE)
 		mme->current = &mme->procedure[!mp->role];
-	else
+	else {
 		mme->current = NULL;
+		dect_mm_admission_put(dh, mme);
+	}
 }
 
 #define dect_mm_procedure_cancel dect_mm_procedure_complete
@@ -471,6 +527,7 @@ static void dect_mm_procedure_timeout(struct dect_handle *dh,
 	dect_debug(DECT_DEBUG_MM, "\n");
 	if (mp->retransmissions++ == 0) {
 		mm_debug(mme, "timeout, retransmitting");
+		mp->rtt_start = 0;
 		dect_lce_retransmit(dh, &mp->transaction);
 		dect_timer_start(dh, mp->timer, proc->param[dh->mode].timeout);
 	} else {
@@ -480,18 +537,16 @@ static void dect_mm_procedure_timeout(struct dect_handle *dh,
 	}
 }
 
-static int dect_mm_procedure_init(struct dect_handle *dh,
-				  struct dect_mm_endpoint *mme,
-				  enum dect_transaction_role role)
+static void dect_mm_procedure_init(struct dect_handle *dh,
+				   struct dect_mm_endpoint *mme,
+				   enum dect_transaction_role role,
+				   void *timers)
 {
 	struct dect_mm_procedure *mp = &mme->procedure[role];
 
 	mp->role  = role;
-	mp->timer = dect_timer_alloc(dh);
-	if (mp->timer == NULL)
-		return -1;
-	dect_timer_setup(mp->timer, dect_mm_procedure_timeout, mp);
-	return 0;
+	mp->timer = dect_timer_embed(dh, timers, role,
+				     dect_mm_procedure_timeout, mp);
 }
 
 /*
@@ -513,49 +568,60 @@ static struct dect_mm_endpoint *
 dect_mm_endpoint_get_by_link(const struct dect_handle *dh,
 			     const struct dect_data_link *link)
 {
-	struct dect_mm_endpoint *mme;
+	return link->endpoints[DECT_PD_MM];
+}
 
-	list_for_each_entry(mme, &dh->mme_list, list) {
-		if (mme->link == link)
-			return mme;
-	}
-	return NULL;
+static void dect_mm_endpoint_bind(struct dect_mm_endpoint *mme,
+				  struct dect_data_link *link)
+{
+	mme->link = link;
+	if (link != NULL && link->endpoints[DECT_PD_MM] == NULL)
+		link->endpoints[DECT_PD_MM] = mme;
+}
+
+static void dect_mm_endpoint_unbind(struct dect_mm_endpoint *mme)
+{
+	if (mme->link != NULL && mme->link->endpoints[DECT_PD_MM] == mme)
+		mme->link->endpoints[DECT_PD_MM] = NULL;
+	mme->link = NULL;
 }
 
 struct dect_mm_endpoint *dect_mm_endpoint_alloc(struct dect_handle *dh,
 						struct dect_data_link *ddl)
 {
 	struct dect_mm_endpoint *mme;
-
-	mme = dect_zalloc(dh, sizeof(*mme) + dh->ops->mm_ops->priv_size);
+	void *timers;
+	size_t size;
+
+	size = align(sizeof(*mme) + dh->ops->mm_ops->priv_size,
+		     __alignof__(uint64_t));
+	mme = dect_cache_alloc(dh, DECT_MEM_MM_ENDPOINT,
+			       size + (DECT_TRANSACTION_MAX + 1) *
+			       dect_timer_size(dh));
 	if (mme == NULL)
-		goto err1;
-	if (dect_mm_procedure_init(dh, mme, DECT_TRANSACTION_INITIATOR) < 0)
-		goto err2;
-	if (dect_mm_procedure_init(dh, mme, DECT_TRANSACTION_RESPONDER) < 0)
-		goto err3;
-	mme->link = ddl;
+		return NULL;
+	timers = (void *)mme + size;
+
+	dect_mm_procedure_init(dh, mme, DECT_TRANSACTION_INITIATOR, timers);
+	dect_mm_procedure_init(dh, mme, DECT_TRANSACTION_RESPONDER, timers);
+	dect_mm_endpoint_bind(mme, ddl);
 
 	list_add_tail(&mme->list, &dh->mme_list);
 	return mme;
-
-	dect_timer_free(dh, mme->procedure[DECT_TRANSACTION_RESPONDER].timer);
-err3:
-	dect_timer_free(dh, mme->procedure[DECT_TRANSACTION_INITIATOR].timer);
-err2:
-	dect_free(dh, mme);
-err1:
-	return NULL;
 }
 EXPORT_SYMBOL(dect_mm_endpoint_alloc);
 
 void dect_mm_endpoint_destroy(struct dect_handle *dh,
 			      struct dect_mm_endpoint *mme)
 {
+	dect_mm_admission_put(dh, mme);
+	dect_mm_provision_endpoint_destroy(dh, mme);
+	dect_mm_secure_endpoint_destroy(dh, mme);
+	dect_mm_endpoint_unbind(mme);
 	list_del(&mme->list);
-	dect_timer_free(dh, mme->procedure[DECT_TRANSACTION_RESPONDER].timer);
-	dect_timer_free(dh, mme->procedure[DECT_TRANSACTION_INITIATOR].timer);
-	dect_free(dh, mme);
+	dect_assert(!dect_timer_running(mme->procedure[DECT_TRANSACTION_INITIATOR].timer));
+	dect_assert(!dect_timer_running(mme->procedure[DECT_TRANSACTION_RESPONDER].timer));
+	dect_cache_free(dh, mme);
 }
 EXPORT_SYMBOL(dect_mm_endpoint_destroy);
 
@@ -700,6 +766,9 @@ static void dect_mm_rcv_key_allocate(struct dect_handle *dh,
 	if (dect_mm_procedure_respond(dh, mme, DECT_MMP_KEY_ALLOCATION) < 0)
 		return;
 
+	/* The key allocation changes the authentication key */
+	dect_auth_ks_cache_invalidate(dh, &mme->link->ipui);
+
 	if (dect_parse_sfmt_msg(dh, &mm_key_allocate_msg_desc,
 				&msg.common, mb) < 0)
 		goto err1;
@@ -886,6 +955,75 @@ void dect_mm_authenticate_res(struct dect_handle *dh,
 }
 EXPORT_SYMBOL(dect_mm_authenticate_res);
 
+/*
+ * Respond to an authentication request using the key store. The PT responds
+ * with RES1 and stores the derived cipher key if requested, the FT responds
+ * with RES2 using a new RS.
+ */
+static bool dect_mm_keystore_authenticate_ind(struct dect_handle *dh,
+					      struct dect_mm_endpoint *mme,
+					      const struct dect_mm_authenticate_param *param)
+{
+	const struct dect_ie_auth_type *auth_type = param->auth_type;
+	const struct dect_keystore_entry *e;
+	uint8_t k[DECT_AUTH_KEY_LEN], ks[DECT_AUTH_KEY_LEN];
+	uint8_t dck[DECT_CIPHER_KEY_LEN];
+	struct dect_ie_auth_res res;
+	struct dect_ie_auth_value rs;
+	struct dect_mm_authenticate_param reply = {
+		.res		= &res,
+	};
+	bool handled = false;
+
+	if (auth_type == NULL || param->rand == NULL ||
+	    auth_type->auth_id != DECT_AUTH_DSAA)
+		return false;
+	if (dh->mode == DECT_MODE_PP && param->rs == NULL)
+		return false;
+
+	e = dect_keystore_get(dh, mme->link);
+	if (e == NULL)
+		return false;
+
+	switch (auth_type->auth_key_type) {
+	case DECT_KEY_USER_AUTHENTICATION_KEY:
+		if (!(e->flags & DECT_KEYSTORE_UAK))
+			return false;
+		dect_auth_b1(e->uak, sizeof(e->uak), k);
+		break;
+	case DECT_KEY_AUTHENTICATION_CODE:
+		if (!(e->flags & DECT_KEYSTORE_AC))
+			return false;
+		dect_auth_b1(e->ac, sizeof(e->ac), k);
+		break;
+	default:
+		return false;
+	}
+
+	mm_debug(mme, "MM_AUTHENTICATE-ind: using key store");
+	if (dh->mode == DECT_MODE_PP) {
+		dect_auth_a11(k, param->rs->value, ks);
+		dect_auth_a12(ks, param->rand->value, dck, &res.value);
+		dect_mm_authenticate_res(dh, mme, true, &reply);
+		if (auth_type->flags & DECT_AUTH_FLAG_UPC)
+			dect_keystore_set_dck(dh, mme->link, dck,
+					      auth_type->cipher_key_num);
+	} else {
+		if (getrandom(&rs.value, sizeof(rs.value), 0) != sizeof(rs.value))
+			goto out;
+		reply.rs = &rs;
+		dect_auth_a21(k, rs.value, ks);
+		dect_auth_a22(ks, param->rand->value, &res.value);
+		dect_mm_authenticate_res(dh, mme, true, &reply);
+	}
+	handled = true;
+out:
+	memset(k, 0, sizeof(k));
+	memset(ks, 0, sizeof(ks));
+	memset(dck, 0, sizeof(dck));
+	return handled;
+}
+
 static void dect_mm_rcv_authentication_request(struct dect_handle *dh,
 					       struct dect_mm_endpoint *mme,
 					       struct dect_msg_buf *mb)
@@ -923,7 +1061,9 @@ static void dect_mm_rcv_authentication_request(struct dect_handle *dh,
 		mp->type = DECT_MMP_AUTHENTICATE;
 
 	mm_debug(mme, "MM_AUTHENTICATE-ind");
-	dh->ops->mm_ops->mm_authenticate_ind(dh, mme, param);
+	if (!dect_mm_provision_authenticate_ind(dh, mme, param) &&
+	    (mp == mpi || !dect_mm_keystore_authenticate_ind(dh, mme, param)))
+		dh->ops->mm_ops->mm_authenticate_ind(dh, mme, param);
 	dect_ie_collection_put(dh, param);
 err1:
 	dect_msg_free(dh, &mm_authentication_request_msg_desc, &msg.common);
@@ -937,7 +1077,9 @@ static void dect_mm_authentication_abort(struct dect_handle *dh,
 	struct dect_mm_authenticate_param param = {};
 
 	mm_debug(mme, "MM_AUTHENTICATE-cfm: accept: 0");
-	dh->ops->mm_ops->mm_authenticate_cfm(dh, mme, false, &param);
+	if (!dect_mm_provision_authenticate_cfm(dh, mme, false, &param) &&
+	    !dect_mm_secure_authenticate_cfm(dh, mme, false, &param))
+		dh->ops->mm_ops->mm_authenticate_cfm(dh, mme, false, &param);
 }
 
 static void dect_mm_rcv_authentication_reply(struct dect_handle *dh,
@@ -974,7 +1116,9 @@ static void dect_mm_rcv_authentication_reply(struct dect_handle *dh,
 	dect_mm_procedure_complete(dh, mme);
 
 	mm_debug(mme, "MM_AUTHENTICATE-cfm: accept: 1");
-	dh->ops->mm_ops->mm_authenticate_cfm(dh, mme, true, param);
+	if (!dect_mm_provision_authenticate_cfm(dh, mme, true, param) &&
+	    !dect_mm_secure_authenticate_cfm(dh, mme, true, param))
+		dh->ops->mm_ops->mm_authenticate_cfm(dh, mme, true, param);
 	dect_ie_collection_put(dh, param);
 err1:
 	dect_msg_free(dh, &mm_authentication_reply_msg_desc, &msg.common);
@@ -1011,7 +1155,9 @@ static void dect_mm_rcv_authentication_reject(struct dect_handle *dh,
 	dect_mm_procedure_complete(dh, mme);
 
 	mm_debug(mme, "MM_AUTHENTICATE-cfm: accept: 0");
-	dh->ops->mm_ops->mm_authenticate_cfm(dh, mme, false, param);
+	if (!dect_mm_provision_authenticate_cfm(dh, mme, false, param) &&
+	    !dect_mm_secure_authenticate_cfm(dh, mme, false, param))
+		dh->ops->mm_ops->mm_authenticate_cfm(dh, mme, false, param);
 	dect_ie_collection_put(dh, param);
 err1:
 	dect_msg_free(dh, &mm_authentication_reject_msg_desc, &msg.common);
@@ -1142,6 +1288,31 @@ out:
 }
 EXPORT_SYMBOL(dect_mm_cipher_res);
 
+/* Accept a cipher request of the FT using the stored derived cipher key */
+static bool dect_mm_keystore_cipher_ind(struct dect_handle *dh,
+					struct dect_mm_endpoint *mme,
+					const struct dect_mm_cipher_param *param)
+{
+	const struct dect_ie_cipher_info *cipher_info = param->cipher_info;
+	const struct dect_keystore_entry *e;
+	struct dect_mm_cipher_param reply = {
+		.cipher_info	= param->cipher_info,
+	};
+
+	if (cipher_info == NULL || !cipher_info->enable ||
+	    cipher_info->cipher_key_type != DECT_CIPHER_DERIVED_KEY)
+		return false;
+
+	e = dect_keystore_get(dh, mme->link);
+	if (e == NULL || !(e->flags & DECT_KEYSTORE_DCK) ||
+	    e->cipher_key_num != cipher_info->cipher_key_num)
+		return false;
+
+	mm_debug(mme, "MM_CIPHER-ind: using key store");
+	dect_mm_cipher_res(dh, mme, true, &reply, e->dck);
+	return true;
+}
+
 static void dect_mm_rcv_cipher_request(struct dect_handle *dh,
 				       struct dect_mm_endpoint *mme,
 				       struct dect_msg_buf *mb)
@@ -1172,7 +1343,8 @@ static void dect_mm_rcv_cipher_request(struct dect_handle *dh,
 	param->escape_to_proprietary	= dect_ie_hold(msg.escape_to_proprietary);
 
 	mm_debug(mme, "MM_CIPHER-ind");
-	dh->ops->mm_ops->mm_cipher_ind(dh, mme, param);
+	if (!dect_mm_keystore_cipher_ind(dh, mme, param))
+		dh->ops->mm_ops->mm_cipher_ind(dh, mme, param);
 	dect_ie_collection_put(dh, param);
 
 	return dect_msg_free(dh, &mm_cipher_request_msg_desc, &msg.common);
@@ -1227,7 +1399,8 @@ static void dect_mm_cipher_abort(struct dect_handle *dh,
 	struct dect_mm_cipher_param param = {};
 
 	mm_debug(mme, "MM_CIPHER-cfm: accept: 0");
-	dh->ops->mm_ops->mm_cipher_cfm(dh, mme, false, &param);
+	if (!dect_mm_secure_cipher_cfm(dh, mme, false))
+		dh->ops->mm_ops->mm_cipher_cfm(dh, mme, false, &param);
 }
 
 static void dect_mm_rcv_cipher_reject(struct dect_handle *dh,
@@ -1253,7 +1426,8 @@ static void dect_mm_rcv_cipher_reject(struct dect_handle *dh,
 	dect_mm_procedure_complete(dh, mme);
 
 	mm_debug(mme, "MM_CIPHER-cfm: accept: 0");
-	dh->ops->mm_ops->mm_cipher_cfm(dh, mme, false, param);
+	if (!dect_mm_secure_cipher_cfm(dh, mme, false))
+		dh->ops->mm_ops->mm_cipher_cfm(dh, mme, false, param);
 	dect_ie_collection_put(dh, param);
 err1:
 	dect_msg_free(dh, &mm_cipher_reject_msg_desc, &msg.common);
@@ -1267,7 +1441,8 @@ static void dect_mm_cipher_cfm(struct dect_handle *dh,
 	dect_mm_procedure_complete(dh, mme);
 
 	mm_debug(mme, "MM_CIPHER-cfm: accept: 1");
-	dh->ops->mm_ops->mm_cipher_cfm(dh, mme, true, NULL);
+	if (!dect_mm_secure_cipher_cfm(dh, mme, true))
+		dh->ops->mm_ops->mm_cipher_cfm(dh, mme, true, NULL);
 }
 
 static void dect_mm_encrypt_ind(struct dect_handle *dh, struct dect_transaction *ta,
@@ -1360,7 +1535,7 @@ static int dect_mm_send_access_rights_accept(const struct dect_handle *dh,
 					     const struct dect_mm_endpoint *mme,
 					     const struct dect_mm_access_rights_param *param)
 {
-	struct dect_ie_fixed_identity fixed_identity;
+	struct dect_ie_fixed_identity fixed_identity = {};
 	struct dect_mm_access_rights_accept_msg msg = {
 		.portable_identity	= param->portable_identity,
 		.fixed_identity		= param->fixed_identity,
@@ -1476,7 +1651,10 @@ static void dect_mm_rcv_access_rights_request(struct dect_handle *dh,
 	mp->iec = dect_ie_collection_hold(param);
 
 	mm_debug(mme, "MM_ACCESS_RIGHTS-ind");
-	dh->ops->mm_ops->mm_access_rights_ind(dh, mme, param);
+	if (!dect_mm_provision_access_rights_ind(dh, mme, param) &&
+	    dect_ind_queue(dh, mme->link, DECT_IND_MM_ACCESS_RIGHTS, mme,
+			   &param->common) < 0)
+		dh->ops->mm_ops->mm_access_rights_ind(dh, mme, param);
 	dect_ie_collection_put(dh, param);
 
 	return dect_msg_free(dh, &mm_access_rights_request_msg_desc, &msg.common);
@@ -1603,7 +1781,7 @@ int dect_mm_access_rights_terminate_req(struct dect_handle *dh,
 					const struct dect_mm_access_rights_terminate_param *param)
 {
 	struct dect_mm_access_rights_terminate_request_msg msg;
-	struct dect_ie_fixed_identity fixed_identity;
+	struct dect_ie_fixed_identity fixed_identity = {};
 	int err;
 
 	mm_debug_entry(mme, "MM_ACCESS_RIGHTS_TERMINATE-req");
@@ -2026,7 +2204,9 @@ static void dect_mm_rcv_locate_request(struct dect_handle *dh,
 	mp->iec = dect_ie_collection_hold(param);
 
 	mm_debug(mme, "MM_LOCATE-ind");
-	dh->ops->mm_ops->mm_locate_ind(dh, mme, param);
+	if (dect_ind_queue(dh, mme->link, DECT_IND_MM_LOCATE, mme,
+			   &param->common) < 0)
+		dh->ops->mm_ops->mm_locate_ind(dh, mme, param);
 	dect_ie_collection_put(dh, param);
 
 	return dect_msg_free(dh, &mm_locate_request_msg_desc, &msg.common);
@@ -2205,7 +2385,9 @@ static void dect_mm_rcv_detach(struct dect_handle *dh,
 	dect_mm_procedure_complete(dh, mme);
 
 	mm_debug(mme, "MM_DETACH-ind");
-	dh->ops->mm_ops->mm_detach_ind(dh, mme, param);
+	if (dect_ind_queue(dh, mme->link, DECT_IND_MM_DETACH, mme,
+			   &param->common) < 0)
+		dh->ops->mm_ops->mm_detach_ind(dh, mme, param);
 
 	dect_ie_collection_put(dh, param);
 err2:
@@ -3029,6 +3211,7 @@ static const struct dect_mm_proc dect_mm_proc[DECT_MMP_MAX + 1] = {
 	[DECT_MMP_ACCESS_RIGHTS] = {
 		.name	= "access rights",
 		.abort	= dect_mm_access_rights_abort,
+		.latency = DECT_STATS_LATENCY_MM_ACCESS_RIGHTS,
 		.param	= {
 			[DECT_MODE_PP] = {
 				.priority	= 3,
@@ -3039,6 +3222,7 @@ static const struct dect_mm_proc dect_mm_proc[DECT_MMP_MAX + 1] = {
 	[DECT_MMP_ACCESS_RIGHTS_TERMINATE] = {
 		.name	= "access rights terminate",
 		.abort	= dect_mm_access_rights_terminate_abort,
+		.latency = DECT_STATS_LATENCY_MM_ACCESS_RIGHTS_TERMINATE,
 		.param	= {
 			[DECT_MODE_FP] = {
 				.priority	= 2,
@@ -3053,6 +3237,7 @@ static const struct dect_mm_proc dect_mm_proc[DECT_MMP_MAX + 1] = {
 	[DECT_MMP_AUTHENTICATE] = {
 		.name	= "authentication",
 		.abort	= dect_mm_authentication_abort,
+		.latency = DECT_STATS_LATENCY_MM_AUTHENTICATE,
 		.param	= {
 			[DECT_MODE_FP] = {
 				.priority	= 2,
@@ -3067,6 +3252,7 @@ static const struct dect_mm_proc dect_mm_proc[DECT_MMP_MAX + 1] = {
 	[DECT_MMP_AUTHENTICATE_USER] = {
 		.name	= "user authentication",
 		.abort	= dect_mm_authentication_abort,
+		.latency = DECT_STATS_LATENCY_MM_AUTHENTICATE,
 		.param	= {
 			[DECT_MODE_FP] = {
 				.priority	= 2,
@@ -3077,6 +3263,7 @@ static const struct dect_mm_proc dect_mm_proc[DECT_MMP_MAX + 1] = {
 	[DECT_MMP_KEY_ALLOCATION]  {
 		.name	= "key allocation",
 		.abort	= dect_mm_authentication_abort,
+		.latency = DECT_STATS_LATENCY_MM_KEY_ALLOCATION,
 		.param	= {
 			[DECT_MODE_FP] = {
 				.priority	= 2,
@@ -3087,6 +3274,7 @@ static const struct dect_mm_proc dect_mm_proc[DECT_MMP_MAX + 1] = {
 	[DECT_MMP_LOCATION_REGISTRATION] = {
 		.name	= "location registration",
 		.abort	= dect_mm_locate_abort,
+		.latency = DECT_STATS_LATENCY_MM_LOCATION_REGISTRATION,
 		.param	= {
 			[DECT_MODE_PP] = {
 				.priority	= 3,
@@ -3097,6 +3285,7 @@ static const struct dect_mm_proc dect_mm_proc[DECT_MMP_MAX + 1] = {
 	[DECT_MMP_TEMPORARY_IDENTITY_ASSIGNMENT] = {
 		.name	= "temporary identity assignment",
 		.abort	= dect_mm_temporary_identity_assign_abort,
+		.latency = DECT_STATS_LATENCY_MM_TEMPORARY_IDENTITY_ASSIGNMENT,
 		.param	= {
 			[DECT_MODE_FP] = {
 				.priority	= 2,
@@ -3107,6 +3296,7 @@ static const struct dect_mm_proc dect_mm_proc[DECT_MMP_MAX + 1] = {
 	[DECT_MMP_IDENTIFICATION] = {
 		.name	= "identification",
 		.abort	= dect_mm_identity_abort,
+		.latency = DECT_STATS_LATENCY_MM_IDENTIFICATION,
 		.param	= {
 			[DECT_MODE_FP] = {
 				.priority	= 2,
@@ -3117,6 +3307,7 @@ static const struct dect_mm_proc dect_mm_proc[DECT_MMP_MAX + 1] = {
 	[DECT_MMP_CIPHER] = {
 		.name	= "ciphering",
 		.abort	= dect_mm_cipher_abort,
+		.latency = DECT_STATS_LATENCY_MM_CIPHER,
 		.param	= {
 			[DECT_MODE_FP] = {
 				.priority	= 2,
@@ -3131,6 +3322,7 @@ static const struct dect_mm_proc dect_mm_proc[DECT_MMP_MAX + 1] = {
 	[DECT_MMP_PARAMETER_RETRIEVAL] = {
 		.name	= "parameter retrieval",
 		.abort	= dect_mm_info_abort,
+		.latency = DECT_STATS_LATENCY_MM_PARAMETER_RETRIEVAL,
 		.param	= {
 			[DECT_MODE_FP] = {
 				.priority	= 2,
@@ -3144,6 +3336,7 @@ static const struct dect_mm_proc dect_mm_proc[DECT_MMP_MAX + 1] = {
 	},
 	[DECT_MMP_DETACH] = {
 		.name	= "detach",
+		.latency = DECT_STATS_LATENCY_MM_DETACH,
 		.param	= {
 			[DECT_MODE_PP] = {
 				.priority	= 3,
@@ -3156,6 +3349,12 @@ static void dect_mm_rcv(struct dect_handle *dh, struct dect_transaction *ta,
 			struct dect_msg_buf *mb)
 {
 	struct dect_mm_endpoint *mme = dect_mm_endpoint(ta);
+	struct dect_mm_procedure *mp = &mme->procedure[DECT_TRANSACTION_INITIATOR];
+
+	if (ta == &mp->transaction && mp->rtt_start != 0) {
+		dect_ddl_rtt_sample(dh, ta->link, DECT_RTT_MM, mp->rtt_start);
+		mp->rtt_start = 0;
+	}
 
 	switch (mb->type) {
 	case DECT_MM_AUTHENTICATION_REQUEST:
@@ -3197,12 +3396,250 @@ static void dect_mm_rcv(struct dect_handle *dh, struct dect_transaction *ta,
 	mm_debug(mme, "receive unknown msg type %x", mb->type);
 }
 
+static struct dect_mm_endpoint *
+dect_mm_endpoint_get_or_alloc(struct dect_handle *dh,
+			      struct dect_data_link *ddl)
+{
+	struct dect_mm_endpoint *mme;
+
+	mme = dect_mm_endpoint_get_by_link(dh, ddl);
+	if (mme == NULL)
+		mme = dect_mm_endpoint_alloc(dh, ddl);
+	return mme;
+}
+
+/*
+ * Admission control
+ *
+ * Location registration and access rights requests arrive in bursts, for
+ * instance when a base station restarts and all PPs register again. At most
+ * @max_active of them are processed concurrently, an endpoint holds its slot
+ * until it has no more active procedures. Further requests are queued in
+ * order of arrival and refused with the configured reject reason when the
+ * queue is full or they could not be admitted within the queue timeout.
+ */
+
+/**
+ * struct dect_mm_admission_entry - deferred MM request
+ *
+ * @list:	admission queue node
+ * @req:	transaction request of the message
+ * @mb:		copy of the received message
+ * @deadline:	time in milliseconds at which the request is refused
+ */
+struct dect_mm_admission_entry {
+	struct list_head		list;
+	struct dect_transaction		req;
+	struct dect_msg_buf		*mb;
+	uint64_t			deadline;
+};
+
+static bool dect_mm_admission_controlled(const struct dect_msg_buf *mb)
+{
+	return mb->type == DECT_MM_LOCATE_REQUEST ||
+	       mb->type == DECT_MM_ACCESS_RIGHTS_REQUEST;
+}
+
+static void dect_mm_admission_reject(struct dect_handle *dh,
+				     struct dect_transaction *req,
+				     const struct dect_msg_buf *mb)
+{
+	struct dect_lce_admission *adm = &dh->admission;
+	struct dect_ie_reject_reason reject_reason;
+	struct dect_mm_endpoint *mme;
+	struct dect_transaction *ta;
+	enum dect_mm_procedures type;
+
+	adm->stats.rejected++;
+	reject_reason.reason = adm->cfg.reject_reason ? : DECT_REJECT_OVERLOAD;
+
+	mme = dect_mm_endpoint_get_or_alloc(dh, req->link);
+	if (mme == NULL)
+		return;
+	mm_debug(mme, "admission: reject msg type %x", mb->type);
+
+	ta = &mme->procedure[DECT_TRANSACTION_RESPONDER].transaction;
+	dect_transaction_confirm(dh, ta, req);
+
+	if (mb->type == DECT_MM_LOCATE_REQUEST)
+		type = DECT_MMP_LOCATION_REGISTRATION;
+	else
+		type = DECT_MMP_ACCESS_RIGHTS;
+	if (dect_mm_procedure_respond(dh, mme, type) < 0) {
+		dect_transaction_close(dh, ta, DECT_DDL_RELEASE_PARTIAL);
+		return;
+	}
+
+	if (type == DECT_MMP_LOCATION_REGISTRATION) {
+		struct dect_mm_locate_param reply = {
+			.reject_reason	= &reject_reason,
+		};
+		dect_mm_send_locate_reject(dh, mme, &reply);
+	} else {
+		struct dect_mm_access_rights_param reply = {
+			.reject_reason	= &reject_reason,
+		};
+		dect_mm_send_access_rights_reject(dh, mme, &reply);
+	}
+	dect_mm_procedure_complete(dh, mme);
+}
+
+static void dect_mm_admission_dequeue(struct dect_handle *dh,
+				      struct dect_mm_admission_entry *e)
+{
+	list_del(&e->list);
+	dh->admission.stats.queued--;
+	dect_mbuf_free(dh, e->mb);
+	dect_free(dh, e);
+}
+
+static void dect_mm_open_endpoint(struct dect_handle *dh,
+				  struct dect_transaction *req,
+				  struct dect_msg_buf *mb, bool admitted);
+
+static void dect_mm_admission_timer(struct dect_handle *dh,
+				    struct dect_timer *timer)
+{
+	struct dect_lce_admission *adm = &dh->admission;
+	struct dect_mm_admission_entry *e;
+	uint64_t now = dect_timer_now();
+
+	/* The queue may change while requests are processed, always restart
+	 * from the head. */
+	while (!list_empty(&adm->queue)) {
+		e = list_first_entry(&adm->queue, struct dect_mm_admission_entry,
+				     list);
+		list_del_init(&e->list);
+
+		if (e->deadline <= now) {
+			adm->stats.timeouts++;
+			dect_mm_admission_reject(dh, &e->req, e->mb);
+		} else if (adm->cfg.max_active == 0 ||
+			   adm->stats.active < adm->cfg.max_active) {
+			adm->stats.active++;
+			adm->stats.admitted++;
+			dect_mm_open_endpoint(dh, &e->req, e->mb, true);
+		} else {
+			list_add(&e->list, &adm->queue);
+			break;
+		}
+
+		adm->stats.queued--;
+		dect_mbuf_free(dh, e->mb);
+		dect_free(dh, e);
+	}
+
+	if (!list_empty(&adm->queue)) {
+		e = list_first_entry(&adm->queue, struct dect_mm_admission_entry,
+				     list);
+		dect_timer_start_ms(dh, adm->timer, e->deadline - now);
+	}
+}
+
+static int dect_mm_admission_defer(struct dect_handle *dh,
+				   const struct dect_transaction *req,
+				   const struct dect_msg_buf *mb)
+{
+	struct dect_lce_admission *adm = &dh->admission;
+	struct dect_mm_admission_entry *e;
+
+	if (adm->stats.queued >= adm->cfg.max_queued)
+		goto err1;
+
+	if (adm->timer == NULL) {
+		adm->timer = dect_timer_alloc(dh);
+		if (adm->timer == NULL)
+			goto err1;
+		dect_timer_setup(adm->timer, dect_mm_admission_timer, NULL);
+	}
+
+	e = dect_malloc(dh, sizeof(*e));
+	if (e == NULL)
+		goto err1;
+	e->mb = dect_mbuf_alloc_raw(dh);
+	if (e->mb == NULL)
+		goto err2;
+
+	memcpy(e->mb->data, mb->data, mb->len);
+	e->mb->len  = mb->len;
+	e->mb->type = mb->type;
+	e->req	    = *req;
+	e->deadline = dect_timer_now() + adm->cfg.queue_timeout;
+
+	list_add_tail(&e->list, &adm->queue);
+	adm->stats.queued++;
+	adm->stats.deferred++;
+	if (!dect_timer_running(adm->timer))
+		dect_timer_start_ms(dh, adm->timer, adm->cfg.queue_timeout);
+	return 0;
+
+err2:
+	dect_free(dh, e);
+err1:
+	return -1;
+}
+
+/* Returns true if the request may be processed immediately */
+static bool dect_mm_admission_get(struct dect_handle *dh,
+				  struct dect_transaction *req,
+				  struct dect_msg_buf *mb)
+{
+	struct dect_lce_admission *adm = &dh->admission;
+
+	if (list_empty(&adm->queue) &&
+	    (adm->cfg.max_active == 0 ||
+	     adm->stats.active < adm->cfg.max_active)) {
+		adm->stats.active++;
+		adm->stats.admitted++;
+		return true;
+	}
+
+	if (dect_mm_admission_defer(dh, req, mb) < 0)
+		dect_mm_admission_reject(dh, req, mb);
+	return false;
+}
+
+static void dect_mm_admission_put(struct dect_handle *dh,
+				  struct dect_mm_endpoint *mme)
+{
+	struct dect_lce_admission *adm = &dh->admission;
+
+	if (!mme->admitted)
+		return;
+	mme->admitted = false;
+	adm->stats.active--;
+
+	/* Admit the next request from the event loop */
+	if (!list_empty(&adm->queue))
+		dect_timer_start_ms(dh, adm->timer, 0);
+}
+
+static void dect_mm_admission_rebind(struct dect_handle *dh,
+				     struct dect_data_link *from,
+				     struct dect_data_link *to)
+{
+	struct dect_lce_admission *adm = &dh->admission;
+	struct dect_mm_admission_entry *e, *next;
+
+	list_for_each_entry_safe(e, next, &adm->queue, list) {
+		if (e->req.link != from)
+			continue;
+		if (to != NULL)
+			e->req.link = to;
+		else
+			dect_mm_admission_dequeue(dh, e);
+	}
+
+	if (list_empty(&adm->queue) && adm->timer != NULL &&
+	    dect_timer_running(adm->timer))
+		dect_timer_stop(dh, adm->timer);
+}
+
 static void dect_mm_open(struct dect_handle *dh,
 			 struct dect_transaction *req,
 			 struct dect_msg_buf *mb)
 {
-	struct dect_mm_endpoint *mme;
-	struct dect_transaction *ta;
+	bool admitted = false;
 
 	dect_debug(DECT_DEBUG_MM, "MM: unknown transaction: msg type: %x\n", mb->type);
 	switch (mb->type) {
@@ -3223,11 +3660,34 @@ static void dect_mm_open(struct dect_handle *dh,
 		return;
 	}
 
-	mme = dect_mm_endpoint_get_by_link(dh, req->link);
-	if (mme == NULL) {
-		mme = dect_mm_endpoint_alloc(dh, req->link);
-		if (mme == NULL)
+	if (dect_mm_admission_controlled(mb)) {
+		if (!dect_mm_admission_get(dh, req, mb))
 			return;
+		admitted = true;
+	}
+
+	dect_mm_open_endpoint(dh, req, mb, admitted);
+}
+
+static void dect_mm_open_endpoint(struct dect_handle *dh,
+				  struct dect_transaction *req,
+				  struct dect_msg_buf *mb, bool admitted)
+{
+	struct dect_mm_endpoint *mme;
+	struct dect_transaction *ta;
+
+	mme = dect_mm_endpoint_get_or_alloc(dh, req->link);
+	if (mme == NULL) {
+		if (admitted)
+			dh->admission.stats.active--;
+		return;
+	}
+
+	/* An endpoint holds at most one slot */
+	if (admitted) {
+		if (mme->admitted)
+			dh->admission.stats.active--;
+		mme->admitted = true;
 	}
 
 	ta = &mme->procedure[DECT_TRANSACTION_RESPONDER].transaction;
@@ -3275,7 +3735,7 @@ static void dect_mm_shutdown(struct dect_handle *dh,
 	mm_debug(mme, "shutdown");
 	dect_mm_procedure_complete(dh, mme);
 	if (mme->current == NULL)
-		mme->link = NULL;
+		dect_mm_endpoint_unbind(mme);
 	if (mp->role == DECT_TRANSACTION_INITIATOR)
 		proc->abort(dh, mme, mp);
 }
@@ -3286,13 +3746,16 @@ static void dect_mm_link_rebind(struct dect_handle *dh,
 {
 	struct dect_mm_endpoint *mme;
 
+	dect_mm_admission_rebind(dh, from, to);
+
 	mme = dect_mm_endpoint_get_by_link(dh, from);
 	if (mme == NULL)
 		return;
 
-	if (to != NULL)
-		mme->link = to;
-	else
+	if (to != NULL) {
+		dect_mm_endpoint_unbind(mme);
+		dect_mm_endpoint_bind(mme, to);
+	} else
 		dect_mm_endpoint_destroy(dh, mme);
 }
 
@@ -3305,6 +3768,7 @@ const struct dect_nwk_protocol dect_mm_protocol = {
 	.rcv			= dect_mm_rcv,
 	.encrypt_ind		= dect_mm_encrypt_ind,
 	.rebind			= dect_mm_link_rebind,
+	.retransmit		= true,
 };
 
 /** @} */
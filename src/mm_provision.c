@@ -0,0 +1,550 @@
+/*
+ * libdect bulk access rights provisioning
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @addtogroup mm
+ * @{
+ *
+ * @defgroup mm_provision Bulk provisioning
+ *
+ * Subscription of many PPs in one provisioning session on the FT.
+ *
+ * A provisioning session started using dect_mm_provision_start() takes a
+ * list of IPUIs, each with an authentication code or a preset UAK. While the
+ * session is active, {ACCESS-RIGHTS-REQUEST} messages of the listed PPs are
+ * accepted by libdect, followed by a key allocation procedure deriving a new
+ * UAK from the authentication code and optionally an authentication using
+ * the UAK. Requests of PPs which are not listed are passed to the
+ * application as usual.
+ *
+ * The key allocations and authentications of different PPs proceed
+ * concurrently, limited to @ref dect_mm_provision_cfg::max_active "max_active"
+ * PPs at a time, further PPs wait in order of their access rights requests.
+ * The progress callback is invoked on every state change of an entry, the
+ * application stores the UAK once an entry has reached
+ * #DECT_MM_PROVISION_DONE. With a @ref keystore "key store", libdect stores
+ * the UAK itself.
+ *
+ * @{
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <libdect.h>
+#include <identities.h>
+#include <utils.h>
+#include <lce.h>
+#include <mm.h>
+#include <keystore.h>
+
+#define DECT_MM_PROVISION_HASH_BITS	8
+#define DECT_MM_PROVISION_HASH_SIZE	(1 << DECT_MM_PROVISION_HASH_BITS)
+
+/**
+ * struct dect_mm_provision_pp - per-PP provisioning state
+ *
+ * @list:	ready or active list node
+ * @hnode:	IPUI hash node
+ * @entry:	application's provisioning entry
+ * @mme:	MM endpoint while a procedure is active
+ * @rand:	RAND_F of the active procedure
+ * @rs:		RS of the active procedure
+ */
+struct dect_mm_provision_pp {
+	struct list_head		list;
+	struct hlist_node		hnode;
+	struct dect_mm_provision_entry	*entry;
+	struct dect_mm_endpoint		*mme;
+	uint64_t			rand;
+	uint64_t			rs;
+};
+
+/**
+ * struct dect_mm_provision - bulk provisioning session
+ *
+ * @cfg:	session configuration
+ * @rand_fd:	file descriptor of the random source
+ * @stopping:	session is released once no more procedures are active
+ * @busy:	number of progress callbacks in progress, defers the release
+ * @active:	number of PPs with an active procedure
+ * @ready:	PPs waiting for key allocation, oldest first
+ * @active_list: PPs with an active procedure
+ * @hash:	IPUI hash of all PPs
+ * @pps:	per-PP state
+ */
+struct dect_mm_provision {
+	struct dect_mm_provision_cfg	cfg;
+	int				rand_fd;
+	bool				stopping;
+	unsigned int			busy;
+	unsigned int			active;
+	struct list_head		ready;
+	struct list_head		active_list;
+	struct hlist_head		hash[DECT_MM_PROVISION_HASH_SIZE];
+	struct dect_mm_provision_pp	pps[];
+};
+
+static void dect_mm_provision_run(struct dect_handle *dh,
+				  struct dect_mm_provision *mp);
+
+static struct dect_mm_provision_pp *
+dect_mm_provision_lookup(const struct dect_mm_provision *mp,
+			 const struct dect_ipui *ipui)
+{
+	struct dect_mm_provision_pp *pp;
+	struct hlist_node *pos;
+
+	hlist_for_each_entry(pp, pos, &mp->hash[dect_ipui_hash(ipui,
+					DECT_MM_PROVISION_HASH_BITS)], hnode) {
+		if (!dect_ipui_cmp(&pp->entry->ipui, ipui))
+			return pp;
+	}
+	return NULL;
+}
+
+static struct dect_mm_provision_pp *
+dect_mm_provision_find(const struct dect_mm_provision *mp,
+		       const struct dect_mm_endpoint *mme)
+{
+	struct dect_mm_provision_pp *pp;
+
+	list_for_each_entry(pp, &mp->active_list, list) {
+		if (pp->mme == mme)
+			return pp;
+	}
+	return NULL;
+}
+
+static void dect_mm_provision_free(struct dect_handle *dh,
+				   struct dect_mm_provision *mp)
+{
+	dh->provision = NULL;
+	close(mp->rand_fd);
+	dect_free(dh, mp);
+}
+
+/* Release a stopped session unless procedures or callbacks are active */
+static bool dect_mm_provision_release(struct dect_handle *dh,
+				      struct dect_mm_provision *mp)
+{
+	if (!mp->stopping || mp->active > 0 || mp->busy > 0)
+		return false;
+	dect_mm_provision_free(dh, mp);
+	return true;
+}
+
+/*
+ * Update the state of an entry and invoke the progress callback, which may
+ * stop the session. Returns false if the session has been released, @mp
+ * must not be used anymore in that case.
+ */
+static bool dect_mm_provision_set_state(struct dect_handle *dh,
+					struct dect_mm_provision *mp,
+					struct dect_mm_provision_pp *pp,
+					enum dect_mm_provision_states state)
+{
+	pp->entry->state = state;
+	if (mp->cfg.progress == NULL)
+		return true;
+
+	mp->busy++;
+	mp->cfg.progress(dh, mp, pp->entry);
+	mp->busy--;
+	return !dect_mm_provision_release(dh, mp);
+}
+
+/*
+ * Finish the active procedure of a PP. Returns false if the session has been
+ * released, @mp must not be used anymore in that case.
+ */
+static bool __dect_mm_provision_finish(struct dect_handle *dh,
+				       struct dect_mm_provision *mp,
+				       struct dect_mm_provision_pp *pp,
+				       enum dect_mm_provision_states state)
+{
+	list_del_init(&pp->list);
+	pp->mme = NULL;
+	mp->active--;
+	if (state == DECT_MM_PROVISION_DONE)
+		dect_keystore_set_uak(dh, &pp->entry->ipui, pp->entry->uak);
+	if (!dect_mm_provision_set_state(dh, mp, pp, state))
+		return false;
+	return !dect_mm_provision_release(dh, mp);
+}
+
+/* Finish the active procedure of a PP and start the next waiting PP */
+static void dect_mm_provision_finish(struct dect_handle *dh,
+				     struct dect_mm_provision *mp,
+				     struct dect_mm_provision_pp *pp,
+				     enum dect_mm_provision_states state)
+{
+	if (__dect_mm_provision_finish(dh, mp, pp, state) && !mp->stopping)
+		dect_mm_provision_run(dh, mp);
+}
+
+static int dect_mm_provision_random(struct dect_mm_provision *mp,
+				    struct dect_mm_provision_pp *pp)
+{
+	uint64_t val[2];
+
+	if (read(mp->rand_fd, val, sizeof(val)) != sizeof(val))
+		return -1;
+	pp->rand = val[0];
+	pp->rs	 = val[1];
+	return 0;
+}
+
+static int dect_mm_provision_key_allocate(struct dect_handle *dh,
+					  struct dect_mm_provision *mp,
+					  struct dect_mm_provision_pp *pp)
+{
+	struct dect_ie_allocation_type allocation_type;
+	struct dect_ie_auth_value rand, rs;
+	struct dect_mm_key_allocate_param param = {
+		.allocation_type	= &allocation_type,
+		.rand			= &rand,
+		.rs			= &rs,
+	};
+
+	if (dect_mm_provision_random(mp, pp) < 0)
+		return -1;
+
+	allocation_type.auth_id	      = DECT_AUTH_DSAA;
+	allocation_type.auth_key_num  = mp->cfg.uak_num;
+	allocation_type.auth_code_num = 0;
+	rand.value		      = pp->rand;
+	rs.value		      = pp->rs;
+
+	/* The PP is active, so the session is not released by the callback */
+	dect_mm_provision_set_state(dh, mp, pp, DECT_MM_PROVISION_KEY_ALLOCATION);
+	return dect_mm_key_allocate_req(dh, pp->mme, &param);
+}
+
+static int dect_mm_provision_authenticate(struct dect_handle *dh,
+					  struct dect_mm_provision *mp,
+					  struct dect_mm_provision_pp *pp)
+{
+	struct dect_ie_auth_type auth_type;
+	struct dect_ie_auth_value rand, rs;
+	struct dect_mm_authenticate_param param = {
+		.auth_type	= &auth_type,
+		.rand		= &rand,
+		.rs		= &rs,
+	};
+
+	if (dect_mm_provision_random(mp, pp) < 0)
+		return -1;
+
+	auth_type.auth_id	 = DECT_AUTH_DSAA;
+	auth_type.auth_key_type	 = DECT_KEY_USER_AUTHENTICATION_KEY;
+	auth_type.auth_key_num	 = mp->cfg.uak_num | DECT_AUTH_KEY_IPUI_PARK;
+	auth_type.cipher_key_num = 0;
+	auth_type.flags		 = 0;
+	rand.value		 = pp->rand;
+	rs.value		 = pp->rs;
+
+	dect_mm_provision_set_state(dh, mp, pp, DECT_MM_PROVISION_AUTHENTICATION);
+	return dect_mm_authenticate_req(dh, pp->mme, &param);
+}
+
+static int dect_mm_provision_start_pp(struct dect_handle *dh,
+				      struct dect_mm_provision *mp,
+				      struct dect_mm_provision_pp *pp)
+{
+	struct dect_data_link *ddl;
+
+	ddl = dect_ddl_connect(dh, &pp->entry->ipui);
+	if (ddl == NULL)
+		return -1;
+
+	pp->mme = ddl->endpoints[DECT_PD_MM];
+	if (pp->mme == NULL) {
+		pp->mme = dect_mm_endpoint_alloc(dh, ddl);
+		if (pp->mme == NULL)
+			return -1;
+	}
+
+	if (pp->entry->flags & DECT_MM_PROVISION_UAK)
+		return dect_mm_provision_authenticate(dh, mp, pp);
+	else
+		return dect_mm_provision_key_allocate(dh, mp, pp);
+}
+
+static void dect_mm_provision_run(struct dect_handle *dh,
+				  struct dect_mm_provision *mp)
+{
+	struct dect_mm_provision_pp *pp;
+
+	while (!list_empty(&mp->ready) &&
+	       (mp->cfg.max_active == 0 || mp->active < mp->cfg.max_active)) {
+		pp = list_first_entry(&mp->ready, struct dect_mm_provision_pp,
+				      list);
+		list_move_tail(&pp->list, &mp->active_list);
+		mp->active++;
+
+		if (dect_mm_provision_start_pp(dh, mp, pp) < 0 &&
+		    (!__dect_mm_provision_finish(dh, mp, pp,
+						 DECT_MM_PROVISION_FAILED) ||
+		     mp->stopping))
+			return;
+	}
+}
+
+/* Called from the MM layer before invoking mm_access_rights_ind */
+bool dect_mm_provision_access_rights_ind(struct dect_handle *dh,
+					 struct dect_mm_endpoint *mme,
+					 struct dect_mm_access_rights_param *param)
+{
+	struct dect_mm_provision *mp = dh->provision;
+	struct dect_mm_provision_pp *pp;
+
+	if (mp == NULL || mp->stopping)
+		return false;
+
+	pp = dect_mm_provision_lookup(mp, &param->portable_identity->ipui);
+	if (pp == NULL)
+		return false;
+	if (pp->entry->state != DECT_MM_PROVISION_PENDING &&
+	    pp->entry->state != DECT_MM_PROVISION_FAILED)
+		return false;
+
+	dect_mm_access_rights_res(dh, mme, true, param);
+
+	list_add_tail(&pp->list, &mp->ready);
+	if (dect_mm_provision_set_state(dh, mp, pp, DECT_MM_PROVISION_ACCESS_RIGHTS) &&
+	    !mp->stopping)
+		dect_mm_provision_run(dh, mp);
+	return true;
+}
+
+/* Called from the MM layer before invoking mm_authenticate_ind */
+bool dect_mm_provision_authenticate_ind(struct dect_handle *dh,
+					struct dect_mm_endpoint *mme,
+					struct dect_mm_authenticate_param *param)
+{
+	struct dect_mm_provision *mp = dh->provision;
+	struct dect_mm_provision_entry *e;
+	struct dect_mm_provision_pp *pp;
+	uint8_t k[DECT_AUTH_KEY_LEN], ks[DECT_AUTH_KEY_LEN];
+	uint8_t dck[DECT_CIPHER_KEY_LEN];
+	struct dect_ie_reject_reason reject_reason;
+	struct dect_ie_auth_res res2;
+	struct dect_mm_authenticate_param reply = {
+		.res		= &res2,
+		.reject_reason	= &reject_reason,
+	};
+	uint32_t res1;
+
+	if (mp == NULL)
+		return false;
+	pp = dect_mm_provision_find(mp, mme);
+	if (pp == NULL || pp->entry->state != DECT_MM_PROVISION_KEY_ALLOCATION)
+		return false;
+	e = pp->entry;
+
+	/* The PT proves knowledge of the AC by responding to RAND_F and
+	 * challenges the FT using RAND_P, the reverse session key KS'
+	 * becomes the new UAK. */
+	dect_auth_b1(e->ac, sizeof(e->ac), k);
+	dect_auth_a11(k, pp->rs, ks);
+	dect_auth_a12(ks, pp->rand, dck, &res1);
+
+	if (param->res == NULL || param->rand == NULL ||
+	    param->res->value != res1) {
+		reject_reason.reason = DECT_REJECT_AUTHENTICATION_FAILED;
+		dect_mm_authenticate_res(dh, mme, false, &reply);
+		dect_mm_provision_finish(dh, mp, pp, DECT_MM_PROVISION_FAILED);
+		goto out;
+	}
+
+	dect_auth_a21(k, pp->rs, ks);
+	dect_auth_a22(ks, param->rand->value, &res2.value);
+	dect_mm_authenticate_res(dh, mme, true, &reply);
+
+	memcpy(e->uak, ks, sizeof(e->uak));
+	e->flags |= DECT_MM_PROVISION_UAK;
+
+	if (!mp->cfg.authenticate)
+		dect_mm_provision_finish(dh, mp, pp, DECT_MM_PROVISION_DONE);
+	else if (dect_mm_provision_authenticate(dh, mp, pp) < 0)
+		dect_mm_provision_finish(dh, mp, pp, DECT_MM_PROVISION_FAILED);
+out:
+	memset(k, 0, sizeof(k));
+	memset(ks, 0, sizeof(ks));
+	return true;
+}
+
+/* Called from the MM layer before invoking mm_authenticate_cfm */
+bool dect_mm_provision_authenticate_cfm(struct dect_handle *dh,
+					struct dect_mm_endpoint *mme, bool accept,
+					struct dect_mm_authenticate_param *param)
+{
+	struct dect_mm_provision *mp = dh->provision;
+	struct dect_mm_provision_entry *e;
+	struct dect_mm_provision_pp *pp;
+	uint8_t k[DECT_AUTH_KEY_LEN], ks[DECT_AUTH_KEY_LEN];
+	uint32_t res1;
+
+	if (mp == NULL)
+		return false;
+	pp = dect_mm_provision_find(mp, mme);
+	if (pp == NULL)
+		return false;
+	e = pp->entry;
+
+	/* Key allocation rejected or timed out */
+	if (e->state != DECT_MM_PROVISION_AUTHENTICATION || !accept ||
+	    param->res == NULL) {
+		dect_mm_provision_finish(dh, mp, pp, DECT_MM_PROVISION_FAILED);
+		return true;
+	}
+
+	dect_auth_b1(e->uak, sizeof(e->uak), k);
+	dect_auth_a11(k, pp->rs, ks);
+	dect_auth_a12(ks, pp->rand, e->dck, &res1);
+	memset(k, 0, sizeof(k));
+	memset(ks, 0, sizeof(ks));
+
+	if (param->res->value == res1)
+		dect_mm_provision_finish(dh, mp, pp, DECT_MM_PROVISION_DONE);
+	else {
+		memset(e->dck, 0, sizeof(e->dck));
+		dect_mm_provision_finish(dh, mp, pp, DECT_MM_PROVISION_FAILED);
+	}
+	return true;
+}
+
+/* Called from the MM layer when an endpoint is destroyed */
+void dect_mm_provision_endpoint_destroy(struct dect_handle *dh,
+					const struct dect_mm_endpoint *mme)
+{
+	struct dect_mm_provision *mp = dh->provision;
+	struct dect_mm_provision_pp *pp;
+
+	if (mp == NULL)
+		return;
+	pp = dect_mm_provision_find(mp, mme);
+	if (pp != NULL)
+		dect_mm_provision_finish(dh, mp, pp, DECT_MM_PROVISION_FAILED);
+}
+
+/**
+ * Start a bulk provisioning session
+ *
+ * @param dh		libdect DECT handle
+ * @param entries	provisioning entries
+ * @param n		number of entries
+ * @param cfg		session configuration
+ *
+ * The entries must remain valid until the session has been stopped, their
+ * state is initialized to #DECT_MM_PROVISION_PENDING. Only one session may
+ * be active per handle.
+ *
+ * @return a new provisioning session or NULL on error.
+ */
+struct dect_mm_provision *
+dect_mm_provision_start(struct dect_handle *dh,
+			struct dect_mm_provision_entry *entries, unsigned int n,
+			const struct dect_mm_provision_cfg *cfg)
+{
+	struct dect_mm_provision *mp;
+	struct dect_mm_provision_pp *pp;
+	unsigned int i;
+
+	if (dh->mode != DECT_MODE_FP || dh->provision != NULL || n == 0) {
+		errno = EINVAL;
+		goto err1;
+	}
+
+	mp = dect_zalloc(dh, sizeof(*mp) + n * sizeof(mp->pps[0]));
+	if (mp == NULL)
+		goto err1;
+	mp->cfg = *cfg;
+	init_list_head(&mp->ready);
+	init_list_head(&mp->active_list);
+
+	mp->rand_fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+	if (mp->rand_fd < 0)
+		goto err2;
+
+	for (i = 0; i < n; i++) {
+		pp = &mp->pps[i];
+		pp->entry = &entries[i];
+		pp->entry->state = DECT_MM_PROVISION_PENDING;
+		init_list_head(&pp->list);
+		hlist_add_head(&pp->hnode,
+			       &mp->hash[dect_ipui_hash(&entries[i].ipui,
+					DECT_MM_PROVISION_HASH_BITS)]);
+	}
+
+	dh->provision = mp;
+	return mp;
+
+err2:
+	dect_free(dh, mp);
+err1:
+	return NULL;
+}
+EXPORT_SYMBOL(dect_mm_provision_start);
+
+/**
+ * Stop a bulk provisioning session
+ *
+ * @param dh		libdect DECT handle
+ * @param mp		provisioning session
+ *
+ * PPs waiting for key allocation fail immediately, procedures in progress
+ * are completed and the session is released afterwards. Further access
+ * rights requests are passed to the application. The session may be stopped
+ * from the progress callback.
+ */
+void dect_mm_provision_stop(struct dect_handle *dh, struct dect_mm_provision *mp)
+{
+	struct dect_mm_provision_pp *pp;
+
+	if (mp->stopping)
+		return;
+	mp->stopping = true;
+
+	/* The session is released by the last callback or below */
+	mp->busy++;
+	while (!list_empty(&mp->ready)) {
+		pp = list_first_entry(&mp->ready, struct dect_mm_provision_pp,
+				      list);
+		list_del_init(&pp->list);
+		dect_mm_provision_set_state(dh, mp, pp, DECT_MM_PROVISION_FAILED);
+	}
+	mp->busy--;
+
+	dect_mm_provision_release(dh, mp);
+}
+EXPORT_SYMBOL(dect_mm_provision_stop);
+
+/**
+ * Get the application private data of a bulk provisioning session
+ *
+ * @param mp		provisioning session
+ */
+void *dect_mm_provision_priv(const struct dect_mm_provision *mp)
+{
+	return mp->cfg.priv;
+}
+EXPORT_SYMBOL(dect_mm_provision_priv);
+
+void dect_mm_provision_exit(struct dect_handle *dh)
+{
+	if (dh->provision != NULL)
+		dect_mm_provision_free(dh, dh->provision);
+}
+
+/** @} */
+/** @} */
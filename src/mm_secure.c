@@ -0,0 +1,272 @@
+/*
+ * libdect combined authentication and ciphering
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @addtogroup mm
+ * @{
+ *
+ * @defgroup mm_secure Secure links
+ *
+ * Authentication of a PP followed by enabling ciphering in one procedure.
+ *
+ * Securing a link usually takes an authentication using
+ * dect_mm_authenticate_req(), the derivation of the cipher key using
+ * dect_auth_a12() and a ciphering request using dect_mm_cipher_req(), each
+ * step driven by the application from the confirmation of the previous one.
+ * dect_mm_secure_req() performs these steps within libdect: the expected
+ * RES1 and the cipher key are calculated while the authentication request
+ * is in transit and the ciphering request is sent as soon as the response
+ * has been verified.
+ *
+ * The derived cipher key is stored in the location table entry of the PP.
+ * Within @ref dect_mm_secure_param::dck_lifetime "dck_lifetime" seconds of
+ * its derivation, further procedures skip the authentication and enable
+ * ciphering using the stored key. If the PP rejects ciphering with a stored
+ * key, it is authenticated again.
+ *
+ * The individual MM_AUTHENTICATE-cfm and MM_CIPHER-cfm primitives are not
+ * passed to the application, the completion callback is invoked instead.
+ *
+ * @{
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/random.h>
+
+#include <libdect.h>
+#include <identities.h>
+#include <utils.h>
+#include <lce.h>
+#include <mm.h>
+#include <keystore.h>
+
+enum dect_mm_secure_states {
+	DECT_MM_SECURE_AUTHENTICATE,
+	DECT_MM_SECURE_CIPHER,
+	DECT_MM_SECURE_CIPHER_CACHED,
+};
+
+/**
+ * struct dect_mm_secure - secure link procedure
+ *
+ * @param:	procedure parameters
+ * @state:	procedure state
+ * @uak:	copy of the user authentication key
+ * @dck:	derived cipher key
+ * @res1:	expected authentication response
+ */
+struct dect_mm_secure {
+	struct dect_mm_secure_param	param;
+	enum dect_mm_secure_states	state;
+	uint8_t				uak[DECT_AUTH_KEY_LEN];
+	uint8_t				dck[DECT_CIPHER_KEY_LEN];
+	uint32_t			res1;
+};
+
+#define ms_debug(mme, fmt, args...) \
+	dect_debug(DECT_DEBUG_MM, "MM: secure link %p: " fmt "\n", \
+		   (mme), ## args)
+
+static void dect_mm_secure_free(struct dect_handle *dh,
+				struct dect_mm_endpoint *mme)
+{
+	struct dect_mm_secure *ms = mme->secure;
+
+	mme->secure = NULL;
+	memset(ms, 0, sizeof(*ms));
+	dect_free(dh, ms);
+}
+
+static void dect_mm_secure_complete(struct dect_handle *dh,
+				    struct dect_mm_endpoint *mme, bool success)
+{
+	struct dect_mm_secure_param param = mme->secure->param;
+
+	ms_debug(mme, "complete: success: %u", success);
+	dect_mm_secure_free(dh, mme);
+	param.complete(dh, mme, success, param.priv);
+}
+
+static int dect_mm_secure_cipher(struct dect_handle *dh,
+				 struct dect_mm_endpoint *mme)
+{
+	struct dect_mm_secure *ms = mme->secure;
+	struct dect_ie_cipher_info cipher_info;
+	struct dect_mm_cipher_param param = {
+		.cipher_info	= &cipher_info,
+	};
+
+	cipher_info.enable		= true;
+	cipher_info.cipher_alg_id	= DECT_CIPHER_STANDARD_1;
+	cipher_info.cipher_key_type	= DECT_CIPHER_DERIVED_KEY;
+	cipher_info.cipher_key_num	= ms->param.cipher_key_num;
+
+	return dect_mm_cipher_req(dh, mme, &param, ms->dck);
+}
+
+static int dect_mm_secure_authenticate(struct dect_handle *dh,
+				       struct dect_mm_endpoint *mme)
+{
+	struct dect_mm_secure *ms = mme->secure;
+	uint8_t k[DECT_AUTH_KEY_LEN], ks[DECT_AUTH_KEY_LEN];
+	struct dect_ie_auth_type auth_type;
+	struct dect_ie_auth_value rand, rs;
+	struct dect_mm_authenticate_param param = {
+		.auth_type	= &auth_type,
+		.rand		= &rand,
+		.rs		= &rs,
+	};
+	int err;
+
+	if (getrandom(&rand.value, sizeof(rand.value), 0) != sizeof(rand.value))
+		return -1;
+
+	auth_type.auth_id	 = DECT_AUTH_DSAA;
+	auth_type.auth_key_type	 = DECT_KEY_USER_AUTHENTICATION_KEY;
+	auth_type.auth_key_num	 = ms->param.uak_num | DECT_AUTH_KEY_IPUI_PARK;
+	auth_type.cipher_key_num = ms->param.cipher_key_num;
+	auth_type.flags		 = DECT_AUTH_FLAG_UPC;
+	rs.value		 = ms->param.rs;
+
+	ms->state = DECT_MM_SECURE_AUTHENTICATE;
+	err = dect_mm_authenticate_req(dh, mme, &param);
+	if (err < 0)
+		return err;
+
+	/* Calculate the expected response while the request is in transit */
+	dect_auth_b1(ms->uak, sizeof(ms->uak), k);
+	dect_auth_a11_cached(dh, &mme->link->ipui, k, rs.value, ks);
+	dect_auth_a12(ks, rand.value, ms->dck, &ms->res1);
+	memset(k, 0, sizeof(k));
+	memset(ks, 0, sizeof(ks));
+	return 0;
+}
+
+/* Called from the MM layer before invoking mm_authenticate_cfm */
+bool dect_mm_secure_authenticate_cfm(struct dect_handle *dh,
+				     struct dect_mm_endpoint *mme, bool accept,
+				     struct dect_mm_authenticate_param *param)
+{
+	struct dect_mm_secure *ms = mme->secure;
+	const struct dect_ipui *ipui = &mme->link->ipui;
+
+	if (ms == NULL || ms->state != DECT_MM_SECURE_AUTHENTICATE)
+		return false;
+
+	if (!accept || param->res == NULL || param->res->value != ms->res1) {
+		ms_debug(mme, "authentication failed");
+		dect_lte_update_dck(dh, ipui, NULL, 0);
+		dect_mm_secure_complete(dh, mme, false);
+		return true;
+	}
+
+	dect_lte_update_dck(dh, ipui, ms->dck, ms->param.cipher_key_num);
+	dect_keystore_set_dck(dh, mme->link, ms->dck, ms->param.cipher_key_num);
+	ms->state = DECT_MM_SECURE_CIPHER;
+	if (dect_mm_secure_cipher(dh, mme) < 0)
+		dect_mm_secure_complete(dh, mme, false);
+	return true;
+}
+
+/* Called from the MM layer before invoking mm_cipher_cfm */
+bool dect_mm_secure_cipher_cfm(struct dect_handle *dh,
+			       struct dect_mm_endpoint *mme, bool accept)
+{
+	struct dect_mm_secure *ms = mme->secure;
+
+	if (ms == NULL || ms->state == DECT_MM_SECURE_AUTHENTICATE)
+		return false;
+
+	/* The PP may have lost the stored key, derive a new one */
+	if (!accept && ms->state == DECT_MM_SECURE_CIPHER_CACHED) {
+		ms_debug(mme, "stored cipher key rejected");
+		dect_lte_update_dck(dh, &mme->link->ipui, NULL, 0);
+		if (dect_mm_secure_authenticate(dh, mme) < 0)
+			dect_mm_secure_complete(dh, mme, false);
+		return true;
+	}
+
+	dect_mm_secure_complete(dh, mme, accept);
+	return true;
+}
+
+/* Called from the MM layer when an endpoint is destroyed */
+void dect_mm_secure_endpoint_destroy(struct dect_handle *dh,
+				     struct dect_mm_endpoint *mme)
+{
+	if (mme->secure != NULL)
+		dect_mm_secure_complete(dh, mme, false);
+}
+
+/**
+ * Authenticate a PP and enable ciphering
+ *
+ * @param dh		libdect DECT handle
+ * @param mme		Mobility Management Endpoint
+ * @param param		procedure parameters
+ *
+ * Authenticates the PP using the UAK unless a derived cipher key within its
+ * lifetime is stored, and enables ciphering using the derived cipher key.
+ * Without a UAK in the parameters, the UAK stored in the key store is used.
+ * The completion callback is invoked once ciphering has been enabled or the
+ * procedure has failed. Only supported on the FP.
+ *
+ * @return 0 on success or -1 on error.
+ */
+int dect_mm_secure_req(struct dect_handle *dh, struct dect_mm_endpoint *mme,
+		       const struct dect_mm_secure_param *param)
+{
+	const struct dect_keystore_entry *e;
+	const uint8_t *uak = param->uak;
+	struct dect_mm_secure *ms;
+	int err;
+
+	if (uak == NULL) {
+		e = dect_keystore_get(dh, mme->link);
+		if (e != NULL && e->flags & DECT_KEYSTORE_UAK)
+			uak = e->uak;
+	}
+
+	if (dh->mode != DECT_MODE_FP || mme->secure != NULL ||
+	    uak == NULL || param->complete == NULL) {
+		errno = EINVAL;
+		goto err1;
+	}
+
+	ms = dect_zalloc(dh, sizeof(*ms));
+	if (ms == NULL)
+		goto err1;
+	ms->param = *param;
+	memcpy(ms->uak, uak, sizeof(ms->uak));
+	ms->param.uak = ms->uak;
+	mme->secure = ms;
+
+	if (param->dck_lifetime &&
+	    dect_lte_get_dck(dh, &mme->link->ipui, param->cipher_key_num,
+			     param->dck_lifetime, ms->dck)) {
+		ms_debug(mme, "using stored cipher key");
+		ms->state = DECT_MM_SECURE_CIPHER_CACHED;
+		err = dect_mm_secure_cipher(dh, mme);
+	} else
+		err = dect_mm_secure_authenticate(dh, mme);
+	if (err < 0)
+		goto err2;
+
+	return 0;
+
+err2:
+	dect_mm_secure_free(dh, mme);
+err1:
+	return -1;
+}
+EXPORT_SYMBOL(dect_mm_secure_req);
+
+/** @} */
+/** @} */
@@ -0,0 +1,921 @@
+/*
+ * libdect in-process mock transport
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @defgroup mock Mock transport
+ *
+ * In-process emulation of the DECT kernel stack.
+ *
+ * A mock cluster connects one FP handle and any number of PP handles opened
+ * using dect_mock_open_handle() within the same process, without requiring
+ * the DECT kernel stack or hardware. It can be used for deterministic tests
+ * and benchmarks of the complete NWK layer stack. All handles of a cluster
+ * must be processed from the same thread.
+ *
+ * Sockets are emulated using UNIX domain sockets, so the application's event
+ * handler is used unchanged:
+ *
+ * - S-SAP data links are SOCK_SEQPACKET socket pairs. Connection requests of
+ *   PPs are passed to the listener of the FP together with the data link
+ *   endpoint identifier. The release of a link is reported to the peer as
+ *   ENOTCONN.
+ * - B-SAP messages transmitted by the FP are copied to the B-SAP sockets of
+ *   all PPs, preceded by a header byte carrying the long page indication.
+ *   Messages are dropped when the receive queue of a PP is full. Socket
+ *   filters attached to B-SAP sockets are relocated to skip the header.
+ * - LU1 sockets are SOCK_STREAM socket pairs, joined when both sides have
+ *   connected to the same ULEI.
+ * - The PARI and FP capabilities are taken from the cluster.
+ *   MAC_ME_RFP_PRELOAD-req updates the capabilities of all handles and
+ *   MAC_ME_INFO-res locks a PP to the given PARI.
+ *
+ * FP initiated data links (fast setup), ciphering indications, MAC connection
+ * parameters other than the defaults, SCAN-req and raw sockets are not
+ * emulated.
+ *
+ * @{
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <linux/filter.h>
+
+#include <libdect.h>
+#include <utils.h>
+#include <io.h>
+#include <lce.h>
+
+/* Maximum number of iovecs of a B-SAP message */
+#define DECT_MOCK_IOV_MAX		16
+
+/* Maximum number of instructions of a B-SAP socket filter */
+#define DECT_MOCK_FILTER_MAX		64
+
+/* B-SAP message header flags */
+#define DECT_MOCK_BSAP_LONG_PAGE	0x1
+
+/**
+ * struct dect_mock_cluster - mock cluster
+ *
+ * @members:	handles bound to the cluster
+ * @lu_pending:	LU1 sockets waiting for their peer
+ * @pari:	PARI of the FP
+ * @fpc:	FP capabilities
+ * @stats:	statistics
+ */
+struct dect_mock_cluster {
+	struct list_head		members;
+	struct list_head		lu_pending;
+	struct dect_ari			pari;
+	struct dect_fp_capabilities	fpc;
+	struct dect_mock_stats		stats;
+};
+
+/**
+ * struct dect_mock_member - mock transport state of a handle
+ *
+ * @transport:	transport instance
+ * @list:	cluster member list node
+ * @mc:		mock cluster
+ * @dh:		libdect DECT handle
+ * @socks:	unconnected S-SAP sockets
+ * @ssap:	S-SAP listener socket, -1 if not listening
+ * @ssap_peer:	peer end of the S-SAP listener used for connection requests
+ * @b_sap:	B-SAP socket, -1 if not opened
+ * @b_sap_peer:	peer end of the B-SAP socket used for delivery
+ */
+struct dect_mock_member {
+	struct dect_transport		transport;
+	struct list_head		list;
+	struct dect_mock_cluster	*mc;
+	struct dect_handle		*dh;
+	struct list_head		socks;
+	int				ssap;
+	int				ssap_peer;
+	int				b_sap;
+	int				b_sap_peer;
+};
+
+/**
+ * struct dect_mock_sock - unconnected S-SAP socket
+ *
+ * @list:	member socket list node
+ * @fd:		socket
+ * @peer:	peer end of the socket pair, passed to the FP on connect
+ */
+struct dect_mock_sock {
+	struct list_head		list;
+	int				fd;
+	int				peer;
+};
+
+/**
+ * struct dect_mock_lu - LU1 socket waiting for its peer
+ *
+ * @list:	cluster pending list node
+ * @member:	member owning the socket
+ * @fd:		socket
+ * @peer:	peer end of the socket pair
+ * @ulei:	U-plane link endpoint identifier
+ */
+struct dect_mock_lu {
+	struct list_head		list;
+	struct dect_mock_member		*member;
+	int				fd;
+	int				peer;
+	struct sockaddr_dect_lu		ulei;
+};
+
+static const struct dect_mac_conn_params dect_mock_mcp = {
+	.service	= DECT_SERVICE_IN_MIN_DELAY,
+	.slot		= DECT_FULL_SLOT,
+};
+
+static struct dect_mock_member *dect_mock_member(struct dect_transport *t)
+{
+	return container_of(t, struct dect_mock_member, transport);
+}
+
+static struct dect_mock_member *dect_mock_cluster_fp(const struct dect_mock_cluster *mc)
+{
+	struct dect_mock_member *mm;
+
+	list_for_each_entry(mm, &mc->members, list) {
+		if (mm->dh->mode == DECT_MODE_FP)
+			return mm;
+	}
+	return NULL;
+}
+
+static struct dect_mock_sock *dect_mock_sock_lookup(const struct dect_mock_member *mm,
+						    int fd)
+{
+	struct dect_mock_sock *ms;
+
+	list_for_each_entry(ms, &mm->socks, list) {
+		if (ms->fd == fd)
+			return ms;
+	}
+	return NULL;
+}
+
+static void dect_mock_sock_free(const struct dect_mock_member *mm,
+				struct dect_mock_sock *ms)
+{
+	if (ms->peer >= 0)
+		close(ms->peer);
+	list_del(&ms->list);
+	dect_free(mm->dh, ms);
+}
+
+static void dect_mock_lu_free(struct dect_mock_lu *lu)
+{
+	close(lu->peer);
+	list_del(&lu->list);
+	dect_free(lu->member->dh, lu);
+}
+
+static int dect_mock_socket(struct dect_transport *t, int type, int protocol)
+{
+	struct dect_mock_member *mm = dect_mock_member(t);
+	struct dect_mock_sock *ms;
+	int flags = type & (SOCK_NONBLOCK | SOCK_CLOEXEC);
+	int sv[2];
+
+	switch (protocol) {
+	case DECT_B_SAP:
+		if (mm->b_sap >= 0) {
+			errno = EADDRINUSE;
+			return -1;
+		}
+		if (socketpair(AF_UNIX, SOCK_DGRAM | flags, 0, sv) < 0)
+			return -1;
+		mm->b_sap      = sv[0];
+		mm->b_sap_peer = sv[1];
+		return mm->b_sap;
+	case DECT_S_SAP:
+		ms = dect_malloc(mm->dh, sizeof(*ms));
+		if (ms == NULL)
+			return -1;
+		if (socketpair(AF_UNIX, SOCK_SEQPACKET | flags, 0, sv) < 0) {
+			dect_free(mm->dh, ms);
+			return -1;
+		}
+		ms->fd   = sv[0];
+		ms->peer = sv[1];
+		list_add_tail(&ms->list, &mm->socks);
+		return ms->fd;
+	case DECT_LU1_SAP:
+		return socket(AF_UNIX, SOCK_STREAM | flags, 0);
+	default:
+		errno = EAFNOSUPPORT;
+		return -1;
+	}
+}
+
+static void dect_mock_close(struct dect_fd *dfd)
+{
+	struct dect_mock_member *mm = dect_mock_member(dfd->transport);
+	struct dect_mock_sock *ms;
+	struct dect_mock_lu *lu;
+
+	if (dfd->fd == mm->ssap) {
+		close(mm->ssap_peer);
+		mm->ssap = mm->ssap_peer = -1;
+	} else if (dfd->fd == mm->b_sap) {
+		close(mm->b_sap_peer);
+		mm->b_sap = mm->b_sap_peer = -1;
+	} else {
+		ms = dect_mock_sock_lookup(mm, dfd->fd);
+		if (ms != NULL)
+			dect_mock_sock_free(mm, ms);
+
+		list_for_each_entry(lu, &mm->mc->lu_pending, list) {
+			if (lu->member == mm && lu->fd == dfd->fd) {
+				dect_mock_lu_free(lu);
+				break;
+			}
+		}
+	}
+	close(dfd->fd);
+}
+
+static int dect_mock_bind(struct dect_fd *dfd, const struct sockaddr *addr,
+			  socklen_t len)
+{
+	struct dect_mock_member *mm = dect_mock_member(dfd->transport);
+	struct dect_mock_sock *ms;
+
+	if (dfd->fd == mm->b_sap)
+		return 0;
+
+	/* Only the S-SAP listener of the FP is bound */
+	ms = dect_mock_sock_lookup(mm, dfd->fd);
+	if (ms == NULL || len < sizeof(struct sockaddr_dect_ssap)) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (mm->dh->mode != DECT_MODE_FP || mm->ssap >= 0) {
+		errno = EADDRINUSE;
+		return -1;
+	}
+
+	mm->ssap      = ms->fd;
+	mm->ssap_peer = ms->peer;
+	ms->peer      = -1;
+	dect_mock_sock_free(mm, ms);
+	return 0;
+}
+
+static int dect_mock_listen(struct dect_fd *dfd, int backlog)
+{
+	struct dect_mock_member *mm = dect_mock_member(dfd->transport);
+
+	if (dfd->fd != mm->ssap) {
+		errno = EINVAL;
+		return -1;
+	}
+	return 0;
+}
+
+/* Pass a socket and its address to the listener of the FP */
+static int dect_mock_send_fd(int fd, const struct sockaddr *addr,
+			     socklen_t len, int sfd)
+{
+	union {
+		struct cmsghdr		cmsg;
+		char			buf[CMSG_SPACE(sizeof(int))];
+	} cmsg_buf;
+	struct cmsghdr *cmsg;
+	struct msghdr msg;
+	struct iovec iov;
+
+	iov.iov_base		= (void *)addr;
+	iov.iov_len		= len;
+
+	memset(&msg, 0, sizeof(msg));
+	memset(&cmsg_buf, 0, sizeof(cmsg_buf));
+	msg.msg_iov		= &iov;
+	msg.msg_iovlen		= 1;
+	msg.msg_control		= &cmsg_buf;
+	msg.msg_controllen	= sizeof(cmsg_buf);
+
+	cmsg			= CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_len		= CMSG_LEN(sizeof(int));
+	cmsg->cmsg_level	= SOL_SOCKET;
+	cmsg->cmsg_type		= SCM_RIGHTS;
+	memcpy(CMSG_DATA(cmsg), &sfd, sizeof(sfd));
+
+	if (sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) < 0)
+		return -1;
+	return 0;
+}
+
+static int dect_mock_accept(const struct dect_fd *dfd, struct sockaddr *addr,
+			    socklen_t *len)
+{
+	union {
+		struct cmsghdr		cmsg;
+		char			buf[CMSG_SPACE(sizeof(int))];
+	} cmsg_buf;
+	struct cmsghdr *cmsg;
+	struct msghdr msg;
+	struct iovec iov;
+	ssize_t size;
+	int fd;
+
+	iov.iov_base		= addr;
+	iov.iov_len		= *len;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov		= &iov;
+	msg.msg_iovlen		= 1;
+	msg.msg_control		= &cmsg_buf;
+	msg.msg_controllen	= sizeof(cmsg_buf);
+
+	/* The peer end of the socket pair was created non-blocking */
+	size = recvmsg(dfd->fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+	if (size < 0)
+		return -1;
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET ||
+	    cmsg->cmsg_type != SCM_RIGHTS) {
+		errno = EPROTO;
+		return -1;
+	}
+	memcpy(&fd, CMSG_DATA(cmsg), sizeof(fd));
+
+	*len = size;
+	return fd;
+}
+
+static int dect_mock_ssap_connect(struct dect_mock_member *mm,
+				  struct dect_mock_sock *ms,
+				  const struct sockaddr *addr, socklen_t len)
+{
+	struct dect_mock_cluster *mc = mm->mc;
+	struct dect_mock_member *fp;
+
+	if (mm->dh->mode != DECT_MODE_PP) {
+		errno = ENETUNREACH;
+		goto err1;
+	}
+
+	fp = dect_mock_cluster_fp(mc);
+	if (fp == NULL || fp->ssap_peer < 0) {
+		errno = ECONNREFUSED;
+		goto err1;
+	}
+
+	/* A full accept queue must not be reported as connection in progress */
+	if (dect_mock_send_fd(fp->ssap_peer, addr, len, ms->peer) < 0) {
+		errno = ECONNREFUSED;
+		goto err1;
+	}
+
+	dect_mock_sock_free(mm, ms);
+	mc->stats.links++;
+	return 0;
+
+err1:
+	mc->stats.link_failures++;
+	return -1;
+}
+
+static int dect_mock_lu_connect(struct dect_mock_member *mm,
+				struct dect_fd *dfd,
+				const struct sockaddr *addr, socklen_t len)
+{
+	struct dect_mock_cluster *mc = mm->mc;
+	struct dect_mock_lu *lu;
+	int sv[2];
+
+	if (len != sizeof(lu->ulei)) {
+		errno = EINVAL;
+		goto err1;
+	}
+
+	/* Join the socket pair the peer created when connecting first */
+	list_for_each_entry(lu, &mc->lu_pending, list) {
+		if (lu->member->dh->mode == mm->dh->mode ||
+		    memcmp(&lu->ulei, addr, len))
+			continue;
+
+		if (dup2(lu->peer, dfd->fd) < 0)
+			goto err1;
+		dect_mock_lu_free(lu);
+		mc->stats.lu_links++;
+		return 0;
+	}
+
+	lu = dect_malloc(mm->dh, sizeof(*lu));
+	if (lu == NULL)
+		goto err1;
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) < 0)
+		goto err2;
+	if (dup2(sv[0], dfd->fd) < 0)
+		goto err3;
+	close(sv[0]);
+
+	lu->member = mm;
+	lu->fd     = dfd->fd;
+	lu->peer   = sv[1];
+	memcpy(&lu->ulei, addr, len);
+	list_add_tail(&lu->list, &mc->lu_pending);
+	return 0;
+
+err3:
+	close(sv[1]);
+	close(sv[0]);
+err2:
+	dect_free(mm->dh, lu);
+err1:
+	return -1;
+}
+
+static int dect_mock_connect(struct dect_fd *dfd, const struct sockaddr *addr,
+			     socklen_t len)
+{
+	struct dect_mock_member *mm = dect_mock_member(dfd->transport);
+	struct dect_mock_sock *ms;
+
+	ms = dect_mock_sock_lookup(mm, dfd->fd);
+	if (ms != NULL)
+		return dect_mock_ssap_connect(mm, ms, addr, len);
+	return dect_mock_lu_connect(mm, dfd, addr, len);
+}
+
+static int dect_mock_getopt(void *optval, socklen_t *optlen,
+			    const void *val, socklen_t len)
+{
+	if (*optlen < len) {
+		errno = EINVAL;
+		return -1;
+	}
+	memcpy(optval, val, len);
+	*optlen = len;
+	return 0;
+}
+
+static int dect_mock_getsockopt(const struct dect_fd *dfd, int level,
+				int optname, void *optval, socklen_t *optlen)
+{
+	struct dect_lu1_queue_stats qstats;
+
+	if (level != SOL_DECT)
+		return getsockopt(dfd->fd, level, optname, optval, optlen);
+
+	switch (optname) {
+	case DECT_DL_MAC_CONN_PARAMS:
+		return dect_mock_getopt(optval, optlen, &dect_mock_mcp,
+					sizeof(dect_mock_mcp));
+	case DECT_LU1_QUEUE_STATS:
+		memset(&qstats, 0, sizeof(qstats));
+		return dect_mock_getopt(optval, optlen, &qstats, sizeof(qstats));
+	default:
+		errno = ENOPROTOOPT;
+		return -1;
+	}
+}
+
+/*
+ * Relocate a B-SAP socket filter to the emulated message format: absolute
+ * loads are moved past the header byte, the message length loaded into the
+ * accumulator is reduced by its size and jumps are adjusted accordingly.
+ */
+static int dect_mock_bsap_filter(const struct dect_fd *dfd,
+				 const struct sock_fprog *prog)
+{
+	struct sock_filter filter[2 * DECT_MOCK_FILTER_MAX], *f;
+	unsigned int map[DECT_MOCK_FILTER_MAX + 1];
+	const struct sock_filter *insn;
+	struct sock_fprog fprog;
+	unsigned int i, n, jt, jf;
+
+	if (prog->len > DECT_MOCK_FILTER_MAX)
+		goto err;
+
+	for (i = 0, n = 0; i < prog->len; i++) {
+		map[i] = n++;
+		insn = &prog->filter[i];
+		if (insn->code == (BPF_LD | BPF_W | BPF_LEN))
+			n++;
+		else if (insn->code == (BPF_LDX | BPF_W | BPF_LEN))
+			goto err;
+	}
+	map[i] = n;
+
+	for (i = 0; i < prog->len; i++) {
+		insn = &prog->filter[i];
+		f = &filter[map[i]];
+		*f = *insn;
+
+		switch (BPF_CLASS(insn->code)) {
+		case BPF_LD:
+		case BPF_LDX:
+			if (BPF_MODE(insn->code) == BPF_ABS ||
+			    BPF_MODE(insn->code) == BPF_IND ||
+			    BPF_MODE(insn->code) == BPF_MSH)
+				f->k++;
+			else if (BPF_MODE(insn->code) == BPF_LEN)
+				f[1] = (struct sock_filter)
+					BPF_STMT(BPF_ALU | BPF_SUB | BPF_K, 1);
+			break;
+		case BPF_JMP:
+			if (BPF_OP(insn->code) == BPF_JA) {
+				if (insn->k >= prog->len - i)
+					goto err;
+				f->k = map[i + 1 + insn->k] - map[i] - 1;
+				break;
+			}
+			if (insn->jt >= prog->len - i || insn->jf >= prog->len - i)
+				goto err;
+			jt = map[i + 1 + insn->jt] - map[i] - 1;
+			jf = map[i + 1 + insn->jf] - map[i] - 1;
+			if (jt > UINT8_MAX || jf > UINT8_MAX)
+				goto err;
+			f->jt = jt;
+			f->jf = jf;
+			break;
+		}
+	}
+
+	fprog.len    = n;
+	fprog.filter = filter;
+	return setsockopt(dfd->fd, SOL_SOCKET, SO_ATTACH_FILTER,
+			  &fprog, sizeof(fprog));
+err:
+	errno = EINVAL;
+	return -1;
+}
+
+static int dect_mock_setsockopt(const struct dect_fd *dfd, int level,
+				int optname, const void *optval,
+				socklen_t optlen)
+{
+	struct dect_mock_member *mm = dect_mock_member(dfd->transport);
+
+	if (level == SOL_SOCKET && optname == SO_ATTACH_FILTER &&
+	    dfd->fd == mm->b_sap && optlen == sizeof(struct sock_fprog))
+		return dect_mock_bsap_filter(dfd, optval);
+	if (level != SOL_DECT)
+		return setsockopt(dfd->fd, level, optname, optval, optlen);
+
+	switch (optname) {
+	case DECT_DL_ENC_KEY:
+	case DECT_DL_ENCRYPT:
+	case DECT_DL_MAC_CONN_PARAMS:
+		return 0;
+	default:
+		errno = ENOPROTOOPT;
+		return -1;
+	}
+}
+
+/* Receive a B-SAP message and convert its header to auxiliary data */
+static ssize_t dect_mock_bsap_recvmsg(const struct dect_fd *dfd,
+				      struct msghdr *msg, int flags)
+{
+	struct iovec iov[DECT_MOCK_IOV_MAX + 1];
+	struct dect_bsap_auxdata aux;
+	struct cmsghdr *cmsg;
+	struct msghdr m;
+	ssize_t len;
+	uint8_t hdr;
+
+	if (msg->msg_iovlen > DECT_MOCK_IOV_MAX) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	iov[0].iov_base = &hdr;
+	iov[0].iov_len	= sizeof(hdr);
+	memcpy(&iov[1], msg->msg_iov, msg->msg_iovlen * sizeof(iov[0]));
+
+	memset(&m, 0, sizeof(m));
+	m.msg_iov	= iov;
+	m.msg_iovlen	= msg->msg_iovlen + 1;
+
+	len = recvmsg(dfd->fd, &m, flags);
+	if (len < 0)
+		return -1;
+	msg->msg_flags = m.msg_flags;
+
+	if (!(hdr & DECT_MOCK_BSAP_LONG_PAGE) ||
+	    msg->msg_controllen < CMSG_SPACE(sizeof(aux))) {
+		msg->msg_controllen = 0;
+		return len - 1;
+	}
+
+	memset(&aux, 0, sizeof(aux));
+	aux.long_page		= true;
+
+	cmsg			= CMSG_FIRSTHDR(msg);
+	cmsg->cmsg_len		= CMSG_LEN(sizeof(aux));
+	cmsg->cmsg_level	= SOL_DECT;
+	cmsg->cmsg_type		= DECT_BSAP_AUXDATA;
+	memcpy(CMSG_DATA(cmsg), &aux, sizeof(aux));
+	msg->msg_controllen	= CMSG_SPACE(sizeof(aux));
+	return len - 1;
+}
+
+static ssize_t dect_mock_recvmsg(const struct dect_fd *dfd,
+				 struct msghdr *msg, int flags)
+{
+	struct dect_mock_member *mm = dect_mock_member(dfd->transport);
+	ssize_t len;
+
+	if (dfd->fd == mm->b_sap)
+		return dect_mock_bsap_recvmsg(dfd, msg, flags);
+
+	len = recvmsg(dfd->fd, msg, flags);
+	/* An orderly shutdown by the peer releases the data link */
+	if (len == 0) {
+		errno = ENOTCONN;
+		return -1;
+	}
+	return len;
+}
+
+/* Copy a B-SAP message to all members of the opposite mode */
+static ssize_t dect_mock_broadcast(struct dect_mock_member *mm,
+				   const struct msghdr *msg)
+{
+	struct dect_mock_cluster *mc = mm->mc;
+	struct iovec iov[DECT_MOCK_IOV_MAX + 1];
+	const struct dect_bsap_auxdata *aux;
+	struct dect_mock_member *pp;
+	struct cmsghdr *cmsg;
+	struct msghdr m;
+	ssize_t len = 0;
+	uint8_t hdr = 0;
+	size_t i;
+
+	if (msg->msg_iovlen > DECT_MOCK_IOV_MAX) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	for (cmsg = CMSG_FIRSTHDR(msg); cmsg;
+	     cmsg = CMSG_NXTHDR((struct msghdr *)msg, cmsg)) {
+		if (cmsg->cmsg_level != SOL_DECT ||
+		    cmsg->cmsg_type != DECT_BSAP_AUXDATA ||
+		    cmsg->cmsg_len < CMSG_LEN(sizeof(*aux)))
+			continue;
+		aux = (struct dect_bsap_auxdata *)CMSG_DATA(cmsg);
+		if (aux->long_page)
+			hdr |= DECT_MOCK_BSAP_LONG_PAGE;
+	}
+
+	iov[0].iov_base = &hdr;
+	iov[0].iov_len	= sizeof(hdr);
+	for (i = 0; i < msg->msg_iovlen; i++) {
+		iov[i + 1] = msg->msg_iov[i];
+		len += msg->msg_iov[i].iov_len;
+	}
+
+	memset(&m, 0, sizeof(m));
+	m.msg_iov	= iov;
+	m.msg_iovlen	= msg->msg_iovlen + 1;
+
+	mc->stats.broadcasts++;
+	list_for_each_entry(pp, &mc->members, list) {
+		if (pp->dh->mode == mm->dh->mode || pp->b_sap_peer < 0)
+			continue;
+
+		if (sendmsg(pp->b_sap_peer, &m, MSG_DONTWAIT | MSG_NOSIGNAL) < 0)
+			mc->stats.drops++;
+		else
+			mc->stats.deliveries++;
+	}
+	return len;
+}
+
+static ssize_t dect_mock_sendmsg(const struct dect_fd *dfd,
+				 const struct msghdr *msg, int flags)
+{
+	struct dect_mock_member *mm = dect_mock_member(dfd->transport);
+	struct msghdr m = *msg;
+
+	if (dfd->fd == mm->b_sap)
+		return dect_mock_broadcast(mm, msg);
+
+	/* Ancillary data is specific to AF_DECT */
+	m.msg_control	 = NULL;
+	m.msg_controllen = 0;
+	return sendmsg(dfd->fd, &m, (flags & ~MSG_OOB) | MSG_NOSIGNAL);
+}
+
+static int dect_mock_sendmmsg(const struct dect_fd *dfd,
+			      struct mmsghdr *msgs, unsigned int vlen,
+			      int flags)
+{
+	unsigned int i;
+	ssize_t len;
+
+	for (i = 0; i < vlen; i++) {
+		len = dect_mock_sendmsg(dfd, &msgs[i].msg_hdr, flags);
+		if (len < 0)
+			return i > 0 ? (int)i : -1;
+		msgs[i].msg_len = len;
+	}
+	return vlen;
+}
+
+static void dect_mock_exit(struct dect_handle *dh)
+{
+	struct dect_mock_member *mm = dect_mock_member(dh->transport);
+	struct dect_mock_sock *ms, *ms_next;
+	struct dect_mock_lu *lu, *lu_next;
+
+	list_for_each_entry_safe(ms, ms_next, &mm->socks, list)
+		dect_mock_sock_free(mm, ms);
+	list_for_each_entry_safe(lu, lu_next, &mm->mc->lu_pending, list) {
+		if (lu->member == mm)
+			dect_mock_lu_free(lu);
+	}
+	if (mm->ssap_peer >= 0)
+		close(mm->ssap_peer);
+	if (mm->b_sap_peer >= 0)
+		close(mm->b_sap_peer);
+
+	list_del(&mm->list);
+	dh->transport = &dect_kernel_transport;
+	dect_free(dh, mm);
+}
+
+static int dect_mock_llme_rfp_preload_req(struct dect_handle *dh,
+					  const struct dect_fp_capabilities *fpc)
+{
+	struct dect_mock_member *mm = dect_mock_member(dh->transport);
+	struct dect_mock_cluster *mc = mm->mc;
+	struct dect_mock_member *pp;
+
+	if (dh->mode != DECT_MODE_FP) {
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	mc->fpc.hlc   = fpc->hlc;
+	mc->fpc.ehlc  = fpc->ehlc;
+	mc->fpc.ehlc2 = fpc->ehlc2;
+
+	list_for_each_entry(pp, &mc->members, list) {
+		pp->dh->fpc = mc->fpc;
+		if (pp == mm || pp->dh->ops->llme_ops == NULL)
+			continue;
+		pp->dh->ops->llme_ops->mac_me_info_ind(pp->dh, &mc->pari,
+							&pp->dh->fpc);
+	}
+	return 0;
+}
+
+static int dect_mock_llme_mac_me_info_res(struct dect_handle *dh,
+					  const struct dect_ari *pari)
+{
+	dh->pari = *pari;
+	dect_handle_tmpl_invalidate(dh);
+	return 0;
+}
+
+static int dect_mock_llme_scan_req(struct dect_handle *dh)
+{
+	errno = EOPNOTSUPP;
+	return -1;
+}
+
+static const struct dect_transport_ops dect_mock_transport_ops = {
+	.socket			= dect_mock_socket,
+	.close			= dect_mock_close,
+	.accept			= dect_mock_accept,
+	.bind			= dect_mock_bind,
+	.listen			= dect_mock_listen,
+	.connect		= dect_mock_connect,
+	.getsockopt		= dect_mock_getsockopt,
+	.setsockopt		= dect_mock_setsockopt,
+	.recvmsg		= dect_mock_recvmsg,
+	.sendmsg		= dect_mock_sendmsg,
+	.sendmmsg		= dect_mock_sendmmsg,
+	.exit			= dect_mock_exit,
+	.llme_rfp_preload_req	= dect_mock_llme_rfp_preload_req,
+	.llme_mac_me_info_res	= dect_mock_llme_mac_me_info_res,
+	.llme_scan_req		= dect_mock_llme_scan_req,
+};
+
+/**
+ * Allocate a mock cluster
+ *
+ * @param pari		PARI of the emulated FP
+ *
+ * @return a new mock cluster or NULL on error.
+ */
+struct dect_mock_cluster *dect_mock_cluster_alloc(const struct dect_ari *pari)
+{
+	struct dect_mock_cluster *mc;
+
+	mc = calloc(1, sizeof(*mc));
+	if (mc == NULL)
+		return NULL;
+	init_list_head(&mc->members);
+	init_list_head(&mc->lu_pending);
+	mc->pari = *pari;
+	return mc;
+}
+EXPORT_SYMBOL(dect_mock_cluster_alloc);
+
+/**
+ * Release a mock cluster
+ *
+ * @param mc		mock cluster
+ *
+ * All handles bound to the cluster must have been closed.
+ */
+void dect_mock_cluster_free(struct dect_mock_cluster *mc)
+{
+	dect_assert(list_empty(&mc->members));
+	free(mc);
+}
+EXPORT_SYMBOL(dect_mock_cluster_free);
+
+/**
+ * Get the statistics of a mock cluster
+ *
+ * @param mc		mock cluster
+ * @param stats		buffer to store the statistics
+ */
+void dect_mock_cluster_get_stats(const struct dect_mock_cluster *mc,
+				 struct dect_mock_stats *stats)
+{
+	*stats = mc->stats;
+}
+EXPORT_SYMBOL(dect_mock_cluster_get_stats);
+
+/**
+ * Initialize the libdect subsystems and bind to a mock cluster
+ *
+ * @param ops		DECT ops
+ * @param mc		mock cluster
+ * @param mode		cluster mode (#dect_cluster_modes)
+ *
+ * A cluster contains at most one FP. The handle is released using
+ * dect_close_handle().
+ *
+ * @return a new libdect DECT handle or NULL on error.
+ */
+struct dect_handle *dect_mock_open_handle(struct dect_ops *ops,
+					  struct dect_mock_cluster *mc,
+					  uint32_t mode)
+{
+	struct dect_mock_member *mm;
+	struct dect_handle *dh;
+
+	if ((mode != DECT_MODE_FP && mode != DECT_MODE_PP) ||
+	    (mode == DECT_MODE_FP && dect_mock_cluster_fp(mc) != NULL)) {
+		errno = EINVAL;
+		goto err1;
+	}
+
+	dh = dect_alloc_handle(ops);
+	if (dh == NULL)
+		goto err1;
+	dh->open_state = DECT_OPEN_FAILED;
+
+	mm = dect_zalloc(dh, sizeof(*mm));
+	if (mm == NULL)
+		goto err2;
+	mm->transport.ops = &dect_mock_transport_ops;
+	mm->mc		  = mc;
+	mm->dh		  = dh;
+	init_list_head(&mm->socks);
+	mm->ssap	  = mm->ssap_peer  = -1;
+	mm->b_sap	  = mm->b_sap_peer = -1;
+	list_add_tail(&mm->list, &mc->members);
+
+	dh->transport = &mm->transport;
+	dh->index     = 0;
+	dh->mode      = mode;
+	dh->pari      = mc->pari;
+	dh->fpc	      = mc->fpc;
+
+	if (dect_lce_init(dh) < 0)
+		goto err2;
+	dh->open_state = DECT_OPEN_READY;
+	return dh;
+
+err2:
+	dect_close_handle(dh);
+err1:
+	return NULL;
+}
+EXPORT_SYMBOL(dect_mock_open_handle);
+
+/** @} */
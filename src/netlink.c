@@ -30,6 +30,13 @@
 #include <netlink.h>
 #include <utils.h>
 #include <io.h>
+#include <timer.h>
+
+/* Timeout for the cluster query of an asynchronous open in milliseconds */
+#define DECT_NETLINK_OPEN_TIMEOUT	5000
+
+/* Size of the buffer for batched LLME requests */
+#define DECT_NETLINK_BATCH_SIZE		4096
 
 #define nl_debug_entry(fmt, args...) \
 	dect_debug(DECT_DEBUG_NL, "\nnetlink: " fmt, ## args)
@@ -70,9 +77,14 @@ static void dect_netlink_obj_rcv(struct nl_object *obj, void *arg)
 
 static int dect_netlink_msg_rcv(struct nl_msg *msg, void *arg)
 {
-	if (nl_msg_parse(msg, dect_netlink_obj_rcv, arg) < 0)
+	struct dect_netlink_handler *handler = arg;
+
+	dect_stats_inc(handler->dh, nl, rx_msgs);
+	if (nl_msg_parse(msg, dect_netlink_obj_rcv, arg) < 0) {
 		nl_debug("message parsing failed type %u\n",
 			 nlmsg_hdr(msg)->nlmsg_type);
+		dect_stats_inc(handler->dh, nl, parse_errors);
+	}
 
 	return NL_OK;
 }
@@ -80,8 +92,10 @@ static int dect_netlink_msg_rcv(struct nl_msg *msg, void *arg)
 static void dect_netlink_event(struct dect_handle *dh, struct dect_fd *fd,
 			       uint32_t event)
 {
-	if (nl_recvmsgs_default(dh->nlsock) < 0)
+	if (nl_recvmsgs_default(dh->nlsock) < 0) {
 		nl_debug("nl_recvmsgs: %s\n", strerror(errno));
+		dect_stats_inc(dh, nl, rx_errors);
+	}
 }
 
 static void dect_netlink_set_callback(struct dect_handle *dh,
@@ -153,21 +167,128 @@ static void dect_netlink_build_ari(struct nl_dect_ari *nlari, const struct dect_
 	}
 }
 
-static void dect_netlink_cluster_rcv(struct dect_handle *dh, bool request,
-				     struct nl_object *obj)
+static struct nla_policy dect_netlink_ari_policy[DECTA_ARI_MAX + 1] = {
+	[DECTA_ARI_CLASS]	= { .type = NLA_U8 },
+	[DECTA_ARI_FPN]		= { .type = NLA_U32 },
+	[DECTA_ARI_FPS]		= { .type = NLA_U32 },
+	[DECTA_ARI_EMC]		= { .type = NLA_U16 },
+	[DECTA_ARI_EIC]		= { .type = NLA_U16 },
+	[DECTA_ARI_POC]		= { .type = NLA_U16 },
+	[DECTA_ARI_GOP]		= { .type = NLA_U32 },
+	[DECTA_ARI_FIL]		= { .type = NLA_U16 },
+};
+
+static uint32_t dect_nla_get_u32(struct nlattr *nla)
 {
-	struct nl_dect_cluster *cl = nl_object_priv(obj);
+	return nla != NULL ? nla_get_u32(nla) : 0;
+}
+
+static uint16_t dect_nla_get_u16(struct nlattr *nla)
+{
+	return nla != NULL ? nla_get_u16(nla) : 0;
+}
+
+static int dect_netlink_nla_parse_ari(struct dect_ari *ari, struct nlattr *nla)
+{
+	struct nlattr *tb[DECTA_ARI_MAX + 1];
+
+	if (nla_parse_nested(tb, DECTA_ARI_MAX, nla,
+			     dect_netlink_ari_policy) < 0)
+		return -1;
+	if (tb[DECTA_ARI_CLASS] == NULL)
+		return -1;
 
-	dh->index = nl_dect_cluster_get_index(cl);
-	dh->mode  = nl_dect_cluster_get_mode(cl);
-	dect_netlink_parse_ari(&dh->pari, nl_dect_cluster_get_pari(cl));
+	memset(ari, 0, sizeof(*ari));
+	ari->arc = nla_get_u8(tb[DECTA_ARI_CLASS]);
+	ari->fpn = dect_nla_get_u32(tb[DECTA_ARI_FPN]);
+	switch (ari->arc) {
+	case DECT_ARC_A:
+		ari->emc = dect_nla_get_u16(tb[DECTA_ARI_EMC]);
+		break;
+	case DECT_ARC_B:
+		ari->eic = dect_nla_get_u16(tb[DECTA_ARI_EIC]);
+		ari->fps = dect_nla_get_u32(tb[DECTA_ARI_FPS]);
+		break;
+	case DECT_ARC_C:
+		ari->poc = dect_nla_get_u16(tb[DECTA_ARI_POC]);
+		ari->fps = dect_nla_get_u32(tb[DECTA_ARI_FPS]);
+		break;
+	case DECT_ARC_D:
+		ari->gop = dect_nla_get_u32(tb[DECTA_ARI_GOP]);
+		break;
+	case DECT_ARC_E:
+		ari->fil = dect_nla_get_u16(tb[DECTA_ARI_FIL]);
+		break;
+	}
+	return 0;
+}
+
+static int dect_netlink_nla_put_ari(struct nl_msg *msg, int attr,
+				    const struct dect_ari *ari)
+{
+	struct nlattr *nest;
+
+	nest = nla_nest_start(msg, attr);
+	if (nest == NULL)
+		goto nla_put_failure;
+
+	NLA_PUT_U8(msg, DECTA_ARI_CLASS, ari->arc);
+	NLA_PUT_U32(msg, DECTA_ARI_FPN, ari->fpn);
+	switch (ari->arc) {
+	case DECT_ARC_A:
+		NLA_PUT_U16(msg, DECTA_ARI_EMC, ari->emc);
+		break;
+	case DECT_ARC_B:
+		NLA_PUT_U16(msg, DECTA_ARI_EIC, ari->eic);
+		NLA_PUT_U32(msg, DECTA_ARI_FPS, ari->fps);
+		break;
+	case DECT_ARC_C:
+		NLA_PUT_U16(msg, DECTA_ARI_POC, ari->poc);
+		NLA_PUT_U32(msg, DECTA_ARI_FPS, ari->fps);
+		break;
+	case DECT_ARC_D:
+		NLA_PUT_U32(msg, DECTA_ARI_GOP, ari->gop);
+		break;
+	case DECT_ARC_E:
+		NLA_PUT_U16(msg, DECTA_ARI_FIL, ari->fil);
+		break;
+	}
+
+	nla_nest_end(msg, nest);
+	return 0;
+
+nla_put_failure:
+	return -NLE_MSGSIZE;
+}
+
+static void dect_netlink_cluster_update(struct dect_handle *dh,
+					const char *name, int index,
+					enum dect_cluster_modes mode,
+					const struct dect_ari *pari)
+{
+	dh->index = index;
+	dh->mode  = mode;
+	dh->pari  = *pari;
+	dect_handle_tmpl_invalidate(dh);
 
 	nl_debug("%s: mode %s ARI: class A: EMC: %.4x FPN: %.5x\n",
-		 nl_dect_cluster_get_name(cl),
-		 dh->mode == DECT_MODE_FP ? "FP" : "PP",
+		 name, dh->mode == DECT_MODE_FP ? "FP" : "PP",
 		 dh->pari.emc, dh->pari.fpn);
 }
 
+static void dect_netlink_cluster_rcv(struct dect_handle *dh, bool request,
+				     struct nl_object *obj)
+{
+	struct nl_dect_cluster *cl = nl_object_priv(obj);
+	struct dect_ari pari;
+
+	memset(&pari, 0, sizeof(pari));
+	dect_netlink_parse_ari(&pari, nl_dect_cluster_get_pari(cl));
+	dect_netlink_cluster_update(dh, nl_dect_cluster_get_name(cl),
+				    nl_dect_cluster_get_index(cl),
+				    nl_dect_cluster_get_mode(cl), &pari);
+}
+
 static int dect_netlink_get_cluster(struct dect_handle *dh, const char *name)
 {
 	struct dect_netlink_handler handler = {
@@ -212,6 +333,10 @@ static struct nl_dect_llme_msg *dect_llme_msg_init(const struct dect_handle *dh,
  * Get FP capabilities
  *
  * @param dh		libdect DECT handle
+ *
+ * On a handle opened with dect_open(), the capabilities of the FP a PP is
+ * locked to are valid once the MAC_ME_INFO response has been processed by
+ * the event handler.
  */
 const struct dect_fp_capabilities *dect_llme_fp_capabilities(const struct dect_handle *dh)
 {
@@ -240,10 +365,21 @@ static void dect_fp_capabilities_dump(const struct dect_fp_capabilities *fpc)
 			 buf2, buf2[0] && buf3[0] ? "," : "", buf3);
 }
 
+static void dect_netlink_mac_info_update(struct dect_handle *dh, bool request,
+					 const struct dect_ari *pari,
+					 const struct dect_fp_capabilities *fpc)
+{
+	dh->fpc = *fpc;
+	dect_fp_capabilities_dump(&dh->fpc);
+	if (request || dect_scan_session_rcv(dh, pari, &dh->fpc))
+		return;
+	dh->ops->llme_ops->mac_me_info_ind(dh, pari, &dh->fpc);
+}
+
 static void dect_netlink_llme_mac_info_rcv(struct dect_handle *dh, bool request,
 					   struct nl_dect_llme_msg *lmsg)
 {
-	struct dect_fp_capabilities *fpc = &dh->fpc;
+	struct dect_fp_capabilities fpc;
 	struct dect_ari *pari = NULL, _pari;
 
 	if (nl_dect_llme_mac_info_test_pari(lmsg)) {
@@ -252,16 +388,14 @@ static void dect_netlink_llme_mac_info_rcv(struct dect_handle *dh, bool request,
 		pari = &_pari;
 	}
 
-	fpc->fpc   = nl_dect_llme_mac_info_get_fpc(lmsg);
-	fpc->hlc   = nl_dect_llme_mac_info_get_hlc(lmsg);
-	fpc->efpc  = nl_dect_llme_mac_info_get_efpc(lmsg);
-	fpc->ehlc  = nl_dect_llme_mac_info_get_ehlc(lmsg);
-	fpc->efpc2 = nl_dect_llme_mac_info_get_efpc2(lmsg);
-	fpc->ehlc2 = nl_dect_llme_mac_info_get_ehlc2(lmsg);
+	fpc.fpc   = nl_dect_llme_mac_info_get_fpc(lmsg);
+	fpc.hlc   = nl_dect_llme_mac_info_get_hlc(lmsg);
+	fpc.efpc  = nl_dect_llme_mac_info_get_efpc(lmsg);
+	fpc.ehlc  = nl_dect_llme_mac_info_get_ehlc(lmsg);
+	fpc.efpc2 = nl_dect_llme_mac_info_get_efpc2(lmsg);
+	fpc.ehlc2 = nl_dect_llme_mac_info_get_ehlc2(lmsg);
 
-	dect_fp_capabilities_dump(fpc);
-	if (!request)
-		dh->ops->llme_ops->mac_me_info_ind(dh, pari, fpc);
+	dect_netlink_mac_info_update(dh, request, pari, &fpc);
 }
 
 static void dect_netlink_llme_rcv(struct dect_handle *dh, bool request,
@@ -284,6 +418,226 @@ static void dect_netlink_llme_rcv(struct dect_handle *dh, bool request,
 	}
 }
 
+/*
+ * Batched LLME requests
+ */
+
+/**
+ * struct dect_llme_batch - batched LLME requests
+ *
+ * @len:	length of the queued messages
+ * @pari_valid:	the queued requests change the PARI
+ * @pari:	PARI after the queued requests have been executed
+ * @buf:	queued netlink messages
+ */
+struct dect_llme_batch {
+	unsigned int		len;
+	bool			pari_valid;
+	struct dect_ari		pari;
+	uint8_t			buf[DECT_NETLINK_BATCH_SIZE];
+};
+
+static struct nl_msg *dect_netlink_llme_msg_alloc(const struct dect_handle *dh,
+						  enum dect_llme_msg_types type,
+						  enum dect_llme_ops op)
+{
+	struct dectmsg dm;
+	struct nl_msg *msg;
+
+	msg = nlmsg_alloc_simple(DECT_LLME_MSG, NLM_F_REQUEST);
+	if (msg == NULL)
+		return NULL;
+
+	memset(&dm, 0, sizeof(dm));
+	dm.dm_index = dh->index;
+	if (nlmsg_append(msg, &dm, sizeof(dm), NLMSG_ALIGNTO) < 0)
+		goto nla_put_failure;
+	NLA_PUT_U8(msg, DECTA_LLME_OP, op);
+	NLA_PUT_U8(msg, DECTA_LLME_TYPE, type);
+	return msg;
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return NULL;
+}
+
+static int dect_netlink_batch_flush(struct dect_handle *dh)
+{
+	struct dect_llme_batch *batch = dh->llme_batch;
+	int err;
+
+	if (batch->len == 0)
+		return 0;
+
+	nl_debug("sending %u bytes of batched LLME requests\n", batch->len);
+	err = nl_sendto(dh->nlsock, batch->buf, batch->len);
+	batch->len = 0;
+	if (err < 0) {
+		dect_stats_inc(dh, nl, tx_errors);
+		return err;
+	}
+
+	if (batch->pari_valid) {
+		dh->pari = batch->pari;
+		dect_handle_tmpl_invalidate(dh);
+		batch->pari_valid = false;
+	}
+	return 0;
+}
+
+/* Append a message to the batch, it is sent once the batch is committed */
+static int dect_netlink_batch_queue(struct dect_handle *dh, struct nl_msg *msg)
+{
+	struct dect_llme_batch *batch = dh->llme_batch;
+	struct nlmsghdr *nlh;
+	unsigned int len;
+	int err = 0;
+
+	nl_complete_msg(dh->nlsock, msg);
+	nlh = nlmsg_hdr(msg);
+	len = NLMSG_ALIGN(nlh->nlmsg_len);
+	if (len > sizeof(batch->buf)) {
+		err = -NLE_MSGSIZE;
+		goto out;
+	}
+
+	if (batch->len + len > sizeof(batch->buf)) {
+		err = dect_netlink_batch_flush(dh);
+		if (err < 0)
+			goto out;
+	}
+
+	memcpy(batch->buf + batch->len, nlh, nlh->nlmsg_len);
+	memset(batch->buf + batch->len + nlh->nlmsg_len, 0,
+	       len - nlh->nlmsg_len);
+	batch->len += len;
+out:
+	nlmsg_free(msg);
+	return err;
+}
+
+static int dect_netlink_batch_rfp_preload_req(struct dect_handle *dh,
+					      const struct dect_fp_capabilities *fpc)
+{
+	struct nlattr *nest;
+	struct nl_msg *msg;
+
+	msg = dect_netlink_llme_msg_alloc(dh, DECT_LLME_MAC_RFP_PRELOAD,
+					  DECT_LLME_REQUEST);
+	if (msg == NULL)
+		return -NLE_NOMEM;
+
+	nest = nla_nest_start(msg, DECTA_LLME_MAC_INFO);
+	if (nest == NULL)
+		goto nla_put_failure;
+	NLA_PUT_U16(msg, DECTA_MAC_INFO_HLC, fpc->hlc);
+	NLA_PUT_U32(msg, DECTA_MAC_INFO_EHLC, fpc->ehlc);
+	NLA_PUT_U32(msg, DECTA_MAC_INFO_EHLC2, fpc->ehlc2);
+	nla_nest_end(msg, nest);
+
+	return dect_netlink_batch_queue(dh, msg);
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return -NLE_MSGSIZE;
+}
+
+static int dect_netlink_batch_mac_me_info_res(struct dect_handle *dh,
+					      const struct dect_ari *pari)
+{
+	struct nlattr *nest;
+	struct nl_msg *msg;
+	int err;
+
+	msg = dect_netlink_llme_msg_alloc(dh, DECT_LLME_MAC_INFO,
+					  DECT_LLME_RESPONSE);
+	if (msg == NULL)
+		return -NLE_NOMEM;
+
+	nest = nla_nest_start(msg, DECTA_LLME_MAC_INFO);
+	if (nest == NULL)
+		goto nla_put_failure;
+	if (dect_netlink_nla_put_ari(msg, DECTA_MAC_INFO_PARI, pari) < 0)
+		goto nla_put_failure;
+	nla_nest_end(msg, nest);
+
+	err = dect_netlink_batch_queue(dh, msg);
+	if (err == 0) {
+		dh->llme_batch->pari	   = *pari;
+		dh->llme_batch->pari_valid = true;
+	}
+	return err;
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return -NLE_MSGSIZE;
+}
+
+static int dect_netlink_batch_scan_req(struct dect_handle *dh)
+{
+	struct nl_msg *msg;
+	int err;
+
+	msg = dect_netlink_llme_msg_alloc(dh, DECT_LLME_SCAN, DECT_LLME_REQUEST);
+	if (msg == NULL)
+		return -NLE_NOMEM;
+
+	err = dect_netlink_batch_queue(dh, msg);
+	if (err == 0) {
+		memset(&dh->llme_batch->pari, 0, sizeof(dh->llme_batch->pari));
+		dh->llme_batch->pari_valid = true;
+	}
+	return err;
+}
+
+/**
+ * Begin a batch of LLME requests
+ *
+ * @param dh		libdect DECT handle
+ *
+ * Until the batch is committed using dect_llme_batch_commit(), the
+ * MAC_ME_RFP_PRELOAD-req, MAC_ME_INFO-res and SCAN-req primitives don't
+ * communicate with the kernel, but queue their requests to be sent together
+ * in a single netlink transmission. Errors reported by the kernel for batched
+ * requests as well as MAC_ME_INFO messages sent in response are processed
+ * asynchronously by the event handler.
+ */
+int dect_llme_batch_begin(struct dect_handle *dh)
+{
+	if (dh->llme_batch != NULL)
+		return 0;
+
+	dh->llme_batch = dect_malloc(dh, sizeof(*dh->llme_batch));
+	if (dh->llme_batch == NULL)
+		return -NLE_NOMEM;
+	dh->llme_batch->len	   = 0;
+	dh->llme_batch->pari_valid = false;
+	return 0;
+}
+EXPORT_SYMBOL(dect_llme_batch_begin);
+
+/**
+ * Send a batch of LLME requests
+ *
+ * @param dh		libdect DECT handle
+ *
+ * Send all requests queued since dect_llme_batch_begin() and leave batch
+ * mode. The batch is released even when sending fails.
+ */
+int dect_llme_batch_commit(struct dect_handle *dh)
+{
+	int err;
+
+	if (dh->llme_batch == NULL)
+		return 0;
+
+	err = dect_netlink_batch_flush(dh);
+	dect_free(dh, dh->llme_batch);
+	dh->llme_batch = NULL;
+	return err;
+}
+EXPORT_SYMBOL(dect_llme_batch_commit);
+
 /**
  * MAC_ME_RFP_PRELOAD-req primitive
  *
@@ -308,6 +662,10 @@ int dect_llme_rfp_preload_req(struct dect_handle *dh,
 
 	nl_debug_entry("MAC_ME_RFP_PRELOAD-req\n");
 	dect_fp_capabilities_dump(fpc);
+	if (dh->transport->ops->llme_rfp_preload_req != NULL)
+		return dh->transport->ops->llme_rfp_preload_req(dh, fpc);
+	if (dh->llme_batch != NULL)
+		return dect_netlink_batch_rfp_preload_req(dh, fpc);
 
 	lmsg = dect_llme_msg_init(dh, DECT_LLME_MAC_RFP_PRELOAD, DECT_LLME_REQUEST);
 	if (lmsg == NULL)
@@ -343,6 +701,11 @@ int dect_llme_mac_me_info_res(struct dect_handle *dh, const struct dect_ari *par
 	int err;
 
 	nl_debug_entry("MAC_ME_INFO-res\n");
+	if (dh->transport->ops->llme_mac_me_info_res != NULL)
+		return dh->transport->ops->llme_mac_me_info_res(dh, pari);
+	if (dh->llme_batch != NULL)
+		return dect_netlink_batch_mac_me_info_res(dh, pari);
+
 	lmsg = dect_llme_msg_init(dh, DECT_LLME_MAC_INFO, DECT_LLME_RESPONSE);
 	if (lmsg == NULL)
 		return -1;
@@ -353,35 +716,50 @@ int dect_llme_mac_me_info_res(struct dect_handle *dh, const struct dect_ari *par
 
 	err = nl_dect_llme_respond(dh->nlsock, lmsg);
 	nl_dect_llme_msg_put(lmsg);
-	if (err == 0)
+	if (err == 0) {
 		dh->pari = *pari;
+		dect_handle_tmpl_invalidate(dh);
+	}
 	return err;
 }
 EXPORT_SYMBOL(dect_llme_mac_me_info_res);
 
+/*
+ * Request the FP capabilities without waiting for the kernel, the response is
+ * processed by the event handler like the cluster query response.
+ */
 static int dect_netlink_mac_me_info_req(struct dect_handle *dh)
 {
-	struct dect_netlink_handler handler = {
-		.dh		= dh,
-		.rcv		= dect_netlink_llme_rcv,
-		.request	= true,
-	};
-	struct nl_dect_llme_msg *lmsg;
-	struct nl_dect_ari *pari;
+	struct nlattr *nest, *pari;
+	struct nl_msg *msg;
 	int err;
 
 	nl_debug_entry("MAC_ME_INFO-req\n");
-	lmsg = dect_llme_msg_init(dh, DECT_LLME_MAC_INFO, DECT_LLME_REQUEST);
-	if (lmsg == NULL)
-		return -1;
+	msg = dect_netlink_llme_msg_alloc(dh, DECT_LLME_MAC_INFO,
+					  DECT_LLME_REQUEST);
+	if (msg == NULL)
+		return -NLE_NOMEM;
+
+	nest = nla_nest_start(msg, DECTA_LLME_MAC_INFO);
+	if (nest == NULL)
+		goto nla_put_failure;
+	pari = nla_nest_start(msg, DECTA_MAC_INFO_PARI);
+	if (pari == NULL)
+		goto nla_put_failure;
+	nla_nest_end(msg, pari);
+	nla_nest_end(msg, nest);
+
+	err = nl_send_auto_complete(dh->nlsock, msg);
+	nlmsg_free(msg);
+	if (err < 0) {
+		dect_stats_inc(dh, nl, tx_errors);
+		return err;
+	}
+	return 0;
 
-	dect_netlink_set_callback(dh, dect_netlink_msg_rcv, &handler);
-	pari = (void *)nl_dect_llme_mac_info_get_pari(lmsg);
-	nl_dect_llme_mac_info_set_pari(lmsg, pari);
-	err = nl_dect_llme_request(dh->nlsock, lmsg);
-	dect_netlink_set_callback(dh, dect_netlink_event_rcv, dh);
-	nl_dect_llme_msg_put(lmsg);
-	return err;
+nla_put_failure:
+	nlmsg_free(msg);
+	return -NLE_MSGSIZE;
 }
 
 int dect_llme_scan_req(struct dect_handle *dh)
@@ -390,18 +768,247 @@ int dect_llme_scan_req(struct dect_handle *dh)
 	int err;
 
 	nl_debug_entry("SCAN-req\n");
+	if (dh->transport->ops->llme_scan_req != NULL)
+		return dh->transport->ops->llme_scan_req(dh);
+	if (dh->llme_batch != NULL)
+		return dect_netlink_batch_scan_req(dh);
+
 	lmsg = dect_llme_msg_init(dh, DECT_LLME_SCAN, DECT_LLME_REQUEST);
 	if (lmsg == NULL)
 		return -1;
 
 	err = nl_dect_llme_request(dh->nlsock, lmsg);
 	nl_dect_llme_msg_put(lmsg);
-	if (err == 0)
+	if (err == 0) {
 		memset(&dh->pari, 0, sizeof(dh->pari));
+		dect_handle_tmpl_invalidate(dh);
+	}
 	return err;
 }
 EXPORT_SYMBOL(dect_llme_scan_req);
 
+/*
+ * Asynchronous open
+ */
+
+static void dect_netlink_open_done(struct dect_handle *dh,
+				   enum dect_open_states state)
+{
+	nl_socket_modify_err_cb(dh->nlsock, NL_CB_DEFAULT, NULL, NULL);
+	dh->open_state = state;
+	dect_timer_start_ms(dh, dh->open_timer, 0);
+}
+
+static int dect_netlink_reply_rcv(struct dect_handle *dh, struct nl_msg *msg)
+{
+	struct dect_netlink_handler handler = {
+		.dh	= dh,
+		.rcv	= dect_netlink_cluster_rcv,
+		.request = true,
+	};
+
+	/* MAC_ME_INFO responses to MAC_ME_INFO-req and batched requests */
+	if (nlmsg_hdr(msg)->nlmsg_type == DECT_LLME_MSG) {
+		handler.rcv = dect_netlink_llme_rcv;
+		dect_netlink_msg_rcv(msg, &handler);
+		if (dh->open_state == DECT_OPEN_INFO)
+			dect_netlink_open_done(dh, DECT_OPEN_READY);
+		return NL_OK;
+	}
+
+	if (nlmsg_hdr(msg)->nlmsg_type != DECT_NEW_CLUSTER)
+		return NL_OK;
+
+	/* Responses to the refresh query of a seeded handle update the cached
+	 * information like cluster events */
+	dect_netlink_msg_rcv(msg, &handler);
+	if (dh->open_state == DECT_OPEN_QUERY)
+		dect_netlink_open_done(dh, DECT_OPEN_DONE);
+	return NL_OK;
+}
+
+static int dect_netlink_error_rcv(struct sockaddr_nl *nla,
+				  struct nlmsgerr *nlerr, void *arg)
+{
+	struct dect_handle *dh = arg;
+
+	nl_debug("%s failed: %s\n",
+		 dh->open_state == DECT_OPEN_INFO ? "MAC_ME_INFO-req" :
+		 "cluster query", strerror(-nlerr->error));
+	if (dh->open_state == DECT_OPEN_QUERY ||
+	    dh->open_state == DECT_OPEN_INFO) {
+		dh->open_err = -nlerr->error;
+		dect_netlink_open_done(dh, DECT_OPEN_FAILED);
+	}
+	return NL_STOP;
+}
+
+static void dect_netlink_open_timer(struct dect_handle *dh,
+				    struct dect_timer *timer)
+{
+	int err = 0;
+
+	switch (dh->open_state) {
+	case DECT_OPEN_QUERY:
+		nl_socket_modify_err_cb(dh->nlsock, NL_CB_DEFAULT, NULL, NULL);
+		nl_debug("cluster query timed out\n");
+		errno = ETIMEDOUT;
+		err = -1;
+		break;
+	case DECT_OPEN_INFO:
+		nl_socket_modify_err_cb(dh->nlsock, NL_CB_DEFAULT, NULL, NULL);
+		nl_debug("MAC_ME_INFO-req timed out\n");
+		errno = ETIMEDOUT;
+		err = -1;
+		break;
+	case DECT_OPEN_FAILED:
+		errno = dh->open_err;
+		err = -1;
+		break;
+	case DECT_OPEN_SEEDED:
+		/* The cached capabilities are refreshed by the response */
+		if (dh->mode == DECT_MODE_PP &&
+		    dect_netlink_mac_me_info_req(dh) < 0)
+			err = -1;
+		break;
+	case DECT_OPEN_DONE:
+		if (dh->mode != DECT_MODE_PP)
+			break;
+		nl_socket_modify_err_cb(dh->nlsock, NL_CB_CUSTOM,
+					dect_netlink_error_rcv, dh);
+		dh->open_state = DECT_OPEN_INFO;
+		if (dect_netlink_mac_me_info_req(dh) < 0) {
+			nl_socket_modify_err_cb(dh->nlsock, NL_CB_DEFAULT,
+						NULL, NULL);
+			err = -1;
+			break;
+		}
+		dect_timer_start_ms(dh, dh->open_timer,
+				    DECT_NETLINK_OPEN_TIMEOUT);
+		return;
+	default:
+		break;
+	}
+
+	dect_open_complete(dh, err);
+}
+
+static int dect_netlink_query_cluster(struct dect_handle *dh, const char *name)
+{
+	struct dectmsg dm;
+	struct nl_msg *msg;
+	int err;
+
+	msg = nlmsg_alloc_simple(DECT_GET_CLUSTER, NLM_F_REQUEST);
+	if (msg == NULL)
+		return -NLE_NOMEM;
+
+	memset(&dm, 0, sizeof(dm));
+	if (nlmsg_append(msg, &dm, sizeof(dm), NLMSG_ALIGNTO) < 0)
+		goto nla_put_failure;
+	NLA_PUT_STRING(msg, DECTA_CLUSTER_NAME, name);
+
+	err = nl_send_auto_complete(dh->nlsock, msg);
+	nlmsg_free(msg);
+	return err < 0 ? err : 0;
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return -NLE_MSGSIZE;
+}
+
+/*
+ * Event fast path: cluster and MAC_ME_INFO-ind events are parsed directly from
+ * the netlink attributes instead of allocating a libnl object for each event.
+ * Anything else is left to the generic libnl message parser.
+ */
+
+static struct nla_policy dect_netlink_cluster_policy[DECTA_CLUSTER_MAX + 1] = {
+	[DECTA_CLUSTER_NAME]	= { .type = NLA_STRING },
+	[DECTA_CLUSTER_MODE]	= { .type = NLA_U8 },
+	[DECTA_CLUSTER_PARI]	= { .type = NLA_NESTED },
+};
+
+static struct nla_policy dect_netlink_llme_policy[DECTA_LLME_MAX + 1] = {
+	[DECTA_LLME_OP]		= { .type = NLA_U8 },
+	[DECTA_LLME_TYPE]	= { .type = NLA_U8 },
+	[DECTA_LLME_MAC_INFO]	= { .type = NLA_NESTED },
+};
+
+static struct nla_policy dect_netlink_mac_info_policy[DECTA_MAC_INFO_MAX + 1] = {
+	[DECTA_MAC_INFO_PARI]	= { .type = NLA_NESTED },
+	[DECTA_MAC_INFO_FPC]	= { .type = NLA_U32 },
+	[DECTA_MAC_INFO_HLC]	= { .type = NLA_U16 },
+	[DECTA_MAC_INFO_EFPC]	= { .type = NLA_U16 },
+	[DECTA_MAC_INFO_EHLC]	= { .type = NLA_U32 },
+	[DECTA_MAC_INFO_EFPC2]	= { .type = NLA_U16 },
+	[DECTA_MAC_INFO_EHLC2]	= { .type = NLA_U32 },
+};
+
+static int dect_netlink_cluster_fast_rcv(struct dect_handle *dh,
+					 struct nlmsghdr *nlh)
+{
+	struct dectmsg *dm = nlmsg_data(nlh);
+	struct nlattr *tb[DECTA_CLUSTER_MAX + 1];
+	struct dect_ari pari;
+
+	if (nlh->nlmsg_type != DECT_NEW_CLUSTER)
+		return -1;
+	if (nlmsg_parse(nlh, sizeof(*dm), tb, DECTA_CLUSTER_MAX,
+			dect_netlink_cluster_policy) < 0)
+		return -1;
+	if (tb[DECTA_CLUSTER_NAME] == NULL || tb[DECTA_CLUSTER_MODE] == NULL ||
+	    tb[DECTA_CLUSTER_PARI] == NULL)
+		return -1;
+	if (dect_netlink_nla_parse_ari(&pari, tb[DECTA_CLUSTER_PARI]) < 0)
+		return -1;
+
+	dect_netlink_cluster_update(dh, nla_get_string(tb[DECTA_CLUSTER_NAME]),
+				    dm->dm_index,
+				    nla_get_u8(tb[DECTA_CLUSTER_MODE]), &pari);
+	return 0;
+}
+
+static int dect_netlink_llme_fast_rcv(struct dect_handle *dh,
+				      struct nlmsghdr *nlh)
+{
+	struct nlattr *tb[DECTA_LLME_MAX + 1];
+	struct nlattr *mi[DECTA_MAC_INFO_MAX + 1];
+	struct dect_fp_capabilities fpc;
+	struct dect_ari *pari = NULL, _pari;
+
+	if (nlh->nlmsg_type != DECT_LLME_MSG)
+		return -1;
+	if (nlmsg_parse(nlh, sizeof(struct dectmsg), tb, DECTA_LLME_MAX,
+			dect_netlink_llme_policy) < 0)
+		return -1;
+	if (tb[DECTA_LLME_OP] == NULL || tb[DECTA_LLME_TYPE] == NULL ||
+	    tb[DECTA_LLME_MAC_INFO] == NULL)
+		return -1;
+	if (nla_get_u8(tb[DECTA_LLME_TYPE]) != DECT_LLME_MAC_INFO ||
+	    nla_get_u8(tb[DECTA_LLME_OP]) != DECT_LLME_INDICATE)
+		return -1;
+
+	if (nla_parse_nested(mi, DECTA_MAC_INFO_MAX, tb[DECTA_LLME_MAC_INFO],
+			     dect_netlink_mac_info_policy) < 0)
+		return -1;
+	if (mi[DECTA_MAC_INFO_PARI] != NULL) {
+		if (dect_netlink_nla_parse_ari(&_pari, mi[DECTA_MAC_INFO_PARI]) < 0)
+			return -1;
+		pari = &_pari;
+	}
+
+	fpc.fpc   = dect_nla_get_u32(mi[DECTA_MAC_INFO_FPC]);
+	fpc.hlc   = dect_nla_get_u16(mi[DECTA_MAC_INFO_HLC]);
+	fpc.efpc  = dect_nla_get_u16(mi[DECTA_MAC_INFO_EFPC]);
+	fpc.ehlc  = dect_nla_get_u32(mi[DECTA_MAC_INFO_EHLC]);
+	fpc.efpc2 = dect_nla_get_u16(mi[DECTA_MAC_INFO_EFPC2]);
+	fpc.ehlc2 = dect_nla_get_u32(mi[DECTA_MAC_INFO_EHLC2]);
+
+	dect_netlink_mac_info_update(dh, false, pari, &fpc);
+	return 0;
+}
+
 static int dect_netlink_event_rcv(struct nl_msg *msg, void *arg)
 {
 	struct sockaddr_nl *addr = nlmsg_get_src(msg);
@@ -410,15 +1017,23 @@ static int dect_netlink_event_rcv(struct nl_msg *msg, void *arg)
 	struct dect_netlink_handler handler = { .dh = dh };
 	unsigned int group = ffs(addr->nl_groups);
 
+	/* Response to an asynchronous cluster query */
+	if (group == 0)
+		return dect_netlink_reply_rcv(dh, msg);
+
 	if (dm->dm_index != dh->index)
 		return NL_OK;
 
 	nl_debug_entry("message group: %u\n", group);
 	switch (group) {
 	case DECTNLGRP_CLUSTER:
+		if (dect_netlink_cluster_fast_rcv(dh, nlmsg_hdr(msg)) == 0)
+			return NL_OK;
 		handler.rcv = dect_netlink_cluster_rcv;
 		break;
 	case DECTNLGRP_LLME:
+		if (dect_netlink_llme_fast_rcv(dh, nlmsg_hdr(msg)) == 0)
+			return NL_OK;
 		handler.rcv = dect_netlink_llme_rcv;
 		break;
 	default:
@@ -429,7 +1044,7 @@ static int dect_netlink_event_rcv(struct nl_msg *msg, void *arg)
 	return dect_netlink_msg_rcv(msg, &handler);
 }
 
-int dect_netlink_init(struct dect_handle *dh, const char *cluster)
+static int dect_netlink_socket_init(struct dect_handle *dh)
 {
 	int err = 0;
 
@@ -449,46 +1064,131 @@ int dect_netlink_init(struct dect_handle *dh, const char *cluster)
 	if (dh->nlfd == NULL)
 		goto err2;
 	dh->nlfd->fd = nl_socket_get_fd(dh->nlsock);
+	dh->nlfd->prio = DECT_FD_PRIO_NETLINK;
 
 	dect_fd_setup(dh->nlfd, dect_netlink_event, NULL);
 	if (dect_fd_register(dh, dh->nlfd, DECT_FD_READ))
 		goto err3;
+	return 0;
+
+err3:
+	dect_free(dh, dh->nlfd);
+err2:
+	nl_close(dh->nlsock);
+	nl_socket_free(dh->nlsock);
+err1:
+	dect_debug(DECT_DEBUG_NL, "dect_netlink_init: %s\n",
+		   err == 0 ? strerror(errno) : nl_geterror(err));
+	return -1;
+}
+
+static void dect_netlink_socket_exit(struct dect_handle *dh)
+{
+	dect_fd_unregister(dh, dh->nlfd);
+	nl_close(dh->nlsock);
+	nl_socket_free(dh->nlsock);
+	dect_free(dh, dh->nlfd);
+}
+
+static void dect_netlink_subscribe(struct dect_handle *dh)
+{
+	dect_netlink_set_callback(dh, dect_netlink_event_rcv, dh);
+	nl_socket_disable_seq_check(dh->nlsock);
+	nl_socket_add_membership(dh->nlsock, DECTNLGRP_CLUSTER);
+	nl_socket_add_membership(dh->nlsock, DECTNLGRP_LLME);
+}
+
+int dect_netlink_init(struct dect_handle *dh, const char *cluster)
+{
+	int err;
+
+	if (dect_netlink_socket_init(dh) < 0)
+		goto err1;
 
 	err = dect_netlink_get_cluster(dh, cluster);
 	if (err < 0)
-		goto err4;
+		goto err2;
 
+	dect_netlink_subscribe(dh);
 	if (dh->mode == DECT_MODE_PP) {
 		err = dect_netlink_mac_me_info_req(dh);
 		if (err < 0)
-			goto err4;
+			goto err2;
 	}
+	return 0;
 
-	dect_netlink_set_callback(dh, dect_netlink_event_rcv, dh);
-	nl_socket_disable_seq_check(dh->nlsock);
-	nl_socket_add_membership(dh->nlsock, DECTNLGRP_CLUSTER);
-	nl_socket_add_membership(dh->nlsock, DECTNLGRP_LLME);
+err2:
+	dect_netlink_socket_exit(dh);
+	dect_debug(DECT_DEBUG_NL, "dect_netlink_init: %s\n", nl_geterror(err));
+err1:
+	return -1;
+}
+
+/*
+ * Initialize the netlink interface without waiting for the kernel. The
+ * cluster query response is processed by the event handler. When seeded
+ * from cached cluster information, the query only refreshes the cached
+ * information and initialization completes right away. Completion is
+ * reported through dect_open_complete() from timer context.
+ */
+int dect_netlink_init_async(struct dect_handle *dh, const char *cluster,
+			    const struct dect_cluster_info *info)
+{
+	int err;
+
+	dh->open_timer = dect_timer_alloc(dh);
+	if (dh->open_timer == NULL)
+		goto err1;
+	dect_timer_setup(dh->open_timer, dect_netlink_open_timer, NULL);
+
+	if (dect_netlink_socket_init(dh) < 0)
+		goto err2;
+	dect_netlink_subscribe(dh);
+
+	if (info != NULL) {
+		dh->index = info->index;
+		dh->mode  = info->mode;
+		dh->pari  = info->pari;
+		dh->fpc   = info->fpc;
+		dect_handle_tmpl_invalidate(dh);
+		dh->open_state = DECT_OPEN_SEEDED;
+	} else {
+		nl_socket_modify_err_cb(dh->nlsock, NL_CB_CUSTOM,
+					dect_netlink_error_rcv, dh);
+		dh->open_state = DECT_OPEN_QUERY;
+	}
+
+	err = dect_netlink_query_cluster(dh, cluster);
+	if (err < 0)
+		goto err3;
+
+	dect_timer_start_ms(dh, dh->open_timer, info != NULL ? 0 :
+			    DECT_NETLINK_OPEN_TIMEOUT);
 	return 0;
 
-err4:
-	dect_fd_unregister(dh, dh->nlfd);
 err3:
-	dect_free(dh, dh->nlfd);
+	dect_debug(DECT_DEBUG_NL, "dect_netlink_init: %s\n", nl_geterror(err));
+	dect_netlink_socket_exit(dh);
 err2:
-	nl_close(dh->nlsock);
-	nl_socket_free(dh->nlsock);
+	dect_timer_free(dh, dh->open_timer);
+	dh->open_timer = NULL;
 err1:
-	dect_debug(DECT_DEBUG_NL, "dect_netlink_init: %s\n",
-		   err == 0 ? strerror(errno) : nl_geterror(err));
 	return -1;
 }
 
 void dect_netlink_exit(struct dect_handle *dh)
 {
-	dect_fd_unregister(dh, dh->nlfd);
-	nl_close(dh->nlsock);
-	nl_socket_free(dh->nlsock);
-	dect_free(dh, dh->nlfd);
+	if (dh->llme_batch != NULL)
+		dect_free(dh, dh->llme_batch);
+	if (dh->scan_session != NULL)
+		dect_scan_session_stop(dh, dh->scan_session);
+	if (dh->open_timer != NULL) {
+		if (dect_timer_running(dh->open_timer))
+			dect_timer_stop(dh, dh->open_timer);
+		dect_timer_free(dh, dh->open_timer);
+	}
+	if (dh->nlsock != NULL)
+		dect_netlink_socket_exit(dh);
 }
 
 /** @} */
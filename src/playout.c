@@ -0,0 +1,344 @@
+/*
+ * libdect U-plane playout
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @defgroup playout U-Plane playout
+ * @{
+ *
+ * Adaptive jitter buffer and playout of G.721 U-Plane audio.
+ *
+ * A playout instance accepts the U-Plane data received through the
+ * dl_u_data_ind or dl_u_data_view_ind callbacks using dect_playout_put()
+ * and delivers decoded linear PCM blocks of #DECT_PLAYOUT_BLOCK_SAMPLES
+ * samples, either when pulled by the application's audio device using
+ * dect_playout_get() or paced by a libdect timer started with
+ * dect_playout_start().
+ *
+ * The target delay is derived from the estimated arrival jitter and kept
+ * within the bounds specified on allocation. Playout starts once the jitter
+ * buffer has been filled up to the target delay. On underrun, the missing
+ * samples are concealed by repeating the previous block with decreasing
+ * gain and the buffer is refilled. When the buffer grows beyond the target
+ * delay, data is decoded and dropped to reduce the delay again.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <libdect.h>
+#include <dect/playout.h>
+#include <utils.h>
+#include <timer.h>
+#include "ccitt-adpcm/g72x.h"
+
+/* G.721 data rate: 32kbit/s, or four bytes per millisecond */
+#define DECT_PLAYOUT_BYTES_PER_MS	4
+#define DECT_PLAYOUT_BLOCK_SIZE		(DECT_PLAYOUT_BLOCK_SAMPLES / 2)
+#define DECT_PLAYOUT_BLOCK_TIME		(DECT_PLAYOUT_BLOCK_SIZE / \
+					 DECT_PLAYOUT_BYTES_PER_MS)
+
+/* Jitter buffer size: 400ms */
+#define DECT_PLAYOUT_BUF_SIZE		1600
+
+/* Number of consecutive concealed blocks before playing silence */
+#define DECT_PLAYOUT_CONCEAL_MAX	4
+
+/**
+ * struct dect_playout - U-Plane playout instance
+ *
+ * @codec:	G.721 decoder state
+ * @head:	offset of the first byte in the jitter buffer
+ * @len:	number of bytes in the jitter buffer
+ * @prefill:	playout is waiting for the buffer to fill up to the target
+ * @min:	minimum target delay in bytes
+ * @max:	maximum target delay in bytes
+ * @target:	target delay in bytes
+ * @jitter:	arrival jitter estimate in 1/16 milliseconds
+ * @arrival:	arrival time of the previous data in milliseconds
+ * @last_len:	length of the previous data
+ * @conceal:	number of consecutive concealed blocks
+ * @timer:	playout pacing timer
+ * @deadline:	time of the next paced block in milliseconds
+ * @cb:		paced playout callback
+ * @priv:	paced playout callback data
+ * @stats:	playout statistics
+ * @last:	previous block, used for concealment
+ * @buf:	jitter buffer
+ */
+struct dect_playout {
+	struct g72x_state		codec;
+	unsigned int			head;
+	unsigned int			len;
+	bool				prefill;
+	unsigned int			min;
+	unsigned int			max;
+	unsigned int			target;
+	unsigned int			jitter;
+	uint64_t			arrival;
+	unsigned int			last_len;
+	unsigned int			conceal;
+	struct dect_timer		*timer;
+	uint64_t			deadline;
+	void				(*cb)(struct dect_handle *, void *,
+					      const int16_t *);
+	void				*priv;
+	struct dect_playout_stats	stats;
+	int16_t				last[DECT_PLAYOUT_BLOCK_SAMPLES];
+	uint8_t				buf[DECT_PLAYOUT_BUF_SIZE];
+};
+
+static void dect_playout_update_target(struct dect_playout *po)
+{
+	unsigned int target;
+
+	/* One block plus three times the jitter estimate */
+	target = DECT_PLAYOUT_BLOCK_SIZE +
+		 3 * po->jitter * DECT_PLAYOUT_BYTES_PER_MS / 16;
+	po->target = min(max(target, po->min), po->max);
+}
+
+/* Decode @len bytes from the jitter buffer, @pcm may be NULL to discard them */
+static void dect_playout_decode(struct dect_playout *po, int16_t *pcm,
+				unsigned int len)
+{
+	int16_t discard[DECT_PLAYOUT_BLOCK_SAMPLES];
+	unsigned int n;
+
+	po->len -= len;
+	while (len > 0) {
+		n = min(len, DECT_PLAYOUT_BUF_SIZE - po->head);
+		n = min(n, (unsigned int)DECT_PLAYOUT_BLOCK_SIZE);
+
+		g721_decode_block(po->buf + po->head, pcm ? pcm : discard,
+				  2 * n, &po->codec);
+		po->head = (po->head + n) % DECT_PLAYOUT_BUF_SIZE;
+		if (pcm != NULL)
+			pcm += 2 * n;
+		len -= n;
+	}
+}
+
+static void dect_playout_conceal(struct dect_playout *po, int16_t *pcm,
+				 unsigned int offset)
+{
+	unsigned int i, shift = po->conceal + 1;
+
+	for (i = offset; i < DECT_PLAYOUT_BLOCK_SAMPLES; i++) {
+		if (po->conceal < DECT_PLAYOUT_CONCEAL_MAX)
+			pcm[i] = po->last[i] >> shift;
+		else
+			pcm[i] = 0;
+	}
+	po->conceal++;
+	po->stats.concealed++;
+}
+
+/**
+ * Allocate a playout instance
+ *
+ * @param dh		libdect DECT handle
+ * @param min_delay	minimum target delay in milliseconds
+ * @param max_delay	maximum target delay in milliseconds
+ */
+struct dect_playout *dect_playout_alloc(const struct dect_handle *dh,
+					unsigned int min_delay,
+					unsigned int max_delay)
+{
+	struct dect_playout *po;
+
+	po = dect_zalloc(dh, sizeof(*po));
+	if (po == NULL)
+		return NULL;
+
+	g72x_init_state(&po->codec);
+	po->min = max(min_delay * DECT_PLAYOUT_BYTES_PER_MS,
+		      (unsigned int)DECT_PLAYOUT_BLOCK_SIZE);
+	po->max = min(max_delay * DECT_PLAYOUT_BYTES_PER_MS,
+		      (unsigned int)DECT_PLAYOUT_BUF_SIZE);
+	po->max = max(po->max, po->min);
+	po->prefill = true;
+	dect_playout_update_target(po);
+	return po;
+}
+EXPORT_SYMBOL(dect_playout_alloc);
+
+/**
+ * Release a playout instance
+ *
+ * @param dh		libdect DECT handle
+ * @param po		playout instance
+ */
+void dect_playout_free(const struct dect_handle *dh, struct dect_playout *po)
+{
+	dect_playout_stop(dh, po);
+	dect_timer_free(dh, po->timer);
+	dect_free(dh, po);
+}
+EXPORT_SYMBOL(dect_playout_free);
+
+/**
+ * Add received U-Plane data to the jitter buffer
+ *
+ * @param po		playout instance
+ * @param mb		libdect message buffer containing G.721 data
+ *
+ * The data is copied, the message buffer remains owned by the caller.
+ */
+void dect_playout_put(struct dect_playout *po, const struct dect_msg_buf *mb)
+{
+	unsigned int len = mb->len, tail, n;
+	uint64_t now = dect_timer_now();
+	int64_t delta;
+
+	/* Interarrival jitter, similar to RFC 3550 */
+	if (po->arrival != 0) {
+		delta = (int64_t)(now - po->arrival) * 16 -
+			po->last_len * 16 / DECT_PLAYOUT_BYTES_PER_MS;
+		if (delta < 0)
+			delta = -delta;
+		po->jitter += (delta - (int64_t)po->jitter) / 16;
+		dect_playout_update_target(po);
+	}
+	po->arrival  = now;
+	po->last_len = len;
+
+	/* Overflow, drop the oldest data */
+	if (po->len + len > DECT_PLAYOUT_BUF_SIZE) {
+		n = po->len + len - DECT_PLAYOUT_BUF_SIZE;
+		dect_playout_decode(po, NULL, min(n, po->len));
+		po->stats.dropped++;
+	}
+
+	tail = (po->head + po->len) % DECT_PLAYOUT_BUF_SIZE;
+	n = min(len, DECT_PLAYOUT_BUF_SIZE - tail);
+	memcpy(po->buf + tail, mb->data, n);
+	memcpy(po->buf, mb->data + n, len - n);
+	po->len += len;
+}
+EXPORT_SYMBOL(dect_playout_put);
+
+/**
+ * Get the next block of linear PCM samples
+ *
+ * @param po		playout instance
+ * @param pcm		buffer for #DECT_PLAYOUT_BLOCK_SAMPLES samples
+ *
+ * Must be called once per block time, for instance from the application's
+ * audio device callback.
+ */
+void dect_playout_get(struct dect_playout *po, int16_t *pcm)
+{
+	unsigned int len;
+
+	po->stats.blocks++;
+	if (po->prefill) {
+		if (po->len < po->target) {
+			dect_playout_conceal(po, pcm, 0);
+			return;
+		}
+		po->prefill = false;
+	}
+
+	len = min(po->len, (unsigned int)DECT_PLAYOUT_BLOCK_SIZE);
+	dect_playout_decode(po, pcm, len);
+	if (len < DECT_PLAYOUT_BLOCK_SIZE) {
+		dect_playout_conceal(po, pcm, 2 * len);
+		po->stats.underruns++;
+		po->prefill = true;
+		return;
+	}
+
+	memcpy(po->last, pcm, sizeof(po->last));
+	po->conceal = 0;
+
+	/* Reduce the delay after a burst */
+	if (po->len > po->target + DECT_PLAYOUT_BLOCK_SIZE) {
+		dect_playout_decode(po, NULL, DECT_PLAYOUT_BLOCK_SIZE);
+		po->stats.dropped++;
+	}
+}
+EXPORT_SYMBOL(dect_playout_get);
+
+static void dect_playout_timer(struct dect_handle *dh, struct dect_timer *timer)
+{
+	struct dect_playout *po = timer->data;
+	int16_t pcm[DECT_PLAYOUT_BLOCK_SAMPLES];
+	uint64_t now;
+
+	/* Schedule relative to the deadline to avoid accumulating drift */
+	now = dect_timer_now();
+	po->deadline += DECT_PLAYOUT_BLOCK_TIME;
+	if (po->deadline < now)
+		po->deadline = now;
+	dect_timer_start_ms(dh, po->timer, po->deadline - now);
+
+	dect_playout_get(po, pcm);
+	po->cb(dh, po->priv, pcm);
+}
+
+/**
+ * Start paced playout
+ *
+ * @param dh		libdect DECT handle
+ * @param po		playout instance
+ * @param cb		callback invoked with each block
+ * @param priv		callback data
+ *
+ * Deliver a block of samples to @cb every block time, for applications
+ * without an audio device driven clock.
+ */
+int dect_playout_start(const struct dect_handle *dh, struct dect_playout *po,
+		       void (*cb)(struct dect_handle *dh, void *priv,
+				  const int16_t *pcm),
+		       void *priv)
+{
+	if (po->timer == NULL) {
+		po->timer = dect_timer_alloc(dh);
+		if (po->timer == NULL)
+			return -1;
+		dect_timer_setup(po->timer, dect_playout_timer, po);
+	}
+
+	po->cb	     = cb;
+	po->priv     = priv;
+	po->deadline = dect_timer_now() + DECT_PLAYOUT_BLOCK_TIME;
+	dect_timer_start_ms(dh, po->timer, DECT_PLAYOUT_BLOCK_TIME);
+	return 0;
+}
+EXPORT_SYMBOL(dect_playout_start);
+
+/**
+ * Stop paced playout
+ *
+ * @param dh		libdect DECT handle
+ * @param po		playout instance
+ */
+void dect_playout_stop(const struct dect_handle *dh, struct dect_playout *po)
+{
+	if (po->timer != NULL && dect_timer_running(po->timer))
+		dect_timer_stop(dh, po->timer);
+}
+EXPORT_SYMBOL(dect_playout_stop);
+
+/**
+ * Get playout statistics
+ *
+ * @param po		playout instance
+ * @param stats		playout statistics
+ */
+void dect_playout_get_stats(const struct dect_playout *po,
+			    struct dect_playout_stats *stats)
+{
+	*stats	      = po->stats;
+	stats->jitter = po->jitter / 16;
+	stats->delay  = po->target / DECT_PLAYOUT_BYTES_PER_MS;
+	stats->depth  = po->len / DECT_PLAYOUT_BYTES_PER_MS;
+}
+EXPORT_SYMBOL(dect_playout_get_stats);
+
+/** @} */
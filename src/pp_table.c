@@ -0,0 +1,260 @@
+/*
+ * libdect PP identity table
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @defgroup pp_table PP identity table
+ *
+ * Emulation of multiple PPs using a single handle.
+ *
+ * A PP handle normally represents a single PP using the identity set by
+ * dect_pp_set_ipui() and dect_pp_set_tpui(). Test rigs emulating many PPs
+ * can instead add any number of identities to the handle's identity table
+ * using dect_pp_identity_add(). Pages received on the B-SAP socket are then
+ * matched against all identities through a hash index and answered by each
+ * addressed identity, data links are established using the PMID of the
+ * identity of their IPUI. The identity of a handle set using
+ * dect_pp_set_ipui() is not used to answer pages while the table is in use.
+ *
+ * The identities are only used by the LCE; the IPUI passed to the requests
+ * of the higher layers selects the identity of a data link.
+ *
+ * @{
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+#include <libdect.h>
+#include <identities.h>
+#include <utils.h>
+#include <io.h>
+#include <lce.h>
+#include <pp_table.h>
+
+#define pp_debug(fmt, args...) \
+	dect_debug(DECT_DEBUG_LCE, "PP table: " fmt, ## args)
+
+static struct dect_pp_table *dect_pp_table_init(struct dect_handle *dh)
+{
+	struct dect_pp_table *pt;
+	int val = 0;
+
+	pt = dect_zalloc(dh, sizeof(*pt));
+	if (pt == NULL)
+		return NULL;
+	init_list_head(&pt->identities);
+
+	/* The B-SAP filter only admits pages of the handle's own identity */
+	if (dh->b_sap != NULL)
+		dect_fd_setsockopt(dh->b_sap, SOL_SOCKET, SO_DETACH_FILTER,
+				   &val, sizeof(val));
+
+	dh->pp_table = pt;
+	return pt;
+}
+
+static void dect_pp_page_hash(struct dect_pp_table *pt,
+			      struct dect_pp_identity *id,
+			      enum dect_pp_page_keys type, uint32_t value)
+{
+	struct dect_pp_page_key *pk = &id->keys[type];
+
+	pk->id	  = id;
+	pk->type  = type;
+	pk->value = value;
+	hlist_add_head(&pk->node, dect_pp_page_bucket(pt, type, value));
+}
+
+static void dect_pp_page_unhash(struct dect_pp_identity *id,
+				enum dect_pp_page_keys type)
+{
+	if (!hlist_unhashed(&id->keys[type].node))
+		hlist_del_init(&id->keys[type].node);
+}
+
+struct dect_pp_identity *dect_pp_identity_find(const struct dect_handle *dh,
+					       uint64_t key,
+					       const struct dect_ipui *ipui)
+{
+	const struct dect_pp_table *pt = dh->pp_table;
+	struct dect_pp_identity *id;
+	struct hlist_node *pos;
+
+	if (pt == NULL)
+		return NULL;
+
+	hlist_for_each_entry(id, pos,
+			     &pt->ipui_hash[hash_64(key, DECT_PP_HASH_BITS)],
+			     ipui_node) {
+		if (dect_ipui_key_eq(id->ipui_key, &id->ipui, key, ipui))
+			return id;
+	}
+	return NULL;
+}
+
+/**
+ * Look up a PP identity of a handle
+ *
+ * @param dh		libdect DECT handle
+ * @param ipui		IPUI of the identity
+ *
+ * @return the identity or NULL if the IPUI is not contained in the table.
+ */
+struct dect_pp_identity *dect_pp_identity_lookup(const struct dect_handle *dh,
+						 const struct dect_ipui *ipui)
+{
+	return dect_pp_identity_find(dh, dect_ipui_key(ipui), ipui);
+}
+EXPORT_SYMBOL(dect_pp_identity_lookup);
+
+/**
+ * Add a PP identity to a handle
+ *
+ * @param dh		libdect DECT handle
+ * @param ipui		IPUI of the identity
+ *
+ * The identity uses its default individual TPUI and a random default PMID
+ * until an assigned TPUI is set using dect_pp_identity_set_tpui().
+ *
+ * @return the identity or NULL on error.
+ */
+struct dect_pp_identity *dect_pp_identity_add(struct dect_handle *dh,
+					      const struct dect_ipui *ipui)
+{
+	struct dect_pp_table *pt = dh->pp_table;
+	struct dect_pp_identity *id;
+	struct dect_tpui tpui;
+
+	if (dh->mode != DECT_MODE_PP) {
+		errno = EINVAL;
+		goto err1;
+	}
+	if (dect_pp_identity_lookup(dh, ipui) != NULL) {
+		errno = EEXIST;
+		goto err1;
+	}
+
+	if (pt == NULL) {
+		pt = dect_pp_table_init(dh);
+		if (pt == NULL)
+			goto err1;
+	}
+
+	id = dect_zalloc(dh, sizeof(*id));
+	if (id == NULL)
+		goto err1;
+	id->ipui     = *ipui;
+	id->ipui_key = dect_ipui_key(ipui);
+	id->flags    = DECT_PP_IPUI;
+	id->pmid     = DECT_PMID_DEFAULT_ID +
+		       (random() & DECT_PMID_DEFAULT_NUM_MASK);
+	id->page_transaction.state = DECT_TRANSACTION_CLOSED;
+
+	init_hlist_node(&id->keys[DECT_PP_PAGE_ASSIGNED_TPUI].node);
+	dect_pp_page_hash(pt, id, DECT_PP_PAGE_DEFAULT_TPUI,
+			  (uint16_t)dect_build_tpui(dect_ipui_to_tpui(&tpui, ipui)));
+	dect_pp_page_hash(pt, id, DECT_PP_PAGE_IPUI, dect_lce_page_ipui(ipui));
+
+	hlist_add_head(&id->ipui_node,
+		       &pt->ipui_hash[hash_64(id->ipui_key, DECT_PP_HASH_BITS)]);
+	list_add_tail(&id->list, &pt->identities);
+	return id;
+
+err1:
+	pp_debug("dect_pp_identity_add: %s\n", strerror(errno));
+	return NULL;
+}
+EXPORT_SYMBOL(dect_pp_identity_add);
+
+/**
+ * Set the assigned TPUI of a PP identity
+ *
+ * @param dh		libdect DECT handle
+ * @param id		PP identity
+ * @param tpui		assigned individual TPUI
+ *
+ * The PMID of the identity is changed to the assigned PMID.
+ *
+ * @return 0 on success or -1 on error.
+ */
+int dect_pp_identity_set_tpui(struct dect_handle *dh,
+			      struct dect_pp_identity *id,
+			      const struct dect_tpui *tpui)
+{
+	struct dect_pmid pmid;
+
+	if (tpui->type != DECT_TPUI_INDIVIDUAL_ASSIGNED) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	id->tpui   = *tpui;
+	id->flags |= DECT_PP_TPUI;
+	id->pmid   = dect_build_pmid(dect_tpui_to_pmid(&pmid, tpui));
+
+	dect_pp_page_unhash(id, DECT_PP_PAGE_ASSIGNED_TPUI);
+	dect_pp_page_hash(dh->pp_table, id, DECT_PP_PAGE_ASSIGNED_TPUI,
+			  (uint16_t)dect_build_tpui(tpui));
+	return 0;
+}
+EXPORT_SYMBOL(dect_pp_identity_set_tpui);
+
+/**
+ * Remove a PP identity from a handle
+ *
+ * @param dh		libdect DECT handle
+ * @param id		PP identity
+ *
+ * Data links of the identity are not affected.
+ */
+void dect_pp_identity_remove(struct dect_handle *dh,
+			     struct dect_pp_identity *id)
+{
+	enum dect_pp_page_keys type;
+
+	if (id->page_transaction.state == DECT_TRANSACTION_OPEN)
+		dect_transaction_close(dh, &id->page_transaction,
+				       DECT_DDL_RELEASE_NORMAL);
+
+	for (type = 0; type < __DECT_PP_PAGE_MAX; type++)
+		dect_pp_page_unhash(id, type);
+	hlist_del(&id->ipui_node);
+	list_del(&id->list);
+	dect_free(dh, id);
+}
+EXPORT_SYMBOL(dect_pp_identity_remove);
+
+/* PMID of the identity a data link is established for */
+uint32_t dect_pp_table_pmid(const struct dect_handle *dh,
+			    const struct dect_data_link *ddl)
+{
+	const struct dect_pp_identity *id;
+
+	id = dect_pp_identity_find(dh, ddl->ipui_key, &ddl->ipui);
+	if (id == NULL)
+		return dh->pmid;
+	return id->pmid;
+}
+
+void dect_pp_table_exit(struct dect_handle *dh)
+{
+	struct dect_pp_table *pt = dh->pp_table;
+	struct dect_pp_identity *id, *next;
+
+	if (pt == NULL)
+		return;
+
+	list_for_each_entry_safe(id, next, &pt->identities, list)
+		dect_pp_identity_remove(dh, id);
+	dect_free(dh, pt);
+	dh->pp_table = NULL;
+}
+
+/** @} */
@@ -15,6 +15,12 @@
  * MAC frames. For raw frame reception, a callback function for
  * #dect_raw_ops::raw_rcv() must be provided by the user.
  *
+ * Applications receiving high frame rates can provide
+ * #dect_raw_ops::raw_rcv_batch() instead, which is invoked with arrays of
+ * up to 16 frames received using a single recvmmsg() call. The frames are
+ * lent to the callback and released when it returns, it may take additional
+ * references to keep them.
+ *
  * @{
  */
 
@@ -29,8 +35,15 @@
 #include <libdect.h>
 #include <utils.h>
 #include <io.h>
+#include <lce.h>
 #include <dect/raw.h>
 
+/* Number of fragments chained for receiving frames exceeding the head area */
+#define DECT_RAW_RCV_FRAGS	1
+
+/* Maximum number of frames received by a single recvmmsg() call */
+#define DECT_RAW_RCV_BATCH	16
+
 static void dect_raw_fill_sockaddr(struct dect_handle *dh,
 				   struct sockaddr_dect *da)
 {
@@ -39,6 +52,39 @@ static void dect_raw_fill_sockaddr(struct dect_handle *dh,
 	da->dect_index  = dh->index;
 }
 
+/* Control message buffer for the DECT_RAW_AUXDATA of a transmitted frame */
+union dect_raw_cmsg_buf {
+	struct cmsghdr		cmsg;
+	char			buf[CMSG_SPACE(sizeof(struct dect_raw_auxdata))];
+};
+
+static void dect_raw_fill_msg(struct msghdr *msg, struct sockaddr_dect *da,
+			      struct iovec *iov, union dect_raw_cmsg_buf *cmsg_buf,
+			      const struct dect_msg_buf *mb, uint32_t mfn,
+			      uint8_t frame, uint8_t slot)
+{
+	struct dect_raw_auxdata aux;
+	struct cmsghdr *cmsg;
+
+	msg->msg_name		= da;
+	msg->msg_namelen	= sizeof(*da);
+	msg->msg_iov		= iov;
+	msg->msg_iovlen		= dect_mbuf_fill_iov(iov, mb);
+	msg->msg_control	= cmsg_buf;
+	msg->msg_controllen	= sizeof(*cmsg_buf);
+	msg->msg_flags		= 0;
+
+	cmsg			= CMSG_FIRSTHDR(msg);
+	cmsg->cmsg_len		= CMSG_LEN(sizeof(aux));
+	cmsg->cmsg_level	= SOL_DECT;
+	cmsg->cmsg_type		= DECT_RAW_AUXDATA;
+
+	aux.mfn			= mfn;
+	aux.frame		= frame;
+	aux.slot		= slot;
+	memcpy(CMSG_DATA(cmsg), &aux, sizeof(aux));
+}
+
 /**
  * Transmit a DECT frame on the specified slot
  *
@@ -46,78 +92,87 @@ static void dect_raw_fill_sockaddr(struct dect_handle *dh,
  * @param dfd	libdect raw socket file descriptor
  * @param slot	slot number to transmit on
  * @param mb	libdect message buffer
+ *
+ * The frame data may be spread over a chain of message buffer fragments.
  */
 ssize_t dect_raw_transmit(struct dect_handle *dh, struct dect_fd *dfd,
 			  uint8_t slot, struct dect_msg_buf *mb)
 {
 	struct sockaddr_dect da;
-	struct iovec iov;
+	struct iovec iov[DECT_MBUF_IOV_MAX];
+	union dect_raw_cmsg_buf cmsg_buf;
 	struct msghdr msg;
-	struct dect_raw_auxdata aux;
-	struct cmsghdr *cmsg;
-	union {
-		struct cmsghdr		cmsg;
-		char			buf[CMSG_SPACE(sizeof(aux))];
-	} cmsg_buf;
+	ssize_t size;
 
 	dect_raw_fill_sockaddr(dh, &da);
-
-	msg.msg_name		= &da;
-	msg.msg_namelen		= sizeof(da);
-	msg.msg_iov		= &iov;
-	msg.msg_iovlen		= 1;
-	msg.msg_control		= &cmsg_buf;
-	msg.msg_controllen	= sizeof(cmsg_buf);
-	msg.msg_flags		= 0;
-
-	iov.iov_len		= mb->len;
-	iov.iov_base		= mb->data;
-
-	cmsg			= CMSG_FIRSTHDR(&msg);
-	cmsg->cmsg_len		= CMSG_LEN(sizeof(aux));
-	cmsg->cmsg_level	= SOL_DECT;
-	cmsg->cmsg_type		= DECT_RAW_AUXDATA;
-
-	aux.mfn			= 0;
-	aux.frame		= 0;
-	aux.slot		= slot;
-	memcpy(CMSG_DATA(cmsg), &aux, sizeof(aux));
-
-	return sendmsg(dfd->fd, &msg, 0);
+	dect_raw_fill_msg(&msg, &da, iov, &cmsg_buf, mb, 0, 0, slot);
+	size = sendmsg(dfd->fd, &msg, 0);
+	if (size < 0)
+		dect_stats_inc(dh, raw, tx_errors);
+	else
+		dect_stats_inc(dh, raw, tx_frames);
+	return size;
 }
 EXPORT_SYMBOL(dect_raw_transmit);
 
-static void dect_raw_event(struct dect_handle *dh, struct dect_fd *dfd,
-			   uint32_t events)
+/**
+ * Transmit a schedule of DECT frames
+ *
+ * @param dh	libdect handle
+ * @param dfd	libdect raw socket file descriptor
+ * @param mbs	libdect message buffers
+ * @param n	number of message buffers
+ *
+ * Transmit each frame in the multiframe, frame and slot specified by the
+ * mfn, frame and slot members of its message buffer. The frames are
+ * submitted using one sendmmsg() call per #DECT_RAW_TX_BATCH frames. The
+ * message buffers remain owned by the caller.
+ *
+ * @return the number of frames submitted, or -1 if the first frame could
+ * not be submitted.
+ */
+int dect_raw_transmit_batch(struct dect_handle *dh, struct dect_fd *dfd,
+			    struct dect_msg_buf *mbs[], unsigned int n)
 {
-	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
-	struct msghdr msg;
-	struct dect_raw_auxdata *aux;
-	struct cmsghdr *cmsg;
-	char cmsg_buf[4 * CMSG_SPACE(16)];
-	struct iovec iov;
-	ssize_t len;
-
-	dect_assert(!(events & ~DECT_FD_READ));
+	struct sockaddr_dect da;
+	struct iovec iov[DECT_RAW_TX_BATCH][DECT_MBUF_IOV_MAX];
+	union dect_raw_cmsg_buf cmsg_buf[DECT_RAW_TX_BATCH];
+	struct mmsghdr msgs[DECT_RAW_TX_BATCH];
+	struct dect_msg_buf *mb;
+	unsigned int i, cnt, sent = 0;
+	int err;
 
-	msg.msg_name		= NULL;
-	msg.msg_namelen		= 0;
-	msg.msg_control		= cmsg_buf;
-	msg.msg_controllen	= sizeof(cmsg_buf);
-	msg.msg_iov		= &iov;
-	msg.msg_iovlen		= 1;
-	msg.msg_flags		= 0;
+	dect_raw_fill_sockaddr(dh, &da);
+	while (sent < n) {
+		cnt = min(n - sent, (unsigned int)DECT_RAW_TX_BATCH);
+		for (i = 0; i < cnt; i++) {
+			mb = mbs[sent + i];
+			dect_raw_fill_msg(&msgs[i].msg_hdr, &da, iov[i], &cmsg_buf[i],
+					  mb, mb->mfn, mb->frame, mb->slot);
+		}
 
-	iov.iov_base		= mb->data;
-	iov.iov_len		= sizeof(mb->head);
+		err = sendmmsg(dfd->fd, msgs, cnt, 0);
+		if (err < 0) {
+			dect_stats_inc(dh, raw, tx_errors);
+			return sent > 0 ? (int)sent : -1;
+		}
+		dh->stats->raw.tx_frames += err;
+		sent += err;
+		if ((unsigned int)err < cnt)
+			break;
+	}
+	return sent;
+}
+EXPORT_SYMBOL(dect_raw_transmit_batch);
 
-	len = recvmsg(dfd->fd, &msg, 0);
-	if (len < 0)
-		return;
-	mb->len = len;
+/* Copy the frame's position from the auxiliary data, returns false if missing */
+static bool dect_raw_parse_auxdata(struct msghdr *msg, struct dect_msg_buf *mb)
+{
+	const struct dect_raw_auxdata *aux;
+	struct cmsghdr *cmsg;
 
 	aux = NULL;
-	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+	for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
 		if (cmsg->cmsg_level != SOL_DECT)
 			continue;
 
@@ -133,13 +188,123 @@ static void dect_raw_event(struct dect_handle *dh, struct dect_fd *dfd,
 	}
 
 	if (aux == NULL)
-		return;
+		return false;
 
 	mb->mfn   = aux->mfn;
 	mb->frame = aux->frame;
 	mb->slot  = aux->slot;
+	return true;
+}
+
+/*
+ * Batched receive: receive up to DECT_RAW_RCV_BATCH frames per recvmmsg()
+ * call into pool buffers and pass them to the raw_rcv_batch callback, until
+ * the socket is drained or the receive budget is exhausted. Returns the
+ * number of received frames, or -1 when no more frames are available.
+ */
+static int dect_raw_rcv_batch(struct dect_handle *dh, struct dect_fd *dfd,
+			      unsigned int budget)
+{
+	struct dect_msg_buf *mbs[DECT_RAW_RCV_BATCH];
+	struct iovec iov[DECT_RAW_RCV_BATCH][DECT_RAW_RCV_FRAGS + 1];
+	char cmsg_buf[DECT_RAW_RCV_BATCH][4 * CMSG_SPACE(16)];
+	struct mmsghdr msgs[DECT_RAW_RCV_BATCH];
+	struct msghdr *msg;
+	unsigned int i, n, valid;
+	int cnt;
+
+	budget = min(budget, (unsigned int)DECT_RAW_RCV_BATCH);
+
+	for (n = 0; n < budget; n++) {
+		mbs[n] = dect_mbuf_alloc_raw(dh);
+		if (mbs[n] == NULL)
+			break;
+
+		msg = &msgs[n].msg_hdr;
+		msg->msg_name		= NULL;
+		msg->msg_namelen	= 0;
+		msg->msg_control	= cmsg_buf[n];
+		msg->msg_controllen	= sizeof(cmsg_buf[n]);
+		msg->msg_iov		= iov[n];
+		msg->msg_iovlen		= dect_mbuf_rcv_prepare(dh, iov[n], mbs[n],
+								DECT_RAW_RCV_FRAGS);
+		msg->msg_flags		= 0;
+	}
+
+	cnt = 0;
+	if (n > 0)
+		cnt = recvmmsg(dfd->fd, msgs, n, MSG_DONTWAIT, NULL);
+
+	if (cnt > 0) {
+		for (i = 0, valid = 0; i < (unsigned int)cnt; i++) {
+			dect_mbuf_rcv_complete(dh, mbs[i], msgs[i].msg_len);
+			if (!dect_raw_parse_auxdata(&msgs[i].msg_hdr, mbs[i])) {
+				dect_stats_inc(dh, raw, rx_errors);
+				dect_mbuf_free(dh, mbs[i]);
+				continue;
+			}
+			mbs[valid++] = mbs[i];
+		}
+		dh->stats->raw.rx_frames += valid;
+
+		if (valid > 0)
+			dh->ops->raw_ops->raw_rcv_batch(dh, dfd, mbs, valid);
+		for (i = 0; i < valid; i++)
+			dect_mbuf_free(dh, mbs[i]);
+	}
+
+	for (i = cnt > 0 ? cnt : 0; i < n; i++)
+		dect_mbuf_free(dh, mbs[i]);
+	return cnt > 0 ? cnt : -1;
+}
+
+static void dect_raw_event(struct dect_handle *dh, struct dect_fd *dfd,
+			   uint32_t events)
+{
+	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
+	struct msghdr msg;
+	char cmsg_buf[4 * CMSG_SPACE(16)];
+	struct iovec iov[DECT_RAW_RCV_FRAGS + 1];
+	unsigned int n;
+	ssize_t len;
+	int cnt;
 
+	dect_assert(!(events & ~DECT_FD_READ));
+
+	if (dh->ops->raw_ops->raw_rcv_batch != NULL) {
+		for (n = 0; n < dh->rcv_budget; n += cnt) {
+			cnt = dect_raw_rcv_batch(dh, dfd, dh->rcv_budget - n);
+			if (cnt < DECT_RAW_RCV_BATCH)
+				break;
+		}
+		return;
+	}
+
+	msg.msg_name		= NULL;
+	msg.msg_namelen		= 0;
+	msg.msg_control		= cmsg_buf;
+	msg.msg_controllen	= sizeof(cmsg_buf);
+	msg.msg_iov		= iov;
+	msg.msg_iovlen		= dect_mbuf_rcv_prepare(dh, iov, mb,
+							DECT_RAW_RCV_FRAGS);
+	msg.msg_flags		= 0;
+
+	len = recvmsg(dfd->fd, &msg, 0);
+	if (len < 0) {
+		dect_stats_inc(dh, raw, rx_errors);
+		goto out;
+	}
+	dect_mbuf_rcv_complete(dh, mb, len);
+
+	if (!dect_raw_parse_auxdata(&msg, mb)) {
+		dect_stats_inc(dh, raw, rx_errors);
+		goto out;
+	}
+
+	dect_stats_inc(dh, raw, rx_frames);
 	dh->ops->raw_ops->raw_rcv(dh, dfd, mb);
+out:
+	dect_mbuf_free_frags(dh, mb);
 }
 
 /**
@@ -158,12 +323,13 @@ struct dect_fd *dect_raw_open(struct dect_handle *dh)
 
 	/* Only bind socket if user wants to receive packets */
 	if (dh->ops->raw_ops == NULL ||
-	    dh->ops->raw_ops->raw_rcv == NULL)
+	    (dh->ops->raw_ops->raw_rcv == NULL &&
+	     dh->ops->raw_ops->raw_rcv_batch == NULL))
 		goto out;
 
 	dect_raw_fill_sockaddr(dh, &da);
 
-	if (bind(dfd->fd, (struct sockaddr *)&da, sizeof(da)) < 0)
+	if (dect_fd_bind(dfd, (struct sockaddr *)&da, sizeof(da)) < 0)
 		goto err2;
 
 	dect_fd_setup(dfd, dect_raw_event, dfd);
@@ -0,0 +1,431 @@
+/*
+ * libdect S-SAP traffic recorder
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @defgroup record S-SAP traffic recording
+ *
+ * Recording and replay of S-Format messages.
+ *
+ * While recording, every S-Format message received or transmitted on a data
+ * link is written to a binary file together with the direction, a timestamp
+ * and the transaction identifier. The release of a link is recorded as well,
+ * so link identifiers can be reused. The file starts with a
+ * #dect_record_file_hdr, followed by records consisting of a
+ * #dect_record_hdr and the message data. All fields are in host byte order.
+ *
+ * dect_replay() feeds the received messages of a recording into the LCE of
+ * a handle as fast as possible, passing them through the S-Format parser and
+ * the protocol state machines. Each recorded link is replayed on a local
+ * link, messages transmitted in response are discarded. It can be used to
+ * benchmark changes against real traffic mixes and to reproduce bugs.
+ *
+ * @{
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+
+#include <libdect.h>
+#include <utils.h>
+#include <s_fmt.h>
+#include <lce.h>
+#include <record.h>
+
+/* Output buffer size */
+#define DECT_RECORD_BUF_SIZE		(64 * 1024)
+
+/* Maximum size of a record including the message data */
+#define DECT_RECORD_SIZE_MAX		(sizeof(struct dect_record_hdr) + 256)
+
+#define DECT_REPLAY_HASH_BITS		8
+#define DECT_REPLAY_HASH_SIZE		(1 << DECT_REPLAY_HASH_BITS)
+
+/**
+ * struct dect_recorder - S-SAP traffic recorder
+ *
+ * @fd:		file descriptor of the recording
+ * @len:	amount of buffered data
+ * @buf:	output buffer
+ */
+struct dect_recorder {
+	int				fd;
+	unsigned int			len;
+	uint8_t				buf[DECT_RECORD_BUF_SIZE];
+};
+
+static int dect_record_flush(struct dect_recorder *rec)
+{
+	unsigned int off = 0;
+	ssize_t len;
+
+	while (off < rec->len) {
+		len = write(rec->fd, rec->buf + off, rec->len - off);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		off += len;
+	}
+	rec->len = 0;
+	return 0;
+}
+
+void __dect_record(const struct dect_handle *dh, const void *link,
+		   enum dect_record_types type, const struct dect_msg_buf *mb)
+{
+	struct dect_recorder *rec = dh->recorder;
+	struct dect_record_hdr *hdr;
+	unsigned int len;
+	uint8_t *data;
+
+	len = mb != NULL ? dect_mbuf_chain_len(mb) : 0;
+	if (len > 256)
+		return;
+	if (rec->len + DECT_RECORD_SIZE_MAX > sizeof(rec->buf) &&
+	    dect_record_flush(rec) < 0)
+		return;
+
+	hdr = (struct dect_record_hdr *)(rec->buf + rec->len);
+	memset(hdr, 0, sizeof(*hdr));
+	hdr->ts   = dect_stats_clock();
+	hdr->link = (uintptr_t)link;
+	hdr->type = type;
+	hdr->len  = len;
+	if (len >= DECT_S_HDR_SIZE) {
+		hdr->f  = !!(mb->data[0] & DECT_S_TI_F_FLAG);
+		hdr->tv = (mb->data[0] & DECT_S_TI_TV_MASK) >> DECT_S_TI_TV_SHIFT;
+		hdr->pd = mb->data[0] & DECT_S_PD_MASK;
+	}
+
+	data = (uint8_t *)(hdr + 1);
+	for (; mb != NULL; mb = mb->frag) {
+		memcpy(data, mb->data, mb->len);
+		data += mb->len;
+	}
+	rec->len += sizeof(*hdr) + align(len, 8);
+}
+
+/**
+ * Start recording S-SAP traffic
+ *
+ * @param dh		libdect DECT handle
+ * @param path		path of the recording, created or truncated
+ *
+ * @return 0 on success or -1 on error, setting errno.
+ */
+int dect_record_start(struct dect_handle *dh, const char *path)
+{
+	struct dect_record_file_hdr *fhdr;
+	struct dect_recorder *rec;
+	struct timespec ts;
+
+	if (dh->recorder != NULL) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	rec = dect_zalloc(dh, sizeof(*rec));
+	if (rec == NULL)
+		goto err1;
+
+	rec->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (rec->fd < 0)
+		goto err2;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	fhdr = (struct dect_record_file_hdr *)rec->buf;
+	fhdr->magic   = DECT_RECORD_MAGIC;
+	fhdr->version = DECT_RECORD_VERSION;
+	fhdr->mode    = dh->mode;
+	fhdr->start   = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+	rec->len      = sizeof(*fhdr);
+
+	dh->recorder = rec;
+	return 0;
+
+err2:
+	dect_free(dh, rec);
+err1:
+	return -1;
+}
+EXPORT_SYMBOL(dect_record_start);
+
+/**
+ * Stop recording S-SAP traffic
+ *
+ * @param dh		libdect DECT handle
+ *
+ * Flush all buffered records and close the recording.
+ *
+ * @return 0 on success or -1 if writing the recording failed, setting errno.
+ */
+int dect_record_stop(struct dect_handle *dh)
+{
+	struct dect_recorder *rec = dh->recorder;
+	int err = 0;
+
+	if (rec == NULL)
+		return 0;
+	dh->recorder = NULL;
+
+	if (dect_record_flush(rec) < 0)
+		err = -1;
+	if (close(rec->fd) < 0)
+		err = -1;
+	dect_free(dh, rec);
+	return err;
+}
+EXPORT_SYMBOL(dect_record_stop);
+
+void dect_record_exit(struct dect_handle *dh)
+{
+	dect_record_stop(dh);
+}
+
+/*
+ * Replay
+ */
+
+/**
+ * struct dect_replay_link - replayed data link
+ *
+ * @node:	hash node
+ * @list:	list of all replayed links
+ * @id:		recorded link identifier
+ * @ddl:	local data link
+ * @peer:	peer end of the local link's socketpair
+ */
+struct dect_replay_link {
+	struct hlist_node		node;
+	struct list_head		list;
+	uint64_t			id;
+	struct dect_data_link		*ddl;
+	int				peer;
+};
+
+struct dect_replay {
+	struct dect_handle		*dh;
+	struct dect_replay_stats	*stats;
+	struct list_head		links;
+	struct hlist_head		hash[DECT_REPLAY_HASH_SIZE];
+};
+
+static struct dect_replay_link *dect_replay_lookup(struct dect_replay *rp,
+						   uint64_t id)
+{
+	struct dect_replay_link *rl;
+	struct hlist_node *n;
+
+	hlist_for_each_entry(rl, n, &rp->hash[hash_64(id, DECT_REPLAY_HASH_BITS)],
+			     node) {
+		if (rl->id == id)
+			return rl;
+	}
+	return NULL;
+}
+
+static void dect_replay_link_free(struct dect_replay *rp,
+				  struct dect_replay_link *rl)
+{
+	hlist_del(&rl->node);
+	list_del(&rl->list);
+	close(rl->peer);
+	dect_free(rp->dh, rl);
+}
+
+/*
+ * Discard the messages transmitted on a link. Returns false if the link was
+ * destroyed, in which case the peer end has become readable with EOF.
+ */
+static bool dect_replay_link_drain(struct dect_replay *rp,
+				   struct dect_replay_link *rl)
+{
+	uint8_t buf[256];
+	ssize_t len;
+
+	while (1) {
+		len = recv(rl->peer, buf, sizeof(buf), MSG_DONTWAIT);
+		if (len > 0) {
+			rp->stats->tx_replies++;
+			continue;
+		}
+		return len < 0 && errno == EAGAIN;
+	}
+}
+
+static struct dect_replay_link *dect_replay_link_get(struct dect_replay *rp,
+						     uint64_t id)
+{
+	struct dect_replay_link *rl;
+
+	rl = dect_replay_lookup(rp, id);
+	if (rl != NULL) {
+		if (dect_replay_link_drain(rp, rl))
+			return rl;
+		dect_replay_link_free(rp, rl);
+	}
+
+	rl = dect_zalloc(rp->dh, sizeof(*rl));
+	if (rl == NULL)
+		return NULL;
+	rl->ddl = dect_ddl_replay_open(rp->dh, &rl->peer);
+	if (rl->ddl == NULL) {
+		dect_free(rp->dh, rl);
+		return NULL;
+	}
+	rl->id = id;
+	hlist_add_head(&rl->node, &rp->hash[hash_64(id, DECT_REPLAY_HASH_BITS)]);
+	list_add_tail(&rl->list, &rp->links);
+	rp->stats->links++;
+	return rl;
+}
+
+static void dect_replay_link_release(struct dect_replay *rp,
+				     struct dect_replay_link *rl)
+{
+	if (dect_replay_link_drain(rp, rl))
+		dect_ddl_replay_close(rp->dh, rl->ddl);
+	dect_replay_link_drain(rp, rl);
+	dect_replay_link_free(rp, rl);
+}
+
+static int dect_replay_rx(struct dect_replay *rp,
+			  const struct dect_record_hdr *hdr)
+{
+	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
+	struct dect_replay_link *rl;
+
+	if (hdr->len > sizeof(mb->head)) {
+		rp->stats->errors++;
+		return 0;
+	}
+
+	rl = dect_replay_link_get(rp, hdr->link);
+	if (rl == NULL)
+		return -1;
+
+	memcpy(mb->data, hdr + 1, hdr->len);
+	mb->len = hdr->len;
+	rp->stats->rx_msgs++;
+
+	if (!dect_ddl_replay_rcv(rp->dh, rl->ddl, mb))
+		dect_replay_link_free(rp, rl);
+	return 0;
+}
+
+/**
+ * Replay a recording of S-SAP traffic
+ *
+ * @param dh		libdect DECT handle
+ * @param path		path of the recording
+ * @param stats		replay statistics
+ *
+ * Process the received messages of a recording as if they were received on
+ * the handle's data links. Recorded transmitted messages are skipped, the
+ * handle generates its own replies. Timers are not run during the replay.
+ * All replayed links are shut down when the end of the recording is reached.
+ *
+ * @return 0 on success or -1 on error, setting errno.
+ */
+int dect_replay(struct dect_handle *dh, const char *path,
+		struct dect_replay_stats *stats)
+{
+	const struct dect_record_file_hdr *fhdr;
+	const struct dect_record_hdr *hdr;
+	struct dect_replay_link *rl, *next;
+	struct dect_replay rp;
+	struct stat st;
+	uint64_t start;
+	size_t off;
+	void *map;
+	int fd, err = 0;
+
+	memset(stats, 0, sizeof(*stats));
+	memset(&rp, 0, sizeof(rp));
+	rp.dh	 = dh;
+	rp.stats = stats;
+	init_list_head(&rp.links);
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		goto err1;
+	if (fstat(fd, &st) < 0)
+		goto err2;
+	if ((size_t)st.st_size < sizeof(*fhdr)) {
+		errno = EINVAL;
+		goto err2;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		goto err2;
+	close(fd);
+
+	fhdr = map;
+	if (fhdr->magic != DECT_RECORD_MAGIC ||
+	    fhdr->version != DECT_RECORD_VERSION) {
+		errno = EINVAL;
+		goto err3;
+	}
+
+	start = dect_stats_clock();
+	for (off = sizeof(*fhdr); off + sizeof(*hdr) <= (size_t)st.st_size;
+	     off += sizeof(*hdr) + align(hdr->len, 8)) {
+		hdr = (const void *)((const uint8_t *)map + off);
+		if (off + sizeof(*hdr) + hdr->len > (size_t)st.st_size) {
+			stats->errors++;
+			break;
+		}
+
+		switch (hdr->type) {
+		case DECT_RECORD_RX:
+			err = dect_replay_rx(&rp, hdr);
+			break;
+		case DECT_RECORD_TX:
+			stats->tx_msgs++;
+			break;
+		case DECT_RECORD_RELEASE:
+			rl = dect_replay_lookup(&rp, hdr->link);
+			if (rl != NULL)
+				dect_replay_link_release(&rp, rl);
+			break;
+		default:
+			stats->errors++;
+			break;
+		}
+		if (err < 0)
+			break;
+	}
+
+	list_for_each_entry_safe(rl, next, &rp.links, list)
+		dect_replay_link_release(&rp, rl);
+	stats->duration = dect_stats_clock() - start;
+
+	munmap(map, st.st_size);
+	return err;
+
+err3:
+	munmap(map, st.st_size);
+	return -1;
+err2:
+	close(fd);
+err1:
+	return -1;
+}
+EXPORT_SYMBOL(dect_replay);
+
+/** @} */
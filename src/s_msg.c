@@ -23,6 +23,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <asm/byteorder.h>
 
 #include <libdect.h>
@@ -30,6 +31,7 @@
 #include <utils.h>
 #include <s_fmt.h>
 #include <lce.h>
+#include <trace.h>
 
 #define sfmt_debug(fmt, args...) \
 	dect_debug(DECT_DEBUG_SFMT, fmt, ## args)
@@ -894,6 +896,18 @@ static int dect_sfmt_parse_service_change_info(const struct dect_handle *dh,
 	return 0;
 }
 
+static int dect_sfmt_build_service_change_info(struct dect_sfmt_ie *dst,
+					       const struct dect_ie_common *ie)
+{
+	struct dect_ie_service_change_info *src = dect_ie_container(src, ie);
+
+	dst->data[2]  = 0x80 | src->mode;
+	if (src->master)
+		dst->data[2] |= 0x40;
+	dst->len = 3;
+	return 0;
+}
+
 static const struct dect_trans_tbl dect_cipher_algs[] = {
 	TRANS_TBL(DECT_CIPHER_STANDARD_1,		"DECT Standard Cipher 1"),
 	TRANS_TBL(DECT_CIPHER_GPRS_NO_CIPHERING,	"GPRS ciphering not used"),
@@ -2135,9 +2149,24 @@ static int dect_sfmt_build_events_notification(struct dect_sfmt_ie *dst,
 	return 0;
 }
 
+/*
+ * IE dump functions are only referenced by debugging builds, so they and
+ * their translation tables are discarded otherwise.
+ */
+#ifdef DEBUG
+#define DECT_SFMT_DUMP(fn)	(fn)
+#else
+#define DECT_SFMT_DUMP(fn)	(0 ? (fn) : NULL)
+#endif
+
+/*
+ * IE handlers. Received IEs with a @payload offset are only allocated up to
+ * the received length instead of the full structure size.
+ */
 static const struct dect_ie_handler {
 	const char	*name;
 	size_t		size;
+	size_t		payload;
 	int		(*parse)(const struct dect_handle *dh,
 				 struct dect_ie_common **dst,
 				 const struct dect_sfmt_ie *ie);
@@ -2149,7 +2178,7 @@ static const struct dect_ie_handler {
 		.name	= "REPEAT-INDICATOR",
 		.parse	= dect_sfmt_parse_repeat_indicator,
 		.build	= dect_sfmt_build_repeat_indicator,
-		.dump	= dect_sfmt_dump_repeat_indicator,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_repeat_indicator),
 	},
 	[DECT_IE_SENDING_COMPLETE]		= {
 		.name	= "SENDING-COMPLETE",
@@ -2174,21 +2203,21 @@ static const struct dect_ie_handler {
 		.size	= sizeof(struct dect_ie_basic_service),
 		.parse	= dect_sfmt_parse_basic_service,
 		.build	= dect_sfmt_build_basic_service,
-		.dump	= dect_sfmt_dump_basic_service,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_basic_service),
 	},
 	[DECT_IE_RELEASE_REASON]		= {
 		.name	= "RELEASE-REASON",
 		.size	= sizeof(struct dect_ie_release_reason),
 		.parse	= dect_sfmt_parse_release_reason,
 		.build	= dect_sfmt_build_release_reason,
-		.dump	= dect_sfmt_dump_release_reason,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_release_reason),
 	},
 	[DECT_IE_SIGNAL]			= {
 		.name	= "SIGNAL",
 		.size	= sizeof(struct dect_ie_signal),
 		.parse	= dect_sfmt_parse_signal,
 		.build	= dect_sfmt_build_signal,
-		.dump	= dect_sfmt_dump_signal,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_signal),
 	},
 	[DECT_IE_TIMER_RESTART]			= {
 		.name	= "TIMER-RESTART",
@@ -2201,51 +2230,53 @@ static const struct dect_ie_handler {
 	[DECT_IE_SINGLE_DISPLAY]		= {
 		.name	= "SINGLE-DISPLAY",
 		.size	= sizeof(struct dect_ie_display),
+		.payload = offsetof(struct dect_ie_display, info),
 		.parse	= dect_sfmt_parse_single_display,
 		.build	= dect_sfmt_build_single_display,
-		.dump	= dect_sfmt_dump_display,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_display),
 	},
 	[DECT_IE_SINGLE_KEYPAD]			= {
 		.name	= "SINGLE-KEYPAD",
 		.size	= sizeof(struct dect_ie_keypad),
+		.payload = offsetof(struct dect_ie_keypad, info),
 		.parse	= dect_sfmt_parse_single_keypad,
 		.build	= dect_sfmt_build_single_keypad,
-		.dump	= dect_sfmt_dump_keypad,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_keypad),
 	},
 	[DECT_IE_INFO_TYPE]			= {
 		.name	= "INFO-TYPE",
 		.size	= sizeof(struct dect_ie_info_type),
 		.parse	= dect_sfmt_parse_info_type,
 		.build	= dect_sfmt_build_info_type,
-		.dump	= dect_sfmt_dump_info_type,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_info_type),
 	},
 	[DECT_IE_IDENTITY_TYPE]			= {
 		.name	= "IDENTITY-TYPE",
 		.size	= sizeof(struct dect_ie_identity_type),
 		.parse	= dect_sfmt_parse_identity_type,
 		.build	= dect_sfmt_build_identity_type,
-		.dump	= dect_sfmt_dump_identity_type,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_identity_type),
 	},
 	[DECT_IE_PORTABLE_IDENTITY]		= {
 		.name	= "PORTABLE-IDENTITY",
 		.size	= sizeof(struct dect_ie_portable_identity),
 		.parse	= dect_sfmt_parse_portable_identity,
 		.build	= dect_sfmt_build_portable_identity,
-		.dump	= dect_sfmt_dump_portable_identity,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_portable_identity),
 	},
 	[DECT_IE_FIXED_IDENTITY]		= {
 		.name	= "FIXED-IDENTITY",
 		.size	= sizeof(struct dect_ie_fixed_identity),
 		.parse	= dect_sfmt_parse_fixed_identity,
 		.build	= dect_sfmt_build_fixed_identity,
-		.dump	= dect_sfmt_dump_fixed_identity,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_fixed_identity),
 	},
 	[DECT_IE_LOCATION_AREA]			= {
 		.name	= "LOCATION-AREA",
 		.size	= sizeof(struct dect_ie_location_area),
 		.parse	= dect_sfmt_parse_location_area,
 		.build	= dect_sfmt_build_location_area,
-		.dump	= dect_sfmt_dump_location_area,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_location_area),
 	},
 	[DECT_IE_NWK_ASSIGNED_IDENTITY]		= {
 		.name	= "NWK-ASSIGNED-IDENTITY",
@@ -2256,35 +2287,35 @@ static const struct dect_ie_handler {
 		.size	= sizeof(struct dect_ie_allocation_type),
 		.parse	= dect_sfmt_parse_allocation_type,
 		.build	= dect_sfmt_build_allocation_type,
-		.dump	= dect_sfmt_dump_allocation_type,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_allocation_type),
 	},
 	[DECT_IE_AUTH_TYPE]			= {
 		.name	= "AUTH-TYPE",
 		.size	= sizeof(struct dect_ie_auth_type),
 		.parse	= dect_sfmt_parse_auth_type,
 		.build	= dect_sfmt_build_auth_type,
-		.dump	= dect_sfmt_dump_auth_type,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_auth_type),
 	},
 	[DECT_IE_RAND]				= {
 		.name	= "RAND",
 		.size	= sizeof(struct dect_ie_auth_value),
 		.parse	= dect_sfmt_parse_auth_value,
 		.build	= dect_sfmt_build_auth_value,
-		.dump	= dect_sfmt_dump_auth_value,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_auth_value),
 	},
 	[DECT_IE_RES]				= {
 		.name	= "RES",
 		.size	= sizeof(struct dect_ie_auth_res),
 		.parse	= dect_sfmt_parse_auth_res,
 		.build	= dect_sfmt_build_auth_res,
-		.dump	= dect_sfmt_dump_auth_res,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_auth_res),
 	},
 	[DECT_IE_RS]				= {
 		.name	= "RS",
 		.size	= sizeof(struct dect_ie_auth_value),
 		.parse	= dect_sfmt_parse_auth_value,
 		.build	= dect_sfmt_build_auth_value,
-		.dump	= dect_sfmt_dump_auth_value,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_auth_value),
 	},
 	[DECT_IE_IWU_ATTRIBUTES]		= {
 		.name	= "IWU-ATTRIBUTES",
@@ -2298,7 +2329,8 @@ static const struct dect_ie_handler {
 		.name	= "SERVICE-CHANGE-INFO",
 		.size	= sizeof(struct dect_ie_service_change_info),
 		.parse	= dect_sfmt_parse_service_change_info,
-		.dump	= dect_sfmt_dump_service_change_info,
+		.build	= dect_sfmt_build_service_change_info,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_service_change_info),
 	},
 	[DECT_IE_CONNECTION_ATTRIBUTES]		= {
 		.name	= "CONNECTION-ATTRIBUTES",
@@ -2309,7 +2341,7 @@ static const struct dect_ie_handler {
 		.size	= sizeof(struct dect_ie_cipher_info),
 		.parse	= dect_sfmt_parse_cipher_info,
 		.build	= dect_sfmt_build_cipher_info,
-		.dump	= dect_sfmt_dump_cipher_info,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_cipher_info),
 	},
 	[DECT_IE_CALL_IDENTITY]			= {
 		.name	= "CALL-IDENTITY",
@@ -2323,14 +2355,14 @@ static const struct dect_ie_handler {
 		.name	= "FACILITY",
 		.size	= sizeof(struct dect_ie_facility),
 		.parse	= dect_sfmt_parse_facility,
-		.dump	= dect_sfmt_dump_facility,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_facility),
 	},
 	[DECT_IE_PROGRESS_INDICATOR]		= {
 		.name	= "PROGRESS-INDICATOR",
 		.size	= sizeof(struct dect_ie_progress_indicator),
 		.parse	= dect_sfmt_parse_progress_indicator,
 		.build	= dect_sfmt_build_progress_indicator,
-		.dump	= dect_sfmt_dump_progress_indicator,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_progress_indicator),
 	},
 	[DECT_IE_MMS_GENERIC_HEADER]		= {
 		.name	= "MMS-GENERIC-HEADER",
@@ -2349,41 +2381,43 @@ static const struct dect_ie_handler {
 		.size	= sizeof(struct dect_ie_time_date),
 		.parse	= dect_sfmt_parse_time_date,
 		.build	= dect_sfmt_build_time_date,
-		.dump	= dect_sfmt_dump_time_date,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_time_date),
 	},
 	[DECT_IE_MULTI_DISPLAY]			= {
 		.name	= "MULTI-DISPLAY",
 		.size	= sizeof(struct dect_ie_display),
+		.payload = offsetof(struct dect_ie_display, info),
 		.parse	= dect_sfmt_parse_multi_display,
 		.build	= dect_sfmt_build_multi_display,
-		.dump	= dect_sfmt_dump_display,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_display),
 	},
 	[DECT_IE_MULTI_KEYPAD]			= {
 		.name	= "MULTI-KEYPAD",
 		.size	= sizeof(struct dect_ie_keypad),
+		.payload = offsetof(struct dect_ie_keypad, info),
 		.parse	= dect_sfmt_parse_multi_keypad,
 		.build	= dect_sfmt_build_multi_keypad,
-		.dump	= dect_sfmt_dump_keypad,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_keypad),
 	},
 	[DECT_IE_FEATURE_ACTIVATE]		= {
 		.name	= "FEATURE-ACTIVATE",
 		.size	= sizeof(struct dect_ie_feature_activate),
 		.parse	= dect_sfmt_parse_feature_activate,
 		.build	= dect_sfmt_build_feature_activate,
-		.dump	= dect_sfmt_dump_feature_activate,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_feature_activate),
 	},
 	[DECT_IE_FEATURE_INDICATE]		= {
 		.name	= "FEATURE-INDICATE",
 		.size	= sizeof(struct dect_ie_feature_indicate),
 		.parse	= dect_sfmt_parse_feature_indicate,
-		.dump	= dect_sfmt_dump_feature_indicate,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_feature_indicate),
 	},
 	[DECT_IE_NETWORK_PARAMETER]		= {
 		.name	= "NETWORK-PARAMETER",
 		.size	= sizeof(struct dect_ie_network_parameter),
 		.build	= dect_sfmt_build_network_parameter,
 		.parse	= dect_sfmt_parse_network_parameter,
-		.dump	= dect_sfmt_dump_network_parameter,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_network_parameter),
 	},
 	[DECT_IE_EXT_HO_INDICATOR]		= {
 		.name	= "EXT-H/O-INDICATOR",
@@ -2406,7 +2440,7 @@ static const struct dect_ie_handler {
 		.size	= sizeof(struct dect_ie_reject_reason),
 		.parse	= dect_sfmt_parse_reject_reason,
 		.build	= dect_sfmt_build_reject_reason,
-		.dump	= dect_sfmt_dump_reject_reason,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_reject_reason),
 	},
 	[DECT_IE_SETUP_CAPABILITY]		= {
 		.name	= "SETUP-CAPABILITY",
@@ -2419,7 +2453,7 @@ static const struct dect_ie_handler {
 		.size	= sizeof(struct dect_ie_terminal_capability),
 		.parse	= dect_sfmt_parse_terminal_capability,
 		.build	= dect_sfmt_build_terminal_capability,
-		.dump	= dect_sfmt_dump_terminal_capability,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_terminal_capability),
 	},
 	[DECT_IE_END_TO_END_COMPATIBILITY]	= {
 		.name	= "END-TO-END-COMPATIBILITY",
@@ -2442,21 +2476,21 @@ static const struct dect_ie_handler {
 		.size	= sizeof(struct dect_ie_calling_party_number),
 		.parse	= dect_sfmt_parse_calling_party_number,
 		.build	= dect_sfmt_build_calling_party_number,
-		.dump	= dect_sfmt_dump_calling_party_number,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_calling_party_number),
 	},
 	[DECT_IE_CALLING_PARTY_NAME]		= {
 		.name	= "CALLING-PARTY-NAME",
 		.size	= sizeof(struct dect_ie_calling_party_name),
 		.parse	= dect_sfmt_parse_calling_party_name,
 		.build	= dect_sfmt_build_calling_party_name,
-		.dump	= dect_sfmt_dump_calling_party_name,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_calling_party_name),
 	},
 	[DECT_IE_CALLED_PARTY_NUMBER]		= {
 		.name	= "CALLED-PARTY-NUMBER",
 		.size	= sizeof(struct dect_ie_called_party_number),
 		.parse	= dect_sfmt_parse_called_party_number,
 		.build	= dect_sfmt_build_called_party_number,
-		.dump	= dect_sfmt_dump_called_party_number,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_called_party_number),
 	},
 	[DECT_IE_CALLED_PARTY_SUBADDR]		= {
 		.name	= "CALLED-PARTY-SUBADDRESS",
@@ -2467,7 +2501,7 @@ static const struct dect_ie_handler {
 		.size	= sizeof(struct dect_ie_duration),
 		.parse	= dect_sfmt_parse_duration,
 		.build	= dect_sfmt_build_duration,
-		.dump	= dect_sfmt_dump_duration,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_duration),
 	},
 	[DECT_IE_SEGMENTED_INFO]		= {
 		.name	= "SEGMENTED-INFO",
@@ -2480,9 +2514,10 @@ static const struct dect_ie_handler {
 	[DECT_IE_IWU_TO_IWU]			= {
 		.name	= "IWU-TO-IWU",
 		.size	= sizeof(struct dect_ie_iwu_to_iwu),
+		.payload = offsetof(struct dect_ie_iwu_to_iwu, data),
 		.parse	= dect_sfmt_parse_iwu_to_iwu,
 		.build	= dect_sfmt_build_iwu_to_iwu,
-		.dump	= dect_sfmt_dump_iwu_to_iwu,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_iwu_to_iwu),
 	},
 	[DECT_IE_MODEL_IDENTIFIER]		= {
 		.name	= "MODEL-IDENTIFIER",
@@ -2497,20 +2532,20 @@ static const struct dect_ie_handler {
 		.size	= sizeof(struct dect_ie_escape_to_proprietary),
 		.parse	= dect_sfmt_parse_escape_to_proprietary,
 		.build	= dect_sfmt_build_escape_to_proprietary,
-		.dump	= dect_sfmt_dump_escape_to_proprietary,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_escape_to_proprietary),
 	},
 	[DECT_IE_CODEC_LIST]			= {
 		.name	= "CODEC-LIST",
 		.size	= sizeof(struct dect_ie_codec_list),
 		.parse	= dect_sfmt_parse_codec_list,
 		.build	= dect_sfmt_build_codec_list,
-		.dump	= dect_sfmt_dump_codec_list,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_codec_list),
 	},
 	[DECT_IE_EVENTS_NOTIFICATION]		= {
 		.name	= "EVENTS-NOTIFICATION",
 		.size	= sizeof(struct dect_ie_events_notification),
 		.build	= dect_sfmt_build_events_notification,
-		.dump	= dect_sfmt_dump_events_notification,
+		.dump	= DECT_SFMT_DUMP(dect_sfmt_dump_events_notification),
 	},
 	[DECT_IE_CALL_INFORMATION]		= {
 		.name	= "CALL-INFORMATION",
@@ -2521,15 +2556,6 @@ static const struct dect_ie_handler {
 	},
 };
 
-static enum dect_sfmt_ie_status dect_rx_status(const struct dect_handle *dh,
-					       const struct dect_sfmt_ie_desc *desc)
-{
-	if (dh->mode == DECT_MODE_FP)
-		return desc->pp_fp;
-	else
-		return desc->fp_pp;
-}
-
 static enum dect_sfmt_ie_status dect_tx_status(const struct dect_handle *dh,
 					       const struct dect_sfmt_ie_desc *desc)
 {
@@ -2619,6 +2645,48 @@ dect_parse_sfmt_ie_header(struct dect_sfmt_ie *ie,
 }
 EXPORT_SYMBOL(dect_parse_sfmt_ie_header);
 
+/**
+ * Find the IPUI of the <<PORTABLE-IDENTITY>> IE of a S-Format message
+ *
+ * @param data	message data, including the S-Format header
+ * @param len	length of the message data
+ * @param ipui	result pointer to the IPUI
+ *
+ * Used to classify a message without fully parsing it.
+ *
+ * @return true if an IPUI was found, false otherwise.
+ */
+bool dect_sfmt_peek_ipui(const uint8_t *data, unsigned int len,
+			 struct dect_ipui *ipui)
+{
+	struct dect_msg_buf mb;
+	struct dect_sfmt_ie ie;
+
+	if (len < DECT_S_HDR_SIZE)
+		return false;
+	mb.data = (uint8_t *)data + DECT_S_HDR_SIZE;
+	mb.len  = len - DECT_S_HDR_SIZE;
+
+	while (mb.len > 0) {
+		if (dect_parse_sfmt_ie_header(&ie, &mb) < 0)
+			return false;
+
+		if (ie.id == DECT_IE_PORTABLE_IDENTITY) {
+			if (ie.len < DECT_IE_PORTABLE_IDENTITY_MIN_SIZE ||
+			    ie.data[2] != (DECT_OCTET_GROUP_END |
+					   DECT_PORTABLE_ID_TYPE_IPUI) ||
+			    !(ie.data[3] & DECT_OCTET_GROUP_END))
+				return false;
+			return dect_parse_ipui(ipui, ie.data + 4,
+					       ie.data[3] & ~DECT_OCTET_GROUP_END);
+		}
+
+		mb.data += ie.len;
+		mb.len  -= ie.len;
+	}
+	return false;
+}
+
 static int dect_build_sfmt_ie_header(struct dect_sfmt_ie *dst, uint8_t id)
 {
 	if (id & DECT_SFMT_IE_FIXED_LEN) {
@@ -2640,37 +2708,33 @@ static int dect_build_sfmt_ie_header(struct dect_sfmt_ie *dst, uint8_t id)
 	return 0;
 }
 
-/**
- * Parse a S-Format encoded Information Element
- *
- * @param dh		libdect DECT handle
- * @param type		IE type
- * @param dst		result pointer to the allocated information element
- * @param ie		information element
- *
- * Parse a S-Format encoded Information Element and return an allocated IE
- * structure.
- *
- * @return #DECT_SFMT_OK on success or one of the @ref dect_sfmt_error
- * "S-Format error codes" on error. On success the dst parameter is set to
- * point to the allocated information element structure.
- */
-enum dect_sfmt_error
-dect_parse_sfmt_ie(const struct dect_handle *dh, uint8_t type,
-		   struct dect_ie_common **dst,
-		   const struct dect_sfmt_ie *ie)
+static enum dect_sfmt_error
+__dect_parse_sfmt_ie(const struct dect_handle *dh, uint8_t type,
+		     struct dect_ie_common **dst,
+		     const struct dect_sfmt_ie *ie,
+		     struct dect_ie_arena *arena)
 {
 	const struct dect_ie_handler *ieh;
+	size_t size;
 	int err = -1;
 
 	ieh = &dect_ie_handlers[ie->id];
 	if (ieh->parse == NULL)
 		goto err1;
 
-	if (ieh->size > 0) {
-		*dst = dect_ie_alloc(dh, ieh->size);
+	size = ieh->size;
+	if (ieh->payload > 0)
+		size = min(size, ieh->payload + ie->len);
+
+	if (size > 0) {
+		if (arena != NULL)
+			*dst = dect_ie_arena_ie_alloc(arena, size);
+		else
+			*dst = dect_ie_alloc(dh, size);
 		if (*dst == NULL)
 			goto err1;
+		if (size < ieh->size)
+			(*dst)->size = size;
 	}
 
 	sfmt_debug("  IE: <<%s>> id: %x len: %u dst: %p\n",
@@ -2679,20 +2743,44 @@ dect_parse_sfmt_ie(const struct dect_handle *dh, uint8_t type,
 	err = ieh->parse(dh, dst, ie);
 	if (err < 0)
 		goto err2;
-	if (ieh->dump != NULL)
+	if (ieh->dump != NULL && dect_debug_enabled(DECT_DEBUG_SFMT))
 		ieh->dump(*dst);
 	return 0;
 
 err2:
-	dect_free(dh, *dst);
+	if (ieh->size > 0 && !((*dst)->flags & DECT_IE_ARENA))
+		dect_free(dh, *dst);
 	*dst = NULL;
 err1:
 	sfmt_debug("smsg: IE parsing error\n");
 	return err;
 }
+
+/**
+ * Parse a S-Format encoded Information Element
+ *
+ * @param dh		libdect DECT handle
+ * @param type		IE type
+ * @param dst		result pointer to the allocated information element
+ * @param ie		information element
+ *
+ * Parse a S-Format encoded Information Element and return an allocated IE
+ * structure.
+ *
+ * @return #DECT_SFMT_OK on success or one of the @ref dect_sfmt_error
+ * "S-Format error codes" on error. On success the dst parameter is set to
+ * point to the allocated information element structure.
+ */
+enum dect_sfmt_error
+dect_parse_sfmt_ie(const struct dect_handle *dh, uint8_t type,
+		   struct dect_ie_common **dst,
+		   const struct dect_sfmt_ie *ie)
+{
+	return __dect_parse_sfmt_ie(dh, type, dst, ie, NULL);
+}
 EXPORT_SYMBOL(dect_parse_sfmt_ie);
 
-static void sfmt_debug_msg(const struct dect_sfmt_msg_desc *mdesc, const char *msg)
+static void __sfmt_debug_msg(const struct dect_sfmt_msg_desc *mdesc, const char *msg)
 {
 	char buf[strlen(mdesc->name) + 1];
 	unsigned int i;
@@ -2707,57 +2795,202 @@ static void sfmt_debug_msg(const struct dect_sfmt_msg_desc *mdesc, const char *m
 	sfmt_debug("%s {%s} message\n", msg, buf);
 }
 
-enum dect_sfmt_error dect_parse_sfmt_msg(const struct dect_handle *dh,
-					 const struct dect_sfmt_msg_desc *mdesc,
-					 struct dect_msg_common *_dst,
-					 struct dect_msg_buf *mb)
+#define sfmt_debug_msg(mdesc, msg)				\
+	do {							\
+		if (dect_debug_enabled(DECT_DEBUG_SFMT))	\
+			__sfmt_debug_msg(mdesc, msg);		\
+	} while (0)
+
+static enum dect_sfmt_ie_status
+__dect_rx_status(enum dect_cluster_modes mode,
+		 const struct dect_sfmt_ie_desc *desc)
 {
-	const struct dect_sfmt_ie_desc *desc = mdesc->ie;
-	struct dect_ie_common **dst = &_dst->ie[0];
+	if (mode == DECT_MODE_FP)
+		return desc->pp_fp;
+	else
+		return desc->fp_pp;
+}
+
+static void dect_sfmt_msg_index_build(const struct dect_sfmt_msg_desc *mdesc,
+				      struct dect_sfmt_msg_index *index)
+{
+	const struct dect_sfmt_ie_desc *desc;
+	struct dect_sfmt_msg_rx_index *rx;
+	unsigned int mode, offset, n, i;
+
+	offset = 0;
+	for (n = 0, desc = mdesc->ie; !(desc->flags & DECT_SFMT_IE_END);
+	     n++, desc++) {
+		dect_assert(n < DECT_SFMT_MSG_IE_MAX);
+		index->offset[n] = offset;
+		if (desc->type == DECT_IE_REPEAT_INDICATOR)
+			offset += sizeof(struct dect_ie_list);
+		else if (!(desc->flags & DECT_SFMT_IE_REPEAT))
+			offset += sizeof(struct dect_ie_common *);
+	}
+	index->offset[n] = offset;
+	index->count = n;
+
+	for (mode = DECT_MODE_FP; mode <= DECT_MODE_PP; mode++) {
+		rx = &index->rx[mode];
+		memset(rx->first, DECT_SFMT_MSG_IE_MAX, sizeof(rx->first));
+		rx->mandatory = 0;
+		rx->optional  = 0;
+
+		for (i = n; i-- > 0; ) {
+			desc = &mdesc->ie[i];
+			rx->next[i] = rx->first[desc->type];
+			rx->first[desc->type] = i;
+
+			switch (__dect_rx_status(mode, desc)) {
+			case DECT_SFMT_IE_MANDATORY:
+				rx->mandatory |= 1ULL << i;
+				break;
+			case DECT_SFMT_IE_OPTIONAL:
+				rx->optional |= 1ULL << i;
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	__atomic_store_n(&index->valid, true, __ATOMIC_RELEASE);
+}
+
+/* Serializes index construction of handles driven by different threads */
+static pthread_mutex_t dect_sfmt_msg_index_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const struct dect_sfmt_msg_index *
+dect_sfmt_msg_index(const struct dect_sfmt_msg_desc *mdesc)
+{
+	if (!__atomic_load_n(&mdesc->index->valid, __ATOMIC_ACQUIRE)) {
+		pthread_mutex_lock(&dect_sfmt_msg_index_lock);
+		if (!mdesc->index->valid)
+			dect_sfmt_msg_index_build(mdesc, mdesc->index);
+		pthread_mutex_unlock(&dect_sfmt_msg_index_lock);
+	}
+	return mdesc->index;
+}
+
+/* Find the first description of type @type at or after position @pos */
+static unsigned int dect_sfmt_rx_lookup(const struct dect_sfmt_msg_rx_index *rx,
+					uint8_t type, unsigned int pos,
+					uint64_t mask)
+{
+	unsigned int i;
+
+	for (i = rx->first[type]; i < DECT_SFMT_MSG_IE_MAX; i = rx->next[i]) {
+		if (i >= pos && (mask & (1ULL << i)))
+			break;
+	}
+	return i;
+}
+
+/*
+ * Locate the description matching an IE. Multi display and keypad IEs may
+ * also be received for optional single display and keypad IEs.
+ */
+static unsigned int dect_sfmt_rx_find(const struct dect_sfmt_msg_rx_index *rx,
+				      uint8_t id, unsigned int pos)
+{
+	unsigned int i, alt = DECT_SFMT_MSG_IE_MAX;
+
+	i = dect_sfmt_rx_lookup(rx, id, pos, ~0ULL);
+	if (id == DECT_IE_MULTI_DISPLAY)
+		alt = dect_sfmt_rx_lookup(rx, DECT_IE_SINGLE_DISPLAY, pos,
+					  rx->optional);
+	else if (id == DECT_IE_MULTI_KEYPAD)
+		alt = dect_sfmt_rx_lookup(rx, DECT_IE_SINGLE_KEYPAD, pos,
+					  rx->optional);
+	return min(i, alt);
+}
+
+static void dect_msg_ie_init_range(const struct dect_sfmt_msg_desc *mdesc,
+				   const struct dect_sfmt_msg_index *index,
+				   struct dect_msg_common *msg,
+				   unsigned int from, unsigned int to)
+{
+	for (; from <= to && from < index->count; from++)
+		dect_msg_ie_init(&mdesc->ie[from],
+				 (void *)msg->ie + index->offset[from]);
+}
+
+/* Bitmap of the descriptions in the range [@from, @to) */
+static uint64_t dect_sfmt_range_mask(unsigned int from, unsigned int to)
+{
+	uint64_t mask;
+
+	if (from >= to)
+		return 0;
+	mask  = to < 64 ? (1ULL << to) - 1 : ~0ULL;
+	mask &= ~((1ULL << from) - 1);
+	return mask;
+}
+
+/* IE descriptions which can be parsed lazily, excluding IE lists */
+static bool dect_sfmt_ie_lazy(const struct dect_sfmt_ie_desc *desc)
+{
+	return desc->type != DECT_IE_REPEAT_INDICATOR &&
+	       !(desc->flags & DECT_SFMT_IE_REPEAT);
+}
+
+static enum dect_sfmt_error
+__dect_parse_sfmt_msg(const struct dect_handle *dh,
+		      const struct dect_sfmt_msg_desc *mdesc,
+		      struct dect_msg_common *_dst,
+		      struct dect_msg_buf *mb,
+		      struct dect_sfmt_msg_view *view)
+{
+	const struct dect_sfmt_msg_index *index = dect_sfmt_msg_index(mdesc);
+	const struct dect_sfmt_msg_rx_index *rx;
+	const struct dect_sfmt_ie_desc *desc;
+	struct dect_ie_common **dst;
 	struct dect_sfmt_ie _ie[2], *ie;
+	enum dect_sfmt_error err;
+	unsigned int cur = 0, pos;
 	uint8_t idx = 0;
 
 	sfmt_debug_msg(mdesc, "parse");
 
-	dect_msg_ie_init(desc, dst);
+	rx = &index->rx[dh->mode == DECT_MODE_FP ? DECT_MODE_FP : DECT_MODE_PP];
+	_dst->arena = dect_ie_arena_alloc(dh);
+	_dst->view  = view;
+	if (view != NULL) {
+		view->data = mb->data;
+		memset(view->ie, 0, index->count * sizeof(view->ie[0]));
+	}
+
+	dect_msg_ie_init_range(mdesc, index, _dst, 0, 0);
 	while (mb->len > 0) {
 		/* Parse the next information element header */
 		ie = &_ie[idx++ % array_size(_ie)];;
-		if (dect_parse_sfmt_ie_header(ie, mb) < 0)
-			return -1;
+		if (dect_parse_sfmt_ie_header(ie, mb) < 0) {
+			err = -1;
+			goto err;
+		}
 
 		/* Locate a matching member in the description and apply
 		 * policy checks. */
-		while (1) {
-			if (desc->flags & DECT_SFMT_IE_END)
-				goto out;
-
-			switch (dect_rx_status(dh, desc)) {
-			case DECT_SFMT_IE_MANDATORY:
-				if (desc->type == ie->id)
-					goto found;
-				return DECT_SFMT_MANDATORY_IE_MISSING;
-			case DECT_SFMT_IE_NONE:
-				if (desc->type == ie->id)
-					return -1;
-				break;
-			case DECT_SFMT_IE_OPTIONAL:
-				if (desc->type == ie->id)
-					goto found;
-				if (desc->type == DECT_IE_SINGLE_DISPLAY &&
-				    ie->id == DECT_IE_MULTI_DISPLAY)
-					goto found;
-				if (desc->type == DECT_IE_SINGLE_KEYPAD &&
-				    ie->id == DECT_IE_MULTI_KEYPAD)
-					goto found;
-				break;
-			}
+		pos = dect_sfmt_rx_find(rx, ie->id, cur);
+		if (rx->mandatory & dect_sfmt_range_mask(cur, min(pos, (unsigned int)index->count))) {
+			err = DECT_SFMT_MANDATORY_IE_MISSING;
+			goto err;
+		}
+		dect_msg_ie_init_range(mdesc, index, _dst, cur + 1, pos);
+		if (pos >= index->count) {
+			cur = index->count;
+			goto out;
+		}
+		cur  = pos;
+		desc = &mdesc->ie[pos];
+		dst  = (void *)_dst->ie + index->offset[pos];
 
-			dst = dect_next_ie(desc, dst);
-			desc++;
-			dect_msg_ie_init(desc, dst);
+		if (__dect_rx_status(dh->mode, desc) == DECT_SFMT_IE_NONE) {
+			err = -1;
+			goto err;
 		}
-found:
+
 		/* Treat empty variable length IEs as absent */
 		if (!(ie->id & DECT_SFMT_IE_FIXED_LEN) && ie->len == 2) {
 			sfmt_debug("  IE: <<%s>> id: %x len: %u (empty)\n",
@@ -2765,30 +2998,222 @@ found:
 			goto next;
 		}
 
+		/* Defer parsing until the IE is resolved */
+		if (view != NULL && dect_sfmt_ie_lazy(desc)) {
+			view->ie[pos].id     = ie->id;
+			view->ie[pos].offset = ie->data - view->data;
+			view->ie[pos].len    = ie->len;
+			goto next;
+		}
+
 		/* Ignore corrupt optional IEs */
-		if (dect_parse_sfmt_ie(dh, desc->type, dst, ie) < 0 &&
-		    dect_rx_status(dh, desc) == DECT_SFMT_IE_MANDATORY)
-			return DECT_SFMT_MANDATORY_IE_ERROR;
+		if (__dect_parse_sfmt_ie(dh, desc->type, dst, ie, _dst->arena) < 0 &&
+		    rx->mandatory & (1ULL << pos)) {
+			err = DECT_SFMT_MANDATORY_IE_ERROR;
+			goto err;
+		}
 
 next:
 		dect_mbuf_pull(mb, ie->len);
 
-		dst = dect_next_ie(desc, dst);
-		desc++;
-		dect_msg_ie_init(desc, dst);
+		cur++;
+		dect_msg_ie_init_range(mdesc, index, _dst, cur, cur);
 	}
 out:
-	while (!(desc->flags & DECT_SFMT_IE_END)) {
-		if (dect_rx_status(dh, desc) == DECT_SFMT_IE_MANDATORY)
-			return DECT_SFMT_MANDATORY_IE_MISSING;
-		dst = dect_next_ie(desc, dst);
-		desc++;
-		dect_msg_ie_init(desc, dst);
+	if (rx->mandatory & dect_sfmt_range_mask(cur, index->count)) {
+		err = DECT_SFMT_MANDATORY_IE_MISSING;
+		goto err;
+	}
+	dect_msg_ie_init_range(mdesc, index, _dst, cur + 1, index->count);
+
+	return DECT_SFMT_OK;
+
+err:
+	if (_dst->arena != NULL) {
+		dect_ie_arena_free(_dst->arena);
+		_dst->arena = NULL;
+	}
+	_dst->view = NULL;
+	return err;
+}
+
+static enum dect_sfmt_error dect_sfmt_stats_parse(const struct dect_handle *dh,
+						  const struct dect_sfmt_msg_desc *mdesc,
+						  const struct dect_msg_buf *mb,
+						  enum dect_sfmt_error err)
+{
+	dect_trace3(sfmt_parse, mdesc->name, mb->len, err);
+
+	switch (err) {
+	case DECT_SFMT_MANDATORY_IE_MISSING:
+		dect_stats_inc(dh, lce, parse_ie_missing);
+		break;
+	case DECT_SFMT_MANDATORY_IE_ERROR:
+		dect_stats_inc(dh, lce, parse_ie_error);
+		break;
+	default:
+		break;
 	}
+	return err;
+}
+
+enum dect_sfmt_error dect_parse_sfmt_msg(const struct dect_handle *dh,
+					 const struct dect_sfmt_msg_desc *mdesc,
+					 struct dect_msg_common *dst,
+					 struct dect_msg_buf *mb)
+{
+	enum dect_sfmt_error err;
+	uint64_t start;
+
+	start = dect_stats_parse_begin(dh);
+	if (mdesc->parse != NULL)
+		err = mdesc->parse(dh, mdesc, dst, mb);
+	else
+		err = __dect_parse_sfmt_msg(dh, mdesc, dst, mb, NULL);
+	dect_stats_parse_end(dh, start);
+	return dect_sfmt_stats_parse(dh, mdesc, mb, err);
+}
 
+/*
+ * Specialized message codec helpers, see DECT_SFMT_MSG_DESC_CODEC()
+ */
+
+static enum dect_sfmt_error dect_sfmt_gen_next_ie(struct dect_msg_buf *mb,
+						  struct dect_sfmt_ie **ie)
+{
+	if (mb->len == 0) {
+		*ie = NULL;
+		return DECT_SFMT_OK;
+	}
+	if (dect_parse_sfmt_ie_header(*ie, mb) < 0)
+		return -1;
 	return DECT_SFMT_OK;
 }
 
+enum dect_sfmt_error dect_sfmt_gen_parse_begin(const struct dect_handle *dh,
+					       const struct dect_sfmt_msg_desc *mdesc,
+					       struct dect_msg_common *msg,
+					       struct dect_msg_buf *mb,
+					       struct dect_sfmt_ie **ie)
+{
+	sfmt_debug_msg(mdesc, "parse");
+
+	msg->arena = dect_ie_arena_alloc(dh);
+	msg->view  = NULL;
+	return dect_sfmt_gen_next_ie(mb, ie);
+}
+
+enum dect_sfmt_error dect_sfmt_gen_parse_msg_ie(const struct dect_handle *dh,
+						struct dect_msg_common *msg,
+						uint8_t type,
+						enum dect_sfmt_ie_status status,
+						struct dect_ie_common **dst,
+						struct dect_msg_buf *mb,
+						struct dect_sfmt_ie **ie)
+{
+	struct dect_sfmt_ie *cur = *ie;
+
+	/* Treat empty variable length IEs as absent */
+	if (!(cur->id & DECT_SFMT_IE_FIXED_LEN) && cur->len == 2) {
+		sfmt_debug("  IE: <<%s>> id: %x len: %u (empty)\n",
+			   dect_ie_handlers[cur->id].name, cur->id, cur->len);
+		goto next;
+	}
+
+	/* Ignore corrupt optional IEs */
+	if (__dect_parse_sfmt_ie(dh, type, dst, cur, msg->arena) < 0 &&
+	    status == DECT_SFMT_IE_MANDATORY)
+		return DECT_SFMT_MANDATORY_IE_ERROR;
+next:
+	dect_mbuf_pull(mb, cur->len);
+	return dect_sfmt_gen_next_ie(mb, ie);
+}
+
+void dect_sfmt_gen_parse_abort(struct dect_msg_common *msg)
+{
+	if (msg->arena != NULL) {
+		dect_ie_arena_free(msg->arena);
+		msg->arena = NULL;
+	}
+}
+
+void dect_sfmt_gen_build_begin(const struct dect_sfmt_msg_desc *mdesc)
+{
+	sfmt_debug_msg(mdesc, "build");
+}
+
+/**
+ * Lazily parse a S-Format encoded message
+ *
+ * @param dh		libdect DECT handle
+ * @param mdesc		message description
+ * @param dst		message structure
+ * @param mb		message buffer
+ * @param view		storage for the IE views
+ *
+ * Perform the structural checks of dect_parse_sfmt_msg(), but only record
+ * the location of each IE instead of parsing it. IE lists are parsed
+ * immediately. The remaining IEs are parsed on demand by dect_msg_ie(),
+ * which may only be used while the message buffer is unchanged. Content
+ * errors in mandatory IEs are reported by a NULL result on resolution.
+ */
+enum dect_sfmt_error dect_parse_sfmt_msg_lazy(const struct dect_handle *dh,
+					      const struct dect_sfmt_msg_desc *mdesc,
+					      struct dect_msg_common *dst,
+					      struct dect_msg_buf *mb,
+					      struct dect_sfmt_msg_view *view)
+{
+	return dect_sfmt_stats_parse(dh, mdesc, mb,
+				     __dect_parse_sfmt_msg(dh, mdesc, dst,
+							   mb, view));
+}
+
+/**
+ * Resolve an IE of a lazily parsed S-Format message
+ *
+ * @param dh		libdect DECT handle
+ * @param mdesc		message description
+ * @param msg		message structure
+ * @param ie		IE member of the message structure
+ *
+ * Parse the IE stored in @ie if it has been received and not been parsed
+ * before and return it.
+ */
+struct dect_ie_common *dect_msg_ie_resolve(const struct dect_handle *dh,
+					   const struct dect_sfmt_msg_desc *mdesc,
+					   struct dect_msg_common *msg,
+					   struct dect_ie_common **ie)
+{
+	const struct dect_sfmt_msg_index *index = dect_sfmt_msg_index(mdesc);
+	struct dect_sfmt_ie_view *v;
+	struct dect_sfmt_ie sie;
+	unsigned int offset, pos;
+
+	if (*ie != NULL || msg->view == NULL)
+		return *ie;
+
+	offset = (void *)ie - (void *)msg->ie;
+	for (pos = 0; pos < index->count; pos++) {
+		if (index->offset[pos] == offset &&
+		    dect_sfmt_ie_lazy(&mdesc->ie[pos]))
+			break;
+	}
+	if (pos == index->count)
+		return NULL;
+
+	v = &msg->view->ie[pos];
+	if (v->len == 0)
+		return NULL;
+
+	sie.id   = v->id;
+	sie.len  = v->len;
+	sie.data = (uint8_t *)msg->view->data + v->offset;
+	v->len   = 0;
+
+	__dect_parse_sfmt_ie(dh, mdesc->ie[pos].type, ie, &sie, msg->arena);
+	return *ie;
+}
+
 /**
  * Construct a S-Format encoded Information Element
  *
@@ -2828,7 +3253,7 @@ dect_build_sfmt_ie(const struct dect_handle *dh, uint8_t type,
 		goto err1;
 
 	sfmt_debug("  IE: <<%s>> id: %x %p\n", ieh->name, type, ie);
-	if (ieh->dump != NULL)
+	if (ieh->dump != NULL && dect_debug_enabled(DECT_DEBUG_SFMT))
 		ieh->dump(ie);
 
 	dst.data = mb->data + mb->len;
@@ -2860,21 +3285,51 @@ __dect_build_sfmt_ie(const struct dect_handle *dh,
 	return dect_build_sfmt_ie(dh, desc->type, mb, ie);
 }
 
-enum dect_sfmt_error dect_build_sfmt_msg(const struct dect_handle *dh,
-					 const struct dect_sfmt_msg_desc *mdesc,
-					 const struct dect_msg_common *_src,
-					 struct dect_msg_buf *mb)
+enum dect_sfmt_error dect_sfmt_gen_build_msg_ie(const struct dect_handle *dh,
+						uint8_t type,
+						enum dect_sfmt_ie_status status,
+						struct dect_msg_buf *mb,
+						const struct dect_ie_common *ie)
+{
+	if (ie == NULL) {
+		sfmt_debug("  IE <%s> id: %x missing\n",
+			   dect_ie_handlers[type].name, type);
+		return DECT_SFMT_MANDATORY_IE_MISSING;
+	}
+	if (status == DECT_SFMT_IE_NONE) {
+		sfmt_debug("  IE <%s> id: %x not allowed\n",
+			   dect_ie_handlers[type].name, type);
+		return DECT_SFMT_INVALID_IE;
+	}
+	return dect_build_sfmt_ie(dh, type, mb, ie);
+}
+
+static enum dect_sfmt_error
+__dect_build_sfmt_msg(const struct dect_handle *dh,
+		      const struct dect_sfmt_msg_desc *mdesc,
+		      const struct dect_sfmt_msg_tmpl *tmpl,
+		      const struct dect_msg_common *_src,
+		      struct dect_msg_buf *mb)
 {
 	const struct dect_sfmt_ie_desc *desc = mdesc->ie;
 	struct dect_ie_common * const *src = &_src->ie[0], **next, *rsrc;
 	struct dect_ie_list *iel;
 	enum dect_sfmt_error err;
+	unsigned int i;
 
 	sfmt_debug_msg(mdesc, "build");
 
 	while (!(desc->flags & DECT_SFMT_IE_END)) {
 		next = dect_next_ie(desc, (struct dect_ie_common **)src);
 
+		i = desc - mdesc->ie;
+		if (tmpl != NULL && tmpl->fixed & (1ULL << i)) {
+			memcpy(mb->data + mb->len, tmpl->data + tmpl->offset[i],
+			       tmpl->len[i]);
+			mb->len += tmpl->len[i];
+			goto next;
+		}
+
 		if (desc->type == DECT_IE_REPEAT_INDICATOR) {
 			iel = (struct dect_ie_list *)src;
 			if (iel->list == NULL) {
@@ -2917,6 +3372,100 @@ err_mandatory:
 	return DECT_SFMT_MANDATORY_IE_MISSING;
 }
 
+enum dect_sfmt_error dect_build_sfmt_msg(const struct dect_handle *dh,
+					 const struct dect_sfmt_msg_desc *mdesc,
+					 const struct dect_msg_common *src,
+					 struct dect_msg_buf *mb)
+{
+	enum dect_sfmt_error err;
+
+	if (mdesc->build != NULL)
+		err = mdesc->build(dh, mdesc, src, mb);
+	else
+		err = __dect_build_sfmt_msg(dh, mdesc, NULL, src, mb);
+	dect_trace3(sfmt_build, mdesc->name, mb->len, err);
+	return err;
+}
+
+/**
+ * Initialize a message template
+ *
+ * @param dh		libdect DECT handle
+ * @param tmpl		message template
+ * @param mdesc		message description
+ * @param msg		message containing the constant IEs
+ *
+ * Build the non-repeated IEs present in @msg and cache their encodings in
+ * the template. Repeated IEs can not be part of a template, nor can
+ * messages with more than #DECT_SFMT_MSG_IE_MAX IE descriptions.
+ *
+ * @return #DECT_SFMT_OK on success or one of the @ref dect_sfmt_error
+ * "S-Format error codes" on error.
+ */
+enum dect_sfmt_error dect_sfmt_msg_tmpl_init(const struct dect_handle *dh,
+					     struct dect_sfmt_msg_tmpl *tmpl,
+					     const struct dect_sfmt_msg_desc *mdesc,
+					     const struct dect_msg_common *msg)
+{
+	const struct dect_sfmt_ie_desc *desc = mdesc->ie;
+	struct dect_ie_common * const *src = &msg->ie[0];
+	DECT_DEFINE_MSG_BUF_ONSTACK(mb);
+	enum dect_sfmt_error err;
+	unsigned int i, len;
+
+	memset(tmpl, 0, sizeof(*tmpl));
+	while (!(desc->flags & DECT_SFMT_IE_END)) {
+		i = desc - mdesc->ie;
+		/* The bitmap and tables cover DECT_SFMT_MSG_IE_MAX descriptions */
+		if (i >= DECT_SFMT_MSG_IE_MAX)
+			return DECT_SFMT_INVALID_IE;
+		if (desc->type != DECT_IE_REPEAT_INDICATOR &&
+		    !(desc->flags & DECT_SFMT_IE_REPEAT) && *src != NULL) {
+			len = mb.len;
+			err = __dect_build_sfmt_ie(dh, desc, &mb, *src);
+			if (err != DECT_SFMT_OK)
+				return err;
+			if (mb.len > DECT_SFMT_MSG_TMPL_SIZE)
+				return DECT_SFMT_INVALID_IE;
+
+			tmpl->offset[i] = len;
+			tmpl->len[i]    = mb.len - len;
+			tmpl->fixed    |= 1ULL << i;
+		}
+		src = dect_next_ie(desc, (struct dect_ie_common **)src);
+		desc++;
+	}
+
+	memcpy(tmpl->data, mb.data, mb.len);
+	tmpl->size = mb.len;
+	tmpl->desc = mdesc;
+	return DECT_SFMT_OK;
+}
+
+/**
+ * Build a S-Format message from a template
+ *
+ * @param dh		libdect DECT handle
+ * @param tmpl		message template
+ * @param src		message containing the variable IEs
+ * @param mb		message buffer
+ *
+ * Build a message like dect_build_sfmt_msg(), copying the cached encodings
+ * of the template's constant IEs. The corresponding members of @src are
+ * ignored.
+ */
+enum dect_sfmt_error dect_build_sfmt_msg_tmpl(const struct dect_handle *dh,
+					      const struct dect_sfmt_msg_tmpl *tmpl,
+					      const struct dect_msg_common *src,
+					      struct dect_msg_buf *mb)
+{
+	enum dect_sfmt_error err;
+
+	err = __dect_build_sfmt_msg(dh, tmpl->desc, tmpl, src, mb);
+	dect_trace3(sfmt_build, tmpl->desc->name, mb->len, err);
+	return err;
+}
+
 void dect_msg_free(const struct dect_handle *dh,
 		   const struct dect_sfmt_msg_desc *mdesc,
 		   struct dect_msg_common *msg)
@@ -2936,6 +3485,12 @@ void dect_msg_free(const struct dect_handle *dh,
 		ie = next;
 		desc++;
 	}
+
+	if (msg->arena != NULL) {
+		dect_ie_arena_free(msg->arena);
+		msg->arena = NULL;
+	}
+	msg->view = NULL;
 }
 
 /** @} */
@@ -0,0 +1,265 @@
+/*
+ * libdect streaming scan sessions
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @addtogroup llme
+ * @{
+ *
+ * @defgroup scan Scan sessions
+ *
+ * Streaming collection of scan results for site surveys.
+ *
+ * A scan session captures the MAC_ME_INFO indications of a PP while it is
+ * active and restarts the scan after each of them, so the MAC keeps scanning
+ * for further FPs. Indications are deduplicated by PARI into a bounded table
+ * of results, repeated indications of an already known FP update its result.
+ * New and updated results are queued until the application reads them in
+ * batches using dect_scan_session_read(). The notification callback is only
+ * invoked when the queue becomes non-empty, not for every indication.
+ *
+ * While a session is active, the mac_me_info_ind callback of the LLME ops
+ * is not invoked.
+ *
+ * @{
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <libdect.h>
+#include <netlink.h>
+#include <utils.h>
+#include <timer.h>
+
+/**
+ * struct dect_scan_session - scan session
+ *
+ * @notify:	notification callback
+ * @priv:	notification callback data
+ * @size:	maximum number of results
+ * @used:	number of results
+ * @head:	first queued result
+ * @count:	number of queued results
+ * @dropped:	number of indications dropped because the table was full
+ * @queue:	queue of result indices
+ * @queued:	per result flag indicating whether it is queued
+ * @timer:	timer restarting the scan outside of the netlink receive path
+ * @results:	results
+ */
+struct dect_scan_session {
+	void			(*notify)(struct dect_handle *,
+					  struct dect_scan_session *, void *);
+	void			*priv;
+	unsigned int		size;
+	unsigned int		used;
+	unsigned int		head;
+	unsigned int		count;
+	uint32_t		dropped;
+	unsigned int		*queue;
+	bool			*queued;
+	struct dect_timer	*timer;
+	struct dect_scan_result	results[];
+};
+
+static struct dect_scan_result *
+dect_scan_session_lookup(struct dect_scan_session *ss,
+			 const struct dect_ari *pari)
+{
+	unsigned int i;
+
+	for (i = 0; i < ss->used; i++) {
+		if (!dect_ari_cmp(&ss->results[i].pari, pari))
+			return &ss->results[i];
+	}
+	return NULL;
+}
+
+static void dect_scan_session_timer(struct dect_handle *dh,
+				    struct dect_timer *timer)
+{
+	if (dect_llme_scan_req(dh) < 0)
+		dect_debug(DECT_DEBUG_NL, "scan session: SCAN-req failed: %s\n",
+			   strerror(errno));
+}
+
+/*
+ * Process a MAC_ME_INFO indication while a scan session is active. Returns
+ * true if the indication was consumed by the session.
+ */
+bool dect_scan_session_rcv(struct dect_handle *dh, const struct dect_ari *pari,
+			   const struct dect_fp_capabilities *fpc)
+{
+	struct dect_scan_session *ss = dh->scan_session;
+	struct dect_scan_result *res;
+	uint64_t now = dect_timer_now();
+	unsigned int idx;
+
+	if (ss == NULL)
+		return false;
+
+	if (pari == NULL)
+		goto rescan;
+
+	res = dect_scan_session_lookup(ss, pari);
+	if (res == NULL) {
+		if (ss->used == ss->size) {
+			ss->dropped++;
+			goto rescan;
+		}
+		res = &ss->results[ss->used++];
+		memset(res, 0, sizeof(*res));
+		res->pari	= *pari;
+		res->first_seen = now;
+	}
+	res->fpc	= *fpc;
+	res->last_seen	= now;
+	res->count++;
+
+	idx = res - ss->results;
+	if (!ss->queued[idx]) {
+		ss->queue[(ss->head + ss->count) % ss->size] = idx;
+		ss->queued[idx] = true;
+		if (ss->count++ == 0 && ss->notify != NULL)
+			ss->notify(dh, ss, ss->priv);
+	}
+
+rescan:
+	/* The session may have been stopped by the notification callback.
+	 * The indication is processed from the netlink receive callback, so
+	 * the scan is restarted from timer context to avoid reentering the
+	 * netlink socket. */
+	if (dh->scan_session == ss && !dect_timer_running(ss->timer))
+		dect_timer_start_ms(dh, ss->timer, 0);
+	return true;
+}
+
+/**
+ * Start a scan session
+ *
+ * @param dh		libdect DECT handle
+ * @param size		maximum number of distinct FPs
+ * @param notify	callback invoked when new results are queued, may be NULL
+ * @param priv		notification callback data
+ *
+ * Only a single scan session can be active per handle.
+ *
+ * @return the new scan session or NULL on error.
+ */
+struct dect_scan_session *
+dect_scan_session_start(struct dect_handle *dh, unsigned int size,
+			void (*notify)(struct dect_handle *dh,
+				       struct dect_scan_session *ss,
+				       void *priv),
+			void *priv)
+{
+	struct dect_scan_session *ss;
+
+	if (dh->scan_session != NULL || size == 0) {
+		errno = EINVAL;
+		goto err1;
+	}
+
+	ss = dect_zalloc(dh, sizeof(*ss) + size * sizeof(ss->results[0]) +
+			 size * sizeof(ss->queue[0]) +
+			 size * sizeof(ss->queued[0]));
+	if (ss == NULL)
+		goto err1;
+	ss->queue  = (void *)&ss->results[size];
+	ss->queued = (void *)&ss->queue[size];
+	ss->size   = size;
+	ss->notify = notify;
+	ss->priv   = priv;
+
+	ss->timer = dect_timer_alloc(dh);
+	if (ss->timer == NULL)
+		goto err2;
+	dect_timer_setup(ss->timer, dect_scan_session_timer, NULL);
+
+	dh->scan_session = ss;
+	if (dect_llme_scan_req(dh) < 0)
+		goto err3;
+	return ss;
+
+err3:
+	dh->scan_session = NULL;
+	dect_timer_free(dh, ss->timer);
+err2:
+	dect_free(dh, ss);
+err1:
+	return NULL;
+}
+EXPORT_SYMBOL(dect_scan_session_start);
+
+/**
+ * Stop a scan session
+ *
+ * @param dh		libdect DECT handle
+ * @param ss		scan session
+ *
+ * Release the scan session, including all unread results.
+ */
+void dect_scan_session_stop(struct dect_handle *dh, struct dect_scan_session *ss)
+{
+	dh->scan_session = NULL;
+	if (dect_timer_running(ss->timer))
+		dect_timer_stop(dh, ss->timer);
+	dect_timer_free(dh, ss->timer);
+	dect_free(dh, ss);
+}
+EXPORT_SYMBOL(dect_scan_session_stop);
+
+/**
+ * Read queued scan results
+ *
+ * @param ss		scan session
+ * @param results	array to store the results
+ * @param n		size of the array
+ *
+ * Copy up to @n new or updated results to @results in the order in which
+ * they were queued and remove them from the queue. A result is queued again
+ * when its FP is seen again.
+ *
+ * @return the number of results copied.
+ */
+unsigned int dect_scan_session_read(struct dect_scan_session *ss,
+				    struct dect_scan_result *results,
+				    unsigned int n)
+{
+	unsigned int i, idx;
+
+	for (i = 0; i < n && ss->count > 0; i++) {
+		idx = ss->queue[ss->head];
+		ss->head = (ss->head + 1) % ss->size;
+		ss->count--;
+
+		ss->queued[idx] = false;
+		results[i] = ss->results[idx];
+	}
+	return i;
+}
+EXPORT_SYMBOL(dect_scan_session_read);
+
+/**
+ * Get the number of FPs seen by a scan session
+ *
+ * @param ss		scan session
+ * @param dropped	number of indications dropped because the maximum number
+ *			of distinct FPs was reached, may be NULL
+ */
+unsigned int dect_scan_session_fp_count(const struct dect_scan_session *ss,
+					uint32_t *dropped)
+{
+	if (dropped != NULL)
+		*dropped = ss->dropped;
+	return ss->used;
+}
+EXPORT_SYMBOL(dect_scan_session_fp_count);
+
+/** @} */
+/** @} */
@@ -0,0 +1,565 @@
+/*
+ * libdect sharding
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @defgroup shard Sharding
+ *
+ * Distribution of protocol processing across handles driven by different
+ * threads.
+ *
+ * Shards opened using dect_shard_open() are handles of the same cluster as
+ * their primary handle, each maintaining its own data links, MM endpoints,
+ * calls and location table. The primary handle keeps the S-SAP listener and
+ * the B-SAP socket: accepted data links are held until their first message
+ * arrives, the hash of the portable identity contained in it determines the
+ * owning shard and the socket is handed over through the shard's message
+ * queue. Messages without an IPUI are assigned by the PMID of the link.
+ *
+ * Pages and broadcasts of shards are passed back to the primary handle
+ * through its message queue. Queues are bounded and signalled through an
+ * eventfd registered with the event ops of the receiving handle.
+ *
+ * Requests for a PP must be issued on the handle returned by
+ * dect_shard_lookup(). Shards must be opened before the first data link is
+ * established and are closed along with their primary handle, after their
+ * event loops have been stopped. When using the mock transport, all handles
+ * must be driven by the same thread.
+ *
+ * @{
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+
+#include <libdect.h>
+#include <identities.h>
+#include <utils.h>
+#include <io.h>
+#include <s_fmt.h>
+#include <timer.h>
+#include <lce.h>
+#include <shard.h>
+
+/**
+ * struct dect_shard_link - accepted data link waiting for its first message
+ *
+ * @list:	primary handle pending list node
+ * @dfd:	S-SAP socket
+ * @timer:	establishment timer
+ * @dlei:	data link endpoint identifier
+ * @mcp:	MAC connection parameters
+ */
+struct dect_shard_link {
+	struct list_head		list;
+	struct dect_fd			*dfd;
+	struct dect_timer		*timer;
+	struct sockaddr_dect_ssap	dlei;
+	struct dect_mac_conn_params	mcp;
+};
+
+static void dect_shard_process(struct dect_handle *dh,
+			       const struct dect_shard_msg *msg);
+
+/*
+ * Message queues
+ */
+
+static int dect_shard_post(struct dect_shard_queue *q,
+			   const struct dect_shard_msg *msg)
+{
+	uint64_t val = 1;
+	bool wakeup;
+
+	pthread_mutex_lock(&q->lock);
+	if (q->count == array_size(q->msgs)) {
+		q->drops++;
+		pthread_mutex_unlock(&q->lock);
+		errno = ENOBUFS;
+		return -1;
+	}
+	q->msgs[(q->head + q->count) % array_size(q->msgs)] = *msg;
+	wakeup = q->count++ == 0;
+	pthread_mutex_unlock(&q->lock);
+
+	if (wakeup && write(q->dfd->fd, &val, sizeof(val)) < 0 &&
+	    errno != EAGAIN)
+		return -1;
+	return 0;
+}
+
+static unsigned int dect_shard_queue_get(struct dect_shard_queue *q,
+					 struct dect_shard_msg *msgs,
+					 unsigned int max)
+{
+	unsigned int n;
+
+	pthread_mutex_lock(&q->lock);
+	for (n = 0; n < max && q->count > 0; n++) {
+		msgs[n] = q->msgs[q->head];
+		q->head = (q->head + 1) % array_size(q->msgs);
+		q->count--;
+	}
+	pthread_mutex_unlock(&q->lock);
+	return n;
+}
+
+static void dect_shard_queue_event(struct dect_handle *dh,
+				   struct dect_fd *dfd, uint32_t events)
+{
+	struct dect_shard_queue *q = dfd->data;
+	struct dect_shard_msg msgs[16];
+	unsigned int i, n;
+	uint64_t val;
+
+	if (read(dfd->fd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+		return;
+
+	do {
+		n = dect_shard_queue_get(q, msgs, array_size(msgs));
+		for (i = 0; i < n; i++)
+			dect_shard_process(dh, &msgs[i]);
+	} while (n > 0);
+}
+
+static int dect_shard_queue_init(struct dect_handle *dh,
+				 struct dect_shard_queue *q)
+{
+	pthread_mutex_init(&q->lock, NULL);
+
+	q->dfd = dect_fd_alloc(dh);
+	if (q->dfd == NULL)
+		goto err1;
+	q->dfd->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (q->dfd->fd < 0)
+		goto err2;
+	dect_fd_setup(q->dfd, dect_shard_queue_event, q);
+	if (dect_fd_register(dh, q->dfd, DECT_FD_READ) < 0)
+		goto err2;
+	return 0;
+
+err2:
+	dect_close(dh, q->dfd);
+err1:
+	pthread_mutex_destroy(&q->lock);
+	return -1;
+}
+
+static void dect_shard_queue_exit(struct dect_handle *dh,
+				  struct dect_shard_queue *q)
+{
+	struct dect_shard_msg msg;
+	struct dect_fd *dfd;
+
+	/* Release the sockets of data links never picked up */
+	while (dect_shard_queue_get(q, &msg, 1) > 0) {
+		if (msg.type != DECT_SHARD_MSG_LINK)
+			continue;
+		dfd = dect_fd_alloc(dh);
+		if (dfd == NULL) {
+			close(msg.link.fd);
+			continue;
+		}
+		dfd->fd        = msg.link.fd;
+		dfd->transport = msg.link.transport;
+		dect_close(dh, dfd);
+	}
+
+	dect_fd_unregister(dh, q->dfd);
+	dect_close(dh, q->dfd);
+	pthread_mutex_destroy(&q->lock);
+}
+
+/*
+ * Data link distribution
+ */
+
+static struct dect_shard *dect_shard_alloc(struct dect_handle *dh,
+					   struct dect_handle *primary)
+{
+	struct dect_shard *shard;
+
+	shard = dect_zalloc(dh, sizeof(*shard));
+	if (shard == NULL)
+		goto err1;
+	shard->primary = primary;
+	init_list_head(&shard->pending);
+
+	if (dect_shard_queue_init(dh, &shard->queue) < 0)
+		goto err2;
+	return shard;
+
+err2:
+	dect_free(dh, shard);
+err1:
+	return NULL;
+}
+
+static void dect_shard_link_free(struct dect_handle *dh,
+				 struct dect_shard_link *sl)
+{
+	list_del(&sl->list);
+	dect_timer_stop(dh, sl->timer);
+	dect_timer_free(dh, sl->timer);
+	dect_free(dh, sl);
+}
+
+static void dect_shard_link_release(struct dect_handle *dh,
+				    struct dect_shard_link *sl)
+{
+	dect_fd_unregister(dh, sl->dfd);
+	dect_close(dh, sl->dfd);
+	dect_shard_link_free(dh, sl);
+}
+
+static void dect_shard_link_timer(struct dect_handle *dh,
+				  struct dect_timer *timer)
+{
+	struct dect_shard_link *sl = timer->data;
+
+	dh->shard->stats.link_timeouts++;
+	dect_shard_link_release(dh, sl);
+}
+
+static void dect_shard_link_handoff(struct dect_handle *dh,
+				    struct dect_shard_link *sl,
+				    struct dect_handle *sh)
+{
+	struct dect_shard_msg msg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.type           = DECT_SHARD_MSG_LINK;
+	msg.link.fd        = sl->dfd->fd;
+	msg.link.transport = sl->dfd->transport;
+	msg.link.dlei      = sl->dlei;
+	msg.link.mcp       = sl->mcp;
+
+	if (dect_shard_post(&sh->shard->queue, &msg) < 0) {
+		dh->shard->stats.link_drops++;
+		dect_shard_link_release(dh, sl);
+		return;
+	}
+	dh->shard->stats.links++;
+
+	/* The socket is owned by the shard now */
+	dect_fd_unregister(dh, sl->dfd);
+	dect_free(dh, sl->dfd);
+	dect_shard_link_free(dh, sl);
+}
+
+static void dect_shard_link_event(struct dect_handle *dh,
+				  struct dect_fd *dfd, uint32_t events)
+{
+	struct dect_shard_link *sl = dfd->data;
+	struct dect_shard *shard = dh->shard;
+	struct dect_ipui ipui;
+	uint8_t buf[128];
+	struct iovec iov;
+	struct msghdr msg;
+	unsigned int n;
+	ssize_t len;
+
+	iov.iov_base = buf;
+	iov.iov_len  = sizeof(buf);
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov    = &iov;
+	msg.msg_iovlen = 1;
+
+	len = dect_fd_recvmsg(dfd, &msg, MSG_PEEK);
+	if (len < 0 && errno == EAGAIN)
+		return;
+	if (len <= 0)
+		return dect_shard_link_release(dh, sl);
+
+	if (dect_sfmt_peek_ipui(buf, len, &ipui))
+		n = dect_ipui_hash(&ipui, 16) % shard->nshards;
+	else {
+		n = sl->dlei.dect_pmid % shard->nshards;
+		shard->stats.links_by_pmid++;
+	}
+	dect_shard_link_handoff(dh, sl, shard->shards[n]);
+}
+
+void dect_shard_accept(struct dect_handle *dh, struct dect_fd *dfd,
+		       const struct sockaddr_dect_ssap *dlei,
+		       const struct dect_mac_conn_params *mcp)
+{
+	struct dect_shard_link *sl;
+
+	sl = dect_zalloc(dh, sizeof(*sl));
+	if (sl == NULL)
+		goto err1;
+	sl->dfd  = dfd;
+	sl->dlei = *dlei;
+	sl->mcp  = *mcp;
+
+	sl->timer = dect_timer_alloc(dh);
+	if (sl->timer == NULL)
+		goto err2;
+	dect_timer_setup(sl->timer, dect_shard_link_timer, sl);
+
+	dect_fd_setup(dfd, dect_shard_link_event, sl);
+	if (dect_fd_register(dh, dfd, DECT_FD_READ) < 0)
+		goto err3;
+
+	dect_timer_start(dh, sl->timer, DECT_DDL_ESTABLISH_SDU_TIMEOUT);
+	list_add_tail(&sl->list, &dh->shard->pending);
+	return;
+
+err3:
+	dect_timer_free(dh, sl->timer);
+err2:
+	dect_free(dh, sl);
+err1:
+	dect_close(dh, dfd);
+}
+
+static void dect_shard_adopt(struct dect_handle *dh,
+			     const struct dect_shard_msg *msg)
+{
+	struct dect_fd *dfd;
+
+	dfd = dect_fd_alloc(dh);
+	if (dfd == NULL) {
+		close(msg->link.fd);
+		return;
+	}
+	dfd->fd        = msg->link.fd;
+	dfd->transport = msg->link.transport;
+
+	if (dect_ddl_adopt(dh, dfd, &msg->link.dlei, &msg->link.mcp,
+			   false) < 0)
+		dect_close(dh, dfd);
+}
+
+/*
+ * Paging
+ */
+
+int dect_shard_page(const struct dect_handle *dh,
+		    const struct dect_msg_buf *mb,
+		    uint32_t tpui, bool fast_page)
+{
+	struct dect_handle *primary = dh->shard->primary;
+	struct dect_shard_msg msg;
+
+	if (mb->len > sizeof(msg.bcast.data)) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	memset(&msg, 0, sizeof(msg));
+	msg.type            = DECT_SHARD_MSG_PAGE;
+	msg.bcast.tpui      = tpui;
+	msg.bcast.fast_page = fast_page;
+	msg.bcast.len       = mb->len;
+	memcpy(msg.bcast.data, mb->data, mb->len);
+
+	return dect_shard_post(&primary->shard->queue, &msg);
+}
+
+int dect_shard_broadcast(const struct dect_handle *dh,
+			 const struct dect_msg_buf *mb,
+			 bool long_page, bool fast_page)
+{
+	struct dect_handle *primary = dh->shard->primary;
+	struct dect_shard_msg msg;
+
+	if (mb->len > sizeof(msg.bcast.data)) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	memset(&msg, 0, sizeof(msg));
+	msg.type            = DECT_SHARD_MSG_BROADCAST;
+	msg.bcast.long_page = long_page;
+	msg.bcast.fast_page = fast_page;
+	msg.bcast.len       = mb->len;
+	memcpy(msg.bcast.data, mb->data, mb->len);
+
+	if (dect_shard_post(&primary->shard->queue, &msg) < 0)
+		return -1;
+	return mb->len;
+}
+
+static void dect_shard_process(struct dect_handle *dh,
+			       const struct dect_shard_msg *msg)
+{
+	struct dect_msg_buf mb;
+
+	switch (msg->type) {
+	case DECT_SHARD_MSG_LINK:
+		return dect_shard_adopt(dh, msg);
+	case DECT_SHARD_MSG_PAGE:
+	case DECT_SHARD_MSG_BROADCAST:
+		mb.data = mb.head;
+		mb.len  = msg->bcast.len;
+		memcpy(mb.data, msg->bcast.data, mb.len);
+		break;
+	}
+
+	if (msg->type == DECT_SHARD_MSG_PAGE) {
+		dh->shard->stats.pages++;
+		dect_lce_page_queue(dh, &mb, msg->bcast.tpui,
+				    msg->bcast.fast_page);
+	} else {
+		dh->shard->stats.broadcasts++;
+		dect_lce_broadcast(dh, &mb, msg->bcast.long_page,
+				   msg->bcast.fast_page);
+	}
+}
+
+/*
+ * Shard handles
+ */
+
+/**
+ * Open a shard of a handle
+ *
+ * @param dh		libdect DECT handle in FP mode
+ * @param ops		DECT ops of the shard
+ *
+ * The shard is a handle of the same cluster, which may be driven by a
+ * different thread using its own event ops. Shards must be opened before
+ * the first data link is established.
+ *
+ * @return		a new libdect DECT handle or NULL on error.
+ */
+struct dect_handle *dect_shard_open(struct dect_handle *dh,
+				    struct dect_ops *ops)
+{
+	struct dect_handle *sh;
+
+	if (dh->mode != DECT_MODE_FP || dh->open_state != DECT_OPEN_READY ||
+	    dect_shard_member(dh)) {
+		errno = EINVAL;
+		goto err1;
+	}
+	if (!list_empty(&dh->links)) {
+		errno = EBUSY;
+		goto err1;
+	}
+
+	if (dh->shard == NULL) {
+		dh->shard = dect_shard_alloc(dh, NULL);
+		if (dh->shard == NULL)
+			goto err1;
+	}
+	if (dh->shard->nshards == array_size(dh->shard->shards)) {
+		errno = ENOSPC;
+		goto err1;
+	}
+
+	sh = dect_alloc_handle(ops);
+	if (sh == NULL)
+		goto err1;
+	sh->transport = dh->transport;
+	sh->index     = dh->index;
+	sh->mode      = dh->mode;
+	sh->pari      = dh->pari;
+	sh->fpc       = dh->fpc;
+
+	sh->shard = dect_shard_alloc(sh, dh);
+	if (sh->shard == NULL)
+		goto err2;
+	if (dect_lce_init(sh) < 0)
+		goto err3;
+	sh->open_state = DECT_OPEN_READY;
+
+	dh->shard->shards[dh->shard->nshards++] = sh;
+	return sh;
+
+err3:
+	dect_shard_queue_exit(sh, &sh->shard->queue);
+	dect_free(sh, sh->shard);
+err2:
+	dect_timer_wheel_exit(sh);
+	dect_stats_exit(sh);
+	dect_mem_exit(sh);
+	sh->ops->free(sh);
+err1:
+	return NULL;
+}
+EXPORT_SYMBOL(dect_shard_open);
+
+/**
+ * Look up the shard processing a PP
+ *
+ * @param dh		primary libdect DECT handle
+ * @param ipui		PP's IPUI
+ *
+ * @return		the shard handle, or the handle itself without shards.
+ */
+struct dect_handle *dect_shard_lookup(struct dect_handle *dh,
+				      const struct dect_ipui *ipui)
+{
+	struct dect_shard *shard = dh->shard;
+
+	if (!dect_shard_primary(dh) || shard->nshards == 0)
+		return dh;
+	return shard->shards[dect_ipui_hash(ipui, 16) % shard->nshards];
+}
+EXPORT_SYMBOL(dect_shard_lookup);
+
+/**
+ * Get the sharding statistics of a primary handle
+ *
+ * @param dh		primary libdect DECT handle
+ * @param stats		result pointer to the statistics
+ */
+void dect_shard_get_stats(struct dect_handle *dh,
+			  struct dect_shard_stats *stats)
+{
+	struct dect_shard *shard = dh->shard;
+
+	memset(stats, 0, sizeof(*stats));
+	if (!dect_shard_primary(dh))
+		return;
+
+	*stats = shard->stats;
+	pthread_mutex_lock(&shard->queue.lock);
+	stats->drops = shard->queue.drops;
+	pthread_mutex_unlock(&shard->queue.lock);
+}
+EXPORT_SYMBOL(dect_shard_get_stats);
+
+void dect_shard_exit(struct dect_handle *dh)
+{
+	struct dect_shard *shard = dh->shard, *ps;
+	struct dect_shard_link *sl, *next;
+	unsigned int i;
+
+	if (shard == NULL)
+		return;
+
+	if (shard->primary != NULL) {
+		ps = shard->primary->shard;
+		for (i = 0; i < ps->nshards; i++) {
+			if (ps->shards[i] != dh)
+				continue;
+			memmove(&ps->shards[i], &ps->shards[i + 1],
+				(ps->nshards - i - 1) * sizeof(ps->shards[0]));
+			ps->nshards--;
+			break;
+		}
+	} else {
+		while (shard->nshards > 0)
+			dect_close_handle(shard->shards[shard->nshards - 1]);
+		list_for_each_entry_safe(sl, next, &shard->pending, list)
+			dect_shard_link_release(dh, sl);
+	}
+
+	dect_shard_queue_exit(dh, &shard->queue);
+	dect_free(dh, shard);
+	dh->shard = NULL;
+}
+
+/** @} */
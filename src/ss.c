@@ -108,7 +108,8 @@ struct dect_ss_endpoint *dect_ss_endpoint_alloc(struct dect_handle *dh,
 {
 	struct dect_ss_endpoint *sse;
 
-	sse = dect_zalloc(dh, sizeof(*sse) + dh->ops->ss_ops->priv_size);
+	sse = dect_cache_alloc(dh, DECT_MEM_SS_ENDPOINT,
+			       sizeof(*sse) + dh->ops->ss_ops->priv_size);
 	if (sse == NULL)
 		goto err1;
 	sse->ipui = *ipui;
@@ -122,7 +123,7 @@ EXPORT_SYMBOL(dect_ss_endpoint_alloc);
 
 void dect_ss_endpoint_destroy(struct dect_handle *dh, struct dect_ss_endpoint *sse)
 {
-	dect_free(dh, sse);
+	dect_cache_free(dh, sse);
 }
 EXPORT_SYMBOL(dect_ss_endpoint_destroy);
 
@@ -0,0 +1,363 @@
+/*
+ * libdect runtime statistics
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @defgroup stats Statistics
+ *
+ * Per-handle runtime counters.
+ *
+ * libdect maintains counters for the LCE, the NWK layer protocols, the
+ * netlink interface and raw sockets. The counters are plain integers
+ * updated from the event loop, grouped by subsystem with each group
+ * occupying separate cache lines, and are always enabled. Applications can
+ * poll a consistent copy using dect_stats_snapshot() and clear them using
+ * dect_stats_reset().
+ *
+ * Procedure latencies of CC, MM and data link establishment are recorded
+ * into log-linear histograms based on the monotonic clock. Percentiles can
+ * be estimated from a snapshot using dect_stats_hist_quantile().
+ *
+ * The processing cost of each message type can be sampled using
+ * dect_stats_msg_cost_enable(): for a fraction of the received messages the
+ * time spent parsing and in the protocol receive handler is measured, for a
+ * fraction of the transmitted messages the time spent building them. The
+ * results are aggregated per protocol discriminator and message type and
+ * retrieved using dect_stats_msg_cost_snapshot().
+ *
+ * @{
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include <libdect.h>
+#include <utils.h>
+
+int dect_stats_init(struct dect_handle *dh)
+{
+	/* dect_zalloc() doesn't guarantee cache line alignment */
+	dh->stats_mem = dect_zalloc(dh, sizeof(*dh->stats) +
+					DECT_STATS_ALIGN - 1);
+	if (dh->stats_mem == NULL)
+		return -1;
+	dh->stats = (void *)(((unsigned long)dh->stats_mem +
+			      DECT_STATS_ALIGN - 1) & ~(DECT_STATS_ALIGN - 1UL));
+	return 0;
+}
+
+void dect_stats_exit(struct dect_handle *dh)
+{
+	dect_stats_msg_cost_enable(dh, 0);
+	dect_free(dh, dh->stats_mem);
+}
+
+/* Monotonic timestamp in microseconds, never zero */
+uint64_t dect_stats_clock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000 + 1;
+}
+
+static unsigned int dect_stats_hist_bucket(uint64_t val)
+{
+	unsigned int exp, bucket;
+
+	if (val < (1 << DECT_STATS_HIST_SUB_BITS))
+		return val;
+
+	exp = 63 - __builtin_clzll(val);
+	bucket  = (exp - DECT_STATS_HIST_SUB_BITS + 1) << DECT_STATS_HIST_SUB_BITS;
+	bucket |= (val >> (exp - DECT_STATS_HIST_SUB_BITS)) &
+		  ((1 << DECT_STATS_HIST_SUB_BITS) - 1);
+	return min(bucket, DECT_STATS_HIST_BUCKETS - 1U);
+}
+
+/* Record the latency of a procedure started at @start, if it was started */
+void dect_stats_latency(const struct dect_handle *dh,
+			enum dect_stats_latencies latency, uint64_t start)
+{
+	struct dect_stats_hist *hist = &dh->stats->latency[latency];
+	uint64_t val;
+
+	if (start == 0)
+		return;
+
+	val = dect_stats_clock() - start;
+	hist->count++;
+	hist->sum += val;
+	hist->max  = max(hist->max, val);
+	hist->buckets[dect_stats_hist_bucket(val)]++;
+}
+
+/**
+ * Get the largest value counted in a histogram bucket
+ *
+ * @param bucket	bucket index
+ *
+ * @return the upper bound of the bucket in microseconds.
+ */
+uint64_t dect_stats_hist_bucket_max(unsigned int bucket)
+{
+	unsigned int group, shift;
+	uint64_t sub;
+
+	if (bucket < (1 << DECT_STATS_HIST_SUB_BITS))
+		return bucket;
+	if (bucket >= DECT_STATS_HIST_BUCKETS - 1)
+		return UINT64_MAX;
+
+	group = bucket >> DECT_STATS_HIST_SUB_BITS;
+	sub   = bucket & ((1 << DECT_STATS_HIST_SUB_BITS) - 1);
+	shift = group - 1;
+	return (((1 << DECT_STATS_HIST_SUB_BITS) + sub + 1) << shift) - 1;
+}
+EXPORT_SYMBOL(dect_stats_hist_bucket_max);
+
+/**
+ * Estimate a quantile of a latency histogram
+ *
+ * @param hist		latency histogram
+ * @param permille	quantile in 1/1000, f.i. 990 for the 99th percentile
+ *
+ * @return the upper bound in microseconds of the bucket containing the
+ * quantile, limited to the maximum sample, or 0 if the histogram is empty.
+ */
+uint64_t dect_stats_hist_quantile(const struct dect_stats_hist *hist,
+				  unsigned int permille)
+{
+	uint64_t rank, cnt = 0;
+	unsigned int i;
+
+	if (hist->count == 0)
+		return 0;
+
+	rank = (hist->count * min(permille, 1000U) + 999) / 1000;
+	for (i = 0; i < DECT_STATS_HIST_BUCKETS; i++) {
+		cnt += hist->buckets[i];
+		if (cnt >= rank && cnt > 0)
+			break;
+	}
+	return min(dect_stats_hist_bucket_max(i), hist->max);
+}
+EXPORT_SYMBOL(dect_stats_hist_quantile);
+
+/**
+ * struct dect_msg_cost - message cost sampling state
+ *
+ * @interval:	sampling interval in messages
+ * @rx_count:	received messages until the next sample
+ * @tx_count:	transmitted messages until the next sample
+ * @cur:	cost entry of the received message being sampled
+ * @nested:	parse and build time within the receive handler being sampled
+ * @costs:	message cost table
+ */
+struct dect_msg_cost {
+	unsigned int			interval;
+	unsigned int			rx_count;
+	unsigned int			tx_count;
+	struct dect_stats_msg_cost	*cur;
+	uint64_t			nested;
+	struct dect_stats_msg_costs	costs;
+};
+
+/* Monotonic timestamp in nanoseconds, never zero */
+static uint64_t dect_stats_clock_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec + 1;
+}
+
+static struct dect_stats_msg_cost *
+dect_stats_msg_cost(struct dect_msg_cost *mc, uint8_t pd, uint8_t type)
+{
+	if (pd >= DECT_STATS_MSG_COST_PDS || type >= DECT_STATS_MSG_COST_TYPES)
+		return NULL;
+	return &mc->costs.msg[pd][type];
+}
+
+/* Start sampling the receive handler of a message, returns 0 if not sampled */
+uint64_t dect_stats_rcv_begin(const struct dect_handle *dh,
+			      uint8_t pd, uint8_t type)
+{
+	struct dect_msg_cost *mc = dh->msg_cost;
+	struct dect_stats_msg_cost *cost;
+
+	if (mc == NULL || mc->cur != NULL || --mc->rx_count > 0)
+		return 0;
+	mc->rx_count = mc->interval;
+
+	cost = dect_stats_msg_cost(mc, pd, type);
+	if (cost == NULL)
+		return 0;
+	mc->cur    = cost;
+	mc->nested = 0;
+	return dect_stats_clock_ns();
+}
+
+void dect_stats_rcv_end(const struct dect_handle *dh, uint64_t start)
+{
+	struct dect_msg_cost *mc = dh->msg_cost;
+	uint64_t val;
+
+	/* Sampling may have been disabled by the receive handler */
+	if (start == 0 || mc == NULL || mc->cur == NULL)
+		return;
+
+	val = dect_stats_clock_ns() - start;
+	mc->cur->rx_samples++;
+	mc->cur->rcv_ns += val - min(val, mc->nested);
+	mc->cur = NULL;
+}
+
+/* Parsing is only measured within a sampled receive handler */
+uint64_t dect_stats_parse_begin(const struct dect_handle *dh)
+{
+	const struct dect_msg_cost *mc = dh->msg_cost;
+
+	if (mc == NULL || mc->cur == NULL)
+		return 0;
+	return dect_stats_clock_ns();
+}
+
+void dect_stats_parse_end(const struct dect_handle *dh, uint64_t start)
+{
+	struct dect_msg_cost *mc = dh->msg_cost;
+	uint64_t val;
+
+	if (start == 0 || mc == NULL || mc->cur == NULL)
+		return;
+
+	val = dect_stats_clock_ns() - start;
+	mc->cur->parse_ns += val;
+	mc->nested += val;
+}
+
+/* Building is measured for sampled messages and within a sampled receive
+ * handler, so the handler time excludes responses. */
+uint64_t dect_stats_build_begin(const struct dect_handle *dh)
+{
+	struct dect_msg_cost *mc = dh->msg_cost;
+
+	if (mc == NULL)
+		return 0;
+	if (--mc->tx_count > 0 && mc->cur == NULL)
+		return 0;
+	if (mc->tx_count == 0)
+		mc->tx_count = mc->interval;
+	return dect_stats_clock_ns();
+}
+
+void dect_stats_build_end(const struct dect_handle *dh, uint64_t start,
+			  uint8_t pd, uint8_t type)
+{
+	struct dect_msg_cost *mc = dh->msg_cost;
+	struct dect_stats_msg_cost *cost;
+	uint64_t val;
+
+	if (start == 0 || mc == NULL)
+		return;
+
+	val = dect_stats_clock_ns() - start;
+	if (mc->cur != NULL)
+		mc->nested += val;
+
+	cost = dect_stats_msg_cost(mc, pd, type);
+	if (cost == NULL)
+		return;
+	cost->tx_samples++;
+	cost->build_ns += val;
+}
+
+/**
+ * Enable sampling of the message processing cost
+ *
+ * @param dh		libdect DECT handle
+ * @param interval	sample one in @p interval messages, 0 to disable
+ *
+ * Enabling sampling resets the message cost table, disabling it discards
+ * the table.
+ *
+ * @return 0 on success or -1 on error.
+ */
+int dect_stats_msg_cost_enable(struct dect_handle *dh, unsigned int interval)
+{
+	struct dect_msg_cost *mc = dh->msg_cost;
+
+	if (interval == 0) {
+		if (mc != NULL) {
+			dect_free(dh, mc);
+			dh->msg_cost = NULL;
+		}
+		return 0;
+	}
+
+	if (mc == NULL) {
+		mc = dect_zalloc(dh, sizeof(*mc));
+		if (mc == NULL)
+			return -1;
+		dh->msg_cost = mc;
+	} else
+		memset(&mc->costs, 0, sizeof(mc->costs));
+
+	mc->interval = interval;
+	mc->rx_count = interval;
+	mc->tx_count = interval;
+	return 0;
+}
+EXPORT_SYMBOL(dect_stats_msg_cost_enable);
+
+/**
+ * Get a snapshot of the message processing cost table
+ *
+ * @param dh		libdect DECT handle
+ * @param costs		buffer to store the message cost table
+ *
+ * The table is empty if sampling is not enabled.
+ */
+void dect_stats_msg_cost_snapshot(const struct dect_handle *dh,
+				  struct dect_stats_msg_costs *costs)
+{
+	if (dh->msg_cost == NULL)
+		memset(costs, 0, sizeof(*costs));
+	else
+		*costs = dh->msg_cost->costs;
+}
+EXPORT_SYMBOL(dect_stats_msg_cost_snapshot);
+
+/**
+ * Get a snapshot of the runtime statistics
+ *
+ * @param dh		libdect DECT handle
+ * @param stats		buffer to store the statistics
+ */
+void dect_stats_snapshot(const struct dect_handle *dh, struct dect_stats *stats)
+{
+	*stats = *dh->stats;
+}
+EXPORT_SYMBOL(dect_stats_snapshot);
+
+/**
+ * Reset all runtime statistics to zero
+ *
+ * Also resets the message cost table.
+ *
+ * @param dh		libdect DECT handle
+ */
+void dect_stats_reset(struct dect_handle *dh)
+{
+	memset(dh->stats, 0, sizeof(*dh->stats));
+	if (dh->msg_cost != NULL)
+		memset(&dh->msg_cost->costs, 0, sizeof(dh->msg_cost->costs));
+}
+EXPORT_SYMBOL(dect_stats_reset);
+
+/** @} */
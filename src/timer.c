@@ -22,6 +22,20 @@
  * the application's event handler. When a timeout occurs, the function
  * dect_timer_run() must be invoked.
  *
+ * Alternatively, applications can leave dect_event_ops::start_timer() and
+ * dect_event_ops::stop_timer() unset, in which case libdect keeps its timers
+ * on an internal hierarchical timer wheel with millisecond resolution.
+ * Starting and stopping a timer then doesn't involve the application, which
+ * only needs to wait for at most dect_timers_next_expiry() milliseconds in
+ * its event loop and call dect_timers_run() afterwards.
+ *
+ * Timers of the coarse slack class, used by libdect for keypad, release and
+ * statistics timers, may expire late by up to the slack window set using
+ * dect_timer_set_slack(). Their expiry is rounded up to a multiple of the
+ * window, so coarse timers expiring within the same window share a single
+ * wakeup, which reduces the wakeups of idle battery powered PPs. Protocol
+ * timers are exact, the window defaults to zero.
+ *
  * Each libdect timer contains a storage area of the size specified in
  * dect_event_ops::timer_priv_size, which can be used by the application to
  * associate data with the timer. The function dect_timer_priv() returns
@@ -30,18 +44,26 @@
  * @{
  */
 
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
 #include <sys/time.h>
+#include <sys/timerfd.h>
 
 #include <libdect.h>
 #include <utils.h>
 #include <timer.h>
+#include <ind.h>
+#include <trace.h>
 
 struct dect_timer *dect_timer_alloc(const struct dect_handle *dh)
 {
 	struct dect_timer *timer;
 
-	timer = dect_zalloc(dh, sizeof(struct dect_timer) +
-			    dh->ops->event_ops->timer_priv_size);
+	timer = dect_zalloc_type(dh, DECT_MEM_TIMER, sizeof(struct dect_timer) +
+				 dh->ops->event_ops->timer_priv_size);
 	if (timer != NULL)
 		timer->state = DECT_TIMER_STOPPED;
 
@@ -51,12 +73,54 @@ EXPORT_SYMBOL(dect_timer_alloc);
 
 void dect_timer_free(const struct dect_handle *dh, struct dect_timer *timer)
 {
-	if (timer != NULL)
+	if (timer != NULL) {
+		/* Lazily cancelled timers are still registered */
+		if (timer->state == DECT_TIMER_CANCELLED)
+			dect_timer_stop(dh, timer);
 		dect_assert(timer->state == DECT_TIMER_STOPPED);
+	}
 	dect_free(dh, timer);
 }
 EXPORT_SYMBOL(dect_timer_free);
 
+/**
+ * Get the storage size of a timer including the user private storage area
+ *
+ * @param dh		libdect DECT handle
+ */
+size_t dect_timer_size(const struct dect_handle *dh)
+{
+	return align(sizeof(struct dect_timer) +
+		     dh->ops->event_ops->timer_priv_size,
+		     __alignof__(uint64_t));
+}
+
+/**
+ * Initialize a timer embedded in the storage area of another object
+ *
+ * @param dh		libdect DECT handle
+ * @param storage	zeroed timer storage area
+ * @param index		index of the timer within the storage area
+ * @param cb		timer callback
+ * @param data		timer data
+ *
+ * The storage area must provide dect_timer_size() bytes for each timer.
+ * Embedded timers are released together with the containing object and
+ * must not be passed to dect_timer_free().
+ */
+struct dect_timer *dect_timer_embed(const struct dect_handle *dh,
+				    void *storage, unsigned int index,
+				    void (*cb)(struct dect_handle *,
+					       struct dect_timer *),
+				    void *data)
+{
+	struct dect_timer *timer = storage + index * dect_timer_size(dh);
+
+	timer->state = DECT_TIMER_STOPPED;
+	dect_timer_setup(timer, cb, data);
+	return timer;
+}
+
 /**
  * Get a pointer to the private data area from a DECT timer
  *
@@ -78,36 +142,356 @@ void dect_timer_setup(struct dect_timer *timer,
 		      void (*cb)(struct dect_handle *, struct dect_timer *),
 		      void *data)
 {
-	dect_assert(timer->state == DECT_TIMER_STOPPED);
+	dect_assert(timer->state != DECT_TIMER_RUNNING);
 	timer->callback	= cb;
 	timer->data	= data;
 }
 EXPORT_SYMBOL(dect_timer_setup);
 
+/* Monotonic time in milliseconds */
+uint64_t dect_timer_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+static void dect_timer_wheel_add(struct dect_timer_wheel *tw,
+				 struct dect_timer *timer)
+{
+	uint64_t delta = timer->expires - tw->clk;
+	unsigned int level;
+
+	if (timer->expires < tw->clk) {
+		/* Already expired, run on the next tick */
+		list_add_tail(&timer->list,
+			      &tw->vec[0][tw->clk & DECT_TIMER_WHEEL_MASK]);
+		return;
+	}
+
+	if (delta > DECT_TIMER_WHEEL_MAX) {
+		timer->expires = tw->clk + DECT_TIMER_WHEEL_MAX;
+		delta = DECT_TIMER_WHEEL_MAX;
+	}
+
+	for (level = 0; level < DECT_TIMER_WHEEL_LEVELS - 1; level++) {
+		if (delta < 1ULL << ((level + 1) * DECT_TIMER_WHEEL_BITS))
+			break;
+	}
+
+	list_add_tail(&timer->list,
+		      &tw->vec[level][(timer->expires >>
+				       (level * DECT_TIMER_WHEEL_BITS)) &
+				      DECT_TIMER_WHEEL_MASK]);
+}
+
+/* Move the timers of the current slot of a level to the lower levels */
+static unsigned int dect_timer_wheel_cascade(struct dect_timer_wheel *tw,
+					     unsigned int level)
+{
+	unsigned int index = (tw->clk >> (level * DECT_TIMER_WHEEL_BITS)) &
+			     DECT_TIMER_WHEEL_MASK;
+	struct dect_timer *timer, *next;
+	struct list_head list;
+
+	init_list_head(&list);
+	list_splice_init(&tw->vec[level][index], &list);
+	list_for_each_entry_safe(timer, next, &list, list)
+		dect_timer_wheel_add(tw, timer);
+	return index;
+}
+
+static void dect_timer_wheel_start(struct dect_timer_wheel *tw,
+				   struct dect_timer *timer,
+				   uint64_t now, unsigned int timeout)
+{
+	/* Catch up the clock of an idle wheel so the timer is placed
+	 * relative to the current time */
+	if (tw->count == 0)
+		tw->clk = now;
+
+	timer->expires = now + timeout;
+	dect_timer_wheel_add(tw, timer);
+	tw->count++;
+}
+
+static void dect_timer_wheel_stop(struct dect_timer_wheel *tw,
+				  struct dect_timer *timer)
+{
+	list_del(&timer->list);
+	tw->count--;
+}
+
+int dect_timer_wheel_init(struct dect_handle *dh)
+{
+	struct dect_timer_wheel *tw;
+	unsigned int level, i;
+
+	if (dh->ops->event_ops->start_timer != NULL)
+		return 0;
+
+	tw = dect_malloc_type(dh, DECT_MEM_TIMER, sizeof(*tw));
+	if (tw == NULL)
+		return -1;
+
+	tw->clk   = dect_timer_now();
+	tw->count = 0;
+	for (level = 0; level < DECT_TIMER_WHEEL_LEVELS; level++) {
+		for (i = 0; i < DECT_TIMER_WHEEL_SIZE; i++)
+			init_list_head(&tw->vec[level][i]);
+	}
+
+	dh->timer_wheel = tw;
+	return 0;
+}
+
+void dect_timer_wheel_exit(struct dect_handle *dh)
+{
+	dect_free(dh, dh->timer_wheel);
+	dh->timer_wheel = NULL;
+}
+
+/**
+ * Get the time until the next expiry of an internal timer
+ *
+ * @param dh		libdect DECT handle
+ *
+ * @return the timeout in milliseconds, suitable for poll(), or -1 if no
+ * timers are running.
+ */
+int dect_timers_next_expiry(const struct dect_handle *dh)
+{
+	const struct dect_timer_wheel *tw = dh->timer_wheel;
+	const struct dect_timer *timer;
+	uint64_t expires = ~0ULL, now;
+	unsigned int level, index, i;
+
+	if (tw == NULL || tw->count == 0)
+		return -1;
+
+	/* All timers of a level 0 slot expire at the same time */
+	for (i = 0; i < DECT_TIMER_WHEEL_SIZE; i++) {
+		index = (tw->clk + i) & DECT_TIMER_WHEEL_MASK;
+		if (!list_empty(&tw->vec[0][index])) {
+			expires = tw->clk + i;
+			goto out;
+		}
+	}
+
+	/* Otherwise the first occupied slot of each higher level contains
+	 * the earliest timers of that level */
+	for (level = 1; level < DECT_TIMER_WHEEL_LEVELS; level++) {
+		index = tw->clk >> (level * DECT_TIMER_WHEEL_BITS);
+		for (i = 1; i <= DECT_TIMER_WHEEL_SIZE; i++) {
+			const struct list_head *head;
+
+			head = &tw->vec[level][(index + i) & DECT_TIMER_WHEEL_MASK];
+			if (list_empty(head))
+				continue;
+			list_for_each_entry(timer, head, list)
+				expires = min(expires, timer->expires);
+			break;
+		}
+	}
+out:
+	now = dect_timer_now();
+	if (expires <= now)
+		return 0;
+	return min(expires - now, (uint64_t)INT_MAX);
+}
+EXPORT_SYMBOL(dect_timers_next_expiry);
+
+/**
+ * Run expired internal timers
+ *
+ * @param dh		libdect DECT handle
+ *
+ * Advance the timer wheel to the current time and invoke the callbacks of
+ * all expired timers.
+ */
+void dect_timers_run(struct dect_handle *dh)
+{
+	struct dect_timer_wheel *tw = dh->timer_wheel;
+	struct dect_timer *timer;
+	struct list_head list;
+	unsigned int level;
+	uint64_t now;
+
+	if (tw == NULL)
+		return;
+
+	now = dect_timer_now();
+	init_list_head(&list);
+	while (tw->clk <= now && tw->count > 0) {
+		for (level = 1; level < DECT_TIMER_WHEEL_LEVELS; level++) {
+			if (tw->clk & ((1ULL << (level * DECT_TIMER_WHEEL_BITS)) - 1))
+				break;
+			if (dect_timer_wheel_cascade(tw, level) != 0)
+				break;
+		}
+
+		list_splice_init(&tw->vec[0][tw->clk & DECT_TIMER_WHEEL_MASK],
+				 &list);
+		tw->clk++;
+
+		/* Callbacks may start and stop arbitrary timers, including
+		 * the ones remaining on the list */
+		while (!list_empty(&list)) {
+			timer = list_first_entry(&list, struct dect_timer, list);
+			dect_timer_wheel_stop(tw, timer);
+			dect_timer_run(dh, timer);
+		}
+	}
+
+	if (tw->count == 0)
+		tw->clk = now;
+}
+EXPORT_SYMBOL(dect_timers_run);
+
+/**
+ * Set the slack window of coarse timers
+ *
+ * @param dh		libdect DECT handle
+ * @param slack		slack window in milliseconds, 0 to disable
+ *
+ * Applies to timers started afterwards.
+ */
+void dect_timer_set_slack(struct dect_handle *dh, unsigned int slack)
+{
+	dh->timer_slack = slack;
+}
+EXPORT_SYMBOL(dect_timer_set_slack);
+
+/**
+ * Set the slack class of a timer
+ *
+ * @param timer		DECT timer
+ * @param slack		slack class
+ */
+void dect_timer_set_slack_class(struct dect_timer *timer,
+				enum dect_timer_slack_classes slack)
+{
+	timer->slack = slack;
+}
+EXPORT_SYMBOL(dect_timer_set_slack_class);
+
+/* Round the expiry of a coarse timer up to the next multiple of the window */
+static unsigned int dect_timer_slack(const struct dect_handle *dh,
+				     const struct dect_timer *timer,
+				     uint64_t now, unsigned int timeout)
+{
+	uint64_t expires;
+
+	if (timer->slack == DECT_TIMER_SLACK_EXACT ||
+	    dh->timer_slack == 0 || timeout == 0)
+		return timeout;
+
+	expires = now + timeout + dh->timer_slack - 1;
+	expires -= expires % dh->timer_slack;
+	return expires - now;
+}
+
+/**
+ * Start a timer
+ *
+ * @param dh		libdect DECT handle
+ * @param timer		DECT timer
+ * @param timeout	timeout in seconds
+ */
 void dect_timer_start(const struct dect_handle *dh,
 		      struct dect_timer *timer, unsigned int timeout)
 {
-	struct timeval tv = {
-		.tv_sec = timeout,
-	};
+	dect_timer_start_ms(dh, timer, timeout * 1000);
+}
+EXPORT_SYMBOL(dect_timer_start);
+
+/**
+ * Start a timer with millisecond resolution
+ *
+ * @param dh		libdect DECT handle
+ * @param timer		DECT timer
+ * @param timeout	timeout in milliseconds
+ */
+void dect_timer_start_ms(const struct dect_handle *dh,
+			 struct dect_timer *timer, unsigned int timeout)
+{
+	uint64_t now, expires;
+	struct timeval tv;
 
-	/* Cancel timer if it is already running */
-	if (timer->state == DECT_TIMER_RUNNING)
-		dh->ops->event_ops->stop_timer(dh, timer);
+	dect_trace2(timer_start, timer, timeout);
+	now = dect_timer_now();
+	timeout = dect_timer_slack(dh, timer, now, timeout);
+
+	if (dh->timer_wheel != NULL) {
+		if (timer->state == DECT_TIMER_RUNNING)
+			dect_timer_stop(dh, timer);
+		timer->state = DECT_TIMER_RUNNING;
+		dect_timer_wheel_start(dh->timer_wheel, timer, now, timeout);
+		return;
+	}
+
+	/* A timer which is still registered for an earlier expiry is only
+	 * updated, dect_timer_run() rearms it for the remaining time */
+	expires = now + timeout;
+	if (timer->state != DECT_TIMER_STOPPED) {
+		if (expires >= timer->armed) {
+			timer->state   = DECT_TIMER_RUNNING;
+			timer->expires = expires;
+			return;
+		}
+		dect_timer_stop(dh, timer);
+	}
 
-	timer->state = DECT_TIMER_RUNNING;
+	timer->state   = DECT_TIMER_RUNNING;
+	timer->expires = expires;
+	timer->armed   = expires;
+	tv.tv_sec  = timeout / 1000;
+	tv.tv_usec = timeout % 1000 * 1000;
 	dh->ops->event_ops->start_timer(dh, timer, &tv);
 }
-EXPORT_SYMBOL(dect_timer_start);
+EXPORT_SYMBOL(dect_timer_start_ms);
 
 void dect_timer_stop(const struct dect_handle *dh, struct dect_timer *timer)
 {
-	dect_assert(timer->state == DECT_TIMER_RUNNING);
-	dh->ops->event_ops->stop_timer(dh, timer);
+	dect_assert(timer->state != DECT_TIMER_STOPPED);
+	dect_trace1(timer_stop, timer);
+	if (dh->timer_wheel != NULL)
+		dect_timer_wheel_stop(dh->timer_wheel, timer);
+	else
+		dh->ops->event_ops->stop_timer(dh, timer);
 	timer->state = DECT_TIMER_STOPPED;
 }
 EXPORT_SYMBOL(dect_timer_stop);
 
+/**
+ * Lazily stop a timer
+ *
+ * @param dh		libdect DECT handle
+ * @param timer		DECT timer
+ *
+ * Mark the timer as stopped without unregistering it from the application's
+ * event handler. The expiry is ignored by dect_timer_run() unless the timer
+ * is restarted in the meantime, in which case the existing registration is
+ * reused if possible. Timers stopped this way must be released using
+ * dect_timer_stop() if dect_timer_pending() returns true before their
+ * storage is freed.
+ */
+void dect_timer_cancel(const struct dect_handle *dh, struct dect_timer *timer)
+{
+	dect_assert(timer->state == DECT_TIMER_RUNNING);
+	if (dh->timer_wheel != NULL)
+		dect_timer_stop(dh, timer);
+	else
+		timer->state = DECT_TIMER_CANCELLED;
+}
+
+/* Timer is running or still registered after lazy cancellation */
+bool dect_timer_pending(const struct dect_timer *timer)
+{
+	return timer->state != DECT_TIMER_STOPPED;
+}
+
 bool dect_timer_running(const struct dect_timer *timer)
 {
 	return timer->state == DECT_TIMER_RUNNING;
@@ -122,11 +506,128 @@ EXPORT_SYMBOL(dect_timer_running);
  */
 void dect_timer_run(struct dect_handle *dh, struct dect_timer *timer)
 {
+	struct timeval tv;
+	uint64_t now;
+
+	if (timer->state == DECT_TIMER_CANCELLED) {
+		timer->state = DECT_TIMER_STOPPED;
+		return;
+	}
 	dect_assert(timer->state == DECT_TIMER_RUNNING);
+
+	/* Restarted for a later expiry while registered */
+	if (dh->timer_wheel == NULL && timer->expires > timer->armed) {
+		now = dect_timer_now();
+		if (timer->expires > now) {
+			tv.tv_sec  = (timer->expires - now) / 1000;
+			tv.tv_usec = (timer->expires - now) % 1000 * 1000;
+			timer->armed = timer->expires;
+			dh->ops->event_ops->start_timer(dh, timer, &tv);
+			return;
+		}
+	}
+
+	dect_trace2(timer_run, timer, timer->callback);
+	dect_debug_bind(dh);
+	dect_ind_flush_pending(dh);
 	timer->state = DECT_TIMER_STOPPED;
 	timer->callback(dh, timer);
 }
 EXPORT_SYMBOL(dect_timer_run);
 
+/*
+ * Timer queue of the built-in event backends: running timers are kept on a
+ * list sorted by expiry time and a timerfd is armed for the first one.
+ */
+
+static uint64_t dect_timer_queue_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void dect_timer_queue_arm(struct dect_timer_queue *tq)
+{
+	struct dect_timer_queue_entry *te;
+	struct itimerspec its;
+
+	memset(&its, 0, sizeof(its));
+	if (!list_empty(&tq->timers)) {
+		te = list_first_entry(&tq->timers, struct dect_timer_queue_entry,
+				      list);
+		its.it_value.tv_sec  = te->expires / 1000000000ULL;
+		its.it_value.tv_nsec = te->expires % 1000000000ULL;
+		/* An all zero value disarms the timer */
+		if (te->expires == 0)
+			its.it_value.tv_nsec = 1;
+	}
+	timerfd_settime(tq->tfd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+int dect_timer_queue_init(struct dect_timer_queue *tq)
+{
+	init_list_head(&tq->timers);
+	tq->tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	return tq->tfd < 0 ? -1 : 0;
+}
+
+void dect_timer_queue_exit(struct dect_timer_queue *tq)
+{
+	close(tq->tfd);
+}
+
+void dect_timer_queue_add(struct dect_timer_queue *tq,
+			  struct dect_timer *timer, const struct timeval *tv)
+{
+	struct dect_timer_queue_entry *te = dect_timer_priv(timer), *pos;
+
+	te->timer   = timer;
+	te->expires = dect_timer_queue_now() + tv->tv_sec * 1000000000ULL +
+		      tv->tv_usec * 1000ULL;
+
+	/* Timeouts are mostly uniform, search from the tail */
+	list_for_each_entry_reverse(pos, &tq->timers, list) {
+		if (pos->expires <= te->expires)
+			break;
+	}
+	list_add(&te->list, &pos->list);
+
+	if (tq->timers.next == &te->list)
+		dect_timer_queue_arm(tq);
+}
+
+void dect_timer_queue_del(struct dect_timer_queue *tq, struct dect_timer *timer)
+{
+	struct dect_timer_queue_entry *te = dect_timer_priv(timer);
+	bool first = tq->timers.next == &te->list;
+
+	list_del(&te->list);
+	if (first)
+		dect_timer_queue_arm(tq);
+}
+
+/* Run expired timers, called when the timerfd is readable */
+void dect_timer_queue_run(struct dect_timer_queue *tq, struct dect_handle *dh)
+{
+	struct dect_timer_queue_entry *te;
+	uint64_t now, exp;
+
+	if (read(tq->tfd, &exp, sizeof(exp)) < 0 && errno == EAGAIN)
+		return;
+
+	now = dect_timer_queue_now();
+	while (!list_empty(&tq->timers)) {
+		te = list_first_entry(&tq->timers, struct dect_timer_queue_entry,
+				      list);
+		if (te->expires > now)
+			break;
+		list_del(&te->list);
+		dect_timer_run(dh, te->timer);
+	}
+	dect_timer_queue_arm(tq);
+}
+
 /** @} */
 /** @} */
@@ -0,0 +1,771 @@
+/*
+ * libdect binary trace ring
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @addtogroup debug
+ * @{
+ *
+ * @defgroup trace_ring Binary trace ring
+ *
+ * Low overhead recording of debugging messages.
+ *
+ * When a trace ring is opened, debugging messages and hexdumps are not
+ * formatted, but stored as fixed size binary records in a memory mapped
+ * file: a timestamp, the subsystem, a reference to the format string, up to
+ * six integer arguments and a truncated payload containing string arguments
+ * or the dumped data. Format strings are stored once in a string table at
+ * the start of the file. Records are claimed using a single atomic
+ * operation, the oldest records are overwritten when the ring is full.
+ *
+ * Since the ring is a shared file mapping, its contents survive crashes of
+ * the application. dect_trace_ring_decode() renders the records of a ring
+ * file as the text produced by the regular debugging output, the file must
+ * be decoded on a host of the same architecture.
+ *
+ * @{
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <ctype.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <libdect.h>
+#include <utils.h>
+
+#define DECT_TRACE_RING_MAGIC		0x44545243	/* "DTRC" */
+#define DECT_TRACE_RING_VERSION		1
+
+/* Default number of records */
+#define DECT_TRACE_RING_SIZE		65536
+
+/* Size of the header, the string table starts behind it */
+#define DECT_TRACE_HDR_SIZE		64
+#define DECT_TRACE_STRTAB_SIZE		(64 * 1024)
+
+/* Size of the format string lookup table, a power of two */
+#define DECT_TRACE_INTERN_SIZE		1024
+#define DECT_TRACE_ID_NONE		UINT32_MAX
+
+#define DECT_TRACE_ARGS_MAX		6
+#define DECT_TRACE_PAYLOAD_SIZE		56
+
+enum dect_trace_rec_types {
+	DECT_TRACE_REC_MSG		= 1,
+	DECT_TRACE_REC_HEXDUMP		= 2,
+};
+
+/**
+ * struct dect_trace_ring_hdr - trace ring file header
+ *
+ * @magic:		#DECT_TRACE_RING_MAGIC
+ * @version:		#DECT_TRACE_RING_VERSION
+ * @rec_size:		size of a record
+ * @nrecs:		number of records, a power of two
+ * @strtab_size:	size of the string table
+ * @strtab_used:	used part of the string table
+ * @head:		number of records ever claimed
+ */
+struct dect_trace_ring_hdr {
+	uint32_t			magic;
+	uint16_t			version;
+	uint16_t			rec_size;
+	uint32_t			nrecs;
+	uint32_t			strtab_size;
+	uint32_t			strtab_used;
+	uint32_t			__pad;
+	uint64_t			head;
+};
+
+/**
+ * struct dect_trace_rec - trace record
+ *
+ * @seq:	index of the record plus one once complete, zero while written
+ * @ts:		monotonic timestamp in nanoseconds
+ * @id:		string table offset of the format string or hexdump prefix
+ * @type:	record type (#dect_trace_rec_types)
+ * @subsys:	debugging subsystem
+ * @nargs:	number of recorded arguments
+ * @len:	payload length
+ * @args:	integer and floating point arguments, hexdump size
+ * @payload:	string arguments or the dumped data
+ */
+struct dect_trace_rec {
+	uint64_t			seq;
+	uint64_t			ts;
+	uint32_t			id;
+	uint8_t				type;
+	uint8_t				subsys;
+	uint8_t				nargs;
+	uint8_t				len;
+	uint64_t			args[DECT_TRACE_ARGS_MAX];
+	uint8_t				payload[DECT_TRACE_PAYLOAD_SIZE];
+};
+
+struct dect_trace_ring {
+	int				fd;
+	size_t				size;
+	struct dect_trace_ring_hdr	*hdr;
+	char				*strtab;
+	struct dect_trace_rec		*recs;
+	pthread_mutex_t			lock;
+	const char			*keys[DECT_TRACE_INTERN_SIZE];
+	uint32_t			ids[DECT_TRACE_INTERN_SIZE];
+};
+
+static struct dect_trace_ring *dect_trace_ring;
+
+/*
+ * Recording
+ */
+
+/* Look up or add a constant string to the string table */
+static uint32_t dect_trace_intern(struct dect_trace_ring *tr, const char *str)
+{
+	unsigned int slot, i;
+	const char *key;
+	uint32_t id = DECT_TRACE_ID_NONE;
+	size_t len;
+
+	slot = hash_64((uintptr_t)str, 10);
+	for (i = 0; i < DECT_TRACE_INTERN_SIZE; i++) {
+		key = __atomic_load_n(&tr->keys[slot], __ATOMIC_ACQUIRE);
+		if (key == str)
+			return tr->ids[slot];
+		if (key == NULL)
+			break;
+		slot = (slot + 1) & (DECT_TRACE_INTERN_SIZE - 1);
+	}
+	if (i == DECT_TRACE_INTERN_SIZE)
+		return id;
+
+	pthread_mutex_lock(&tr->lock);
+	/* Another thread may have added it in the meantime */
+	for (; tr->keys[slot] != NULL; slot = (slot + 1) & (DECT_TRACE_INTERN_SIZE - 1)) {
+		if (tr->keys[slot] == str) {
+			id = tr->ids[slot];
+			goto out;
+		}
+	}
+
+	len = strlen(str) + 1;
+	if (tr->hdr->strtab_used + len > tr->hdr->strtab_size)
+		goto out;
+
+	id = tr->hdr->strtab_used;
+	memcpy(tr->strtab + id, str, len);
+	__atomic_store_n(&tr->hdr->strtab_used, id + len, __ATOMIC_RELEASE);
+
+	tr->ids[slot] = id;
+	__atomic_store_n(&tr->keys[slot], str, __ATOMIC_RELEASE);
+out:
+	pthread_mutex_unlock(&tr->lock);
+	return id;
+}
+
+static struct dect_trace_rec *dect_trace_rec_get(struct dect_trace_ring *tr,
+						 enum dect_trace_rec_types type,
+						 enum dect_debug_subsys subsys,
+						 const char *str, uint64_t *seq)
+{
+	struct dect_trace_rec *rec;
+	struct timespec ts;
+
+	*seq = __atomic_fetch_add(&tr->hdr->head, 1, __ATOMIC_RELAXED);
+	rec  = &tr->recs[*seq & (tr->hdr->nrecs - 1)];
+	__atomic_store_n(&rec->seq, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	rec->ts     = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	rec->id     = dect_trace_intern(tr, str);
+	rec->type   = type;
+	rec->subsys = subsys;
+	rec->nargs  = 0;
+	rec->len    = 0;
+	return rec;
+}
+
+static void dect_trace_rec_put(struct dect_trace_rec *rec, uint64_t seq)
+{
+	__atomic_store_n(&rec->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+static void dect_trace_arg(struct dect_trace_rec *rec, uint64_t val)
+{
+	if (rec->nargs < DECT_TRACE_ARGS_MAX)
+		rec->args[rec->nargs] = val;
+	rec->nargs = min(rec->nargs + 1, DECT_TRACE_ARGS_MAX + 1);
+}
+
+/*
+ * Store a string argument, @prec is the precision of the conversion or -1.
+ * Like printf(), at most @prec bytes are read, so strings don't need to be
+ * NUL terminated when a precision is given.
+ */
+static void dect_trace_str(struct dect_trace_rec *rec, const char *s, int prec)
+{
+	unsigned int len;
+
+	if (s == NULL)
+		s = "(null)";
+	if (rec->len == DECT_TRACE_PAYLOAD_SIZE)
+		return;
+
+	len = DECT_TRACE_PAYLOAD_SIZE - rec->len - 1;
+	if (prec >= 0 && (unsigned int)prec < len)
+		len = prec;
+	len = strnlen(s, len);
+	memcpy(rec->payload + rec->len, s, len);
+	rec->len += len;
+	rec->payload[rec->len++] = '\0';
+}
+
+/*
+ * Record the arguments of a printf format string. Integers are stored sign
+ * extended, floating point values as double. Arguments exceeding the record
+ * are consumed but dropped.
+ */
+static void dect_trace_capture(struct dect_trace_rec *rec, const char *fmt,
+			       va_list ap)
+{
+	unsigned int lmod;
+	int prec;
+	double d;
+	uint64_t val;
+
+	while ((fmt = strchr(fmt, '%')) != NULL) {
+		fmt++;
+		if (*fmt == '%') {
+			fmt++;
+			continue;
+		}
+
+		fmt += strspn(fmt, "-+ #0'");
+		if (*fmt == '*') {
+			dect_trace_arg(rec, va_arg(ap, int));
+			fmt++;
+		} else
+			fmt += strspn(fmt, "0123456789");
+		prec = -1;
+		if (*fmt == '.') {
+			fmt++;
+			if (*fmt == '*') {
+				prec = va_arg(ap, int);
+				dect_trace_arg(rec, prec);
+				fmt++;
+			} else {
+				prec = atoi(fmt);
+				fmt += strspn(fmt, "0123456789");
+			}
+		}
+
+		for (lmod = 0; *fmt != '\0' && strchr("hlLqjzt", *fmt); fmt++) {
+			if (*fmt == 'l')
+				lmod++;
+			else if (*fmt != 'h')
+				lmod = 2;
+		}
+
+		switch (*fmt++) {
+		case 'd':
+		case 'i':
+			if (lmod == 0)
+				val = va_arg(ap, int);
+			else if (lmod == 1)
+				val = va_arg(ap, long);
+			else
+				val = va_arg(ap, long long);
+			break;
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+			if (lmod == 0)
+				val = va_arg(ap, unsigned int);
+			else if (lmod == 1)
+				val = va_arg(ap, unsigned long);
+			else
+				val = va_arg(ap, unsigned long long);
+			break;
+		case 'c':
+			val = va_arg(ap, int);
+			break;
+		case 'p':
+			val = (uintptr_t)va_arg(ap, void *);
+			break;
+		case 's':
+			dect_trace_str(rec, va_arg(ap, const char *), prec);
+			continue;
+		case 'e':
+		case 'E':
+		case 'f':
+		case 'F':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+			if (lmod == 2)
+				d = va_arg(ap, long double);
+			else
+				d = va_arg(ap, double);
+			memcpy(&val, &d, sizeof(val));
+			break;
+		case 'n':
+			va_arg(ap, void *);
+			continue;
+		default:
+			return;
+		}
+		dect_trace_arg(rec, val);
+	}
+}
+
+bool dect_trace_ring_vlog(enum dect_debug_subsys subsys, const char *fmt,
+			  va_list ap)
+{
+	struct dect_trace_ring *tr;
+	struct dect_trace_rec *rec;
+	uint64_t seq;
+
+	tr = __atomic_load_n(&dect_trace_ring, __ATOMIC_ACQUIRE);
+	if (tr == NULL)
+		return false;
+
+	rec = dect_trace_rec_get(tr, DECT_TRACE_REC_MSG, subsys, fmt, &seq);
+	dect_trace_capture(rec, fmt, ap);
+	dect_trace_rec_put(rec, seq);
+	return true;
+}
+
+bool dect_trace_ring_hexdump(enum dect_debug_subsys subsys, const char *prefix,
+			     const uint8_t *buf, size_t size)
+{
+	struct dect_trace_ring *tr;
+	struct dect_trace_rec *rec;
+	uint64_t seq;
+
+	tr = __atomic_load_n(&dect_trace_ring, __ATOMIC_ACQUIRE);
+	if (tr == NULL)
+		return false;
+
+	rec = dect_trace_rec_get(tr, DECT_TRACE_REC_HEXDUMP, subsys, prefix, &seq);
+	rec->nargs   = 1;
+	rec->args[0] = size;
+	rec->len     = min(size, (size_t)DECT_TRACE_PAYLOAD_SIZE);
+	memcpy(rec->payload, buf, rec->len);
+	dect_trace_rec_put(rec, seq);
+	return true;
+}
+
+/**
+ * Open a trace ring
+ *
+ * @param path		path of the ring file, created or truncated
+ * @param nrecs		number of records, rounded up to a power of two, or 0
+ *			for the default of 65536
+ *
+ * Record all further debugging messages of enabled subsystems in the trace
+ * ring instead of passing them to the debugging hook. Each record occupies
+ * 128 bytes.
+ *
+ * @return 0 on success or -1 on error, setting errno.
+ */
+int dect_trace_ring_open(const char *path, unsigned int nrecs)
+{
+	struct dect_trace_ring *tr;
+	void *map;
+	int err;
+
+	BUILD_BUG_ON(sizeof(struct dect_trace_rec) != 128);
+	BUILD_BUG_ON(sizeof(struct dect_trace_ring_hdr) > DECT_TRACE_HDR_SIZE);
+
+	if (dect_trace_ring != NULL) {
+		errno = EBUSY;
+		return -1;
+	}
+	if (nrecs == 0)
+		nrecs = DECT_TRACE_RING_SIZE;
+	nrecs = 1 << fls(max(nrecs, 2U) - 1);
+
+	tr = calloc(1, sizeof(*tr));
+	if (tr == NULL)
+		goto err1;
+	tr->size = DECT_TRACE_HDR_SIZE + DECT_TRACE_STRTAB_SIZE +
+		   nrecs * sizeof(struct dect_trace_rec);
+
+	tr->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (tr->fd < 0)
+		goto err2;
+	if (ftruncate(tr->fd, tr->size) < 0)
+		goto err3;
+
+	map = mmap(NULL, tr->size, PROT_READ | PROT_WRITE, MAP_SHARED, tr->fd, 0);
+	if (map == MAP_FAILED)
+		goto err3;
+
+	tr->hdr	   = map;
+	tr->strtab = (char *)map + DECT_TRACE_HDR_SIZE;
+	tr->recs   = (void *)(tr->strtab + DECT_TRACE_STRTAB_SIZE);
+	pthread_mutex_init(&tr->lock, NULL);
+
+	tr->hdr->version     = DECT_TRACE_RING_VERSION;
+	tr->hdr->rec_size    = sizeof(struct dect_trace_rec);
+	tr->hdr->nrecs	     = nrecs;
+	tr->hdr->strtab_size = DECT_TRACE_STRTAB_SIZE;
+	tr->hdr->strtab_used = 0;
+	tr->hdr->head	     = 0;
+	__atomic_store_n(&tr->hdr->magic, DECT_TRACE_RING_MAGIC, __ATOMIC_RELEASE);
+
+	__atomic_store_n(&dect_trace_ring, tr, __ATOMIC_RELEASE);
+	return 0;
+
+err3:
+	err = errno;
+	close(tr->fd);
+	unlink(path);
+	errno = err;
+err2:
+	free(tr);
+err1:
+	return -1;
+}
+EXPORT_SYMBOL(dect_trace_ring_open);
+
+/**
+ * Close the trace ring
+ *
+ * Stop recording and flush the ring file. Debugging messages are passed to
+ * the debugging hook again. No debugging output may be generated
+ * concurrently.
+ */
+void dect_trace_ring_close(void)
+{
+	struct dect_trace_ring *tr = dect_trace_ring;
+
+	if (tr == NULL)
+		return;
+	__atomic_store_n(&dect_trace_ring, NULL, __ATOMIC_RELEASE);
+
+	msync(tr->hdr, tr->size, MS_SYNC);
+	munmap(tr->hdr, tr->size);
+	close(tr->fd);
+	pthread_mutex_destroy(&tr->lock);
+	free(tr);
+}
+EXPORT_SYMBOL(dect_trace_ring_close);
+
+/*
+ * Decoding
+ */
+
+struct dect_trace_decoder {
+	FILE				*f;
+	const struct dect_trace_rec	*rec;
+	unsigned int			arg;
+	unsigned int			off;
+};
+
+static bool dect_trace_next_arg(struct dect_trace_decoder *dec, uint64_t *val)
+{
+	if (dec->arg >= dec->rec->nargs || dec->arg >= DECT_TRACE_ARGS_MAX)
+		return false;
+	*val = dec->rec->args[dec->arg++];
+	return true;
+}
+
+static const char *dect_trace_next_str(struct dect_trace_decoder *dec)
+{
+	const char *s = (const char *)dec->rec->payload + dec->off;
+
+	if (dec->off >= dec->rec->len || dec->off >= DECT_TRACE_PAYLOAD_SIZE)
+		return "";
+	dec->off += strnlen(s, DECT_TRACE_PAYLOAD_SIZE - dec->off) + 1;
+	return s;
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+
+/* Render one conversion specification @spec of conversion @conv */
+static void dect_trace_render_conv(struct dect_trace_decoder *dec,
+				   const char *spec, char conv, int lmod)
+{
+	union {
+		uint64_t	val;
+		double		d;
+	} u;
+
+	if (conv == 's') {
+		fprintf(dec->f, spec, dect_trace_next_str(dec));
+		return;
+	}
+	if (!dect_trace_next_arg(dec, &u.val)) {
+		fputc('?', dec->f);
+		return;
+	}
+
+	switch (conv) {
+	case 'd':
+	case 'i':
+		if (lmod < 0)
+			u.val = lmod == -1 ? (short)u.val : (signed char)u.val;
+		else if (lmod == 0)
+			u.val = (int)u.val;
+		fprintf(dec->f, spec, (long long)u.val);
+		break;
+	case 'u':
+	case 'o':
+	case 'x':
+	case 'X':
+		if (lmod < 0)
+			u.val = lmod == -1 ? (unsigned short)u.val : (unsigned char)u.val;
+		else if (lmod == 0)
+			u.val = (unsigned int)u.val;
+		fprintf(dec->f, spec, (unsigned long long)u.val);
+		break;
+	case 'c':
+		fprintf(dec->f, spec, (int)u.val);
+		break;
+	case 'p':
+		fprintf(dec->f, spec, (void *)(uintptr_t)u.val);
+		break;
+	default:
+		fprintf(dec->f, spec, u.d);
+		break;
+	}
+}
+
+#pragma GCC diagnostic pop
+
+/* Render a message record using the format string @fmt */
+static void dect_trace_render_msg(struct dect_trace_decoder *dec,
+				  const char *fmt)
+{
+	char spec[64];
+	unsigned int len;
+	uint64_t val;
+	int lmod;
+
+	while (*fmt != '\0') {
+		len = strcspn(fmt, "%");
+		fwrite(fmt, 1, len, dec->f);
+		fmt += len;
+		if (*fmt == '\0')
+			break;
+
+		fmt++;
+		if (*fmt == '%') {
+			fputc('%', dec->f);
+			fmt++;
+			continue;
+		}
+
+		/* Copy flags, width and precision, substituting '*' arguments */
+		spec[0] = '%';
+		len = 1;
+		while (*fmt != '\0' && strchr("-+ #0'.0123456789*", *fmt) &&
+		       len < sizeof(spec) - 16) {
+			if (*fmt == '*') {
+				val = 0;
+				dect_trace_next_arg(dec, &val);
+				len += snprintf(spec + len, sizeof(spec) - len,
+						"%d", (int)val);
+			} else
+				spec[len++] = *fmt;
+			fmt++;
+		}
+
+		for (lmod = 0; *fmt != '\0' && strchr("hlLqjzt", *fmt); fmt++) {
+			if (*fmt == 'h')
+				lmod = lmod < 0 ? -2 : -1;
+			else if (*fmt == 'l')
+				lmod++;
+			else
+				lmod = 2;
+		}
+
+		switch (*fmt) {
+		case 'd':
+		case 'i':
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+			spec[len++] = 'l';
+			spec[len++] = 'l';
+			/* fall through */
+		case 'c':
+		case 'p':
+		case 's':
+		case 'e':
+		case 'E':
+		case 'f':
+		case 'F':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+			spec[len++] = *fmt;
+			spec[len] = '\0';
+			dect_trace_render_conv(dec, spec, *fmt, lmod);
+			fmt++;
+			break;
+		case 'n':
+			fmt++;
+			break;
+		default:
+			fputs(fmt, dec->f);
+			return;
+		}
+	}
+}
+
+#define BLOCKSIZE	16
+
+/* Render a hexdump record like __dect_hexdump() */
+static void dect_trace_render_hexdump(struct dect_trace_decoder *dec,
+				      const char *prefix)
+{
+	const struct dect_trace_rec *rec = dec->rec;
+	unsigned int i, off, size, plen = 0;
+	char hbuf[3 * BLOCKSIZE + 1], abuf[BLOCKSIZE + 1];
+	const uint8_t *buf = rec->payload;
+
+	for (i = 0; i < strlen(prefix); i++)
+		plen += prefix[i] == '\t' ? 8 : 1;
+
+	size = min(rec->len, (uint8_t)DECT_TRACE_PAYLOAD_SIZE);
+	for (i = 0; i < size; i++) {
+		off = i % BLOCKSIZE;
+
+		sprintf(hbuf + 3 * off, "%.2x ", buf[i]);
+		abuf[off] = isascii(buf[i]) && isprint(buf[i]) ? buf[i] : '.';
+
+		if (off == BLOCKSIZE - 1 || i == size - 1) {
+			abuf[off + 1] = '\0';
+			fprintf(dec->f, "%s: %-*s    |%s|\n",
+				prefix, 64 - plen, hbuf, abuf);
+		}
+	}
+
+	if (rec->nargs > 0 && rec->args[0] > size)
+		fprintf(dec->f, "%s: [%" PRIu64 " bytes not recorded]\n",
+			prefix, rec->args[0] - size);
+}
+
+/**
+ * Decode a trace ring file
+ *
+ * @param path		path of the ring file
+ * @param f		output stream
+ * @param flags		decoding flags (#dect_trace_decode_flags)
+ *
+ * Render the records stored in a trace ring file in chronological order.
+ * Records overwritten or being written at the time the file was captured
+ * are skipped.
+ *
+ * @return the number of decoded records or -1 on error, setting errno.
+ */
+int dect_trace_ring_decode(const char *path, FILE *f, unsigned int flags)
+{
+	const struct dect_trace_ring_hdr *hdr;
+	struct dect_trace_decoder dec = { .f = f };
+	const struct dect_trace_rec *recs, *rec;
+	const char *strtab, *str;
+	uint64_t head, seq;
+	struct stat st;
+	void *map;
+	int fd, cnt = 0;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		goto err1;
+	if (fstat(fd, &st) < 0)
+		goto err2;
+	if (st.st_size < DECT_TRACE_HDR_SIZE + DECT_TRACE_STRTAB_SIZE) {
+		errno = EINVAL;
+		goto err2;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		goto err2;
+	close(fd);
+
+	hdr = map;
+	if (hdr->magic != DECT_TRACE_RING_MAGIC ||
+	    hdr->version != DECT_TRACE_RING_VERSION ||
+	    hdr->rec_size != sizeof(struct dect_trace_rec) ||
+	    hdr->nrecs == 0 || (hdr->nrecs & (hdr->nrecs - 1)) ||
+	    hdr->strtab_size != DECT_TRACE_STRTAB_SIZE ||
+	    hdr->strtab_used > hdr->strtab_size ||
+	    (uint64_t)st.st_size < DECT_TRACE_HDR_SIZE + hdr->strtab_size +
+				   (uint64_t)hdr->nrecs * hdr->rec_size) {
+		errno = EINVAL;
+		goto err3;
+	}
+
+	strtab = (const char *)map + DECT_TRACE_HDR_SIZE;
+	recs   = (const void *)(strtab + hdr->strtab_size);
+
+	head = hdr->head;
+	for (seq = head > hdr->nrecs ? head - hdr->nrecs : 0; seq < head; seq++) {
+		rec = &recs[seq & (hdr->nrecs - 1)];
+		if (rec->seq != seq + 1)
+			continue;
+
+		if (rec->id < hdr->strtab_used &&
+		    memchr(strtab + rec->id, '\0', hdr->strtab_used - rec->id))
+			str = strtab + rec->id;
+		else
+			str = NULL;
+
+		if (flags & DECT_TRACE_DECODE_TIMESTAMPS)
+			fprintf(f, "[%5" PRIu64 ".%06" PRIu64 "] ",
+				rec->ts / 1000000000, rec->ts % 1000000000 / 1000);
+		if (flags & DECT_TRACE_DECODE_SUBSYS)
+			fprintf(f, "<%u> ", rec->subsys);
+
+		dec.rec = rec;
+		dec.arg = 0;
+		dec.off = 0;
+		if (str == NULL)
+			fprintf(f, "[unknown format]\n");
+		else if (rec->type == DECT_TRACE_REC_HEXDUMP)
+			dect_trace_render_hexdump(&dec, str);
+		else
+			dect_trace_render_msg(&dec, str);
+		cnt++;
+	}
+
+	munmap(map, st.st_size);
+	return cnt;
+
+err3:
+	munmap(map, st.st_size);
+	return -1;
+err2:
+	close(fd);
+err1:
+	return -1;
+}
+EXPORT_SYMBOL(dect_trace_ring_decode);
+
+/** @} */
+/** @} */
@@ -0,0 +1,1118 @@
+/*
+ * libdect io_uring event backend
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @addtogroup events
+ * @{
+ *
+ * @defgroup uring io_uring event backend
+ *
+ * Built-in event handler based on io_uring.
+ *
+ * The io_uring backend is used like the @ref epoll "epoll backend", but
+ * performs the message I/O of DECT S-SAP and B-SAP sockets on the ring
+ * instead of only polling them:
+ *
+ * - a multishot receive request is posted on each socket, received messages
+ *   are placed in buffers of a provided buffer ring and queued on the socket
+ *   until the data link entity reads them. Reads don't enter the kernel,
+ *   messages left over by the receive budget are delivered again on the next
+ *   dispatch call.
+ *
+ * - sent messages are copied and queued on the socket. At the end of the
+ *   dispatch call, or immediately when sending outside of it, the queued
+ *   messages of each socket are submitted as one chain of linked send
+ *   requests, so all sockets are flushed with a single system call. Only one
+ *   chain is in flight per socket to keep the messages in order, closing a
+ *   socket is deferred until its messages have been sent.
+ *
+ * All other file descriptors have a level triggered multishot poll request
+ * posted on the ring. Registration changes made while processing events are
+ * queued on the submission ring and submitted in one batch at the end of the
+ * dispatch call.
+ *
+ * Requests terminated by an error are not re-armed. A failing poll delivers
+ * one final event, so the owner notices the error condition, a failing
+ * receive request falls back to polling the socket.
+ *
+ * Messages queued for a socket passed to another process are discarded when
+ * it is detached, so only idle data links should be handed off. Data links
+ * of a shard primary handle are polled, since they are passed to the shards
+ * after peeking at their first message.
+ *
+ * @{
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <linux/dect.h>
+#include <liburing.h>
+
+#include <libdect.h>
+#include <utils.h>
+#include <io.h>
+#include <timer.h>
+#include <shard.h>
+
+/* Size of the submission ring */
+#define DECT_URING_ENTRIES		256
+
+/* Maximum number of registered file descriptors */
+#define DECT_URING_FD_MAX		4096
+
+/* Number and size of the receive buffers */
+#define DECT_URING_BUFS			256
+#define DECT_URING_BUF_SIZE		256
+#define DECT_URING_BGID			0
+
+/* Maximum number of received messages queued on a socket */
+#define DECT_URING_RX_MAX		32
+
+/* Maximum number of sent messages queued on a socket */
+#define DECT_URING_TX_MAX		64
+
+/*
+ * User data of requests: the message of send requests, the timerfd poll,
+ * ignored completions, or the request type, a generation and the fd number.
+ */
+#define DECT_URING_TIMER		1ULL
+#define DECT_URING_IGNORE		2ULL
+
+enum dect_uring_ops {
+	DECT_URING_OP_POLL		= 1,
+	DECT_URING_OP_RECV		= 2,
+};
+
+#define DECT_URING_GEN_MASK		0xffffff
+#define DECT_URING_DATA(op, gen, fd)	((uint64_t)(op) << 56 |		\
+					 (uint64_t)((gen) & DECT_URING_GEN_MASK) << 32 | \
+					 (uint32_t)(fd))
+
+/**
+ * struct dect_uring_buf - receive buffer
+ *
+ * @next:	next buffer queued on the socket
+ * @len:	length of the received message
+ */
+struct dect_uring_buf {
+	struct dect_uring_buf	*next;
+	size_t			len;
+};
+
+/**
+ * struct dect_uring_tx - queued message
+ *
+ * @next:	next message queued on the socket
+ * @fd:		fd number
+ * @id:		socket instance
+ * @flags:	send flags
+ * @len:	message length
+ * @data:	message data
+ */
+struct dect_uring_tx {
+	struct dect_uring_tx	*next;
+	int			fd;
+	uint32_t		id;
+	int			flags;
+	size_t			len;
+	uint8_t			data[];
+};
+
+/**
+ * struct dect_uring_sock - per file descriptor state
+ *
+ * @owner:	libdect file descriptor owning the fd number, NULL if unused
+ * @dfd:	registered libdect file descriptor, NULL if unregistered
+ * @id:		instance, incremented when the fd number gets a new owner
+ * @gen:	generation, incremented on each registration change
+ * @events:	registered events
+ * @recv:	messages are received through a multishot receive request
+ * @armed:	the receive request is in flight
+ * @cancel:	cancellation of the receive request has been submitted
+ * @eof:	the receive request has seen the end of the data link
+ * @closing:	close the fd once the last queued message has been sent
+ * @tx_blocked:	a send failed because of a full queue
+ * @rx_count:	number of queued received messages
+ * @tx_count:	number of queued and in flight messages
+ * @rx_queue:	received messages
+ * @tx_queue:	messages queued for sending
+ * @tx_inflight: messages submitted for sending
+ * @rx_list:	node in the list of sockets with left over messages
+ * @arm_list:	node in the list of sockets waiting for a receive request
+ * @tx_list:	node in the list of sockets with messages to submit
+ *
+ * The instance and generation are part of the user data of requests,
+ * completions of receive requests of a previous owner and poll requests of a
+ * previous registration are ignored.
+ */
+struct dect_uring_sock {
+	struct dect_fd		*owner;
+	struct dect_fd		*dfd;
+	uint32_t		id;
+	uint32_t		gen;
+	uint32_t		events;
+	bool			recv;
+	bool			armed;
+	bool			cancel;
+	bool			eof;
+	bool			closing;
+	bool			tx_blocked;
+	unsigned int		rx_count;
+	unsigned int		tx_count;
+	PTRQUEUE_HEAD(struct dect_uring_buf) rx_queue;
+	PTRQUEUE_HEAD(struct dect_uring_tx) tx_queue;
+	PTRQUEUE_HEAD(struct dect_uring_tx) tx_inflight;
+	struct list_head	rx_list;
+	struct list_head	arm_list;
+	struct list_head	tx_list;
+};
+
+/**
+ * struct dect_uring - io_uring event backend
+ *
+ * @ops:	event ops installed in the DECT ops
+ * @dops:	DECT ops, used for memory allocation
+ * @transport:	transport of sockets performing message I/O on the ring
+ * @tops:	transport operations, the kernel transport with the message I/O
+ *		and socket closing overridden
+ * @ring:	io_uring instance
+ * @tq:		timer queue
+ * @dispatching: events are being processed, defer submissions
+ * @br:		provided buffer ring
+ * @nfree:	number of receive buffers owned by the kernel
+ * @rx_pending:	sockets with left over messages
+ * @arm_pending: sockets waiting for a receive request
+ * @tx_pending:	sockets with messages to submit
+ * @bufs:	receive buffer descriptors
+ * @bufdata:	receive buffers
+ * @socks:	per file descriptor state, indexed by fd number
+ */
+struct dect_uring {
+	struct dect_event_ops	ops;
+	const struct dect_ops	*dops;
+	struct dect_transport	transport;
+	struct dect_transport_ops tops;
+	struct io_uring		ring;
+	struct dect_timer_queue	tq;
+	bool			dispatching;
+	struct io_uring_buf_ring *br;
+	unsigned int		nfree;
+	struct list_head	rx_pending;
+	struct list_head	arm_pending;
+	struct list_head	tx_pending;
+	struct dect_uring_buf	bufs[DECT_URING_BUFS];
+	uint8_t			bufdata[DECT_URING_BUFS][DECT_URING_BUF_SIZE];
+	struct dect_uring_sock	socks[DECT_URING_FD_MAX];
+};
+
+static struct dect_uring *dect_uring(const struct dect_handle *dh)
+{
+	return container_of(dh->ops->event_ops, struct dect_uring, ops);
+}
+
+static struct dect_uring *dect_uring_transport(const struct dect_fd *dfd)
+{
+	return container_of(dfd->transport, struct dect_uring, transport);
+}
+
+static struct io_uring_sqe *dect_uring_get_sqe(struct dect_uring *ur)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = io_uring_get_sqe(&ur->ring);
+	if (sqe == NULL) {
+		io_uring_submit(&ur->ring);
+		sqe = io_uring_get_sqe(&ur->ring);
+	}
+	return sqe;
+}
+
+static void dect_uring_flush(struct dect_uring *ur);
+static void dect_uring_rearm(struct dect_uring *ur);
+
+static void dect_uring_submit(struct dect_uring *ur)
+{
+	if (ur->dispatching)
+		return;
+	dect_uring_rearm(ur);
+	dect_uring_flush(ur);
+	io_uring_submit(&ur->ring);
+}
+
+static void dect_uring_cancel(struct dect_uring *ur, uint64_t data)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = dect_uring_get_sqe(ur);
+	if (sqe == NULL)
+		return;
+	io_uring_prep_cancel64(sqe, data, 0);
+	io_uring_sqe_set_data64(sqe, DECT_URING_IGNORE);
+}
+
+/*
+ * Receive buffers
+ */
+
+static void dect_uring_buf_put(struct dect_uring *ur, struct dect_uring_buf *buf)
+{
+	unsigned int bid = buf - ur->bufs;
+
+	io_uring_buf_ring_add(ur->br, ur->bufdata[bid], DECT_URING_BUF_SIZE,
+			      bid, io_uring_buf_ring_mask(DECT_URING_BUFS), 0);
+	io_uring_buf_ring_advance(ur->br, 1);
+	ur->nfree++;
+}
+
+static struct dect_uring_buf *dect_uring_buf_get(struct dect_uring *ur,
+						 const struct io_uring_cqe *cqe)
+{
+	if (!(cqe->flags & IORING_CQE_F_BUFFER))
+		return NULL;
+	ur->nfree--;
+	return &ur->bufs[cqe->flags >> IORING_CQE_BUFFER_SHIFT];
+}
+
+/*
+ * Per file descriptor state
+ */
+
+static bool dect_uring_sock_recv(const struct dect_handle *dh,
+				 const struct dect_fd *dfd)
+{
+	socklen_t optlen;
+	int val;
+
+	if (dfd->transport != &dect_kernel_transport)
+		return false;
+
+	optlen = sizeof(val);
+	if (getsockopt(dfd->fd, SOL_SOCKET, SO_DOMAIN, &val, &optlen) < 0 ||
+	    val != AF_DECT)
+		return false;
+	optlen = sizeof(val);
+	if (getsockopt(dfd->fd, SOL_SOCKET, SO_ACCEPTCONN, &val, &optlen) < 0 ||
+	    val != 0)
+		return false;
+	optlen = sizeof(val);
+	if (getsockopt(dfd->fd, SOL_SOCKET, SO_TYPE, &val, &optlen) < 0)
+		return false;
+
+	if (val == SOCK_SEQPACKET)
+		return !dect_shard_primary(dh);
+	return val == SOCK_DGRAM;
+}
+
+/* Drop the received messages and stop the receive request */
+static void dect_uring_sock_release(struct dect_uring *ur,
+				    struct dect_uring_sock *sk)
+{
+	struct dect_uring_buf *buf;
+
+	if (sk->armed && !sk->cancel)
+		dect_uring_cancel(ur, DECT_URING_DATA(DECT_URING_OP_RECV, sk->id,
+						      sk - ur->socks));
+	while ((buf = ptrqueue_dequeue_head(&sk->rx_queue)) != NULL)
+		dect_uring_buf_put(ur, buf);
+
+	list_del_init(&sk->rx_list);
+	list_del_init(&sk->arm_list);
+	sk->owner	= NULL;
+	sk->dfd		= NULL;
+	sk->gen++;
+	sk->recv	= false;
+	sk->armed	= false;
+	sk->cancel	= false;
+	sk->eof		= false;
+	sk->tx_blocked	= false;
+	sk->rx_count	= 0;
+}
+
+/*
+ * Forget messages of a previous owner which closed the fd number without
+ * going through the transport. Messages in flight are released when their
+ * completions arrive.
+ */
+static void dect_uring_sock_reset(struct dect_uring *ur,
+				  struct dect_uring_sock *sk)
+{
+	struct dect_uring_tx *tx;
+
+	dect_uring_sock_release(ur, sk);
+	while ((tx = ptrqueue_dequeue_head(&sk->tx_queue)) != NULL)
+		ur->dops->free(tx);
+	ptrqueue_init(&sk->tx_inflight);
+	list_del_init(&sk->tx_list);
+	sk->closing  = false;
+	sk->tx_count = 0;
+}
+
+static void dect_uring_sock_attach(struct dect_uring *ur,
+				   const struct dect_handle *dh,
+				   struct dect_uring_sock *sk,
+				   struct dect_fd *dfd)
+{
+	if (sk->owner != NULL || sk->tx_count > 0)
+		dect_uring_sock_reset(ur, sk);
+	sk->owner = dfd;
+	sk->id++;
+
+	if (dect_uring_sock_recv(dh, dfd)) {
+		sk->recv = true;
+		dfd->transport = &ur->transport;
+		list_add_tail(&sk->arm_list, &ur->arm_pending);
+	}
+}
+
+/*
+ * Polling
+ */
+
+static int dect_uring_poll(struct dect_uring *ur, int fd, uint16_t events,
+			   bool level, uint64_t data)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = dect_uring_get_sqe(ur);
+	if (sqe == NULL) {
+		errno = EBUSY;
+		return -1;
+	}
+	io_uring_prep_poll_multishot(sqe, fd, events);
+	/*
+	 * Level triggered, so the poll keeps firing while messages left over
+	 * by the receive budget are still queued on the socket.
+	 */
+	if (level)
+		sqe->len |= IORING_POLL_ADD_LEVEL;
+	io_uring_sqe_set_data64(sqe, data);
+	return 0;
+}
+
+/*
+ * Post the poll request of the current registration. Sockets receiving
+ * through the ring are only polled for completion of connection setup.
+ */
+static int dect_uring_sock_poll(struct dect_uring *ur,
+				struct dect_uring_sock *sk)
+{
+	uint16_t events = 0;
+
+	if (sk->events & DECT_FD_READ && !sk->recv)
+		events |= POLLIN;
+	if (sk->events & DECT_FD_WRITE)
+		events |= POLLOUT;
+	if (events == 0)
+		return 0;
+
+	return dect_uring_poll(ur, sk - ur->socks, events, !sk->recv,
+			       DECT_URING_DATA(DECT_URING_OP_POLL, sk->gen,
+					       sk - ur->socks));
+}
+
+static void dect_uring_sock_unpoll(struct dect_uring *ur,
+				   struct dect_uring_sock *sk)
+{
+	struct io_uring_sqe *sqe;
+
+	if (!(sk->events & DECT_FD_WRITE) &&
+	    !(sk->events & DECT_FD_READ && !sk->recv))
+		return;
+
+	sqe = dect_uring_get_sqe(ur);
+	if (sqe == NULL)
+		return;
+	io_uring_prep_poll_remove(sqe, DECT_URING_DATA(DECT_URING_OP_POLL,
+						       sk->gen, sk - ur->socks));
+	io_uring_sqe_set_data64(sqe, DECT_URING_IGNORE);
+}
+
+/* Stop receiving through the ring after an error and poll the socket */
+static void dect_uring_sock_fallback(struct dect_uring *ur,
+				     struct dect_uring_sock *sk)
+{
+	if (sk->dfd != NULL)
+		dect_uring_sock_unpoll(ur, sk);
+	list_del_init(&sk->arm_list);
+	sk->recv = false;
+	sk->gen++;
+	if (sk->dfd != NULL)
+		dect_uring_sock_poll(ur, sk);
+}
+
+/*
+ * Receiving
+ */
+
+static void dect_uring_recv(struct dect_uring *ur, struct dect_uring_sock *sk)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = dect_uring_get_sqe(ur);
+	if (sqe == NULL)
+		return;
+	io_uring_prep_recv_multishot(sqe, sk - ur->socks, NULL, 0, 0);
+	sqe->flags |= IOSQE_BUFFER_SELECT;
+	sqe->buf_group = DECT_URING_BGID;
+	io_uring_sqe_set_data64(sqe, DECT_URING_DATA(DECT_URING_OP_RECV,
+						     sk->id, sk - ur->socks));
+	sk->armed = true;
+}
+
+/*
+ * Post receive requests on sockets which had none or had theirs terminated,
+ * once buffers are available and the queue of the socket has drained.
+ */
+static void dect_uring_rearm(struct dect_uring *ur)
+{
+	struct dect_uring_sock *sk, *next;
+
+	list_for_each_entry_safe(sk, next, &ur->arm_pending, arm_list) {
+		if (ur->nfree == 0)
+			break;
+		if (sk->armed || sk->rx_count >= DECT_URING_RX_MAX / 2)
+			continue;
+		list_del_init(&sk->arm_list);
+		if (!sk->recv || sk->eof)
+			continue;
+		dect_uring_recv(ur, sk);
+	}
+}
+
+static void dect_uring_rx_process(struct dect_uring *ur, struct dect_handle *dh,
+				  struct dect_uring_sock *sk, bool eof)
+{
+	if (sk->dfd == NULL || !(sk->events & DECT_FD_READ))
+		return;
+	if (ptrqueue_empty(&sk->rx_queue) && !eof)
+		return;
+
+	dect_fd_process(dh, sk->dfd, DECT_FD_READ);
+
+	/* Deliver messages left over by the receive budget on the next call */
+	if (sk->dfd != NULL && sk->events & DECT_FD_READ &&
+	    !ptrqueue_empty(&sk->rx_queue) && list_empty(&sk->rx_list))
+		list_add_tail(&sk->rx_list, &ur->rx_pending);
+}
+
+static void dect_uring_recv_cqe(struct dect_uring *ur, struct dect_handle *dh,
+				const struct io_uring_cqe *cqe, uint64_t data)
+{
+	struct dect_uring_sock *sk = &ur->socks[(uint32_t)data];
+	struct dect_uring_buf *buf;
+	bool eof = false;
+
+	buf = dect_uring_buf_get(ur, cqe);
+	if (sk->owner == NULL || !sk->recv ||
+	    (sk->id & DECT_URING_GEN_MASK) != ((data >> 32) & DECT_URING_GEN_MASK)) {
+		if (buf != NULL)
+			dect_uring_buf_put(ur, buf);
+		return;
+	}
+
+	if (buf != NULL) {
+		if (cqe->res > 0) {
+			buf->len = cqe->res;
+			ptrqueue_add_tail(buf, &sk->rx_queue);
+			sk->rx_count++;
+		} else
+			dect_uring_buf_put(ur, buf);
+	}
+
+	if (!(cqe->flags & IORING_CQE_F_MORE)) {
+		sk->armed  = false;
+		sk->cancel = false;
+		if (cqe->res == 0) {
+			/* Reads return the end of data link once drained */
+			sk->eof = true;
+			eof = true;
+		} else if (cqe->res == -ENOBUFS || cqe->res == -ECANCELED ||
+			   cqe->res > 0) {
+			if (list_empty(&sk->arm_list))
+				list_add_tail(&sk->arm_list, &ur->arm_pending);
+		} else {
+			dect_uring_sock_fallback(ur, sk);
+			eof = true;
+		}
+	} else if (sk->rx_count >= DECT_URING_RX_MAX && !sk->cancel) {
+		/* Stop receiving until the owner has caught up */
+		dect_uring_cancel(ur, data);
+		sk->cancel = true;
+	}
+
+	dect_uring_rx_process(ur, dh, sk, eof);
+}
+
+static ssize_t dect_uring_recvmsg(const struct dect_fd *dfd,
+				  struct msghdr *msg, int flags)
+{
+	struct dect_uring *ur = dect_uring_transport(dfd);
+	struct dect_uring_sock *sk = &ur->socks[dfd->fd];
+	struct dect_uring_buf *buf = sk->rx_queue.head;
+	const uint8_t *data;
+	size_t len, off;
+	unsigned int i;
+
+	if (buf == NULL) {
+		/* Read directly while no receive request is in flight */
+		if (!sk->recv || !sk->armed)
+			return dect_kernel_transport.ops->recvmsg(dfd, msg, flags);
+		errno = EAGAIN;
+		return -1;
+	}
+
+	data = ur->bufdata[buf - ur->bufs];
+	for (i = 0, off = 0; i < msg->msg_iovlen && off < buf->len; i++) {
+		len = min(msg->msg_iov[i].iov_len, buf->len - off);
+		memcpy(msg->msg_iov[i].iov_base, data + off, len);
+		off += len;
+	}
+
+	msg->msg_namelen    = 0;
+	msg->msg_controllen = 0;
+	msg->msg_flags      = off < buf->len ? MSG_TRUNC : 0;
+	len = flags & MSG_TRUNC ? buf->len : off;
+
+	if (!(flags & MSG_PEEK)) {
+		ptrqueue_dequeue_head(&sk->rx_queue);
+		sk->rx_count--;
+		dect_uring_buf_put(ur, buf);
+	}
+	return len;
+}
+
+/*
+ * Sending
+ */
+
+static void dect_uring_tx_schedule(struct dect_uring *ur,
+				   struct dect_uring_sock *sk)
+{
+	if (ptrqueue_empty(&sk->tx_inflight) && !ptrqueue_empty(&sk->tx_queue) &&
+	    list_empty(&sk->tx_list))
+		list_add_tail(&sk->tx_list, &ur->tx_pending);
+}
+
+/* Submit the queued messages of each socket as a chain of linked sends */
+static void dect_uring_flush(struct dect_uring *ur)
+{
+	struct dect_uring_sock *sk, *next;
+	struct dect_uring_tx *tx;
+	struct io_uring_sqe *sqe;
+	unsigned int n;
+
+	list_for_each_entry_safe(sk, next, &ur->tx_pending, tx_list) {
+		n = 0;
+		for (tx = sk->tx_queue.head; tx != NULL; tx = tx->next)
+			n++;
+		/* A chain must not be split over two submissions */
+		if (io_uring_sq_space_left(&ur->ring) < n)
+			io_uring_submit(&ur->ring);
+
+		list_del_init(&sk->tx_list);
+		while ((tx = ptrqueue_dequeue_head(&sk->tx_queue)) != NULL) {
+			sqe = io_uring_get_sqe(&ur->ring);
+			io_uring_prep_send(sqe, tx->fd, tx->data, tx->len,
+					   tx->flags);
+			if (sk->tx_queue.head != NULL)
+				sqe->flags |= IOSQE_IO_LINK;
+			io_uring_sqe_set_data64(sqe, (uintptr_t)tx);
+			ptrqueue_add_tail(tx, &sk->tx_inflight);
+		}
+	}
+}
+
+static void dect_uring_send_cqe(struct dect_uring *ur, struct dect_handle *dh,
+				const struct io_uring_cqe *cqe,
+				struct dect_uring_tx *tx)
+{
+	struct dect_uring_sock *sk = &ur->socks[tx->fd];
+
+	if (sk->id != tx->id || sk->tx_inflight.head != tx) {
+		ur->dops->free(tx);
+		return;
+	}
+	ptrqueue_dequeue_head(&sk->tx_inflight);
+	sk->tx_count--;
+	ur->dops->free(tx);
+
+	if (!ptrqueue_empty(&sk->tx_inflight))
+		return;
+
+	if (sk->closing && ptrqueue_empty(&sk->tx_queue)) {
+		close(sk - ur->socks);
+		sk->closing = false;
+		return;
+	}
+	dect_uring_tx_schedule(ur, sk);
+
+	if (sk->tx_blocked && sk->tx_count < DECT_URING_TX_MAX) {
+		sk->tx_blocked = false;
+		if (sk->dfd != NULL && sk->events & DECT_FD_WRITE)
+			dect_fd_process(dh, sk->dfd, DECT_FD_WRITE);
+	}
+}
+
+static ssize_t dect_uring_queue(struct dect_uring *ur,
+				struct dect_uring_sock *sk,
+				const struct msghdr *msg, int flags)
+{
+	struct dect_uring_tx *tx;
+	size_t len = 0, off = 0;
+	unsigned int i;
+
+	if (sk->tx_count >= DECT_URING_TX_MAX) {
+		sk->tx_blocked = true;
+		errno = EAGAIN;
+		return -1;
+	}
+
+	for (i = 0; i < msg->msg_iovlen; i++)
+		len += msg->msg_iov[i].iov_len;
+
+	tx = ur->dops->malloc(sizeof(*tx) + len);
+	if (tx == NULL) {
+		errno = ENOMEM;
+		return -1;
+	}
+	tx->fd	  = sk - ur->socks;
+	tx->id	  = sk->id;
+	tx->flags = flags | MSG_NOSIGNAL;
+	tx->len	  = len;
+	for (i = 0; i < msg->msg_iovlen; i++) {
+		memcpy(tx->data + off, msg->msg_iov[i].iov_base,
+		       msg->msg_iov[i].iov_len);
+		off += msg->msg_iov[i].iov_len;
+	}
+
+	ptrqueue_add_tail(tx, &sk->tx_queue);
+	sk->tx_count++;
+	dect_uring_tx_schedule(ur, sk);
+	return len;
+}
+
+/* Addressed messages are sent directly unless they would overtake */
+static ssize_t dect_uring_send(struct dect_uring *ur, const struct dect_fd *dfd,
+			       const struct msghdr *msg, int flags)
+{
+	struct dect_uring_sock *sk = &ur->socks[dfd->fd];
+
+	if (msg->msg_name == NULL && msg->msg_controllen == 0)
+		return dect_uring_queue(ur, sk, msg, flags);
+
+	if (sk->tx_count > 0) {
+		errno = EAGAIN;
+		return -1;
+	}
+	return dect_kernel_transport.ops->sendmsg(dfd, msg, flags);
+}
+
+static ssize_t dect_uring_sendmsg(const struct dect_fd *dfd,
+				  const struct msghdr *msg, int flags)
+{
+	struct dect_uring *ur = dect_uring_transport(dfd);
+	ssize_t len;
+
+	len = dect_uring_send(ur, dfd, msg, flags);
+	dect_uring_submit(ur);
+	return len;
+}
+
+static int dect_uring_sendmmsg(const struct dect_fd *dfd,
+			       struct mmsghdr *msgs, unsigned int vlen,
+			       int flags)
+{
+	struct dect_uring *ur = dect_uring_transport(dfd);
+	unsigned int i;
+	ssize_t len;
+
+	for (i = 0; i < vlen; i++) {
+		len = dect_uring_send(ur, dfd, &msgs[i].msg_hdr, flags);
+		if (len < 0)
+			break;
+		msgs[i].msg_len = len;
+	}
+	dect_uring_submit(ur);
+	return i == 0 && vlen > 0 ? -1 : (int)i;
+}
+
+/*
+ * Closing a socket cancels its receive request, the fd is closed once the
+ * queued messages have been sent.
+ */
+static void dect_uring_close(struct dect_fd *dfd)
+{
+	struct dect_uring *ur = dect_uring_transport(dfd);
+	struct dect_uring_sock *sk = &ur->socks[dfd->fd];
+
+	if (sk->owner == dfd) {
+		dect_uring_sock_release(ur, sk);
+		if (sk->tx_count > 0) {
+			sk->closing = true;
+			dect_uring_submit(ur);
+			return;
+		}
+		dect_uring_submit(ur);
+	}
+	dect_kernel_transport.ops->close(dfd);
+}
+
+/*
+ * Detaching a socket passed to another process submits its queued messages
+ * and stops receiving, received messages which have not been read are lost.
+ */
+static void dect_uring_detach(struct dect_fd *dfd)
+{
+	struct dect_uring *ur = dect_uring_transport(dfd);
+	struct dect_uring_sock *sk = &ur->socks[dfd->fd];
+
+	if (sk->owner == dfd) {
+		dect_uring_sock_release(ur, sk);
+		dect_uring_flush(ur);
+		io_uring_submit(&ur->ring);
+	}
+	dfd->transport = &dect_kernel_transport;
+}
+
+/*
+ * Event ops
+ */
+
+static int dect_uring_register_fd(const struct dect_handle *dh,
+				  struct dect_fd *dfd, uint32_t events)
+{
+	struct dect_uring *ur = dect_uring(dh);
+	struct dect_uring_sock *sk;
+
+	if (dfd->fd >= DECT_URING_FD_MAX) {
+		errno = EMFILE;
+		return -1;
+	}
+	sk = &ur->socks[dfd->fd];
+	if (sk->owner != dfd)
+		dect_uring_sock_attach(ur, dh, sk, dfd);
+
+	sk->gen++;
+	sk->events = events;
+	if (dect_uring_sock_poll(ur, sk) < 0)
+		return -1;
+	sk->dfd = dfd;
+
+	if (sk->recv && events & DECT_FD_READ) {
+		if (!ptrqueue_empty(&sk->rx_queue) && list_empty(&sk->rx_list))
+			list_add_tail(&sk->rx_list, &ur->rx_pending);
+		if (!sk->armed && list_empty(&sk->arm_list))
+			list_add_tail(&sk->arm_list, &ur->arm_pending);
+	}
+
+	dect_uring_submit(ur);
+	return 0;
+}
+
+static void dect_uring_unregister_fd(const struct dect_handle *dh,
+				     struct dect_fd *dfd)
+{
+	struct dect_uring *ur = dect_uring(dh);
+	struct dect_uring_sock *sk = &ur->socks[dfd->fd];
+
+	dect_uring_sock_unpoll(ur, sk);
+
+	/*
+	 * Completions still in flight for this registration are stale, the
+	 * receive request stays armed and queues messages for the owner.
+	 */
+	sk->dfd = NULL;
+	sk->events = 0;
+	sk->gen++;
+	list_del_init(&sk->rx_list);
+
+	dect_uring_submit(ur);
+}
+
+static void dect_uring_start_timer(const struct dect_handle *dh,
+				   struct dect_timer *timer,
+				   const struct timeval *tv)
+{
+	dect_timer_queue_add(&dect_uring(dh)->tq, timer, tv);
+}
+
+static void dect_uring_stop_timer(const struct dect_handle *dh,
+				  struct dect_timer *timer)
+{
+	dect_timer_queue_del(&dect_uring(dh)->tq, timer);
+}
+
+static void dect_uring_poll_cqe(struct dect_uring *ur, struct dect_handle *dh,
+				const struct io_uring_cqe *cqe, uint64_t data)
+{
+	struct dect_uring_sock *sk = &ur->socks[(uint32_t)data];
+	uint32_t events;
+
+	if (sk->dfd == NULL ||
+	    (sk->gen & DECT_URING_GEN_MASK) != ((data >> 32) & DECT_URING_GEN_MASK))
+		return;
+
+	if (cqe->res < 0) {
+		/*
+		 * The poll failed and is not re-armed, let the owner run into
+		 * the error on its next I/O operation.
+		 */
+		sk->gen++;
+		events = sk->events;
+		if (sk->recv)
+			events &= ~DECT_FD_READ;
+	} else {
+		/* Multishot polls may terminate, for instance on CQ overflow */
+		if (!(cqe->flags & IORING_CQE_F_MORE))
+			dect_uring_sock_poll(ur, sk);
+		if (cqe->res == 0)
+			return;
+
+		events = 0;
+		if (cqe->res & POLLOUT)
+			events |= DECT_FD_WRITE;
+		if (cqe->res & ~POLLOUT)
+			events |= DECT_FD_READ;
+		events &= sk->events;
+	}
+
+	if (events)
+		dect_fd_process(dh, sk->dfd, events);
+}
+
+static void dect_uring_cqe(struct dect_uring *ur, struct dect_handle *dh,
+			   const struct io_uring_cqe *cqe)
+{
+	uint64_t data = io_uring_cqe_get_data64(cqe);
+
+	if (data == DECT_URING_IGNORE)
+		return;
+
+	if (data == DECT_URING_TIMER) {
+		/* A failing timerfd poll would only fail again */
+		if (cqe->res >= 0 && !(cqe->flags & IORING_CQE_F_MORE))
+			dect_uring_poll(ur, ur->tq.tfd, POLLIN, true,
+					DECT_URING_TIMER);
+		dect_timer_queue_run(&ur->tq, dh);
+		return;
+	}
+
+	switch (data >> 56) {
+	case DECT_URING_OP_POLL:
+		return dect_uring_poll_cqe(ur, dh, cqe, data);
+	case DECT_URING_OP_RECV:
+		return dect_uring_recv_cqe(ur, dh, cqe, data);
+	default:
+		return dect_uring_send_cqe(ur, dh, cqe,
+					   (struct dect_uring_tx *)(uintptr_t)data);
+	}
+}
+
+/**
+ * Allocate an io_uring event backend and install its event ops
+ *
+ * @param ops		DECT ops
+ *
+ * Initialize ops->event_ops to use the io_uring event handler. The backend
+ * must not be released before the handle using it has been closed.
+ *
+ * @return the new event backend or NULL on error.
+ */
+struct dect_uring *dect_uring_alloc(struct dect_ops *ops)
+{
+	struct dect_uring_sock *sk;
+	struct dect_uring *ur;
+	unsigned int i;
+	int err;
+
+	if (ops->malloc == NULL)
+		ops->malloc = malloc;
+	if (ops->free == NULL)
+		ops->free = free;
+
+	ur = ops->malloc(sizeof(*ur));
+	if (ur == NULL)
+		goto err1;
+	memset(ur, 0, sizeof(*ur));
+	ur->dops = ops;
+	init_list_head(&ur->rx_pending);
+	init_list_head(&ur->arm_pending);
+	init_list_head(&ur->tx_pending);
+
+	for (i = 0; i < DECT_URING_FD_MAX; i++) {
+		sk = &ur->socks[i];
+		ptrqueue_init(&sk->rx_queue);
+		ptrqueue_init(&sk->tx_queue);
+		ptrqueue_init(&sk->tx_inflight);
+		init_list_head(&sk->rx_list);
+		init_list_head(&sk->arm_list);
+		init_list_head(&sk->tx_list);
+	}
+
+	ur->tops		= *dect_kernel_transport.ops;
+	ur->tops.close		= dect_uring_close;
+	ur->tops.detach		= dect_uring_detach;
+	ur->tops.recvmsg	= dect_uring_recvmsg;
+	ur->tops.sendmsg	= dect_uring_sendmsg;
+	ur->tops.sendmmsg	= dect_uring_sendmmsg;
+	ur->transport.ops	= &ur->tops;
+
+	ur->ops.register_fd	= dect_uring_register_fd;
+	ur->ops.unregister_fd	= dect_uring_unregister_fd;
+	ur->ops.timer_priv_size	= sizeof(struct dect_timer_queue_entry);
+	ur->ops.start_timer	= dect_uring_start_timer;
+	ur->ops.stop_timer	= dect_uring_stop_timer;
+
+	err = io_uring_queue_init(DECT_URING_ENTRIES, &ur->ring, 0);
+	if (err < 0) {
+		errno = -err;
+		goto err2;
+	}
+
+	ur->br = io_uring_setup_buf_ring(&ur->ring, DECT_URING_BUFS,
+					 DECT_URING_BGID, 0, &err);
+	if (ur->br == NULL) {
+		errno = -err;
+		goto err3;
+	}
+	for (i = 0; i < DECT_URING_BUFS; i++)
+		dect_uring_buf_put(ur, &ur->bufs[i]);
+
+	if (dect_timer_queue_init(&ur->tq) < 0)
+		goto err4;
+	if (dect_uring_poll(ur, ur->tq.tfd, POLLIN, true, DECT_URING_TIMER) < 0)
+		goto err5;
+	io_uring_submit(&ur->ring);
+
+	ops->event_ops = &ur->ops;
+	return ur;
+
+err5:
+	dect_timer_queue_exit(&ur->tq);
+err4:
+	io_uring_free_buf_ring(&ur->ring, ur->br, DECT_URING_BUFS,
+			       DECT_URING_BGID);
+err3:
+	io_uring_queue_exit(&ur->ring);
+err2:
+	ops->free(ur);
+err1:
+	return NULL;
+}
+EXPORT_SYMBOL(dect_uring_alloc);
+
+/**
+ * Release an io_uring event backend
+ *
+ * @param ur		io_uring event backend
+ *
+ * Messages which have not been sent yet are discarded.
+ */
+void dect_uring_free(struct dect_uring *ur)
+{
+	struct dect_uring_sock *sk;
+	struct dect_uring_tx *tx;
+	unsigned int i;
+
+	dect_timer_queue_exit(&ur->tq);
+	io_uring_free_buf_ring(&ur->ring, ur->br, DECT_URING_BUFS,
+			       DECT_URING_BGID);
+	io_uring_queue_exit(&ur->ring);
+
+	for (i = 0; i < DECT_URING_FD_MAX; i++) {
+		sk = &ur->socks[i];
+		while ((tx = ptrqueue_dequeue_head(&sk->tx_queue)) != NULL)
+			ur->dops->free(tx);
+		while ((tx = ptrqueue_dequeue_head(&sk->tx_inflight)) != NULL)
+			ur->dops->free(tx);
+		if (sk->closing)
+			close(i);
+	}
+	ur->dops->free(ur);
+}
+EXPORT_SYMBOL(dect_uring_free);
+
+/**
+ * Get the pollable file descriptor of an io_uring event backend
+ *
+ * @param ur		io_uring event backend
+ *
+ * The file descriptor becomes readable when completions are pending.
+ */
+int dect_uring_fd(const struct dect_uring *ur)
+{
+	return ur->ring.ring_fd;
+}
+EXPORT_SYMBOL(dect_uring_fd);
+
+/**
+ * Wait for and process pending events
+ *
+ * @param ur		io_uring event backend
+ * @param dh		libdect DECT handle
+ * @param timeout	maximum time to wait in milliseconds, -1 for infinite
+ *
+ * Submit queued registration changes, wait for completions and process
+ * them. Messages left over from the previous call are delivered without
+ * waiting, messages sent while processing events are submitted at the end.
+ *
+ * @return the number of processed events or -1 on error.
+ */
+int dect_uring_dispatch(struct dect_uring *ur, struct dect_handle *dh,
+			int timeout)
+{
+	struct __kernel_timespec ts = {
+		.tv_sec		= timeout / 1000,
+		.tv_nsec	= (timeout % 1000) * 1000000LL,
+	};
+	struct dect_uring_sock *sk;
+	struct io_uring_cqe *cqe;
+	unsigned int head, n = 0;
+	LIST_HEAD(pending);
+	int err;
+
+	err = io_uring_submit_and_wait_timeout(&ur->ring, &cqe,
+					       list_empty(&ur->rx_pending),
+					       timeout < 0 ? NULL : &ts, NULL);
+	if (err < 0 && err != -ETIME && err != -EINTR && err != -EAGAIN) {
+		errno = -err;
+		return -1;
+	}
+
+	ur->dispatching = true;
+	list_splice_init(&ur->rx_pending, &pending);
+
+	io_uring_for_each_cqe(&ur->ring, head, cqe) {
+		dect_uring_cqe(ur, dh, cqe);
+		n++;
+	}
+	io_uring_cq_advance(&ur->ring, n);
+
+	while (!list_empty(&pending)) {
+		sk = list_first_entry(&pending, struct dect_uring_sock, rx_list);
+		list_del_init(&sk->rx_list);
+		dect_uring_rx_process(ur, dh, sk, false);
+		n++;
+	}
+	ur->dispatching = false;
+
+	/* Submit registration changes and messages sent while processing */
+	dect_uring_rearm(ur);
+	dect_uring_flush(ur);
+	if (io_uring_sq_ready(&ur->ring))
+		io_uring_submit(&ur->ring);
+	return n;
+}
+EXPORT_SYMBOL(dect_uring_dispatch);
+
+/** @} */
+/** @} */
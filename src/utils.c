@@ -12,26 +12,391 @@
 #include <stdbool.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
 
 #include <libdect.h>
 #include <utils.h>
 
-void *dect_malloc(const struct dect_handle *dh, size_t size)
+/**
+ * @defgroup mem Memory accounting
+ *
+ * Per-handle accounting of all memory allocated by libdect.
+ *
+ * Each allocation is accounted to an object type with the number of live
+ * objects and bytes, the peak of live bytes and the number of allocations
+ * and failures, in addition to the totals of all types. Applications can
+ * poll a copy using dect_mem_snapshot() to bound memory usage or to find
+ * leaks. Optional limits of the live bytes per type and in total make
+ * allocations exceeding them fail like allocator failures, with errno set
+ * to ENOMEM.
+ *
+ * @{
+ */
+
+/**
+ * Accounting header preceding each allocation
+ *
+ * @size:	requested size
+ * @type:	object type
+ *
+ * The header is padded to preserve the alignment of the underlying allocator.
+ */
+struct dect_mem_hdr {
+	size_t			size;
+	enum dect_mem_types	type;
+} __aligned(16);
+
+/**
+ * Object cache of a memory type
+ *
+ * @objs:	cached objects, linked through their first word
+ * @cnt:	number of cached objects
+ * @max:	maximum number of cached objects
+ */
+struct dect_mem_cache {
+	void			*objs;
+	unsigned int		cnt;
+	unsigned int		max;
+};
+
+/**
+ * Memory accounting state
+ *
+ * @stats:	memory statistics
+ * @limit:	live byte limit per type, zero when unlimited
+ * @total_limit: live byte limit of all types, zero when unlimited
+ * @cache:	object caches per type
+ */
+struct dect_mem {
+	struct dect_mem_stats	stats;
+	uint64_t		limit[DECT_MEM_MAX + 1];
+	uint64_t		total_limit;
+	struct dect_mem_cache	cache[DECT_MEM_MAX + 1];
+};
+
+static const char * const dect_mem_type_names[DECT_MEM_MAX + 1] = {
+	[DECT_MEM_OTHER]	= "other",
+	[DECT_MEM_CALL]		= "call",
+	[DECT_MEM_LINK]		= "link",
+	[DECT_MEM_LTE]		= "lte",
+	[DECT_MEM_MM_ENDPOINT]	= "mm-endpoint",
+	[DECT_MEM_SS_ENDPOINT]	= "ss-endpoint",
+	[DECT_MEM_IE]		= "ie",
+	[DECT_MEM_MBUF]		= "mbuf",
+	[DECT_MEM_TIMER]	= "timer",
+	[DECT_MEM_RTX]		= "rtx",
+};
+
+/**
+ * Get the name of a memory object type
+ *
+ * @param type		object type
+ */
+const char *dect_mem_type_name(enum dect_mem_types type)
 {
-	return dh->ops->malloc(size);
+	if (type > DECT_MEM_MAX)
+		return "unknown";
+	return dect_mem_type_names[type];
 }
+EXPORT_SYMBOL(dect_mem_type_name);
 
-void *dect_zalloc(const struct dect_handle *dh, size_t size)
+static void dect_mem_account(struct dect_mem_type_stats *ts, size_t size)
+{
+	ts->allocs++;
+	ts->objects++;
+	ts->bytes += size;
+	if (ts->bytes > ts->peak_bytes)
+		ts->peak_bytes = ts->bytes;
+}
+
+static void dect_mem_unaccount(struct dect_mem_type_stats *ts, size_t size)
+{
+	ts->objects--;
+	ts->bytes -= size;
+}
+
+static bool dect_mem_over_limit(const struct dect_mem *mem,
+				enum dect_mem_types type, size_t size)
+{
+	return (mem->limit[type] &&
+		mem->stats.type[type].bytes + size > mem->limit[type]) ||
+	       (mem->total_limit &&
+		mem->stats.total.bytes + size > mem->total_limit);
+}
+
+static void dect_mem_cache_flush(const struct dect_handle *dh);
+
+void *dect_malloc_type(const struct dect_handle *dh,
+		       enum dect_mem_types type, size_t size)
+{
+	struct dect_mem *mem = dh->mem;
+	struct dect_mem_type_stats *ts = &mem->stats.type[type];
+	struct dect_mem_hdr *hdr;
+
+	/* Cached objects must not cause allocations to fail */
+	if (dect_mem_over_limit(mem, type, size)) {
+		dect_mem_cache_flush(dh);
+		if (dect_mem_over_limit(mem, type, size)) {
+			errno = ENOMEM;
+			goto err1;
+		}
+	}
+
+	hdr = dh->ops->malloc(sizeof(*hdr) + size);
+	if (hdr == NULL)
+		goto err1;
+	hdr->size = size;
+	hdr->type = type;
+
+	dect_mem_account(ts, size);
+	dect_mem_account(&mem->stats.total, size);
+	return hdr + 1;
+
+err1:
+	ts->failures++;
+	mem->stats.total.failures++;
+	return NULL;
+}
+
+void *dect_zalloc_type(const struct dect_handle *dh,
+		       enum dect_mem_types type, size_t size)
 {
 	void *ptr;
 
-	ptr = dect_malloc(dh, size);
+	ptr = dect_malloc_type(dh, type, size);
 	if (ptr != NULL)
 		memset(ptr, 0, size);
 	return ptr;
 }
 
+void *dect_malloc(const struct dect_handle *dh, size_t size)
+{
+	return dect_malloc_type(dh, DECT_MEM_OTHER, size);
+}
+
+void *dect_zalloc(const struct dect_handle *dh, size_t size)
+{
+	return dect_zalloc_type(dh, DECT_MEM_OTHER, size);
+}
+
 void dect_free(const struct dect_handle *dh, void *ptr)
 {
-	dh->ops->free(ptr);
+	struct dect_mem *mem = dh->mem;
+	struct dect_mem_hdr *hdr;
+
+	if (ptr == NULL)
+		return;
+	hdr = (struct dect_mem_hdr *)ptr - 1;
+
+	dect_mem_unaccount(&mem->stats.type[hdr->type], hdr->size);
+	dect_mem_unaccount(&mem->stats.total, hdr->size);
+	dh->ops->free(hdr);
+}
+
+/*
+ * Object caches
+ *
+ * Frequently allocated objects of fixed size per handle, like calls, MM and
+ * SS endpoints and data links, are kept in a per-type free list when
+ * released, so churn doesn't hit the allocator for each object. Cached
+ * objects remain accounted to their type and are zeroed when reused.
+ */
+
+static void dect_mem_cache_account(struct dect_mem *mem,
+				   enum dect_mem_types type, int delta)
+{
+	mem->cache[type].cnt		+= delta;
+	mem->stats.type[type].cached	+= delta;
+	mem->stats.total.cached		+= delta;
 }
+
+static void *dect_mem_cache_get(const struct dect_handle *dh,
+				enum dect_mem_types type)
+{
+	struct dect_mem *mem = dh->mem;
+	struct dect_mem_cache *cache = &mem->cache[type];
+	void *ptr;
+
+	ptr = cache->objs;
+	if (ptr != NULL) {
+		cache->objs = *(void **)ptr;
+		dect_mem_cache_account(mem, type, -1);
+	}
+	return ptr;
+}
+
+static void dect_mem_cache_shrink(const struct dect_handle *dh,
+				  enum dect_mem_types type, unsigned int max)
+{
+	while (dh->mem->cache[type].cnt > max)
+		dect_free(dh, dect_mem_cache_get(dh, type));
+}
+
+static void dect_mem_cache_flush(const struct dect_handle *dh)
+{
+	enum dect_mem_types type;
+
+	for (type = 0; type <= DECT_MEM_MAX; type++)
+		dect_mem_cache_shrink(dh, type, 0);
+}
+
+/**
+ * dect_cache_alloc - allocate a zeroed object from the object cache
+ *
+ * @dh:		libdect DECT handle
+ * @type:	object type
+ * @size:	object size
+ *
+ * Objects must be released using dect_cache_free().
+ */
+void *dect_cache_alloc(const struct dect_handle *dh,
+		       enum dect_mem_types type, size_t size)
+{
+	struct dect_mem *mem = dh->mem;
+	struct dect_mem_hdr *hdr;
+	void *ptr;
+
+	while ((ptr = dect_mem_cache_get(dh, type)) != NULL) {
+		hdr = (struct dect_mem_hdr *)ptr - 1;
+		if (hdr->size != size) {
+			dect_free(dh, ptr);
+			continue;
+		}
+
+		mem->stats.type[type].cache_hits++;
+		mem->stats.total.cache_hits++;
+		memset(ptr, 0, size);
+		return ptr;
+	}
+
+	return dect_zalloc_type(dh, type, size);
+}
+
+/**
+ * dect_cache_free - release an object to the object cache
+ *
+ * @dh:		libdect DECT handle
+ * @ptr:	object allocated using dect_cache_alloc()
+ */
+void dect_cache_free(const struct dect_handle *dh, void *ptr)
+{
+	struct dect_mem *mem = dh->mem;
+	struct dect_mem_cache *cache;
+	struct dect_mem_hdr *hdr;
+
+	if (ptr == NULL)
+		return;
+	hdr   = (struct dect_mem_hdr *)ptr - 1;
+	cache = &mem->cache[hdr->type];
+
+	if (cache->cnt >= cache->max || hdr->size < sizeof(void *))
+		return dect_free(dh, ptr);
+
+	*(void **)ptr = cache->objs;
+	cache->objs = ptr;
+	dect_mem_cache_account(mem, hdr->type, 1);
+}
+
+int dect_mem_init(struct dect_handle *dh)
+{
+	enum dect_mem_types type;
+
+	dh->mem = dh->ops->malloc(sizeof(*dh->mem));
+	if (dh->mem == NULL)
+		return -1;
+	memset(dh->mem, 0, sizeof(*dh->mem));
+	for (type = 0; type <= DECT_MEM_MAX; type++)
+		dh->mem->cache[type].max = DECT_MEM_CACHE_MAX;
+	return 0;
+}
+
+void dect_mem_exit(struct dect_handle *dh)
+{
+	const struct dect_mem_type_stats *ts;
+	enum dect_mem_types type;
+
+	dect_mem_cache_flush(dh);
+	for (type = 0; type <= DECT_MEM_MAX; type++) {
+		ts = &dh->mem->stats.type[type];
+		if (ts->objects == 0)
+			continue;
+		dect_debug(DECT_DEBUG_UNKNOWN,
+			   "mem: %llu %s objects (%llu bytes) not freed\n",
+			   (unsigned long long)ts->objects,
+			   dect_mem_type_names[type],
+			   (unsigned long long)ts->bytes);
+	}
+	dh->ops->free(dh->mem);
+}
+
+/**
+ * Get a snapshot of the memory statistics
+ *
+ * @param dh		libdect DECT handle
+ * @param stats		buffer to store the statistics
+ */
+void dect_mem_snapshot(const struct dect_handle *dh,
+		       struct dect_mem_stats *stats)
+{
+	*stats = dh->mem->stats;
+}
+EXPORT_SYMBOL(dect_mem_snapshot);
+
+/**
+ * Limit the live memory of an object type
+ *
+ * @param dh		libdect DECT handle
+ * @param type		object type
+ * @param bytes		maximum number of live bytes, zero for no limit
+ *
+ * Allocations exceeding the limit fail. Lowering the limit below the current
+ * usage does not release any memory.
+ */
+int dect_mem_set_limit(struct dect_handle *dh, enum dect_mem_types type,
+		       uint64_t bytes)
+{
+	if (type > DECT_MEM_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+	dh->mem->limit[type] = bytes;
+	return 0;
+}
+EXPORT_SYMBOL(dect_mem_set_limit);
+
+/**
+ * Limit the live memory of all object types
+ *
+ * @param dh		libdect DECT handle
+ * @param bytes		maximum number of live bytes, zero for no limit
+ */
+void dect_mem_set_total_limit(struct dect_handle *dh, uint64_t bytes)
+{
+	dh->mem->total_limit = bytes;
+}
+EXPORT_SYMBOL(dect_mem_set_total_limit);
+
+/**
+ * Limit the number of cached objects of an object type
+ *
+ * @param dh		libdect DECT handle
+ * @param type		object type
+ * @param max		maximum number of cached objects, zero to disable caching
+ *
+ * Calls, MM and SS endpoints and data links are cached for reuse when
+ * released, by default up to 16 objects of each type.
+ */
+int dect_mem_set_cache_limit(struct dect_handle *dh, enum dect_mem_types type,
+			     unsigned int max)
+{
+	if (type > DECT_MEM_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+	dh->mem->cache[type].max = max;
+	dect_mem_cache_shrink(dh, type, max);
+	return 0;
+}
+EXPORT_SYMBOL(dect_mem_set_cache_limit);
+
+/** @} */